@@ -70,6 +70,8 @@ std::vector<vrna_path_t> my_get_path(std::string seq, std::string s1, std::strin
 %feature("kwargs") path_findpath;
 %feature("autodoc") path_findpath_saddle;
 %feature("kwargs") path_findpath_saddle;
+%feature("autodoc") path_findpath_saddle_matrix;
+%feature("kwargs") path_findpath_saddle_matrix;
 
   PyObject *
   path_findpath_saddle(std::string s1, std::string s2, int width = 1, int maxE = INT_MAX){
@@ -122,6 +124,28 @@ std::vector<vrna_path_t> my_get_path(std::string seq, std::string s1, std::strin
       return v;
   }
 
+  std::vector<std::vector<int> >
+  path_findpath_saddle_matrix(std::vector<std::string> structures, int width = 1, unsigned int options = VRNA_PATH_SADDLE_MATRIX_DEFAULT){
+      std::vector<std::vector<int> > S;
+      std::vector<const char*>  v;
+      int                       i, n, *m;
+
+      /* convert std::vector<std::string> to vector<const char *> */
+      std::transform(structures.begin(), structures.end(), std::back_inserter(v), convert_vecstring2veccharcp);
+      v.push_back(NULL); /* mark end of structures */
+
+      n = (int)structures.size();
+      m = vrna_path_findpath_saddle_matrix($self, (const char **)&v[0], width, options);
+
+      if (m) {
+        for (i = 0; i < n; i++)
+          S.push_back(std::vector<int>(m + n * i, m + n * (i + 1)));
+
+        free(m);
+      }
+
+      return S;
+  }
 }
 
 
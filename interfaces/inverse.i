@@ -57,6 +57,14 @@ char * my_inverse_pf_fold(char *start, const char *target, float *OUTPUT);
 
 %ignore inverse_fold;
 %ignore inverse_pf_fold;
+%ignore vrna_inverse_s;
+%ignore vrna_inverse_t;
+%ignore vrna_inverse_init;
+%ignore vrna_inverse_free;
+%ignore vrna_inverse_seed;
+%ignore vrna_inverse_mfe;
+%ignore vrna_inverse_pf;
+%ignore vrna_inverse_failure;
 
 
 %init %{
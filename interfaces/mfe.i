@@ -200,6 +200,7 @@ char *my_alifold(std::vector<std::string> alignment, char *constraints, float *O
 
 /* tell swig that these functions return objects that require memory management */
 %newobject vrna_fold_compound_t::mfe;
+%newobject vrna_fold_compound_t::mfe_update;
 %newobject vrna_fold_compound_t::mfe_dimer;
 
 %extend vrna_fold_compound_t {
@@ -207,6 +208,8 @@ char *my_alifold(std::vector<std::string> alignment, char *constraints, float *O
 #ifdef SWIGPYTHON
 %feature("autodoc") mfe;
 %feature("kwargs") mfe;
+%feature("autodoc") mfe_update;
+%feature("kwargs") mfe_update;
 %feature("autodoc") mfe_dimer;
 %feature("kwargs") mfe_dimer;
 #endif
@@ -218,6 +221,14 @@ char *my_alifold(std::vector<std::string> alignment, char *constraints, float *O
     return structure;
   }
 
+  /* MFE re-computation after adding hard constraints */
+  char *mfe_update(float *OUTPUT){
+
+    char *structure = (char *)vrna_alloc(sizeof(char) * ($self->length + 1));
+    *OUTPUT = vrna_mfe_update($self, structure);
+    return structure;
+  }
+
   /* MFE for 2 RNA strands */
   char *mfe_dimer(float *OUTPUT){
 
@@ -243,6 +243,42 @@ std::vector<int> my_loopidx_from_ptable(std::vector<int> pt);
 
 int my_bp_distance(const char *str1, const char *str2);
 
+
+%rename (bp_distance_matrix) my_bp_distance_matrix;
+%{
+  std::vector<std::vector<int> >
+  my_bp_distance_matrix(std::vector<std::string> structures)
+  {
+    std::vector<const char*>        v;
+    std::vector<std::vector<int> >  D;
+    int                             i, n, *m;
+
+    /* convert std::vector<std::string> to vector<const char *> */
+    std::transform(structures.begin(), structures.end(), std::back_inserter(v), convert_vecstring2veccharcp);
+    v.push_back(NULL); /* mark end of structures */
+
+    n = (int)structures.size();
+    m = vrna_bp_distance_matrix((const char **)&v[0]);
+
+    /* row i of the lower triangle holds the distances to structures 0, ..., i - 1 */
+    if (m) {
+      for (i = 0; i < n; i++)
+        D.push_back(std::vector<int>(m + i * (i - 1) / 2, m + i * (i - 1) / 2 + i));
+
+      free(m);
+    }
+
+    return D;
+  }
+%}
+
+#ifdef SWIGPYTHON
+%feature("autodoc") my_bp_distance_matrix;
+%feature("kwargs") my_bp_distance_matrix;
+#endif
+
+std::vector<std::vector<int> > my_bp_distance_matrix(std::vector<std::string> structures);
+
 %rename (dist_mountain) my_dist_mountain;
 
 %{
@@ -17,14 +17,15 @@
 #define PRIVATE   static
 
 PRIVATE void usage(void);
+PRIVATE void analyse(Condensed_Matrix *cm, char *type, short Do_Split, short Do_Wards, short Do_Nj);
 
 int main(int argc, char *argv[])
 {
-   int     i,j;
-   float **dm;
-   Split  *S;
-   Union  *U;
+   int     i,j,n_taxa=0;
+   Condensed_Matrix *cm;
+   Binary_Matrices  *bm;
    char    type[5];
+   char   *binary_file=NULL;
 
    short   Do_Split=1, Do_Wards=0, Do_Nj=0;
 
@@ -48,44 +49,71 @@ int main(int argc, char *argv[])
 	       }
 	    }
 	    break;
+	  case 'B':  if (++i>=argc) usage();
+	    binary_file = argv[i];
+	    break;
+	  case 'N':  if ((++i>=argc)||(sscanf(argv[i],"%d",&n_taxa)!=1)) usage();
+	    break;
 	    default : 
 	    usage();
          }
       }
    }
 
-   while ((dm=read_distance_matrix(type))!=NULL) {
-
-      printf_taxa_list();
-      printf("> %s\n",type);
-      
-      if(Do_Split) {
-         S = split_decomposition(dm);
-         sort_Split(S);
-         print_Split(S);
-         free_Split(S);
-      }
-      if(Do_Wards) {
-         U = wards_cluster(dm);
-
-         printf_phylogeny(U,"W");
-         PSplot_phylogeny(U,"wards.ps","Ward's Method");
-         free(U);
+   if (binary_file) {
+      /* RNAdistance --binary-matrix writes base pair distances */
+      strcpy(type,"P");
+      bm = open_binary_distance_matrices(binary_file, n_taxa);
+      for (i=0; (cm=read_binary_distance_matrix(bm,i))!=NULL; i++) {
+         analyse(cm, type, Do_Split, Do_Wards, Do_Nj);
+         free_condensed_matrix(cm);
       }
-      if(Do_Nj) {
-         U = neighbour_joining(dm);
-         printf_phylogeny(U,"Nj");
-         PSplot_phylogeny(U,"nj.ps","Neighbor Joining");
-         free(U);
+      close_binary_distance_matrices(bm);
+   } else {
+      while ((cm=read_condensed_distance_matrix(type))!=NULL) {
+         printf_taxa_list();
+         analyse(cm, type, Do_Split, Do_Wards, Do_Nj);
+         free_condensed_matrix(cm);
       }
-      free_distance_matrix(dm);
    }
    return 0;
 }
 
 
+PRIVATE void analyse(Condensed_Matrix *cm, char *type, short Do_Split, short Do_Wards, short Do_Nj)
+{
+   float **dm;
+   Split  *S;
+   Union  *U;
+
+   printf("> %s\n",type);
+      
+   if(Do_Split) {
+      dm = expand_distance_matrix(cm);
+      S = split_decomposition(dm);
+      sort_Split(S);
+      print_Split(S);
+      free_Split(S);
+      free_distance_matrix(dm);
+   }
+   if(Do_Wards) {
+      U = wards_cluster_condensed(cm);
+
+      printf_phylogeny(U,"W");
+      PSplot_phylogeny(U,"wards.ps","Ward's Method");
+      free(U);
+   }
+   if(Do_Nj) {
+      U = neighbour_joining_condensed(cm);
+      printf_phylogeny(U,"Nj");
+      PSplot_phylogeny(U,"nj.ps","Neighbor Joining");
+      free(U);
+   }
+}
+
+
 PRIVATE void usage(void)
 {
-   vrna_message_error("usage: AnalyseDist [-X[swn]]");
+   vrna_message_error("usage: AnalyseDist [-X[swn]] [-B file [-N taxa]]");
    exit(0);
 }
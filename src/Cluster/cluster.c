@@ -2,6 +2,11 @@
 		 Cluster Analysis using Ward's Method
 		Ward J Amer Stat Ass, 58 (1963), p236
 		   c Peter Stadler and Ivo Hofacker
+
+   Ward's method uses the nearest-neighbor chain algorithm in O(n^2)
+   time (Murtagh, Comput J, 26 (1983), p354), neighbour joining prunes
+   its search with sorted rows and row sum bounds as in RapidNJ
+   (Simonsen et al., WABI 2008). Both work on a condensed matrix.
 */
 
 #ifdef HAVE_CONFIG_H
@@ -11,19 +16,16 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <float.h>
 #include "ViennaRNA/utils/basic.h"
+#include "cluster.h"
 
 #define PUBLIC
 #define PRIVATE static
 
-#define INFINITY   1000000
-
-typedef struct{
-        int   set1;
-        int   set2;
-        float distance;
-        float distance2;
-        } Union;
+/* index of the pair i != j in a condensed matrix */
+#define CM_IDX(i, j)  ((i) > (j) ? (size_t)(i) * ((i) - 1) / 2 + (j) \
+                                 : (size_t)(j) * ((j) - 1) / 2 + (i))
 
 typedef struct {
                  int  type; 
@@ -33,225 +35,441 @@ typedef struct {
                  int  leftmostleaf;                 
                } Postorder_list;
 
+typedef struct {
+        float  d;
+        int    id;
+        } Row_Entry;
+
 PUBLIC Union *wards_cluster(float **clmat);
 PUBLIC Union *neighbour_joining(float **clmat);
+PUBLIC Union *wards_cluster_condensed(const Condensed_Matrix *cm);
+PUBLIC Union *neighbour_joining_condensed(const Condensed_Matrix *cm);
 PUBLIC void   printf_phylogeny(Union *tree, char *type);
+
+PRIVATE void  order_merges(Union *tree, Union *merges, float *height, int *child, int n);
+PRIVATE int   merge_before(Union *merges, float *height, int x, int y);
+PRIVATE void  heap_push(int *heap, int *h, int m, Union *merges, float *height);
+PRIVATE int   heap_pop(int *heap, int *h, Union *merges, float *height);
+PRIVATE int   compare_row_entries(const void *p1, const void *p2);
        
 
 /*--------------------------------------------------------------------*/
 
 PUBLIC Union *wards_cluster(float **clmat)
 {
-   float  **d;
-   int      *indic;
-   int      *size;
-   float    *help;
-   Union    *tree;
-
-   float    min,deno,xa,xb,x;
-   int      i,j,step,s=0,t=0,n;
+   Condensed_Matrix *cm;
+   Union            *tree;
 
-   n= (int)(clmat[0][0]);
+   cm   = condense_distance_matrix(clmat);
+   tree = wards_cluster_condensed(cm);
+   free_condensed_matrix(cm);
 
-   size  = (int *)     vrna_alloc((n+1)*sizeof(int));
-   d     = (float **)  vrna_alloc((n+1)*sizeof(float *));
-   for(i=0;i<=n;i++)
-      d[i] = (float *) vrna_alloc((n+1)*sizeof(float));
-   indic = (int *)     vrna_alloc((n+1)*sizeof(int));
-   help  = (float *)   vrna_alloc((n+1)*sizeof(float));
-   tree  = (Union *)   vrna_alloc((n+1)*sizeof(Union));
-
-   tree[0].set1      = n;
-   tree[0].set2      = 0;
-   tree[0].distance  = 0.0;   
-   tree[0].distance2 = 0.0;    
+   return tree;
+}
 
-   for (i=1;i<=n;i++) size[i]=1;
-   for (i=1; i<=n; i++){
-      for(j=1; j<=n; j++){
-         d[i][j] = clmat[i][j];
-      }
-   }
+/*--------------------------------------------------------------------*/
 
-   /* look for the indices [s,t]  with minimum  d[s][t]*/
+PUBLIC Union *wards_cluster_condensed(const Condensed_Matrix *cm)
+{
+   float    *d, *row, *height;
+   int      *size, *chain, *last, *child;
+   char     *indic;
+   Union    *merges, *tree;
+
+   float    min,dst,deno,xa,xb,x;
+   int      a,b,c,s,t,prev,len,next,step,n;
+   size_t   num;
+
+   n   = cm->n;
+   num = (size_t)n*(n-1)/2;
+
+   d      = (float *)  vrna_alloc((num+1)*sizeof(float));
+   size   = (int *)    vrna_alloc((n+1)*sizeof(int));
+   indic  = (char *)   vrna_alloc((n+1)*sizeof(char));
+   chain  = (int *)    vrna_alloc((n+1)*sizeof(int));
+   last   = (int *)    vrna_alloc((n+1)*sizeof(int));
+   child  = (int *)    vrna_alloc(2*(n+1)*sizeof(int));
+   height = (float *)  vrna_alloc((n+1)*sizeof(float));
+   merges = (Union *)  vrna_alloc((n+1)*sizeof(Union));
+   tree   = (Union *)  vrna_alloc((n+1)*sizeof(Union));
+
+   memcpy(d, cm->d, num*sizeof(float));
+   for (c=0; c<n; c++) size[c]=1;
+
+   len  = 0;
+   next = 0;
    for(step=1;step<n; step++){
-      min = INFINITY;
-      for (i=1; i<=n; i++){
-         if (indic[i]==0){
-            for (j=1; j<=n; j++){
-               if(j!=i){
-                  if (indic[j]==0){
-                     if(d[i][j] < min) {
-                        min = d[i][j];
-                        s = i;
-                        t = j;
-                     }
-                  }
-               }
+      /* follow nearest neighbours until two clusters are mutual nearest
+         neighbours. Ties are broken by the smaller index, i.e. pairs are
+         totally ordered exactly as in a scan for the global minimum */
+      while(1){
+         if (len==0) {
+            while (indic[next]) next++;
+            chain[len++] = next;
+         }
+         a    = chain[len-1];
+         prev = (len>1) ? chain[len-2] : -1;
+         min  = FLT_MAX;
+         b    = -1;
+         row = d + (size_t)a*(a-1)/2;
+         for (c=0; c<a; c++){
+            if ((!indic[c])&&((b<0)||(row[c] < min))) {
+               min = row[c];
+               b   = c;
             }
-         }  
-      }
-
-      /* now we have to join the clusters s and t and update the working array*/
-
-      tree[step].set1     = s;
-      tree[step].set2     = t;
-      tree[step].distance = min;
-      indic[t] =1;
-   
-      for (i=1; i<=n; i++){
-         if (indic[i]==0){
-            deno = (float) (size[i]+size[s]+size[t]);
-            xa = ((float) (size[i]+size[s]))/deno; 
-            xb = ((float) (size[i]+size[t]))/deno;
-             x = ((float) size[i])/deno;
-            help[i] = xa*d[i][s] + xb*d[i][t] - x*d[s][t];
          }
+         for (c=a+1; c<n; c++){
+            if ((!indic[c])&&((b<0)||(d[(size_t)c*(c-1)/2+a] < min))) {
+               min = d[(size_t)c*(c-1)/2+a];
+               b   = c;
+            }
+         }
+         if (b==prev) break;
+         chain[len++] = b;
       }
-      for (i=1; i<=n; i++){
-         if (indic[i]==0){
-            d[s][i] = help[i];
-            d[i][s] = help[i];
+      len -= 2;
+
+      /* join the clusters s and t, the joint cluster keeps the smaller index */
+      s   = MIN2(a,b);
+      t   = MAX2(a,b);
+      dst = d[CM_IDX(s,t)];
+
+      for (c=0; c<n; c++){
+         if ((!indic[c])&&(c!=s)&&(c!=t)){
+            deno = (float) (size[c]+size[s]+size[t]);
+            xa = ((float) (size[c]+size[s]))/deno; 
+            xb = ((float) (size[c]+size[t]))/deno;
+             x = ((float) size[c])/deno;
+            d[CM_IDX(c,s)] = xa*d[CM_IDX(c,s)] + xb*d[CM_IDX(c,t)] - x*dst;
          }
       }
+      indic[t] = 1;
       size[s] += size[t];
+
+      merges[step].set1     = s+1;
+      merges[step].set2     = t+1;
+      merges[step].distance = dst;
+      child[2*step]         = last[s];
+      child[2*step+1]       = last[t];
+      /* guard the output order against rounding, a cluster never
+         sorts below its parts */
+      height[step] = dst;
+      if ((last[s])&&(height[last[s]] > height[step])) height[step] = height[last[s]];
+      if ((last[t])&&(height[last[t]] > height[step])) height[step] = height[last[t]];
+      last[s] = step;
    }
 
-   free(help);
+   /* report the merges in the order a global minimum search would find them */
+   order_merges(tree, merges, height, child, n);
+
+   free(merges);
+   free(height);
+   free(child);
+   free(last);
+   free(chain);
    free(indic);
-   for(i=0;i<=n;i++) free(d[i]);
-   free(d);
    free(size);
+   free(d);
  
    return tree;
 }        
 
 /*--------------------------------------------------------------------*/
 
+PRIVATE void order_merges(Union *tree, Union *merges, float *height, int *child, int n)
+{
+   int  *heap, *pending, *parent;
+   int   k,m,h,step;
+
+   heap    = (int *) vrna_alloc((n+1)*sizeof(int));
+   pending = (int *) vrna_alloc((n+1)*sizeof(int));
+   parent  = (int *) vrna_alloc((n+1)*sizeof(int));
+
+   for (m=1; m<n; m++){
+      for (k=0; k<2; k++){
+         if (child[2*m+k]) {
+            parent[child[2*m+k]] = m;
+            pending[m]++;
+         }
+      }
+   }
+
+   tree[0].set1      = n;
+   tree[0].set2      = 0;
+   tree[0].distance  = 0.0;   
+   tree[0].distance2 = 0.0;    
+
+   /* a merge becomes available once both of its parts are reported */
+   h = 0;
+   for (m=1; m<n; m++)
+      if (pending[m]==0) heap_push(heap, &h, m, merges, height);
+
+   for (step=1; step<n; step++){
+      m          = heap_pop(heap, &h, merges, height);
+      tree[step] = merges[m];
+      if ((parent[m])&&(--pending[parent[m]]==0))
+         heap_push(heap, &h, parent[m], merges, height);
+   }
+
+   free(parent);
+   free(pending);
+   free(heap);
+}
+
+/*--------------------------------------------------------------------*/
+
+PRIVATE int merge_before(Union *merges, float *height, int x, int y)
+{
+   if (height[x] != height[y])           return (height[x] < height[y]);
+   if (merges[x].set1 != merges[y].set1) return (merges[x].set1 < merges[y].set1);
+   return (merges[x].set2 < merges[y].set2);
+}
+
+/*--------------------------------------------------------------------*/
+
+PRIVATE void heap_push(int *heap, int *h, int m, Union *merges, float *height)
+{
+   int i,k;
+
+   for (i=(*h)++; i>0; i=k){
+      k = (i-1)/2;
+      if (!merge_before(merges, height, m, heap[k])) break;
+      heap[i] = heap[k];
+   }
+   heap[i] = m;
+}
+
+/*--------------------------------------------------------------------*/
+
+PRIVATE int heap_pop(int *heap, int *h, Union *merges, float *height)
+{
+   int i,k,m,top;
+
+   top = heap[0];
+   m   = heap[--(*h)];
+   for (i=0; 2*i+1<*h; i=k){
+      k = 2*i+1;
+      if ((k+1<*h)&&(merge_before(merges, height, heap[k+1], heap[k]))) k++;
+      if (!merge_before(merges, height, heap[k], m)) break;
+      heap[i] = heap[k];
+   }
+   heap[i] = m;
+
+   return top;
+}
+
+/*--------------------------------------------------------------------*/
+
 PUBLIC Union *neighbour_joining(float **clmat)
+{
+   Condensed_Matrix *cm;
+   Union            *tree;
+
+   cm   = condense_distance_matrix(clmat);
+   tree = neighbour_joining_condensed(cm);
+   free_condensed_matrix(cm);
+
+   return tree;
+}
+
+/*--------------------------------------------------------------------*/
+
+PUBLIC Union *neighbour_joining_condensed(const Condensed_Matrix *cm)
 {            
-  int n,i,j,k,l,step,ll[3];
-  float b1,b2,b3,nn,tot,tmin,d1,d2;
+  int n,i,j,k,l,a,m,e,len,step,next_id,ll[3];
+  float b1,b2,b3,nn,d1,d2,dkl,dnew,dold;
+  double tot,tmin,bound,rmax;
   int mini=0, minj=0;
-  int    *indic;
-  float  *av, *temp;
-  float **d;
+  int    *id_of, *label_of, *row_len;
+  float  *av, *d;
+  double *r;
+  size_t  num, stored;
+  Row_Entry **row;
   Union   *tree;
 
-  n = (int) (clmat[0][0]);
+  n   = cm->n;
+  num = (size_t)n*(n-1)/2;
 
-  tree = (Union *) vrna_alloc((n+1)*sizeof(Union));
-  indic = (int   *) vrna_alloc((n+1)*sizeof(int)   );
-  av   = (float *) vrna_alloc((n+1)*sizeof(float) );
-  temp = (float *) vrna_alloc((n+1)*sizeof(float) );
-  d    = (float**) vrna_alloc((n+1)*sizeof(float*));
-  for(i=0;i<=n;i++) d[i] = (float*) vrna_alloc((n+1)*sizeof(float));
+  tree     = (Union *)     vrna_alloc((n+1)*sizeof(Union));
+  av       = (float *)     vrna_alloc((n+1)*sizeof(float));
+  r        = (double *)    vrna_alloc((n+1)*sizeof(double));
+  d        = (float *)     vrna_alloc((num+1)*sizeof(float));
+  id_of    = (int *)       vrna_alloc((n+1)*sizeof(int));
+  label_of = (int *)       vrna_alloc(2*(n+1)*sizeof(int));
+  row_len  = (int *)       vrna_alloc(2*(n+1)*sizeof(int));
+  row      = (Row_Entry **)vrna_alloc(2*(n+1)*sizeof(Row_Entry *));
 
-
-  for (i=1; i<=n; i++){
-     for(j=1; j<=n; j++){
-        d[i][j] = clmat[i][j];
-     }
-     d[i][i]=0.0;
-  }
+  memcpy(d, cm->d, num*sizeof(float));
 
   tree[0].set1      = n;
   tree[0].set2      = 0;
   tree[0].distance  = 0.0; 
   tree[0].distance2 = 0.0;
-  
-  nn = (float) n;
+
+  if (n<3) {
+     tree[1].set1      = 1;
+     tree[1].distance  = 0.0;
+     tree[1].set2      = 2;
+     tree[1].distance2 = (n==2) ? d[0] : 0.0;
+     free(row); free(row_len); free(label_of); free(id_of);
+     free(d); free(r); free(av);
+     return tree;
+  }
+
+  /* row sums, and for every taxon its distances to all taxa with a
+     smaller index, sorted in ascending order. A cluster that changes
+     gets a new id, entries pointing to an outdated id are skipped. */
+  for (i=0; i<n; i++){
+     id_of[i]    = i;
+     label_of[i] = i;
+     row[i]      = (Row_Entry *) vrna_alloc((i+1)*sizeof(Row_Entry));
+     row_len[i]  = i;
+     for (j=0; j<i; j++){
+        row[i][j].d  = d[CM_IDX(i,j)];
+        row[i][j].id = j;
+        r[i] += row[i][j].d;
+        r[j] += row[i][j].d;
+     }
+     qsort(row[i], i, sizeof(Row_Entry), compare_row_entries);
+  }
+  stored  = num;
+  next_id = n;
+  m       = n;
+  nn      = (float) n;
 
   for(step=1;step<=n-3;step++) {
-/*    for(j=2;j<=n;j++) for(i=1;i<j;i++) d[j][i]=d[i][j]; */
-     tmin=99999.9;
-     for(l=2; l<=n; l++){
-        if(!indic[l]) {
-           for(k=1;k<l;k++){                          
-              if(!indic[k]) {                                       
-                 d1=0.0; d2=0.0;
-                 for(i=1; i<=n;i++) {
-                    d1 += d[i][k];
-                    d2 += d[i][l];
-                 }
-                 tot=(nn-2.0)*d[k][l]-d1-d2;
-                 if(tot<tmin){
-                    tmin=tot;
-                    mini=k;
-                    minj=l;
-                 }
-              }
+     rmax = -DBL_MAX;
+     for (k=0; k<n; k++)
+        if ((id_of[k]>=0)&&(r[k]>rmax)) rmax = r[k];
+
+     /* minimize (nn-2)*d(k,l)-r(k)-r(l), every row is only scanned up to
+        the point where even the largest row sum can not yield a new
+        minimum. Ties are resolved in favour of the smallest pair (l,k) */
+     tmin = DBL_MAX;
+     for (k=0; k<n; k++){
+        if ((a=id_of[k])<0) continue;
+        for (e=0; e<row_len[a]; e++){
+           bound = (nn-2.0)*row[a][e].d - r[k] - rmax;
+           if (bound > tmin) break;
+           l = label_of[row[a][e].id];
+           if (id_of[l] != row[a][e].id) continue;
+           tot = (nn-2.0)*row[a][e].d - r[k] - r[l];
+           i = MIN2(k,l);
+           j = MAX2(k,l);
+           if ((tot<tmin)||((tot==tmin)&&((j<minj)||((j==minj)&&(i<mini))))){
+              tmin = tot;
+              mini = i;
+              minj = j;
            }
         }
      }
 
-     d1=0.0; d2=0.0;                                                                
-     for(i=1;i<=n;i++) {
-        d1 +=d[i][mini];
-        d2 +=d[i][minj];
-     }
-     d1 = (d1-d[mini][minj])/(nn-2.0);
-     d2 = (d2-d[mini][minj])/(nn-2.0);
+     dkl = d[CM_IDX(mini,minj)];
+     d1  = (r[mini]-dkl)/(nn-2.0);
+     d2  = (r[minj]-dkl)/(nn-2.0);
 
-     tree[step].set1      = mini;
-     tree[step].distance  = (d[mini][minj]+d1-d2)*0.5-av[mini];
-     tree[step].set2      = minj; 
-     tree[step].distance2 = d[mini][minj]-(d[mini][minj]+d1-d2)*0.5-av[minj];
+     tree[step].set1      = mini+1;
+     tree[step].distance  = (dkl+d1-d2)*0.5-av[mini];
+     tree[step].set2      = minj+1; 
+     tree[step].distance2 = dkl-(dkl+d1-d2)*0.5-av[minj];
 
-     av[mini]=d[mini][minj]*0.5;
+     av[mini]=dkl*0.5;
 
      nn=nn-1.0;
-     indic[minj]=1;
-     for(j=1;j<=n;j++) { 
-        if(!indic[j]) 
-           temp[j]=(d[mini][j]+d[minj][j])*0.5;
+     m--;
+
+     /* retire minj and the old id of mini */
+     for (k=0; k<2; k++){
+        a = id_of[(k) ? minj : mini];
+        stored -= row_len[a];
+        free(row[a]);
+        row[a] = NULL;
      }
-     for(j=1;j<=n;j++) {
-        if(!indic[j]) {
-           d[mini][j] = temp[j];
-           d[j][mini] = temp[j];
+     id_of[minj] = -1;
+
+     r[mini] = 0.0;
+     a       = next_id++;
+     row[a]  = (Row_Entry *) vrna_alloc((m+1)*sizeof(Row_Entry));
+     len     = 0;
+     for(j=0;j<n;j++) { 
+        if ((j==mini)||(id_of[j]<0)) continue;
+        dold = d[CM_IDX(mini,j)];
+        dnew = (dold+d[CM_IDX(minj,j)])*0.5;
+        r[j]   += (double)dnew - dold - d[CM_IDX(minj,j)];
+        r[mini] += dnew;
+        d[CM_IDX(mini,j)] = dnew;
+        row[a][len].d    = dnew;
+        row[a][len++].id = id_of[j];
+     }
+     qsort(row[a], len, sizeof(Row_Entry), compare_row_entries);
+     row_len[a]     = len;
+     label_of[a]    = mini;
+     id_of[mini]    = a;
+     stored        += len;
+
+     /* drop outdated entries once they dominate the rows */
+     if (stored > (size_t)m*(m-1) + n) {
+        stored = 0;
+        for (k=0; k<n; k++){
+           if ((a=id_of[k])<0) continue;
+           for (len=0, e=0; e<row_len[a]; e++){
+              if (id_of[label_of[row[a][e].id]] == row[a][e].id)
+                 row[a][len++] = row[a][e];
+           }
+           row_len[a] = len;
+           stored    += len;
         }
-     }                               
-     for(j=1;j<=n;j++){
-         d[minj][j] = 0.0;
-         d[j][minj] = 0.0;
-         d[j][j]    = 0.0;
      }
   }  
                                             
   j=0;   
-  for(i=1;i<=n;i++) {
-     if(!indic[i]){
+  for(i=0;i<n;i++) {
+     if(id_of[i]>=0){
         ll[j]=i;
         j++;
      }
   }          
-  b1=(d[ll[0]][ll[1]]+d[ll[0]][ll[2]]-d[ll[1]][ll[2]])*0.5;
-  b2=d[ll[0]][ll[1]]-b1;
-  b3=d[ll[0]][ll[2]]-b1;
+  b1=(d[CM_IDX(ll[0],ll[1])]+d[CM_IDX(ll[0],ll[2])]-d[CM_IDX(ll[1],ll[2])])*0.5;
+  b2=d[CM_IDX(ll[0],ll[1])]-b1;
+  b3=d[CM_IDX(ll[0],ll[2])]-b1;
   b1 -= av[ll[0]];
   b2 -= av[ll[1]];
   b3 -= av[ll[2]];
-  tree[step].set1      = ll[1];
+  tree[step].set1      = ll[1]+1;
   tree[step].distance  = b2;
-  tree[step].set2      = ll[2];
+  tree[step].set2      = ll[2]+1;
   tree[step].distance2 = b3;
   step++;
-  tree[step].set1      = ll[0];
+  tree[step].set1      = ll[0]+1;
   tree[step].distance  = 0.0;
-  tree[step].set2      = ll[1];
+  tree[step].set2      = ll[1]+1;
   tree[step].distance2 = b1;
 
-  for(i=0;i<=n;i++) free(d[i]); free(d); 
-  free(temp);
+  for (i=0; i<next_id; i++) free(row[i]);
+  free(row);
+  free(row_len);
+  free(label_of);
+  free(id_of);
+  free(d);
+  free(r);
   free(av);
-  free(indic);
 
   return tree;
 }
 
 /*--------------------------------------------------------------------*/
 
+PRIVATE int compare_row_entries(const void *p1, const void *p2)
+{
+   const Row_Entry *e1 = (const Row_Entry *) p1;
+   const Row_Entry *e2 = (const Row_Entry *) p2;
+
+   if (e1->d != e2->d) return (e1->d < e2->d) ? -1 : 1;
+   return e1->id - e2->id;
+}
+
+/*--------------------------------------------------------------------*/
+
 
 PUBLIC void   printf_phylogeny(Union *tree, char *type)
 {
@@ -1,3 +1,5 @@
+#include "distance_matrix.h"
+
 typedef struct{
         int   set1;
         int   set2;
@@ -7,6 +9,8 @@ typedef struct{
 
 extern Union *wards_cluster(float **clmat);
 extern Union *neighbour_joining(float **clmat);
+extern Union *wards_cluster_condensed(const Condensed_Matrix *cm);
+extern Union *neighbour_joining_condensed(const Condensed_Matrix *cm);
 extern void   printf_phylogeny(Union *tree, char *type);
 
 
@@ -10,6 +10,14 @@
 #include "ViennaRNA/utils/basic.h"
 #include "ViennaRNA/io/utils.h"
 #include "StrEdit_CostMatrix.h"
+#include "distance_matrix.h"
+
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_MMAP)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#endif
 
 #define  PUBLIC
 #define  PRIVATE         static
@@ -28,6 +36,13 @@ PUBLIC   float   StrEdit_SimpleDist(char *str1, char *str2);
 PUBLIC   float   StrEdit_GotohDist(char *str1, char *str2);
 PUBLIC   void    Set_StrEdit_CostMatrix(char type);
 PUBLIC   void    Set_StrEdit_GapCosts(float per_digit, float per_gap);
+PUBLIC   Condensed_Matrix *read_condensed_distance_matrix(char type[]);
+PUBLIC   Binary_Matrices  *open_binary_distance_matrices(const char *filename, int n);
+PUBLIC   Condensed_Matrix *read_binary_distance_matrix(Binary_Matrices *bm, int which);
+PUBLIC   void              close_binary_distance_matrices(Binary_Matrices *bm);
+PUBLIC   Condensed_Matrix *condense_distance_matrix(float **x);
+PUBLIC   float           **expand_distance_matrix(const Condensed_Matrix *cm);
+PUBLIC   void              free_condensed_matrix(Condensed_Matrix *cm);
 
 /* NOTE:   x[0][0] = (float)size_of_matrix;    */
 
@@ -50,16 +65,30 @@ PRIVATE  float   StrEdit_GotohBeta  = 1.;
 
 
 PUBLIC float **read_distance_matrix(char type[])
+{
+   Condensed_Matrix *cm;
+   float           **D;
+
+   if ((cm = read_condensed_distance_matrix(type))==NULL) return NULL;
+   D = expand_distance_matrix(cm);
+   free_condensed_matrix(cm);
+
+   return D;
+}
+
+/* ------------------------------------------------------------------------- */
+
+PUBLIC Condensed_Matrix *read_condensed_distance_matrix(char type[])
 {
    char   *line;
-   float **D;
+   Condensed_Matrix *cm;
    float   tmp;
-   int     i,j,size;
+   int     size;
+   size_t  k, num;
    
    while(1) {
      type[0]= '\0';
      size   =    0;
-     D      = NULL;
      if ((line = vrna_read_line(stdin))==NULL) return NULL;
      if (*line =='@') return NULL;
      if (*line =='*') {
@@ -82,24 +111,19 @@ PUBLIC float **read_distance_matrix(char type[])
        fprintf(stderr, "%d ", r);
        if (r==EOF) return NULL;
        if((r==2)&&(size>1)) {
-	 D=(float **)vrna_alloc((size+1)*sizeof(float *));
-	 for(i=0; i<=size; i++)
-	   D[i] = (float *)vrna_alloc((size+1)*sizeof(float));
-	 D[0][0] = (float)size;
-	 D[1][1] = 0.0;
-	 for(i=2; i<= size; i++) {
-	   D[i][i] = 0.0;
-	   for(j=1; j<i; j++) {
-	     if (scanf("%f", &tmp)!=1) {
-	       for(i=0;i<=size;i++) free(D[i]);
-	       free(D);
-	       return NULL;
-	     }
-	     D[i][j] = tmp;
-	     D[j][i] = tmp;
+	 free(line);
+	 num   = (size_t)size*(size-1)/2;
+	 cm    = (Condensed_Matrix *) vrna_alloc(sizeof(Condensed_Matrix));
+	 cm->n = size;
+	 cm->d = (float *) vrna_alloc(num*sizeof(float));
+	 for(k=0; k<num; k++) {
+	   if (scanf("%f", &tmp)!=1) {
+	     free_condensed_matrix(cm);
+	     return NULL;
 	   }
+	   cm->d[k] = tmp;
 	 }
-	 return D;
+	 return cm;
        }
        else printf("%s\n",line);
      }
@@ -110,6 +134,123 @@ PUBLIC float **read_distance_matrix(char type[])
 
 /* ------------------------------------------------------------------------- */
 
+struct Binary_Matrices {
+   char       *filename;
+   int         n;         /* number of taxa */
+   size_t      num;       /* number of distances per matrix */
+   size_t      count;     /* number of matrices in the file */
+   size_t      file_size;
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_MMAP)
+   void       *map;
+#else
+   FILE       *fp;
+#endif
+};
+
+PUBLIC Binary_Matrices *open_binary_distance_matrices(const char *filename, int n)
+{
+   Binary_Matrices *bm;
+   size_t  num, file_size;
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_MMAP)
+   int          fd;
+   struct stat  st;
+
+   if (((fd = open(filename, O_RDONLY)) < 0) || (fstat(fd, &st) != 0))
+     vrna_message_error("can't read binary distance matrix %s", filename);
+   file_size = (size_t) st.st_size;
+#else
+   FILE   *fp;
+
+   if (((fp = fopen(filename, "rb")) == NULL) || (fseek(fp, 0L, SEEK_END) != 0))
+     vrna_message_error("can't read binary distance matrix %s", filename);
+   file_size = (size_t) ftell(fp);
+#endif
+
+   if (file_size == 0)
+     vrna_message_error("binary distance matrix %s is empty", filename);
+
+   /* without a number of taxa, the file holds exactly one matrix */
+   if (n <= 0) {
+     num = file_size/sizeof(int);
+     for (n=2; (size_t)n*(n-1)/2 < num; n++);
+   }
+   num = (size_t)n*(n-1)/2;
+   if ((n < 2) || (file_size % (num*sizeof(int)) != 0))
+     vrna_message_error("size of %s does not match distance matrices of %d taxa", filename, n);
+
+   bm            = (Binary_Matrices *) vrna_alloc(sizeof(Binary_Matrices));
+   bm->filename  = strdup(filename);
+   bm->n         = n;
+   bm->num       = num;
+   bm->count     = file_size/(num*sizeof(int));
+   bm->file_size = file_size;
+
+   /* the file is mapped (or kept open) once for all of its matrices */
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_MMAP)
+   bm->map = mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+   if (bm->map == MAP_FAILED)
+     vrna_message_error("can't map binary distance matrix %s", filename);
+   close(fd);
+#else
+   bm->fp = fp;
+#endif
+
+   return bm;
+}
+
+/* ------------------------------------------------------------------------- */
+
+PUBLIC Condensed_Matrix *read_binary_distance_matrix(Binary_Matrices *bm, int which)
+{
+   Condensed_Matrix *cm;
+   size_t  k, num, offset;
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_MMAP)
+   const int   *src;
+#else
+   int     buf[4096];
+   size_t  i, chunk;
+#endif
+
+   if ((which < 0) || ((size_t)which >= bm->count)) return NULL;
+
+   num    = bm->num;
+   offset = (size_t)which*num;
+   cm     = (Condensed_Matrix *) vrna_alloc(sizeof(Condensed_Matrix));
+   cm->n  = bm->n;
+   cm->d  = (float *) vrna_alloc(num*sizeof(float));
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_MMAP)
+   src = (const int *) bm->map + offset;
+   for (k=0; k<num; k++) cm->d[k] = (float) src[k];
+#else
+   if (fseek(bm->fp, (long)(offset*sizeof(int)), SEEK_SET) != 0)
+     vrna_message_error("can't read binary distance matrix %s", bm->filename);
+   for (k=0; k<num; k+=chunk) {
+     chunk = MIN2(num-k, sizeof(buf)/sizeof(int));
+     if (fread(buf, sizeof(int), chunk, bm->fp) != chunk)
+       vrna_message_error("can't read binary distance matrix %s", bm->filename);
+     for (i=0; i<chunk; i++) cm->d[k+i] = (float) buf[i];
+   }
+#endif
+
+   return cm;
+}
+
+/* ------------------------------------------------------------------------- */
+
+PUBLIC void close_binary_distance_matrices(Binary_Matrices *bm)
+{
+   if (bm == NULL) return;
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_MMAP)
+   munmap(bm->map, bm->file_size);
+#else
+   fclose(bm->fp);
+#endif
+   free(bm->filename);
+   free(bm);
+}
+
+/* ------------------------------------------------------------------------- */
+
 PUBLIC char **read_sequence_list(int *n_of_seqs, char *mask)
 {
    int     i;
@@ -202,6 +343,58 @@ PUBLIC void free_distance_matrix(float **x)
 
 /* -------------------------------------------------------------------------- */
 
+PUBLIC Condensed_Matrix *condense_distance_matrix(float **x)
+{
+   Condensed_Matrix *cm;
+   float            *row;
+   int               i,j,n;
+
+   n     = (int) x[0][0];
+   cm    = (Condensed_Matrix *) vrna_alloc(sizeof(Condensed_Matrix));
+   cm->n = n;
+   cm->d = (float *) vrna_alloc(((size_t)n*(n-1)/2+1)*sizeof(float));
+   for(i=1;i<n;i++){
+      row = cm->d + (size_t)i*(i-1)/2;
+      for(j=0;j<i;j++) row[j] = x[i+1][j+1];
+   }
+   return cm;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC float **expand_distance_matrix(const Condensed_Matrix *cm)
+{
+   float **D;
+   float  *row;
+   int     i,j,n;
+
+   n = cm->n;
+   D = (float **) vrna_alloc((n+1)*sizeof(float *));
+   for(i=0;i<=n;i++)
+      D[i] = (float *) vrna_alloc((n+1)*sizeof(float));
+   D[0][0] = (float) n;
+   for(i=1;i<n;i++){
+      row = cm->d + (size_t)i*(i-1)/2;
+      for(j=0;j<i;j++){
+         D[i+1][j+1] = row[j];
+         D[j+1][i+1] = row[j];
+      }
+   }
+   return D;
+}
+
+/* -------------------------------------------------------------------------- */
+
+PUBLIC void free_condensed_matrix(Condensed_Matrix *cm)
+{
+   if(cm){
+      free(cm->d);
+      free(cm);
+   }
+}
+
+/* -------------------------------------------------------------------------- */
+
 PUBLIC void printf_distance_matrix(float **x)
 {
    int i,j,n;
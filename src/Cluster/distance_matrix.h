@@ -1,3 +1,19 @@
+#ifndef CLUSTER_DISTANCE_MATRIX_H
+#define CLUSTER_DISTANCE_MATRIX_H
+
+/* Condensed distance matrix of n taxa in a single allocation: the strict
+   lower triangle is stored row by row, i.e. the distance between taxa i
+   and j (0 <= j < i < n) is d[i*(i-1)/2 + j]. This is the layout written
+   by RNAdistance --binary-matrix. */
+typedef struct {
+        int    n;
+        float *d;
+        } Condensed_Matrix;
+
+/* Distance matrices of a file written by RNAdistance --binary-matrix,
+   which is opened (and memory mapped) once for all of its matrices. */
+typedef struct Binary_Matrices Binary_Matrices;
+
 extern   float **read_distance_matrix(char type[]);
 extern   char  **read_sequence_list(int *n_of_seqs,char *mask);
 extern   float **Hamming_Distance_Matrix(char **seqs, int n_of_seqs);
@@ -12,3 +28,12 @@ extern   float   StrEdit_GotohDist(char *str1, char *str2);
 extern   void    Set_StrEdit_CostMatrix(char type);
 extern   void    Set_StrEdit_GapCosts(float per_digit, float per_gap);
 
+extern   Condensed_Matrix *read_condensed_distance_matrix(char type[]);
+extern   Binary_Matrices  *open_binary_distance_matrices(const char *filename, int n);
+extern   Condensed_Matrix *read_binary_distance_matrix(Binary_Matrices *bm, int which);
+extern   void              close_binary_distance_matrices(Binary_Matrices *bm);
+extern   Condensed_Matrix *condense_distance_matrix(float **x);
+extern   float           **expand_distance_matrix(const Condensed_Matrix *cm);
+extern   void              free_condensed_matrix(Condensed_Matrix *cm);
+
+#endif
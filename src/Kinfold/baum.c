@@ -46,12 +46,14 @@ typedef struct _baum {
 } baum;
 
 static char UNUSED rcsid[]="$Id: baum.c,v 1.9 2008/05/21 10:15:45 ivo Exp $";
-static short *pairList = NULL;
-static short *typeList = NULL;
-static short *aliasList = NULL;
-static baum *rl = NULL;         /* ringlist */
-static baum *wurzl = NULL;      /* virtualroot of ringlist-tree */
-static char **ptype = NULL;
+static THREADLOCAL short *pairList = NULL;
+static THREADLOCAL short *typeList = NULL;
+static THREADLOCAL short *aliasList = NULL;
+static THREADLOCAL baum *rl = NULL;         /* ringlist */
+static THREADLOCAL baum *wurzl = NULL;      /* virtualroot of ringlist-tree */
+static THREADLOCAL char **ptype = NULL;
+/* stop structure(s) and their energies are shared by all threads */
+static int shared_ini_done = 0;
 
 static int comp_struc(const void *A, const void *B);
 /* PUBLIC FUNCTIONES */
@@ -220,7 +222,10 @@ void ini_or_reset_rl(void) {
 #endif
 
     /* stop structure(s) */
-    if ( GTV.stop )  {
+    if (shared_ini_done) {
+      /* already set up by a previous call */
+    }
+    else if ( GTV.stop )  {
       int i;
 
       qsort(GAV.stopform, GSV.maxS, sizeof(char *), comp_struc);
@@ -268,6 +273,8 @@ void ini_or_reset_rl(void) {
       GAV.sE[0] = energy_of_structure(GAV.farbe_full, GAV.stopform[0], 0);
 #endif
     }
+    if (!shared_ini_done) ini_stop_set();
+    shared_ini_done = 1;
     GSV.stopE = GAV.sE[0];
     ini_nbList(strlen(GAV.farbe_full)*strlen(GAV.farbe_full));
   }
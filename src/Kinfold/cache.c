@@ -19,6 +19,11 @@
 #endif
 
 #include "cache_util.h"
+#include "globals.h"
+
+#if WITH_KINFOLD_THREADS
+#include <pthread.h>
+#endif
 
 #ifdef __GNUC__
 # define INLINE inline
@@ -27,8 +32,8 @@
 #endif
 
 /*
-  modify cache_f(), cache_comp() and the typedef of cache_entry
-  in cache_utils.h to suit your application
+  modify key_of_structure(), same_structure() and the typedef of
+  cache_entry in cache_utils.h to suit your application
 */
 
 /* PUBLIC FUNCTIONES */
@@ -37,108 +42,353 @@ int write_cache (cache_entry *x);
 /*  void delete_cache (cache_entry *x); */
 void kill_cache();
 void initialize_cache();
+void cache_share(int share);
+void cache_lock(void);
+void cache_unlock(void);
+void log_cache_stats(FILE *FP);
+void key_of_structure(const char *s, structure_key *k);
+uint64_t hash_structure(const char *s);
+int same_structure(const structure_key *a, const structure_key *b);
+void free_structure_key(structure_key *k);
+
+/*
+  entries are kept in a hash table with chaining, and in a list
+  ordered by the time of their last use. If the memory occupied by
+  all entries exceeds the budget, the least recently used ones are
+  evicted
+*/
+typedef struct _cache_slot {
+  cache_entry *entry;
+  size_t size;                 /* memory occupied by entry */
+  struct _cache_slot *chain;   /* next slot in same bucket */
+  struct _cache_slot *newer;   /* neighbors in LRU list */
+  struct _cache_slot *older;
+} cache_slot;
+
+typedef struct {
+  cache_slot **buckets;
+  unsigned long mask;          /* number of buckets - 1 */
+  unsigned long count;         /* number of entries */
+  size_t mem;                  /* memory occupied by entries */
+  size_t budget;               /* maximum memory for entries */
+  cache_slot lru;              /* lru.older is the most recently used */
+  unsigned long lookups;
+  unsigned long hits;
+  unsigned long evictions;
+} cache_table;
 
 /* PRIVATE FUNCTIONES */
 /*  static int cache_comp(cache_entry *x, cache_entry *y); */
-INLINE static unsigned cache_f (char *x);
-
-/* #define CACHESIZE 67108864 -1 */ /* 2^26 -1   must be power of 2 -1 */
-/* #define CACHESIZE 33554432 -1 */ /* 2^25 -1   must be power of 2 -1 */
-/* #define CACHESIZE 16777216 -1 */ /* 2^24 -1   must be power of 2 -1 */ 
-/* #define CACHESIZE  4194304 -1 */ /* 2^22 -1   must be power of 2 -1 */
-#define CACHESIZE  1048576 -1  /* 2^20 -1   must be power of 2 -1 */
-/* #define CACHESIZE   262144 -1 */ /* 2^18 -1   must be power of 2 -1 */
-/* next is default */
-/* #define CACHESIZE    65536 -1 */ /* 2^16 -1   must be power of 2 -1 */
-/* #define CACHESIZE    16384 -1 */ /* 2^14 -1   must be power of 2 -1 */
-/* #define CACHESIZE     4096 -1 */ /* 2^12 -1   must be power of 2 -1 */
-
-static cache_entry *cachetab[CACHESIZE+1];
+INLINE static unsigned long cache_f (cache_table *tab, const structure_key *x);
+static cache_table *get_cachetab(void);
+static uint64_t pack(const char *s, int n, uint64_t *bits);
+static cache_table *new_cachetab(size_t budget);
+static void free_cachetab(cache_table *tab);
+static void free_entry(cache_entry *c);
+static void remove_slot(cache_table *tab, cache_slot *x);
+static void grow_cachetab(cache_table *tab);
+
+#define INIBUCKETS 1024 /* must be power of 2 */
+#define KEYBITS 64      /* bits per word of a packed structure */
+#define KEYWORDS(n) ((2*(n) + KEYBITS - 1)/KEYBITS)
+
+/* each thread has its own cache, unless the cache is shared */
+static THREADLOCAL cache_table *cachetab = NULL;
+static THREADLOCAL structure_key lookup_key = {0, 0, 0, NULL};
+static cache_table *shared_cachetab = NULL;
+static int cache_is_shared = 0;
+#if WITH_KINFOLD_THREADS
+static pthread_mutex_t cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
 static char UNUSED rcsid[] ="$Id: cache.c,v 1.3 2006/10/04 12:45:12 xtof Exp $";
 unsigned long collisions=0;
 
-/* stolen from perl source */
-char coeff[] = {
-                61,59,53,47,43,41,37,31,29,23,17,13,11,7,3,1,
-                61,59,53,47,43,41,37,31,29,23,17,13,11,7,3,1,
-                61,59,53,47,43,41,37,31,29,23,17,13,11,7,3,1,
-                61,59,53,47,43,41,37,31,29,23,17,13,11,7,3,1,
-                61,59,53,47,43,41,37,31,29,23,17,13,11,7,3,1,
-                61,59,53,47,43,41,37,31,29,23,17,13,11,7,3,1,
-                61,59,53,47,43,41,37,31,29,23,17,13,11,7,3,1,
-                61,59,53,47,43,41,37,31,29,23,17,13,11,7,3,1};
-
-/* key must not be longer than 128 */
-INLINE static unsigned cache_f(char *x) { 
-  register char *s;
-  register int i;
-  register unsigned cache;
-
-  s = x;
-
-  for (i=0,    cache = 0;
-       /* while */ *s;
-       s++,           i++ , cache *= 5 ) {
-    cache += *s * coeff[i];
+/* counters of all caches killed so far */
+static unsigned long total_lookups = 0;
+static unsigned long total_hits = 0;
+static unsigned long total_evictions = 0;
+
+/* 2 bits per position, and a 64 bit hash of the packed words */
+void key_of_structure(const char *s, structure_key *k) {
+  int n;
+
+  n = strlen(s);
+  if (KEYWORDS(n) > k->size) {
+    k->size = KEYWORDS(n);
+    k->bits = (uint64_t *)realloc(k->bits, k->size*sizeof(uint64_t));
+    if (k->bits == NULL) {
+      fprintf(stderr, "out of memory\n"); exit(255);
+    }
+  }
+  k->len = n;
+  k->hash = pack(s, n, k->bits);
+}
+
+/* same hash as key_of_structure(), but without storing the packed structure */
+uint64_t hash_structure(const char *s) {
+  return pack(s, strlen(s), NULL);
+}
+
+/**/
+static uint64_t pack(const char *s, int n, uint64_t *bits) {
+  int i;
+  uint64_t w, c, h;
+
+  h = (uint64_t)n;
+  for (i = 0, w = 0; i < n; i++) {
+    switch (s[i]) {
+    case '.': c = 0; break;
+    case '(': c = 1; break;
+    case ')': c = 2; break;
+    default:  c = 3; break;
+    }
+    w |= c << ((2*i) % KEYBITS);
+    if (((2*i + 2) % KEYBITS == 0) || (i == n - 1)) {
+      if (bits) bits[(2*i)/KEYBITS] = w;
+      /* splitmix64 finalizer */
+      h ^= w;
+      h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+      h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+      h ^= h >> 31;
+      w = 0;
+    }
   }
+  return h;
+}
+
+/**/
+int same_structure(const structure_key *a, const structure_key *b) {
+  if ((a->hash != b->hash) || (a->len != b->len)) return 0;
+  return memcmp(a->bits, b->bits, KEYWORDS(a->len)*sizeof(uint64_t)) == 0;
+}
+
+/**/
+void free_structure_key(structure_key *k) {
+  free(k->bits);
+  k->bits = NULL;
+  k->len = k->size = 0;
+}
+
+/**/
+INLINE static unsigned long cache_f(cache_table *tab, const structure_key *x) {
+  return (unsigned long)x->hash & tab->mask;
+}
+
+/**/
+static cache_table *new_cachetab(size_t budget) {
+  cache_table *tab;
 
-   /* divide through CACHESIZE for normalization */
-  return ((cache) & (CACHESIZE));
+  tab = (cache_table *)calloc(1, sizeof(cache_table));
+  if (tab != NULL)
+    tab->buckets = (cache_slot **)calloc(INIBUCKETS, sizeof(cache_slot *));
+  if ((tab == NULL) || (tab->buckets == NULL)) {
+    fprintf(stderr, "out of memory\n"); exit(255);
+  }
+  tab->mask = INIBUCKETS - 1;
+  tab->budget = budget;
+  tab->lru.newer = tab->lru.older = &(tab->lru);
+  return tab;
 }
 
+/**/
+static cache_table *get_cachetab(void) {
+  int concurrent;
+
+  if (cache_is_shared) return shared_cachetab;
+
+  if (cachetab == NULL) {
+    /* caches of concurrent threads share the memory budget */
+    concurrent = (GSV.threads < GSV.num) ? GSV.threads : GSV.num;
+    if (concurrent < 1) concurrent = 1;
+    cachetab = new_cachetab(((size_t)GSV.cacheMem << 20) / concurrent);
+  }
+  return cachetab;
+}
+
+/*
+  use one cache for all threads; must be called before any
+  thread accesses the cache. Access then has to be guarded
+  by cache_lock() and cache_unlock(). cache_share(0) frees
+  the shared cache once all threads are done
+*/
+void cache_share(int share) {
+  if (shared_cachetab != NULL) free_cachetab(shared_cachetab);
+  shared_cachetab = NULL;
+  cache_is_shared = 0;
+  if (share) {
+    shared_cachetab = new_cachetab((size_t)GSV.cacheMem << 20);
+    cache_is_shared = 1;
+  }
+}
+
+/**/
+void cache_lock(void) {
+#if WITH_KINFOLD_THREADS
+  if (cache_is_shared) pthread_mutex_lock(&cache_mutex);
+#endif
+}
+
+/**/
+void cache_unlock(void) {
+#if WITH_KINFOLD_THREADS
+  if (cache_is_shared) pthread_mutex_unlock(&cache_mutex);
+#endif
+}
 
 /* returns NULL unless x is in the cache */
 cache_entry *lookup_cache (char *x) {
-  int cacheval;
-  cache_entry *c;
+  cache_slot *c;
+  cache_table *tab = get_cachetab();
+
+  key_of_structure(x, &lookup_key);
+  tab->lookups++;
+  for (c = tab->buckets[cache_f(tab, &lookup_key)]; c; c = c->chain)
+    if (same_structure(&(c->entry->key), &lookup_key)) {
+      /* move to the front of the LRU list */
+      c->newer->older = c->older;
+      c->older->newer = c->newer;
+      c->older = tab->lru.older;
+      c->newer = &(tab->lru);
+      tab->lru.older->newer = c;
+      tab->lru.older = c;
+      tab->hits++;
+      return c->entry;
+    }
 
-  cacheval=cache_f(x);
-  if ((c=cachetab[cacheval]))
-    if (strcmp(c->structure,x)==0) return c;
-  
   return NULL;
 }
 
 /* returns 1 if x already was in the cache */
 int write_cache (cache_entry *x) {
-  int cacheval;
-  cache_entry *c;
-  
-  cacheval=cache_f(x->structure);
-  if ((c=cachetab[cacheval])) {
-    free(c->structure);
-    free(c->neighbors);
-    free(c->rates);
-    free(c->energies);
-    free(c);
+  int found = 0;
+  unsigned long cacheval;
+  cache_slot *c;
+  cache_table *tab = get_cachetab();
+
+  cache_lock();
+  cacheval = cache_f(tab, &(x->key));
+
+  /* another thread may have stored the same structure meanwhile */
+  for (c = tab->buckets[cacheval]; c; c = c->chain)
+    if (same_structure(&(c->entry->key), &(x->key))) {
+      remove_slot(tab, c);
+      found = 1;
+      break;
+    }
+
+  if ((c = (cache_slot *)malloc(sizeof(cache_slot))) == NULL) {
+    fprintf(stderr, "out of memory\n"); exit(255);
+  }
+  c->entry = x;
+  c->size = sizeof(cache_slot) + sizeof(cache_entry)
+    + KEYWORDS(x->key.len)*sizeof(uint64_t)
+    + x->top*(2*sizeof(short) + sizeof(float) + sizeof(double));
+
+  /* make room for the new entry */
+  while ((tab->count > 0) && (tab->mem + c->size > tab->budget)) {
+    remove_slot(tab, tab->lru.newer);
+    tab->evictions++;
   }
-  cachetab[cacheval]=x;
-  return 0;
+
+  c->chain = tab->buckets[cacheval];
+  tab->buckets[cacheval] = c;
+  c->older = tab->lru.older;
+  c->newer = &(tab->lru);
+  tab->lru.older->newer = c;
+  tab->lru.older = c;
+  tab->mem += c->size;
+  tab->count++;
+  if (tab->count > tab->mask) grow_cachetab(tab);
+
+  cache_unlock();
+  return found;
+}
+
+/* unlink slot x from bucket and LRU list and free its entry */
+static void remove_slot(cache_table *tab, cache_slot *x) {
+  cache_slot **p;
+
+  for (p = tab->buckets + cache_f(tab, &(x->entry->key)); *p != x; p = &((*p)->chain));
+  *p = x->chain;
+  x->newer->older = x->older;
+  x->older->newer = x->newer;
+  tab->mem -= x->size;
+  tab->count--;
+  free_entry(x->entry);
+  free(x);
+}
+
+/* double number of buckets */
+static void grow_cachetab(cache_table *tab) {
+  unsigned long i, size = tab->mask + 1;
+  cache_slot **b, *c, *next;
+
+  b = (cache_slot **)calloc(2*size, sizeof(cache_slot *));
+  if (b == NULL) return; /* keep longer chains */
+
+  for (i = 0; i < size; i++)
+    for (c = tab->buckets[i]; c; c = next) {
+      next = c->chain;
+      c->chain = b[c->entry->key.hash & (2*size - 1)];
+      b[c->entry->key.hash & (2*size - 1)] = c;
+    }
+  free(tab->buckets);
+  tab->buckets = b;
+  tab->mask = 2*size - 1;
 }
 
 /**/
-void initialize_cache () { }
+static void free_entry(cache_entry *c) {
+  free_structure_key(&(c->key));
+  free(c->neighbors);
+  free(c->rates);
+  free(c->energies);
+  free(c);
+}
 
 /**/
+void initialize_cache () { }
+
+/* free cache of current thread; a shared cache is left alone */
 void kill_cache () {
-  int i;
-  
-  for (i=0;i<CACHESIZE+1;i++) {
-    if ( cachetab[i] ) {
-      free (cachetab[i]->structure);
-      free (cachetab[i]->neighbors);
-      free (cachetab[i]->rates);
-      free (cachetab[i]->energies);
-      free (cachetab[i]);
-    }
-    cachetab[i]=NULL;
-  }
+  free_structure_key(&lookup_key);
+  if (cache_is_shared || (cachetab == NULL)) return;
+  free_cachetab(cachetab);
+  cachetab = NULL;
+}
+
+/**/
+static void free_cachetab(cache_table *tab) {
+  while (tab->count > 0) remove_slot(tab, tab->lru.newer);
+
+  /* keep counters for the summary */
+#if WITH_KINFOLD_THREADS
+  pthread_mutex_lock(&cache_mutex);
+#endif
+  total_lookups += tab->lookups;
+  total_hits += tab->hits;
+  total_evictions += tab->evictions;
+#if WITH_KINFOLD_THREADS
+  pthread_mutex_unlock(&cache_mutex);
+#endif
+
+  free(tab->buckets);
+  free(tab);
+}
+
+/* summary of all caches killed so far */
+void log_cache_stats(FILE *FP) {
+  if (total_lookups == 0) return;
+  fprintf(FP, "#Cache: lookups=%lu hits=%lu (%.1f%%) evictions=%lu\n",
+          total_lookups, total_hits, 100.*total_hits/total_lookups,
+          total_evictions);
+  fflush(FP);
 }
 
 #if 0
 /**/
 static int cache_comp(cache_entry *x, cache_entry *y) {
-  return strcmp(((cache_entry *)x)->structure, ((cache_entry *)y)->structure);
+  return same_structure(&(x->key), &(y->key));
 }
 #endif
 
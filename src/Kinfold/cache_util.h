@@ -9,14 +9,25 @@
 #ifndef CACHE_UTIL_H
 #define CACHE_UTIL_H
 
+#include <stdio.h>
+#include <stdint.h>
+
 #ifdef __GNUC__
 #define UNUSED __attribute__ ((unused))
 #else
 #define UNUSED
 #endif
 
+/* structure in dot-bracket notation packed to 2 bits per position */
+typedef struct {
+  int len;           /* length of structure */
+  int size;          /* number of allocated words */
+  uint64_t hash;
+  uint64_t *bits;
+} structure_key;
+
 typedef struct {
-  char *structure;
+  structure_key key; /* packed structure */
   int top;           /* number of neighbors */
   int lmin;          /* is a local minimum ? */
   double flux;       /* sum of rates */
@@ -29,5 +40,13 @@ typedef struct {
 extern cache_entry *lookup_cache (char *x);
 extern int write_cache (cache_entry *x);
 void kill_cache(void);
+void cache_share(int share);
+void cache_lock(void);
+void cache_unlock(void);
+void log_cache_stats(FILE *FP);
+void key_of_structure(const char *s, structure_key *k);
+uint64_t hash_structure(const char *s);
+int same_structure(const structure_key *a, const structure_key *b);
+void free_structure_key(structure_key *k);
 
 #endif
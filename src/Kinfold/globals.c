@@ -23,6 +23,7 @@
 #endif
 
 #include "globals.h"
+#include "cache_util.h"
 #include "cmdline.h"
 
 /* forward declarations privat functions */
@@ -40,6 +41,16 @@ static void process_options_gg (int argc, char *argv[]);
 static const char *costring(const char *str);
 
 static char UNUSED rcsid[] ="$Id: globals.c,v 1.8 2008/10/07 09:03:14 ivo Exp $";
+
+/* hash set of stop structures, see find_stop_structure() */
+static uint64_t *stop_hash = NULL;
+static int *stop_set = NULL;
+static unsigned long stop_mask = 0;
+
+THREADLOCAL GlobVars GSV;
+THREADLOCAL GlobArrays GAV;
+GlobToggles GTV;
+
 #define MAXMSG 8
 static char msg[MAXMSG][60] =
 {{"off"},
@@ -99,6 +110,10 @@ void clean_up_globals(void) {
   for (i = 0; i < GSV.maxS; i++) free(GAV.stopform[i]);
   free(GAV.stopform);
   free(GAV.sE);
+  free(stop_hash);
+  free(stop_set);
+  stop_hash = NULL;
+  stop_set = NULL;
 #if HAVE_RNALIB_API3
   vrna_fold_compound_free(GAV.vc);
 #else
@@ -108,6 +123,72 @@ void clean_up_globals(void) {
 #endif
 }
 
+/* set up hash set of stop structures, once they are known */
+void ini_stop_set(void) {
+  int i, k;
+  unsigned long size, h;
+
+  for (size = 1; size < 2*GSV.maxS; size <<= 1);
+  stop_mask = size - 1;
+  stop_hash = (uint64_t *)calloc(GSV.maxS, sizeof(uint64_t));
+  assert(stop_hash != NULL);
+  stop_set = (int *)malloc(size*sizeof(int));
+  assert(stop_set != NULL);
+  for (h = 0; h < size; h++) stop_set[h] = -1;
+
+  for (i = 0; i < GSV.maxS; i++) {
+    stop_hash[i] = hash_structure(GAV.stopform[i]);
+    for (h = stop_hash[i] & stop_mask; (k = stop_set[h]) >= 0; h = (h + 1) & stop_mask)
+      if (strcmp(GAV.stopform[k], GAV.stopform[i]) == 0) break;
+    if (k < 0) stop_set[h] = i; /* first of identical stop structures wins */
+  }
+}
+
+/* returns number of stop structure s (counting from 1), or 0 */
+int find_stop_structure(const char *s) {
+  int k;
+  unsigned long h;
+  uint64_t hash;
+
+  hash = hash_structure(s);
+  for (h = hash & stop_mask; (k = stop_set[h]) >= 0; h = (h + 1) & stop_mask)
+    if ((stop_hash[k] == hash) && (strcmp(GAV.stopform[k], s) == 0))
+      return k + 1;
+  return 0;
+}
+
+/**/
+double kinfold_urn(void) {
+  /*
+    each trajectory draws from its own random number stream, regardless
+    of the number of threads, see kinfold_seed_trajectory()
+  */
+  return erand48(GAV.rng);
+}
+
+/*
+  derive the random number stream of trajectory traj from the
+  seed of the simulation, such that the outcome of a trajectory
+  does not depend on the thread that simulates it
+*/
+void kinfold_seed_trajectory(int traj) {
+  unsigned long long z;
+
+  z = ((unsigned long long)GAV.subi[0] << 32)
+    | ((unsigned long long)GAV.subi[1] << 16)
+    | (unsigned long long)GAV.subi[2];
+  z += 0x9E3779B97F4A7C15ULL * (unsigned long long)(traj + 1);
+  /* splitmix64 finalizer */
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  z = z ^ (z >> 31);
+
+  GAV.rng[0] = (unsigned short)(z & 0xFFFF);
+  GAV.rng[1] = (unsigned short)((z >> 16) & 0xFFFF);
+  GAV.rng[2] = (unsigned short)((z >> 32) & 0xFFFF);
+  GSV.traj   = traj;
+}
+
 /**/
 static void usage(int status) {
   fprintf(stderr, "\n%s - Kinetic Folding Program for Nucleic Acids -\n",
@@ -364,6 +445,18 @@ static void process_options_gg (int argc, char *argv[]) {
   }
   GSV.time = args_info.time_arg;
   GSV.num = args_info.num_arg;
+  GSV.threads = (args_info.threads_arg > 0) ? args_info.threads_arg : 1;
+#if !WITH_KINFOLD_THREADS
+  if (GSV.threads > 1) {
+    fprintf(stderr, "WARNING: Kinfold was compiled without thread support, "
+	    "ignoring --threads\n");
+    GSV.threads = 1;
+  }
+#endif
+  GTV.sharedCache = args_info.shared_cache_flag;
+  GTV.rateTree = args_info.ratetree_flag;
+  GSV.cacheMem = (args_info.cache_mem_arg > 0) ? args_info.cache_mem_arg : 1;
+  GSV.rtCheck = (args_info.ratetree_check_arg > 0) ? args_info.ratetree_check_arg : 0;
   strncpy(GAV.BaseName, args_info.log_arg, 255);
   GSV.cut = args_info.cut_arg;
   GSV.grow = args_info.grow_arg;
@@ -534,6 +627,8 @@ static void ini_gtoggles(void) {
   GTV.lmin = 0;
   GTV.fpt = 1;
   GTV.mc = 0;
+  GTV.sharedCache = 0;
+  GTV.rateTree = 0;
 }
 
 /**/
@@ -550,6 +645,10 @@ static void ini_gvars(void) {
   GSV.phi = 1.0;
   GSV.simTime = 0.0;
   GSV.glen = 15;
+  GSV.threads = 1;
+  GSV.traj = 0;
+  GSV.cacheMem = 512;
+  GSV.rtCheck = 0;
 }
 
 /**/
@@ -17,6 +17,18 @@
 
 #include "config.h"
 
+/*
+  simulate trajectories concurrently, where each thread keeps its own
+  copy of the simulation state (GSV, GAV, ringlist, neighbor list)
+*/
+#if defined(__GNUC__) && HAVE_LIBRNA_API3 && HAVE_PTHREAD_H && \
+    HAVE_LIBPTHREAD && HAVE_OPEN_MEMSTREAM && HAVE_ERAND48
+#define WITH_KINFOLD_THREADS 1
+#define THREADLOCAL __thread
+#else
+#define THREADLOCAL
+#endif
+
 #if HAVE_LIBRNA_API3
 #include <ViennaRNA/model.h>
 #include <ViennaRNA/data_structures.h>
@@ -40,6 +52,10 @@ typedef struct _GlobVars {
   double time;
   double phi;
   double simTime;
+  int    threads;  /* number of concurrent simulation threads */
+  int    traj;     /* number of the current trajectory */
+  int    cacheMem; /* memory budget of neighborhood cache in MB */
+  int    rtCheck;  /* validate rate tree every rtCheck steps (0 = never) */
 } GlobVars;
 
 typedef struct _GlobArrays {
@@ -55,6 +71,7 @@ typedef struct _GlobArrays {
   float *sE;           /* energy(s) of stop structure(s) */
   double phi_bounds[3];   /* phi_min, phi_inc, phi_max */
   unsigned short subi[3]; /* seeds for random-number-generator */
+  unsigned short rng[3];  /* random-number-generator state of current trajectory */
 
 #if HAVE_LIBRNA_API3
   vrna_md_t md;
@@ -81,16 +98,24 @@ typedef struct _GlobToogles {
   int fpt;
   int mc;
   int verbose;
+  int sharedCache; /* share neighborhood cache among threads */
+  int rateTree;    /* update neighborhood incrementally (ratetree.c) */
 } GlobToggles;
 
 void decode_switches(int argc, char *argv[]);
 void clean_up_globals(void);
 void log_prog_params(FILE *FP);
 void log_start_stop(FILE *FP);
+void ini_stop_set(void);
+int find_stop_structure(const char *s);
+double kinfold_urn(void);
+void kinfold_seed_trajectory(int traj);
 
-GlobVars GSV;
-GlobArrays GAV;
-GlobToggles GTV;
+/* simulation state is private to each thread */
+extern THREADLOCAL GlobVars GSV;
+extern THREADLOCAL GlobArrays GAV;
+/* toggles are read-only during simulation */
+extern GlobToggles GTV;
 
 #endif
 
@@ -29,15 +29,25 @@
 #include "nachbar.h"
 #include "cache_util.h"
 #include "globals.h"
+#include "ratetree.h"
+
+#if WITH_KINFOLD_THREADS
+#include <pthread.h>
+#endif
 
 static char UNUSED rcsid[] ="$Id: main.c,v 1.5 2008/08/28 09:40:55 ivo Exp $";
 extern void  read_parameter_file(const char fname[]);
 extern void get_from_cache(cache_entry *c);
+extern void get_from_ratetree(void);
 
 /* PRIVAT FUNCTIONS */
 static void ini_energy_model(void);
 static void read_data(void);
 static void clean_up(void);
+static void run_trajectory(char *start);
+#if WITH_KINFOLD_THREADS
+static void run_threads(void);
+#endif
 
 /**/
 int main(int argc, char *argv[]) {
@@ -59,6 +69,12 @@ int main(int argc, char *argv[]) {
   */
   read_data();
 
+  if (GTV.rateTree && !rt_supported()) {
+    fprintf(stderr, "WARNING: --ratetree can not be used with --noLP, --grow, "
+            "--phi, or co-folding, ignoring --ratetree\n");
+    GTV.rateTree = 0;
+  }
+
 #if HAVE_LIBRNA_API3
   /* init vrna_fold_compound_t */
   /*
@@ -70,64 +86,254 @@ int main(int argc, char *argv[]) {
   free(tmp);
 #endif
 
+#if WITH_KINFOLD_THREADS
+  if (GSV.threads > 1) {
+    /*
+      perform GSV.num simulations in GSV.threads concurrent threads
+    */
+    run_threads();
+    clean_up();
+    return(0);
+  }
+#endif
+
   /*
     perform GSV.num simulations
   */
     
   start = strdup(GAV.startform); /* remember startform for next run */
   for (i = 0; i < GSV.num; i++) {
+    kinfold_seed_trajectory(i);
+    run_trajectory(start);
+  }
+  
+  /*
+    clean up memory
+  */
+  free(start);
+  clean_up();
+  return(0);
+}
 
-    /*
-      initialize or reset ringlist to start conditions
-    */
-    ini_or_reset_rl();
-    if (GSV.grow>0) {
-      if (strlen(GAV.farbe)>GSV.glen) {
-	start[GSV.glen] = '\0';
-	GAV.farbe[GSV.glen] = '\0';
-	strcpy(GAV.startform,start);
-	strcpy(GAV.currform,start);
-	GSV.len=GSV.glen;
+/* simulate a single trajectory */
+static void run_trajectory(char *start) {
+
+  /*
+    initialize or reset ringlist to start conditions
+  */
+  ini_or_reset_rl();
+  if (GSV.grow>0) {
+    if (strlen(GAV.farbe)>GSV.glen) {
+      start[GSV.glen] = '\0';
+      GAV.farbe[GSV.glen] = '\0';
+      strcpy(GAV.startform,start);
+      strcpy(GAV.currform,start);
+      GSV.len=GSV.glen;
 
 #if HAVE_LIBRNA_API3
-        GAV.vc->length = GSV.len;
+      GAV.vc->length = GSV.len;
 #endif
+    }
+    clean_up_rl();
+    ini_or_reset_rl();
+  }
+
+  /* moves of the start structure */
+  if (GTV.rateTree) rt_ini();
+
+  /*
+    perform simulation
+  */
+  for (GSV.steps = 1;; GSV.steps++) {
+    cache_entry *c;
+
+    if (GTV.rateTree) {
+      /* neighbourhood is updated incrementally */
+      get_from_ratetree();
+      if ((GSV.rtCheck > 0) && (GSV.steps % GSV.rtCheck == 0) && (rt_check() > 0)) {
+	fprintf(stderr, "ERROR: rate tree inconsistent after %d steps in\n%s\n",
+		GSV.steps, GAV.currform);
+	exit(EXIT_FAILURE);
       }
-      clean_up_rl();
-      ini_or_reset_rl();
+      if ( sel_nb() > 0 ) break;
+      continue;
     }
 
     /*
-      perform simulation
+      take neighbourhood of current structure from cache if there
+      else generate it from scratch
     */
-    for (GSV.steps = 1;; GSV.steps++) {
-      cache_entry *c;
-
-      /*
-	take neighbourhood of current structure from cache if there
-	else generate it from scratch
-      */
-      if ( (c = lookup_cache(GAV.currform)) ) get_from_cache(c);
-      else move_it();
+    cache_lock();
+    if ( (c = lookup_cache(GAV.currform)) ) get_from_cache(c);
+    cache_unlock();
+    if (c == NULL) move_it();
 	
-      /*
-	select a structure from neighbourhood of current structure
-	and make it to the new current structure.
-	stop simulation if stop condition is met.
-      */
-      if ( sel_nb() > 0 ) break;
+    /*
+      select a structure from neighbourhood of current structure
+      and make it to the new current structure.
+      stop simulation if stop condition is met.
+    */
+    if ( sel_nb() > 0 ) break;
 
-      /* if (GSV.grow>0) grow_chain(); */
-    }
+    /* if (GSV.grow>0) grow_chain(); */
   }
-  
+}
+
+#if WITH_KINFOLD_THREADS
+/*
+  Concurrent simulation of trajectories. Each thread works on a private
+  copy of the simulation state (GSV, GAV, ringlist, neighbor list, cache)
+  and draws random numbers from a stream that only depends on the seed
+  and the number of the trajectory. Output and log of each trajectory
+  are buffered and written in the order of the trajectories, such that
+  the results do not depend on the number of threads.
+*/
+typedef struct {
+  char   *out;   /* buffered output of trajectory */
+  size_t out_size;
+  char   *log;   /* buffered log of trajectory */
+  size_t log_size;
+  int    done;
+} traj_output;
+
+static pthread_mutex_t  traj_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int              next_traj = 0;    /* next trajectory to simulate */
+static int              next_flush = 0;   /* next trajectory to write */
+static traj_output      *traj_out = NULL;
+static FILE             *traj_logFP = NULL;
+static GlobVars         GSV_template;
+static GlobArrays       GAV_template;
+static char             *tmpl_start = NULL; /* start structure of each trajectory */
+
+/* write the buffered results of finished trajectories in order */
+static void flush_trajectories(void) {
+  while ((next_flush < GSV.num) && traj_out[next_flush].done) {
+    traj_output *o = traj_out + next_flush;
+    fwrite(o->out, 1, o->out_size, stdout);
+    fwrite(o->log, 1, o->log_size, traj_logFP);
+    free(o->out);
+    free(o->log);
+    o->out = o->log = NULL;
+    next_flush++;
+  }
+  fflush(stdout);
+  fflush(traj_logFP);
+}
+
+/**/
+static void *trajectory_worker(void *arg) {
+  char *start;
+  int  t;
+
+  /* private copy of the simulation state */
+  GSV = GSV_template;
+  GAV = GAV_template;
+  GAV.vc        = (vrna_fold_compound_t *)arg;
+  GAV.farbe     = strdup(GAV_template.farbe);
+  GAV.startform = strdup(GAV_template.startform);
+  GAV.currform  = strdup(GAV_template.currform);
+  GAV.prevform  = strdup(GAV_template.prevform);
+  start         = strdup(tmpl_start);
+
+  for (;;) {
+    FILE *out, *log;
+    traj_output *o;
+
+    pthread_mutex_lock(&traj_mutex);
+    t = next_traj++;
+    pthread_mutex_unlock(&traj_mutex);
+    if (t >= GSV.num) break;
+
+    o   = traj_out + t;
+    out = open_memstream(&(o->out), &(o->out_size));
+    log = open_memstream(&(o->log), &(o->log_size));
+    assert((out != NULL) && (log != NULL));
+
+    /* reset to initial conditions of the simulation */
+    if (GSV.len != GSV_template.len) clean_up_rl(); /* chain growth */
+    strcpy(GAV.farbe, GAV_template.farbe);
+    strcpy(GAV.startform, tmpl_start);
+    strcpy(start, tmpl_start);
+    GSV.len       = GSV_template.len;
+    GAV.vc->length = GSV.len;
+
+    kinfold_seed_trajectory(t);
+    nb_set_output(out, log);
+    run_trajectory(start);
+    nb_set_output(NULL, NULL);
+
+    fclose(out);
+    fclose(log);
+
+    pthread_mutex_lock(&traj_mutex);
+    o->done = 1;
+    flush_trajectories();
+    pthread_mutex_unlock(&traj_mutex);
+  }
+
+  clean_up_rl();
+  clean_up_nbArrays();
+  rt_clean_up();
+  kill_cache();
+  free(start);
+  free(GAV.farbe);
+  free(GAV.startform);
+  free(GAV.currform);
+  free(GAV.prevform);
+
+  return NULL;
+}
+
+/**/
+static void run_threads(void) {
+  int                   i, num_threads;
+  char                  *tmp;
+  pthread_t             *threads;
+  vrna_fold_compound_t  **vcs;
+
+  num_threads = (GSV.threads > GSV.num) ? GSV.num : GSV.threads;
+
   /*
-    clean up memory
+    set up shared data, i.e. log-file, stop structure(s), and their energies,
+    in the main thread
   */
-  free(start);
-  clean_up();
-  return(0);
+  tmpl_start = strdup(GAV.startform);
+  ini_or_reset_rl();
+  traj_logFP = nb_get_log();
+  GSV_template = GSV;
+  GAV_template = GAV;
+
+  cache_share(GTV.sharedCache);
+
+  traj_out  = (traj_output *)calloc(GSV.num, sizeof(traj_output));
+  threads   = (pthread_t *)calloc(num_threads, sizeof(pthread_t));
+  vcs       = (vrna_fold_compound_t **)calloc(num_threads, sizeof(vrna_fold_compound_t *));
+  assert((traj_out != NULL) && (threads != NULL) && (vcs != NULL));
+
+  /* each thread evaluates energies with its own fold compound */
+  tmp = vrna_cut_point_insert(GAV.farbe, cut_point);
+  for (i = 0; i < num_threads; i++)
+    vcs[i] = vrna_fold_compound(tmp, &(GAV.md), VRNA_OPTION_EVAL_ONLY);
+  free(tmp);
+
+  for (i = 0; i < num_threads; i++)
+    if (pthread_create(threads + i, NULL, trajectory_worker, vcs[i])) {
+      fprintf(stderr, "run_threads(): could not create thread\n");
+      exit(1);
+    }
+
+  for (i = 0; i < num_threads; i++) {
+    pthread_join(threads[i], NULL);
+    vrna_fold_compound_free(vcs[i]);
+  }
+  cache_share(0);
+
+  free(vcs);
+  free(threads);
+  free(traj_out);
+  free(tmpl_start);
 }
+#endif
 
 /**/
 static void ini_energy_model(void) {
@@ -255,8 +461,9 @@ static void read_data(void) {
 
 /**/
 void clean_up(void) {
+  rt_clean_up();
   clean_up_globals();
   clean_up_rl();
-  clean_up_nbList();
   kill_cache();
+  clean_up_nbList();
 }
@@ -26,53 +26,60 @@
 
 #include "cache_util.h"
 #include "baum.h"
+#include "ratetree.h"
 
 static char UNUSED rcsid[]="$Id: nachbar.c,v 1.8 2008/06/03 21:55:11 ivo Exp $";
 
 /* arrays */
-static short *neighbor_list=NULL;
-static float *bmf=NULL; /* boltzmann weight of structure */
+static THREADLOCAL short *neighbor_list=NULL;
+static THREADLOCAL float *bmf=NULL; /* boltzmann weight of structure */
 static const char *costring(const char *str);
 
 /* globals for laplace stuff */
-static double L = 0.0;
-static double D = 0.0;
-static double sumT = 0.0;
-static double sumK = 0.0;
-static double sumKK = 0.0;
-static double sumD = 0.0;
-static double *energies=NULL; /* energies of neighbors */
+static THREADLOCAL double L = 0.0;
+static THREADLOCAL double D = 0.0;
+static THREADLOCAL double sumT = 0.0;
+static THREADLOCAL double sumK = 0.0;
+static THREADLOCAL double sumKK = 0.0;
+static THREADLOCAL double sumD = 0.0;
+static THREADLOCAL double *energies=NULL; /* energies of neighbors */
 
 /* variables */
 /*  static double highestE = -1000.0; */
 /*  static double OhighestE = -1000.0; */
 /*  static char *highestS, *OhighestS; */
-static int lmin = 1;
-static int top = 0;
-static int is_from_cache = 0;
+static THREADLOCAL int lmin = 1;
+static THREADLOCAL int top = 0;
+static THREADLOCAL int is_from_cache = 0;
+static THREADLOCAL int is_from_ratetree = 0;
 /*  static double meanE = 0.0; */
-static double totalflux = 0.0;
-static double Zeit = 0.0;
-static double zeitInc = 0.0;
-static double _RT = 0.6;
+static THREADLOCAL double totalflux = 0.0;
+static THREADLOCAL double Zeit = 0.0;
+static THREADLOCAL double zeitInc = 0.0;
+static THREADLOCAL double _RT = 0.6;
 
 /* public functiones */
 void ini_nbList(int chords);
 void update_nbList(int i, int j, int iE);
 int sel_nb(void);
 void clean_up_nbList(void);
+void nb_set_output(FILE *out, FILE *log);
+FILE *nb_get_log(void);
+void clean_up_nbArrays(void);
 extern void update_tree(int i, int j);
 
 /* privat functiones */
 static void reset_nbList(void);
 static void grow_chain(void);
-static FILE *logFP=NULL;
+static THREADLOCAL FILE *logFP=NULL;  /* trajectory log */
+static THREADLOCAL FILE *outFP=NULL;  /* trajectory output (stdout) */
 
 /**/
 void ini_nbList(int chords) {
   char logFN[256];
 
   _RT = (((temperature + K0) * GASCONST) / 1000.0);
+  if (outFP == NULL) outFP = stdout;
   if (neighbor_list!=NULL) return;
   /*
     list for move coding
@@ -91,6 +98,9 @@ void ini_nbList(int chords) {
   energies = (double*)calloc(2*chords, sizeof(double));
   assert(energies != NULL);
   
+  /* threads other than the main thread log to a buffer set beforehand */
+  if (logFP != NULL) return;
+
   /* open log-file */
   logFP = fopen(strcat(strcpy(logFN, GAV.BaseName), ".log"), "a+");
   assert(logFP != NULL);
@@ -100,6 +110,17 @@ void ini_nbList(int chords) {
   log_start_stop(logFP);
 }
 
+/* redirect output and log of the trajectories of the current thread */
+void nb_set_output(FILE *out, FILE *log) {
+  outFP = out;
+  logFP = log;
+}
+
+/**/
+FILE *nb_get_log(void) {
+  return logFP;
+}
+
 /**/
 void update_nbList(int i, int j, int iE) {
   double E, dE, p;
@@ -144,6 +165,15 @@ void get_from_cache(cache_entry *c) {
   is_from_cache = 1;
 }
 
+/**/
+void get_from_ratetree(void) {
+  top = rt_num_moves();
+  totalflux = rt_flux();
+  GSV.currE = rt_energy();
+  lmin = rt_lmin();
+  is_from_ratetree = 1;
+}
+
 /**/
 void put_in_cache(void) {
   cache_entry *c;
@@ -151,9 +181,9 @@ void put_in_cache(void) {
   if ((c = (cache_entry *) malloc(sizeof(cache_entry)))==NULL) {
     fprintf(stderr, "out of memory\n"); exit(255);
   }
-/*    c->structure = strdup(GAV.currform); */
-  c->structure = (char *) calloc(GSV.len+1, sizeof(char));
-  strcpy(c->structure, GAV.currform);
+  c->key.bits = NULL;
+  c->key.size = 0;
+  key_of_structure(GAV.currform, &(c->key));
   c->neighbors = (short *) malloc(top*2*sizeof(short));
   memcpy(c->neighbors,neighbor_list,top*2*sizeof(short));
   c->rates = (float *) malloc(top*sizeof(float));
@@ -171,14 +201,15 @@ void put_in_cache(void) {
 
 int sel_nb(void) {
 
-  char trans, **s;
+  char trans;
   int next, i;
   double pegel = 0.0, schwelle = 0.0, zufall = 0.0;
   int found_stop=0;
 
   /* before we select a move, store current conformation in cache */
   /* ... unless it just came from there */
-  if ( !is_from_cache ) put_in_cache();
+  if ( is_from_ratetree ) ; /* rates are kept in rate tree */
+  else if ( !is_from_cache ) put_in_cache();
   else
     /* laplace stuff */
     for (i=0; i<top; i++) {
@@ -188,8 +219,8 @@ int sel_nb(void) {
   is_from_cache = 0;
 
   /* draw 2 different a random number */
-  schwelle = urn();
-  while ( zufall==0 ) zufall = urn();
+  schwelle = kinfold_urn();
+  while ( zufall==0 ) zufall = kinfold_urn();
 
   /* advance internal clock */
   if (totalflux>0)
@@ -214,24 +245,28 @@ int sel_nb(void) {
   schwelle *=totalflux;
 
   /* and choose a neighbour structure next */
-  for (next = 0; next < top; next++) {
-    pegel += bmf[next];
-    if (pegel > schwelle) break;
+  if ( is_from_ratetree ) {
+    next = -1;
+    if (top > 0) {
+      rt_select(schwelle, neighbor_list, neighbor_list + 1);
+      next = 0;
+    }
   }
+  else {
+    for (next = 0; next < top; next++) {
+      pegel += bmf[next];
+      if (pegel > schwelle) break;
+    }
 
-  /* in case of rounding errors */
-  if (next==top) next=top-1;
+    /* in case of rounding errors */
+    if (next==top) next=top-1;
+  }
 
   /*
     process termination contitiones
   */
   /* is current structure identical to a stop structure ?*/
-  for (found_stop = 0, s = GAV.stopform; *s; s++) {
-    if (strcmp(*s, GAV.currform) == 0) {
-      found_stop = (s - GAV.stopform) + 1;
-      break;
-    }
-  }
+  found_stop = find_stop_structure(GAV.currform);
 
   if ( ((found_stop > 0) && (GTV.fpt == 1)) || (Zeit > GSV.time) ) {
     /* met condition to stop simulation */
@@ -246,19 +281,19 @@ int sel_nb(void) {
     
     /* this goes to stdout */
     if ( !GTV.silent ) {
-      printf("%s %6.2f %10.3f", costring(GAV.currform), GSV.currE, Zeit);
+      fprintf(outFP, "%s %6.2f %10.3f", costring(GAV.currform), GSV.currE, Zeit);
 
       /* laplace stuff*/
-      if (GTV.phi) printf(" %8.3f %8.3f %3g", zeitInc, L, D); 
+      if (GTV.phi) fprintf(outFP, " %8.3f %8.3f %3g", zeitInc, L, D); 
 
-      if (GTV.verbose) printf(" %4d _ %d", top, lmin);
-      if (found_stop) printf(" X%d\n", found_stop);/* found a stop structure */
-      else printf(" O\n"); /* time for simulation is exceeded */
+      if (GTV.verbose) fprintf(outFP, " %4d _ %d", top, lmin);
+      if (found_stop) fprintf(outFP, " X%d\n", found_stop);/* found a stop structure */
+      else fprintf(outFP, " O\n"); /* time for simulation is exceeded */
 
       /* laplace stuff */
-      if (GTV.phi) printf("Curvature fluctuation sigma = %7.5f\n", sigma);
+      if (GTV.phi) fprintf(outFP, "Curvature fluctuation sigma = %7.5f\n", sigma);
 
-      fflush(stdout);
+      fflush(outFP);
     }
 
     /* this goes to log */
@@ -279,10 +314,8 @@ int sel_nb(void) {
 
       fprintf(logFP," %d %s\n", lmin, costring(GAV.currform));
     }
-    GAV.subi[0] = xsubi[0];
-    GAV.subi[1] = xsubi[1];
-    GAV.subi[2] = xsubi[2];
-    fprintf(logFP, "(%5hu %5hu %5hu)", GAV.subi[0], GAV.subi[1], GAV.subi[2]);
+    /* trajectories use their own random number stream */
+    fprintf(logFP, "(%5hu %5hu %5hu)", GAV.rng[0], GAV.rng[1], GAV.rng[2]);
     fflush(logFP);
     
     Zeit = 0.0;
@@ -298,6 +331,7 @@ int sel_nb(void) {
     /*  highestE = OhighestE = -1000.0; */
     reset_nbList();
     costring(NULL);
+    is_from_ratetree = 0;
     return(1);
   }
   else {
@@ -309,12 +343,12 @@ int sel_nb(void) {
 	char format[64];
 	flag = 1;
 	sprintf(format, "%%-%ds %%6.2f %%10.3f", strlen(GAV.farbe_full)+1);
-	printf(format, costring(GAV.currform), GSV.currE, Zeit);
+	fprintf(outFP, format, costring(GAV.currform), GSV.currE, Zeit);
       }
 
       /* laplace stuff */
       if (GTV.phi) {
-	printf(" %8.3f %8.3f %3g", zeitInc, L, D);
+	fprintf(outFP, " %8.3f %8.3f %3g", zeitInc, L, D);
 	L = D = 0.0; /* reset L and D for next structure */
       }
 
@@ -334,9 +368,9 @@ int sel_nb(void) {
 	    else trans = 'D';
 	  }
 	}
-	printf(" %4d %c %d", top, trans, lmin);
+	fprintf(outFP, " %4d %c %d", top, trans, lmin);
       }
-      if (flag) printf("\n");
+      if (flag) fprintf(outFP, "\n");
     }
   }
 
@@ -373,12 +407,16 @@ int sel_nb(void) {
   }
 #endif
 
-  if (next>=0) update_tree(neighbor_list[2*next], neighbor_list[2*next+1]);
+  if ( is_from_ratetree ) {
+    if (next >= 0) rt_apply();
+  }
+  else if (next>=0) update_tree(neighbor_list[2*next], neighbor_list[2*next+1]);
   else {
     clean_up_rl(); ini_or_reset_rl();
   }
 
   reset_nbList();
+  is_from_ratetree = 0;
   return(0);
 }
 
@@ -394,11 +432,23 @@ static void reset_nbList(void) {
 /*======================*/
 void clean_up_nbList(void){
 
+  clean_up_nbArrays();
+  fprintf(logFP,"\n");
+  log_cache_stats(logFP);
+  fclose(logFP);
+  logFP = NULL;
+}
+
+/* free neighbor list of current thread, but leave its log alone */
+void clean_up_nbArrays(void){
+
   free(neighbor_list);
   free(bmf);
   free(energies);
-  fprintf(logFP,"\n");
-  fclose(logFP);
+  neighbor_list = NULL;
+  bmf = NULL;
+  energies = NULL;
+  costring(NULL);
 }
 
 /*======================*/
@@ -425,8 +475,8 @@ static void grow_chain(void){
 }
 
 static const char *costring(const char *str) {
-  static char* buffer=NULL;
-  static int size=0;
+  static THREADLOCAL char* buffer=NULL;
+  static THREADLOCAL int size=0;
   int n;
   if (str==NULL) {
     if (buffer) {
@@ -16,6 +16,9 @@ extern void update_nbList(int i,int j, int iE);
 /* used in main.c */
 extern int sel_nb(void);
 extern void clean_up_nbList(void);
+extern void nb_set_output(FILE *out, FILE *log);
+extern FILE *nb_get_log(void);
+extern void clean_up_nbArrays(void);
 
 extern void grow_chain(void);
 #endif
@@ -0,0 +1,712 @@
+/*
+  Incremental neighborhood for Kinfold (--ratetree)
+
+  All moves of the current structure are kept in a pool together with
+  their rates, and the rates are summed up in a Fenwick tree, such that
+  a move can be drawn in O(log n). Moves are grouped by the loop(s) their
+  energy change depends on:
+
+    INS(p)   insertion of a base pair into the loop closed by p
+    STEM(p)  deletion and shifts of the pair p, which depend on the loop
+             closed by p and the loop enclosing p
+
+  (p = 0 denotes the exterior loop). After a move, only the groups of
+  the (at most two) changed loops, and the STEM groups of their children
+  are re-generated. All other moves keep their energy change and rate.
+*/
+
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+
+#if HAVE_LIBRNA_API3
+#include <ViennaRNA/fold_vars.h>
+#include <ViennaRNA/energy_const.h>
+#include <ViennaRNA/eval.h>
+#include <ViennaRNA/structure_utils.h>
+#include <ViennaRNA/loops/external.h>
+#include <ViennaRNA/loops/hairpin.h>
+#include <ViennaRNA/loops/internal.h>
+#include <ViennaRNA/loops/multibranch.h>
+#include <ViennaRNA/neighbor.h>
+#include <ViennaRNA/utils.h>
+#endif
+
+#include "globals.h"
+#include "ratetree.h"
+
+/* PUBLIC FUNCTIONES */
+int rt_supported(void);
+void rt_ini(void);
+void rt_clean_up(void);
+int rt_check(void);
+int rt_num_moves(void);
+int rt_lmin(void);
+double rt_flux(void);
+float rt_energy(void);
+void rt_select(double r, short *i, short *j);
+void rt_apply(void);
+
+#if HAVE_LIBRNA_API3
+
+#define INS(p)  (p)
+#define STEM(p) (length + 1 + (p))
+
+/* item of move pool */
+typedef struct {
+  short i, j; /* move, encoded as in the neighbor list of nachbar.c */
+  int dE;     /* energy change in dcal/mol */
+  int group;  /* group the move belongs to, -1 if slot is unused */
+  int next;   /* next move of group, or next unused slot */
+} rt_move;
+
+/* PRIVATE FUNCTIONES */
+static void grow_pool(void);
+static void rebuild_tree(void);
+static void tree_add(int k, double v);
+static double rate_of(int dE);
+static void add_move(int g, int i, int j, int dE);
+static void clear_group(int g);
+static int parent_of(int k, int l);
+static int collect_loop(int p, int *u);
+static int ext_stem(int k, int l);
+static int ml_stem(int k, int l);
+static int ml_closing(int k, int l);
+static int ml_unpaired(int u);
+static void gen_insertions(int p);
+static void gen_stem(int p);
+static void refresh_loop(int p, int with_stem);
+static long move_key(int i, int j);
+static int cmp_key(const void *a, const void *b);
+
+static THREADLOCAL rt_move *moves = NULL;
+static THREADLOCAL double *rates = NULL;
+static THREADLOCAL double *tree = NULL;  /* Fenwick tree of rates (1-based) */
+static THREADLOCAL int capacity = 0;     /* size of move pool, power of 2 */
+static THREADLOCAL int free_slot = -1;
+static THREADLOCAL int updates = 0;      /* tree updates since last rebuild */
+static THREADLOCAL int *groups = NULL;   /* first move of each group */
+static THREADLOCAL int *loop_u = NULL;   /* unpaired bases of a loop */
+static THREADLOCAL int *loop_v = NULL;
+/* stems, unpaired bases, and stem energies 5' of an unpaired base in a loop */
+static THREADLOCAL int *stems_left = NULL;
+static THREADLOCAL int *unpaired_left = NULL;
+static THREADLOCAL int *energy_left = NULL;
+static THREADLOCAL int *ml_left = NULL;
+static THREADLOCAL short *pt = NULL;     /* pair table of current structure */
+static THREADLOCAL int length = 0;
+static THREADLOCAL int energy = 0;       /* energy of current structure */
+static THREADLOCAL int num_moves = 0;
+static THREADLOCAL int num_down = 0;     /* moves with dE < 0 */
+static THREADLOCAL int num_flat = 0;     /* moves with dE == 0 */
+static THREADLOCAL int selected = -1;
+static THREADLOCAL double RT = 0.6;
+
+/**/
+int rt_supported(void) {
+  /*
+    lonely pair moves and co-folding penalties depend on more
+    than two loops, chain growth and the laplace statistics need
+    the full neighborhood in every step
+  */
+  return !(GTV.noLP || GTV.phi || (GSV.grow > 0) || (cut_point > 0));
+}
+
+/**/
+void rt_ini(void) {
+  int p, i;
+
+  rt_clean_up();
+
+  RT = (((temperature + K0) * GASCONST) / 1000.0);
+  length = GSV.len;
+  pt = vrna_ptable(GAV.currform);
+  groups = (int *)malloc(2 * (length + 1) * sizeof(int));
+  loop_u = (int *)malloc((length + 2) * sizeof(int));
+  loop_v = (int *)malloc((length + 2) * sizeof(int));
+  stems_left = (int *)malloc((length + 2) * sizeof(int));
+  unpaired_left = (int *)malloc((length + 2) * sizeof(int));
+  energy_left = (int *)malloc((length + 2) * sizeof(int));
+  ml_left = (int *)malloc((length + 2) * sizeof(int));
+  assert((groups != NULL) && (loop_u != NULL) && (loop_v != NULL));
+  assert((stems_left != NULL) && (unpaired_left != NULL));
+  assert((energy_left != NULL) && (ml_left != NULL));
+  for (i = 0; i < 2 * (length + 1); i++) groups[i] = -1;
+
+  grow_pool();
+  energy = vrna_eval_structure_pt(GAV.vc, pt);
+
+  gen_insertions(0);
+  for (p = 1; p <= length; p++) {
+    if (pt[p] > p) {
+      gen_insertions(p);
+      gen_stem(p);
+    }
+  }
+}
+
+/**/
+void rt_clean_up(void) {
+  free(moves);
+  free(rates);
+  free(tree);
+  free(groups);
+  free(loop_u);
+  free(loop_v);
+  free(stems_left);
+  free(unpaired_left);
+  free(energy_left);
+  free(ml_left);
+  free(pt);
+  moves = NULL;
+  rates = tree = NULL;
+  groups = loop_u = loop_v = NULL;
+  stems_left = unpaired_left = energy_left = ml_left = NULL;
+  pt = NULL;
+  capacity = 0;
+  free_slot = selected = -1;
+  num_moves = num_down = num_flat = updates = 0;
+}
+
+/*
+  compare the incrementally maintained moves with a full re-evaluation
+  of the current structure and all its neighbors, returns the number of
+  discrepancies found (details go to stderr)
+*/
+int rt_check(void) {
+  int k, n, E, E_nb, down = 0, flat = 0, errors = 0;
+  double flux = 0.;
+  short *pt_nb;
+  long *keys;
+  unsigned int options;
+  vrna_move_t m, *nb;
+
+  E = vrna_eval_structure_pt(GAV.vc, pt);
+  if (E != energy) {
+    fprintf(stderr, "ratetree: energy %d != %d of %s\n", energy, E, GAV.currform);
+    errors++;
+  }
+
+  pt_nb = vrna_ptable_copy(pt);
+  for (n = k = 0; k < capacity; k++) {
+    if (moves[k].group < 0) continue;
+    n++;
+    if (moves[k].dE < 0) down++;
+    else if (moves[k].dE == 0) flat++;
+    flux += rates[k];
+
+    m = vrna_move_init(moves[k].i, moves[k].j);
+    vrna_move_apply(pt_nb, &m);
+    E_nb = vrna_eval_structure_pt(GAV.vc, pt_nb);
+    memcpy(pt_nb, pt, (length + 1) * sizeof(short));
+
+    if (moves[k].dE != E_nb - E) {
+      fprintf(stderr, "ratetree: move (%d,%d) dE %d != %d\n",
+	      moves[k].i, moves[k].j, moves[k].dE, E_nb - E);
+      errors++;
+    }
+    if (rates[k] != rate_of(moves[k].dE)) {
+      fprintf(stderr, "ratetree: move (%d,%d) rate %g != %g\n",
+	      moves[k].i, moves[k].j, rates[k], rate_of(moves[k].dE));
+      errors++;
+    }
+  }
+  free(pt_nb);
+
+  if ((n != num_moves) || (down != num_down) || (flat != num_flat)) {
+    fprintf(stderr, "ratetree: counted %d/%d/%d moves (all/down/flat), expected %d/%d/%d\n",
+	    num_moves, num_down, num_flat, n, down, flat);
+    errors++;
+  }
+  if (fabs(rt_flux() - flux) > 1e-9 * flux) {
+    fprintf(stderr, "ratetree: flux %.12g != %.12g\n", rt_flux(), flux);
+    errors++;
+  }
+
+  /* the pool must hold exactly the neighbors of the current structure */
+  options = VRNA_MOVESET_INSERTION | VRNA_MOVESET_DELETION;
+  if (!GTV.noShift) options |= VRNA_MOVESET_SHIFT;
+  nb = vrna_neighbors(GAV.vc, pt, options);
+  for (n = 0; (nb[n].pos_5 != 0) || (nb[n].pos_3 != 0); n++);
+  if (n != num_moves) {
+    fprintf(stderr, "ratetree: %d moves in pool, %d neighbors\n", num_moves, n);
+    errors++;
+  }
+  else {
+    keys = (long *)malloc(2 * (n + 1) * sizeof(long));
+    assert(keys != NULL);
+    for (k = 0; k < n; k++)
+      keys[n + k] = move_key(nb[k].pos_5, nb[k].pos_3);
+    for (n = k = 0; k < capacity; k++)
+      if (moves[k].group >= 0) keys[n++] = move_key(moves[k].i, moves[k].j);
+    qsort(keys, n, sizeof(long), cmp_key);
+    qsort(keys + n, n, sizeof(long), cmp_key);
+    for (k = 0; k < n; k++)
+      if (keys[k] != keys[n + k]) {
+	fprintf(stderr, "ratetree: pool and neighbors differ\n");
+	errors++;
+	break;
+      }
+    free(keys);
+  }
+  free(nb);
+
+  return errors;
+}
+
+/**/
+int rt_num_moves(void) {
+  return num_moves;
+}
+
+/* 1 if local minimum, 2 if neighbors of same energy exist, 0 otherwise */
+int rt_lmin(void) {
+  if (num_down > 0) return 0;
+  return (num_flat > 0) ? 2 : 1;
+}
+
+/**/
+double rt_flux(void) {
+  return (num_moves > 0) ? tree[capacity] : 0.;
+}
+
+/**/
+float rt_energy(void) {
+  return (float)energy / 100.;
+}
+
+/* select the move where the cumulative rate exceeds r */
+void rt_select(double r, short *i, short *j) {
+  int pos, step;
+
+  for (pos = 0, step = capacity; step > 0; step >>= 1) {
+    if ((pos + step <= capacity) && (tree[pos + step] <= r)) {
+      pos += step;
+      r -= tree[pos];
+    }
+  }
+
+  /* in case of rounding errors */
+  if (pos >= capacity) pos = capacity - 1;
+  while ((pos > 0) && (moves[pos].group < 0)) pos--;
+  while ((pos < capacity - 1) && (moves[pos].group < 0)) pos++;
+
+  selected = pos;
+  *i = moves[pos].i;
+  *j = moves[pos].j;
+}
+
+/* perform the selected move and update the affected moves */
+void rt_apply(void) {
+  int i, j, keep, old, new, L;
+
+  i = moves[selected].i;
+  j = moves[selected].j;
+  energy += moves[selected].dE;
+
+  if ((i > 0) && (j > 0)) { /* insert */
+    L = parent_of(i, j);
+    pt[i] = j;
+    pt[j] = i;
+    GAV.currform[i - 1] = '(';
+    GAV.currform[j - 1] = ')';
+    refresh_loop(L, 1);
+    refresh_loop(i, 0);
+  }
+  else if ((i < 0) && (j < 0)) { /* delete */
+    i = -i;
+    j = -j;
+    L = parent_of(i, j);
+    clear_group(INS(i));
+    clear_group(STEM(i));
+    pt[i] = pt[j] = 0;
+    GAV.currform[i - 1] = GAV.currform[j - 1] = '.';
+    refresh_loop(L, 1);
+  }
+  else { /* shift */
+    keep  = (i > 0) ? i : j;
+    new   = (i > 0) ? -j : -i;
+    old   = pt[keep];
+    L     = (keep < old) ? parent_of(keep, old) : parent_of(old, keep);
+    clear_group(INS((keep < old) ? keep : old));
+    clear_group(STEM((keep < old) ? keep : old));
+    pt[old] = 0;
+    pt[keep] = new;
+    pt[new] = keep;
+    GAV.currform[old - 1] = '.';
+    GAV.currform[((keep < new) ? keep : new) - 1] = '(';
+    GAV.currform[((keep < new) ? new : keep) - 1] = ')';
+    refresh_loop(L, 1);
+    refresh_loop((keep < new) ? keep : new, 0);
+  }
+
+  selected = -1;
+}
+
+/*==========================*/
+static void grow_pool(void) {
+  int k, n;
+
+  n = (capacity > 0) ? 2 * capacity : 1024;
+  moves = (rt_move *)realloc(moves, n * sizeof(rt_move));
+  rates = (double *)realloc(rates, n * sizeof(double));
+  tree  = (double *)realloc(tree, (n + 1) * sizeof(double));
+  assert((moves != NULL) && (rates != NULL) && (tree != NULL));
+
+  /* link new slots into list of unused slots */
+  for (k = n - 1; k >= capacity; k--) {
+    moves[k].group = -1;
+    moves[k].next = free_slot;
+    rates[k] = 0.;
+    free_slot = k;
+  }
+  capacity = n;
+  rebuild_tree();
+}
+
+/* compute Fenwick tree from scratch, gets rid of accumulated rounding errors */
+static void rebuild_tree(void) {
+  int k, parent;
+
+  tree[0] = 0.;
+  for (k = 1; k <= capacity; k++) tree[k] = rates[k - 1];
+  for (k = 1; k <= capacity; k++) {
+    parent = k + (k & -k);
+    if (parent <= capacity) tree[parent] += tree[k];
+  }
+  updates = 0;
+}
+
+/**/
+static void tree_add(int k, double v) {
+  for (k++; k <= capacity; k += k & -k) tree[k] += v;
+  updates++;
+}
+
+/**/
+static double rate_of(int dE) {
+  double E = (double)dE / 100.;
+
+  if (GTV.mc) {
+    /* metropolis rule */
+    if (dE < 0) return 1.;
+    return exp(-(E / RT * GSV.phi));
+  }
+  /* kawasaki rule */
+  return exp(-0.5 * (E / RT * GSV.phi));
+}
+
+/**/
+static void add_move(int g, int i, int j, int dE) {
+  int k;
+
+  if (free_slot < 0) grow_pool();
+  k = free_slot;
+  free_slot = moves[k].next;
+
+  moves[k].i = (short)i;
+  moves[k].j = (short)j;
+  moves[k].dE = dE;
+  moves[k].group = g;
+  moves[k].next = groups[g];
+  groups[g] = k;
+
+  rates[k] = rate_of(dE);
+  tree_add(k, rates[k]);
+
+  num_moves++;
+  if (dE < 0) num_down++;
+  else if (dE == 0) num_flat++;
+}
+
+/**/
+static void clear_group(int g) {
+  int k, next;
+
+  for (k = groups[g]; k >= 0; k = next) {
+    next = moves[k].next;
+    tree_add(k, -rates[k]);
+    rates[k] = 0.;
+    num_moves--;
+    if (moves[k].dE < 0) num_down--;
+    else if (moves[k].dE == 0) num_flat--;
+    moves[k].group = -1;
+    moves[k].next = free_slot;
+    free_slot = k;
+  }
+  groups[g] = -1;
+
+  if (updates > capacity) rebuild_tree();
+}
+
+/* opening base of the pair enclosing k < l, 0 for the exterior loop */
+static int parent_of(int k, int l) {
+  int j;
+
+  for (j = l + 1; j <= length; j++) {
+    if (pt[j] == 0) continue;
+    if (pt[j] < k) return pt[j];
+    j = pt[j]; /* skip substructure */
+  }
+  return 0;
+}
+
+/* store the unpaired bases of the loop closed by p in u */
+static int collect_loop(int p, int *u) {
+  int k, end, n = 0;
+
+  end = (p == 0) ? length : pt[p] - 1;
+  for (k = p + 1; k <= end; k++) {
+    if (pt[k] == 0) u[n++] = k;
+    else k = pt[k];
+  }
+  return n;
+}
+
+/*
+  can i and j form a base pair, same as the ptype array which the
+  fold compounds of worker threads (VRNA_OPTION_EVAL_ONLY) lack
+*/
+#define CAN_PAIR(I, J) \
+  ((abs((J) - (I)) > GAV.vc->params->model_details.min_loop_size) && \
+   GAV.vc->params->model_details.pair[GAV.vc->sequence_encoding2[(I)]] \
+                                     [GAV.vc->sequence_encoding2[(J)]])
+
+/* energy contribution of stem k,l in the exterior loop */
+static int ext_stem(int k, int l) {
+  vrna_param_t *P = GAV.vc->params;
+  short *S = GAV.vc->sequence_encoding2;
+  short *S1 = GAV.vc->sequence_encoding;
+  int type, n5d = -1, n3d = -1;
+
+  type = P->model_details.pair[S[k]][S[l]];
+  if (type == 0) type = 7;
+  if (P->model_details.dangles == 2) {
+    if (k > 1) n5d = S1[k - 1];
+    if (l < length) n3d = S1[l + 1];
+  }
+  return vrna_E_ext_stem(type, n5d, n3d, P);
+}
+
+/* energy contribution of stem k,l in a multiloop */
+static int ml_stem(int k, int l) {
+  vrna_param_t *P = GAV.vc->params;
+  short *S = GAV.vc->sequence_encoding2;
+  short *S1 = GAV.vc->sequence_encoding;
+  int type;
+
+  type = P->model_details.pair[S[k]][S[l]];
+  if (type == 0) type = 7;
+  if (P->model_details.dangles == 2)
+    return E_MLstem(type, S1[k - 1], S1[l + 1], P);
+  return E_MLstem(type, -1, -1, P);
+}
+
+/* energy contribution of the closing pair k,l of a multiloop */
+static int ml_closing(int k, int l) {
+  vrna_param_t *P = GAV.vc->params;
+  short *S = GAV.vc->sequence_encoding2;
+  short *S1 = GAV.vc->sequence_encoding;
+  int type;
+
+  type = P->model_details.pair[S[l]][S[k]];
+  if (type == 0) type = 7;
+  if (P->model_details.dangles == 2)
+    return P->MLclosing + E_MLstem(type, S1[l - 1], S1[k + 1], P);
+  return P->MLclosing + E_MLstem(type, -1, -1, P);
+}
+
+/* energy contribution of u unpaired bases in a multiloop */
+static int ml_unpaired(int u) {
+  vrna_param_t *P = GAV.vc->params;
+
+  if (P->model_details.logML && (u > 6))
+    return 6 * P->MLbase + (int)(P->lxc * log((double)u / 6.));
+  return u * P->MLbase;
+}
+
+/* all structures with one additional base pair in loop p */
+static void gen_insertions(int p) {
+  int a, b, k, l, n, E_old, dE;
+
+  E_old = vrna_eval_loop_pt(GAV.vc, p, pt);
+
+  if ((GTV.dangle == 0) || (GTV.dangle == 2)) {
+    /*
+      without dangles, or with double dangles, exterior and multiloop
+      energies are sums over independent stem contributions. So the
+      energies of both loops after an insertion follow from the stems
+      and unpaired bases that end up inside and outside the new pair
+    */
+    int q, x, c = 0, u = 0, e_out = 0, e_ml = 0, e, u_in, E_in, E_out;
+
+    q = (p == 0) ? length + 1 : pt[p];
+    for (x = p + 1; x < q; x++) {
+      if (pt[x] == 0) {
+        stems_left[x] = c;
+        unpaired_left[x] = u++;
+        energy_left[x] = e_out;
+        ml_left[x] = e_ml;
+      }
+      else {
+        loop_v[c++] = x;
+        e_out += (p == 0) ? ext_stem(x, pt[x]) : ml_stem(x, pt[x]);
+        e_ml += ml_stem(x, pt[x]);
+        x = pt[x];
+      }
+    }
+
+    n = collect_loop(p, loop_u);
+    for (a = 0; a < n; a++) {
+      k = loop_u[a];
+      for (b = a + 1; b < n; b++) {
+        l = loop_u[b];
+        if (!CAN_PAIR(k, l)) continue;
+
+        /* the loop closed by the new pair */
+        e = stems_left[l] - stems_left[k];
+        u_in = unpaired_left[l] - unpaired_left[k] - 1;
+        if (e == 0) {
+          E_in = vrna_eval_hp_loop(GAV.vc, k, l);
+        }
+        else if (e == 1) {
+          x = loop_v[stems_left[k]];
+          E_in = vrna_eval_int_loop(GAV.vc, k, l, x, pt[x]);
+        }
+        else {
+          E_in = ml_closing(k, l) + ml_left[l] - ml_left[k] + ml_unpaired(u_in);
+        }
+
+        /* the loop enclosing the new pair */
+        if (p == 0) {
+          E_out = E_old + ext_stem(k, l) - (energy_left[l] - energy_left[k]);
+        }
+        else if (c - e == 0) {
+          E_out = vrna_eval_int_loop(GAV.vc, p, q, k, l);
+        }
+        else {
+          E_out = ml_closing(p, q) + e_ml - (ml_left[l] - ml_left[k]) + ml_stem(k, l)
+                  + ml_unpaired(u - u_in - 2);
+        }
+
+        dE = E_in + E_out - E_old;
+        add_move(INS(p), k, l, dE);
+      }
+    }
+    return;
+  }
+
+  n = collect_loop(p, loop_u);
+  for (a = 0; a < n; a++) {
+    k = loop_u[a];
+    for (b = a + 1; b < n; b++) {
+      l = loop_u[b];
+      if (!CAN_PAIR(k, l)) continue;
+      pt[k] = l;
+      pt[l] = k;
+      dE = vrna_eval_loop_pt(GAV.vc, k, pt) + vrna_eval_loop_pt(GAV.vc, p, pt) - E_old;
+      pt[k] = pt[l] = 0;
+      add_move(INS(p), k, l, dE);
+    }
+  }
+}
+
+/* all structures where pair p is deleted or shifted */
+static void gen_stem(int p) {
+  int q, L, a, b, k, x, n, E_old, dE, side;
+
+  q = pt[p];
+  L = parent_of(p, q);
+  E_old = vrna_eval_loop_pt(GAV.vc, p, pt) + vrna_eval_loop_pt(GAV.vc, L, pt);
+
+  /* delete */
+  pt[p] = pt[q] = 0;
+  dE = vrna_eval_loop_pt(GAV.vc, L, pt) - E_old;
+  pt[p] = q;
+  pt[q] = p;
+  add_move(STEM(p), -p, -q, dE);
+
+  if (GTV.noShift) return;
+
+  /* shift p or q to an unpaired base in the interior or the exterior of p */
+  for (side = 0; side < 2; side++) {
+    n = (side == 0) ? collect_loop(p, loop_v) : collect_loop(L, loop_v);
+    for (x = 0; x < n; x++) {
+      k = loop_v[x];
+      /* p remains, q shifts to k, or q remains, p shifts to k */
+      for (b = 0; b < 2; b++) {
+        int keep = (b == 0) ? p : q;
+        int gone = (b == 0) ? q : p;
+        if (!CAN_PAIR(keep, k)) continue;
+        pt[gone] = 0;
+        pt[keep] = k;
+        pt[k] = keep;
+        a = (keep < k) ? keep : k;
+        dE = vrna_eval_loop_pt(GAV.vc, a, pt) + vrna_eval_loop_pt(GAV.vc, L, pt) - E_old;
+        pt[k] = 0;
+        pt[p] = q;
+        pt[q] = p;
+        if (b == 0) add_move(STEM(p), p, -k, dE);
+        else add_move(STEM(p), -k, q, dE);
+      }
+    }
+  }
+}
+
+/* moves that lead to the same structure get the same key (shifts may be given in either order) */
+static long move_key(int i, int j) {
+  if ((i > 0) != (j > 0)) {
+    int keep = (i > 0) ? i : j;
+    int new = (i > 0) ? -j : -i;
+    i = keep;
+    j = -new;
+  }
+  return (long)(i + 32768) * 65536 + (j + 32768);
+}
+
+/**/
+static int cmp_key(const void *a, const void *b) {
+  long x = *(const long *)a, y = *(const long *)b;
+
+  return (x > y) - (x < y);
+}
+
+/* re-generate the moves that depend on the loop closed by p */
+static void refresh_loop(int p, int with_stem) {
+  int k, end;
+
+  clear_group(INS(p));
+  gen_insertions(p);
+  if ((p > 0) && with_stem) {
+    clear_group(STEM(p));
+    gen_stem(p);
+  }
+
+  /* deletion and shifts of enclosed pairs depend on this loop */
+  end = (p == 0) ? length : pt[p] - 1;
+  for (k = p + 1; k <= end; k++) {
+    if (pt[k] > k) {
+      clear_group(STEM(k));
+      gen_stem(k);
+      k = pt[k];
+    }
+  }
+}
+
+#else
+
+int rt_supported(void) { return 0; }
+void rt_ini(void) { }
+void rt_clean_up(void) { }
+int rt_check(void) { return 0; }
+int rt_num_moves(void) { return 0; }
+int rt_lmin(void) { return 1; }
+double rt_flux(void) { return 0.; }
+float rt_energy(void) { return GSV.currE; }
+void rt_select(double r, short *i, short *j) { *i = *j = 0; }
+void rt_apply(void) { }
+
+#endif
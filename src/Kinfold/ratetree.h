@@ -0,0 +1,18 @@
+#ifndef RATETREE_H
+#define RATETREE_H
+
+/* used in main.c */
+extern int rt_supported(void);
+extern void rt_ini(void);
+extern void rt_clean_up(void);
+extern int rt_check(void);
+
+/* used in nachbar.c */
+extern int rt_num_moves(void);
+extern int rt_lmin(void);
+extern double rt_flux(void);
+extern float rt_energy(void);
+extern void rt_select(double r, short *i, short *j);
+extern void rt_apply(void);
+
+#endif
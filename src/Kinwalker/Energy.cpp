@@ -17,7 +17,7 @@ extern "C" {
 }
 extern short * S;
 extern short * S1;
-extern short * pair_table;
+extern thread_local short * pair_table;
 
 static float
 (*EnergyModel)(std::string sequence, std::string structure) = NULL;
@@ -4,12 +4,15 @@
 */
 
 #include <cstring>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 #include "MorganHiggs.h"
 #define BP_ADD_CONST 10000
 using std::cout;
 using std::endl;
 
-extern short * pair_table;
+extern thread_local short * pair_table;
 
 extern "C" {
 #include "energy_const.h" /* defines INF */
@@ -423,9 +426,9 @@ function.
 larger one of the potentially two creatd minuscule stacks form base pair removal
 */
 
-Stack createdMinusculeStack1;
+thread_local Stack createdMinusculeStack1;
 
-Stack createdMinusculeStack2;
+thread_local Stack createdMinusculeStack2;
 
 
 
@@ -1215,6 +1218,84 @@ if(MHS_debug)   cout<<"yields pathTrail "+ PrintCombination(pathTrail)+"\n";
 }
 
 
+void PartialPath::WalkCombinations(long int first,long int last,const Stack & originalMinusculeStack,double & best_saddle,long int & best_idx){
+  bool debug=false;
+  for (long int j=first; j<last; j++) {
+    minusculeStack=originalMinusculeStack;
+
+    if(MHS_debug)cout<<"combination "+Str((int)j)+" out of "+Str((int)last)<<endl;
+    std::vector<int> combination = GetCombination(conflict_group.size(),lookahead,j);
+    double saddle_energy=WalkPartialPath(combination);
+    if(MHS_debug)cout<<"obtains saddle "+Str(saddle_energy)+"\n";
+    if(saddle_energy<best_saddle) {
+      if(debug) cout<<"UpdateBestPartialPathTrail from current Trail of size "+Str((int)currentPartialPathTrail.size())+"\n";
+      best_saddle=saddle_energy;
+      best_idx=j;
+      bestPartialPathTrail=currentPartialPathTrail;
+    }
+    UndoPartialPathTrail();
+  }
+}
+
+
+#ifdef _OPENMP
+/**
+Gives the calling thread its own copy of the pair table shared_pair_table for the lifetime of the object,
+so that combinations can be walked concurrently.
+*/
+class PrivatePairTable{
+public:
+  PrivatePairTable(const short *shared_pair_table){
+    saved_pair_table=pair_table;
+    int length=shared_pair_table[0];
+    pair_table=new short[length+2];
+    memcpy(pair_table,shared_pair_table,(length+2)*sizeof(short));
+  }
+  ~PrivatePairTable(){
+    delete [] pair_table;
+    pair_table=saved_pair_table;
+  }
+private:
+  short *saved_pair_table;
+};
+
+
+void PartialPath::WalkCombinationsParallel(long int n_combinations,const Stack & originalMinusculeStack,double & best_saddle,long int & best_idx){
+  //the trail may already hold the removal of surplus minuscule stacks (see FindOptimalPath), which only the first combination
+  //is walked with. Every thread therefore starts from the state before combination 0 and undoes that trail if it starts later.
+  const short *shared_pair_table=pair_table;
+  int nthreads=omp_get_max_threads();
+  std::vector<double> saddles(nthreads,best_saddle);
+  std::vector<long int> indices(nthreads,-1);
+  std::vector<std::vector<int> > trails(nthreads);
+
+  #pragma omp parallel num_threads(nthreads)
+  {
+    int tid=omp_get_thread_num();
+    int nt=omp_get_num_threads();
+    long int first=n_combinations*tid/nt;
+    long int last=n_combinations*(tid+1)/nt;
+    PrivatePairTable own_pair_table(shared_pair_table);
+
+    PartialPath walker(*this);
+    if(first>0) walker.UndoPartialPathTrail();
+    walker.WalkCombinations(first,last,originalMinusculeStack,saddles[tid],indices[tid]);
+    trails[tid].swap(walker.bestPartialPathTrail);
+  }
+
+  //threads hold consecutive ranges, so taking the first strictly lower saddle reproduces the sequential choice
+  for(int i=0;i<nthreads;i++){
+    if(indices[i]==-1 || saddles[i]>=best_saddle) continue;
+    best_saddle=saddles[i];
+    best_idx=indices[i];
+    bestPartialPathTrail.swap(trails[i]);
+  }
+  //leave pair_table and the trail as the sequential walk does
+  UndoPartialPathTrail();
+}
+#endif
+
+
 void PartialPath::FindOptimalPath(std::vector<std::pair<double,std::string> >& structures){
   bool debug=false;
   if(MHS_debug)cout<<"FindOptimalPath\n";
@@ -1255,20 +1336,14 @@ void PartialPath::FindOptimalPath(std::vector<std::pair<double,std::string> >& s
 
    //  cout<<"Treat conflict group of size"+Str((int)conflict_group.size())+"\n";
     //try all combinations and record combination idx with the best energy.Keep track of saddle point for the entire function all, that is throughout all groups.
-    for (long int j=0; j<n_combinations; j++) {
-      minusculeStack=originalMinusculeStack;
-
-      if(MHS_debug)cout<<"combination "+Str((int)j)+" out of "+Str((int)n_combinations)<<endl;
-      combination = GetCombination(conflict_group.size(),lookahead,j);
-      double saddle_energy=WalkPartialPath(combination);
-        if(MHS_debug)cout<<"obtains saddle "+Str(saddle_energy)+"\n";
-      if(saddle_energy<best_combination_saddle_energy) {
-        if(debug) cout<<"UpdateBestPartialPathTrail from current Trail of size "+Str((int)currentPartialPathTrail.size())+"\n";
-        best_combination_saddle_energy=saddle_energy;
-        bestPartialPathTrail=currentPartialPathTrail;
-      }
-      UndoPartialPathTrail();
-    }
+    long int best_combination=-1;
+#ifdef _OPENMP
+    if(!MHS_debug && omp_get_max_threads()>1 && n_combinations>=2*omp_get_max_threads())
+      WalkCombinationsParallel(n_combinations,originalMinusculeStack,best_combination_saddle_energy,best_combination);
+    else
+#endif
+      WalkCombinations(0,n_combinations,originalMinusculeStack,best_combination_saddle_energy,best_combination);
+    if(MHS_debug)cout<<"best combination "+Str((int)best_combination)+" with saddle "+Str(best_combination_saddle_energy)+"\n";
     if(debug) cout<<"AddBestPartialPathTrail of size "+Str((int)bestPartialPathTrail.size())+" ToPathTrail"<<std::endl;
     //updates pair_table
     AddBestPartialPathTrailToPathTrail();
@@ -1728,6 +1803,38 @@ const std::vector<std::pair<int,int> > & only_in_base_pairs2){
  
   std::vector<int> combination= std::vector<int>();  
   std::vector<std::pair<double,std::string> > partial_path=std::vector<std::pair<double,std::string> > ();
+#ifdef _OPENMP
+  //each thread walks a consecutive range of combinations on its own pair_table, taking the first strictly lower
+  //saddle of the ranges in order then yields the same combination as the sequential loop below
+  if(omp_get_max_threads()>1 && n_combinations>=2*omp_get_max_threads()){
+    const short *shared_pair_table=pair_table;
+    int nthreads=omp_get_max_threads();
+    std::vector<double> saddles(nthreads,INF);
+    std::vector<std::vector<int> > combinations(nthreads);
+
+    #pragma omp parallel num_threads(nthreads) private(combination,partial_path)
+    {
+      int tid=omp_get_thread_num();
+      int nt=omp_get_num_threads();
+      PrivatePairTable own_pair_table(shared_pair_table);
+      for (long int j=n_combinations*tid/nt; j<n_combinations*(tid+1)/nt; j++) {
+        combination = GetCombination(conflict_group.size(),lookahead,j);
+        DoPartialPath(partial_path,combination,sequence,backtrack_base,conflict_group,only_in_base_pairs,only_in_base_pairs2);
+        if (partial_path.back().first < saddles[tid]) {
+          saddles[tid]=partial_path.back().first;
+          combinations[tid]=combination;
+        }
+      }
+    }
+    for(int i=0;i<nthreads;i++){
+      if (saddles[i] < best_combination_saddle_energy) {
+        best_combination_saddle_energy = saddles[i];
+        best_combination.swap(combinations[i]);
+      }
+    }
+    return;
+  }
+#endif
   //try all combinations and record combination idx with the best energy.Keep track of saddle point for the entire function all, that is throughout all groups.
   for (long int j=0; j<n_combinations; j++) {
     combination = GetCombination(conflict_group.size(),lookahead,j);
@@ -2150,7 +2257,7 @@ short *S;
 //extern 
 short *S1;
 //extern 
-short *pair_table;
+thread_local short *pair_table;
 // End of file
 int main(int argc, char *argv[]) {
 
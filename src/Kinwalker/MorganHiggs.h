@@ -182,6 +182,19 @@ public:
 
   double WalkPartialPath( std::vector<int> combination );
 
+  /**
+      Walks the combinations with indices first,...,last-1 of the current conflict group, each starting from
+      originalMinusculeStack, and records the one with the lowest saddle (the earliest in case of ties) in
+      best_saddle, best_idx and bestPartialPathTrail. pair_table is restored after each combination.
+  */
+  void WalkCombinations(long int first,long int last,const Stack & originalMinusculeStack,double & best_saddle,long int & best_idx);
+
+  /**
+      Same as WalkCombinations(0,n_combinations,...), but distributes the combinations over the OpenMP threads.
+      Each thread walks its share on a private copy of this object and of pair_table.
+  */
+  void WalkCombinationsParallel(long int n_combinations,const Stack & originalMinusculeStack,double & best_saddle,long int & best_idx);
+
   /**
      adds/removes all elements in the conflit group at the given index thus constructing
 a partial path
@@ -55,10 +55,12 @@ double Node::time;
 OptionS* Node::OptS=NULL;
 std::vector<std::string>  Node::trajectory= std::vector<std::string>();
 std::vector<std::pair<double,std::string> > Node::path=std::vector<std::pair<double,std::string> > ();
+std::map<std::string,std::vector<std::pair<double,std::string> > > Node::path_cache;
 
 short *S;
 short *S1;
-short *pair_table;
+//per thread, so that MorganHiggs can walk combinations on private copies
+thread_local short *pair_table;
 
 
 
@@ -281,10 +283,60 @@ and the new structure as the second element.
 
 
 
+/**
+Length of the sequence prefix that the energies of all structures on a path from the front to target depend on.
+Only base pairs of either structure occur on the path, so unpaired trailing bases do not contribute without
+dangles, and only the one next to the last pair does with dangles=2.
+*/
+int Node::PathKeyLength(const std::string & target){
+  int t=Node::transcribed;
+  if(OptS->dangle!=0 && OptS->dangle!=2) return t;
+  int last_paired=0;
+  for(int i=t;i>0;i--){
+    if(Node::front_structure[i-1]!='.' || target[i-1]!='.'){
+      last_paired=i;
+      break;
+    }
+  }
+  if(OptS->dangle==0) return last_paired;
+  return std::min(t,last_paired+1);
+}
+
+/**
+The MorganHiggs heuristics terminate their path with a dummy entry holding the index of the first structure
+above the energy barrier. Recalculate it for the current barrier when a path is taken from the cache.
+*/
+void Node::SetPathInterrupt(){
+  double saddlE=Node::front_energy+Node::energy_barrier;
+  //'M' points behind that structure, 'S' at it
+  int offset=(OptS->barrier_heuristic=='M') ? 1 : 0;
+  int last=(int)Node::path.size()-1;
+  int interrupt=last;
+  for(int k=1;k<last;k++){
+    if(Node::path[k].first>saddlE){
+      interrupt=k+offset;
+      break;
+    }
+  }
+  Node::path.back().first=(double)interrupt;
+}
+
 void Node::CalculateFoldingPath(Node* extremum,std::string integrated_structure){
   if(verbose>=3) std::cout<<"Folding "<<OptS->barrier_heuristic<<std::endl;
     MakePairTableFromFrontStructure();
-    if(OptS->barrier_heuristic=='M')
+    //FindExtremum asks for the same pairs of front and target after every transcription step, so paths are cached
+    //for the prefix of the sequence their energies actually depend on
+    int t=Node::transcribed;
+    int key_length=PathKeyLength(integrated_structure);
+    std::string key=OptS->barrier_heuristic+Node::front_structure.substr(0,key_length)+integrated_structure.substr(0,key_length);
+    std::map<std::string,std::vector<std::pair<double,std::string> > >::iterator cached=path_cache.find(key);
+    if(cached!=path_cache.end()){
+      Node::path=cached->second;
+      //the last element is the dummy element
+      for(size_t i=0;i+1<Node::path.size();i++) Node::path[i].second.append(t-key_length,'.');
+      if(OptS->barrier_heuristic=='M' || OptS->barrier_heuristic=='S') SetPathInterrupt();
+    }
+    else if(OptS->barrier_heuristic=='M')
       GetMorganHiggsPath(integrated_structure);
     else if(OptS->barrier_heuristic=='S') 
       GetMorganHiggsStudlaPath(integrated_structure);
@@ -293,7 +345,6 @@ void Node::CalculateFoldingPath(Node* extremum,std::string integrated_structure)
       int p_len = 0;
       double maxE = -INF;//std::numeric_limits<double>::max();
       int maxE_idx = 0;
-      int t = Node::transcribed;
       std::vector<std::pair<double,std::string> > v;
       p = get_path(const_cast<char*>(sequence.substr(0,t).c_str()),
                    const_cast<char*>(Node::front_structure.c_str()),
@@ -315,6 +366,11 @@ void Node::CalculateFoldingPath(Node* extremum,std::string integrated_structure)
       Node::path = v;
 
     }
+    if(cached==path_cache.end()){
+      std::vector<std::pair<double,std::string> > & entry=path_cache[key];
+      entry=Node::path;
+      for(size_t i=0;i+1<entry.size();i++) entry[i].second.resize(key_length);
+    }
 
     if(verbose>=3) {
       Cout(Node::front_structure+"\n");
@@ -503,6 +559,8 @@ Node::AddToFront(std::string new_front_structure,double barrier){
         }
         front_extrema.push_back(this);
         Node::front_structure=new_front_structure;
+        //the front energy only decreases, so paths starting from the old front are never asked for again
+        Node::path_cache.clear();
         Node::front_energy=new_front_energy;
 
         if(barrier>0.0) Node::IncreaseTime(TimePassedFolding(barrier));
@@ -27,6 +27,7 @@
 #include <string>
 #include <cstring>
 #include <vector>
+#include <map>
 
 
 extern "C" {
@@ -53,6 +54,12 @@ class Node {
  public:
 static  std::vector<std::pair<double,std::string> > path;
 
+  /*
+folding paths from the current front, keyed by heuristic, front and target structure on the
+prefix of length PathKeyLength(). Cleared whenever the front is extended.
+  */
+  static std::map<std::string,std::vector<std::pair<double,std::string> > > path_cache;
+
 
   /*
 set of time and structure pairs
@@ -182,6 +189,8 @@ set of time and structure pairs
 
 
     static void GetMorganHiggsStudlaPath(std::string target);
+    static void SetPathInterrupt();
+    static int PathKeyLength(const std::string & target);
 
     static void CalculatePathAndSaddle(Node* extremum,std::string integrated_structure,std::pair<double,std::string> & saddle,std::pair<double,std::string> & final_structure);
 
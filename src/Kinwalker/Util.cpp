@@ -1,6 +1,6 @@
 #include "Util.h"
 
-extern short *pair_table;
+extern thread_local short *pair_table;
 //extern void  *space(unsigned int size);
 /*@exits@*/
 //extern void   nrerror(const char message[]);
@@ -4,6 +4,9 @@
 */
 #include "Node.h"
 #include <ctime>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 extern "C" {
 #include "fold.h"
@@ -27,6 +30,11 @@ int main (int argc, char *argv[]) {
   // Process commandline options  
   OptionS* OptS;
   OptS = decodeCML(argc, argv);
+#ifdef _OPENMP
+  omp_set_num_threads(OptS->threads>0 ? OptS->threads : omp_get_num_procs());
+#else
+  if(OptS->threads!=1) std::cerr<<"WARNING: kinwalker was compiled without OpenMP support, --threads is ignored\n";
+#endif
  
   clock_t start,finish;
   double time;
@@ -31,6 +31,7 @@ static struct option const long_options[] =
 
   {"maxkeep",   required_argument, 0,   0},  
   {"noLonelyPairs",   required_argument, 0,   0},
+  {"threads",   required_argument, 0,   0},
   {"transcribed",   required_argument, 0,   0},
   {"transcription_rate",   required_argument, 0,   0},
   {"windowsize",   required_argument, 0,   0},  
@@ -98,10 +99,11 @@ usage(int status)
   fprintf(stderr,
           "--maxkeep            Breadth of breadth first seerch in barrier_heuristic='B'. Default: >%d<\n"
           "--nolonely           Value of noLonelyPairs as in ViennaRNA. Default: >%d<\n"
+          "--threads            #threads evaluating the combinations of a conflict group in MorganHiggs, 0= all processors. Default: >%d<\n"
           "--transcribed        #bases initially transcribed, <0 means all is transcribed. Default: >%d<)\n"
           "--transcription_rate #bases transcribed per second. Default: >%f<)\n"
           "--windowsize         Max size of substructures considered for folding events during transcription, 0= all are considered. Default: >%d<)\n",
-          OptS.maxkeep,OptS.noLonelyPairs,OptS.transcribed, OptS.transcription_rate,OptS.windowsize);
+          OptS.maxkeep,OptS.noLonelyPairs,OptS.threads,OptS.transcribed, OptS.transcription_rate,OptS.windowsize);
   exit (status);
 }
 
@@ -143,6 +145,7 @@ initializeOptions (char *name) {
 
   OptS.maxkeep = 1;
   OptS.noLonelyPairs=2;
+  OptS.threads=1;
   OptS.transcribed=1;
   OptS.transcription_rate=200.0;
   OptS.windowsize=0;
@@ -226,6 +229,14 @@ processOptions(int argc, char *argv[]) {
 	}
 	else { OptS.noLonelyPairs = tmp; }
       }
+      if ( strcmp(long_options[option_index].name, "threads" ) == 0 ) {
+	int tmp;
+	if ( sscanf(optarg, "%d", &tmp) == 0 || tmp < 0 ) {
+	  warn ("Option requires argument: INT >= 0");
+	  usage (EXIT_FAILURE);
+	}
+	else { OptS.threads = tmp; }
+      }
       if ( strcmp(long_options[option_index].name, "transcribed") == 0 ) {
 	int tmp;
 	if ( sscanf(optarg, "%d", &tmp ) == 0 ) {
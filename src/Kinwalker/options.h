@@ -33,6 +33,7 @@ typedef struct _Options {
 
   int maxkeep;
   int noLonelyPairs;
+  int threads;
   int transcribed;
   float transcription_rate;
   int windowsize;
@@ -161,6 +161,7 @@ template<class R,class L,class AL>
 class AlignmentLinear : public Alignment<R,L,AL> {
 	private:
 		TAD_DP_TableLinear<R> *mtrx_;
+		bool ownMtrx_;                 // false if the table was passed to the constructor
     const Algebra<R,L> *alg_;
     const RNA_Algebra<R,L> *rnaAlg_;
 
@@ -171,8 +172,10 @@ class AlignmentLinear : public Alignment<R,L,AL> {
 
 		void print(std::ostream &out) const { out << "linear ali's matrix" << std::endl << *mtrx_; };
 
-    AlignmentLinear(const Forest<L> *f1, const Forest<L> *f2,const Algebra<R,L> &alg, const bool topdown, const bool anchored, bool local, bool printBacktrace, bool speedup=SPEEDUP);
-    AlignmentLinear(const Forest<L> *f1, const Forest<L> *f2,const RNA_Algebra<R,L> &rnaAlg, const bool topdown, const bool anchored, bool local, bool printBacktrace, bool speedup=SPEEDUP);
+		// if table is given, it is reset and used instead of allocating a new one,
+		// it must not be used by another alignment while this one exists
+    AlignmentLinear(const Forest<L> *f1, const Forest<L> *f2,const Algebra<R,L> &alg, const bool topdown, const bool anchored, bool local, bool printBacktrace, bool speedup=SPEEDUP, TAD_DP_TableLinear<R> *table=NULL);
+    AlignmentLinear(const Forest<L> *f1, const Forest<L> *f2,const RNA_Algebra<R,L> &rnaAlg, const bool topdown, const bool anchored, bool local, bool printBacktrace, bool speedup=SPEEDUP, TAD_DP_TableLinear<R> *table=NULL);
     void makeFirstCell();
     void makeFirstRow();
     void makeFirstCol();
@@ -204,7 +207,10 @@ class AlignmentLinear : public Alignment<R,L,AL> {
 		bool computed(const unsigned long i, const unsigned long j) const { return mtrx_->computed(i,j); }; 
 		void setComputed(const unsigned long i, const unsigned long j) { mtrx_->setComputed(i,j); }; 
 
-    virtual ~AlignmentLinear() {};
+    virtual ~AlignmentLinear() {
+			if (ownMtrx_)
+				delete mtrx_;
+		};
 
     // virtual, for replacepair
     virtual inline R computeReplacementScore(CSFPair p, std::string & backtrack_as) const {
@@ -474,6 +480,7 @@ template<class R,class L,class AL>
 class AlignmentAffine : public Alignment<R,L,AL> {
 	private:
 		TAD_DP_TableAffine<R> *mtrx_;
+		bool ownMtrx_;                 // false if the table was passed to the constructor
     const AlgebraAffine<R,L> *alg_;
     const RNA_AlgebraAffine<R,L> *rnaAlg_;
 		int localOptimumTable_;
@@ -494,10 +501,12 @@ class AlignmentAffine : public Alignment<R,L,AL> {
 
 		void print(std::ostream &out) const { out << "affine ali's matrix" << std::endl << *mtrx_; };
 
+		// if table is given, it is reset and used instead of allocating a new one,
+		// it must not be used by another alignment while this one exists
     AlignmentAffine(const Forest<L> *f1, const Forest<L> *f2,const AlgebraAffine<R,L> &alg, 
-				const bool topdown, const bool anchored, bool local, bool printBacktrace, bool speedup=SPEEDUP);
+				const bool topdown, const bool anchored, bool local, bool printBacktrace, bool speedup=SPEEDUP, TAD_DP_TableAffine<R> *table=NULL);
     AlignmentAffine(const Forest<L> *f1, const Forest<L> *f2,const RNA_AlgebraAffine<R,L> &rnaAlg, 
-				const bool topdown, const bool anchored, bool local, bool printBacktrace, bool speedup=SPEEDUP);
+				const bool topdown, const bool anchored, bool local, bool printBacktrace, bool speedup=SPEEDUP, TAD_DP_TableAffine<R> *table=NULL);
     void makeFirstCell();
     void makeFirstRow();
     void makeFirstCol();
@@ -530,7 +539,10 @@ class AlignmentAffine : public Alignment<R,L,AL> {
 
 		bool computed(const unsigned long i, const unsigned long j) const { return mtrx_->computed(i,j); }; 
 		void setComputed(const unsigned long i, const unsigned long j) { mtrx_->setComputed(i,j); }; 
-    virtual ~AlignmentAffine() {};
+    virtual ~AlignmentAffine() {
+			if (ownMtrx_)
+				delete mtrx_;
+		};
 };
 
 #endif
@@ -144,12 +144,18 @@ void Alignment<R, L, AL>::recursiveFill(CSFPair p, bool RNA, bool speedup) {
 
 
 template<class R,class L,class AL>
-AlignmentLinear<R,L,AL>::AlignmentLinear(const Forest<L> *f1, const Forest<L> *f2, const Algebra<R,L> &alg, const bool topdown, const bool anchored, const bool local, const bool printBacktrace, bool speedup)
-        : Alignment<R,L,AL>(f1,f2,topdown,anchored,printBacktrace) {
+AlignmentLinear<R,L,AL>::AlignmentLinear(const Forest<L> *f1, const Forest<L> *f2, const Algebra<R,L> &alg, const bool topdown, const bool anchored, const bool local, const bool printBacktrace, bool speedup, TAD_DP_TableLinear<R> *table)
+        : Alignment<R,L,AL>(f1,f2,topdown,anchored,printBacktrace),
+				ownMtrx_(table == NULL) {
 
     // alloc space for the score matrix, backtrace structure,
     // and , if wanted, for the calculation-order-matrix
-		mtrx_ = new TAD_DP_TableLinear<R>(this->f1_->getNumCSFs(),this->f2_->getNumCSFs(),alg.worst_score());
+		if (table) {
+			mtrx_ = table;
+			mtrx_->reset(this->f1_->getNumCSFs(),this->f2_->getNumCSFs(),alg.worst_score());
+		}
+		else
+			mtrx_ = new TAD_DP_TableLinear<R>(this->f1_->getNumCSFs(),this->f2_->getNumCSFs(),alg.worst_score());
     // initialize variables
     alg_ = &alg;
     rnaAlg_ = NULL;
@@ -165,12 +171,18 @@ AlignmentLinear<R,L,AL>::AlignmentLinear(const Forest<L> *f1, const Forest<L> *f
 
 // constructor for RNA alignments
 template<class R,class L,class AL>
-AlignmentLinear<R,L,AL>::AlignmentLinear(const Forest<L> *f1, const Forest<L> *f2, const RNA_Algebra<R,L> &rnaAlg, const bool topdown, const bool anchored, const bool local, const bool printBacktrace, bool speedup)
-        : Alignment<R,L,AL>(f1,f2,topdown,anchored,printBacktrace) {
+AlignmentLinear<R,L,AL>::AlignmentLinear(const Forest<L> *f1, const Forest<L> *f2, const RNA_Algebra<R,L> &rnaAlg, const bool topdown, const bool anchored, const bool local, const bool printBacktrace, bool speedup, TAD_DP_TableLinear<R> *table)
+        : Alignment<R,L,AL>(f1,f2,topdown,anchored,printBacktrace),
+				ownMtrx_(table == NULL) {
 
     // alloc space for the score matrix, backtrace structure and,
     // if wanted, for the calculation-order-matrix
-		mtrx_ = new TAD_DP_TableLinear<R>(this->f1_->getNumCSFs(),this->f2_->getNumCSFs(),rnaAlg.worst_score());
+		if (table) {
+			mtrx_ = table;
+			mtrx_->reset(this->f1_->getNumCSFs(),this->f2_->getNumCSFs(),rnaAlg.worst_score());
+		}
+		else
+			mtrx_ = new TAD_DP_TableLinear<R>(this->f1_->getNumCSFs(),this->f2_->getNumCSFs(),rnaAlg.worst_score());
     // initialize variables
     rnaAlg_ = &rnaAlg;
     alg_ = (const Algebra<R,L>*)&rnaAlg;
@@ -906,12 +918,18 @@ found:
 
 template<class R, class L, class AL>
 AlignmentAffine<R,L,AL>::AlignmentAffine(const Forest<L> *f1, const Forest<L> *f2, const AlgebraAffine<R,L> &alg, 
-		const bool topdown, const bool anchored, const bool local, const bool printBacktrace, bool speedup)
-        : Alignment<R,L,AL>(f1, f2, topdown, anchored, printBacktrace) {
+		const bool topdown, const bool anchored, const bool local, const bool printBacktrace, bool speedup, TAD_DP_TableAffine<R> *table)
+        : Alignment<R,L,AL>(f1, f2, topdown, anchored, printBacktrace),
+				ownMtrx_(table == NULL) {
 
     // alloc space for the score matrix, backtrace structure,
     // and , if wanted, for the calculation-order-matrix
-		mtrx_ = new TAD_DP_TableAffine<R>(this->f1_->getNumCSFs(),this->f2_->getNumCSFs(),alg.worst_score());
+		if (table) {
+			mtrx_ = table;
+			mtrx_->reset(this->f1_->getNumCSFs(),this->f2_->getNumCSFs(),alg.worst_score());
+		}
+		else
+			mtrx_ = new TAD_DP_TableAffine<R>(this->f1_->getNumCSFs(),this->f2_->getNumCSFs(),alg.worst_score());
     // initialize variables
     alg_ = &alg;
     rnaAlg_ = NULL;
@@ -928,12 +946,18 @@ AlignmentAffine<R,L,AL>::AlignmentAffine(const Forest<L> *f1, const Forest<L> *f
 // constructor for RNA alignments
 template<class R,class L,class AL>
 AlignmentAffine<R,L,AL>::AlignmentAffine(const Forest<L> *f1, const Forest<L> *f2, const RNA_AlgebraAffine<R,L> &rnaAlg, 
-		const bool topdown, const bool anchored, const bool local, const bool printBacktrace, bool speedup)
-        : Alignment<R,L,AL>(f1, f2, topdown, anchored, printBacktrace) {
+		const bool topdown, const bool anchored, const bool local, const bool printBacktrace, bool speedup, TAD_DP_TableAffine<R> *table)
+        : Alignment<R,L,AL>(f1, f2, topdown, anchored, printBacktrace),
+				ownMtrx_(table == NULL) {
 
     // alloc space for the score matrix, backtrace structure and,
     // if wanted, for the calculation-order-matrix
-		mtrx_ = new TAD_DP_TableAffine<R>(this->f1_->getNumCSFs(),this->f2_->getNumCSFs(),rnaAlg.worst_score());
+		if (table) {
+			mtrx_ = table;
+			mtrx_->reset(this->f1_->getNumCSFs(),this->f2_->getNumCSFs(),rnaAlg.worst_score());
+		}
+		else
+			mtrx_ = new TAD_DP_TableAffine<R>(this->f1_->getNumCSFs(),this->f2_->getNumCSFs(),rnaAlg.worst_score());
     // initialize variables
     rnaAlg_ = &rnaAlg;
     alg_ = (const AlgebraAffine<R,L>*)&rnaAlg;
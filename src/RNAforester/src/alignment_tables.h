@@ -2,6 +2,7 @@
 #define _ALIGNMENT_TABLES_H_
 
 #include <string>
+#include <algorithm>
 #include <cassert>
 #include <iostream>
 #include <fstream>
@@ -9,6 +10,8 @@
 #include <climits>
 
 // superclass of tables, has the row start info
+// a table can be reset() to be re-used for another pair of forests,
+// memory is only reallocated if the new tables do not fit
 
 template<class R> 
 class TAD_DP_Table {
@@ -21,22 +24,23 @@ class TAD_DP_Table {
 		TAD_DP_Table(unsigned long rows, unsigned long cols, R init) 
 			: rows_(rows),
 			cols_(cols),
-			mtrxSize_(rows*cols) {
+			mtrxSize_(rows*cols),
+			rowsCapacity_(rows),
+			mtrxCapacity_(rows*cols) {
 	    rowStart_ = new unsigned long[rows];
-	    rowStart_[0] = 0;
-	    for (unsigned long h = 1; h < rows; h++) {
-	        rowStart_[h] = rowStart_[h - 1] + cols;
-	    }
+	    setRowStart();
 			//TODO if (topdown)
-			computed_ = new bool[mtrxSize_];
+			computed_ = new bool[mtrxSize_]();
 		}
 
-		~TAD_DP_Table(){
+		virtual ~TAD_DP_Table(){
 			delete[] rowStart_;
+			delete[] computed_;
 		}
 
 		virtual void checkSpaceConsumption() = 0;
     virtual void print(std::ostream &s) const = 0;
+		virtual void reset(unsigned long rows, unsigned long cols, R init) = 0;
 
 		// TODO if nicht topdown dann was?
 	  inline bool computed(const unsigned long i, const unsigned long j) const {
@@ -54,9 +58,43 @@ class TAD_DP_Table {
 		unsigned long rows_;
 		unsigned long cols_;
     unsigned long mtrxSize_;
+    unsigned long rowsCapacity_;
+    unsigned long mtrxCapacity_;
     unsigned long *rowStart_;
 		bool *computed_;
 
+		inline void setRowStart() {
+	    rowStart_[0] = 0;
+	    for (unsigned long h = 1; h < rows_; h++) {
+	        rowStart_[h] = rowStart_[h - 1] + cols_;
+	    }
+		}
+
+		// set the new dimensions and clear the computed flags,
+		// returns true if the matrices of the subclass must be reallocated
+		bool resize(unsigned long rows, unsigned long cols) {
+			rows_ = rows;
+			cols_ = cols;
+			mtrxSize_ = rows*cols;
+			checkSpaceConsumption();
+
+			if (rows_ > rowsCapacity_) {
+				delete[] rowStart_;
+				rowStart_ = new unsigned long[rows_];
+				rowsCapacity_ = rows_;
+			}
+			setRowStart();
+
+			bool grow = (mtrxSize_ > mtrxCapacity_);
+			if (grow) {
+				delete[] computed_;
+				computed_ = new bool[mtrxSize_];
+				mtrxCapacity_ = mtrxSize_;
+			}
+			std::fill(computed_, computed_ + mtrxSize_, false);
+			return grow;
+		}
+
 };
 
 
@@ -78,6 +116,13 @@ class TAD_DP_TableLinear : public TAD_DP_Table<R> {
 			delete[] mtrx_;
 		}
 
+		void reset(unsigned long rows, unsigned long cols, R init) {
+			if (this->resize(rows,cols)) {
+				delete[] mtrx_;
+				mtrx_ = new R[this->mtrxSize_];
+			}
+		}
+
 		void checkSpaceConsumption() {
 		    // check for an overflow
 		    if (this->rows_ > ULONG_MAX / this->cols_) {
@@ -150,10 +195,7 @@ class TAD_DP_TableAffine : public TAD_DP_Table<R> {
 				return 0;
     }
 
-	public:
-    TAD_DP_TableAffine(unsigned long rows, unsigned long cols, R init)
-      : TAD_DP_Table<R>(rows,cols,init) {
-      checkSpaceConsumption();
+    void allocMatrices() {
       mtrxS_ = new R[this->mtrxSize_];
       mtrxV_ = new R[this->mtrxSize_];
       mtrxH_ = new R[this->mtrxSize_];
@@ -161,6 +203,19 @@ class TAD_DP_TableAffine : public TAD_DP_Table<R> {
       mtrxH__ = new R[this->mtrxSize_];
       mtrxV_H_ = new R[this->mtrxSize_];
       mtrxVH__ = new R[this->mtrxSize_];
+    }
+
+    void freeMatrices() {
+      delete[] mtrxS_;
+      delete[] mtrxV_;
+      delete[] mtrxH_;
+      delete[] mtrxV__;
+      delete[] mtrxH__;
+      delete[] mtrxV_H_;
+      delete[] mtrxVH__;
+    }
+
+    void fillMatrices(R init) {
 			// TODO quicker way to init array?
 			//std::cout << "filling with " << init << std::endl;
 			std::fill( mtrxS_, mtrxS_ + this->mtrxSize_, init );
@@ -172,6 +227,26 @@ class TAD_DP_TableAffine : public TAD_DP_Table<R> {
 			std::fill( mtrxVH__, mtrxVH__ + this->mtrxSize_, init );
     }
 
+	public:
+    TAD_DP_TableAffine(unsigned long rows, unsigned long cols, R init)
+      : TAD_DP_Table<R>(rows,cols,init) {
+      checkSpaceConsumption();
+      allocMatrices();
+      fillMatrices(init);
+    }
+
+    ~TAD_DP_TableAffine() {
+      freeMatrices();
+    }
+
+    void reset(unsigned long rows, unsigned long cols, R init) {
+      if (this->resize(rows,cols)) {
+        freeMatrices();
+        allocMatrices();
+      }
+      fillMatrices(init);
+    }
+
 		void checkSpaceConsumption() {
 			// check for an overflow
 			if (this->rows_ > ULONG_MAX / this->cols_) {
@@ -35,6 +35,8 @@ Options::Options(int argc, const char **argv)
     setOption(Multiple,                  "-m","","                        ","multiple alignment mode",false);
     setOption(ClusterThreshold,          "-mt","=double","                ","clustering threshold",false);
     setOption(ClusterJoinCutoff,         "-mc","=double","                ","clustering cutoff",false);
+    setOption(Threads,                   "--threads","=int","             ","number of threads for the pairwise alignments (0 = all processors)",false);
+    setOption(ScoreMatrixFile,           "--score_matrix","=file","       ","write pairwise scores to file, resume from it if it exists",false);
 #ifdef HAVE_LIBRNA
     setOption(PredictProfile,            "-p","","                        ","predict structures from sequences",false);
     setOption(PredictMinPairProb,	       "-pmin","=double","              ","minimum basepair frequency for prediction",false);
@@ -116,6 +118,8 @@ Options::Options(int argc, const char **argv)
     requires(LocalSubopts,LocalSimilarity);
     requires(ClusterThreshold,Multiple);
     requires(ClusterJoinCutoff,Multiple);
+    requires(Threads,Multiple);
+    requires(ScoreMatrixFile,Multiple);
 #ifdef HAVE_LIBRNA
     requires(PredictProfile,Multiple);
     requires(PredictMinPairProb,PredictProfile);
@@ -52,6 +52,8 @@ public:
         ConsensusMinPairProb,
         ClusterThreshold,
         ClusterJoinCutoff,
+        Threads,
+        ScoreMatrixFile,
 #ifdef HAVE_LIBRNA
         PredictProfile,
         PredictMinPairProb,
@@ -1,9 +1,144 @@
 #include <algorithm>
 #include <fstream>
+#include <sstream>
 #include "alignment.h"
 #include "progressive_align.h"
 #include "alignment.t.cpp"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// reads the scores of a previous run from a score matrix file, every complete
+// line "x y score" sets the score of pair x,y and marks it as known
+static void readScoreMatrix(const std::string &filename, long n, Matrix<double> *score_mtrx, std::vector<bool> &known) {
+    std::ifstream in(filename.c_str());
+    std::string line;
+
+    if (!in.is_open())
+        return;
+
+    while (std::getline(in,line)) {
+        // the last line may have been cut by an interruption
+        if (in.eof())
+            break;
+
+        if (line.empty())
+            continue;
+
+        if (line[0] == '#') {
+            long m = 0;
+            std::string::size_type pos = line.find("n=");
+            if (pos != std::string::npos)
+                std::istringstream(line.substr(pos+2)) >> m;
+            if (m != n) {
+                std::cerr << "Error: score matrix file " << filename << " was computed for " << m
+                          << " instead of " << n << " structures." << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            continue;
+        }
+
+        std::istringstream ss(line);
+        long x, y;
+        double score;
+        if ((ss >> x >> y >> score) && y >= 1 && y < x && x <= n) {
+            score_mtrx->setAt(x-1,y-1,score);
+            known[(x-1)*n+y-1] = true;
+        }
+    }
+}
+
+// computes the scores of all pairs x,y with y<x of the input profiles. The pairs
+// are distributed among the threads, and each thread re-uses its own dynamic
+// programming tables for all of its pairs. If scoreMatrixFile is given, each
+// score is appended to it as soon as it is known. Scores that are already
+// stored there by a previous, interrupted run are not computed again
+static void computePairwiseScores(const RNAProfileAliMapType &inputMapProfile, Matrix<double> *score_mtrx,
+                                  const Algebra<double,RNA_Alphabet_Profile> *alg, const AlgebraAffine<double,RNA_Alphabet_Profile> *alg_affine,
+                                  bool topdown, bool anchored, bool local, bool printBT, int threads, const std::string &scoreMatrixFile) {
+    long n = inputMapProfile.size();
+    std::vector<RNAProfileAlignment*> profiles(n+1);
+    std::vector<bool> known(n*n,false);
+    std::vector<std::pair<long,long> > pairs;
+    std::ofstream scoreFile;
+
+    RNAProfileAliMapType::const_iterator it;
+    for (it=inputMapProfile.begin(); it!=inputMapProfile.end(); it++)
+        profiles[it->first] = it->second;
+
+    if (!scoreMatrixFile.empty()) {
+        readScoreMatrix(scoreMatrixFile,n,score_mtrx,known);
+
+        // rewrite the file with the known scores only, which drops
+        // a line that may have been cut by an interruption
+        scoreFile.open(scoreMatrixFile.c_str(), std::ios::trunc);
+        if (!scoreFile.is_open()) {
+            std::cerr << "Error: cannot write score matrix file " << scoreMatrixFile << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        // print enough digits to resume with exactly the same scores
+        scoreFile.precision(17);
+        scoreFile << "# RNAforester score matrix n=" << n << std::endl;
+        for (long x=2; x<=n; x++)
+            for (long y=1; y<x; y++)
+                if (known[(x-1)*n+y-1])
+                    scoreFile << x << " " << y << " " << score_mtrx->getAt(x-1,y-1) << std::endl;
+    }
+
+    for (long x=2; x<=n; x++)
+        for (long y=1; y<x; y++)
+            if (!known[(x-1)*n+y-1])
+                pairs.push_back(std::make_pair(x,y));
+
+#ifdef _OPENMP
+    if (threads <= 0)
+        threads = omp_get_num_procs();
+#pragma omp parallel num_threads(threads)
+#endif
+    {
+        TAD_DP_TableLinear<double> *table = NULL;
+        TAD_DP_TableAffine<double> *tableAffine = NULL;
+
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+        for (long p=0; p<(long)pairs.size(); p++) {
+            long x = pairs[p].first;
+            long y = pairs[p].second;
+            RNAProfileAlignment *f1 = profiles[x];
+            RNAProfileAlignment *f2 = profiles[y];
+            double score;
+
+            if (alg_affine) {
+                if (!tableAffine)
+                    tableAffine = new TAD_DP_TableAffine<double>(1,1,alg_affine->worst_score());
+                AlignmentAffine<double,RNA_Alphabet_Profile,RNA_Alphabet_Profile> ali(f1,f2,*alg_affine,topdown,anchored,local,printBT,SPEEDUP,tableAffine);
+                score = local ? ali.getLocalOptimum() : ali.getGlobalOptimumRelative();
+            } 
+            else {
+                if (!table)
+                    table = new TAD_DP_TableLinear<double>(1,1,alg->worst_score());
+                AlignmentLinear<double,RNA_Alphabet_Profile,RNA_Alphabet_Profile> ali(f1,f2,*alg,topdown,anchored,local,printBT,SPEEDUP,table);
+                score = local ? ali.getLocalOptimum() : ali.getGlobalOptimumRelative();
+            }
+
+            // each pair has its own cell
+            score_mtrx->setAt(x-1,y-1,score);
+
+            if (scoreFile.is_open()) {
+#ifdef _OPENMP
+#pragma omp critical (score_matrix_file)
+#endif
+                scoreFile << x << " " << y << " " << score << std::endl;
+            }
+        }
+
+        delete table;
+        delete tableAffine;
+    }
+}
+
 
 // !!! this operator is defined as > !!!
 bool operator < (std::pair<double,RNAProfileAlignment*> &l, std::pair<double,RNAProfileAlignment*> &r) {
@@ -98,34 +233,18 @@ void progressiveAlign(std::vector<RNAProfileAlignment*> &inputList,
 		RNAProfileAlignment *f1 = NULL, *f2 = NULL;
     std::cout << "Computing all pairwise similarities" << std::endl;
 
+    int threads = 1;
+    std::string scoreMatrixFile;
+    options.get(Options::Threads, threads, 1);
+    options.get(Options::ScoreMatrixFile, scoreMatrixFile, std::string(""));
+    computePairwiseScores(inputMapProfile,score_mtrx,alg,alg_affine,topdown,anchored,local,printBT,threads,scoreMatrixFile);
+
     RNAProfileAliMapType::iterator it2;
     for (it=inputMapProfile.begin(); it!=inputMapProfile.end(); it++) {
         x = it->first;
-        f1 = it->second;
         for (it2=inputMapProfile.begin(); it2->first<it->first; it2++) {
             y = it2->first;
-            f2 = it2->second;
-
-						if (options.has(Options::Affine)) {
-							AlignmentAffine<double,RNA_Alphabet_Profile,RNA_Alphabet_Profile> * ali = new AlignmentAffine<double,RNA_Alphabet_Profile,RNA_Alphabet_Profile>(f1,f2,*alg_affine,topdown,anchored,local,printBT);
-	            if (local)
-		              score_mtrx->setAt(x-1,y-1,ali->getLocalOptimum());
-			        else
-				          score_mtrx->setAt(x-1,y-1,ali->getGlobalOptimumRelative());
-
-					    std::cout << x << "," << y << ": " << score_mtrx->getAt(x-1,y-1) << std::endl;
-							delete ali;
-						}
-						else {
-							AlignmentLinear<double,RNA_Alphabet_Profile,RNA_Alphabet_Profile> * ali = new AlignmentLinear<double,RNA_Alphabet_Profile,RNA_Alphabet_Profile>(f1,f2,*alg,topdown,anchored,local,printBT);
-							if (local)
-								  score_mtrx->setAt(x-1,y-1,ali->getLocalOptimum());
-							else
-								  score_mtrx->setAt(x-1,y-1,ali->getGlobalOptimumRelative());
-
-							std::cout << x << "," << y << ": " << score_mtrx->getAt(x-1,y-1) << std::endl;
-							delete ali;
-						}
+            std::cout << x << "," << y << ": " << score_mtrx->getAt(x-1,y-1) << std::endl;
         }
     }
     std::cout << std::endl;
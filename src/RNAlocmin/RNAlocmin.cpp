@@ -3,6 +3,7 @@
 #include <string.h>
 #include <math.h>
 #include <limits.h>
+#include <stdint.h>
 
 #include <map>
 #include <vector>
@@ -14,6 +15,7 @@ extern "C" {
 }
 
 #include "RNAlocmin.h"
+#include "barrier_tree.h"
 #include "move_set_pk.h"
 #include "neighbourhood.h"
 
@@ -102,6 +104,89 @@ void print_rates(char *filename, double temp, int num, float *energy_barr, vecto
   fclose(rates);
 }
 
+// entry of sparse rates
+typedef struct {
+  uint32_t from;
+  uint32_t to;
+  double rate;
+} rate_entry;
+
+bool compf_rates(const rate_entry &lhs, const rate_entry &rhs)
+{
+  if (lhs.from != rhs.from) return lhs.from < rhs.from;
+  return lhs.to < rhs.to;
+}
+
+// print rates to a file in sparse binary format
+void print_rates_sparse(char *filename, double temp, const SaddleList &saddles, vector<int> &output_en)
+{
+  FILE *rates;
+  rates = fopen(filename, "wb");
+  if (rates==NULL) {
+    fprintf(stderr, "ERROR: couldn't open file \"%s\" for rates!\n", filename);
+    return;
+  }
+  double _kT = 0.00198717*(273.15 + temp);
+
+  // both directions of every saddle
+  vector<rate_entry> entries;
+  entries.reserve(2*saddles.Saddles().size());
+  for (unsigned int k=0; k<saddles.Saddles().size(); k++) {
+    const energy_pair &ep = saddles.Saddles()[k];
+    rate_entry re;
+    // Arhenius kinetics (as A method in treekin)
+    re.from = ep.i; re.to = ep.j; re.rate = 1.0*exp(-(ep.barrier-(output_en[ep.i]/100.0))/_kT);
+    entries.push_back(re);
+    re.from = ep.j; re.to = ep.i; re.rate = 1.0*exp(-(ep.barrier-(output_en[ep.j]/100.0))/_kT);
+    entries.push_back(re);
+  }
+  sort(entries.begin(), entries.end(), compf_rates);
+
+  // index of rows
+  vector<uint64_t> index(saddles.n+1, 0);
+  for (unsigned int k=0; k<entries.size(); k++) index[entries[k].from+1]++;
+  for (int i=0; i<saddles.n; i++) index[i+1] += index[i];
+
+  // header
+  uint32_t version = 1;
+  uint32_t n = saddles.n;
+  uint64_t nnz = entries.size();
+  fwrite("RLMRATES", sizeof(char), 8, rates);
+  fwrite(&version, sizeof(uint32_t), 1, rates);
+  fwrite(&n, sizeof(uint32_t), 1, rates);
+  fwrite(&nnz, sizeof(uint64_t), 1, rates);
+  fwrite(index.data(), sizeof(uint64_t), index.size(), rates);
+  for (unsigned int k=0; k<entries.size(); k++) {
+    fwrite(&entries[k].from, sizeof(uint32_t), 1, rates);
+    fwrite(&entries[k].to, sizeof(uint32_t), 1, rates);
+    fwrite(&entries[k].rate, sizeof(double), 1, rates);
+  }
+  fclose(rates);
+}
+
+bool compf_saddles(const energy_pair &lhs, const energy_pair &rhs)
+{
+  if (lhs.i != rhs.i) return lhs.i < rhs.i;
+  return lhs.j < rhs.j;
+}
+
+// print saddles to a file as "i j saddle" lines
+void print_saddles_sparse(char *filename, const SaddleList &saddles)
+{
+  FILE *out;
+  out = fopen(filename, "w");
+  if (out==NULL) {
+    fprintf(stderr, "ERROR: couldn't open file \"%s\" for saddles! (using stderr instead)\n", filename);
+    out = stderr;
+  }
+  vector<energy_pair> sorted = saddles.Saddles();
+  sort(sorted.begin(), sorted.end(), compf_saddles);
+  for (unsigned int k=0; k<sorted.size(); k++) {
+    fprintf(out, "%6d %6d %6.2f\n", sorted[k].i+1, sorted[k].j+1, sorted[k].barrier);
+  }
+  if (out!=stderr) fclose(out);
+}
+
 // pt to str
 string pt_to_str(short *pt)
 {
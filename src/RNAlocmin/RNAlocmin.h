@@ -6,6 +6,8 @@
 
 #include "globals.h"
 
+class SaddleList;
+
 // reads a line no matter how long
 char* my_getline(FILE *fp);
 
@@ -21,6 +23,16 @@ int find_lone_pair(short* str);
 // print rates/saddles to a file
 void print_rates(char *filename, double temp, int num, float *energy_barr, std::vector<int> &output_en, bool only_saddles = false);
 
+// print rates to a file in sparse binary format (only between LM with computed saddle):
+//   char magic[8] = "RLMRATES"; uint32 version = 1; uint32 number of LM (n); uint64 number of rates (nnz)
+//   uint64 index[n+1] - position of first rate from LM i (rates are sorted by source, then target LM)
+//   nnz times { uint32 from; uint32 to; double rate } - LM numbered from 0
+// all in native byte order, so the file can be memory-mapped
+void print_rates_sparse(char *filename, double temp, const SaddleList &saddles, std::vector<int> &output_en);
+
+// print saddles to a file as "i j saddle" lines (LM numbered from 1)
+void print_saddles_sparse(char *filename, const SaddleList &saddles);
+
 // just encapsulation
 int move_set(struct_en &input, SeqInfo &sqi);
 
@@ -6,13 +6,6 @@
 
 using namespace std;
 
-typedef struct {
-  float barrier;
-  int i;
-  int j;
-  bool findpath;
-} energy_pair;
-
 struct comparator {
   bool operator()(const energy_pair& x, const energy_pair& y) const {
     if (x.barrier==y.barrier) {
@@ -62,6 +55,31 @@ int findfather(nodeT *nodes, int i) {
   else return findfather(nodes, nodes[i].father);
 }
 
+SaddleList::SaddleList(int n)
+{
+  this->n = n;
+}
+
+void SaddleList::Add(int i, int j, float barrier, bool findpath)
+{
+  energy_pair ep;
+  ep.barrier = barrier;
+  ep.i = min(i, j);
+  ep.j = max(i, j);
+  ep.findpath = findpath;
+
+  long long key = (long long)ep.i*n + ep.j;
+  unordered_map<long long, int>::iterator it = index.find(key);
+  if (it != index.end()) {
+    saddles[it->second] = ep;
+  } else {
+    index[key] = saddles.size();
+    saddles.push_back(ep);
+  }
+}
+
+int make_tree(int n, priority_queue<energy_pair, vector<energy_pair>, comparator> &saddles, nodeT *nodes);
+
 // make barrier tree
 int make_tree(int n, float *energy_barr, bool *findpath, nodeT *nodes)
 {
@@ -81,6 +99,21 @@ int make_tree(int n, float *energy_barr, bool *findpath, nodeT *nodes)
     }
   }
 
+  return make_tree(n, saddles, nodes);
+}
+
+// make barrier tree from computed saddles only
+int make_tree(const SaddleList &list, nodeT *nodes)
+{
+  priority_queue<energy_pair, vector<energy_pair>, comparator> saddles(comparator(), list.Saddles());
+
+  return make_tree(list.n, saddles, nodes);
+}
+
+// join LM along saddles in increasing order (union-find)
+int make_tree(int n, priority_queue<energy_pair, vector<energy_pair>, comparator> &saddles, nodeT *nodes)
+{
+
   // max_height
   float max_height = -1e10;
   //for (int i=0; i<n; i++) if (nodes[i].father!=-1) max_height=max(max_height, nodes[i].saddle_height);
@@ -1,5 +1,34 @@
+#ifndef __BARRIER_TREE_H
+#define __BARRIER_TREE_H
+
+#include <vector>
+#include <unordered_map>
+
 #include "treeplot.h"
 
+// saddle between two LM
+typedef struct {
+  float barrier;
+  int i;
+  int j;
+  bool findpath;
+} energy_pair;
+
+// sparse list of computed saddles (instead of the dense num*num matrix of energy barriers)
+class SaddleList {
+  std::vector<energy_pair> saddles;
+  std::unordered_map<long long, int> index;  // (i,j) -> position in saddles
+
+public:
+  int n;  // number of LM
+
+  SaddleList(int n);
+
+  // add saddle between i and j (overwrites previous one)
+  void Add(int i, int j, float barrier, bool findpath);
+
+  const std::vector<energy_pair> &Saddles() const { return saddles; }
+};
 
 // union find set for LM when trying to recompute barrier tree
 void union_set(int father, int child);
@@ -8,6 +37,9 @@ int find(int x);
 
 // make barrier tree
 int make_tree(int n, float *energy_bar, bool *findpath, nodeT *nodes);
+int make_tree(const SaddleList &saddles, nodeT *nodes);
 
 // recompute single father change
 void add_father(nodeT *nodes, int child, int father, double color);
+
+#endif
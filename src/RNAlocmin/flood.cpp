@@ -14,21 +14,38 @@ extern "C" {
 
 using namespace std;
 
-// global priority queue for stuff in flooding (does not hold memory - memory is in hash)
-priority_queue<struct_en*, vector<struct_en*>, comps_entries_rev> neighs;
-priority_queue<Structure*, vector<Structure*>, comps_entries_rev> neighs2;
-int energy_lvl;
-bool debugg;
-int top_lvl;
-int min_lvl;
-bool minh_total;
-bool found_exit;
-// hash for the flooding
-unordered_set<struct_en*, hash_fncts, hash_eq> hash_flood (HASHSIZE);
-unordered_set<struct_en*, hash_fncts, hash_eq>::iterator it_hash;
-
-unordered_set<Structure*, hash_fncts, hash_eq> hash_flood2 (HASHSIZE);
-unordered_set<Structure*, hash_fncts, hash_eq>::iterator it_hash2;
+// hash for the flooding of non-pseudoknotted structures (packed, arena is reused by consecutive floods)
+thread_local PackedStore flood_store;
+// unpacked structure that is flooded from
+thread_local vector<short> flood_pt;
+
+// queue entry of flooding - energy and index into flood_store
+struct flood_entry {
+  int energy;
+  int id;
+};
+
+// same ordering as comps_entries_rev
+struct comps_flood_rev {
+  bool operator() (const flood_entry &lhs, const flood_entry &rhs) const {
+    if (lhs.energy!=rhs.energy) return lhs.energy>rhs.energy;
+    return flood_store.Less(rhs.id, lhs.id);
+  }
+};
+
+// priority queue for stuff in flooding (does not hold memory - memory is in hash)
+// all flooding state is thread local, so minima can be flooded concurrently
+thread_local priority_queue<flood_entry, vector<flood_entry>, comps_flood_rev> neighs;
+thread_local priority_queue<Structure*, vector<Structure*>, comps_entries_rev> neighs2;
+thread_local int energy_lvl;
+thread_local bool debugg;
+thread_local int top_lvl;
+thread_local int min_lvl;
+thread_local bool minh_total;
+thread_local bool found_exit;
+// hash for the flooding of pseudoknotted structures (grows on demand, instead of HASHSIZE buckets per thread)
+thread_local unordered_set<Structure*, hash_fncts, hash_eq> hash_flood2;
+thread_local unordered_set<Structure*, hash_fncts, hash_eq>::iterator it_hash2;
 
 
 void copy_se(struct_en *dest, const struct_en *src) {
@@ -43,12 +60,21 @@ struct_en *allocopy_se(const struct_en *src) {
   return dest;
 }
 
+// add structure to the flooded ones
+void flood_push(struct_en *input)
+{
+  bool inserted;
+  flood_entry entry;
+  entry.id = flood_store.Insert(input->structure, inserted);
+  entry.energy = input->energy;
+  neighs.push(entry);
+}
+
 // function to do on all the items...
 int flood_func(struct_en *input, struct_en *output)
 {
   // have we seen him?
-  it_hash = hash_flood.find(input);
-  if (it_hash != hash_flood.end()) {
+  if (flood_store.Find(input->structure) != -1) {
     // nothing to do with already processed structure
     if (debugg) fprintf(stderr,     "   already seen: %s %.2f\n", pt_to_str(input->structure).c_str(), input->energy/100.0);
     return 0;
@@ -67,11 +93,7 @@ int flood_func(struct_en *input, struct_en *output)
           //add it:
           if (debugg) fprintf(stderr, "    adding(min): %s %.2f\n", pt_to_str(input->structure).c_str(), input->energy/100.0);
           // just add it to the queue... and to hash
-          struct_en *he_tmp = (struct_en*)space(sizeof(struct_en));
-          he_tmp->structure = allocopy(input->structure);
-          he_tmp->energy = input->energy;
-          neighs.push(he_tmp);
-          hash_flood.insert(he_tmp);
+          flood_push(input);
           return 0;
         }
       }
@@ -88,11 +110,7 @@ int flood_func(struct_en *input, struct_en *output)
       } else {
         if (debugg) fprintf(stderr, "       adding  : %s %.2f\n", pt_to_str(input->structure).c_str(), input->energy/100.0);
         // just add it to the queue... and to hash
-        struct_en *he_tmp = (struct_en*)space(sizeof(struct_en));
-        he_tmp->structure = allocopy(input->structure);
-        he_tmp->energy = input->energy;
-        neighs.push(he_tmp);
-        hash_flood.insert(he_tmp);
+        flood_push(input);
         return 0;
       }
     }
@@ -160,10 +178,6 @@ struct_en* flood(const struct_en &he, SeqInfo &sqi, int &saddle_en, int maxh, bo
 
   struct_en *res = NULL;
 
-  // save deg.first + create deg
-  bool first = Opt.first;
-  Opt.first = true;
-
   // if minh specified, assign top_lvl and flood_total
   if (maxh>0) {
     top_lvl = he.energy + maxh;
@@ -206,6 +220,8 @@ struct_en* flood(const struct_en &he, SeqInfo &sqi, int &saddle_en, int maxh, bo
 
       int verbose = Opt.verbose_lvl<2?0:Opt.verbose_lvl-2;
       he_top->energy = browse_neighs_pk_pt(sqi.seq, he_top, sqi.s0, sqi.s1, Opt.shift, verbose, flood_func2);
+      // saddle is the level we are flooding at
+      if (found_exit) saddle_en = energy_lvl;
 
       if (found_exit && Opt.verbose_lvl>2) fprintf(stderr, "sad= %6.2f    : %s %.2f\n", saddle_en/100.0, pt_to_str(he_top->str).c_str(), he_top->energy/100.0);
 
@@ -241,37 +257,42 @@ struct_en* flood(const struct_en &he, SeqInfo &sqi, int &saddle_en, int maxh, bo
     }
 
     // init hash
-    free_hash(hash_flood);
+    flood_store.Clear(he.structure[0]);
+    flood_pt.resize(he.structure[0]+1);
     found_exit = false;
 
 
-    // add the first structure to hash, get its adress and add it to priority queue
+    // add the first structure to hash and to priority queue
     {
-      struct_en *he_tmp = allocopy_se(&he);
-      neighs.push(he_tmp);
-      hash_flood.insert(he_tmp);
+      struct_en he_tmp = he;
+      flood_push(&he_tmp);
     }
 
     // FLOOOD!
-    while ((int)hash_flood.size() < Opt.floodMax) {
+    while (flood_store.Size() < Opt.floodMax) {
       // should not be empty (only when maxh specified)
       if (neighs.empty()) break;
 
       // get structure
-      struct_en *he_top = neighs.top();
+      struct_en he_top;
+      he_top.structure = flood_pt.data();
+      he_top.energy = neighs.top().energy;
+      flood_store.Unpack(neighs.top().id, he_top.structure);
       neighs.pop();
-      energy_lvl = he_top->energy;
+      energy_lvl = he_top.energy;
 
-      if (Opt.verbose_lvl>2) fprintf(stderr, "  neighbours of: %s %.2f\n", pt_to_str(he_top->structure).c_str(), he_top->energy/100.0);
+      if (Opt.verbose_lvl>2) fprintf(stderr, "  neighbours of: %s %.2f\n", pt_to_str(he_top.structure).c_str(), he_top.energy/100.0);
 
       int verbose = Opt.verbose_lvl<2?0:Opt.verbose_lvl-2;
-      he_top->energy = browse_neighs_pt(sqi.seq, he_top->structure, sqi.s0, sqi.s1, verbose, Opt.shift, Opt.noLP, flood_func);
+      he_top.energy = browse_neighs_pt(sqi.seq, he_top.structure, sqi.s0, sqi.s1, verbose, Opt.shift, Opt.noLP, flood_func);
+      // saddle is the level we are flooding at
+      if (found_exit) saddle_en = energy_lvl;
 
-      if (found_exit && Opt.verbose_lvl>2) fprintf(stderr, "sad= %6.2f    : %s %.2f\n", saddle_en/100.0, pt_to_str(he_top->structure).c_str(), he_top->energy/100.0);
+      if (found_exit && Opt.verbose_lvl>2) fprintf(stderr, "sad= %6.2f    : %s %.2f\n", saddle_en/100.0, pt_to_str(he_top.structure).c_str(), he_top.energy/100.0);
 
       // did we find exit from basin?
       if (found_exit) {
-        res = allocopy_se(he_top);
+        res = allocopy_se(&he_top);
         break;
       }
 
@@ -288,14 +309,8 @@ struct_en* flood(const struct_en &he, SeqInfo &sqi, int &saddle_en, int maxh, bo
       //fprintf(stderr, "-neighs size: %d\n", (int)neighs.size());
       neighs.pop();
     }
-
-    // destroy hash
-    free_hash(hash_flood);
   }  /// #### END OF PKNOTS BRANCH
 
-  // restore deg options
-  Opt.first = first;
-
   // return found? structure
   return res;
 }
@@ -7,6 +7,10 @@
 
 #include <stack>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 extern "C" {
   #include "pair_mat.h"
   #include "fold.h"
@@ -106,6 +110,11 @@ int Options::Init(gengetopt_args_info &args_info)
     ret = -1;
   }
 
+  if (args_info.threads_arg<0) {
+    fprintf(stderr, "Number of threads should be non-negative integer (threads)\n");
+    ret = -1;
+  }
+
   if (ret ==-1) return -1;
 
   // adjust options
@@ -120,6 +129,15 @@ int Options::Init(gengetopt_args_info &args_info)
   pknots = args_info.pseudoknots_flag;
   neighs = args_info.neighborhood_flag;
 
+  // threads
+#ifdef _OPENMP
+  threads = (args_info.threads_arg == 0 ? omp_get_num_procs() : args_info.threads_arg);
+  omp_set_num_threads(threads);
+#else
+  threads = 1;
+  if (args_info.threads_arg != 1) fprintf(stderr, "WARNING: RNAlocmin was compiled without OpenMP support, using one thread\n");
+#endif
+
   return ret;
 }
 
@@ -43,6 +43,8 @@ public:
 
   bool pknots; // flag for pseudoknots.
 
+  int threads;  // number of threads for descents, flooding, and findpath
+
 public:
   Options();
 
@@ -50,58 +50,231 @@ bool compf_entries_rev (const struct_en *lhs, const struct_en *rhs) {
   return compf_short_rev(lhs->structure, rhs->structure);
 }
 
-void print_stats(unordered_map<struct_en, gw_struct, hash_fncts, hash_eq> &structs)
+// number of structures in one chunk of the arena
+#define CHUNK_BITS 12
+#define CHUNK (1<<CHUNK_BITS)
+
+PackedStore::PackedStore()
+{
+  length = 0;
+  words = 0;
+  count = 0;
+}
+
+PackedStore::~PackedStore()
+{
+  for (unsigned int i=0; i<chunks.size(); i++) free(chunks[i]);
+}
+
+void PackedStore::Clear(int length)
+{
+  // different length - arena cannot be reused
+  if (length != this->length) {
+    for (unsigned int i=0; i<chunks.size(); i++) free(chunks[i]);
+    chunks.clear();
+    this->length = length;
+    words = (2*length+63)/64;
+    scratch.resize(words);
+  }
+  count = 0;
+  hashes.clear();
+  index.assign(1024, -1);
+}
+
+inline uint64_t *PackedStore::Slot(int id) const
+{
+  return chunks[id>>CHUNK_BITS] + (size_t)(id&(CHUNK-1))*words;
+}
+
+void PackedStore::Pack(const short *pt, uint64_t *dest) const
+{
+  // first nucleotide in the most significant bits, so words compare lexicographically
+  for (int w=0; w<words; w++) dest[w] = 0;
+  for (int i=1; i<=length; i++) {
+    uint64_t code = (pt[i]==0 ? 2 : (pt[i]<i ? 1 : 0));
+    dest[(i-1)/32] |= code << (62 - 2*((i-1)%32));
+  }
+}
+
+void PackedStore::Unpack(int id, short *pt)
+{
+  const uint64_t *key = Slot(id);
+  std::vector<short> &stack = scratch_stack;
+  stack.resize(length+1);
+  int sp = 0;
+  pt[0] = length;
+  for (int i=1; i<=length; i++) {
+    int code = (key[(i-1)/32] >> (62 - 2*((i-1)%32))) & 3;
+    switch (code) {
+      case 0: stack[sp++] = i; break;
+      case 1: pt[i] = stack[--sp]; pt[pt[i]] = i; break;
+      default: pt[i] = 0;
+    }
+  }
+}
+
+uint32_t PackedStore::Hash(const uint64_t *key) const
+{
+  uint64_t h = length;
+  for (int w=0; w<words; w++) {
+    h ^= key[w] + 0x9e3779b97f4a7c15ULL + (h<<6) + (h>>2);
+    h = (h ^ (h>>31)) * 0xbf58476d1ce4e5b9ULL;
+  }
+  return (uint32_t)(h ^ (h>>32));
+}
+
+int PackedStore::Lookup(const uint64_t *key, uint32_t hash) const
+{
+  unsigned mask = index.size()-1;
+  unsigned pos = hash & mask;
+  while (index[pos] != -1) {
+    int id = index[pos];
+    if (hashes[id]==hash && memcmp(Slot(id), key, words*sizeof(uint64_t))==0) return pos;
+    pos = (pos+1) & mask;
+  }
+  return pos;
+}
+
+void PackedStore::Grow()
+{
+  index.assign(index.size()*2, -1);
+  unsigned mask = index.size()-1;
+  for (int id=0; id<count; id++) {
+    unsigned pos = hashes[id] & mask;
+    while (index[pos] != -1) pos = (pos+1) & mask;
+    index[pos] = id;
+  }
+}
+
+int PackedStore::Find(const short *pt)
+{
+  Pack(pt, scratch.data());
+  return index[Lookup(scratch.data(), Hash(scratch.data()))];
+}
+
+int PackedStore::Insert(const short *pt, bool &inserted)
+{
+  Pack(pt, scratch.data());
+  uint32_t hash = Hash(scratch.data());
+  int pos = Lookup(scratch.data(), hash);
+  inserted = (index[pos] == -1);
+  if (!inserted) return index[pos];
+
+  // new structure - copy it to the arena
+  if ((count>>CHUNK_BITS) == (int)chunks.size()) {
+    chunks.push_back((uint64_t*)malloc((size_t)CHUNK*words*sizeof(uint64_t)));
+  }
+  int id = count++;
+  memcpy(Slot(id), scratch.data(), words*sizeof(uint64_t));
+  hashes.push_back(hash);
+  index[pos] = id;
+
+  // keep load factor below 1/2
+  if (2*count > (int)index.size()) Grow();
+
+  return id;
+}
+
+bool PackedStore::Less(int lhs, int rhs) const
+{
+  const uint64_t *l = Slot(lhs), *r = Slot(rhs);
+  for (int w=0; w<words; w++) {
+    if (l[w] != r[w]) return l[w] < r[w];
+  }
+  return false;
+}
+
+size_t PackedStore::Memory() const
+{
+  return chunks.size()*(size_t)CHUNK*words*sizeof(uint64_t) + hashes.capacity()*sizeof(uint32_t) + index.size()*sizeof(int);
+}
+
+StructTable::StructTable(int length, bool packed)
+{
+  this->packed = packed;
+  if (packed) store.Clear(length);
+  else map.reserve(HASHSIZE);
+}
+
+StructTable::~StructTable()
+{
+  unordered_map<struct_en, gw_struct, hash_fncts, hash_eq>::iterator it;
+  for (it=map.begin(); it!=map.end(); it++) {
+    free(it->first.structure);
+  }
+}
+
+gw_struct *StructTable::Find(const struct_en &str)
+{
+  if (packed) {
+    int id = store.Find(str.structure);
+    return (id == -1 ? NULL : &values[id]);
+  }
+  unordered_map<struct_en, gw_struct, hash_fncts, hash_eq>::iterator it = map.find(str);
+  return (it == map.end() ? NULL : &it->second);
+}
+
+gw_struct &StructTable::Insert(struct_en &str)
+{
+  if (packed) {
+    bool inserted;
+    store.Insert(str.structure, inserted);
+    free(str.structure);
+    str.structure = NULL;
+    energies.push_back(str.energy);
+    values.push_back(gw_struct());
+    return values.back();
+  }
+  return map[str];
+}
+
+void print_stats(StructTable &structs)
 {
   double mean = 0.0;
   int count = 0;
   double entropy = 0.0;
-  unordered_map<struct_en, gw_struct, hash_fncts>::iterator it;
-  for (it=structs.begin(); it!=structs.end(); it++) {
-    count += it->second.count;
-    mean += (it->first.energy)*(it->second.count);
-    entropy += it->second.count*log(it->second.count);
+  if (structs.packed) {
+    for (unsigned int i=0; i<structs.values.size(); i++) {
+      count += structs.values[i].count;
+      mean += (structs.energies[i])*(structs.values[i].count);
+      entropy += structs.values[i].count*log(structs.values[i].count);
+    }
+  } else {
+    unordered_map<struct_en, gw_struct, hash_fncts>::iterator it;
+    for (it=structs.map.begin(); it!=structs.map.end(); it++) {
+      count += it->second.count;
+      mean += (it->first.energy)*(it->second.count);
+      entropy += it->second.count*log(it->second.count);
+    }
   }
 
   mean /= (double)count*100.0;
   entropy = entropy/(double)count - log(count);
 
   fprintf(stderr, "Mean  : %.3f (Entrpy: %.3f)\n", mean, entropy);
+  if (structs.packed) fprintf(stderr, "Packed: %d structures in %.1f MB\n", structs.store.Size(), structs.store.Memory()/1048576.0);
 }
 
-void add_stats(unordered_map<struct_en, gw_struct, hash_fncts, hash_eq> &structs, map<struct_en, int, comps_entries> &output)
+void add_stats(gw_struct &gw, map<struct_en, int, comps_entries> &output)
 {
-  unordered_map<struct_en, gw_struct, hash_fncts>::iterator it;
-  for (it=structs.begin(); it!=structs.end(); it++) {
-    // add stats:
-    //fprintf(stderr, "struct: %s %6.2f %d\n", pt_to_str(it->second.he.structure).c_str(), it->second.he.energy/100.0, it->second.count);
+  // add stats:
+  //fprintf(stderr, "struct: %s %6.2f %d\n", pt_to_str(it->second.he.structure).c_str(), it->second.he.energy/100.0, it->second.count);
 
-    if (output.count(it->second.he) == 0) {
-      fprintf(stderr, "ERROR: output does not contain structure it should!!!\n");
-      //if (!Opt.pknots) exit(EXIT_FAILURE);
-    }
-    output[it->second.he] += it->second.count-1;
+  if (output.count(gw.he) == 0) {
+    fprintf(stderr, "ERROR: output does not contain structure it should!!!\n");
+    //if (!Opt.pknots) exit(EXIT_FAILURE);
   }
+  output[gw.he] += gw.count-1;
 }
 
-// free hash
-void free_hash(unordered_map<struct_en, gw_struct, hash_fncts, hash_eq> &structs)
+void add_stats(StructTable &structs, map<struct_en, int, comps_entries> &output)
 {
-  unordered_map<struct_en, gw_struct, hash_fncts>::iterator it;
-  for (it=structs.begin(); it!=structs.end(); it++) {
-    free(it->first.structure);
-  }
-  structs.clear();
-}
-
-// free hash
-void free_hash(unordered_set<struct_en*, hash_fncts, hash_eq> &structs)
-{
-  unordered_set<struct_en*, hash_fncts, hash_eq>::iterator it;
-  for (it=structs.begin(); it!=structs.end(); it++) {
-    free((*it)->structure);
-    free(*it);
+  if (structs.packed) {
+    for (unsigned int i=0; i<structs.values.size(); i++) add_stats(structs.values[i], output);
+  } else {
+    unordered_map<struct_en, gw_struct, hash_fncts>::iterator it;
+    for (it=structs.map.begin(); it!=structs.map.end(); it++) add_stats(it->second, output);
   }
-  structs.clear();
 }
 
 // free hash
@@ -1,9 +1,12 @@
 #ifndef _hash_util_h
 #define _hash_util_h
 
+#include <stdint.h>
+
 #include <unordered_map>
 #include <unordered_set>
 #include <map>
+#include <vector>
 
 extern "C" {
   #include "utils.h"
@@ -295,16 +298,76 @@ struct comps_entries_rev {
   }
 };
 
+// compact store of non-pseudoknotted structures - 2 bits per nucleotide ('(', ')', '.' in this order,
+// so packed structures compare as compf_short), kept in an arena and indexed by a flat open-addressing table
+class PackedStore {
+  int length;                     // length of structures
+  int words;                      // 64-bit words per structure
+  std::vector<uint64_t*> chunks;  // arena (CHUNK structures each)
+  std::vector<uint32_t> hashes;   // hash of every structure
+  std::vector<int> index;         // open-addressing table (-1 = empty)
+  int count;
+
+  uint64_t *Slot(int id) const;
+  void Pack(const short *pt, uint64_t *dest) const;
+  uint32_t Hash(const uint64_t *key) const;
+  int Lookup(const uint64_t *key, uint32_t hash) const;
+  void Grow();
+
+  std::vector<uint64_t> scratch;
+  std::vector<short> scratch_stack;
+
+public:
+  PackedStore();
+  ~PackedStore();
+
+  // remove all structures (memory of the arena is kept for reuse), set length of structures
+  void Clear(int length);
+  // index of the structure or -1 if not present
+  int Find(const short *pt);
+  // index of the structure, inserts it if not present (inserted is then set to true)
+  int Insert(const short *pt, bool &inserted);
+  // unpack structure into pair table (allocated with length+1 shorts)
+  void Unpack(int id, short *pt);
+  // compf_short on packed structures
+  bool Less(int lhs, int rhs) const;
+
+  int Size() const { return count; }
+  int Length() const { return length; }
+  size_t Memory() const;
+};
+
+// structures to minima map - packed, or std::unordered_map for pseudoknotted structures
+class StructTable {
+  bool packed;
+  std::unordered_map<struct_en, gw_struct, hash_fncts, hash_eq> map;
+  PackedStore store;
+  std::vector<int> energies;
+  std::vector<gw_struct> values;
+
+public:
+  StructTable(int length, bool packed);
+  ~StructTable();
+
+  // NULL if structure is not present
+  gw_struct *Find(const struct_en &str);
+  // insert new structure (takes over memory of str.structure)
+  gw_struct &Insert(struct_en &str);
+
+  int Size() const { return packed ? store.Size() : (int)map.size(); }
+
+  friend void print_stats(StructTable &structs);
+  friend void add_stats(StructTable &structs, std::map<struct_en, int, comps_entries> &output);
+};
+
 // print stats about hash
-void print_stats(std::unordered_map<struct_en, gw_struct, hash_fncts, hash_eq> &structs);
+void print_stats(StructTable &structs);
 // add stats from hash to output map
-void add_stats(std::unordered_map<struct_en, gw_struct, hash_fncts, hash_eq> &structs, std::map<struct_en, int, comps_entries> &output);
+void add_stats(StructTable &structs, std::map<struct_en, int, comps_entries> &output);
 
 
 // free hash
-void free_hash(std::unordered_map<struct_en, gw_struct, hash_fncts, hash_eq> &structs);
 //void free_hash(unordered_map<Structure, gw_struct, hash_fncts, hash_eq> &structs);
-void free_hash(std::unordered_set<struct_en*, hash_fncts, hash_eq> &structs);
 void free_hash(std::unordered_set<Structure*, hash_fncts, hash_eq> &structs);
 
 // entry handling
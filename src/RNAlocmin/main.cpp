@@ -102,9 +102,20 @@ struct barr_info { // info taken from barriers
   }
 };
 
+// one structure from the input and its gradient walk
+struct walk_item {
+  struct_en old; // structure as read
+  struct_en str; // local minimum (NULL structure if not descended yet)
+  int gw_length;
+  int num;       // number of the structure in the input
+  bool skip;     // seen already - no need to descend concurrently
+};
+
 // functions that are down in file ;-)
 char *read_seq(char *seq_arg, char **name_out);
-int move(unordered_map<struct_en, gw_struct, hash_fncts, hash_eq> &structs, map<struct_en, int, comps_entries> &output, set<struct_en, comps_entries> &output_shallow, SeqInfo &sqi, bool pure_output);
+int read_structure(walk_item &item, SeqInfo &sqi);
+void descend(walk_item &item, SeqInfo &sqi);
+int record(walk_item &item, StructTable &structs, map<struct_en, int, comps_entries> &output, set<struct_en, comps_entries> &output_shallow, SeqInfo &sqi, bool pure_output);
 char *read_previous(char *previous, map<struct_en, int, comps_entries> &output);
 char *read_barr(char *previous, map<struct_en, barr_info, comps_entries> &output);
 
@@ -205,25 +216,68 @@ int main(int argc, char **argv)
 
   int not_canonical = 0;
 
+  // concurrency - the walks and floods of the -N and -k variants share static data, so they stay sequential
+  // random descents (-r) draw from the global rand() stream, so they stay sequential as well
+  bool parallel_walks = (Opt.threads>1 && !Opt.neighs && !Opt.pknots && !Opt.rand);
+  bool parallel_floods = (Opt.threads>1 && !Opt.pknots);
+
   if (!args_info.fix_barriers_given) {
 
     // if direct output:
     if (args_info.just_output_flag) printf("%s\n", seq);
 
     // hash
-    unordered_map<struct_en, gw_struct, hash_fncts, hash_eq> structs (HASHSIZE); // structures to minima map
-    while ((!args_info.find_num_given || count != args_info.find_num_arg) && !args_info.just_read_flag) {
-      int res = move(structs, output, output_shallow, sqi, args_info.just_output_flag);
+    StructTable structs(seq_len, !Opt.pknots); // structures to minima map
+
+    // structures are read in batches, new ones are descended concurrently, then recorded in input order
+    int batch_size = (parallel_walks ? 1024*Opt.threads : 1);
+    vector<walk_item> batch;
+    batch.reserve(batch_size);
+    bool end = false;
+    while (!end && (!args_info.find_num_given || count != args_info.find_num_arg) && !args_info.just_read_flag) {
+      // read
+      batch.clear();
+      while ((int)batch.size() < batch_size) {
+        walk_item item;
+        int res = read_structure(item, sqi);
+        if (res==-1) {  // error or end
+          end = true;
+          break;
+        }
+        if (res==1) batch.push_back(item);
+      }
 
-      // print out
-      //if (Opt.verbose_lvl>0 && num_moves%10000==0) fprintf(stderr, "processed %d, minima %d, time %f secs.\n", num_moves, count, (clock()-clck1)/(double)CLOCKS_PER_SEC);
-      if (Opt.verbose_lvl>0 && num_moves%(Opt.pknots?1000:10000)==0 && num_moves!=0) fprintf(stderr, "processed %d, minima %d, time %f secs.\n", num_moves, (int)output.size(), (clock()-clck1)/(double)CLOCKS_PER_SEC);
+      // descend new structures concurrently
+      if (parallel_walks) {
+        unordered_set<struct_en, hash_fncts, hash_eq> in_batch;
+        for (walk_item &item : batch) {
+          item.skip = !args_info.just_output_flag && (structs.Find(item.old) || !in_batch.insert(item.old).second);
+        }
+        #pragma omp parallel for schedule(dynamic)
+        for (int k=0; k<(int)batch.size(); k++) {
+          if (!batch[k].skip) descend(batch[k], sqi);
+        }
+      }
 
-      // evaluate results
-      if (res==0)   continue; // same structure has been processed already
-      if (res==-1)  break; // error or end
-      if (res==-2)  not_canonical++;
-      if (res==1)   count=output.size();
+      // record
+      int k = 0;
+      for (; k<(int)batch.size() && (!args_info.find_num_given || count != args_info.find_num_arg); k++) {
+        int res = record(batch[k], structs, output, output_shallow, sqi, args_info.just_output_flag);
+
+        // print out
+        //if (Opt.verbose_lvl>0 && num_moves%10000==0) fprintf(stderr, "processed %d, minima %d, time %f secs.\n", num_moves, count, (clock()-clck1)/(double)CLOCKS_PER_SEC);
+        if (Opt.verbose_lvl>0 && batch[k].num%(Opt.pknots?1000:10000)==0) fprintf(stderr, "processed %d, minima %d, time %f secs.\n", batch[k].num, (int)output.size(), (clock()-clck1)/(double)CLOCKS_PER_SEC);
+
+        // evaluate results
+        if (res==0)   continue; // same structure has been processed already
+        if (res==-2)  not_canonical++;
+        if (res==1)   count=output.size();
+      }
+      // leftovers after enough minima were found
+      for (; k<(int)batch.size(); k++) {
+        free(batch[k].old.structure);
+        if (batch[k].str.structure) free(batch[k].str.structure);
+      }
     }
 
     if (args_info.just_output_flag) {
@@ -275,14 +329,28 @@ int main(int argc, char **argv)
 
     int i=0;
     int ii=0;
+    // escapes from the minima, flooded concurrently in chunks ahead of the loop below
+    vector<struct_en*> escapes;
+    map<struct_en, int, comps_entries>::iterator it_flooded = output.begin();
     for (map<struct_en, int, comps_entries>::iterator it=output.begin(); it!=output.end(); it++) {
       ii++;
       // if not enough minima
       if (i<num) {
         // first check if the output is not shallow
         if (Opt.minh>0) {
-          int saddle;
-          struct_en *escape = flood(it->first, sqi, saddle, Opt.minh, args_info.pseudoknots_flag, !args_info.minh_lite_flag);
+          if (it == it_flooded) {
+            vector<map<struct_en, int, comps_entries>::iterator> chunk;
+            for (; it_flooded!=output.end() && (int)chunk.size() < (parallel_floods ? 64*Opt.threads : 1); it_flooded++) chunk.push_back(it_flooded);
+            escapes.assign(chunk.size(), NULL);
+            #pragma omp parallel for schedule(dynamic) if(parallel_floods)
+            for (int k=0; k<(int)chunk.size(); k++) {
+              int saddle;
+              escapes[k] = flood(chunk[k]->first, sqi, saddle, Opt.minh, args_info.pseudoknots_flag, !args_info.minh_lite_flag);
+            }
+            reverse(escapes.begin(), escapes.end());
+          }
+          struct_en *escape = escapes.back();
+          escapes.pop_back();
 
           if (args_info.verbose_lvl_arg>0 && ii%100 == 0) {
             fprintf(stderr, "non-shallow remained: %d / %d; time: %.2f secs.\n", i, ii, (clock()-clck1)/(double)CLOCKS_PER_SEC);
@@ -314,6 +382,12 @@ int main(int argc, char **argv)
         free(it->first.structure);
       }
     }
+    for (struct_en *escape : escapes) {
+      if (escape) {
+        free(escape->structure);
+        free(escape);
+      }
+    }
     output.clear();
 
     // allegiance:
@@ -365,10 +439,13 @@ int main(int argc, char **argv)
 
       // nodes
       std::unique_ptr<nodeT []> nodes(new nodeT[num]);
-      energy_barr = (float*) malloc(num*num*sizeof(float));
-      for (int i=0; i<num*num; i++) energy_barr[i]=1e10;
-      findpath_barr = (bool*) malloc(num*num*sizeof(bool));
-      for (int i=0; i<num*num; i++) findpath_barr[i]=false;
+      if (!args_info.sparse_flag) {
+        energy_barr = (float*) malloc(num*num*sizeof(float));
+        for (int i=0; i<num*num; i++) energy_barr[i]=1e10;
+        findpath_barr = (bool*) malloc(num*num*sizeof(bool));
+        for (int i=0; i<num*num; i++) findpath_barr[i]=false;
+      }
+      SaddleList saddle_list(num);
 
       // fill nodes
       for (int i=0; i<num; i++) {
@@ -382,6 +459,16 @@ int main(int argc, char **argv)
       int flooded = 0;
       // init union-findset
       init_union(num);
+      // flood (and walk down from the escapes) concurrently, the results are then joined in the original order
+      vector<struct_en*> escapes(num, NULL);
+      vector<int> saddles(num);
+      #pragma omp parallel for schedule(dynamic) if(parallel_walks)
+      for (int i=num-1; i>=0; i--) {
+        if (output_num[i]<=threshold && Opt.floodMax>0) {
+          escapes[i] = flood(output_he[i], sqi, saddles[i], Opt.minh, args_info.pseudoknots_flag);
+          if (escapes[i]) move_set(*escapes[i], sqi);
+        }
+      }
       // first try to flood the highest bins
       for (int i=num-1; i>=0; i--) {
         // flood only if low number of walks ended there
@@ -389,8 +476,8 @@ int main(int argc, char **argv)
           //copy_arr(Enc.pt, output_he[i].structure);
           if (args_info.verbose_lvl_arg>2) fprintf(stderr,   "flooding  (%3d): %s %.2f\n", i+1, output_str[i].c_str(), output_he[i].energy/100.0);
 
-          int saddle;
-          struct_en *he = flood(output_he[i], sqi, saddle, Opt.minh, args_info.pseudoknots_flag);
+          int saddle = saddles[i];
+          struct_en *he = escapes[i];
 
           // print info
           if (args_info.verbose_lvl_arg>1) {
@@ -406,9 +493,6 @@ int main(int argc, char **argv)
           }
           // if flood succesfull - walk down to find father minima
           if (he) {
-            // walk down
-            move_set(*he, sqi);
-
             // now check if we have the minimum already (hopefuly yes ;-) )
             vector<struct_en>::iterator it;
             it = lower_bound(output_he.begin(), output_he.end(), *he, compf_entries2);
@@ -422,7 +506,8 @@ int main(int argc, char **argv)
               if (args_info.verbose_lvl_arg>1) fprintf(stderr, "found father at pos: %d\n", pos);
 
               flooded++;
-              energy_barr[i*num+pos] = energy_barr[pos*num+i] = saddle/100.0;
+              if (args_info.sparse_flag) saddle_list.Add(i, pos, saddle/100.0, false);
+              else energy_barr[i*num+pos] = energy_barr[pos*num+i] = saddle/100.0;
 
               // union set
               //fprintf(stderr, "join: %d %d\n", min(i, pos), max(i, pos));
@@ -454,22 +539,44 @@ int main(int argc, char **argv)
       }
 
       // findpath:
+      vector<pair<int, int> > pairs;
       for (set<int>::iterator it=to_findpath.begin(); it!=to_findpath.end(); it++) {
         set<int>::iterator it2=it;
         it2++;
-        for (; it2!=to_findpath.end(); it2++) {
-          if (args_info.pseudoknots_flag) energy_barr[(*it2)*num+(*it)] = energy_barr[(*it)*num+(*it2)] = find_saddle_pk(seq, output_str[*it].c_str(), output_str[*it2].c_str(), args_info.depth_arg)/100.0;
-          else energy_barr[(*it2)*num+(*it)] = energy_barr[(*it)*num+(*it2)] = find_saddle(seq, output_str[*it].c_str(), output_str[*it2].c_str(), args_info.depth_arg)/100.0;
-          findpath_barr[(*it2)*num+(*it)] = findpath_barr[(*it)*num+(*it2)] = true;
-          if (args_info.verbose_lvl_arg>0 && findpath %10000==0){
-            fprintf(stderr, "Findpath:%7d/%7d\n", findpath, (int)(to_findpath.size()*(to_findpath.size()-1)/2));
-          }
-          findpath++;
+        for (; it2!=to_findpath.end(); it2++) pairs.push_back(make_pair(*it, *it2));
+      }
+      vector<float> pair_saddles(pairs.size());
+      #pragma omp parallel for schedule(dynamic) if(parallel_floods)
+      for (int k=0; k<(int)pairs.size(); k++) {
+        int i = pairs[k].first;
+        int j = pairs[k].second;
+        if (args_info.pseudoknots_flag) pair_saddles[k] = find_saddle_pk(seq, output_str[i].c_str(), output_str[j].c_str(), args_info.depth_arg)/100.0;
+        else pair_saddles[k] = find_saddle(seq, output_str[i].c_str(), output_str[j].c_str(), args_info.depth_arg)/100.0;
+        if (args_info.verbose_lvl_arg>0 && k %10000==0){
+          fprintf(stderr, "Findpath:%7d/%7d\n", k, (int)pairs.size());
+        }
+      }
+      for (int k=0; k<(int)pairs.size(); k++) {
+        int i = pairs[k].first;
+        int j = pairs[k].second;
+        if (args_info.sparse_flag) saddle_list.Add(i, j, pair_saddles[k], true);
+        else {
+          energy_barr[j*num+i] = energy_barr[i*num+j] = pair_saddles[k];
+          findpath_barr[j*num+i] = findpath_barr[i*num+j] = true;
         }
       }
+      findpath = pairs.size();
 
       // debug output
-      if (args_info.verbose_lvl_arg>2) {
+      if (args_info.verbose_lvl_arg>2 && args_info.sparse_flag) {
+        fprintf(stderr, "Energy barriers:\n");
+        for (unsigned int k=0; k<saddle_list.Saddles().size(); k++) {
+          const energy_pair &ep = saddle_list.Saddles()[k];
+          fprintf(stderr, "%4d %4d %8.2g%c\n", ep.i, ep.j, ep.barrier, (ep.findpath?'~':' '));
+        }
+        fprintf(stderr, "\n");
+      }
+      if (args_info.verbose_lvl_arg>2 && !args_info.sparse_flag) {
         fprintf(stderr, "Energy barriers:\n");
         //bool symmetric = true;
         for (int i=0; i<num; i++) {
@@ -491,12 +598,14 @@ int main(int argc, char **argv)
 
       // create rates for treekin
       if (args_info.rates_flag) {
-        print_rates(args_info.rates_file_arg, args_info.temp_arg, num, energy_barr, output_en);
+        if (args_info.sparse_flag) print_rates_sparse(args_info.rates_file_arg, args_info.temp_arg, saddle_list, output_en);
+        else print_rates(args_info.rates_file_arg, args_info.temp_arg, num, energy_barr, output_en);
       }
 
       // saddles for evaluation
       if (args_info.barrier_file_given) {
-        print_rates(args_info.barrier_file_arg, args_info.temp_arg, num, energy_barr, output_en, true);
+        if (args_info.sparse_flag) print_saddles_sparse(args_info.barrier_file_arg, saddle_list);
+        else print_rates(args_info.barrier_file_arg, args_info.temp_arg, num, energy_barr, output_en, true);
       }
 
       // generate barrier tree?
@@ -505,7 +614,8 @@ int main(int argc, char **argv)
         //PS_tree_plot(nodes, num, "tst.ps");
 
         // make tree (fill missing nodes)
-        make_tree(num, energy_barr, findpath_barr, nodes.get());
+        if (args_info.sparse_flag) make_tree(saddle_list, nodes.get());
+        else make_tree(num, energy_barr, findpath_barr, nodes.get());
 
         // plot it!
         PS_tree_plot(nodes.get(), num, args_info.barr_name_arg);
@@ -550,8 +660,6 @@ int main(int argc, char **argv)
     for(unsigned int i=0; i<output_he.size(); i++) {
       free(output_he[i].structure);
     }
-    // free hash
-    free_hash(structs);
 
     // release res:
     if (energy_barr!=NULL) free(energy_barr);
@@ -834,7 +942,7 @@ char *read_seq(char *seq_arg, char **name_out)
 }
 
 
-int move(unordered_map<struct_en, gw_struct, hash_fncts, hash_eq> &structs, map<struct_en, int, comps_entries> &output, set<struct_en, comps_entries> &output_shallow, SeqInfo &sqi, bool pure_output)
+int read_structure(walk_item &item, SeqInfo &sqi)
 {
   // read a line
   char *line = my_getline(stdin);
@@ -881,6 +989,7 @@ int move(unordered_map<struct_en, gw_struct, hash_fncts, hash_eq> &structs, map<
 
   // count moves
   num_moves++;
+  item.num = num_moves;
 
   // find length of structure
   int len=0;
@@ -893,51 +1002,75 @@ int move(unordered_map<struct_en, gw_struct, hash_fncts, hash_eq> &structs, map<
   }
 
   // make make_pair
-  struct_en str;
-  str.structure = Opt.pknots? make_pair_table_PK(p):make_pair_table(p);
+  item.old.structure = Opt.pknots? make_pair_table_PK(p):make_pair_table(p);
 
   // only H,K,L,M types allowed:
-  if (!str.structure) {
+  if (!item.old.structure) {
     free(line);
     return 0;
   } else {
-    str.energy = Opt.pknots? energy_of_struct_pk(sqi.seq, str.structure, sqi.s0, sqi.s1, Opt.verbose_lvl>3):energy_of_structure_pt(sqi.seq, str.structure, sqi.s0, sqi.s1, 0);
+    item.old.energy = Opt.pknots? energy_of_struct_pk(sqi.seq, item.old.structure, sqi.s0, sqi.s1, Opt.verbose_lvl>3):energy_of_structure_pt(sqi.seq, item.old.structure, sqi.s0, sqi.s1, 0);
     free(line);
   }
 
+  item.str.structure = NULL;
+  item.gw_length = 0;
+  item.skip = false;
+
+  return 1;
+}
+
+void descend(walk_item &item, SeqInfo &sqi)
+{
+  //is it canonical (noLP) - then record() complains about it
+  if (Opt.noLP && find_lone_pair(item.old.structure)!=-1) return;
+
+  // copy it anew
+  item.str.structure = allocopy(item.old.structure);
+  item.str.energy = item.old.energy;
+
+  // descend
+  item.gw_length = move_set(item.str, sqi);
+}
+
+int record(walk_item &item, StructTable &structs, map<struct_en, int, comps_entries> &output, set<struct_en, comps_entries> &output_shallow, SeqInfo &sqi, bool pure_output)
+{
   // if pure, just do descend and print it:
   if (pure_output) {
     //is it canonical (noLP)
-    if (Opt.noLP && find_lone_pair(str.structure)!=-1) {
-      if (Opt.verbose_lvl>0) fprintf(stderr, "WARNING: structure \"%s\" has lone pairs, skipping...\n", pt_to_str_pk(str.structure).c_str());
-      free(str.structure);
+    if (Opt.noLP && find_lone_pair(item.old.structure)!=-1) {
+      if (Opt.verbose_lvl>0) fprintf(stderr, "WARNING: structure \"%s\" has lone pairs, skipping...\n", pt_to_str_pk(item.old.structure).c_str());
+      free(item.old.structure);
       return -2;
     }
 
     //debugging
-    if (Opt.verbose_lvl>1) fprintf(stderr, "proc(pure): %d %s\n", num_moves, pt_to_str_pk(str.structure).c_str());
+    if (Opt.verbose_lvl>1) fprintf(stderr, "proc(pure): %d %s\n", item.num, pt_to_str_pk(item.old.structure).c_str());
 
-    // descend
-    int gw_length = move_set(str, sqi);
+    // descend (if not done concurrently already)
+    if (!item.str.structure) descend(item, sqi);
+    free(item.old.structure);
+    struct_en &str = item.str;
     // only some types of PK allowed!!!
     if (Opt.pknots && str.energy == INT_MAX) {
       free(str.structure);
       return 0;
     }
 
-    if (Opt.verbose_lvl>2) fprintf(stderr, "\n  %s %d %d\n", pt_to_str_pk(str.structure).c_str(), str.energy, gw_length);
-    printf("%s %6.2f %4d\n", pt_to_str_pk(str.structure).c_str(), str.energy/100.0, gw_length);
+    if (Opt.verbose_lvl>2) fprintf(stderr, "\n  %s %d %d\n", pt_to_str_pk(str.structure).c_str(), str.energy, item.gw_length);
+    printf("%s %6.2f %4d\n", pt_to_str_pk(str.structure).c_str(), str.energy/100.0, item.gw_length);
     free(str.structure);
     return 1;
   }
 
   // check if it was before
-  unordered_map<struct_en, gw_struct, hash_fncts, hash_eq>::iterator it_s = structs.find(str);
+  gw_struct *it_s = structs.Find(item.old);
 
   // if it was - release memory + get another
-  if (it_s != structs.end()) {
-    it_s->second.count++;
-    free(str.structure);
+  if (it_s) {
+    it_s->count++;
+    free(item.old.structure);
+    if (item.str.structure) free(item.str.structure);
     return 0;
   } else {
     // find energy only if not in input (not working - does energy_of_move require energy_of_struct run first???)
@@ -946,28 +1079,28 @@ int move(unordered_map<struct_en, gw_struct, hash_fncts, hash_eq> &structs, map<
     /*if (1 || !energy_found) str.energy = Enc.Energy(str);
     else str.energy = (int)(energy*100.0+(energy<0.0 ? -0.5 : 0.5));*/
 
-    // allegiance hack:
-    struct_en he_str = str;
+    struct_en old = item.old;
+
+    // allegiance hack (own copy, the table may pack the structure):
+    struct_en he_str = old;
     if (allegiance) {
+      he_str.structure = allocopy(old.structure);
       structures.push_back(he_str);
     }
 
     //is it canonical (noLP)
-    if (Opt.noLP && find_lone_pair(str.structure)!=-1) {
-      if (Opt.verbose_lvl>0) fprintf(stderr, "WARNING: structure \"%s\" has lone pairs, skipping...\n", pt_to_str_pk(str.structure).c_str());
-      free(str.structure);
+    if (Opt.noLP && find_lone_pair(old.structure)!=-1) {
+      if (Opt.verbose_lvl>0) fprintf(stderr, "WARNING: structure \"%s\" has lone pairs, skipping...\n", pt_to_str_pk(old.structure).c_str());
+      free(old.structure);
       return -2;
     }
 
-    // copy it anew
-    struct_en old = str;
-    str.structure = allocopy(str.structure);
-
     //debugging
-    if (Opt.verbose_lvl>1) fprintf(stderr, "processing: %d %s\n", num_moves, pt_to_str_pk(str.structure).c_str());
+    if (Opt.verbose_lvl>1) fprintf(stderr, "processing: %d %s\n", item.num, pt_to_str_pk(old.structure).c_str());
 
-    // descend
-    move_set(str, sqi);
+    // descend (if not done concurrently already)
+    if (!item.str.structure) descend(item, sqi);
+    struct_en str = item.str;
     // only some types of PK allowed!!!
     if (Opt.pknots && str.energy == INT_MAX) {
       free(str.structure);
@@ -976,7 +1109,7 @@ int move(unordered_map<struct_en, gw_struct, hash_fncts, hash_eq> &structs, map<
     }
 
     // insert into hash (memory is here only on left side)
-    gw_struct &lm = structs[old];
+    gw_struct &lm = structs.Insert(old);
     lm.count = 1;
     /*
     int i;
@@ -15,6 +15,7 @@
 #include <ctype.h>
 #include <string.h>
 #include "ViennaRNA/utils/basic.h"
+#include "ViennaRNA/utils/cpu.h"
 #include "ViennaRNA/params/default.h"
 #include "ViennaRNA/fold_vars.h"
 #include "ViennaRNA/fold.h"
@@ -38,6 +39,34 @@ int compute_2Dfold_F3 = 0;
  #################################
  */
 
+/*
+ *  A cell (i,j) of the dynamic programming matrices together with the
+ *  estimated size of its distance class plane. Cells are handed out to
+ *  the threads in order of decreasing weight, see prepareCells()
+ */
+typedef struct {
+  unsigned int  i;
+  unsigned int  j;
+  unsigned int  weight;
+} cell_t;
+
+/*
+ *  A thread private copy of a distance class plane. Threads that
+ *  contribute to the same plane accumulate into their own copy,
+ *  which is merged into the shared plane once they are done
+ */
+typedef struct {
+  int **E;
+  int rem;
+  int k_min, k_max, *l_min, *l_max;
+  int k_min_real, k_max_real, *l_min_real, *l_max_real;
+} plane_t;
+
+typedef void (proto_min_plus)(int       *target,
+                              const int *source,
+                              int       n,
+                              int       e);
+
 /*
  #################################
  # PRIVATE FUNCTION DECLARATIONS #
@@ -148,6 +177,68 @@ INLINE PRIVATE void  prepareArray2(unsigned long  ***array,
                                    int            *max_l);
 
 
+PRIVATE unsigned int  prepareCells(vrna_fold_compound_t *vc,
+                                   unsigned int         d_min,
+                                   unsigned int         d_max,
+                                   cell_t               *cells);
+
+
+PRIVATE void  preparePlane(plane_t  *plane,
+                           int      max_k,
+                           int      max_l,
+                           int      bpdist);
+
+
+PRIVATE void  mergePlane(plane_t  *plane,
+                         int      **E,
+                         int      *rem,
+                         int      *min_k,
+                         int      *max_k,
+                         int      **min_l,
+                         int      **max_l);
+
+
+INLINE PRIVATE void  propagateRow(int       **target,
+                                  int       k,
+                                  int       dl,
+                                  const int *source,
+                                  int       l_min,
+                                  int       l_max,
+                                  int       e,
+                                  int       maxD1,
+                                  int       maxD2,
+                                  int       *rem,
+                                  int       *min_k,
+                                  int       *max_k,
+                                  int       **min_l,
+                                  int       **max_l);
+
+
+PRIVATE void  min_plus_dispatcher(int       *target,
+                                  const int *source,
+                                  int       n,
+                                  int       e);
+
+
+PRIVATE void  min_plus_default(int        *target,
+                               const int  *source,
+                               int        n,
+                               int        e);
+
+
+#if VRNA_WITH_SIMD_SSE41
+void
+vrna_2Dfold_min_plus_sse41(int        *target,
+                           const int  *source,
+                           int        n,
+                           int        e);
+
+
+#endif
+
+PRIVATE proto_min_plus *min_plus = &min_plus_dispatcher;
+
+
 /*
  #################################
  # BEGIN OF FUNCTION DEFINITIONS #
@@ -382,10 +473,12 @@ vrna_backtrack5_TwoD(vrna_fold_compound_t *vc,
 PRIVATE void
 mfe_linear(vrna_fold_compound_t *vc)
 {
-  unsigned int  d, i, j, ij, maxD1, maxD2, seq_length, dia, dib, dja, djb, *referenceBPs1, *referenceBPs2, *mm1, *mm2, *bpdist;
+  unsigned int  d, i, j, ij, maxD1, maxD2, seq_length, dia, dib, dja, djb, *referenceBPs1, *referenceBPs2, *mm1, *mm2, *bpdist,
+                c, n_cells;
   int           cnt1, cnt2, cnt3, cnt4, d1, d2, energy, dangles, temp2, type, additional_en, *my_iindx, *jindx, circ, *rtype;
   short         *S1, *reference_pt1, *reference_pt2;
   char          *sequence, *ptype;
+  cell_t        *cells;
   vrna_param_t  *P;
   vrna_mx_mfe_t *matrices;
   vrna_md_t     *md;
@@ -412,17 +505,21 @@ mfe_linear(vrna_fold_compound_t *vc)
   bpdist        = vc->bpdist;
   dangles       = md->dangles;
   circ          = md->circ;
+  cells         = (cell_t *)vrna_alloc(sizeof(cell_t) * (seq_length + 1));
 
   for (d = TURN + 2; d <= seq_length; d++) {
     /* i,j in [1..length] */
+    n_cells = prepareCells(vc, d, d, cells);
+
 #ifdef _OPENMP
-#pragma omp parallel for private(additional_en, j, energy, temp2, i, ij, dia,dib,dja,djb,cnt1,cnt2,cnt3,cnt4, d1, d2)
+#pragma omp parallel for private(additional_en, j, energy, temp2, i, ij, dia,dib,dja,djb,cnt1,cnt2,cnt3,cnt4, d1, d2) schedule(dynamic, 1)
 #endif
-    for (j = d; j <= seq_length; j++) {
+    for (c = 0; c < n_cells; c++) {
       unsigned int  p, q, pq, u, maxp, dij;
       int           type_2, type, tt, no_close, base_d1, base_d2;
 
-      i     = j - d + 1;
+      i     = cells[c].i;
+      j     = cells[c].j;
       dij   = j - i - 1;
       ij    = my_iindx[i] - j;
       type  = ptype[jindx[j] + i];
@@ -541,29 +638,27 @@ mfe_linear(vrna_fold_compound_t *vc)
 
             if (matrices->E_C[pq] != NULL) {
               for (cnt1 = matrices->k_min_C[pq]; cnt1 <= matrices->k_max_C[pq]; cnt1++) {
-                for (cnt2 = matrices->l_min_C[pq][cnt1]; cnt2 <= matrices->l_max_C[pq][cnt1]; cnt2 += 2) {
-                  if (matrices->E_C[pq][cnt1][cnt2 / 2] != INF) {
-                    if (((cnt1 + d1) <= maxD1) && ((cnt2 + d2) <= maxD2)) {
-                      matrices->E_C[ij][cnt1 + d1][(cnt2 + d2) / 2] = MIN2(matrices->E_C[ij][cnt1 + d1][(cnt2 + d2) / 2],
-                                                                           matrices->E_C[pq][cnt1][cnt2 / 2] + energy
-                                                                           );
-                      updatePosteriorBoundaries(cnt1 + d1,
-                                                cnt2 + d2,
-                                                &real_min_k,
-                                                &real_max_k,
-                                                &min_l_real,
-                                                &max_l_real
-                                                );
+                /* cases where d1+cnt1 or d2+cnt2 exceeds maxD1, maxD2, respectively, go to E_C_rem */
+                propagateRow(matrices->E_C[ij],
+                             cnt1 + d1,
+                             d2,
+                             matrices->E_C[pq][cnt1],
+                             matrices->l_min_C[pq][cnt1],
+                             matrices->l_max_C[pq][cnt1],
+                             energy,
+                             maxD1,
+                             maxD2,
+                             &matrices->E_C_rem[ij],
+                             &real_min_k,
+                             &real_max_k,
+                             &min_l_real,
+                             &max_l_real
+                             );
 #ifdef COUNT_STATES
-                      matrices->N_C[ij][cnt1 + d1][(cnt2 + d2) / 2] += matrices->N_C[pq][cnt1][cnt2 / 2];
+                for (cnt2 = matrices->l_min_C[pq][cnt1]; cnt2 <= matrices->l_max_C[pq][cnt1]; cnt2 += 2)
+                  if ((matrices->E_C[pq][cnt1][cnt2 / 2] != INF) && ((cnt1 + d1) <= maxD1) && ((cnt2 + d2) <= maxD2))
+                    matrices->N_C[ij][cnt1 + d1][(cnt2 + d2) / 2] += matrices->N_C[pq][cnt1][cnt2 / 2];
 #endif
-                    }
-                    /* collect all cases where d1+cnt1 or d2+cnt2 exceeds maxD1, maxD2, respectively */
-                    else {
-                      matrices->E_C_rem[ij] = MIN2(matrices->E_C_rem[ij], matrices->E_C[pq][cnt1][cnt2 / 2] + energy);
-                    }
-                  }
-                }
               }
             }
 
@@ -645,41 +740,38 @@ mfe_linear(vrna_fold_compound_t *vc)
                  cnt1++)
               for (cnt2 = matrices->l_min_M[i1u][cnt1];
                    cnt2 <= matrices->l_max_M[i1u][cnt1];
-                   cnt2 += 2)
+                   cnt2 += 2) {
+                if (matrices->E_M[i1u][cnt1][cnt2 / 2] == INF)
+                  continue;
+
                 for (cnt3 = matrices->k_min_M1[u1j1];
                      cnt3 <= matrices->k_max_M1[u1j1];
-                     cnt3++)
+                     cnt3++) {
+                  /* cases where d1+cnt1+cnt3 or d2+cnt2+cnt4 exceeds maxD1, maxD2, respectively, go to E_C_rem */
+                  propagateRow(matrices->E_C[ij],
+                               cnt1 + cnt3 + d1,
+                               cnt2 + d2,
+                               matrices->E_M1[u1j1][cnt3],
+                               matrices->l_min_M1[u1j1][cnt3],
+                               matrices->l_max_M1[u1j1][cnt3],
+                               matrices->E_M[i1u][cnt1][cnt2 / 2] + temp2,
+                               maxD1,
+                               maxD2,
+                               &matrices->E_C_rem[ij],
+                               &real_min_k,
+                               &real_max_k,
+                               &min_l_real,
+                               &max_l_real
+                               );
+#ifdef COUNT_STATES
                   for (cnt4 = matrices->l_min_M1[u1j1][cnt3];
                        cnt4 <= matrices->l_max_M1[u1j1][cnt3];
-                       cnt4 += 2) {
-                    if ((matrices->E_M[i1u][cnt1][cnt2 / 2] != INF) && (matrices->E_M1[u1j1][cnt3][cnt4 / 2] != INF)) {
-                      if (((cnt1 + cnt3 + d1) <= maxD1) && ((cnt2 + cnt4 + d2) <= maxD2)) {
-                        matrices->E_C[ij][cnt1 + cnt3 + d1][(cnt2 + cnt4 + d2) / 2] = MIN2(matrices->E_C[ij][cnt1 + cnt3 + d1][(cnt2 + cnt4 + d2) / 2],
-                                                                                           matrices->E_M[i1u][cnt1][cnt2 / 2]
-                                                                                           + matrices->E_M1[u1j1][cnt3][cnt4 / 2]
-                                                                                           + temp2
-                                                                                           );
-                        updatePosteriorBoundaries(cnt1 + cnt3 + d1,
-                                                  cnt2 + cnt4 + d2,
-                                                  &real_min_k,
-                                                  &real_max_k,
-                                                  &min_l_real,
-                                                  &max_l_real
-                                                  );
-#ifdef COUNT_STATES
-                        matrices->N_C[ij][cnt1 + cnt3 + d1][(cnt2 + cnt4 + d2) / 2] += matrices->N_M[i1u][cnt1][cnt2 / 2] * matrices->N_M1[u1j1][cnt3][cnt4 / 2];
+                       cnt4 += 2)
+                    if ((matrices->E_M1[u1j1][cnt3][cnt4 / 2] != INF) && ((cnt1 + cnt3 + d1) <= maxD1) && ((cnt2 + cnt4 + d2) <= maxD2))
+                      matrices->N_C[ij][cnt1 + cnt3 + d1][(cnt2 + cnt4 + d2) / 2] += matrices->N_M[i1u][cnt1][cnt2 / 2] * matrices->N_M1[u1j1][cnt3][cnt4 / 2];
 #endif
-                      }
-                      /* collect all cases where d1+cnt1+cnt3 or d2+cnt2+cnt4 exceeds maxD1, maxD2, respectively */
-                      else {
-                        matrices->E_C_rem[ij] = MIN2(matrices->E_C_rem[ij],
-                                                     matrices->E_M[i1u][cnt1][cnt2 / 2]
-                                                     + matrices->E_M1[u1j1][cnt3][cnt4 / 2]
-                                                     + temp2
-                                                     );
-                      }
-                    }
-                  }
+                }
+              }
           }
         }
 
@@ -829,33 +921,29 @@ mfe_linear(vrna_fold_compound_t *vc)
         for (cnt1 = matrices->k_min_M[my_iindx[i + 1] - j];
              cnt1 <= matrices->k_max_M[my_iindx[i + 1] - j];
              cnt1++) {
+          /* cases where dia+cnt1 or dib+cnt2 exceeds maxD1, maxD2, respectively, go to E_M_rem */
+          propagateRow(matrices->E_M[ij],
+                       cnt1 + dia,
+                       dib,
+                       matrices->E_M[my_iindx[i + 1] - j][cnt1],
+                       matrices->l_min_M[my_iindx[i + 1] - j][cnt1],
+                       matrices->l_max_M[my_iindx[i + 1] - j][cnt1],
+                       P->MLbase,
+                       maxD1,
+                       maxD2,
+                       &matrices->E_M_rem[ij],
+                       &min_k_real_m,
+                       &max_k_real_m,
+                       &min_l_real_m,
+                       &max_l_real_m
+                       );
+#ifdef COUNT_STATES
           for (cnt2 = matrices->l_min_M[my_iindx[i + 1] - j][cnt1];
                cnt2 <= matrices->l_max_M[my_iindx[i + 1] - j][cnt1];
-               cnt2 += 2) {
-            if (matrices->E_M[my_iindx[i + 1] - j][cnt1][cnt2 / 2] != INF) {
-              if (((cnt1 + dia) <= maxD1) && ((cnt2 + dib) <= maxD2)) {
-                matrices->E_M[ij][cnt1 + dia][(cnt2 + dib) / 2] = MIN2(matrices->E_M[ij][cnt1 + dia][(cnt2 + dib) / 2],
-                                                                       matrices->E_M[my_iindx[i + 1] - j][cnt1][cnt2 / 2] + P->MLbase
-                                                                       );
-                updatePosteriorBoundaries(cnt1 + dia,
-                                          cnt2 + dib,
-                                          &min_k_real_m,
-                                          &max_k_real_m,
-                                          &min_l_real_m,
-                                          &max_l_real_m
-                                          );
-#ifdef COUNT_STATES
-                matrices->N_M[ij][cnt1 + dia][(cnt2 + dib) / 2] += matrices->N_M[my_iindx[i + 1] - j][cnt1][cnt2 / 2];
+               cnt2 += 2)
+            if ((matrices->E_M[my_iindx[i + 1] - j][cnt1][cnt2 / 2] != INF) && ((cnt1 + dia) <= maxD1) && ((cnt2 + dib) <= maxD2))
+              matrices->N_M[ij][cnt1 + dia][(cnt2 + dib) / 2] += matrices->N_M[my_iindx[i + 1] - j][cnt1][cnt2 / 2];
 #endif
-              }
-              /* collect all cases where dia+cnt1 or dib+cnt2 exceeds maxD1, maxD2, respectively */
-              else {
-                matrices->E_M_rem[ij] = MIN2(matrices->E_M_rem[ij],
-                                             matrices->E_M[my_iindx[i + 1] - j][cnt1][cnt2 / 2] + P->MLbase
-                                             );
-              }
-            }
-          }
         }
       }
 
@@ -870,33 +958,29 @@ mfe_linear(vrna_fold_compound_t *vc)
         for (cnt1 = matrices->k_min_M[ij + 1];
              cnt1 <= matrices->k_max_M[ij + 1];
              cnt1++) {
+          /* cases where dja+cnt1 or djb+cnt2 exceeds maxD1, maxD2, respectively, go to E_M_rem */
+          propagateRow(matrices->E_M[ij],
+                       cnt1 + dja,
+                       djb,
+                       matrices->E_M[ij + 1][cnt1],
+                       matrices->l_min_M[ij + 1][cnt1],
+                       matrices->l_max_M[ij + 1][cnt1],
+                       P->MLbase,
+                       maxD1,
+                       maxD2,
+                       &matrices->E_M_rem[ij],
+                       &min_k_real_m,
+                       &max_k_real_m,
+                       &min_l_real_m,
+                       &max_l_real_m
+                       );
+#ifdef COUNT_STATES
           for (cnt2 = matrices->l_min_M[ij + 1][cnt1];
                cnt2 <= matrices->l_max_M[ij + 1][cnt1];
-               cnt2 += 2) {
-            if (matrices->E_M[ij + 1][cnt1][cnt2 / 2] != INF) {
-              if (((cnt1 + dja) <= maxD1) && ((cnt2 + djb) <= maxD2)) {
-                matrices->E_M[ij][cnt1 + dja][(cnt2 + djb) / 2] = MIN2(matrices->E_M[ij][cnt1 + dja][(cnt2 + djb) / 2],
-                                                                       matrices->E_M[ij + 1][cnt1][cnt2 / 2] + P->MLbase
-                                                                       );
-                updatePosteriorBoundaries(cnt1 + dja,
-                                          cnt2 + djb,
-                                          &min_k_real_m,
-                                          &max_k_real_m,
-                                          &min_l_real_m,
-                                          &max_l_real_m
-                                          );
-#ifdef COUNT_STATES
-                matrices->N_M[ij][cnt1 + dja][(cnt2 + djb) / 2] += matrices->N_M[ij + 1][cnt1][cnt2 / 2];
+               cnt2 += 2)
+            if ((matrices->E_M[ij + 1][cnt1][cnt2 / 2] != INF) && ((cnt1 + dja) <= maxD1) && ((cnt2 + djb) <= maxD2))
+              matrices->N_M[ij][cnt1 + dja][(cnt2 + djb) / 2] += matrices->N_M[ij + 1][cnt1][cnt2 / 2];
 #endif
-              }
-              /* collect all cases where dja+cnt1 or djb+cnt2 exceeds maxD1, maxD2, respectively */
-              else {
-                matrices->E_M_rem[ij] = MIN2(matrices->E_M_rem[ij],
-                                             matrices->E_M[ij + 1][cnt1][cnt2 / 2] + P->MLbase
-                                             );
-              }
-            }
-          }
         }
       }
 
@@ -911,33 +995,29 @@ mfe_linear(vrna_fold_compound_t *vc)
         for (cnt1 = matrices->k_min_M1[ij + 1];
              cnt1 <= matrices->k_max_M1[ij + 1];
              cnt1++) {
+          /* cases where dja+cnt1 or djb+cnt2 exceeds maxD1, maxD2, respectively, go to E_M1_rem */
+          propagateRow(matrices->E_M1[ij],
+                       cnt1 + dja,
+                       djb,
+                       matrices->E_M1[ij + 1][cnt1],
+                       matrices->l_min_M1[ij + 1][cnt1],
+                       matrices->l_max_M1[ij + 1][cnt1],
+                       P->MLbase,
+                       maxD1,
+                       maxD2,
+                       &matrices->E_M1_rem[ij],
+                       &min_k_real_m1,
+                       &max_k_real_m1,
+                       &min_l_real_m1,
+                       &max_l_real_m1
+                       );
+#ifdef COUNT_STATES
           for (cnt2 = matrices->l_min_M1[ij + 1][cnt1];
                cnt2 <= matrices->l_max_M1[ij + 1][cnt1];
-               cnt2 += 2) {
-            if (matrices->E_M1[ij + 1][cnt1][cnt2 / 2] != INF) {
-              if (((cnt1 + dja) <= maxD1) && ((cnt2 + djb) <= maxD2)) {
-                matrices->E_M1[ij][cnt1 + dja][(cnt2 + djb) / 2] = MIN2(matrices->E_M1[ij][cnt1 + dja][(cnt2 + djb) / 2],
-                                                                        matrices->E_M1[ij + 1][cnt1][cnt2 / 2] + P->MLbase
-                                                                        );
-                updatePosteriorBoundaries(cnt1 + dja,
-                                          cnt2 + djb,
-                                          &min_k_real_m1,
-                                          &max_k_real_m1,
-                                          &min_l_real_m1,
-                                          &max_l_real_m1
-                                          );
-#ifdef COUNT_STATES
-                matrices->N_M1[ij][cnt1 + dja][(cnt2 + djb) / 2] += matrices->N_M1[ij + 1][cnt1][cnt2 / 2];
+               cnt2 += 2)
+            if ((matrices->E_M1[ij + 1][cnt1][cnt2 / 2] != INF) && ((cnt1 + dja) <= maxD1) && ((cnt2 + djb) <= maxD2))
+              matrices->N_M1[ij][cnt1 + dja][(cnt2 + djb) / 2] += matrices->N_M1[ij + 1][cnt1][cnt2 / 2];
 #endif
-              }
-              /* collect all cases where dja+cnt1 or djb+cnt2 exceeds maxD1, maxD2, respectively */
-              else {
-                matrices->E_M1_rem[ij] = MIN2(matrices->E_M1_rem[ij],
-                                              matrices->E_M1[ij + 1][cnt1][cnt2 / 2] + P->MLbase
-                                              );
-              }
-            }
-          }
         }
       }
 
@@ -997,37 +1077,35 @@ mfe_linear(vrna_fold_compound_t *vc)
             for (cnt2 = matrices->l_min_M[my_iindx[i] - u][cnt1];
                  cnt2 <= matrices->l_max_M[my_iindx[i] - u][cnt1];
                  cnt2 += 2) {
+              if (matrices->E_M[my_iindx[i] - u][cnt1][cnt2 / 2] == INF)
+                continue;
+
               for (cnt3 = matrices->k_min_M[my_iindx[u + 1] - j];
                    cnt3 <= matrices->k_max_M[my_iindx[u + 1] - j];
                    cnt3++) {
+                /* cases where dia+cnt1+cnt3 or dib+cnt2+cnt4 exceeds maxD1, maxD2, respectively, go to E_M_rem */
+                propagateRow(matrices->E_M[ij],
+                             cnt1 + cnt3 + dia,
+                             cnt2 + dib,
+                             matrices->E_M[my_iindx[u + 1] - j][cnt3],
+                             matrices->l_min_M[my_iindx[u + 1] - j][cnt3],
+                             matrices->l_max_M[my_iindx[u + 1] - j][cnt3],
+                             matrices->E_M[my_iindx[i] - u][cnt1][cnt2 / 2],
+                             maxD1,
+                             maxD2,
+                             &matrices->E_M_rem[ij],
+                             &min_k_real_m,
+                             &max_k_real_m,
+                             &min_l_real_m,
+                             &max_l_real_m
+                             );
+#ifdef COUNT_STATES
                 for (cnt4 = matrices->l_min_M[my_iindx[u + 1] - j][cnt3];
                      cnt4 <= matrices->l_max_M[my_iindx[u + 1] - j][cnt3];
-                     cnt4 += 2) {
-                  if ((matrices->E_M[my_iindx[i] - u][cnt1][cnt2 / 2] != INF) && (matrices->E_M[my_iindx[u + 1] - j][cnt3][cnt4 / 2] != INF)) {
-                    if (((cnt1 + cnt3 + dia) <= maxD1) && ((cnt2 + cnt4 + dib) <= maxD2)) {
-                      matrices->E_M[ij][cnt1 + cnt3 + dia][(cnt2 + cnt4 + dib) / 2] = MIN2(matrices->E_M[ij][cnt1 + cnt3 + dia][(cnt2 + cnt4 + dib) / 2],
-                                                                                           matrices->E_M[my_iindx[i] - u][cnt1][cnt2 / 2]
-                                                                                           + matrices->E_M[my_iindx[u + 1] - j][cnt3][cnt4 / 2]
-                                                                                           );
-                      updatePosteriorBoundaries(cnt1 + cnt3 + dia,
-                                                cnt2 + cnt4 + dib,
-                                                &min_k_real_m,
-                                                &max_k_real_m,
-                                                &min_l_real_m,
-                                                &max_l_real_m
-                                                );
-#ifdef COUNT_STATES
-                      matrices->N_M[ij][cnt1 + cnt3 + dia][(cnt2 + cnt4 + dib) / 2] += matrices->N_M[my_iindx[i] - u][cnt1][cnt2 / 2] * matrices->N_M1[my_iindx[u + 1] - j][cnt3][cnt4 / 2];
+                     cnt4 += 2)
+                  if ((matrices->E_M[my_iindx[u + 1] - j][cnt3][cnt4 / 2] != INF) && ((cnt1 + cnt3 + dia) <= maxD1) && ((cnt2 + cnt4 + dib) <= maxD2))
+                    matrices->N_M[ij][cnt1 + cnt3 + dia][(cnt2 + cnt4 + dib) / 2] += matrices->N_M[my_iindx[i] - u][cnt1][cnt2 / 2] * matrices->N_M1[my_iindx[u + 1] - j][cnt3][cnt4 / 2];
 #endif
-                    }
-                    /* collect all cases where dia+cnt1+cnt3 or dib+cnt2+cnt4 exceeds maxD1, maxD2, respectively */
-                    else {
-                      matrices->E_M_rem[ij] = MIN2(matrices->E_M_rem[ij],
-                                                   matrices->E_M[my_iindx[i] - u][cnt1][cnt2 / 2] + matrices->E_M[my_iindx[u + 1] - j][cnt3][cnt4 / 2]
-                                                   );
-                    }
-                  }
-                }
               }
             }
           }
@@ -1064,6 +1142,8 @@ mfe_linear(vrna_fold_compound_t *vc)
     } /* end of j-loop */
   }
 
+  free(cells);
+
   /* calculate energies of 5' and 3' fragments */
 
   /* prepare first entries in E_F5 */
@@ -2996,10 +3076,12 @@ backtrack_m2(unsigned int         i,
 PRIVATE void
 mfe_circ(vrna_fold_compound_t *vc)
 {
-  unsigned int  d, i, j, maxD1, maxD2, seq_length, *referenceBPs1, *referenceBPs2, d1, d2, base_d1, base_d2, *mm1, *mm2, *bpdist;
-  int           *my_iindx, *jindx, energy, cnt1, cnt2, cnt3, cnt4, *rtype;
+  unsigned int  i, j, maxD1, maxD2, seq_length, *referenceBPs1, *referenceBPs2, d1, d2, base_d1, base_d2, *mm1, *mm2, *bpdist,
+                n_cells;
+  int           *my_iindx, *jindx, energy, cnt1, cnt2, cnt3, *rtype;
   short         *S1;
   char          *sequence, *ptype;
+  cell_t        *cells;
   int           ***E_C, ***E_M, ***E_M1;
   int           *E_C_rem, *E_M_rem, *E_M1_rem;
   int           **l_min_C, **l_max_C, **l_min_M, **l_max_M, **l_min_M1, **l_max_M1;
@@ -3050,7 +3132,7 @@ mfe_circ(vrna_fold_compound_t *vc)
   E_M1_rem  = matrices->E_M1_rem;
 
 #ifdef _OPENMP
-#pragma omp parallel for private(d1,d2,cnt1,cnt2,cnt3,cnt4,j, i)
+#pragma omp parallel for private(d1,d2,cnt1,cnt2,cnt3,j, i) schedule(dynamic)
 #endif
   for (i = 1; i < seq_length - TURN - 1; i++) {
     /* guess memory requirements for M2 */
@@ -3132,25 +3214,25 @@ mfe_circ(vrna_fold_compound_t *vc)
 
       for (cnt1 = k_min_M1[my_iindx[i] - j]; cnt1 <= k_max_M1[my_iindx[i] - j]; cnt1++)
         for (cnt2 = l_min_M1[my_iindx[i] - j][cnt1]; cnt2 <= l_max_M1[my_iindx[i] - j][cnt1]; cnt2 += 2) {
+          if (E_M1[my_iindx[i] - j][cnt1][cnt2 / 2] == INF)
+            continue;
+
           for (cnt3 = k_min_M1[my_iindx[j + 1] - seq_length]; cnt3 <= k_max_M1[my_iindx[j + 1] - seq_length]; cnt3++)
-            for (cnt4 = l_min_M1[my_iindx[j + 1] - seq_length][cnt3]; cnt4 <= l_max_M1[my_iindx[j + 1] - seq_length][cnt3]; cnt4 += 2) {
-              if (((cnt1 + cnt3 + d1) <= maxD1) && ((cnt2 + cnt4 + d2) <= maxD2)) {
-                matrices->E_M2[i][cnt1 + cnt3 + d1][(cnt2 + cnt4 + d2) / 2] = MIN2(matrices->E_M2[i][cnt1 + cnt3 + d1][(cnt2 + cnt4 + d2) / 2],
-                                                                                   E_M1[my_iindx[i] - j][cnt1][cnt2 / 2] + E_M1[my_iindx[j + 1] - seq_length][cnt3][cnt4 / 2]
-                                                                                   );
-                updatePosteriorBoundaries(cnt1 + cnt3 + d1,
-                                          cnt2 + cnt4 + d2,
-                                          &min_k_real,
-                                          &max_k_real,
-                                          &min_l_real,
-                                          &max_l_real
-                                          );
-              } else {
-                matrices->E_M2_rem[i] = MIN2(matrices->E_M2_rem[i],
-                                             E_M1[my_iindx[i] - j][cnt1][cnt2 / 2] + E_M1[my_iindx[j + 1] - seq_length][cnt3][cnt4 / 2]
-                                             );
-              }
-            }
+            propagateRow(matrices->E_M2[i],
+                         cnt1 + cnt3 + d1,
+                         cnt2 + d2,
+                         E_M1[my_iindx[j + 1] - seq_length][cnt3],
+                         l_min_M1[my_iindx[j + 1] - seq_length][cnt3],
+                         l_max_M1[my_iindx[j + 1] - seq_length][cnt3],
+                         E_M1[my_iindx[i] - j][cnt1][cnt2 / 2],
+                         maxD1,
+                         maxD2,
+                         &matrices->E_M2_rem[i],
+                         &min_k_real,
+                         &max_k_real,
+                         &min_l_real,
+                         &max_l_real
+                         );
         }
     }
 
@@ -3185,12 +3267,6 @@ mfe_circ(vrna_fold_compound_t *vc)
   max_k = mm1[my_iindx[1] - seq_length] + referenceBPs1[my_iindx[1] - seq_length];
   max_l = mm2[my_iindx[1] - seq_length] + referenceBPs2[my_iindx[1] - seq_length];
 
-#ifdef _OPENMP
-#pragma omp sections
-  {
-#pragma omp section
-    {
-#endif
   prepareBoundaries(min_k,
                     max_k,
                     min_l,
@@ -3207,13 +3283,7 @@ mfe_circ(vrna_fold_compound_t *vc)
                matrices->l_min_Fc,
                matrices->l_max_Fc
                );
-#ifdef _OPENMP
-}
 
-
-#pragma omp section
-{
-#endif
   prepareBoundaries(min_k,
                     max_k,
                     min_l,
@@ -3230,11 +3300,7 @@ mfe_circ(vrna_fold_compound_t *vc)
                matrices->l_min_FcH,
                matrices->l_max_FcH
                );
-#ifdef _OPENMP
-}
-#pragma omp section
-{
-#endif
+
   prepareBoundaries(min_k,
                     max_k,
                     min_l,
@@ -3251,11 +3317,7 @@ mfe_circ(vrna_fold_compound_t *vc)
                matrices->l_min_FcI,
                matrices->l_max_FcI
                );
-#ifdef _OPENMP
-}
-#pragma omp section
-{
-#endif
+
   prepareBoundaries(min_k,
                     max_k,
                     min_l,
@@ -3272,11 +3334,7 @@ mfe_circ(vrna_fold_compound_t *vc)
                matrices->l_min_FcM,
                matrices->l_max_FcM
                );
-#ifdef _OPENMP
-}
-#pragma omp section
-{
-#endif
+
   preparePosteriorBoundaries(max_k - min_k + 1,
                              min_k,
                              &min_k_real,
@@ -3284,11 +3342,7 @@ mfe_circ(vrna_fold_compound_t *vc)
                              &min_l_real,
                              &max_l_real
                              );
-#ifdef _OPENMP
-}
-#pragma omp section
-{
-#endif
+
   preparePosteriorBoundaries(max_k - min_k + 1,
                              min_k,
                              &min_k_real_fcH,
@@ -3296,11 +3350,7 @@ mfe_circ(vrna_fold_compound_t *vc)
                              &min_l_real_fcH,
                              &max_l_real_fcH
                              );
-#ifdef _OPENMP
-}
-#pragma omp section
-{
-#endif
+
   preparePosteriorBoundaries(max_k - min_k + 1,
                              min_k,
                              &min_k_real_fcI,
@@ -3309,11 +3359,6 @@ mfe_circ(vrna_fold_compound_t *vc)
                              &max_l_real_fcI
                              );
 
-#ifdef _OPENMP
-}
-#pragma omp section
-{
-#endif
   preparePosteriorBoundaries(max_k - min_k + 1,
                              min_k,
                              &min_k_real_fcM,
@@ -3321,24 +3366,36 @@ mfe_circ(vrna_fold_compound_t *vc)
                              &min_l_real_fcM,
                              &max_l_real_fcM
                              );
+
+  /*
+   *  begin actual energy calculations
+   *  Each thread collects the exterior hairpin, interior and multiloop
+   *  contributions in private copies of E_FcH, E_FcI, and E_FcM which
+   *  are merged into the shared matrices at the end
+   */
+  cells   = (cell_t *)vrna_alloc(sizeof(cell_t) * (seq_length * (seq_length + 1) / 2));
+  n_cells = prepareCells(vc, TURN + 2, seq_length, cells);
+
 #ifdef _OPENMP
-}
-}
+#pragma omp parallel private(d1,d2,cnt1,cnt2,cnt3,j, i, energy)
 #endif
+  {
+    unsigned int  c;
+    plane_t       fcH, fcI, fcM;
+
+    preparePlane(&fcH, max_k, max_l, bpdist[my_iindx[1] - seq_length]);
+    preparePlane(&fcI, max_k, max_l, bpdist[my_iindx[1] - seq_length]);
+    preparePlane(&fcM, max_k, max_l, bpdist[my_iindx[1] - seq_length]);
 
-  /* begin actual energy calculations */
 #ifdef _OPENMP
-#pragma omp sections private(d, d1,d2,cnt1,cnt2,cnt3,cnt4,j, i, energy)
-  {
-#pragma omp section
-    {
+#pragma omp for schedule(dynamic, 1) nowait
 #endif
-  for (d = TURN + 2; d <= seq_length; d++) /* i,j in [1..length] */
-    for (j = d; j <= seq_length; j++) {
-      unsigned int  u, ij;
-      int           type, no_close;
+    for (c = 0; c < n_cells; c++) {
+      unsigned int  u, ij, p, q, pq;
+      int           type, type_2, no_close;
       char          loopseq[10];
-      i   = j - d + 1;
+      i   = cells[c].i;
+      j   = cells[c].j;
       ij  = my_iindx[i] - j;
       u   = seq_length - j + i - 1;
       if (u < TURN)
@@ -3356,6 +3413,7 @@ mfe_circ(vrna_fold_compound_t *vc)
       if (no_close)
         continue;
 
+      /* exterior hairpin closed by (j,i) */
       d1  = base_d1 - referenceBPs1[ij];
       d2  = base_d2 - referenceBPs2[ij];
       if (u < 7) {
@@ -3366,69 +3424,28 @@ mfe_circ(vrna_fold_compound_t *vc)
       energy = E_Hairpin(u, type, S1[j + 1], S1[i - 1], loopseq, P);
 
       if (E_C_rem[ij] != INF)
-        matrices->E_FcH_rem = MIN2(matrices->E_FcH_rem, E_C_rem[ij] + energy);
-
-      if (!E_C[ij])
-        continue;
-
-      for (cnt1 = k_min_C[ij]; cnt1 <= k_max_C[ij]; cnt1++)
-        for (cnt2 = l_min_C[ij][cnt1]; cnt2 <= l_max_C[ij][cnt1]; cnt2 += 2) {
-          if (((cnt1 + d1) <= maxD1) && ((cnt2 + d2) <= maxD2)) {
-            matrices->E_FcH[cnt1 + d1][(cnt2 + d2) / 2] = MIN2(matrices->E_FcH[cnt1 + d1][(cnt2 + d2) / 2],
-                                                               energy + E_C[ij][cnt1][cnt2 / 2]
-                                                               );
-            updatePosteriorBoundaries(cnt1 + d1,
-                                      cnt2 + d2,
-                                      &min_k_real_fcH,
-                                      &max_k_real_fcH,
-                                      &min_l_real_fcH,
-                                      &max_l_real_fcH
-                                      );
-          } else {
-            matrices->E_FcH_rem = MIN2(matrices->E_FcH_rem, energy + E_C[ij][cnt1][cnt2 / 2]);
-          }
-        }
-    }
-  /* end of i-j loop */
-
-  /* resize and move memory portions of energy matrix E_FcH */
-  adjustArrayBoundaries(&matrices->E_FcH,
-                        &matrices->k_min_FcH,
-                        &matrices->k_max_FcH,
-                        &matrices->l_min_FcH,
-                        &matrices->l_max_FcH,
-                        min_k_real_fcH,
-                        max_k_real_fcH,
-                        min_l_real_fcH,
-                        max_l_real_fcH
-                        );
-#ifdef _OPENMP
-}
-#pragma omp section
-{
-#endif
-  for (d = TURN + 2; d <= seq_length; d++) /* i,j in [1..length] */
-    for (j = d; j <= seq_length; j++) {
-      unsigned int  u, ij, p, q, pq;
-      int           type, type_2, no_close;
-      i   = j - d + 1;
-      ij  = my_iindx[i] - j;
-      u   = seq_length - j + i - 1;
-      if (u < TURN)
-        continue;
-
-      type = ptype[jindx[j] + i];
-
-      no_close = (((type == 3) || (type == 4)) && no_closingGU);
-
-      type = rtype[type];
-
-      if (!type)
-        continue;
+        fcH.rem = MIN2(fcH.rem, E_C_rem[ij] + energy);
 
-      if (no_close)
-        continue;
+      if (E_C[ij]) {
+        for (cnt1 = k_min_C[ij]; cnt1 <= k_max_C[ij]; cnt1++)
+          propagateRow(fcH.E,
+                       cnt1 + d1,
+                       d2,
+                       E_C[ij][cnt1],
+                       l_min_C[ij][cnt1],
+                       l_max_C[ij][cnt1],
+                       energy,
+                       maxD1,
+                       maxD2,
+                       &fcH.rem,
+                       &fcH.k_min_real,
+                       &fcH.k_max_real,
+                       &fcH.l_min_real,
+                       &fcH.l_max_real
+                       );
+      }
 
+      /* exterior interior loops closed by (j,i) and (p,q) */
       if (E_C_rem[ij] != INF) {
         for (p = j + 1; p < seq_length; p++) {
           unsigned int u1, qmin, ln_pre;
@@ -3461,7 +3478,7 @@ mfe_circ(vrna_fold_compound_t *vc)
             energy  = E_IntLoop(u1, u2, type, type_2, S1[j + 1], S1[i - 1], S1[p - 1], S1[q + 1], P);
 
             if (E_C_rem[pq] != INF)
-              matrices->E_FcI_rem = MIN2(matrices->E_FcI_rem, E_C_rem[ij] + E_C_rem[pq] + energy);
+              fcI.rem = MIN2(fcI.rem, E_C_rem[ij] + E_C_rem[pq] + energy);
 
             if (E_C[pq]) {
               for (cnt1 = k_min_C[pq];
@@ -3470,7 +3487,7 @@ mfe_circ(vrna_fold_compound_t *vc)
                 for (cnt2 = l_min_C[pq][cnt1];
                      cnt2 <= l_max_C[pq][cnt1];
                      cnt2 += 2)
-                  matrices->E_FcI_rem = MIN2(matrices->E_FcI_rem, E_C_rem[ij] + E_C[pq][cnt1][cnt2 / 2] + energy);
+                  fcI.rem = MIN2(fcI.rem, E_C_rem[ij] + E_C[pq][cnt1][cnt2 / 2] + energy);
             }
           }
         }
@@ -3513,7 +3530,7 @@ mfe_circ(vrna_fold_compound_t *vc)
                 for (cnt2 = l_min_C[ij][cnt1];
                      cnt2 <= l_max_C[ij][cnt1];
                      cnt2 += 2)
-                  matrices->E_FcI_rem = MIN2(matrices->E_FcI_rem, E_C[ij][cnt1][cnt2 / 2] + E_C_rem[pq] + energy);
+                  fcI.rem = MIN2(fcI.rem, E_C[ij][cnt1][cnt2 / 2] + E_C_rem[pq] + energy);
             }
 
             if (E_C[pq]) {
@@ -3522,132 +3539,163 @@ mfe_circ(vrna_fold_compound_t *vc)
                    cnt1++)
                 for (cnt2 = l_min_C[ij][cnt1];
                      cnt2 <= l_max_C[ij][cnt1];
-                     cnt2 += 2)
+                     cnt2 += 2) {
+                  if (E_C[ij][cnt1][cnt2 / 2] == INF)
+                    continue;
+
                   for (cnt3 = k_min_C[pq];
                        cnt3 <= k_max_C[pq];
                        cnt3++)
-                    for (cnt4 = l_min_C[pq][cnt3];
-                         cnt4 <= l_max_C[pq][cnt3];
-                         cnt4 += 2) {
-                      if (((cnt1 + cnt3 + d1) <= maxD1) && ((cnt2 + cnt4 + d2) <= maxD2)) {
-                        matrices->E_FcI[cnt1 + cnt3 + d1][(cnt2 + cnt4 + d2) / 2] = MIN2(
-                          matrices->E_FcI[cnt1 + cnt3 + d1][(cnt2 + cnt4 + d2) / 2],
-                          E_C[ij][cnt1][cnt2 / 2]
-                          + E_C[pq][cnt3][cnt4 / 2]
-                          + energy
-                          );
-                        updatePosteriorBoundaries(cnt1 + cnt3 + d1,
-                                                  cnt2 + cnt4 + d2,
-                                                  &min_k_real_fcI,
-                                                  &max_k_real_fcI,
-                                                  &min_l_real_fcI,
-                                                  &max_l_real_fcI
-                                                  );
-                      } else {
-                        matrices->E_FcI_rem = MIN2(
-                          matrices->E_FcI_rem,
-                          E_C[ij][cnt1][cnt2 / 2]
-                          + E_C[pq][cnt3][cnt4 / 2]
-                          + energy
-                          );
-                      }
-                    }
+                    propagateRow(fcI.E,
+                                 cnt1 + cnt3 + d1,
+                                 cnt2 + d2,
+                                 E_C[pq][cnt3],
+                                 l_min_C[pq][cnt3],
+                                 l_max_C[pq][cnt3],
+                                 E_C[ij][cnt1][cnt2 / 2] + energy,
+                                 maxD1,
+                                 maxD2,
+                                 &fcI.rem,
+                                 &fcI.k_min_real,
+                                 &fcI.k_max_real,
+                                 &fcI.l_min_real,
+                                 &fcI.l_max_real
+                                 );
+                }
             }
           }
         }
       }
     }
-  /* end of i-j loop */
+    /* end of i-j loop */
 
-  /* resize and move memory portions of energy matrix E_FcI */
-  adjustArrayBoundaries(&matrices->E_FcI,
-                        &matrices->k_min_FcI,
-                        &matrices->k_max_FcI,
-                        &matrices->l_min_FcI,
-                        &matrices->l_max_FcI,
-                        min_k_real_fcI,
-                        max_k_real_fcI,
-                        min_l_real_fcI,
-                        max_l_real_fcI
-                        );
+    /* exterior multiloops */
+    if (seq_length > 2 * TURN) {
 #ifdef _OPENMP
-}
-#pragma omp section
-{
+#pragma omp for schedule(dynamic, 1) nowait
 #endif
-  if (seq_length > 2 * TURN) {
-    for (i = TURN + 1; i < seq_length - 2 * TURN; i++) {
-      /* get distancies to references
-       * d3a = dbp(T1_[1,n}, T1_{1,k} + T1_{k+1, n})
-       * d3b = dbp(T2_[1,n}, T2_{1,k} + T2_{k+1, n})
-       */
-      d1  = base_d1 - referenceBPs1[my_iindx[1] - i] - referenceBPs1[my_iindx[i + 1] - seq_length];
-      d2  = base_d2 - referenceBPs2[my_iindx[1] - i] - referenceBPs2[my_iindx[i + 1] - seq_length];
-
-      if (E_M_rem[my_iindx[1] - i] != INF) {
-        if (matrices->E_M2[i + 1]) {
-          for (cnt1 = matrices->k_min_M2[i + 1];
-               cnt1 <= matrices->k_max_M2[i + 1];
-               cnt1++)
-            for (cnt2 = matrices->l_min_M2[i + 1][cnt1];
-                 cnt2 <= matrices->l_max_M2[i + 1][cnt1];
-                 cnt2 += 2)
-              matrices->E_FcM_rem = MIN2(matrices->E_FcM_rem, E_M_rem[my_iindx[1] - i] + matrices->E_M2[i + 1][cnt1][cnt2 / 2] + P->MLclosing);
-        }
+      for (i = TURN + 1; i < seq_length - 2 * TURN; i++) {
+        /* get distancies to references
+         * d3a = dbp(T1_[1,n}, T1_{1,k} + T1_{k+1, n})
+         * d3b = dbp(T2_[1,n}, T2_{1,k} + T2_{k+1, n})
+         */
+        d1  = base_d1 - referenceBPs1[my_iindx[1] - i] - referenceBPs1[my_iindx[i + 1] - seq_length];
+        d2  = base_d2 - referenceBPs2[my_iindx[1] - i] - referenceBPs2[my_iindx[i + 1] - seq_length];
 
-        if (matrices->E_M2_rem[i + 1] != INF)
-          matrices->E_FcM_rem = MIN2(matrices->E_FcM_rem, E_M_rem[my_iindx[1] - i] + matrices->E_M2_rem[i + 1] + P->MLclosing);
-      }
+        if (E_M_rem[my_iindx[1] - i] != INF) {
+          if (matrices->E_M2[i + 1]) {
+            for (cnt1 = matrices->k_min_M2[i + 1];
+                 cnt1 <= matrices->k_max_M2[i + 1];
+                 cnt1++)
+              for (cnt2 = matrices->l_min_M2[i + 1][cnt1];
+                   cnt2 <= matrices->l_max_M2[i + 1][cnt1];
+                   cnt2 += 2)
+                fcM.rem = MIN2(fcM.rem, E_M_rem[my_iindx[1] - i] + matrices->E_M2[i + 1][cnt1][cnt2 / 2] + P->MLclosing);
+          }
 
-      if (matrices->E_M2_rem[i + 1] != INF) {
-        if (E_M[my_iindx[1] - i]) {
-          for (cnt1 = k_min_M[my_iindx[1] - i];
-               cnt1 <= k_max_M[my_iindx[1] - i];
-               cnt1++)
-            for (cnt2 = l_min_M[my_iindx[1] - i][cnt1];
-                 cnt2 <= l_max_M[my_iindx[1] - i][cnt1];
-                 cnt2 += 2)
-              matrices->E_FcM_rem = MIN2(matrices->E_FcM_rem, E_M[my_iindx[1] - i][cnt1][cnt2 / 2] + matrices->E_M2_rem[i + 1] + P->MLclosing);
+          if (matrices->E_M2_rem[i + 1] != INF)
+            fcM.rem = MIN2(fcM.rem, E_M_rem[my_iindx[1] - i] + matrices->E_M2_rem[i + 1] + P->MLclosing);
         }
-      }
 
-      if (!E_M[my_iindx[1] - i])
-        continue;
+        if (matrices->E_M2_rem[i + 1] != INF) {
+          if (E_M[my_iindx[1] - i]) {
+            for (cnt1 = k_min_M[my_iindx[1] - i];
+                 cnt1 <= k_max_M[my_iindx[1] - i];
+                 cnt1++)
+              for (cnt2 = l_min_M[my_iindx[1] - i][cnt1];
+                   cnt2 <= l_max_M[my_iindx[1] - i][cnt1];
+                   cnt2 += 2)
+                fcM.rem = MIN2(fcM.rem, E_M[my_iindx[1] - i][cnt1][cnt2 / 2] + matrices->E_M2_rem[i + 1] + P->MLclosing);
+          }
+        }
 
-      if (!matrices->E_M2[i + 1])
-        continue;
+        if (!E_M[my_iindx[1] - i])
+          continue;
 
-      for (cnt1 = k_min_M[my_iindx[1] - i]; cnt1 <= k_max_M[my_iindx[1] - i]; cnt1++)
-        for (cnt2 = l_min_M[my_iindx[1] - i][cnt1]; cnt2 <= l_max_M[my_iindx[1] - i][cnt1]; cnt2 += 2)
-          for (cnt3 = matrices->k_min_M2[i + 1]; cnt3 <= matrices->k_max_M2[i + 1]; cnt3++)
-            for (cnt4 = matrices->l_min_M2[i + 1][cnt3]; cnt4 <= matrices->l_max_M2[i + 1][cnt3]; cnt4 += 2) {
-              if (((cnt1 + cnt3 + d1) <= maxD1) && ((cnt2 + cnt4 + d2) <= maxD2)) {
-                matrices->E_FcM[cnt1 + cnt3 + d1][(cnt2 + cnt4 + d2) / 2] = MIN2(
-                  matrices->E_FcM[cnt1 + cnt3 + d1][(cnt2 + cnt4 + d2) / 2],
-                  E_M[my_iindx[1] - i][cnt1][cnt2 / 2]
-                  + matrices->E_M2[i + 1][cnt3][cnt4 / 2]
-                  + P->MLclosing
-                  );
-                updatePosteriorBoundaries(cnt1 + cnt3 + d1,
-                                          cnt2 + cnt4 + d2,
-                                          &min_k_real_fcM,
-                                          &max_k_real_fcM,
-                                          &min_l_real_fcM,
-                                          &max_l_real_fcM
-                                          );
-              } else {
-                matrices->E_FcM_rem = MIN2(
-                  matrices->E_FcM_rem,
-                  E_M[my_iindx[1] - i][cnt1][cnt2 / 2]
-                  + matrices->E_M2[i + 1][cnt3][cnt4 / 2]
-                  + P->MLclosing
-                  );
-              }
-            }
+        if (!matrices->E_M2[i + 1])
+          continue;
+
+        for (cnt1 = k_min_M[my_iindx[1] - i]; cnt1 <= k_max_M[my_iindx[1] - i]; cnt1++)
+          for (cnt2 = l_min_M[my_iindx[1] - i][cnt1]; cnt2 <= l_max_M[my_iindx[1] - i][cnt1]; cnt2 += 2) {
+            if (E_M[my_iindx[1] - i][cnt1][cnt2 / 2] == INF)
+              continue;
+
+            for (cnt3 = matrices->k_min_M2[i + 1]; cnt3 <= matrices->k_max_M2[i + 1]; cnt3++)
+              propagateRow(fcM.E,
+                           cnt1 + cnt3 + d1,
+                           cnt2 + d2,
+                           matrices->E_M2[i + 1][cnt3],
+                           matrices->l_min_M2[i + 1][cnt3],
+                           matrices->l_max_M2[i + 1][cnt3],
+                           E_M[my_iindx[1] - i][cnt1][cnt2 / 2] + P->MLclosing,
+                           maxD1,
+                           maxD2,
+                           &fcM.rem,
+                           &fcM.k_min_real,
+                           &fcM.k_max_real,
+                           &fcM.l_min_real,
+                           &fcM.l_max_real
+                           );
+          }
+      }
+    }
+
+#ifdef _OPENMP
+#pragma omp critical (mfe_circ_merge)
+#endif
+    {
+      mergePlane(&fcH,
+                 matrices->E_FcH,
+                 &matrices->E_FcH_rem,
+                 &min_k_real_fcH,
+                 &max_k_real_fcH,
+                 &min_l_real_fcH,
+                 &max_l_real_fcH
+                 );
+      mergePlane(&fcI,
+                 matrices->E_FcI,
+                 &matrices->E_FcI_rem,
+                 &min_k_real_fcI,
+                 &max_k_real_fcI,
+                 &min_l_real_fcI,
+                 &max_l_real_fcI
+                 );
+      mergePlane(&fcM,
+                 matrices->E_FcM,
+                 &matrices->E_FcM_rem,
+                 &min_k_real_fcM,
+                 &max_k_real_fcM,
+                 &min_l_real_fcM,
+                 &max_l_real_fcM
+                 );
     }
   }
 
-  /* resize and move memory portions of energy matrix E_FcM */
+  free(cells);
+
+  /* resize and move memory portions of energy matrices E_FcH, E_FcI, and E_FcM */
+  adjustArrayBoundaries(&matrices->E_FcH,
+                        &matrices->k_min_FcH,
+                        &matrices->k_max_FcH,
+                        &matrices->l_min_FcH,
+                        &matrices->l_max_FcH,
+                        min_k_real_fcH,
+                        max_k_real_fcH,
+                        min_l_real_fcH,
+                        max_l_real_fcH
+                        );
+
+  adjustArrayBoundaries(&matrices->E_FcI,
+                        &matrices->k_min_FcI,
+                        &matrices->k_max_FcI,
+                        &matrices->l_min_FcI,
+                        &matrices->l_max_FcI,
+                        min_k_real_fcI,
+                        max_k_real_fcI,
+                        min_l_real_fcI,
+                        max_l_real_fcI
+                        );
+
   adjustArrayBoundaries(&matrices->E_FcM,
                         &matrices->k_min_FcM,
                         &matrices->k_max_FcM,
@@ -3658,11 +3706,6 @@ mfe_circ(vrna_fold_compound_t *vc)
                         min_l_real_fcM,
                         max_l_real_fcM
                         );
-#ifdef _OPENMP
-}
-}
-#endif
-
 
   /* compute E_Fc_rem */
   matrices->E_Fc_rem  = MIN2(matrices->E_FcH_rem, matrices->E_FcI_rem);
@@ -3950,6 +3993,219 @@ prepareArray2(unsigned long ***array,
 }
 
 
+PRIVATE int
+compareCells(const void *a,
+             const void *b)
+{
+  const cell_t  *c1 = (const cell_t *)a;
+  const cell_t  *c2 = (const cell_t *)b;
+
+  if (c1->weight != c2->weight)
+    return (c1->weight > c2->weight) ? -1 : 1;
+
+  return (c1->j > c2->j) - (c1->j < c2->j);
+}
+
+
+/*
+ *  Collect all cells (i,j) with d_min <= j - i + 1 <= d_max and sort them by
+ *  the estimated size of their distance class planes, largest first. The
+ *  work spent on a cell grows with the size of its plane, so handing out the
+ *  largest cells first keeps the threads busy until the end of a diagonal
+ */
+PRIVATE unsigned int
+prepareCells(vrna_fold_compound_t *vc,
+             unsigned int         d_min,
+             unsigned int         d_max,
+             cell_t               *cells)
+{
+  unsigned int d, i, j, ij, k, l, n;
+
+  n = 0;
+
+  for (d = d_min; d <= d_max; d++)
+    for (j = d; j <= vc->length; j++) {
+      i   = j - d + 1;
+      ij  = vc->iindx[i] - j;
+      k   = MIN2(vc->maxD1, vc->mm1[ij] + vc->referenceBPs1[ij]);
+      l   = MIN2(vc->maxD2, vc->mm2[ij] + vc->referenceBPs2[ij]);
+
+      cells[n].i      = i;
+      cells[n].j      = j;
+      cells[n].weight = (k + 1) * (l / 2 + 1);
+      n++;
+    }
+
+  qsort(cells, n, sizeof(cell_t), compareCells);
+
+  return n;
+}
+
+
+PRIVATE void
+preparePlane(plane_t  *plane,
+             int      max_k,
+             int      max_l,
+             int      bpdist)
+{
+  plane->rem = INF;
+
+  prepareBoundaries(0,
+                    max_k,
+                    0,
+                    max_l,
+                    bpdist,
+                    &plane->k_min,
+                    &plane->k_max,
+                    &plane->l_min,
+                    &plane->l_max
+                    );
+
+  prepareArray(&plane->E,
+               plane->k_min,
+               plane->k_max,
+               plane->l_min,
+               plane->l_max
+               );
+
+  preparePosteriorBoundaries(plane->k_max - plane->k_min + 1,
+                             plane->k_min,
+                             &plane->k_min_real,
+                             &plane->k_max_real,
+                             &plane->l_min_real,
+                             &plane->l_max_real
+                             );
+}
+
+
+/* merge a thread private plane into the shared plane E and release it */
+PRIVATE void
+mergePlane(plane_t  *plane,
+           int      **E,
+           int      *rem,
+           int      *min_k,
+           int      *max_k,
+           int      **min_l,
+           int      **max_l)
+{
+  int k, l;
+
+  for (k = plane->k_min_real; k <= plane->k_max_real; k++) {
+    if (plane->l_min_real[k] == INF)
+      continue;
+
+    for (l = plane->l_min_real[k]; l <= plane->l_max_real[k]; l += 2)
+      E[k][l / 2] = MIN2(E[k][l / 2], plane->E[k][l / 2]);
+
+    updatePosteriorBoundaries(k, plane->l_min_real[k], min_k, max_k, min_l, max_l);
+    updatePosteriorBoundaries(k, plane->l_max_real[k], min_k, max_k, min_l, max_l);
+  }
+
+  *rem = MIN2(*rem, plane->rem);
+
+  /* without any actual data, all memory of the plane is released */
+  adjustArrayBoundaries(&plane->E,
+                        &plane->k_min,
+                        &plane->k_max,
+                        &plane->l_min,
+                        &plane->l_max,
+                        INF,
+                        0,
+                        plane->l_min_real,
+                        plane->l_max_real
+                        );
+}
+
+
+/*
+ *  Add the row k_s of a source plane, i.e. all entries source[l / 2] with
+ *  l_min <= l <= l_max, to the target plane using energy offset e. The entry
+ *  (k_s, l) contributes to target[k][(l + dl) / 2], where k and dl already
+ *  include the shift in both distances. Contributions beyond maxD1, maxD2
+ *  are collected in rem instead.
+ */
+INLINE PRIVATE void
+propagateRow(int        **target,
+             int        k,
+             int        dl,
+             const int  *source,
+             int        l_min,
+             int        l_max,
+             int        e,
+             int        maxD1,
+             int        maxD2,
+             int        *rem,
+             int        *min_k,
+             int        *max_k,
+             int        **min_l,
+             int        **max_l)
+{
+  int n, n_in, first, last, t;
+
+  if (l_min > l_max)
+    return;
+
+  source  += l_min / 2;
+  n       = (l_max - l_min) / 2 + 1;
+  n_in    = 0;
+
+  if ((k <= maxD1) && (l_min + dl <= maxD2))
+    n_in = MIN2(n, (maxD2 - dl - l_min) / 2 + 1);
+
+  /* only the range between the first and the last finite entry is written */
+  for (first = 0; (first < n_in) && (source[first] == INF); first++);
+
+  if (first < n_in) {
+    for (last = n_in - 1; source[last] == INF; last--);
+
+    (*min_plus)(target[k] + (l_min + 2 * first + dl) / 2,
+                source + first,
+                last - first + 1,
+                e);
+
+    updatePosteriorBoundaries(k, l_min + 2 * first + dl, min_k, max_k, min_l, max_l);
+    updatePosteriorBoundaries(k, l_min + 2 * last + dl, min_k, max_k, min_l, max_l);
+  }
+
+  for (t = n_in; t < n; t++)
+    if (source[t] != INF)
+      *rem = MIN2(*rem, source[t] + e);
+}
+
+
+/* target[t] = MIN2(target[t], source[t] + e) for all finite source[t] */
+PRIVATE void
+min_plus_default(int        *target,
+                 const int  *source,
+                 int        n,
+                 int        e)
+{
+  int t;
+
+  for (t = 0; t < n; t++)
+    if (source[t] != INF)
+      target[t] = MIN2(target[t], source[t] + e);
+}
+
+
+PRIVATE void
+min_plus_dispatcher(int       *target,
+                    const int *source,
+                    int       n,
+                    int       e)
+{
+  min_plus = &min_plus_default;
+
+#if VRNA_WITH_SIMD_SSE41
+  if (vrna_cpu_simd_capabilities() & VRNA_CPU_SIMD_SSE41)
+    min_plus = &vrna_2Dfold_min_plus_sse41;
+
+#endif
+
+  (*min_plus)(target, source, n, e);
+}
+
+
 /*
  #################################
  # OLD API support               #
@@ -0,0 +1,76 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ViennaRNA/utils/basic.h"
+
+#include <emmintrin.h>
+#include <smmintrin.h>
+
+
+/*
+ *  Row kernel of the distance class convolutions in vrna_mfe_TwoD() that
+ *  processes four entries at once. Computes
+ *  target[t] = MIN2(target[t], source[t] + e) for all finite source[t],
+ *  see min_plus_default() in 2Dfold.c for the scalar version.
+ */
+PUBLIC void
+vrna_2Dfold_min_plus_sse41(int        *target,
+                           const int  *source,
+                           int        n,
+                           int        e)
+{
+  int           t;
+  const __m128i inf = _mm_set1_epi32(INF);
+  const __m128i ve  = _mm_set1_epi32(e);
+
+  for (t = 0; t + 3 < n; t += 4) {
+    __m128i s = _mm_loadu_si128((const __m128i *)(source + t));
+    __m128i v = _mm_add_epi32(s, ve);
+
+    /* INF entries in the source leave the target untouched */
+    v = _mm_blendv_epi8(v, inf, _mm_cmpeq_epi32(s, inf));
+    v = _mm_min_epi32(v, _mm_loadu_si128((const __m128i *)(target + t)));
+    _mm_storeu_si128((__m128i *)(target + t), v);
+  }
+
+  for (; t < n; t++)
+    if (source[t] != INF)
+      target[t] = MIN2(target[t], source[t] + e);
+}
+
+
+#ifndef USE_FLOAT_PF
+/*
+ *  Row kernel of the distance class convolutions in vrna_pf_TwoD() that
+ *  processes two entries at once. Computes
+ *  target[t] += a * source[t] * c, see mul_add_default() in 2Dpfold.c
+ *  for the scalar version.
+ */
+PUBLIC void
+vrna_2Dpfold_mul_add_sse41(FLT_OR_DBL       *target,
+                           const FLT_OR_DBL *source,
+                           int              n,
+                           FLT_OR_DBL       a,
+                           FLT_OR_DBL       c)
+{
+  int           t;
+  const __m128d va  = _mm_set1_pd(a);
+  const __m128d vc  = _mm_set1_pd(c);
+
+  for (t = 0; t + 1 < n; t += 2) {
+    /* same order of operations as the scalar version, i.e. (a * source[t]) * c */
+    __m128d v = _mm_mul_pd(_mm_mul_pd(va, _mm_loadu_pd(source + t)), vc);
+
+    _mm_storeu_pd(target + t, _mm_add_pd(_mm_loadu_pd(target + t), v));
+  }
+
+  for (; t < n; t++)
+    target[t] += a * source[t] * c;
+}
+
+
+#endif
@@ -16,10 +16,14 @@
 #include <string.h>
 #include <float.h>    /* #defines FLT_MAX ... */
 #include "ViennaRNA/utils/basic.h"
+#include "ViennaRNA/utils/cpu.h"
 #include "ViennaRNA/fold_vars.h"
 #include "ViennaRNA/params/basic.h"
 #include "ViennaRNA/params/default.h"
 #include "ViennaRNA/loops/all.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 #include "ViennaRNA/2Dpfold.h"
 
 /*
@@ -34,6 +38,35 @@
  #################################
  */
 
+/*
+ *  A cell (i,j) of the dynamic programming matrices together with the
+ *  estimated size of its distance class plane. Cells are handed out to
+ *  the threads in order of decreasing weight, see prepareCells()
+ */
+typedef struct {
+  unsigned int  i;
+  unsigned int  j;
+  unsigned int  weight;
+} cell_t;
+
+/*
+ *  A thread private copy of a distance class plane. Threads that
+ *  contribute to the same plane accumulate into their own copy,
+ *  which is merged into the shared plane once they are done
+ */
+typedef struct {
+  FLT_OR_DBL  **Q;
+  FLT_OR_DBL  rem;
+  int         k_min, k_max, *l_min, *l_max;
+  int         k_min_real, k_max_real, *l_min_real, *l_max_real;
+} plane_t;
+
+typedef void (proto_mul_add)(FLT_OR_DBL       *target,
+                             const FLT_OR_DBL *source,
+                             int              n,
+                             FLT_OR_DBL       a,
+                             FLT_OR_DBL       c);
+
 /*
  #################################
  # PRIVATE FUNCTION DECLARATIONS #
@@ -147,6 +180,72 @@ INLINE PRIVATE void  prepareArray(FLT_OR_DBL  ***array,
                                   int         *max_l);
 
 
+PRIVATE unsigned int  prepareCells(vrna_fold_compound_t *vc,
+                                   unsigned int         d_min,
+                                   unsigned int         d_max,
+                                   cell_t               *cells);
+
+
+PRIVATE void  preparePlane(plane_t  *plane,
+                           int      max_k,
+                           int      max_l,
+                           int      bpdist);
+
+
+PRIVATE void  mergePlane(plane_t    *plane,
+                         FLT_OR_DBL **Q,
+                         FLT_OR_DBL *rem,
+                         int        *min_k,
+                         int        *max_k,
+                         int        **min_l,
+                         int        **max_l);
+
+
+INLINE PRIVATE void  propagateRow(FLT_OR_DBL        **target,
+                                  int               k,
+                                  int               dl,
+                                  const FLT_OR_DBL  *source,
+                                  int               l_min,
+                                  int               l_max,
+                                  FLT_OR_DBL        a,
+                                  FLT_OR_DBL        c,
+                                  int               maxD1,
+                                  int               maxD2,
+                                  FLT_OR_DBL        *rem,
+                                  int               *min_k,
+                                  int               *max_k,
+                                  int               **min_l,
+                                  int               **max_l);
+
+
+PRIVATE void  mul_add_dispatcher(FLT_OR_DBL       *target,
+                                 const FLT_OR_DBL *source,
+                                 int              n,
+                                 FLT_OR_DBL       a,
+                                 FLT_OR_DBL       c);
+
+
+PRIVATE void  mul_add_default(FLT_OR_DBL       *target,
+                              const FLT_OR_DBL *source,
+                              int              n,
+                              FLT_OR_DBL       a,
+                              FLT_OR_DBL       c);
+
+
+#if VRNA_WITH_SIMD_SSE41 && !defined(USE_FLOAT_PF)
+void
+vrna_2Dpfold_mul_add_sse41(FLT_OR_DBL       *target,
+                           const FLT_OR_DBL *source,
+                           int              n,
+                           FLT_OR_DBL       a,
+                           FLT_OR_DBL       c);
+
+
+#endif
+
+PRIVATE proto_mul_add *mul_add = &mul_add_dispatcher;
+
+
 /*
  #################################
  # BEGIN OF FUNCTION DEFINITIONS #
@@ -368,13 +467,14 @@ pf2D_linear(vrna_fold_compound_t *vc)
   short             *S1, *reference_pt1, *reference_pt2;
   unsigned int      *referenceBPs1, *referenceBPs2,
                     d, i, j, ij, seq_length, maxD1,
-                    maxD2, *mm1, *mm2, *bpdist;
-  int               *my_iindx, *jindx, circ, cnt1, cnt2, cnt3, cnt4, *rtype;
+                    maxD2, *mm1, *mm2, *bpdist, c, n_cells;
+  int               *my_iindx, *jindx, circ, cnt1, cnt2, cnt3, *rtype;
   double            max_real;
   FLT_OR_DBL        *scale, Qmax;
   vrna_exp_param_t  *pf_params;
   vrna_mx_pf_t      *matrices;
   vrna_md_t         *md;
+  cell_t            *cells;
 
   max_real = (sizeof(FLT_OR_DBL) == sizeof(float)) ? FLT_MAX : DBL_MAX;
 
@@ -419,18 +519,22 @@ pf2D_linear(vrna_fold_compound_t *vc)
       matrices->Q[ij][0][0]     = 1.0 * scale[j - i + 1];
     }
 
+  cells = (cell_t *)vrna_alloc(sizeof(cell_t) * (seq_length + 1));
 
   for (d = TURN + 2; d <= seq_length; d++) {
-    /* i,j in [1..seq_length] */
+    /* i,j in [1..seq_length], largest distance class planes first */
+    n_cells = prepareCells(vc, d, d, cells);
+
 #ifdef _OPENMP
-#pragma omp parallel for private(i, j, ij, cnt1, cnt2, cnt3, cnt4)
+#pragma omp parallel for private(i, j, ij, cnt1, cnt2, cnt3) schedule(dynamic, 1)
 #endif
-    for (j = d; j <= seq_length; j++) {
+    for (c = 0; c < n_cells; c++) {
       unsigned int  k, l, kl, u, ii, dij;
       int           no_close, type, type_2, tt, da, db, base_da, base_db;
       FLT_OR_DBL    temp2, aux_en;
 
-      i     = j - d + 1;
+      i     = cells[c].i;
+      j     = cells[c].j;
       ij    = my_iindx[i] - j;
       dij   = j - i - 1;
       type  = ptype[jindx[j] + i];
@@ -442,7 +546,7 @@ pf2D_linear(vrna_fold_compound_t *vc)
         /* we have a pair */
 
         int k_min_Q_B, k_max_Q_B, l_min_Q_B, l_max_Q_B;
-        int k_min_post_b, k_max_post_b, *l_min_post_b, *l_max_post_b;
+        int k_min_post_b, k_max_post_b, *l_min_post_b = NULL, *l_max_post_b = NULL;
         int update_b = 0;
 
         if (!matrices->Q_B[ij]) {
@@ -543,24 +647,22 @@ pf2D_linear(vrna_fold_compound_t *vc)
             for (cnt1 = matrices->k_min_Q_B[kl];
                  cnt1 <= matrices->k_max_Q_B[kl];
                  cnt1++)
-              for (cnt2 = matrices->l_min_Q_B[kl][cnt1];
-                   cnt2 <= matrices->l_max_Q_B[kl][cnt1];
-                   cnt2 += 2) {
-                if (((cnt1 + da) <= maxD1) && ((cnt2 + db) <= maxD2)) {
-                  matrices->Q_B[ij][cnt1 + da][(cnt2 + db) / 2] += matrices->Q_B[kl][cnt1][cnt2 / 2] * aux_en;
-                  if (update_b) {
-                    updatePosteriorBoundaries(da + cnt1,
-                                              db + cnt2,
-                                              &k_min_post_b,
-                                              &k_max_post_b,
-                                              &l_min_post_b,
-                                              &l_max_post_b
-                                              );
-                  }
-                } else {
-                  matrices->Q_B_rem[ij] += matrices->Q_B[kl][cnt1][cnt2 / 2] * aux_en;
-                }
-              }
+              propagateRow(matrices->Q_B[ij],
+                           cnt1 + da,
+                           db,
+                           matrices->Q_B[kl][cnt1],
+                           matrices->l_min_Q_B[kl][cnt1],
+                           matrices->l_max_Q_B[kl][cnt1],
+                           aux_en,
+                           1.,
+                           maxD1,
+                           maxD2,
+                           &matrices->Q_B_rem[ij],
+                           update_b ? &k_min_post_b : NULL,
+                           &k_max_post_b,
+                           &l_min_post_b,
+                           &l_max_post_b
+                           );
           } /* end l-loop */
         }   /* end k-loop */
 
@@ -614,33 +716,26 @@ pf2D_linear(vrna_fold_compound_t *vc)
                  cnt1++)
               for (cnt2 = matrices->l_min_Q_M[my_iindx[i + 1] - u][cnt1];
                    cnt2 <= matrices->l_max_Q_M[my_iindx[i + 1] - u][cnt1];
-                   cnt2 += 2) {
+                   cnt2 += 2)
                 for (cnt3 = matrices->k_min_Q_M1[jindx[j - 1] + u + 1];
                      cnt3 <= matrices->k_max_Q_M1[jindx[j - 1] + u + 1];
                      cnt3++)
-                  for (cnt4 = matrices->l_min_Q_M1[jindx[j - 1] + u + 1][cnt3];
-                       cnt4 <= matrices->l_max_Q_M1[jindx[j - 1] + u + 1][cnt3];
-                       cnt4 += 2) {
-                    if (((cnt1 + cnt3 + da) <= maxD1) && ((cnt2 + cnt4 + db) <= maxD2)) {
-                      matrices->Q_B[ij][cnt1 + cnt3 + da][(cnt2 + cnt4 + db) / 2] += matrices->Q_M[my_iindx[i + 1] - u][cnt1][cnt2 / 2]
-                                                                                     * matrices->Q_M1[jindx[j - 1] + u + 1][cnt3][cnt4 / 2]
-                                                                                     * temp2;
-                      if (update_b) {
-                        updatePosteriorBoundaries(cnt1 + cnt3 + da,
-                                                  cnt2 + cnt4 + db,
-                                                  &k_min_post_b,
-                                                  &k_max_post_b,
-                                                  &l_min_post_b,
-                                                  &l_max_post_b
-                                                  );
-                      }
-                    } else {
-                      matrices->Q_B_rem[ij] += matrices->Q_M[my_iindx[i + 1] - u][cnt1][cnt2 / 2]
-                                               * matrices->Q_M1[jindx[j - 1] + u + 1][cnt3][cnt4 / 2]
-                                               * temp2;
-                    }
-                  }
-              }
+                  propagateRow(matrices->Q_B[ij],
+                               cnt1 + cnt3 + da,
+                               cnt2 + db,
+                               matrices->Q_M1[jindx[j - 1] + u + 1][cnt3],
+                               matrices->l_min_Q_M1[jindx[j - 1] + u + 1][cnt3],
+                               matrices->l_max_Q_M1[jindx[j - 1] + u + 1][cnt3],
+                               matrices->Q_M[my_iindx[i + 1] - u][cnt1][cnt2 / 2],
+                               temp2,
+                               maxD1,
+                               maxD2,
+                               &matrices->Q_B_rem[ij],
+                               update_b ? &k_min_post_b : NULL,
+                               &k_max_post_b,
+                               &l_min_post_b,
+                               &l_max_post_b
+                               );
           }
         }
 
@@ -661,10 +756,10 @@ pf2D_linear(vrna_fold_compound_t *vc)
       /* free ends ? -----------------------------------------*/
 
       int k_min_Q_M, k_max_Q_M, l_min_Q_M, l_max_Q_M;
-      int k_min_post_m, k_max_post_m, *l_min_post_m, *l_max_post_m;
+      int k_min_post_m, k_max_post_m, *l_min_post_m = NULL, *l_max_post_m = NULL;
       int update_m = 0;
       int k_min_Q_M1, k_max_Q_M1, l_min_Q_M1, l_max_Q_M1;
-      int k_min_post_m1, k_max_post_m1, *l_min_post_m1, *l_max_post_m1;
+      int k_min_post_m1, k_max_post_m1, *l_min_post_m1 = NULL, *l_max_post_m1 = NULL;
       int update_m1 = 0;
 
       if (!matrices->Q_M[ij]) {
@@ -741,26 +836,23 @@ pf2D_linear(vrna_fold_compound_t *vc)
       if (matrices->Q_M[ij + 1]) {
         for (cnt1 = matrices->k_min_Q_M[ij + 1];
              cnt1 <= matrices->k_max_Q_M[ij + 1];
-             cnt1++) {
-          for (cnt2 = matrices->l_min_Q_M[ij + 1][cnt1];
-               cnt2 <= matrices->l_max_Q_M[ij + 1][cnt1];
-               cnt2 += 2) {
-            if (((cnt1 + da) <= maxD1) && ((cnt2 + db) <= maxD2)) {
-              matrices->Q_M[ij][cnt1 + da][(cnt2 + db) / 2] += matrices->Q_M[ij + 1][cnt1][cnt2 / 2] * pf_params->expMLbase * scale[1];
-              if (update_m) {
-                updatePosteriorBoundaries(cnt1 + da,
-                                          cnt2 + db,
-                                          &k_min_post_m,
-                                          &k_max_post_m,
-                                          &l_min_post_m,
-                                          &l_max_post_m
-                                          );
-              }
-            } else {
-              matrices->Q_M_rem[ij] += matrices->Q_M[ij + 1][cnt1][cnt2 / 2] * pf_params->expMLbase * scale[1];
-            }
-          }
-        }
+             cnt1++)
+          propagateRow(matrices->Q_M[ij],
+                       cnt1 + da,
+                       db,
+                       matrices->Q_M[ij + 1][cnt1],
+                       matrices->l_min_Q_M[ij + 1][cnt1],
+                       matrices->l_max_Q_M[ij + 1][cnt1],
+                       pf_params->expMLbase,
+                       scale[1],
+                       maxD1,
+                       maxD2,
+                       &matrices->Q_M_rem[ij],
+                       update_m ? &k_min_post_m : NULL,
+                       &k_max_post_m,
+                       &l_min_post_m,
+                       &l_max_post_m
+                       );
       }
 
       if (matrices->Q_M1_rem[jindx[j - 1] + i])
@@ -770,24 +862,22 @@ pf2D_linear(vrna_fold_compound_t *vc)
         for (cnt1 = matrices->k_min_Q_M1[jindx[j - 1] + i];
              cnt1 <= matrices->k_max_Q_M1[jindx[j - 1] + i];
              cnt1++)
-          for (cnt2 = matrices->l_min_Q_M1[jindx[j - 1] + i][cnt1];
-               cnt2 <= matrices->l_max_Q_M1[jindx[j - 1] + i][cnt1];
-               cnt2 += 2) {
-            if (((cnt1 + da) <= maxD1) && ((cnt2 + db) <= maxD2)) {
-              matrices->Q_M1[jindx[j] + i][cnt1 + da][(cnt2 + db) / 2] += matrices->Q_M1[jindx[j - 1] + i][cnt1][cnt2 / 2] * pf_params->expMLbase * scale[1];
-              if (update_m1) {
-                updatePosteriorBoundaries(cnt1 + da,
-                                          cnt2 + db,
-                                          &k_min_post_m1,
-                                          &k_max_post_m1,
-                                          &l_min_post_m1,
-                                          &l_max_post_m1
-                                          );
-              }
-            } else {
-              matrices->Q_M1_rem[jindx[j] + i] += matrices->Q_M1[jindx[j - 1] + i][cnt1][cnt2 / 2] * pf_params->expMLbase * scale[1];
-            }
-          }
+          propagateRow(matrices->Q_M1[jindx[j] + i],
+                       cnt1 + da,
+                       db,
+                       matrices->Q_M1[jindx[j - 1] + i][cnt1],
+                       matrices->l_min_Q_M1[jindx[j - 1] + i][cnt1],
+                       matrices->l_max_Q_M1[jindx[j - 1] + i][cnt1],
+                       pf_params->expMLbase,
+                       scale[1],
+                       maxD1,
+                       maxD2,
+                       &matrices->Q_M1_rem[jindx[j] + i],
+                       update_m1 ? &k_min_post_m1 : NULL,
+                       &k_max_post_m1,
+                       &l_min_post_m1,
+                       &l_max_post_m1
+                       );
       }
 
       /* j pairs with i */
@@ -802,32 +892,40 @@ pf2D_linear(vrna_fold_compound_t *vc)
         if (matrices->Q_B[ij]) {
           for (cnt1 = matrices->k_min_Q_B[ij];
                cnt1 <= matrices->k_max_Q_B[ij];
-               cnt1++)
-            for (cnt2 = matrices->l_min_Q_B[ij][cnt1];
-                 cnt2 <= matrices->l_max_Q_B[ij][cnt1];
-                 cnt2 += 2) {
-              matrices->Q_M[ij][cnt1][cnt2 / 2] += matrices->Q_B[ij][cnt1][cnt2 / 2] * aux_en;
-              if (update_m) {
-                updatePosteriorBoundaries(cnt1,
-                                          cnt2,
-                                          &k_min_post_m,
-                                          &k_max_post_m,
-                                          &l_min_post_m,
-                                          &l_max_post_m
-                                          );
-              }
-
-              matrices->Q_M1[jindx[j] + i][cnt1][cnt2 / 2] += matrices->Q_B[ij][cnt1][cnt2 / 2] * aux_en;
-              if (update_m1) {
-                updatePosteriorBoundaries(cnt1,
-                                          cnt2,
-                                          &k_min_post_m1,
-                                          &k_max_post_m1,
-                                          &l_min_post_m1,
-                                          &l_max_post_m1
-                                          );
-              }
-            }
+               cnt1++) {
+            propagateRow(matrices->Q_M[ij],
+                         cnt1,
+                         0,
+                         matrices->Q_B[ij][cnt1],
+                         matrices->l_min_Q_B[ij][cnt1],
+                         matrices->l_max_Q_B[ij][cnt1],
+                         aux_en,
+                         1.,
+                         maxD1,
+                         maxD2,
+                         &matrices->Q_M_rem[ij],
+                         update_m ? &k_min_post_m : NULL,
+                         &k_max_post_m,
+                         &l_min_post_m,
+                         &l_max_post_m
+                         );
+            propagateRow(matrices->Q_M1[jindx[j] + i],
+                         cnt1,
+                         0,
+                         matrices->Q_B[ij][cnt1],
+                         matrices->l_min_Q_B[ij][cnt1],
+                         matrices->l_max_Q_B[ij][cnt1],
+                         aux_en,
+                         1.,
+                         maxD1,
+                         maxD2,
+                         &matrices->Q_M1_rem[jindx[j] + i],
+                         update_m1 ? &k_min_post_m1 : NULL,
+                         &k_max_post_m1,
+                         &l_min_post_m1,
+                         &l_max_post_m1
+                         );
+          }
         }
       }
 
@@ -915,24 +1013,22 @@ pf2D_linear(vrna_fold_compound_t *vc)
             for (cnt3 = matrices->k_min_Q_B[my_iindx[k] - j];
                  cnt3 <= matrices->k_max_Q_B[my_iindx[k] - j];
                  cnt3++)
-              for (cnt4 = matrices->l_min_Q_B[my_iindx[k] - j][cnt3];
-                   cnt4 <= matrices->l_max_Q_B[my_iindx[k] - j][cnt3];
-                   cnt4 += 2) {
-                if (((cnt1 + cnt3 + da) <= maxD1) && ((cnt2 + cnt4 + db) <= maxD2)) {
-                  matrices->Q_M[ij][cnt1 + cnt3 + da][(cnt2 + cnt4 + db) / 2] += matrices->Q_M[ii - k + 1][cnt1][cnt2 / 2] * matrices->Q_B[my_iindx[k] - j][cnt3][cnt4 / 2] * temp2;
-                  if (update_m) {
-                    updatePosteriorBoundaries(cnt1 + cnt3 + da,
-                                              cnt2 + cnt4 + db,
-                                              &k_min_post_m,
-                                              &k_max_post_m,
-                                              &l_min_post_m,
-                                              &l_max_post_m
-                                              );
-                  }
-                } else {
-                  matrices->Q_M_rem[ij] += matrices->Q_M[ii - k + 1][cnt1][cnt2 / 2] * matrices->Q_B[my_iindx[k] - j][cnt3][cnt4 / 2] * temp2;
-                }
-              }
+              propagateRow(matrices->Q_M[ij],
+                           cnt1 + cnt3 + da,
+                           cnt2 + db,
+                           matrices->Q_B[my_iindx[k] - j][cnt3],
+                           matrices->l_min_Q_B[my_iindx[k] - j][cnt3],
+                           matrices->l_max_Q_B[my_iindx[k] - j][cnt3],
+                           matrices->Q_M[ii - k + 1][cnt1][cnt2 / 2],
+                           temp2,
+                           maxD1,
+                           maxD2,
+                           &matrices->Q_M_rem[ij],
+                           update_m ? &k_min_post_m : NULL,
+                           &k_max_post_m,
+                           &l_min_post_m,
+                           &l_max_post_m
+                           );
       }
 
       if (update_m) {
@@ -963,7 +1059,7 @@ pf2D_linear(vrna_fold_compound_t *vc)
 
       /* compute contributions for Q(i,j) */
       int k_min, k_max, l_min, l_max;
-      int k_min_post, k_max_post, *l_min_post, *l_max_post;
+      int k_min_post, k_max_post, *l_min_post = NULL, *l_max_post = NULL;
       int update_q = 0;
       if (!matrices->Q[ij]) {
         update_q  = 1;
@@ -1007,20 +1103,22 @@ pf2D_linear(vrna_fold_compound_t *vc)
           for (cnt1 = matrices->k_min_Q_B[ij];
                cnt1 <= matrices->k_max_Q_B[ij];
                cnt1++)
-            for (cnt2 = matrices->l_min_Q_B[ij][cnt1];
-                 cnt2 <= matrices->l_max_Q_B[ij][cnt1];
-                 cnt2 += 2) {
-              matrices->Q[ij][cnt1][cnt2 / 2] += matrices->Q_B[ij][cnt1][cnt2 / 2] * aux_en;
-              if (update_q) {
-                updatePosteriorBoundaries(cnt1,
-                                          cnt2,
-                                          &k_min_post,
-                                          &k_max_post,
-                                          &l_min_post,
-                                          &l_max_post
-                                          );
-              }
-            }
+            propagateRow(matrices->Q[ij],
+                         cnt1,
+                         0,
+                         matrices->Q_B[ij][cnt1],
+                         matrices->l_min_Q_B[ij][cnt1],
+                         matrices->l_max_Q_B[ij][cnt1],
+                         aux_en,
+                         1.,
+                         maxD1,
+                         maxD2,
+                         &matrices->Q_rem[ij],
+                         update_q ? &k_min_post : NULL,
+                         &k_max_post,
+                         &l_min_post,
+                         &l_max_post
+                         );
         }
       }
 
@@ -1037,24 +1135,22 @@ pf2D_linear(vrna_fold_compound_t *vc)
         for (cnt1 = matrices->k_min_Q[ij + 1];
              cnt1 <= matrices->k_max_Q[ij + 1];
              cnt1++)
-          for (cnt2 = matrices->l_min_Q[ij + 1][cnt1];
-               cnt2 <= matrices->l_max_Q[ij + 1][cnt1];
-               cnt2 += 2) {
-            if (((cnt1 + da) <= maxD1) && ((cnt2 + db) <= maxD2)) {
-              matrices->Q[ij][cnt1 + da][(cnt2 + db) / 2] += matrices->Q[ij + 1][cnt1][cnt2 / 2] * scale[1];
-              if (update_q) {
-                updatePosteriorBoundaries(cnt1 + da,
-                                          cnt2 + db,
-                                          &k_min_post,
-                                          &k_max_post,
-                                          &l_min_post,
-                                          &l_max_post
-                                          );
-              }
-            } else {
-              matrices->Q_rem[ij] += matrices->Q[ij + 1][cnt1][cnt2 / 2] * scale[1];
-            }
-          }
+          propagateRow(matrices->Q[ij],
+                       cnt1 + da,
+                       db,
+                       matrices->Q[ij + 1][cnt1],
+                       matrices->l_min_Q[ij + 1][cnt1],
+                       matrices->l_max_Q[ij + 1][cnt1],
+                       scale[1],
+                       1.,
+                       maxD1,
+                       maxD2,
+                       &matrices->Q_rem[ij],
+                       update_q ? &k_min_post : NULL,
+                       &k_max_post,
+                       &l_min_post,
+                       &l_max_post
+                       );
       }
 
       for (k = j - TURN - 1; k > i; k--) {
@@ -1110,24 +1206,22 @@ pf2D_linear(vrna_fold_compound_t *vc)
             for (cnt3 = matrices->k_min_Q_B[my_iindx[k] - j];
                  cnt3 <= matrices->k_max_Q_B[my_iindx[k] - j];
                  cnt3++)
-              for (cnt4 = matrices->l_min_Q_B[my_iindx[k] - j][cnt3];
-                   cnt4 <= matrices->l_max_Q_B[my_iindx[k] - j][cnt3];
-                   cnt4 += 2) {
-                if (((cnt1 + cnt3 + da) <= maxD1) && ((cnt2 + cnt4 + db) <= maxD2)) {
-                  matrices->Q[ij][cnt1 + cnt3 + da][(cnt2 + cnt4 + db) / 2] += matrices->Q[my_iindx[i] - k + 1][cnt1][cnt2 / 2] * matrices->Q_B[my_iindx[k] - j][cnt3][cnt4 / 2] * temp2;
-                  if (update_q) {
-                    updatePosteriorBoundaries(cnt1 + cnt3 + da,
-                                              cnt2 + cnt4 + db,
-                                              &k_min_post,
-                                              &k_max_post,
-                                              &l_min_post,
-                                              &l_max_post
-                                              );
-                  }
-                } else {
-                  matrices->Q_rem[ij] += matrices->Q[my_iindx[i] - k + 1][cnt1][cnt2 / 2] * matrices->Q_B[my_iindx[k] - j][cnt3][cnt4 / 2] * temp2;
-                }
-              }
+              propagateRow(matrices->Q[ij],
+                           cnt1 + cnt3 + da,
+                           cnt2 + db,
+                           matrices->Q_B[my_iindx[k] - j][cnt3],
+                           matrices->l_min_Q_B[my_iindx[k] - j][cnt3],
+                           matrices->l_max_Q_B[my_iindx[k] - j][cnt3],
+                           matrices->Q[my_iindx[i] - k + 1][cnt1][cnt2 / 2],
+                           temp2,
+                           maxD1,
+                           maxD2,
+                           &matrices->Q_rem[ij],
+                           update_q ? &k_min_post : NULL,
+                           &k_max_post,
+                           &l_min_post,
+                           &l_max_post
+                           );
       }
 
       if (update_q) {
@@ -1162,8 +1256,10 @@ pf2D_linear(vrna_fold_compound_t *vc)
         }
       }
 #endif
-    } /* end of j-loop */
+    } /* end of cell-loop */
   }
+
+  free(cells);
 }
 
 
@@ -1174,8 +1270,8 @@ pf2D_linear(vrna_fold_compound_t *vc)
 PRIVATE void
 pf2D_circ(vrna_fold_compound_t *vc)
 {
-  unsigned int      d, p, q, pq, k, l, kl, u, da, db, seq_length, maxD1, maxD2, base_d1, base_d2, *mm1, *mm2, *bpdist;
-  int               *my_iindx, *jindx, type, cnt1, cnt2, cnt3, cnt4, *rtype;
+  unsigned int      p, q, pq, k, l, kl, u, da, db, seq_length, maxD1, maxD2, base_d1, base_d2, *mm1, *mm2, *bpdist, n_cells;
+  int               *my_iindx, *jindx, type, cnt1, cnt2, cnt3, *rtype, t, n_threads;
   short             *S1;
   unsigned int      *referenceBPs1, *referenceBPs2;
   char              *sequence, *ptype;
@@ -1183,6 +1279,8 @@ pf2D_circ(vrna_fold_compound_t *vc)
   vrna_exp_param_t  *pf_params;     /* holds all [unscaled] pf parameters */
   vrna_md_t         *md;
   vrna_mx_pf_t      *matrices;
+  cell_t            *cells;
+  plane_t           *planes;
 
   pf_params     = vc->exp_params;
   md            = &(pf_params->model_details);
@@ -1240,7 +1338,7 @@ pf2D_circ(vrna_fold_compound_t *vc)
 
   /* construct qm2 matrix from qm1 entries  */
 #ifdef _OPENMP
-#pragma omp parallel for private(d, k, l, da, db, cnt1, cnt2, cnt3, cnt4)
+#pragma omp parallel for private(k, l, da, db, cnt1, cnt2, cnt3) schedule(dynamic)
 #endif
   for (k = 1; k < seq_length - TURN - 1; k++) {
     int k_min_Q_M2, k_max_Q_M2, l_min_Q_M2, l_max_Q_M2;
@@ -1314,25 +1412,24 @@ pf2D_circ(vrna_fold_compound_t *vc)
         da  = referenceBPs1[my_iindx[k] - seq_length] - referenceBPs1[my_iindx[k] - l] - referenceBPs1[my_iindx[l + 1] - seq_length];
         db  = referenceBPs2[my_iindx[k] - seq_length] - referenceBPs2[my_iindx[k] - l] - referenceBPs2[my_iindx[l + 1] - seq_length];
         for (cnt1 = k_min_Q_M1[jindx[l] + k]; cnt1 <= k_max_Q_M1[jindx[l] + k]; cnt1++)
-          for (cnt2 = l_min_Q_M1[jindx[l] + k][cnt1]; cnt2 <= l_max_Q_M1[jindx[l] + k][cnt1]; cnt2 += 2) {
+          for (cnt2 = l_min_Q_M1[jindx[l] + k][cnt1]; cnt2 <= l_max_Q_M1[jindx[l] + k][cnt1]; cnt2 += 2)
             for (cnt3 = k_min_Q_M1[jindx[seq_length] + l + 1]; cnt3 <= k_max_Q_M1[jindx[seq_length] + l + 1]; cnt3++)
-              for (cnt4 = l_min_Q_M1[jindx[seq_length] + l + 1][cnt3]; cnt4 <= l_max_Q_M1[jindx[seq_length] + l + 1][cnt3]; cnt4 += 2) {
-                if (((cnt1 + cnt3 + da) <= maxD1) && ((cnt2 + cnt4 + db) <= maxD2)) {
-                  matrices->Q_M2[k][cnt1 + cnt3 + da][(cnt2 + cnt4 + db) / 2] += Q_M1[jindx[l] + k][cnt1][cnt2 / 2] * Q_M1[jindx[seq_length] + l + 1][cnt3][cnt4 / 2];
-                  if (update_m2) {
-                    updatePosteriorBoundaries(cnt1 + cnt3 + da,
-                                              cnt2 + cnt4 + db,
-                                              &k_min_post_m2,
-                                              &k_max_post_m2,
-                                              &l_min_post_m2,
-                                              &l_max_post_m2
-                                              );
-                  }
-                } else {
-                  matrices->Q_M2_rem[k] += Q_M1[jindx[l] + k][cnt1][cnt2 / 2] * Q_M1[jindx[seq_length] + l + 1][cnt3][cnt4 / 2];
-                }
-              }
-          }
+              propagateRow(matrices->Q_M2[k],
+                           cnt1 + cnt3 + da,
+                           cnt2 + db,
+                           Q_M1[jindx[seq_length] + l + 1][cnt3],
+                           l_min_Q_M1[jindx[seq_length] + l + 1][cnt3],
+                           l_max_Q_M1[jindx[seq_length] + l + 1][cnt3],
+                           Q_M1[jindx[l] + k][cnt1][cnt2 / 2],
+                           1.,
+                           maxD1,
+                           maxD2,
+                           &matrices->Q_M2_rem[k],
+                           update_m2 ? &k_min_post_m2 : NULL,
+                           &k_max_post_m2,
+                           &l_min_post_m2,
+                           &l_max_post_m2
+                           );
       }
     }
     if (update_m2) {
@@ -1369,12 +1466,6 @@ pf2D_circ(vrna_fold_compound_t *vc)
   max_k = mm1[my_iindx[1] - seq_length] + referenceBPs1[my_iindx[1] - seq_length];
   max_l = mm2[my_iindx[1] - seq_length] + referenceBPs2[my_iindx[1] - seq_length];
 
-#ifdef _OPENMP
-#pragma omp sections
-  {
-#pragma omp section
-    {
-#endif
   if (!matrices->Q_c) {
     update_c = 1;
     prepareBoundaries(min_k,
@@ -1402,13 +1493,6 @@ pf2D_circ(vrna_fold_compound_t *vc)
                                );
   }
 
-#ifdef _OPENMP
-}
-
-
-#pragma omp section
-{
-#endif
   if (!matrices->Q_cH) {
     update_cH = 1;
     prepareBoundaries(min_k,
@@ -1436,11 +1520,6 @@ pf2D_circ(vrna_fold_compound_t *vc)
                                );
   }
 
-#ifdef _OPENMP
-}
-#pragma omp section
-{
-#endif
   if (!matrices->Q_cI) {
     update_cI = 1;
     prepareBoundaries(min_k,
@@ -1468,11 +1547,6 @@ pf2D_circ(vrna_fold_compound_t *vc)
                                );
   }
 
-#ifdef _OPENMP
-}
-#pragma omp section
-{
-#endif
   if (!matrices->Q_cM) {
     update_cM = 1;
     prepareBoundaries(min_k,
@@ -1500,20 +1574,49 @@ pf2D_circ(vrna_fold_compound_t *vc)
                                );
   }
 
+  /*
+   *  Each thread collects the exterior hairpin, interior and multiloop
+   *  contributions in private copies of Q_cH, Q_cI, and Q_cM. The work
+   *  is distributed statically and the copies are merged into the shared
+   *  matrices in order of the thread ids afterwards, so the sums do not
+   *  depend on the timing of the threads
+   */
+  cells   = (cell_t *)vrna_alloc(sizeof(cell_t) * (seq_length * (seq_length + 1) / 2));
+  n_cells = prepareCells(vc, TURN + 2, seq_length, cells);
+
 #ifdef _OPENMP
-}
-}
+  n_threads = omp_get_max_threads();
+#else
+  n_threads = 1;
 #endif
 
+  planes = (plane_t *)vrna_alloc(sizeof(plane_t) * 3 * n_threads);
+
+#ifdef _OPENMP
+#pragma omp parallel private(p, q, pq, k, l, kl, u, da, db, type, cnt1, cnt2, cnt3, t)
+#endif
+  {
+    unsigned int  c;
+    plane_t       cH, cI, cM;
 
-  for (d = TURN + 2; d <= seq_length; d++) /* i,j in [1..length] */
 #ifdef _OPENMP
-#pragma omp parallel for private(p, q, pq, k, l, kl, u, da, db, type, cnt1, cnt2, cnt3, cnt4)
+    t = omp_get_thread_num();
+#else
+    t = 0;
 #endif
-    for (q = d; q <= seq_length; q++) {
+
+    preparePlane(&cH, max_k, max_l, bpdist[my_iindx[1] - seq_length]);
+    preparePlane(&cI, max_k, max_l, bpdist[my_iindx[1] - seq_length]);
+    preparePlane(&cM, max_k, max_l, bpdist[my_iindx[1] - seq_length]);
+
+#ifdef _OPENMP
+#pragma omp for schedule(static, 1) nowait
+#endif
+    for (c = 0; c < n_cells; c++) {
       FLT_OR_DBL  qot;
       char        loopseq[10];
-      p   = q - d + 1;
+      p   = cells[c].i;
+      q   = cells[c].j;
       pq  = my_iindx[p] - q;
 
       /* 1. get exterior hairpin contribution  */
@@ -1545,30 +1648,28 @@ pf2D_circ(vrna_fold_compound_t *vc)
       qot = exp_E_Hairpin(u, type, S1[q + 1], S1[p - 1], loopseq, pf_params) * scale[u];
 
       if (Q_B_rem[pq])
-        matrices->Q_cH_rem += Q_B_rem[pq] * qot;
+        cH.rem += Q_B_rem[pq] * qot;
 
       if (Q_B[pq]) {
         for (cnt1 = k_min_Q_B[pq];
              cnt1 <= k_max_Q_B[pq];
              cnt1++)
-          for (cnt2 = l_min_Q_B[pq][cnt1];
-               cnt2 <= l_max_Q_B[pq][cnt1];
-               cnt2 += 2) {
-            if (((cnt1 + da) <= maxD1) && ((cnt2 + db) <= maxD2)) {
-              matrices->Q_cH[cnt1 + da][(cnt2 + db) / 2] += Q_B[pq][cnt1][cnt2 / 2] * qot;
-              if (update_cH) {
-                updatePosteriorBoundaries(cnt1 + da,
-                                          cnt2 + db,
-                                          &min_k_real_qcH,
-                                          &max_k_real_qcH,
-                                          &min_l_real_qcH,
-                                          &max_l_real_qcH
-                                          );
-              }
-            } else {
-              matrices->Q_cH_rem += Q_B[pq][cnt1][cnt2 / 2] * qot;
-            }
-          }
+          propagateRow(cH.Q,
+                       cnt1 + da,
+                       db,
+                       Q_B[pq][cnt1],
+                       l_min_Q_B[pq][cnt1],
+                       l_max_Q_B[pq][cnt1],
+                       qot,
+                       1.,
+                       maxD1,
+                       maxD2,
+                       &cH.rem,
+                       &cH.k_min_real,
+                       &cH.k_max_real,
+                       &cH.l_min_real,
+                       &cH.l_max_real
+                       );
       }
 
       /* 2. exterior interior loops, i "define" the (k,l) pair as "outer pair"  */
@@ -1601,7 +1702,7 @@ pf2D_circ(vrna_fold_compound_t *vc)
             qot = exp_E_IntLoop(ln2, ln1, rtype[type2], type, S1[l + 1], S1[k - 1], S1[p - 1], S1[q + 1], pf_params) * scale[ln1 + ln2];
 
             if (Q_B_rem[kl])
-              matrices->Q_cI_rem += Q_B_rem[pq] * Q_B_rem[kl] * qot;
+              cI.rem += Q_B_rem[pq] * Q_B_rem[kl] * qot;
 
             if (Q_B[kl]) {
               for (cnt1 = k_min_Q_B[kl];
@@ -1610,7 +1711,7 @@ pf2D_circ(vrna_fold_compound_t *vc)
                 for (cnt2 = l_min_Q_B[kl][cnt1];
                      cnt2 <= l_max_Q_B[kl][cnt1];
                      cnt2 += 2)
-                  matrices->Q_cI_rem += Q_B_rem[pq] * Q_B[kl][cnt1][cnt2 / 2] * qot;
+                  cI.rem += Q_B_rem[pq] * Q_B[kl][cnt1][cnt2 / 2] * qot;
             }
           }
         }
@@ -1650,7 +1751,7 @@ pf2D_circ(vrna_fold_compound_t *vc)
                 for (cnt2 = l_min_Q_B[pq][cnt1];
                      cnt2 <= l_max_Q_B[pq][cnt1];
                      cnt2 += 2)
-                  matrices->Q_cI_rem += Q_B[pq][cnt1][cnt2 / 2] * Q_B_rem[kl] * qot;
+                  cI.rem += Q_B[pq][cnt1][cnt2 / 2] * Q_B_rem[kl] * qot;
             }
 
             if (!Q_B[kl])
@@ -1666,27 +1767,130 @@ pf2D_circ(vrna_fold_compound_t *vc)
             for (cnt1 = k_min_Q_B[pq]; cnt1 <= k_max_Q_B[pq]; cnt1++)
               for (cnt2 = l_min_Q_B[pq][cnt1]; cnt2 <= l_max_Q_B[pq][cnt1]; cnt2 += 2)
                 for (cnt3 = k_min_Q_B[kl]; cnt3 <= k_max_Q_B[kl]; cnt3++)
-                  for (cnt4 = l_min_Q_B[kl][cnt3]; cnt4 <= l_max_Q_B[kl][cnt3]; cnt4 += 2) {
-                    if (((cnt1 + cnt3 + da) <= maxD1) && ((cnt2 + cnt4 + db) <= maxD2)) {
-                      matrices->Q_cI[cnt1 + cnt3 + da][(cnt2 + cnt4 + db) / 2] += Q_B[pq][cnt1][cnt2 / 2] * Q_B[kl][cnt3][cnt4 / 2] * qot;
-                      if (update_cI) {
-                        updatePosteriorBoundaries(cnt1 + cnt3 + da,
-                                                  cnt2 + cnt4 + db,
-                                                  &min_k_real_qcI,
-                                                  &max_k_real_qcI,
-                                                  &min_l_real_qcI,
-                                                  &max_l_real_qcI
-                                                  );
-                      }
-                    } else {
-                      matrices->Q_cI_rem += Q_B[pq][cnt1][cnt2 / 2] * Q_B[kl][cnt3][cnt4 / 2] * qot;
-                    }
-                  }
+                  propagateRow(cI.Q,
+                               cnt1 + cnt3 + da,
+                               cnt2 + db,
+                               Q_B[kl][cnt3],
+                               l_min_Q_B[kl][cnt3],
+                               l_max_Q_B[kl][cnt3],
+                               Q_B[pq][cnt1][cnt2 / 2],
+                               qot,
+                               maxD1,
+                               maxD2,
+                               &cI.rem,
+                               &cI.k_min_real,
+                               &cI.k_max_real,
+                               &cI.l_min_real,
+                               &cI.l_max_real
+                               );
+          }
+        }
+      }
+    }
+
+    /* 3. Multiloops  */
+    if (seq_length > 2 * TURN - 3) {
+#ifdef _OPENMP
+#pragma omp for schedule(static, 1) nowait
+#endif
+      for (k = TURN + 2; k < seq_length - 2 * TURN - 3; k++) {
+        if (Q_M_rem[my_iindx[1] - k]) {
+          if (matrices->Q_M2[k + 1]) {
+            for (cnt1 = matrices->k_min_Q_M2[k + 1];
+                 cnt1 <= matrices->k_max_Q_M2[k + 1];
+                 cnt1++)
+              for (cnt2 = matrices->l_min_Q_M2[k + 1][cnt1];
+                   cnt2 <= matrices->l_max_Q_M2[k + 1][cnt1];
+                   cnt2 += 2)
+                cM.rem += Q_M_rem[my_iindx[1] - k] * matrices->Q_M2[k + 1][cnt1][cnt2 / 2] * pf_params->expMLclosing;
           }
+
+          if (matrices->Q_M2_rem[k + 1])
+            cM.rem += Q_M_rem[my_iindx[1] - k] * matrices->Q_M2_rem[k + 1] * pf_params->expMLclosing;
+        }
+
+        if (matrices->Q_M2_rem[k + 1]) {
+          if (Q_M[my_iindx[1] - k]) {
+            for (cnt1 = k_min_Q_M[my_iindx[1] - k];
+                 cnt1 <= k_max_Q_M[my_iindx[1] - k];
+                 cnt1++)
+              for (cnt2 = l_min_Q_M[my_iindx[1] - k][cnt1];
+                   cnt2 <= l_max_Q_M[my_iindx[1] - k][cnt1];
+                   cnt2 += 2)
+                cM.rem += Q_M[my_iindx[1] - k][cnt1][cnt2 / 2] * matrices->Q_M2_rem[k + 1] * pf_params->expMLclosing;
+          }
+        }
+
+        /* get distancies to references
+         * d3a = dbp(T1_[1,n}, T1_{1,k} + T1_{k+1, n})
+         * d3b = dbp(T2_[1,n}, T2_{1,k} + T2_{k+1, n})
+         */
+        da  = base_d1 - referenceBPs1[my_iindx[1] - k] - referenceBPs1[my_iindx[k + 1] - seq_length];
+        db  = base_d2 - referenceBPs2[my_iindx[1] - k] - referenceBPs2[my_iindx[k + 1] - seq_length];
+        if (Q_M[my_iindx[1] - k] && matrices->Q_M2[k + 1]) {
+          for (cnt1 = k_min_Q_M[my_iindx[1] - k]; cnt1 <= k_max_Q_M[my_iindx[1] - k]; cnt1++)
+            for (cnt2 = l_min_Q_M[my_iindx[1] - k][cnt1]; cnt2 <= l_max_Q_M[my_iindx[1] - k][cnt1]; cnt2 += 2)
+              for (cnt3 = matrices->k_min_Q_M2[k + 1]; cnt3 <= matrices->k_max_Q_M2[k + 1]; cnt3++)
+                propagateRow(cM.Q,
+                             cnt1 + cnt3 + da,
+                             cnt2 + db,
+                             matrices->Q_M2[k + 1][cnt3],
+                             matrices->l_min_Q_M2[k + 1][cnt3],
+                             matrices->l_max_Q_M2[k + 1][cnt3],
+                             Q_M[my_iindx[1] - k][cnt1][cnt2 / 2],
+                             pf_params->expMLclosing,
+                             maxD1,
+                             maxD2,
+                             &cM.rem,
+                             &cM.k_min_real,
+                             &cM.k_max_real,
+                             &cM.l_min_real,
+                             &cM.l_max_real
+                             );
         }
       }
     }
 
+    planes[3 * t]     = cH;
+    planes[3 * t + 1] = cI;
+    planes[3 * t + 2] = cM;
+  }
+
+  free(cells);
+
+  /* planes of threads that did not take part in the computation were never prepared */
+  for (t = 0; t < n_threads; t++) {
+    if (!planes[3 * t].Q)
+      continue;
+
+    mergePlane(&planes[3 * t],
+               matrices->Q_cH,
+               &matrices->Q_cH_rem,
+               update_cH ? &min_k_real_qcH : NULL,
+               &max_k_real_qcH,
+               &min_l_real_qcH,
+               &max_l_real_qcH
+               );
+    mergePlane(&planes[3 * t + 1],
+               matrices->Q_cI,
+               &matrices->Q_cI_rem,
+               update_cI ? &min_k_real_qcI : NULL,
+               &max_k_real_qcI,
+               &min_l_real_qcI,
+               &max_l_real_qcI
+               );
+    mergePlane(&planes[3 * t + 2],
+               matrices->Q_cM,
+               &matrices->Q_cM_rem,
+               update_cM ? &min_k_real_qcM : NULL,
+               &max_k_real_qcM,
+               &min_l_real_qcM,
+               &max_l_real_qcM
+               );
+  }
+
+  free(planes);
+
   if (update_cH) {
     adjustArrayBoundaries(&matrices->Q_cH,
                           &matrices->k_min_Q_cH,
@@ -1713,69 +1917,6 @@ pf2D_circ(vrna_fold_compound_t *vc)
                           );
   }
 
-  /* 3. Multiloops  */
-  if (seq_length > 2 * TURN - 3) {
-#ifdef _OPENMP
-#pragma omp parallel for private(k, da, db, cnt1, cnt2, cnt3, cnt4)
-#endif
-    for (k = TURN + 2; k < seq_length - 2 * TURN - 3; k++) {
-      if (Q_M_rem[my_iindx[1] - k]) {
-        if (matrices->Q_M2[k + 1]) {
-          for (cnt1 = matrices->k_min_Q_M2[k + 1];
-               cnt1 <= matrices->k_max_Q_M2[k + 1];
-               cnt1++)
-            for (cnt2 = matrices->l_min_Q_M2[k + 1][cnt1];
-                 cnt2 <= matrices->l_max_Q_M2[k + 1][cnt1];
-                 cnt2 += 2)
-              matrices->Q_cM_rem += Q_M_rem[my_iindx[1] - k] * matrices->Q_M2[k + 1][cnt1][cnt2 / 2] * pf_params->expMLclosing;
-        }
-
-        if (matrices->Q_M2_rem[k + 1])
-          matrices->Q_cM_rem += Q_M_rem[my_iindx[1] - k] * matrices->Q_M2_rem[k + 1] * pf_params->expMLclosing;
-      }
-
-      if (matrices->Q_M2_rem[k + 1]) {
-        if (Q_M[my_iindx[1] - k]) {
-          for (cnt1 = k_min_Q_M[my_iindx[1] - k];
-               cnt1 <= k_max_Q_M[my_iindx[1] - k];
-               cnt1++)
-            for (cnt2 = l_min_Q_M[my_iindx[1] - k][cnt1];
-                 cnt2 <= l_max_Q_M[my_iindx[1] - k][cnt1];
-                 cnt2 += 2)
-              matrices->Q_cM_rem += Q_M[my_iindx[1] - k][cnt1][cnt2 / 2] * matrices->Q_M2_rem[k + 1] * pf_params->expMLclosing;
-        }
-      }
-
-      /* get distancies to references
-       * d3a = dbp(T1_[1,n}, T1_{1,k} + T1_{k+1, n})
-       * d3b = dbp(T2_[1,n}, T2_{1,k} + T2_{k+1, n})
-       */
-      da  = base_d1 - referenceBPs1[my_iindx[1] - k] - referenceBPs1[my_iindx[k + 1] - seq_length];
-      db  = base_d2 - referenceBPs2[my_iindx[1] - k] - referenceBPs2[my_iindx[k + 1] - seq_length];
-      if (Q_M[my_iindx[1] - k] && matrices->Q_M2[k + 1]) {
-        for (cnt1 = k_min_Q_M[my_iindx[1] - k]; cnt1 <= k_max_Q_M[my_iindx[1] - k]; cnt1++)
-          for (cnt2 = l_min_Q_M[my_iindx[1] - k][cnt1]; cnt2 <= l_max_Q_M[my_iindx[1] - k][cnt1]; cnt2 += 2)
-            for (cnt3 = matrices->k_min_Q_M2[k + 1]; cnt3 <= matrices->k_max_Q_M2[k + 1]; cnt3++)
-              for (cnt4 = matrices->l_min_Q_M2[k + 1][cnt3]; cnt4 <= matrices->l_max_Q_M2[k + 1][cnt3]; cnt4 += 2) {
-                if (((cnt1 + cnt3 + da) <= maxD1) && ((cnt2 + cnt4 + db) <= maxD2)) {
-                  matrices->Q_cM[cnt1 + cnt3 + da][(cnt2 + cnt4 + db) / 2] += Q_M[my_iindx[1] - k][cnt1][cnt2 / 2] * matrices->Q_M2[k + 1][cnt3][cnt4 / 2] * pf_params->expMLclosing;
-                  if (update_cM) {
-                    updatePosteriorBoundaries(cnt1 + cnt3 + da,
-                                              cnt2 + cnt4 + db,
-                                              &min_k_real_qcM,
-                                              &max_k_real_qcM,
-                                              &min_l_real_qcM,
-                                              &max_l_real_qcM
-                                              );
-                  }
-                } else {
-                  matrices->Q_cM_rem += Q_M[my_iindx[1] - k][cnt1][cnt2 / 2] * matrices->Q_M2[k + 1][cnt3][cnt4 / 2] * pf_params->expMLclosing;
-                }
-              }
-      }
-    }
-  }
-
   if (update_cM) {
     adjustArrayBoundaries(&matrices->Q_cM,
                           &matrices->k_min_Q_cM,
@@ -4210,6 +4351,218 @@ prepareArray(FLT_OR_DBL ***array,
 }
 
 
+PRIVATE int
+compareCells(const void *a,
+             const void *b)
+{
+  const cell_t  *c1 = (const cell_t *)a;
+  const cell_t  *c2 = (const cell_t *)b;
+
+  if (c1->weight != c2->weight)
+    return (c1->weight > c2->weight) ? -1 : 1;
+
+  return (c1->j > c2->j) - (c1->j < c2->j);
+}
+
+
+/*
+ *  Collect all cells (i,j) with d_min <= j - i + 1 <= d_max and sort them by
+ *  the estimated size of their distance class planes, largest first
+ */
+PRIVATE unsigned int
+prepareCells(vrna_fold_compound_t *vc,
+             unsigned int         d_min,
+             unsigned int         d_max,
+             cell_t               *cells)
+{
+  unsigned int d, i, j, ij, k, l, n;
+
+  n = 0;
+
+  for (d = d_min; d <= d_max; d++)
+    for (j = d; j <= vc->length; j++) {
+      i   = j - d + 1;
+      ij  = vc->iindx[i] - j;
+      k   = MIN2(vc->maxD1, vc->mm1[ij] + vc->referenceBPs1[ij]);
+      l   = MIN2(vc->maxD2, vc->mm2[ij] + vc->referenceBPs2[ij]);
+
+      cells[n].i      = i;
+      cells[n].j      = j;
+      cells[n].weight = (k + 1) * (l / 2 + 1);
+      n++;
+    }
+
+  qsort(cells, n, sizeof(cell_t), compareCells);
+
+  return n;
+}
+
+
+PRIVATE void
+preparePlane(plane_t  *plane,
+             int      max_k,
+             int      max_l,
+             int      bpdist)
+{
+  plane->rem = 0.;
+
+  prepareBoundaries(0,
+                    max_k,
+                    0,
+                    max_l,
+                    bpdist,
+                    &plane->k_min,
+                    &plane->k_max,
+                    &plane->l_min,
+                    &plane->l_max
+                    );
+
+  prepareArray(&plane->Q,
+               plane->k_min,
+               plane->k_max,
+               plane->l_min,
+               plane->l_max
+               );
+
+  preparePosteriorBoundaries(plane->k_max - plane->k_min + 1,
+                             plane->k_min,
+                             &plane->k_min_real,
+                             &plane->k_max_real,
+                             &plane->l_min_real,
+                             &plane->l_max_real
+                             );
+}
+
+
+/*
+ *  merge a thread private plane into the shared plane Q and release it,
+ *  the boundaries of Q are only updated if min_k is not NULL
+ */
+PRIVATE void
+mergePlane(plane_t    *plane,
+           FLT_OR_DBL **Q,
+           FLT_OR_DBL *rem,
+           int        *min_k,
+           int        *max_k,
+           int        **min_l,
+           int        **max_l)
+{
+  int k, l;
+
+  for (k = plane->k_min_real; k <= plane->k_max_real; k++) {
+    if (plane->l_min_real[k] == INF)
+      continue;
+
+    for (l = plane->l_min_real[k]; l <= plane->l_max_real[k]; l += 2)
+      Q[k][l / 2] += plane->Q[k][l / 2];
+
+    if (min_k) {
+      updatePosteriorBoundaries(k, plane->l_min_real[k], min_k, max_k, min_l, max_l);
+      updatePosteriorBoundaries(k, plane->l_max_real[k], min_k, max_k, min_l, max_l);
+    }
+  }
+
+  *rem += plane->rem;
+
+  /* without any actual data, all memory of the plane is released */
+  adjustArrayBoundaries(&plane->Q,
+                        &plane->k_min,
+                        &plane->k_max,
+                        &plane->l_min,
+                        &plane->l_max,
+                        INF,
+                        0,
+                        plane->l_min_real,
+                        plane->l_max_real
+                        );
+}
+
+
+/*
+ *  Add the row of a source plane, i.e. all entries source[l / 2] with
+ *  l_min <= l <= l_max, to row k of the target plane with weight a * c.
+ *  The entry source[l / 2] contributes to target[k][(l + dl) / 2], where
+ *  k and dl already include the shifts of both distances. Contributions
+ *  beyond maxD1, maxD2 are collected in rem instead. The boundaries of the
+ *  target are only updated if min_k is not NULL
+ */
+INLINE PRIVATE void
+propagateRow(FLT_OR_DBL       **target,
+             int              k,
+             int              dl,
+             const FLT_OR_DBL *source,
+             int              l_min,
+             int              l_max,
+             FLT_OR_DBL       a,
+             FLT_OR_DBL       c,
+             int              maxD1,
+             int              maxD2,
+             FLT_OR_DBL       *rem,
+             int              *min_k,
+             int              *max_k,
+             int              **min_l,
+             int              **max_l)
+{
+  int n, n_in, t;
+
+  if (l_min > l_max)
+    return;
+
+  source  += l_min / 2;
+  n       = (l_max - l_min) / 2 + 1;
+  n_in    = 0;
+
+  if ((k <= maxD1) && (l_min + dl <= maxD2))
+    n_in = MIN2(n, (maxD2 - dl - l_min) / 2 + 1);
+
+  if (n_in > 0) {
+    (*mul_add)(target[k] + (l_min + dl) / 2, source, n_in, a, c);
+
+    if (min_k) {
+      updatePosteriorBoundaries(k, l_min + dl, min_k, max_k, min_l, max_l);
+      updatePosteriorBoundaries(k, l_min + 2 * (n_in - 1) + dl, min_k, max_k, min_l, max_l);
+    }
+  }
+
+  for (t = n_in; t < n; t++)
+    *rem += a * source[t] * c;
+}
+
+
+/* target[t] += a * source[t] * c */
+PRIVATE void
+mul_add_default(FLT_OR_DBL        *target,
+                const FLT_OR_DBL  *source,
+                int               n,
+                FLT_OR_DBL        a,
+                FLT_OR_DBL        c)
+{
+  int t;
+
+  for (t = 0; t < n; t++)
+    target[t] += a * source[t] * c;
+}
+
+
+PRIVATE void
+mul_add_dispatcher(FLT_OR_DBL       *target,
+                   const FLT_OR_DBL *source,
+                   int              n,
+                   FLT_OR_DBL       a,
+                   FLT_OR_DBL       c)
+{
+  mul_add = &mul_add_default;
+
+#if VRNA_WITH_SIMD_SSE41 && !defined(USE_FLOAT_PF)
+  if (vrna_cpu_simd_capabilities() & VRNA_CPU_SIMD_SSE41)
+    mul_add = &vrna_2Dpfold_mul_add_sse41;
+
+#endif
+
+  (*mul_add)(target, source, n, a, c);
+}
+
+
 /*
  #################################
  # DEPRECATED FUNCTIONS BELOW    #
@@ -29,31 +29,37 @@
 #include "ViennaRNA/fold_vars.h"
 #include "ViennaRNA/part_func.h"
 #include "ViennaRNA/utils/basic.h"
+#include "ViennaRNA/utils/cpu.h"
 #include "ViennaRNA/profiledist.h"
 #include "ViennaRNA/ProfileAln.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "profile_utils.inc"
 
 #define EQUAL(x, y)     (fabs((x) - (y)) <= fabs(x) * 2 * FLT_EPSILON)
 
-PRIVATE int *alignment[2];
+#define S_(i, j)        S[(size_t)(i) * cols + (j)]
+#define E_(i, j)        E[(size_t)(i) * cols + (j)]
+#define F_(i, j)        F[(size_t)(i) * cols + (j)]
+
+PRIVATE vrna_dist_ws_t *backward_compat_ws = NULL;
 
 PRIVATE void
-sprint_aligned_bppm(const float *T1,
+sprint_aligned_bppm(int         *alignment[2],
+                    const float *T1,
                     const char  *seq1,
                     const float *T2,
-                    const char  *seq2);
-
-
-PRIVATE double
-PrfEditScore(const float  *p1,
-             const float  *p2,
-             char         c1,
-             char         c2);
+                    const char  *seq2,
+                    char        **aligned_line);
 
 
 PRIVATE double
-average(double  x,
-        double  y);
+PrfEditScore(float  prf,
+             char   c1,
+             char   c2);
 
 
 PRIVATE double  open = -1.5, ext = -0.666;  /* defaults from clustalw */
@@ -62,93 +68,182 @@ PRIVATE int     free_ends = 1;              /* whether to use free end gaps */
 
 /*---------------------------------------------------------------------------*/
 
-PRIVATE float **
-newmat(int  l1,
-       int  l2)
+PUBLIC float
+profile_aln(const float *T1,
+            const char  *seq1,
+            const float *T2,
+            const char  *seq2)
 {
-  float **a;
+  float tot_score;
   int   i;
 
-  a = (float **)vrna_alloc((l1 + 1) * sizeof(float *));
-  for (i = 0; i <= l1; i++)
-    a[i] = (float *)vrna_alloc((l2 + 1) * sizeof(float));
-  return a;
+  if (!backward_compat_ws)
+    backward_compat_ws = vrna_dist_ws_init();
+
+  tot_score = vrna_profile_aln(backward_compat_ws,
+                               T1,
+                               seq1,
+                               T2,
+                               seq2,
+                               0,
+                               (edit_backtrack) ? VRNA_DIST_BACKTRACK : VRNA_DIST_DEFAULT);
+
+  if (edit_backtrack) {
+    /* hand the alignment over to the global aligned_line */
+    for (i = 0; i < 4; i++) {
+      free(aligned_line[i]);
+      aligned_line[i]                     = backward_compat_ws->aligned_line[i];
+      backward_compat_ws->aligned_line[i] = NULL;
+    }
+  }
+
+  return tot_score;
 }
 
 
 PUBLIC float
-profile_aln(const float *T1,
-            const char  *seq1,
-            const float *T2,
-            const char  *seq2)
+vrna_profile_aln(vrna_dist_ws_t *ws,
+                 const float    *T1,
+                 const char     *seq1,
+                 const float    *T2,
+                 const char     *seq2,
+                 unsigned int   band,
+                 unsigned int   options)
 {
   /* align the 2 probability profiles T1, T2 */
   /* This is like a Needleman-Wunsch alignment, with affine gap-costs
    * ala Gotoh. The score looks at both seq and pair profile */
 
-  float **S, **E, **F, tot_score;
-  int   i, j, length1, length2;
+  float         *S, *E, *F, *Sp, *Sc, *Ep, *Ec, *Fc, *sq2, *dot, *a, tot_score;
+  double        score;
+  int           i, j, length1, length2, cols, lo, hi, jlo, jhi, imax, backtrack;
+  profile_dot_f *dot_f;
 
-  length1 = strlen(seq1);
-  length2 = strlen(seq2);
-  S       = newmat(length1, length2);
-  E       = newmat(length1, length2);
-  F       = newmat(length1, length2);
+  length1   = strlen(seq1);
+  length2   = strlen(seq2);
+  cols      = length2 + 1;
+  backtrack = (options & VRNA_DIST_BACKTRACK) ? 1 : 0;
+  dot_f     = profile_dot_function();
 
-  E[0][0]   = F[0][0] = open - ext;
-  S[0][0]   = 0;
-  tot_score = -9999.;
+  profile_band(length1, length2, band, &lo, &hi);
+
+  /*
+   *  square root profile of T2, stored as one row per dimension,
+   *  followed by the structure scores of the current row, and the
+   *  square root profile of the current position in T1
+   */
+  sq2 = profile_row_buffer(ws, (size_t)4 * cols + 3);
+  dot = sq2 + (size_t)3 * cols;
+  a   = dot + cols;
 
-  for (i = 1; i <= length1; i++)
-    F[i][0] = -9999;                          /* impossible */
   for (j = 1; j <= length2; j++)
-    E[0][j] = -9999;                          /* impossible */
-  if (!free_ends) {
-    for (i = 1; i <= length1; i++)
-      S[i][0] = E[i][0] = E[i - 1][0] + ext;
-    for (j = 1; j <= length2; j++)
-      S[0][j] = F[0][j] = F[0][j - 1] + ext;
+    profile_sqrt_position(T2, j, 3, sq2 + j, cols);
+
+  /*
+   *  complete matrices for backtracking, otherwise two rows of S,
+   *  and a single row of E and F, respectively, that are updated
+   *  in place
+   */
+  if (backtrack) {
+    S = profile_mat_buffer(ws, (size_t)3 * (length1 + 1) * cols);
+    E = S + (size_t)(length1 + 1) * cols;
+    F = E + (size_t)(length1 + 1) * cols;
+  } else {
+    S = profile_mat_buffer(ws, (size_t)4 * cols);
+    E = S + (size_t)2 * cols;
+    F = E + cols;
+  }
+
+  Sc    = S;
+  Ec    = E;
+  Fc    = F;
+  Sc[0] = 0;
+  Ec[0] = Fc[0] = open - ext;
+
+  for (j = 1; j <= length2; j++) {
+    if (j > hi) {
+      Sc[j] = Ec[j] = Fc[j] = -PROFILE_INF;
+    } else {
+      Ec[j] = -9999;                          /* impossible */
+      if (free_ends)
+        Sc[j] = Fc[j] = 0;
+      else
+        Sc[j] = Fc[j] = Fc[j - 1] + ext;
+    }
   }
 
+  score = 0;
+  imax  = 0;
+
   for (i = 1; i <= length1; i++) {
-    for (j = 1; j <= length2; j++) {
+    Sp  = Sc;
+    Ep  = Ec;
+    Sc  = S + (size_t)((backtrack) ? i : (i & 1)) * cols;
+    Ec  = (backtrack) ? E + (size_t)i * cols : E;
+    Fc  = (backtrack) ? F + (size_t)i * cols : F;
+    jlo = MAX2(1, i - lo);
+    jhi = MIN2(length2, i + hi);
+
+    if (i > lo) {
+      Sc[0] = Ec[0] = Fc[0] = -PROFILE_INF;
+    } else {
+      Fc[0] = -9999;                          /* impossible */
+      if (free_ends)
+        Sc[0] = Ec[0] = 0;
+      else
+        Sc[0] = Ec[0] = Ep[0] + ext;
+    }
+
+    if (jlo > 1)
+      Sc[jlo - 1] = Ec[jlo - 1] = Fc[jlo - 1] = -PROFILE_INF;
+
+    if (jhi < length2)
+      Sc[jhi + 1] = Ec[jhi + 1] = Fc[jhi + 1] = -PROFILE_INF;
+
+    profile_sqrt_position(T1, i, 3, a, 1);
+    dot_f(a, sq2 + jlo, cols, 3, dot + jlo, jhi - jlo + 1);
+
+    for (j = jlo; j <= jhi; j++) {
       float M;
-      E[i][j] = MAX2(E[i - 1][j] + ext, S[i - 1][j] + open);
-      F[i][j] = MAX2(F[i][j - 1] + ext, S[i][j - 1] + open);
-      M       = S[i - 1][j - 1] + PrfEditScore(T1 + 3 * i, T2 + 3 * j, seq1[i - 1], seq2[j - 1]);
-      S[i][j] = MAX3(M, E[i][j], F[i][j]);
+      Ec[j] = MAX2(Ep[j] + ext, Sp[j] + open);
+      Fc[j] = MAX2(Fc[j - 1] + ext, Sc[j - 1] + open);
+      M     = Sp[j - 1] + PrfEditScore(dot[j], seq1[i - 1], seq2[j - 1]);
+      Sc[j] = MAX3(M, Ec[j], Fc[j]);
+    }
+
+    /* highest entry in the last column */
+    if ((jhi == length2) && (Sc[length2] > score)) {
+      score = Sc[length2];
+      imax  = i;
     }
   }
 
-  if (edit_backtrack) {
-    double  score = 0;
-    char    state = 'S';
-    int     pos, i, j;
-    alignment[0]  = (int *)vrna_alloc((length1 + length2 + 1) * sizeof(int));
-    alignment[1]  = (int *)vrna_alloc((length1 + length2 + 1) * sizeof(int));
+  if (free_ends) {
+    /* highest entry in the last row or column */
+    for (j = MAX2(1, length1 - lo); j <= length2; j++) {
+      if (Sc[j] > score) {
+        score = Sc[j];
+        imax  = -j;
+      }
+    }
+
+    tot_score = score;
+  } else {
+    tot_score = Sc[length2];
+  }
 
-    pos = length1 + length2;
-    i   = length1;
-    j   = length2;
+  if (backtrack) {
+    char  state = 'S';
+    int   pos, row, **alignment;
 
-    tot_score = S[length1][length2];
+    alignment = profile_alignment_buffer(ws, (size_t)(length1 + length2 + 1));
+    pos       = length1 + length2;
+    i         = length1;
+    j         = length2;
+    row       = 0;
 
     if (free_ends) {
-      /* find starting point for backtracking,
-       * search for highest entry in last row or column */
-      int imax = 0;
-      for (i = 1; i <= length1; i++) {
-        if (S[i][length2] > score) {
-          score = S[i][length2];
-          imax  = i;
-        }
-      }
-      for (j = 1; j <= length2; j++) {
-        if (S[length1][j] > score) {
-          score = S[length1][j];
-          imax  = -j;
-        }
-      }
+      /* start backtracking at the highest entry in last row or column */
       if (imax < 0) {
         for (j = length2; j > -imax; j--) {
           alignment[0][pos]   = 0;
@@ -162,38 +257,45 @@ profile_aln(const float *T1,
         }
         j = length2;
       }
-
-      tot_score = score;
     }
 
     while (i > 0 && j > 0) {
       switch (state) {
         case 'E':
-          score               = E[i][j];
+          score               = E_(i, j);
           alignment[0][pos]   = i;
           alignment[1][pos--] = 0;
-          if (EQUAL(score, S[i - 1][j] + open))
+          if (EQUAL(score, S_(i - 1, j) + open))
             state = 'S';
 
           i--;
           break;
         case 'F':
-          score               = F[i][j];
+          score               = F_(i, j);
           alignment[0][pos]   = 0;
           alignment[1][pos--] = j;
-          if (EQUAL(score, S[i][j - 1] + open))
+          if (EQUAL(score, S_(i, j - 1) + open))
             state = 'S';
 
           j--;
           break;
         case 'S':
-          score = S[i][j];
-          if (EQUAL(score, E[i][j])) {
+          score = S_(i, j);
+          if (row != i) {
+            /* re-compute the structure scores of row i */
+            jlo = MAX2(1, i - lo);
+            jhi = MIN2(length2, i + hi);
+            profile_sqrt_position(T1, i, 3, a, 1);
+            dot_f(a, sq2 + jlo, cols, 3, dot + jlo, jhi - jlo + 1);
+            row = i;
+          }
+
+          if (EQUAL(score, E_(i, j))) {
             state = 'E';
-          } else if (EQUAL(score, F[i][j])) {
+          } else if (EQUAL(score, F_(i, j))) {
             state = 'F';
-          } else if (EQUAL(score, S[i - 1][j - 1] +
-                           PrfEditScore(T1 + 3 * i, T2 + 3 * j, seq1[i - 1], seq2[j - 1]))) {
+          } else if (EQUAL(score, S_(i - 1, j - 1) +
+                           PrfEditScore(dot[j], seq1[i - 1], seq2[j - 1]))) {
             alignment[0][pos]   = i;
             alignment[1][pos--] = j;
             i--;
@@ -221,50 +323,89 @@ profile_aln(const float *T1,
     }
     alignment[0][0] = length1 + length2 - pos;   /* length of alignment */
 
-    sprint_aligned_bppm(T1, seq1, T2, seq2);
-    free(alignment[0]);
-    free(alignment[1]);
+    sprint_aligned_bppm(alignment, T1, seq1, T2, seq2, ws->aligned_line);
   }
 
-  for (i = 0; i <= length1; i++) {
-    free(S[i]);
-    free(E[i]);
-    free(F[i]);
-  }
-  free(S);
-  free(E);
-  free(F);
-
   return tot_score;
 }
 
 
-/*---------------------------------------------------------------------------*/
-PRIVATE inline double
-average(double  x,
-        double  y)
+PUBLIC float *
+vrna_profile_aln_matrix(const float   **profiles,
+                        const char    **sequences,
+                        unsigned int  band,
+                        unsigned int  options)
 {
-  /*
-   * As in Bonhoeffer et al (1993) 'RNA Multi Structure Landscapes',
-   * Eur. Biophys. J. 22: 13-24 we have chosen  the geometric mean.
-   */
-  return (float)sqrt(x * y);
+  float *matrix;
+  int   n, p, num_tiles, num_tile_pairs;
+
+  if ((!profiles) || (!sequences))
+    return NULL;
+
+  for (n = 0; profiles[n] && sequences[n]; n++) ;
+
+  if (n < 2)
+    return NULL;
+
+  matrix = (float *)vrna_alloc(sizeof(float) * n * (n - 1) / 2);
+
+  /* alignments of the individual pairs are not available */
+  options &= ~VRNA_DIST_BACKTRACK;
+
+  /* tiles of the lower triangle, dynamically assigned to idle threads */
+  num_tiles       = (n + PROFILE_TILE - 1) / PROFILE_TILE;
+  num_tile_pairs  = num_tiles * (num_tiles + 1) / 2;
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+  {
+    vrna_dist_ws_t *ws = vrna_dist_ws_init();
+
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+    for (p = 0; p < num_tile_pairs; p++) {
+      int ti, tj, i, j;
+
+      /* decode the index of the tile pair */
+      for (ti = 0; (ti + 1) * (ti + 2) / 2 <= p; ti++) ;
+      tj = p - ti * (ti + 1) / 2;
+
+      for (i = ti * PROFILE_TILE; (i < n) && (i < (ti + 1) * PROFILE_TILE); i++)
+        for (j = tj * PROFILE_TILE; (j < i) && (j < (tj + 1) * PROFILE_TILE); j++)
+          matrix[i * (i - 1) / 2 + j] = vrna_profile_aln(ws,
+                                                         profiles[i],
+                                                         sequences[i],
+                                                         profiles[j],
+                                                         sequences[j],
+                                                         band,
+                                                         options);
+    }
+
+    vrna_dist_ws_free(ws);
+  }
+
+  return matrix;
 }
 
 
+/*---------------------------------------------------------------------------*/
+
+/*
+ *  Score of aligning two positions, where prf is the sum of the averages of
+ *  the structure profile entries. As in Bonhoeffer et al (1993) 'RNA Multi
+ *  Structure Landscapes', Eur. Biophys. J. 22: 13-24 we have chosen the
+ *  geometric mean as average.
+ */
 PRIVATE double
-PrfEditScore(const float  *p1,
-             const float  *p2,
-             char         c1,
-             char         c2)
+PrfEditScore(float  prf,
+             char   c1,
+             char   c2)
 {
-  double  score;
-  int     k;
-
-  for (score = 0., k = 0; k < 3; k++)
-    score += average(p1[k], p2[k]);
+  double score;
 
-  score *= (1 - seqw);
+  score = prf * (1 - seqw);
   if (c1 == c2)
     score += seqw;
   else if (((c1 == 'A') && (c2 == 'G')) ||
@@ -282,10 +423,12 @@ PrfEditScore(const float  *p1,
 /*---------------------------------------------------------------------------*/
 
 PRIVATE void
-sprint_aligned_bppm(const float *T1,
+sprint_aligned_bppm(int         *alignment[2],
+                    const float *T1,
                     const char  *seq1,
                     const float *T2,
-                    const char  *seq2)
+                    const char  *seq2,
+                    char        **aligned_line)
 {
   int i, length;
 
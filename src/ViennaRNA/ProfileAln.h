@@ -1,12 +1,92 @@
 #ifndef VIENNA_RNA_PACKAGE_PROFILEALN_H
 #define VIENNA_RNA_PACKAGE_PROFILEALN_H
 
+#include <ViennaRNA/dist_vars.h>
+
+/**
+ *  \file ProfileAln.h
+ *  \brief Pairwise alignments of base pair probability profiles and sequences
+ */
+
+/**
+ *  \brief Align two probability profiles and their sequences
+ *
+ *  This is like a Needleman-Wunsch alignment with affine gap costs
+ *  ala Gotoh. The score looks at both, the sequence and the pair profile.
+ *  The aligned profiles and sequences are stored in #aligned_line if
+ *  #edit_backtrack is set.
+ *
+ *  \see set_paln_params(), vrna_profile_aln()
+ */
 float profile_aln(const float *T1,
                   const char  *seq1,
                   const float *T2,
                   const char  *seq2);
 
 
+/**
+ *  \brief Align two probability profiles and their sequences using a workspace
+ *
+ *  In contrast to profile_aln(), this function does not depend on the global
+ *  variable #edit_backtrack but takes the corresponding setting from \p options.
+ *  All memory is taken from the workspace \p ws and re-used in subsequent calls.
+ *  Hence, it may be called concurrently with different workspaces. If \p options
+ *  contains #VRNA_DIST_BACKTRACK, the aligned profiles, followed by the aligned
+ *  sequences, are stored in the \p aligned_line member of the workspace.
+ *
+ *  A non-zero \p band restricts the alignment to cells \f$(i,j)\f$ that are at most
+ *  \p band positions off the diagonal, extended by the length difference of the
+ *  two sequences.
+ *
+ *  \see vrna_dist_ws_init(), vrna_profile_aln_matrix(), set_paln_params()
+ *
+ *  \param ws      The workspace
+ *  \param T1      The first probability profile
+ *  \param seq1    The first sequence
+ *  \param T2      The second probability profile
+ *  \param seq2    The second sequence
+ *  \param band    The band width, or 0 for the complete dynamic programming matrices
+ *  \param options Options for the alignment
+ *  \return        The score of the optimal alignment
+ */
+float vrna_profile_aln(vrna_dist_ws_t *ws,
+                       const float    *T1,
+                       const char     *seq1,
+                       const float    *T2,
+                       const char     *seq2,
+                       unsigned int   band,
+                       unsigned int   options);
+
+
+/**
+ *  \brief Align all pairs of a list of probability profiles and their sequences
+ *
+ *  The matrix is split into tiles that are distributed among all available
+ *  threads if OpenMP is available. Each thread re-uses its own workspace for
+ *  all of its pairs. #VRNA_DIST_BACKTRACK is ignored.
+ *
+ *  The lower triangle of the score matrix is returned in row-major order
+ *  without the diagonal, i.e. the score of profiles \f$i > j\f$ (0-based)
+ *  is found at position \f$i(i-1)/2 + j\f$.
+ *
+ *  \see vrna_profile_aln()
+ *
+ *  \param profiles  A \em NULL terminated list of probability profiles
+ *  \param sequences The sequences of the profiles
+ *  \param band      The band width, or 0 for the complete dynamic programming matrices
+ *  \param options   Options for the alignments
+ *  \return          The lower triangle of the score matrix, or \em NULL if the list
+ *                   has less than two entries
+ */
+float *vrna_profile_aln_matrix(const float  **profiles,
+                               const char   **sequences,
+                               unsigned int band,
+                               unsigned int options);
+
+
+/**
+ *  \brief Set the gap costs, the sequence weight, and the treatment of end gaps for profile_aln()
+ */
 int set_paln_params(double  gap_open,
                     double  gap_ext,
                     double  seqweight,
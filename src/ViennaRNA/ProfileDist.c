@@ -13,29 +13,27 @@
 #include <string.h>
 #include <ctype.h>
 #include <math.h>
+#include <float.h>
 #include "ViennaRNA/dist_vars.h"
 #include "ViennaRNA/fold_vars.h"
 #include "ViennaRNA/part_func.h"
 #include "ViennaRNA/utils/basic.h"
+#include "ViennaRNA/utils/cpu.h"
 #include "ViennaRNA/profiledist.h"
 
-PRIVATE int *alignment[2];
-
-PRIVATE void
-sprint_aligned_bppm(const float *T1,
-                    const float *T2);
-
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
-PRIVATE double
-PrfEditCost(int         i,
-            int         j,
-            const float *T1,
-            const float *T2);
+#include "profile_utils.inc"
 
+PRIVATE vrna_dist_ws_t *backward_compat_ws = NULL;
 
-PRIVATE double
-average(double  x,
-        double  y);
+PRIVATE void
+sprint_aligned_bppm(int         *alignment[2],
+                    const float *T1,
+                    const float *T2,
+                    char        **aligned_line);
 
 
 /*---------------------------------------------------------------------------*/
@@ -44,181 +42,237 @@ PUBLIC float
 profile_edit_distance(const float *T1,
                       const float *T2)
 {
-  /* align the 2 probability profiles T1, T2 */
-  /* This is like a Needleman-Wunsch alignment,
-   * we should really use affine gap-costs ala Gotoh */
+  float dist;
 
-  float **distance;
-  short **i_point, **j_point;
+  if (!backward_compat_ws)
+    backward_compat_ws = vrna_dist_ws_init();
 
-  int   i, j, i1, j1, pos, length1, length2;
-  float minus, plus, change, temp;
+  dist = vrna_profile_edit_distance(backward_compat_ws,
+                                    T1,
+                                    T2,
+                                    0,
+                                    (edit_backtrack) ? VRNA_DIST_BACKTRACK : VRNA_DIST_DEFAULT);
 
-  i_point   = NULL;
-  j_point   = NULL;
-  length1   = (int)T1[0];
-  length2   = (int)T2[0];
-  distance  = (float **)vrna_alloc((length1 + 1) * sizeof(float *));
   if (edit_backtrack) {
-    i_point = (short **)vrna_alloc((length1 + 1) * sizeof(short *));
-    j_point = (short **)vrna_alloc((length1 + 1) * sizeof(short *));
+    /* hand the alignment over to the global aligned_line */
+    free(aligned_line[0]);
+    free(aligned_line[1]);
+    aligned_line[0]                     = backward_compat_ws->aligned_line[0];
+    aligned_line[1]                     = backward_compat_ws->aligned_line[1];
+    backward_compat_ws->aligned_line[0] = NULL;
+    backward_compat_ws->aligned_line[1] = NULL;
   }
 
-  for (i = 0; i <= length1; i++) {
-    distance[i] = (float *)vrna_alloc((length2 + 1) * sizeof(float));
-    if (edit_backtrack) {
-      i_point[i]  = (short *)vrna_alloc((length2 + 1) * sizeof(short));
-      j_point[i]  = (short *)vrna_alloc((length2 + 1) * sizeof(short));
-    }
-  }
+  return dist;
+}
 
-  for (i = 1; i <= length1; i++) {
-    distance[i][0] = distance[i - 1][0] + PrfEditCost(i, 0, T1, T2);
-    if (edit_backtrack) {
-      i_point[i][0] = (short)i - 1;
-      j_point[i][0] = 0;
-    }
-  }
-  for (j = 1; j <= length2; j++) {
-    distance[0][j] = distance[0][j - 1] + PrfEditCost(0, j, T1, T2);
-    if (edit_backtrack) {
-      i_point[0][j] = 0;
-      j_point[0][j] = (short)j - 1;
-    }
+
+PUBLIC float
+vrna_profile_edit_distance(vrna_dist_ws_t *ws,
+                           const float    *T1,
+                           const float    *T2,
+                           unsigned int   band,
+                           unsigned int   options)
+{
+  /* align the 2 probability profiles T1, T2 */
+  /* This is like a Needleman-Wunsch alignment,
+   * we should really use affine gap-costs ala Gotoh */
+
+  float         *D, *prev, *cur, *sq2, *ins, *dot, *a, minus, plus, change, dist;
+  double        del;
+  int           i, j, k, n, m, kmax, cols, lo, hi, jlo, jhi, backtrack;
+  profile_dot_f *dot_f;
+
+  n     = (int)T1[0];
+  m     = (int)T2[0];
+  kmax  = (int)T1[1];
+  if ((int)T2[1] != kmax)
+    vrna_message_error("inconsistent Profiles in vrna_profile_edit_distance()");
+
+  backtrack = (options & VRNA_DIST_BACKTRACK) ? 1 : 0;
+  cols      = m + 1;
+  dot_f     = profile_dot_function();
+
+  profile_band(n, m, band, &lo, &hi);
+
+  /*
+   *  square root profile of T2, stored as one row per dimension,
+   *  followed by the insertion costs, the scores of the current row,
+   *  and the square root profile of the current position in T1
+   */
+  sq2 = profile_row_buffer(ws, (size_t)(kmax + 2) * cols + kmax);
+  ins = sq2 + (size_t)kmax * cols;
+  dot = ins + cols;
+  a   = dot + cols;
+
+  for (j = 1; j <= m; j++) {
+    profile_sqrt_position(T2, j, kmax, sq2 + j, cols);
+    for (del = 0., k = 0; k < kmax; k++)
+      del += T2[j * kmax + k];
+    ins[j] = (float)del;
   }
-  for (i = 1; i <= length1; i++) {
-    for (j = 1; j <= length2; j++) {
-      minus   = distance[i - 1][j] + PrfEditCost(i, 0, T1, T2);
-      plus    = distance[i][j - 1] + PrfEditCost(0, j, T1, T2);
-      change  = distance[i - 1][j - 1] + PrfEditCost(i, j, T1, T2);
-
-      distance[i][j] = MIN3(minus, plus, change);
-      /* printf("%g ", distance[i][j]); */
-
-      if (edit_backtrack) {
-        if (distance[i][j] == change) {
-          i_point[i][j] = (short)i - 1;
-          j_point[i][j] = (short)j - 1;
-        } else if (distance[i][j] == plus) {
-          i_point[i][j] = (short)i;
-          j_point[i][j] = (short)j - 1;
-        } else {
-          i_point[i][j] = (short)i - 1;
-          j_point[i][j] = (short)j;
-        }
-      }
+
+  /* two rows suffice unless we want to backtrack */
+  D = profile_mat_buffer(ws, (size_t)((backtrack) ? n + 1 : 2) * cols);
+
+  cur     = D;
+  cur[0]  = 0.;
+  for (j = 1; j <= m; j++)
+    cur[j] = (j <= hi) ? cur[j - 1] + ins[j] : PROFILE_INF;
+
+  for (i = 1; i <= n; i++) {
+    prev  = cur;
+    cur   = D + (size_t)((backtrack) ? i : (i & 1)) * cols;
+    jlo   = MAX2(1, i - lo);
+    jhi   = MIN2(m, i + hi);
+
+    for (del = 0., k = 0; k < kmax; k++)
+      del += T1[i * kmax + k];
+
+    profile_sqrt_position(T1, i, kmax, a, 1);
+
+    cur[0] = (i <= lo) ? prev[0] + del : PROFILE_INF;
+    if (jlo > 1)
+      cur[jlo - 1] = PROFILE_INF;
+
+    if (jhi < m)
+      cur[jhi + 1] = PROFILE_INF;
+
+    /*
+     *  substitution costs are 2 - 2 sum_k avg(T1[i][k], T2[j][k]) where, as in
+     *  Bonhoeffer et al (1993) 'RNA Multi Structure Landscapes', Eur. Biophys. J.
+     *  22: 13-24, we have chosen the geometric mean as average
+     */
+    dot_f(a, sq2 + jlo, cols, kmax, dot + jlo, jhi - jlo + 1);
+
+    for (j = jlo; j <= jhi; j++) {
+      minus   = prev[j] + del;
+      plus    = cur[j - 1] + ins[j];
+      change  = prev[j - 1] + (2. - 2. * dot[j]);
+      cur[j]  = MIN3(minus, plus, change);
     }
-    /* printf("\n"); */
   }
-  /* printf("\n"); */
-  temp = distance[length1][length2];
-  for (i = 0; i <= length1; i++)
-    free(distance[i]);
-  free(distance);
 
-  if (edit_backtrack) {
-    alignment[0]  = (int *)vrna_alloc((length1 + length2 + 1) * sizeof(int));
-    alignment[1]  = (int *)vrna_alloc((length1 + length2 + 1) * sizeof(int));
+  dist = cur[m];
+
+  if (backtrack) {
+    int pos, row, **alignment;
+
+    alignment = profile_alignment_buffer(ws, (size_t)(n + m + 1));
+    pos       = n + m;
+    i         = n;
+    j         = m;
+    row       = 0;
 
-    pos = length1 + length2;
-    i   = length1;
-    j   = length2;
     while ((i > 0) || (j > 0)) {
-      i1  = i_point[i][j];
-      j1  = j_point[i][j];
-      if (((i - i1) == 1) && ((j - j1) == 1)) {
-        /* substitution    */
-        alignment[0][pos] = i;
-        alignment[1][pos] = j;
-      }
+      int di, dj;
+
+      if (j == 0) {
+        di  = 1;
+        dj  = 0;
+      } else if (i == 0) {
+        di  = 0;
+        dj  = 1;
+      } else {
+        if (row != i) {
+          /* re-compute the scores of row i */
+          profile_sqrt_position(T1, i, kmax, a, 1);
+          jlo = MAX2(1, i - lo);
+          jhi = MIN2(m, i + hi);
+          dot_f(a, sq2 + jlo, cols, kmax, dot + jlo, jhi - jlo + 1);
+          row = i;
+        }
 
-      if (((i - i1) == 1) && (j == j1)) {
-        /* Deletion in [1] */
-        alignment[0][pos] = i;
-        alignment[1][pos] = 0;
-      }
+        change  = D[(size_t)(i - 1) * cols + j - 1] + (2. - 2. * dot[j]);
+        plus    = D[(size_t)i * cols + j - 1] + ins[j];
 
-      if ((i == i1) && ((j - j1) == 1)) {
-        /* Deletion in [0] */
-        alignment[0][pos] = 0;
-        alignment[1][pos] = j;
+        if (D[(size_t)i * cols + j] == change) {
+          di  = 1;
+          dj  = 1;
+        } else if (D[(size_t)i * cols + j] == plus) {
+          di  = 0;
+          dj  = 1;
+        } else {
+          di  = 1;
+          dj  = 0;
+        }
       }
 
+      /* INDELs have one 0 */
+      alignment[0][pos] = (di) ? i : 0;
+      alignment[1][pos] = (dj) ? j : 0;
       pos--;
-      i = i1;
-      j = j1;
+      i -= di;
+      j -= dj;
     }
-    for (i = pos + 1; i <= length1 + length2; i++) {
+
+    for (i = pos + 1; i <= n + m; i++) {
       alignment[0][i - pos] = alignment[0][i];
       alignment[1][i - pos] = alignment[1][i];
     }
-    alignment[0][0] = length1 + length2 - pos;   /* length of alignment */
+    alignment[0][0] = n + m - pos;   /* length of alignment */
 
-    for (i = 0; i <= length1; i++) {
-      free(i_point[i]);
-      free(j_point[i]);
-    }
-    free(i_point);
-    free(j_point);
-    sprint_aligned_bppm(T1, T2);
-    free(alignment[0]);
-    free(alignment[1]);
+    sprint_aligned_bppm(alignment, T1, T2, ws->aligned_line);
   }
 
-  return temp;
+  return dist;
 }
 
 
-/*---------------------------------------------------------------------------*/
-
-PRIVATE double
-PrfEditCost(int         i,
-            int         j,
-            const float *T1,
-            const float *T2)
+PUBLIC float *
+vrna_profile_edit_distance_matrix(const float   **profiles,
+                                  unsigned int  band,
+                                  unsigned int  options)
 {
-  double  dist;
-  int     k, kmax;
+  float *matrix;
+  int   n, p, num_tiles, num_tile_pairs;
 
-  kmax = (int)T1[1];
-  if ((int)T2[1] != kmax)
-    vrna_message_error("inconsistent Profiles in PrfEditCost");
+  if (!profiles)
+    return NULL;
 
-  if (i == 0)
-    for (dist = 0., k = 0; k < kmax; k++)
-      dist += T2[j * kmax + k];
+  for (n = 0; profiles[n]; n++) ;
 
-  if (j == 0)
-    for (dist = 0., k = 0; k < kmax; k++)
-      dist += T1[i * kmax + k];
+  if (n < 2)
+    return NULL;
 
-  if ((i > 0) && (j > 0))
-    for (dist = 2., k = 0; k < kmax; k++)
-      dist -= 2. * average(T1[i * kmax + k], T2[j * kmax + k]);
+  matrix = (float *)vrna_alloc(sizeof(float) * n * (n - 1) / 2);
 
-  return dist;
-}
+  /* alignments of the individual pairs are not available */
+  options &= ~VRNA_DIST_BACKTRACK;
 
+  /* tiles of the lower triangle, dynamically assigned to idle threads */
+  num_tiles       = (n + PROFILE_TILE - 1) / PROFILE_TILE;
+  num_tile_pairs  = num_tiles * (num_tiles + 1) / 2;
 
-/*---------------------------------------------------------------------------*/
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+  {
+    vrna_dist_ws_t *ws = vrna_dist_ws_init();
 
-PRIVATE double
-average(double  x,
-        double  y)
-
-/* can be essentially anything that fulfils :
- * 1.)     a(x,y)  =  a(y,x)
- * 2.)     a(x,y) >=  0       for 0<= x,y <= 1
- * 3.)     a(x,y) <=  (x+y)/2
- * 4.)     a(x,x) >=  a(x,y)  for 0<= x,y <= 1
- * As in Bonhoeffer et al (1993) 'RNA Multi Structure Landscapes',
- * Eur. Biophys. J. 22: 13-24 we have chosen  the geometric mean.
- */
-{
-  float a;
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+    for (p = 0; p < num_tile_pairs; p++) {
+      int ti, tj, i, j;
+
+      /* decode the index of the tile pair */
+      for (ti = 0; (ti + 1) * (ti + 2) / 2 <= p; ti++) ;
+      tj = p - ti * (ti + 1) / 2;
+
+      for (i = ti * PROFILE_TILE; (i < n) && (i < (ti + 1) * PROFILE_TILE); i++)
+        for (j = tj * PROFILE_TILE; (j < i) && (j < (tj + 1) * PROFILE_TILE); j++)
+          matrix[i * (i - 1) / 2 + j] = vrna_profile_edit_distance(ws,
+                                                                   profiles[i],
+                                                                   profiles[j],
+                                                                   band,
+                                                                   options);
+    }
+
+    vrna_dist_ws_free(ws);
+  }
 
-  a = (float)sqrt(x * y);
-  return a;
+  return matrix;
 }
 
 
@@ -255,12 +309,16 @@ Make_bp_profile_bppm(FLT_OR_DBL *bppm,
 /*---------------------------------------------------------------------------*/
 
 PRIVATE void
-sprint_aligned_bppm(const float *T1,
-                    const float *T2)
+sprint_aligned_bppm(int         *alignment[2],
+                    const float *T1,
+                    const float *T2,
+                    char        **aligned_line)
 {
   int i, length;
 
-  length          = alignment[0][0];
+  length = alignment[0][0];
+  free(aligned_line[0]);
+  free(aligned_line[1]);
   aligned_line[0] = (char *)vrna_alloc((length + 1) * sizeof(char));
   aligned_line[1] = (char *)vrna_alloc((length + 1) * sizeof(char));
   for (i = 1; i <= length; i++) {
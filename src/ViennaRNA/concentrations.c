@@ -19,9 +19,17 @@
 #include <limits.h>
 
 #include "ViennaRNA/utils/basic.h"
+#include "ViennaRNA/utils/cpu.h"
 #include "ViennaRNA/fold_compound.h"
 #include "ViennaRNA/concentrations.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/* number of start concentration pairs per work unit of the batch solver */
+#define CONC_CHUNK  256
+
 /*
  #################################
  # GLOBAL VARIABLES              #
@@ -39,12 +47,46 @@
  # PRIVATE FUNCTION DECLARATIONS #
  #################################
  */
-PRIVATE double *Newton_Conc(double  ZAB,
-                            double  ZAA,
-                            double  ZBB,
-                            double  concA,
-                            double  concB,
-                            double  *ConcVec);
+PRIVATE void
+Newton_Conc(double  ZAB,
+            double  ZAA,
+            double  ZBB,
+            double  concA,
+            double  concB,
+            double  *ConcVec);
+
+
+typedef void (conc_newton_f)(double             KAB,
+                             double             KAA,
+                             double             KBB,
+                             const double       *startconc,
+                             size_t             num,
+                             vrna_dimer_conc_t  *conc);
+
+
+PRIVATE void
+newton_conc_default(double            KAB,
+                    double            KAA,
+                    double            KBB,
+                    const double      *startconc,
+                    size_t            num,
+                    vrna_dimer_conc_t *conc);
+
+
+#if VRNA_WITH_SIMD_SSE41
+void
+vrna_conc_newton_sse41(double             KAB,
+                       double             KAA,
+                       double             KBB,
+                       const double       *startconc,
+                       size_t             num,
+                       vrna_dimer_conc_t  *conc);
+
+
+#endif
+
+PRIVATE conc_newton_f *
+newton_conc_function(void);
 
 
 /*
@@ -65,48 +107,178 @@ vrna_pf_dimer_concentrations(double                 FcAB,
    * takes an array of start concentrations, computes equilibrium concentrations of dimers,
    * monomers, returns array of concentrations in strucutre vrna_dimer_conc_t
    */
-  double            *ConcVec;
-  int               i;
+  size_t            n;
+  vrna_dimer_conc_t *Concentration;
+
+  for (n = 0; ((startconc[2 * n] != 0) || (startconc[2 * n + 1] != 0)); n++); /* count */
+
+  Concentration = vrna_pf_dimer_concentrations_batch(FcAB,
+                                                     FcAA,
+                                                     FcBB,
+                                                     FEA,
+                                                     FEB,
+                                                     startconc,
+                                                     n,
+                                                     exp_params);
+
+  if (!Concentration) /* keep previous behavior and always return a valid memory block */
+    Concentration = (vrna_dimer_conc_t *)vrna_alloc(sizeof(vrna_dimer_conc_t));
+
+  return Concentration;
+}
+
+
+PUBLIC vrna_dimer_conc_t *
+vrna_pf_dimer_concentrations_batch(double                 FcAB,
+                                   double                 FcAA,
+                                   double                 FcBB,
+                                   double                 FEA,
+                                   double                 FEB,
+                                   const double           *startconc,
+                                   size_t                 num,
+                                   const vrna_exp_param_t *exp_params)
+{
+  long int          c, chunks;
   vrna_dimer_conc_t *Concentration;
   double            KAA, KAB, KBB, kT;
+  conc_newton_f     *newton;
+
+  if ((!startconc) || (!exp_params) || (num == 0))
+    return NULL;
 
   kT            = exp_params->kT / 1000.;
-  Concentration = (vrna_dimer_conc_t *)vrna_alloc(20 * sizeof(vrna_dimer_conc_t));
+  Concentration = (vrna_dimer_conc_t *)vrna_alloc(num * sizeof(vrna_dimer_conc_t));
   /* Compute equilibrium constants */
   /* again note the input free energies are not from the null model (without DuplexInit) */
 
   KAA = exp((2.0 * FEA - FcAA) / kT);
   KBB = exp((2.0 * FEB - FcBB) / kT);
   KAB = exp((FEA + FEB - FcAB) / kT);
-  /* printf("Kaa..%g %g %g\n", KAA, KBB, KAB); */
-  for (i = 0; ((startconc[i] != 0) || (startconc[i + 1] != 0)); i += 2) {
-    ConcVec = Newton_Conc(KAB,
-                          KAA,
-                          KBB,
-                          startconc[i],
-                          startconc[i + 1],
-                          ConcVec);
-    Concentration[i / 2].Ac_start = startconc[i];
-    Concentration[i / 2].Bc_start = startconc[i + 1];
-    Concentration[i / 2].ABc      = ConcVec[0];
-    Concentration[i / 2].AAc      = ConcVec[1];
-    Concentration[i / 2].BBc      = ConcVec[2];
-    Concentration[i / 2].Ac       = ConcVec[3];
-    Concentration[i / 2].Bc       = ConcVec[4];
-
-    if (!(((i + 2) / 2) % 20))
-      Concentration =
-        (vrna_dimer_conc_t *)vrna_realloc(Concentration,
-                                          ((i + 2) / 2 + 20) * sizeof(vrna_dimer_conc_t));
-
-    free(ConcVec);
+
+  newton  = newton_conc_function();
+  chunks  = (long int)((num + CONC_CHUNK - 1) / CONC_CHUNK);
+
+  /*
+   *  each pair of start concentrations is independent of all others, so
+   *  we distribute chunks of pairs among the threads and let the (SIMD)
+   *  kernel solve multiple pairs of a chunk at once
+   */
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1) if (chunks > 1)
+#endif
+  for (c = 0; c < chunks; c++) {
+    size_t first = (size_t)c * CONC_CHUNK;
+
+    newton(KAB,
+           KAA,
+           KBB,
+           startconc + 2 * first,
+           MIN2(CONC_CHUNK, num - first),
+           Concentration + first);
   }
 
   return Concentration;
 }
 
 
-PRIVATE double *
+PUBLIC int
+vrna_pf_dimer_concentrations_write(FILE                     *fp,
+                                   const vrna_dimer_conc_t  *conc,
+                                   size_t                   num,
+                                   unsigned int             options)
+{
+  char    *buf;
+  size_t  i, pos, buf_size;
+  double  tot;
+  int     ret;
+
+  if ((!fp) || ((!conc) && (num > 0)))
+    return 0;
+
+  if (options & VRNA_CONC_OUTPUT_BINARY)
+    return (fwrite(conc, sizeof(vrna_dimer_conc_t), num, fp) == num) ? 1 : 0;
+
+  /* CSV output, assembled in a large buffer that is flushed at once */
+  ret       = 1;
+  buf_size  = 65536;
+  buf       = (char *)vrna_alloc(sizeof(char) * buf_size);
+  pos       = snprintf(buf, buf_size, "A0,B0,AB,AA,BB,A,B\n");
+
+  for (i = 0; i < num; i++) {
+    /* flush buffer if less than one full line of output remains */
+    if (buf_size - pos < 256) {
+      if (fwrite(buf, sizeof(char), pos, fp) != pos)
+        ret = 0;
+
+      pos = 0;
+    }
+
+    tot = (options & VRNA_CONC_OUTPUT_RELATIVE) ? conc[i].Ac_start + conc[i].Bc_start : 1.;
+
+    pos += snprintf(buf + pos,
+                    buf_size - pos,
+                    "%g,%g,%g,%g,%g,%g,%g\n",
+                    conc[i].Ac_start,
+                    conc[i].Bc_start,
+                    conc[i].ABc / tot,
+                    conc[i].AAc / tot,
+                    conc[i].BBc / tot,
+                    conc[i].Ac / tot,
+                    conc[i].Bc / tot);
+  }
+
+  if (fwrite(buf, sizeof(char), pos, fp) != pos)
+    ret = 0;
+
+  free(buf);
+
+  return ret;
+}
+
+
+PRIVATE void
+newton_conc_default(double            KAB,
+                    double            KAA,
+                    double            KBB,
+                    const double      *startconc,
+                    size_t            num,
+                    vrna_dimer_conc_t *conc)
+{
+  size_t  i;
+  double  ConcVec[5];
+
+  for (i = 0; i < num; i++) {
+    Newton_Conc(KAB,
+                KAA,
+                KBB,
+                startconc[2 * i],
+                startconc[2 * i + 1],
+                ConcVec);
+    conc[i].Ac_start  = startconc[2 * i];
+    conc[i].Bc_start  = startconc[2 * i + 1];
+    conc[i].ABc       = ConcVec[0];
+    conc[i].AAc       = ConcVec[1];
+    conc[i].BBc       = ConcVec[2];
+    conc[i].Ac        = ConcVec[3];
+    conc[i].Bc        = ConcVec[4];
+  }
+}
+
+
+PRIVATE conc_newton_f *
+newton_conc_function(void)
+{
+#if VRNA_WITH_SIMD_SSE41
+  if (vrna_cpu_simd_capabilities() & VRNA_CPU_SIMD_SSE41)
+    return &vrna_conc_newton_sse41;
+
+#endif
+
+  return &newton_conc_default;
+}
+
+
+PRIVATE void
 Newton_Conc(double  KAB,
             double  KAA,
             double  KBB,
@@ -122,7 +294,6 @@ Newton_Conc(double  KAB,
   cA      = concA;
   cB      = concB;
   TOL     = 1e-6;                                     /* Tolerance for convergence */
-  ConcVec = (double *)vrna_alloc(5 * sizeof(double)); /* holds concentrations */
   do {
     /* det = (4.0 * KAA * cA + KAB *cB + 1.0) * (4.0 * KBB * cB + KAB *cA + 1.0) - (KAB *cB) * (KAB *cA); */
     det = 1 + 16. * KAA * KBB * cA * cB + KAB * (cA + cB) + 4. * KAA * cA + 4. * KBB * cB + 4. *
@@ -154,7 +325,5 @@ Newton_Conc(double  KAB,
   ConcVec[2]  = cB * cB * KBB;  /* BB concentration */
   ConcVec[3]  = cA;             /* A concentration */
   ConcVec[4]  = cB;             /* B concentration */
-
-  return ConcVec;
 }
 
@@ -37,9 +37,27 @@ typedef struct vrna_dimer_conc_s ConcEnt;
 
 #endif
 
+#include <stdio.h>
+
 #include <ViennaRNA/fold_compound.h>
 #include <ViennaRNA/params/basic.h>
 
+/**
+ *  @brief  Option flag for vrna_pf_dimer_concentrations_write() to write comma separated values (CSV)
+ */
+#define VRNA_CONC_OUTPUT_CSV        0U
+
+/**
+ *  @brief  Option flag for vrna_pf_dimer_concentrations_write() to write the raw binary #vrna_dimer_conc_t array
+ */
+#define VRNA_CONC_OUTPUT_BINARY     1U
+
+/**
+ *  @brief  Option flag for vrna_pf_dimer_concentrations_write() to write equilibrium concentrations
+ *          relative to the sum of the two start concentrations (CSV only)
+ */
+#define VRNA_CONC_OUTPUT_RELATIVE   2U
+
 /**
  *  @brief  Data structure for concentration dependency computations
  */
@@ -82,6 +100,61 @@ vrna_dimer_conc_t *vrna_pf_dimer_concentrations(double                  FcAB,
                                                 const vrna_exp_param_t  *exp_params);
 
 
+/**
+ *  @brief Compute the equilibrium concentrations for a batch of start monomer concentrations
+ *
+ *  Similar to vrna_pf_dimer_concentrations() but takes the number of concentration pairs
+ *  in @p startconc explicitly, such that no terminating pair of zeros is required. Since the
+ *  Newton iterations for different pairs of start concentrations are independent, they
+ *  are solved concurrently if RNAlib was compiled with OpenMP support. Within each thread,
+ *  two pairs are solved at once using SSE4.1 instructions if available. This makes it feasible
+ *  to evaluate entire titration series or concentration grids at once.
+ *
+ *  @see vrna_pf_dimer_concentrations(), vrna_pf_dimer_concentrations_write()
+ *
+ *  @param FcAB       Free energy of AB dimer (FcAB entry)
+ *  @param FcAA       Free energy of AA dimer (FcAB entry)
+ *  @param FcBB       Free energy of BB dimer (FcAB entry)
+ *  @param FEA        Free energy of monomer A
+ *  @param FEB        Free energy of monomer B
+ *  @param startconc  List of start concentrations [a0],[b0],[a1],[b1],...,[a(num-1)],[b(num-1)]
+ *  @param num        Number of pairs of start concentrations
+ *  @param exp_params The precomputed Boltzmann factors
+ *  @return vrna_dimer_conc_t array of size @p num containing the equilibrium and start concentrations
+ *          (or @p NULL on error)
+ */
+vrna_dimer_conc_t *vrna_pf_dimer_concentrations_batch(double                  FcAB,
+                                                      double                  FcAA,
+                                                      double                  FcBB,
+                                                      double                  FEA,
+                                                      double                  FEB,
+                                                      const double            *startconc,
+                                                      size_t                  num,
+                                                      const vrna_exp_param_t  *exp_params);
+
+
+/**
+ *  @brief Write a list of equilibrium concentrations to a file
+ *
+ *  Output is either a table of comma separated values (#VRNA_CONC_OUTPUT_CSV) with a single header
+ *  line, or the raw, native-endian, #vrna_dimer_conc_t array (#VRNA_CONC_OUTPUT_BINARY). Output is
+ *  assembled in large blocks before it is written to @p fp.
+ *
+ *  @see vrna_pf_dimer_concentrations_batch(), #VRNA_CONC_OUTPUT_CSV, #VRNA_CONC_OUTPUT_BINARY,
+ *       #VRNA_CONC_OUTPUT_RELATIVE
+ *
+ *  @param fp       The file pointer to write to
+ *  @param conc     The equilibrium concentrations
+ *  @param num      Number of entries in @p conc
+ *  @param options  Output options
+ *  @return         1 on success, 0 on errors
+ */
+int vrna_pf_dimer_concentrations_write(FILE                     *fp,
+                                       const vrna_dimer_conc_t  *conc,
+                                       size_t                   num,
+                                       unsigned int             options);
+
+
 /**
  *  @}
  */
@@ -0,0 +1,127 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ViennaRNA/utils/basic.h"
+#include "ViennaRNA/concentrations.h"
+
+#include <emmintrin.h>
+#include <smmintrin.h>
+
+
+/*
+ *  Newton iterations of vrna_pf_dimer_concentrations_batch() for two pairs
+ *  of start concentrations at once. Each lane performs exactly the same
+ *  operations as Newton_Conc() in concentrations.c, lanes that already
+ *  converged are simply not updated anymore.
+ */
+PUBLIC void
+vrna_conc_newton_sse41(double             KAB,
+                       double             KAA,
+                       double             KBB,
+                       const double       *startconc,
+                       size_t             num,
+                       vrna_dimer_conc_t  *conc)
+{
+  size_t        p, l, lanes;
+  int           i, active;
+  double        A[2], B[2];
+  const __m128d one   = _mm_set1_pd(1.);
+  const __m128d tol   = _mm_set1_pd(1e-6);
+  const __m128d absm  = _mm_castsi128_pd(_mm_set1_epi64x(0x7FFFFFFFFFFFFFFFLL));
+  const __m128d vKAB  = _mm_set1_pd(KAB);
+  const __m128d vKAA  = _mm_set1_pd(KAA);
+  const __m128d vKBB  = _mm_set1_pd(KBB);
+  const __m128d KAA2  = _mm_set1_pd(2.0 * KAA);
+  const __m128d KBB2  = _mm_set1_pd(2.0 * KBB);
+  const __m128d KAA4  = _mm_set1_pd(4. * KAA);
+  const __m128d KBB4  = _mm_set1_pd(4. * KBB);
+  const __m128d KAB4  = _mm_set1_pd(4. * KAB);
+  const __m128d KAABB = _mm_set1_pd(16. * KAA * KBB);
+
+  for (p = 0; p < num; p += 2) {
+    /* duplicate the last pair of start concentrations if num is odd */
+    lanes = MIN2(2, num - p);
+    for (l = 0; l < 2; l++) {
+      A[l]  = startconc[2 * (p + MIN2(l, lanes - 1))];
+      B[l]  = startconc[2 * (p + MIN2(l, lanes - 1)) + 1];
+    }
+
+    __m128d concA = _mm_loadu_pd(A);
+    __m128d concB = _mm_loadu_pd(B);
+    __m128d cA    = concA;
+    __m128d cB    = concB;
+    __m128d todo  = _mm_castsi128_pd(_mm_set1_epi64x(-1));
+
+    for (i = 0; ; ) {
+      __m128d KABcA = _mm_mul_pd(vKAB, cA);
+      __m128d KABcB = _mm_mul_pd(vKAB, cB);
+      __m128d KAAcA = _mm_mul_pd(KAA4, cA);
+      __m128d KBBcB = _mm_mul_pd(KBB4, cB);
+
+      /* det = 1 + 16 KAA KBB cA cB + KAB (cA + cB) + 4 KAA cA + 4 KBB cB + 4 KAB (KBB cB^2 + KAA cA^2) */
+      __m128d det = _mm_add_pd(one, _mm_mul_pd(_mm_mul_pd(KAABB, cA), cB));
+      det = _mm_add_pd(det, _mm_mul_pd(vKAB, _mm_add_pd(cA, cB)));
+      det = _mm_add_pd(det, KAAcA);
+      det = _mm_add_pd(det, KBBcB);
+      det = _mm_add_pd(det,
+                       _mm_mul_pd(KAB4,
+                                  _mm_add_pd(_mm_mul_pd(_mm_mul_pd(vKBB, cB), cB),
+                                             _mm_mul_pd(_mm_mul_pd(vKAA, cA), cA))));
+
+      /* fA = 2 KAA cA^2 + cA - concA, fB = 2 KBB cB^2 + cB - concB */
+      __m128d fA    = _mm_sub_pd(_mm_add_pd(_mm_mul_pd(_mm_mul_pd(KAA2, cA), cA), cA), concA);
+      __m128d fB    = _mm_sub_pd(_mm_add_pd(_mm_mul_pd(_mm_mul_pd(KBB2, cB), cB), cB), concB);
+      __m128d cAB   = _mm_mul_pd(KABcA, cB);
+
+      /* xn = (fB KAB cA - KAB cA cB (4 KBB cB + 1) - fA (4 KBB cB + KAB cA + 1)) / det */
+      __m128d xn = _mm_sub_pd(_mm_mul_pd(fB, KABcA), _mm_mul_pd(cAB, _mm_add_pd(KBBcB, one)));
+      xn = _mm_sub_pd(xn, _mm_mul_pd(fA, _mm_add_pd(_mm_add_pd(KBBcB, KABcA), one)));
+      xn = _mm_div_pd(xn, det);
+
+      /* yn = (fA KAB cB - KAB cA cB (4 KAA cA + 1) - fB (4 KAA cA + KAB cB + 1)) / det */
+      __m128d yn = _mm_sub_pd(_mm_mul_pd(fA, KABcB), _mm_mul_pd(cAB, _mm_add_pd(KAAcA, one)));
+      yn = _mm_sub_pd(yn, _mm_mul_pd(fB, _mm_add_pd(_mm_add_pd(KAAcA, KABcB), one)));
+      yn = _mm_div_pd(yn, det);
+
+      __m128d eps = _mm_add_pd(_mm_and_pd(_mm_div_pd(xn, cA), absm),
+                               _mm_and_pd(_mm_div_pd(yn, cB), absm));
+
+      /* only lanes that did not converge yet are updated */
+      cA  = _mm_blendv_pd(cA, _mm_add_pd(cA, xn), todo);
+      cB  = _mm_blendv_pd(cB, _mm_add_pd(cB, yn), todo);
+      i++;
+
+      if (i > 10000) {
+        active = _mm_movemask_pd(todo);
+        for (l = 0; l < lanes; l++)
+          if (active & (1 << l))
+            vrna_message_warning("Newton did not converge after %d steps!!", i);
+
+        break;
+      }
+
+      /* comparisons with NaN are false, so such lanes stop, too */
+      todo = _mm_and_pd(todo, _mm_cmpgt_pd(eps, tol));
+
+      if (_mm_movemask_pd(todo) == 0)
+        break;
+    }
+
+    _mm_storeu_pd(A, cA);
+    _mm_storeu_pd(B, cB);
+
+    for (l = 0; l < lanes; l++) {
+      conc[p + l].Ac_start  = startconc[2 * (p + l)];
+      conc[p + l].Bc_start  = startconc[2 * (p + l) + 1];
+      conc[p + l].ABc       = A[l] * B[l] * KAB;
+      conc[p + l].AAc       = A[l] * A[l] * KAA;
+      conc[p + l].BBc       = B[l] * B[l] * KBB;
+      conc[p + l].Ac        = A[l];
+      conc[p + l].Bc        = B[l];
+    }
+  }
+}
@@ -15,6 +15,9 @@
 #include "ViennaRNA/params/default.h"
 #include "ViennaRNA/params/constants.h" /* defines MINPSCORE */
 #include "ViennaRNA/fold_vars.h"
+#include "ViennaRNA/model.h"
+#include "ViennaRNA/mfe.h"
+#include "ViennaRNA/part_func.h"
 #include "ViennaRNA/utils/basic.h"
 #include "ViennaRNA/utils/strings.h"
 #include "ViennaRNA/utils/alignments.h"
@@ -24,6 +27,10 @@
 #include "ViennaRNA/constraints/soft.h"
 #include "ViennaRNA/constraints/SHAPE.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 /*
  #################################
  # GLOBAL VARIABLES              #
@@ -53,6 +60,18 @@ PRIVATE void
 prepare_Boltzmann_weights_stack(vrna_fold_compound_t *vc);
 
 
+PRIVATE void
+batch_fold_profile(vrna_fold_compound_t   *fc,
+                   vrna_sc_SHAPE_batch_t  *batch,
+                   unsigned int           k,
+                   const double           *reactivities,
+                   char                   method,
+                   double                 p1,
+                   double                 p2,
+                   const char             *shape_conversion,
+                   unsigned int           options);
+
+
 /*
  #################################
  # BEGIN OF FUNCTION DEFINITIONS #
@@ -514,6 +533,110 @@ vrna_sc_add_SHAPE_deigan_ali(vrna_fold_compound_t *vc,
 }
 
 
+PUBLIC vrna_sc_SHAPE_batch_t *
+vrna_sc_SHAPE_batch(const char    *sequence,
+                    vrna_md_t     *md_p,
+                    const double  **reactivities,
+                    const double  *params,
+                    unsigned int  num_profiles,
+                    char          method,
+                    const char    *shape_conversion,
+                    unsigned int  options)
+{
+  unsigned int          k, n, fc_options;
+  float                 p1, p2;
+  vrna_md_t             md;
+  vrna_sc_SHAPE_batch_t *batch;
+
+  if ((!sequence) || (!reactivities) || (num_profiles == 0))
+    return NULL;
+
+  if ((method != 'D') && (method != 'Z')) {
+    vrna_message_warning("vrna_sc_SHAPE_batch: "
+                         "SHAPE method %c not implemented for batch processing!",
+                         method);
+    return NULL;
+  }
+
+  for (k = 0; k < num_profiles; k++)
+    if (!reactivities[k])
+      return NULL;
+
+  /* default conversion parameters */
+  p1  = method == 'D' ? 1.8 : 0.89;
+  p2  = method == 'D' ? -0.6 : 0.5;
+
+  if (md_p)
+    vrna_md_copy(&md, md_p);
+  else
+    vrna_md_set_default(&md);
+
+  fc_options = VRNA_OPTION_MFE;
+
+  if (options & VRNA_OPTION_PF) {
+    fc_options      |= VRNA_OPTION_PF;
+    md.uniq_ML      = 1;
+    md.compute_bpp  = 1;
+  }
+
+  n = (unsigned int)strlen(sequence);
+
+  batch             = (vrna_sc_SHAPE_batch_t *)vrna_alloc(sizeof(vrna_sc_SHAPE_batch_t));
+  batch->profiles   = num_profiles;
+  batch->length     = n;
+  batch->mfe        = (float *)vrna_alloc(sizeof(float) * num_profiles);
+  batch->ens_en     = NULL;
+  batch->p_unpaired = NULL;
+
+  if (options & VRNA_OPTION_PF) {
+    batch->ens_en     = (float *)vrna_alloc(sizeof(float) * num_profiles);
+    batch->p_unpaired = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * num_profiles * (n + 1));
+  }
+
+  /*
+   *  Each thread prepares its own fold compound, i.e. sequence encoding,
+   *  energy parameters and hard constraints, only once and re-uses it for all
+   *  profiles it processes. Only the soft constraints are exchanged in between.
+   */
+#ifdef _OPENMP
+#pragma omp parallel private(k)
+#endif
+  {
+    vrna_fold_compound_t *fc = vrna_fold_compound(sequence, &md, fc_options);
+
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic, 1)
+#endif
+    for (k = 0; k < num_profiles; k++)
+      batch_fold_profile(fc,
+                         batch,
+                         k,
+                         reactivities[k],
+                         method,
+                         params ? params[2 * k] : p1,
+                         params ? params[2 * k + 1] : p2,
+                         shape_conversion,
+                         options);
+
+    vrna_fold_compound_free(fc);
+  }
+
+  return batch;
+}
+
+
+PUBLIC void
+vrna_sc_SHAPE_batch_free(vrna_sc_SHAPE_batch_t *batch)
+{
+  if (batch) {
+    free(batch->mfe);
+    free(batch->ens_en);
+    free(batch->p_unpaired);
+    free(batch);
+  }
+}
+
+
 PUBLIC int
 vrna_sc_SHAPE_parse_method(const char *method_string,
                            char       *method,
@@ -652,3 +775,65 @@ prepare_Boltzmann_weights_stack(vrna_fold_compound_t *fc)
       break;
   }
 }
+
+
+PRIVATE void
+batch_fold_profile(vrna_fold_compound_t   *fc,
+                   vrna_sc_SHAPE_batch_t  *batch,
+                   unsigned int           k,
+                   const double           *reactivities,
+                   char                   method,
+                   double                 p1,
+                   double                 p2,
+                   const char             *shape_conversion,
+                   unsigned int           options)
+{
+  unsigned int  constraint_type;
+  int           i, j, n, *iidx;
+  double        mfe;
+  FLT_OR_DBL    *probs, *p_u;
+
+  n               = (int)fc->length;
+  constraint_type = VRNA_OPTION_MFE;
+  if (options & VRNA_OPTION_PF)
+    constraint_type |= VRNA_OPTION_PF;
+
+  /* exchange soft constraints of the previous profile */
+  vrna_sc_remove(fc);
+
+  if (method == 'D')
+    (void)vrna_sc_add_SHAPE_deigan(fc, reactivities, p1, p2, constraint_type);
+  else
+    (void)vrna_sc_add_SHAPE_zarringhalam(fc,
+                                         reactivities,
+                                         p1,
+                                         p2,
+                                         shape_conversion ? shape_conversion : "O",
+                                         constraint_type);
+
+  mfe             = (double)vrna_mfe(fc, NULL);
+  batch->mfe[k]   = (float)mfe;
+
+  if (options & VRNA_OPTION_PF) {
+    vrna_exp_params_rescale(fc, &mfe);
+    batch->ens_en[k] = vrna_pf(fc, NULL);
+
+    /* p_u(i) = 1 - sum_j p(i,j) */
+    p_u   = batch->p_unpaired + (size_t)k * (n + 1);
+    probs = fc->exp_matrices->probs;
+    iidx  = fc->iindx;
+
+    for (i = 1; i <= n; i++)
+      p_u[i] = 1.;
+
+    for (i = 1; i < n; i++)
+      for (j = i + 1; j <= n; j++) {
+        p_u[i]  -= probs[iidx[i] - j];
+        p_u[j]  -= probs[iidx[i] - j];
+      }
+
+    for (i = 1; i <= n; i++)
+      if (p_u[i] < 0.)
+        p_u[i] = 0.;
+  }
+}
@@ -20,6 +20,30 @@
  *  secondary structure prediction can be found in @cite lorenz:2016a
  *
  */
+/**
+ *  @brief  A compact container for the results of batched SHAPE directed folding
+ *
+ *  @ingroup SHAPE_reactivities
+ *  @see    vrna_sc_SHAPE_batch(), vrna_sc_SHAPE_batch_free()
+ */
+typedef struct vrna_sc_SHAPE_batch_s vrna_sc_SHAPE_batch_t;
+
+/**
+ *  @brief  Results of batched SHAPE directed folding
+ *
+ *  @ingroup SHAPE_reactivities
+ */
+struct vrna_sc_SHAPE_batch_s {
+  unsigned int  profiles;     /**<  @brief  Number of reactivity profiles (K) */
+  unsigned int  length;       /**<  @brief  Length of the sequence (n) */
+  float         *mfe;         /**<  @brief  MFE of each profile in kcal/mol (K entries) */
+  float         *ens_en;      /**<  @brief  Ensemble free energy of each profile in kcal/mol (K entries, NULL if not requested) */
+  FLT_OR_DBL    *p_unpaired;  /**<  @brief  Probabilities to be unpaired, row-wise per profile @f$ k @f$
+                               *            and 1-based, i.e. position @f$ i @f$ is stored at
+                               *            <tt>p_unpaired[k * (length + 1) + i]</tt> (NULL if not requested)
+                               */
+};
+
 void vrna_constraints_add_SHAPE(vrna_fold_compound_t *vc,
                                 const char *shape_file,
                                 const char *shape_method,
@@ -148,4 +172,56 @@ int vrna_sc_SHAPE_to_pr(const char *shape_conversion,
                         int length,
                         double default_value);
 
+/**
+ *  @brief  Fold a single sequence under a batch of SHAPE reactivity profiles
+ *
+ *  This function computes the MFE and, if @p options contains #VRNA_OPTION_PF, the
+ *  ensemble free energy and the probabilities to be unpaired of @p sequence for each
+ *  of the @p num_profiles reactivity profiles in @p reactivities. Each profile is converted
+ *  into soft constraints using @p method, where @p method is either @p 'D' (see
+ *  vrna_sc_add_SHAPE_deigan()) or @p 'Z' (see vrna_sc_add_SHAPE_zarringhalam()).
+ *  The conversion parameters are taken pair-wise from @p params, i.e. @f$ (m, b) @f$ for
+ *  method @p 'D', and @f$ (\beta, p_{default}) @f$ for method @p 'Z', where @f$ p_{default} @f$
+ *  is the probability used for nucleotides with missing reactivity data (see the @p default_value
+ *  argument of vrna_sc_add_SHAPE_zarringhalam()). If @p params is @p NULL, the default parameters
+ *  of vrna_sc_SHAPE_parse_method() are used for all profiles, with @f$ p_{default} = 0.5 @f$.
+ *  To scan a grid of conversion parameters for a single profile, simply pass the same
+ *  reactivity vector multiple times.
+ *
+ *  The sequence encoding, energy parameters, and hard constraints are prepared only once per
+ *  thread and re-used for all profiles processed by that thread. If RNAlib was compiled with
+ *  OpenMP support, the profiles are processed concurrently.
+ *
+ *  @ingroup SHAPE_reactivities
+ *  @see    vrna_sc_SHAPE_batch_free(), vrna_sc_add_SHAPE_deigan(), vrna_sc_add_SHAPE_zarringhalam()
+ *  @param  sequence          The RNA sequence
+ *  @param  md                The model details to use (Maybe NULL)
+ *  @param  reactivities      An array of @p num_profiles (1-based) vectors of normalized SHAPE reactivities
+ *  @param  params            An array of @f$ 2 \cdot @f$ @p num_profiles conversion parameters (Maybe NULL)
+ *  @param  num_profiles      The number of reactivity profiles
+ *  @param  method            The conversion method, either @p 'D' or @p 'Z'
+ *  @param  shape_conversion  The reactivity to probability conversion for method @p 'Z' (Maybe NULL)
+ *  @param  options           Options, i.e. #VRNA_OPTION_MFE and/or #VRNA_OPTION_PF
+ *  @return                   The per-profile results, or @p NULL on errors
+ */
+vrna_sc_SHAPE_batch_t *
+vrna_sc_SHAPE_batch(const char    *sequence,
+                    vrna_md_t     *md,
+                    const double  **reactivities,
+                    const double  *params,
+                    unsigned int  num_profiles,
+                    char          method,
+                    const char    *shape_conversion,
+                    unsigned int  options);
+
+
+/**
+ *  @brief  Free memory occupied by the results of vrna_sc_SHAPE_batch()
+ *
+ *  @ingroup SHAPE_reactivities
+ *  @param  batch The results of a vrna_sc_SHAPE_batch() call
+ */
+void
+vrna_sc_SHAPE_batch_free(vrna_sc_SHAPE_batch_t *batch);
+
 #endif
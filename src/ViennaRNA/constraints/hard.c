@@ -130,6 +130,37 @@ hc_update_up_window(vrna_fold_compound_t  *vc,
                     int                   i);
 
 
+PRIVATE void
+hc_update_up_local(vrna_fold_compound_t *vc,
+                   unsigned int         i);
+
+
+PRIVATE INLINE void
+hc_update_up_context(int            *up,
+                     unsigned char  *mx,
+                     unsigned int   n,
+                     unsigned int   i,
+                     unsigned char  context,
+                     int            circ);
+
+
+PRIVATE INLINE void
+hc_update_up_wrap(int           *up,
+                  unsigned char *mx,
+                  unsigned int  n,
+                  unsigned char context);
+
+
+PRIVATE INLINE int
+hc_is_circular(vrna_fold_compound_t *vc);
+
+
+PRIVATE INLINE void
+hc_mark_dirty(vrna_hc_t     *hc,
+              unsigned int  i,
+              unsigned int  j);
+
+
 /*
  #################################
  # BEGIN OF FUNCTION DEFINITIONS #
@@ -201,6 +232,10 @@ vrna_hc_init(vrna_fold_compound_t *vc)
   hc->data      = NULL;
   hc->free_data = NULL;
 
+  /* nothing has been computed with these constraints yet */
+  hc->dirty_start = 1;
+  hc->dirty_end   = n;
+
   /* update */
   hc_update_up(vc);
 }
@@ -236,6 +271,9 @@ vrna_hc_init_window(vrna_fold_compound_t *vc)
   hc->f         = NULL;
   hc->data      = NULL;
   hc->free_data = NULL;
+
+  hc->dirty_start = 1;
+  hc->dirty_end   = n;
 }
 
 
@@ -287,8 +325,10 @@ vrna_hc_add_up(vrna_fold_compound_t *vc,
 
       hc_add_up(vc, i, option);
 
-      if (vc->hc->type != VRNA_HC_WINDOW)
-        hc_update_up(vc);
+      if (vc->hc->type != VRNA_HC_WINDOW) {
+        hc_update_up_local(vc, i);
+        hc_mark_dirty(vc->hc, i, i);
+      }
     }
   }
 }
@@ -314,10 +354,12 @@ vrna_hc_add_up_batch(vrna_fold_compound_t *vc,
         }
 
         hc_add_up(vc, pos, options);
-      }
 
-      if (vc->hc->type != VRNA_HC_WINDOW)
-        hc_update_up(vc);
+        if (vc->hc->type != VRNA_HC_WINDOW) {
+          hc_update_up_local(vc, pos);
+          hc_mark_dirty(vc->hc, pos, pos);
+        }
+      }
 
       ret = 1; /* success */
     }
@@ -395,7 +437,8 @@ vrna_hc_add_bp_nonspecific(vrna_fold_compound_t *vc,
           hc->mx[n * i + i]             = VRNA_CONSTRAINT_CONTEXT_NONE;
         }
 
-        hc_update_up(vc);
+        hc_update_up_local(vc, i);
+        hc_mark_dirty(hc, i, i);
       }
     }
   }
@@ -529,8 +572,11 @@ vrna_hc_add_bp(vrna_fold_compound_t *vc,
           hc->mx[n * i + i] = VRNA_CONSTRAINT_CONTEXT_NONE;
           hc->mx[n * j + j] = VRNA_CONSTRAINT_CONTEXT_NONE;
 
-          hc_update_up(vc);
+          hc_update_up_local(vc, j);
+          hc_update_up_local(vc, i);
         }
+
+        hc_mark_dirty(hc, i, j);
       }
     }
   }
@@ -578,6 +624,7 @@ vrna_hc_add_f(vrna_fold_compound_t      *vc,
         vrna_hc_init(vc);
 
       vc->hc->f = f;
+      hc_mark_dirty(vc->hc, 1, vc->length);
     }
   }
 }
@@ -595,6 +642,7 @@ vrna_hc_add_data(vrna_fold_compound_t       *vc,
 
       vc->hc->data      = data;
       vc->hc->free_data = f;
+      hc_mark_dirty(vc->hc, 1, vc->length);
     }
   }
 }
@@ -1416,6 +1464,8 @@ hc_reset_to_default(vrna_fold_compound_t *vc)
     }
   }
 
+  hc_mark_dirty(hc, 1, n);
+
   /* should we reset the generalized hard constraint feature here? */
   if (hc->f || hc->data) {
     if (hc->free_data)
@@ -1481,45 +1531,11 @@ hc_update_up(vrna_fold_compound_t *vc)
      *  loop arround once more until we find a nucleotide that mustn't
      *  be unpaired (needed for circular folding)
      */
-
-    if (hc->mx[n + 1] & VRNA_CONSTRAINT_CONTEXT_EXT_LOOP) {
-      hc->up_ext[n + 1] = hc->up_ext[1];
-      for (i = n; i > 0; i--) {
-        if (hc->mx[n * i + i] & VRNA_CONSTRAINT_CONTEXT_EXT_LOOP)
-          hc->up_ext[i] = MIN2(n, 1 + hc->up_ext[i + 1]);
-        else
-          break;
-      }
-    }
-
-    if (hc->mx[n + 1] & VRNA_CONSTRAINT_CONTEXT_HP_LOOP) {
-      hc->up_hp[n + 1] = hc->up_hp[1];
-      for (i = n; i > 0; i--) {
-        if (hc->mx[n * i + i] & VRNA_CONSTRAINT_CONTEXT_HP_LOOP)
-          hc->up_hp[i] = MIN2(n, 1 + hc->up_hp[i + 1]);
-        else
-          break;
-      }
-    }
-
-    if (hc->mx[n + 1] & VRNA_CONSTRAINT_CONTEXT_INT_LOOP) {
-      hc->up_int[n + 1] = hc->up_int[1];
-      for (i = n; i > 0; i--) {
-        if (hc->mx[n * i + i] & VRNA_CONSTRAINT_CONTEXT_INT_LOOP)
-          hc->up_int[i] = MIN2(n, 1 + hc->up_int[i + 1]);
-        else
-          break;
-      }
-    }
-
-    if (hc->mx[n + 1] & VRNA_CONSTRAINT_CONTEXT_MB_LOOP) {
-      hc->up_ml[n + 1] = hc->up_ml[1];
-      for (i = n; i > 0; i--) {
-        if (hc->mx[n * i + i] & VRNA_CONSTRAINT_CONTEXT_MB_LOOP)
-          hc->up_ml[i] = MIN2(n, 1 + hc->up_ml[i + 1]);
-        else
-          break;
-      }
+    if (hc_is_circular(vc)) {
+      hc_update_up_wrap(hc->up_ext, hc->mx, n, VRNA_CONSTRAINT_CONTEXT_EXT_LOOP);
+      hc_update_up_wrap(hc->up_hp, hc->mx, n, VRNA_CONSTRAINT_CONTEXT_HP_LOOP);
+      hc_update_up_wrap(hc->up_int, hc->mx, n, VRNA_CONSTRAINT_CONTEXT_INT_LOOP);
+      hc_update_up_wrap(hc->up_ml, hc->mx, n, VRNA_CONSTRAINT_CONTEXT_MB_LOOP);
     }
   }
 }
@@ -1548,6 +1564,129 @@ hc_update_up_window(vrna_fold_compound_t  *vc,
 }
 
 
+/*
+ *  Update the unpaired stretch arrays after the constraint for nucleotide i
+ *  changed. In contrast to hc_update_up(), this only touches the part of
+ *  the stretch ending in i that actually changes, and the wrap-around tail
+ *  of circular RNAs if i belongs to the first or the last stretch
+ */
+PRIVATE void
+hc_update_up_local(vrna_fold_compound_t *vc,
+                   unsigned int         i)
+{
+  int           circ;
+  unsigned int  n;
+  vrna_hc_t     *hc;
+
+  n     = vc->length;
+  hc    = vc->hc;
+  circ  = hc_is_circular(vc);
+
+  hc_update_up_context(hc->up_ext, hc->mx, n, i, VRNA_CONSTRAINT_CONTEXT_EXT_LOOP, circ);
+  hc_update_up_context(hc->up_hp, hc->mx, n, i, VRNA_CONSTRAINT_CONTEXT_HP_LOOP, circ);
+  hc_update_up_context(hc->up_int, hc->mx, n, i, VRNA_CONSTRAINT_CONTEXT_INT_LOOP, circ);
+  hc_update_up_context(hc->up_ml, hc->mx, n, i, VRNA_CONSTRAINT_CONTEXT_MB_LOOP, circ);
+}
+
+
+PRIVATE INLINE void
+hc_update_up_context(int            *up,
+                     unsigned char  *mx,
+                     unsigned int   n,
+                     unsigned int   i,
+                     unsigned char  context,
+                     int            circ)
+{
+  int           u;
+  unsigned int  k;
+
+  /* nothing to do if nucleotide i may still (not) be unpaired in this context */
+  if (((mx[n * i + i] & context) != 0) == (up[i] > 0))
+    return;
+
+  /*
+   *  1. the wrap-around only depends on the first and the last stretch,
+   *  i.e. it requires an update only if all nucleotides upstream, or all
+   *  nucleotides downstream of i may be unpaired. In that case, undo the
+   *  wrap-around of the trailing stretch, recognized by up[n + 1] != 0
+   */
+  if (circ)
+    circ = ((up[1] >= (int)i - 1) || (up[i + 1] >= (int)(n - i)));
+
+  if ((circ) && (up[n + 1] != 0)) {
+    up[n + 1] = 0;
+    for (k = n; (k > 0) && (mx[n * k + k] & context); k--)
+      up[k] = 1 + up[k + 1];
+  }
+
+  /*
+   *  2. re-compute the stretch that ends in i. As soon as an entry upstream
+   *  of i remains unchanged, all entries further upstream remain unchanged
+   */
+  for (k = i; k > 0; k--) {
+    u = (mx[n * k + k] & context) ? 1 + up[k + 1] : 0;
+    if ((k < i) && (up[k] == u))
+      break;
+
+    up[k] = u;
+  }
+
+  /* 3. loop arround once more, same as in hc_update_up() */
+  if (circ)
+    hc_update_up_wrap(up, mx, n, context);
+}
+
+
+/*
+ *  Continue the trailing unpaired stretch at the 5' end of a circular RNA
+ *  until we find a nucleotide that mustn't be unpaired
+ */
+PRIVATE INLINE void
+hc_update_up_wrap(int           *up,
+                  unsigned char *mx,
+                  unsigned int  n,
+                  unsigned char context)
+{
+  unsigned int k;
+
+  if (mx[n + 1] & context) {
+    up[n + 1] = up[1];
+    for (k = n; k > 0; k--) {
+      if (mx[n * k + k] & context)
+        up[k] = MIN2(n, 1 + up[k + 1]);
+      else
+        break;
+    }
+  }
+}
+
+
+PRIVATE INLINE int
+hc_is_circular(vrna_fold_compound_t *vc)
+{
+  if (vc->params)
+    return vc->params->model_details.circ;
+
+  if (vc->exp_params)
+    return vc->exp_params->model_details.circ;
+
+  return 0;
+}
+
+
+PRIVATE INLINE void
+hc_mark_dirty(vrna_hc_t     *hc,
+              unsigned int  i,
+              unsigned int  j)
+{
+  if (i < hc->dirty_start)
+    hc->dirty_start = i;
+
+  if (j > hc->dirty_end)
+    hc->dirty_end = j;
+}
+
+
 #ifndef VRNA_DISABLE_BACKWARD_COMPATIBILITY
 
 /*###########################################*/
@@ -406,7 +406,21 @@ struct vrna_hc_s {
                                            *            unpaired nucleotides in a multi branched loop
                                            */
 
-  vrna_callback_hc_evaluate   *f;         /**<  @brief  A function pointer that returns whether or
+  unsigned int                dirty_start;  /**<  @brief  First nucleotide affected by constraints
+                                             *            added since the last MFE prediction
+                                             */
+  unsigned int                dirty_end;    /**<  @brief  Last nucleotide affected by constraints
+                                             *            added since the last MFE prediction
+                                             *
+                                             *    Together with vrna_hc_s.dirty_start, this spans
+                                             *    the only sequence interval where DP matrix entries
+                                             *    may have changed. It is used by vrna_mfe_update()
+                                             *    to re-use all entries of sub-sequences outside this
+                                             *    interval. An empty interval is indicated by
+                                             *    @p dirty_start > @p dirty_end.
+                                             */
+
+  vrna_callback_hc_evaluate   *f;        /**<  @brief  A function pointer that returns whether or
                                            *            not a certain decomposition may be evaluated
                                            */
 
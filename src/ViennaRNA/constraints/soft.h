@@ -20,6 +20,13 @@
  *  in the recursions by adding bonuses/penalties in form of pseudo free energies
  *  to certain loop configurations.
  *
+ *  As long as no generic callback is attached via vrna_sc_add_f() or
+ *  vrna_sc_add_exp_f(), pre-computed unpaired, base pair, and stacking
+ *  contributions are evaluated inline ('compiled' mode). Currently, this
+ *  applies to interior loops only; hairpin, exterior, and multibranch loops
+ *  still retrieve their soft constraint contributions through the generic
+ *  wrapper callbacks.
+ *
  */
 
 
@@ -1,8 +1,45 @@
 /*             Global variables for Distance-Package */
 
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+
+#include "ViennaRNA/utils/basic.h"
+#include "ViennaRNA/dist_vars.h"
+
 int  edit_backtrack = 0;  /* calculate aligned representation */
 
 char *aligned_line[4];    /* containes the aligned string representations */
 
 int  cost_matrix = 0;     /* 0 for usual costs, 1 for Shapiro's costs */
 
+
+PUBLIC vrna_dist_ws_t *
+vrna_dist_ws_init(void)
+{
+  return (vrna_dist_ws_t *)vrna_alloc(sizeof(vrna_dist_ws_t));
+}
+
+
+PUBLIC void
+vrna_dist_ws_free(vrna_dist_ws_t *ws)
+{
+  if (ws) {
+    free(ws->aligned_line[0]);
+    free(ws->aligned_line[1]);
+    free(ws->aligned_line[2]);
+    free(ws->aligned_line[3]);
+    free(ws->tdist);
+    free(ws->fdist);
+    free(ws->sdist);
+    free(ws->i_point);
+    free(ws->j_point);
+    free(ws->alignment[0]);
+    free(ws->alignment[1]);
+    free(ws->pmat);
+    free(ws->prow);
+    free(ws);
+  }
+}
@@ -1,6 +1,8 @@
 #ifndef VIENNA_RNA_PACKAGE_DIST_VARS_H
 #define VIENNA_RNA_PACKAGE_DIST_VARS_H
 
+#include <stddef.h>
+
 /**
  *  @file dist_vars.h
  *  @brief Global variables for Distance-Package
@@ -57,4 +59,76 @@ typedef struct {
                  int    sign;
                  float  weight;
                } swString;
+
+/**
+ *  @brief  Option flag for tree and string edit distances to use the default costs
+ *  @see    vrna_tree_edit_distance(), vrna_string_edit_distance(), #VRNA_DIST_SHAPIRO_COSTS
+ */
+#define VRNA_DIST_DEFAULT         0U
+
+/**
+ *  @brief  Option flag for tree and string edit distances to use Shapiro's costs
+ *  @see    vrna_tree_edit_distance(), vrna_string_edit_distance(), #cost_matrix
+ */
+#define VRNA_DIST_SHAPIRO_COSTS   1U
+
+/**
+ *  @brief  Option flag for tree and string edit distances to produce an alignment of the two structures
+ *  @see    vrna_tree_edit_distance(), vrna_string_edit_distance(), #edit_backtrack
+ */
+#define VRNA_DIST_BACKTRACK       2U
+
+/**
+ *  @brief  Workspace for tree, string, and profile edit distances
+ *
+ *  A workspace keeps the dynamic programming matrices of vrna_tree_edit_distance(),
+ *  vrna_string_edit_distance(), vrna_profile_edit_distance(), and vrna_profile_aln()
+ *  between subsequent calls, such that memory is only re-allocated if larger structures
+ *  are compared. Each thread requires its own workspace.
+ *
+ *  @see vrna_dist_ws_init(), vrna_dist_ws_free()
+ */
+typedef struct {
+  char    *aligned_line[4];   /**<  @brief  The aligned structures after a call with #VRNA_DIST_BACKTRACK,
+                               *            followed by the aligned sequences for vrna_profile_aln() */
+
+  /* private buffers, re-used between calls */
+  int     *tdist;             /* distances between subtrees */
+  int     *fdist;             /* distances between forests */
+  size_t  tree_size;
+  float   *sdist;             /* distances between string prefixes */
+  size_t  string_size;
+  short   *i_point;           /* backtracking pointers of string alignments */
+  short   *j_point;
+  size_t  point_size;
+  int     *alignment[2];      /* aligned positions */
+  size_t  alignment_size;
+  float   *pmat;              /* profile alignment matrices */
+  size_t  pmat_size;
+  float   *prow;              /* square root profiles and scores of a row */
+  size_t  prow_size;
+} vrna_dist_ws_t;
+
+
+/**
+ *  @brief  Create a workspace for tree, string, and profile edit distances
+ *
+ *  @see vrna_dist_ws_free(), vrna_tree_edit_distance(), vrna_string_edit_distance(),
+ *  vrna_profile_edit_distance(), vrna_profile_aln()
+ *
+ *  @return An empty workspace
+ */
+vrna_dist_ws_t *vrna_dist_ws_init(void);
+
+
+/**
+ *  @brief  Free a workspace for tree, string, and profile edit distances
+ *
+ *  @see vrna_dist_ws_init()
+ *
+ *  @param  ws  The workspace
+ */
+void vrna_dist_ws_free(vrna_dist_ws_t *ws);
+
+
 #endif
@@ -267,6 +267,13 @@ vrna_mx_mfe_add(vrna_fold_compound_t  *vc,
                                           mx_type,
                                           options);
     vrna_mx_mfe_free(vc);
+
+    /* freshly allocated matrices do not hold anything worth re-using */
+    if (vc->hc) {
+      vc->hc->dirty_start = 1;
+      vc->hc->dirty_end   = vc->length;
+    }
+
     return add_mfe_matrices(vc, mx_type, mx_alloc_vector);
   }
 
@@ -40,12 +40,33 @@ typedef struct move {
  *  @brief
  */
 typedef struct intermediate {
-  short   *pt;      /**<  @brief  pair table */
-  int     Sen;      /**<  @brief  saddle energy so far */
-  int     curr_en;  /**<  @brief  current energy */
-  move_t  *moves;   /**<  @brief  remaining moves to target */
+  short         *pt;      /**<  @brief  pair table */
+  int           Sen;      /**<  @brief  saddle energy so far */
+  int           curr_en;  /**<  @brief  current energy */
+  move_t        *moves;   /**<  @brief  remaining moves to target */
+  unsigned int  hash;     /**<  @brief  hash value of the pair table */
 } intermediate_t;
 
+
+/**
+ *  @brief  The state of a single findpath search
+ *
+ *  Everything a search modifies lives in here rather than in file-scope
+ *  variables, such that any number of searches may run concurrently
+ */
+typedef struct {
+  int     BP_dist;  /**<  @brief  base pair distance between the two structures */
+  move_t  *path;    /**<  @brief  moves of the best path found so far */
+  int     path_fwd; /**<  @brief  1: s1->s2, else s2 -> s1 */
+} findpath_ctx_t;
+
+
+/*
+ *  Expand the beam in parallel only if there are at least that many
+ *  candidate moves, otherwise, thread start-up dominates
+ */
+#define FINDPATH_PARALLEL_MIN_MOVES 512
+
 /*
  #################################
  # GLOBAL VARIABLES              #
@@ -57,17 +78,13 @@ typedef struct intermediate {
  # PRIVATE VARIABLES             #
  #################################
  */
-PRIVATE int                   BP_dist;
-PRIVATE move_t                *path = NULL;
-PRIVATE int                   path_fwd; /* 1: s1->s2, else s2 -> s1 */
-
 PRIVATE vrna_fold_compound_t  *backward_compat_compound = NULL;
 
 #ifdef _OPENMP
 
 /* NOTE: all variables are assumed to be uninitialized if they are declared as threadprivate
  */
-#pragma omp threadprivate(BP_dist, path, path_fwd, backward_compat_compound)
+#pragma omp threadprivate(backward_compat_compound)
 
 #endif
 
@@ -76,13 +93,29 @@ PRIVATE vrna_fold_compound_t  *backward_compat_compound = NULL;
  # PRIVATE FUNCTION DECLARATIONS #
  #################################
  */
+PRIVATE vrna_fold_compound_t *
+get_backward_compat_compound(const char *seq);
+
+
 PRIVATE move_t *
-copy_moves(move_t *mvs);
+copy_moves(move_t *mvs,
+           int    bp_dist);
+
+
+PRIVATE unsigned int
+hash_pair(int i,
+          int j);
+
+
+PRIVATE unsigned int
+hash_ptable(const short *pt);
 
 
 PRIVATE int
-compare_ptable(const void *A,
-               const void *B);
+remove_duplicates(intermediate_t  *next,
+                  int             num_next,
+                  int             *index,
+                  unsigned int    index_size);
 
 
 PRIVATE int
@@ -109,15 +142,34 @@ usage(void);
 #endif
 
 PRIVATE int
-find_path_once(vrna_fold_compound_t *vc,
-               const char           *s1,
-               const char           *s2,
+saddle_energy(vrna_fold_compound_t  *vc,
+              const short           *pt1,
+              const short           *pt2,
+              int                   width,
+              int                   maxE);
+
+
+PRIVATE int
+findpath_saddle(findpath_ctx_t        *ctx,
+                vrna_fold_compound_t  *vc,
+                const short           *pt1,
+                const short           *pt2,
+                int                   width,
+                int                   maxE);
+
+
+PRIVATE int
+find_path_once(findpath_ctx_t       *ctx,
+               vrna_fold_compound_t *vc,
+               const short          *pt_start,
+               const short          *pt_target,
                int                  maxl,
                int                  maxE);
 
 
 PRIVATE int
-try_moves(vrna_fold_compound_t  *vc,
+try_moves(findpath_ctx_t        *ctx,
+          vrna_fold_compound_t  *vc,
           intermediate_t        c,
           int                   maxE,
           intermediate_t        *next,
@@ -150,38 +202,11 @@ find_saddle(const char  *seq,
             const char  *s2,
             int         width)
 {
-  int                   maxE;
-  char                  *sequence;
-  vrna_fold_compound_t  *vc;
-  vrna_md_t             md, *md_p;
+  vrna_fold_compound_t *vc;
 
-  vc = NULL;
-  set_model_details(&md);
+  vc = get_backward_compat_compound(seq);
 
-  if (backward_compat_compound) {
-    if (!strcmp(seq, backward_compat_compound->sequence)) {
-      /* check if sequence is the same as before */
-      md.window_size  = backward_compat_compound->length;
-      md.max_bp_span  = backward_compat_compound->length;
-      md_p            = &(backward_compat_compound->params->model_details);
-      if (!memcmp(&md, md_p, sizeof(vrna_md_t)))  /* check if model_details are the same as before */
-        vc = backward_compat_compound;            /* re-use previous vrna_fold_compound_t */
-    }
-  }
-
-  if (!vc) {
-    vrna_fold_compound_free(backward_compat_compound);
-
-    sequence = vrna_cut_point_insert(seq, cut_point);
-
-    backward_compat_compound = vc = vrna_fold_compound(sequence, &md, VRNA_OPTION_EVAL_ONLY);
-
-    free(sequence);
-  }
-
-  maxE = vrna_path_findpath_saddle(vc, s1, s2, width);
-
-  return maxE;
+  return vrna_path_findpath_saddle(vc, s1, s2, width);
 }
 
 
@@ -202,48 +227,18 @@ vrna_path_findpath_saddle_ub(vrna_fold_compound_t *vc,
                              int                  width,
                              int                  maxE)
 {
-  int         maxl;
-  const char  *tmp;
-  move_t      *bestpath = NULL;
-  int         dir;
-
-  path_fwd = dir = 0;
-
-  maxl = 1;
-  do {
-    int saddleE;
-    path_fwd = !path_fwd;
-    if (maxl > width)
-      maxl = width;
-
-    if (path)
-      free(path);
-
-    saddleE = find_path_once(vc, s1, s2, maxl, maxE);
-    if (saddleE < maxE) {
-      maxE = saddleE;
-      if (bestpath)
-        free(bestpath);
+  short *pt1, *pt2;
+  int   E;
 
-      bestpath  = path;
-      path      = NULL;
-      dir       = path_fwd;
-    } else {
-      free(path);
-      path = NULL;
-    }
+  pt1 = vrna_ptable(s1);
+  pt2 = vrna_ptable(s2);
 
-    tmp   = s1;
-    s1    = s2;
-    s2    = tmp;
-    maxl  *= 2;
-  } while (maxl < 2 * width);
+  E = saddle_energy(vc, pt1, pt2, width, maxE);
 
-  /* (re)set some globals */
-  path      = bestpath;
-  path_fwd  = dir;
+  free(pt1);
+  free(pt2);
 
-  return maxE;
+  return E;
 }
 
 
@@ -253,37 +248,11 @@ get_path(const char *seq,
          const char *s2,
          int        maxkeep)
 {
-  vrna_path_t           *route = NULL;
-  char                  *sequence = NULL;
-  vrna_fold_compound_t  *vc = NULL;
-  vrna_md_t             md, *md_p;
-
-  set_model_details(&md);
-
-  if (backward_compat_compound) {
-    if (!strcmp(seq, backward_compat_compound->sequence)) {
-      /* check if sequence is the same as before */
-      md.window_size  = backward_compat_compound->length;
-      md.max_bp_span  = backward_compat_compound->length;
-      md_p            = &(backward_compat_compound->params->model_details);
-      if (!memcmp(&md, md_p, sizeof(vrna_md_t)))  /* check if model_details are the same as before */
-        vc = backward_compat_compound;            /* re-use previous vrna_fold_compound_t */
-    }
-  }
-
-  if (!vc) {
-    vrna_fold_compound_free(backward_compat_compound);
+  vrna_fold_compound_t *vc;
 
-    sequence = vrna_cut_point_insert(seq, cut_point);
-
-    backward_compat_compound = vc = vrna_fold_compound(sequence, &md, VRNA_OPTION_EVAL_ONLY);
+  vc = get_backward_compat_compound(seq);
 
-    free(sequence);
-  }
-
-  route = vrna_path_findpath(vc, s1, s2, maxkeep);
-
-  return route;
+  return vrna_path_findpath(vc, s1, s2, maxkeep);
 }
 
 
@@ -304,10 +273,26 @@ vrna_path_findpath_ub(vrna_fold_compound_t  *vc,
                       int                   width,
                       int                   maxE)
 {
-  int         E, d;
-  vrna_path_t *route = NULL;
+  short           *pt1, *pt2;
+  int             E, d, BP_dist;
+  move_t          *path;
+  vrna_path_t     *route = NULL;
+  findpath_ctx_t  ctx;
 
-  E = vrna_path_findpath_saddle_ub(vc, s1, s2, width, maxE);
+  ctx.BP_dist   = 0;
+  ctx.path      = NULL;
+  ctx.path_fwd  = 0;
+
+  pt1 = vrna_ptable(s1);
+  pt2 = vrna_ptable(s2);
+
+  E = findpath_saddle(&ctx, vc, pt1, pt2, width, maxE);
+
+  free(pt1);
+  free(pt2);
+
+  BP_dist = ctx.BP_dist;
+  path    = ctx.path;
 
   /* did we find a better path than one with saddle maxE? */
   if (E < maxE) {
@@ -315,7 +300,7 @@ vrna_path_findpath_ub(vrna_fold_compound_t  *vc,
 
     qsort(path, BP_dist, sizeof(move_t), compare_moves_when);
 
-    if (path_fwd) {
+    if (ctx.path_fwd) {
       /* memorize start of path */
       route[0].s  = strdup(s1);
       route[0].en = vrna_eval_structure(vc, s1);
@@ -367,13 +352,197 @@ vrna_path_findpath_ub(vrna_fold_compound_t  *vc,
   }
 
   free(path);
-  path = NULL;
   return route;
 }
 
 
+PUBLIC int *
+vrna_path_findpath_saddle_matrix(vrna_fold_compound_t *vc,
+                                 const char           **structures,
+                                 int                  width,
+                                 unsigned int         options)
+{
+  short **pts;
+  int   i, n, *S;
+
+  if ((!vc) || (!structures) || (!structures[0]))
+    return NULL;
+
+  for (n = 0; structures[n]; n++);
+
+  /* pair tables and free energies of all structures are computed only once */
+  pts = (short **)vrna_alloc(sizeof(short *) * n);
+  S   = (int *)vrna_alloc(sizeof(int) * n * n);
+
+  for (i = 0; i < n; i++) {
+    pts[i]        = vrna_ptable(structures[i]);
+    S[n * i + i]  = vrna_eval_structure_pt(vc, pts[i]);
+  }
+
+  if (options & VRNA_PATH_SADDLE_MATRIX_UPPER_BOUNDS) {
+    /*
+     *  process one row after another, such that the upper bounds for row i
+     *  only depend on the complete rows before it. This way, the result does
+     *  not depend on the number of threads
+     */
+    for (i = 0; i < n - 1; i++) {
+      int j;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+      for (j = i + 1; j < n; j++) {
+        int k, ub, maxE = INT_MAX - 1;
+
+        /* the detour via structure k is an upper bound for the saddle between i and j */
+        for (k = 0; k < i; k++) {
+          ub = MAX2(S[n * k + i], S[n * k + j]);
+          if (ub < maxE)
+            maxE = ub;
+        }
+
+        S[n * i + j] = S[n * j + i] = saddle_energy(vc, pts[i], pts[j], width, maxE);
+      }
+    }
+  } else {
+    int p;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+    for (p = 0; p < n * n; p++) {
+      int a, b;
+
+      a = p / n;
+      b = p % n;
+
+      if (a < b)
+        S[n * a + b] = S[n * b + a] = saddle_energy(vc, pts[a], pts[b], width, INT_MAX - 1);
+    }
+  }
+
+  for (i = 0; i < n; i++)
+    free(pts[i]);
+
+  free(pts);
+
+  return S;
+}
+
+
+PRIVATE vrna_fold_compound_t *
+get_backward_compat_compound(const char *seq)
+{
+  char                  *sequence;
+  vrna_fold_compound_t  *vc;
+  vrna_md_t             md, *md_p;
+
+  vc = NULL;
+  set_model_details(&md);
+
+  if (backward_compat_compound) {
+    if (!strcmp(seq, backward_compat_compound->sequence)) {
+      /* check if sequence is the same as before */
+      md.window_size  = backward_compat_compound->length;
+      md.max_bp_span  = backward_compat_compound->length;
+      md_p            = &(backward_compat_compound->params->model_details);
+      if (!memcmp(&md, md_p, sizeof(vrna_md_t)))  /* check if model_details are the same as before */
+        vc = backward_compat_compound;            /* re-use previous vrna_fold_compound_t */
+    }
+  }
+
+  if (!vc) {
+    vrna_fold_compound_free(backward_compat_compound);
+
+    sequence = vrna_cut_point_insert(seq, cut_point);
+
+    backward_compat_compound = vc = vrna_fold_compound(sequence, &md, VRNA_OPTION_EVAL_ONLY);
+
+    free(sequence);
+  }
+
+  return vc;
+}
+
+
+PRIVATE int
+saddle_energy(vrna_fold_compound_t  *vc,
+              const short           *pt1,
+              const short           *pt2,
+              int                   width,
+              int                   maxE)
+{
+  int             E;
+  findpath_ctx_t  ctx;
+
+  ctx.BP_dist   = 0;
+  ctx.path      = NULL;
+  ctx.path_fwd  = 0;
+
+  E = findpath_saddle(&ctx, vc, pt1, pt2, width, maxE);
+
+  free(ctx.path);
+
+  return E;
+}
+
+
+PRIVATE int
+findpath_saddle(findpath_ctx_t        *ctx,
+                vrna_fold_compound_t  *vc,
+                const short           *pt1,
+                const short           *pt2,
+                int                   width,
+                int                   maxE)
+{
+  int         maxl;
+  const short *tmp;
+  move_t      *bestpath = NULL;
+  int         dir;
+
+  ctx->path_fwd = dir = 0;
+
+  maxl = 1;
+  do {
+    int saddleE;
+    ctx->path_fwd = !ctx->path_fwd;
+    if (maxl > width)
+      maxl = width;
+
+    if (ctx->path)
+      free(ctx->path);
+
+    saddleE = find_path_once(ctx, vc, pt1, pt2, maxl, maxE);
+    if (saddleE < maxE) {
+      maxE = saddleE;
+      if (bestpath)
+        free(bestpath);
+
+      bestpath  = ctx->path;
+      ctx->path = NULL;
+      dir       = ctx->path_fwd;
+    } else {
+      free(ctx->path);
+      ctx->path = NULL;
+    }
+
+    tmp   = pt1;
+    pt1   = pt2;
+    pt2   = tmp;
+    maxl  *= 2;
+  } while (maxl < 2 * width);
+
+  /* (re)set the path of the context to the best one found */
+  ctx->path     = bestpath;
+  ctx->path_fwd = dir;
+
+  return maxE;
+}
+
+
 PRIVATE int
-try_moves(vrna_fold_compound_t  *vc,
+try_moves(findpath_ctx_t        *ctx,
+          vrna_fold_compound_t  *vc,
           intermediate_t        c,
           int                   maxE,
           intermediate_t        *next,
@@ -391,9 +560,26 @@ try_moves(vrna_fold_compound_t  *vc,
     if (mv->when > 0)
       continue;
 
-    i   = mv->i;
-    j   = mv->j;
-    pt  = (short *)vrna_alloc(sizeof(short) * (len + 1));
+    i = mv->i;
+    j = mv->j;
+
+    /* insert moves are only legal if i and j are unpaired and belong to the same loop */
+    if ((j > 0) &&
+        ((loopidx[i] != loopidx[j]) || (c.pt[i] != 0) || (c.pt[j] != 0)))
+      continue;
+
+#ifdef LOOP_EN
+    /*
+     *  evaluate the energy change on the pair table of c, such that we
+     *  only need to copy it for the moves that we actually keep
+     */
+    en = c.curr_en + vrna_eval_move_pt(vc, c.pt, i, j);
+    if (en >= maxE)
+      continue;
+
+#endif
+
+    pt = (short *)vrna_alloc(sizeof(short) * (len + 1));
     memcpy(pt, c.pt, (len + 1) * sizeof(short));
     if (j < 0) {
       /*it's a delete move */
@@ -401,33 +587,27 @@ try_moves(vrna_fold_compound_t  *vc,
       pt[-j]  = 0;
     } else {
       /* insert move */
-      if ((loopidx[i] == loopidx[j]) && /* i and j belong to same loop */
-          (pt[i] == 0) && (pt[j] == 0)  /* ... and are unpaired */
-          ) {
-        pt[i] = j;
-        pt[j] = i;
-      } else {
-        free(pt);
-        continue; /* llegal move, try next; */
-      }
+      pt[i] = j;
+      pt[j] = i;
     }
 
-#ifdef LOOP_EN
-    en = c.curr_en + vrna_eval_move_pt(vc, c.pt, i, j);
-#else
+#ifndef LOOP_EN
     en = vrna_eval_structure_pt(vc, pt);
-#endif
-    if (en < maxE) {
-      next[num_next].Sen      = (en > oldE) ? en : oldE;
-      next[num_next].curr_en  = en;
-      next[num_next].pt       = pt;
-      mv->when                = dist;
-      mv->E                   = en;
-      next[num_next++].moves  = copy_moves(c.moves);
-      mv->when                = 0;
-    } else {
+    if (en >= maxE) {
       free(pt);
+      continue;
     }
+
+#endif
+
+    next[num_next].Sen      = (en > oldE) ? en : oldE;
+    next[num_next].curr_en  = en;
+    next[num_next].pt       = pt;
+    next[num_next].hash     = (j < 0) ? c.hash - hash_pair(-i, -j) : c.hash + hash_pair(i, j);
+    mv->when                = dist;
+    mv->E                   = en;
+    next[num_next++].moves  = copy_moves(c.moves, ctx->BP_dist);
+    mv->when                = 0;
   }
   free(loopidx);
   return num_next;
@@ -435,20 +615,23 @@ try_moves(vrna_fold_compound_t  *vc,
 
 
 PRIVATE int
-find_path_once(vrna_fold_compound_t *vc,
-               const char           *s1,
-               const char           *s2,
+find_path_once(findpath_ctx_t       *ctx,
+               vrna_fold_compound_t *vc,
+               const short          *pt_start,
+               const short          *pt_target,
                int                  maxl,
                int                  maxE)
 {
-  short           *pt1, *pt2;
+  short           *pt1;
+  const short     *pt2;
   move_t          *mlist;
-  int             i, len, d, dist = 0, result;
+  int             i, len, d, dist = 0, result, *num_children, *index;
+  unsigned int    index_size;
   intermediate_t  *current, *next;
 
-  pt1 = vrna_ptable(s1);
-  pt2 = vrna_ptable(s2);
-  len = (int)strlen(s1);
+  pt1 = vrna_ptable_copy(pt_start);
+  pt2 = pt_target;
+  len = (int)pt1[0];
 
   mlist = (move_t *)vrna_alloc(sizeof(move_t) * len); /* bp_dist < n */
 
@@ -469,21 +652,48 @@ find_path_once(vrna_fold_compound_t *vc,
       }
     }
   }
-  free(pt2);
-  BP_dist           = dist;
+  ctx->BP_dist      = dist;
   current           = (intermediate_t *)vrna_alloc(sizeof(intermediate_t) * (maxl + 1));
   current[0].pt     = pt1;
   current[0].Sen    = current[0].curr_en = vrna_eval_structure_pt(vc, pt1);
   current[0].moves  = mlist;
+  current[0].hash   = hash_ptable(pt1);
   next              = (intermediate_t *)vrna_alloc(sizeof(intermediate_t) * (dist * maxl + 1));
+  num_children      = (int *)vrna_alloc(sizeof(int) * (maxl + 1));
+
+  /* open addressing index for duplicate removal, at most half filled */
+  for (index_size = 1; index_size < 2 * (unsigned int)(dist * maxl + 1); index_size <<= 1);
+  index = (int *)vrna_alloc(sizeof(int) * index_size);
 
   for (d = 1; d <= dist; d++) {
     /* go through the distance classes */
-    int             c, u, num_next = 0;
+    int             c, u, num_current, slot, num_next = 0;
     intermediate_t  *cc;
 
-    for (c = 0; current[c].pt != NULL; c++)
-      num_next += try_moves(vc, current[c], maxE, next + num_next, d);
+    for (num_current = 0; current[num_current].pt != NULL; num_current++);
+
+    /*
+     *  each intermediate has dist - d + 1 moves left, so we reserve a
+     *  slot of that size in next for its children. This allows us to
+     *  expand all intermediates independently of each other
+     */
+    slot = dist - d + 1;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) \
+    if ((num_current > 1) && (num_current * slot >= FINDPATH_PARALLEL_MIN_MOVES))
+#endif
+    for (c = 0; c < num_current; c++)
+      num_children[c] = try_moves(ctx, vc, current[c], maxE, next + c * slot, d);
+
+    /* close the gaps between the slots */
+    for (c = 0; c < num_current; c++) {
+      if (num_next != c * slot)
+        memmove(next + num_next, next + c * slot, sizeof(intermediate_t) * num_children[c]);
+
+      num_next += num_children[c];
+    }
+
     if (num_next == 0) {
       for (cc = current; cc->pt != NULL; cc++)
         free_intermediate(cc);
@@ -491,16 +701,7 @@ find_path_once(vrna_fold_compound_t *vc,
       break;
     }
 
-    /* remove duplicates via sort|uniq
-     * if this becomes a bottleneck we can use a hash instead */
-    qsort(next, num_next, sizeof(intermediate_t), compare_ptable);
-    for (u = 0, c = 1; c < num_next; c++) {
-      if (memcmp(next[u].pt, next[c].pt, sizeof(short) * len) != 0)
-        next[++u] = next[c];
-      else
-        free_intermediate(next + c);
-    }
-    num_next = u + 1;
+    num_next = remove_duplicates(next, num_next, index, index_size);
     qsort(next, num_next, sizeof(intermediate_t), compare_energy);
     /* free the old stuff */
     for (cc = current; cc->pt != NULL; cc++)
@@ -511,15 +712,58 @@ find_path_once(vrna_fold_compound_t *vc,
       free_intermediate(next + u);
     num_next = 0;
   }
+  free(index);
+  free(num_children);
   free(next);
-  path    = current[0].moves;
-  result  = current[0].Sen;
+  ctx->path = current[0].moves;
+  result    = current[0].Sen;
   free(current[0].pt);
   free(current);
   return result;
 }
 
 
+PRIVATE int
+remove_duplicates(intermediate_t  *next,
+                  int             num_next,
+                  int             *index,
+                  unsigned int    index_size)
+{
+  int           c, k, u, len;
+  unsigned int  h, mask;
+
+  /* use only as much of the index as is required to keep it at most half filled */
+  for (mask = 1; (mask < 2 * (unsigned int)num_next) && (mask < index_size); mask <<= 1);
+  mask--;
+
+  for (h = 0; h <= mask; h++)
+    index[h] = -1;
+
+  len = next[0].pt[0];
+
+  for (u = c = 0; c < num_next; c++) {
+    for (h = next[c].hash & mask; (k = index[h]) != -1; h = (h + 1) & mask)
+      if ((next[k].hash == next[c].hash) &&
+          (memcmp(next[k].pt, next[c].pt, sizeof(short) * (len + 1)) == 0))
+        break;
+
+    if (k == -1) {
+      /* first occurence of this structure */
+      index[h]  = u;
+      next[u++] = next[c];
+    } else if (compare_energy(next + c, next + k) < 0) {
+      /* keep the duplicate with the lower saddle, or current energy */
+      free_intermediate(next + k);
+      next[k] = next[c];
+    } else {
+      free_intermediate(next + c);
+    }
+  }
+
+  return u;
+}
+
+
 PRIVATE void
 free_intermediate(intermediate_t *i)
 {
@@ -531,27 +775,6 @@ free_intermediate(intermediate_t *i)
 }
 
 
-PRIVATE int
-compare_ptable(const void *A,
-               const void *B)
-{
-  intermediate_t  *a, *b;
-  int             c;
-
-  a = (intermediate_t *)A;
-  b = (intermediate_t *)B;
-
-  c = memcmp(a->pt, b->pt, a->pt[0] * sizeof(short));
-  if (c != 0)
-    return c;
-
-  if ((a->Sen - b->Sen) != 0)
-    return a->Sen - b->Sen;
-
-  return a->curr_en - b->curr_en;
-}
-
-
 PRIVATE int
 compare_energy(const void *A,
                const void *B)
@@ -564,7 +787,11 @@ compare_energy(const void *A,
   if ((a->Sen - b->Sen) != 0)
     return a->Sen - b->Sen;
 
-  return a->curr_en - b->curr_en;
+  if ((a->curr_en - b->curr_en) != 0)
+    return a->curr_en - b->curr_en;
+
+  /* break ties by structure, such that the beam does not depend on the order of expansion */
+  return memcmp(a->pt, b->pt, a->pt[0] * sizeof(short));
 }
 
 
@@ -582,21 +809,61 @@ compare_moves_when(const void *A,
 
 
 PRIVATE move_t *
-copy_moves(move_t *mvs)
+copy_moves(move_t *mvs,
+           int    bp_dist)
 {
   move_t *new;
 
-  new = (move_t *)vrna_alloc(sizeof(move_t) * (BP_dist + 1));
-  memcpy(new, mvs, sizeof(move_t) * (BP_dist + 1));
+  new = (move_t *)vrna_alloc(sizeof(move_t) * (bp_dist + 1));
+  memcpy(new, mvs, sizeof(move_t) * (bp_dist + 1));
   return new;
 }
 
 
+PRIVATE unsigned int
+hash_pair(int i,
+          int j)
+{
+  unsigned int h;
+
+  /* pair tables store shorts, so this is unique for each pair (i,j) */
+  h = ((unsigned int)i << 16) | (unsigned int)j;
+
+  /* murmur3 finalizer */
+  h ^= h >> 16;
+  h *= 0x85ebca6bU;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35U;
+  h ^= h >> 16;
+
+  return h;
+}
+
+
+/*
+ *  The hash of a pair table is the sum of the hashes of its base pairs.
+ *  This allows us to update it for each move in constant time
+ */
+PRIVATE unsigned int
+hash_ptable(const short *pt)
+{
+  int           i;
+  unsigned int  h = 0;
+
+  for (i = 1; i <= pt[0]; i++)
+    if (i < pt[i])
+      h += hash_pair(i, pt[i]);
+
+  return h;
+}
+
+
 #ifdef TEST_FINDPATH
 
 PUBLIC void
-print_path(const char *seq,
-           const char *struc)
+print_path(findpath_ctx_t *ctx,
+           const char     *seq,
+           const char     *struc)
 {
   int   d;
   char  *s;
@@ -616,11 +883,11 @@ print_path(const char *seq,
     free(pseq);
   }
 
-  qsort(path, BP_dist, sizeof(move_t), compare_moves_when);
-  for (d = 0; d < BP_dist; d++) {
+  qsort(ctx->path, ctx->BP_dist, sizeof(move_t), compare_moves_when);
+  for (d = 0; d < ctx->BP_dist; d++) {
     int i, j;
-    i = path[d].i;
-    j = path[d].j;
+    i = ctx->path[d].i;
+    j = ctx->path[d].j;
     if (i < 0) {
       /* delete */
       s[(-i) - 1] = s[(-j) - 1] = '.';
@@ -639,10 +906,13 @@ int
 main(int  argc,
      char *argv[])
 {
-  char        *line, *seq, *s1, *s2;
-  int         E, maxkeep = 1000;
-  int         verbose = 0, i;
-  vrna_path_t *route, *r;
+  char                  *line, *seq, *s1, *s2;
+  short                 *pt1, *pt2;
+  int                   E, maxkeep = 1000;
+  int                   verbose = 0, i;
+  vrna_path_t           *route, *r;
+  vrna_fold_compound_t  *vc;
+  findpath_ctx_t        ctx;
 
   for (i = 1; i < argc; i++) {
     switch (argv[i][1]) {
@@ -675,16 +945,21 @@ main(int  argc,
   s2    = vrna_cut_point_remove(line, &cut_point);
   free(line);
 
-  E = find_saddle(seq, s1, s2, maxkeep);
+  ctx.BP_dist   = 0;
+  ctx.path      = NULL;
+  ctx.path_fwd  = 0;
+
+  pt1 = vrna_ptable(s1);
+  pt2 = vrna_ptable(s2);
+  vc  = get_backward_compat_compound(seq);
+  E   = findpath_saddle(&ctx, vc, pt1, pt2, maxkeep, INT_MAX - 1);
   printf("saddle_energy = %6.2f\n", E / 100.);
   if (verbose) {
-    if (path_fwd)
-      print_path(seq, s1);
+    if (ctx.path_fwd)
+      print_path(&ctx, seq, s1);
     else
-      print_path(seq, s2);
+      print_path(&ctx, seq, s2);
 
-    free(path);
-    path  = NULL;
     route = get_path(seq, s1, s2, maxkeep);
     for (r = route; r->s; r++) {
       if (cut_point == -1) {
@@ -703,6 +978,9 @@ main(int  argc,
     free(route);
   }
 
+  free(ctx.path);
+  free(pt1);
+  free(pt2);
   free(seq);
   free(s1);
   free(s2);
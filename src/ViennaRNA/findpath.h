@@ -60,6 +60,12 @@ struct vrna_path_s {
  * vc = vrna_fold_compound(sequence, NULL, VRNA_OPTION_DEFAULT);
  *  @endcode
  *
+ *  @note   The search keeps all of its state local to the call, so this function may be
+ *          called concurrently for the same @p vc from different threads. If OpenMP is
+ *          available, the intermediates of each step are expanded in parallel whenever
+ *          @p width is large enough to make this worthwhile. The result does not depend
+ *          on the number of threads.
+ *
  *  @see vrna_path_findpath_saddle_ub(), vrna_fold_compound(), #vrna_fold_compound_t, vrna_path_findpath()
  *
  *  @param vc     The #vrna_fold_compound_t with precomputed sequence encoding and model details
@@ -168,6 +174,51 @@ vrna_path_t *vrna_path_findpath_ub(vrna_fold_compound_t *vc,
                                    int                  maxE);
 
 
+/**
+ *  @brief  Option flag to compute all saddles of vrna_path_findpath_saddle_matrix() independently
+ *  @see    vrna_path_findpath_saddle_matrix(), #VRNA_PATH_SADDLE_MATRIX_UPPER_BOUNDS
+ */
+#define VRNA_PATH_SADDLE_MATRIX_DEFAULT       0U
+
+/**
+ *  @brief  Option flag to bound the saddles of vrna_path_findpath_saddle_matrix() by detours via other structures
+ *  @see    vrna_path_findpath_saddle_matrix(), #VRNA_PATH_SADDLE_MATRIX_DEFAULT
+ */
+#define VRNA_PATH_SADDLE_MATRIX_UPPER_BOUNDS  1U
+
+
+/**
+ *  @brief Find the saddle energies between all pairs of a list of structures (search only direct paths)
+ *
+ *  This function computes the same saddle energies as calling vrna_path_findpath_saddle()
+ *  for each pair of structures @f$i < j@f$ (in this order), but converts each structure
+ *  only once and distributes the pairs among all available threads if OpenMP is available.
+ *
+ *  If @p options contains #VRNA_PATH_SADDLE_MATRIX_UPPER_BOUNDS, the pairs are processed
+ *  row by row, and the search between structures @f$i < j@f$ is bounded by
+ *  @f$ \min_{k < i} \max(S_{ki}, S_{kj}) @f$, i.e. the lowest saddle of any detour via
+ *  a structure of a previous row. Intermediates above that bound are discarded early,
+ *  which considerably speeds up the search. If no direct path below the bound exists,
+ *  the bound itself is stored. Hence, each entry then is the minimum of the direct
+ *  saddle and the detours, which remains an upper bound for the actual barrier.
+ *
+ *  @see vrna_path_findpath_saddle_ub(), #VRNA_PATH_SADDLE_MATRIX_DEFAULT, #VRNA_PATH_SADDLE_MATRIX_UPPER_BOUNDS
+ *
+ *  @param vc         The #vrna_fold_compound_t with precomputed sequence encoding and model details
+ *  @param structures A @em NULL terminated list of structures in dot-bracket notation
+ *  @param width      A number specifying how many strutures are being kept at each step during the search
+ *  @param options    Options that control how the saddles are computed
+ *  @returns          The row-major matrix @f$S@f$ of size @f$n \times n@f$ where @f$S_{ij}@f$ is
+ *                    the saddle energy between structures @f$i@f$ and @f$j@f$ in 10cal/mol, and
+ *                    @f$S_{ii}@f$ the free energy of structure @f$i@f$, or @em NULL if the list
+ *                    is empty
+ */
+int *vrna_path_findpath_saddle_matrix(vrna_fold_compound_t  *vc,
+                                      const char            **structures,
+                                      int                   width,
+                                      unsigned int          options);
+
+
 #ifndef VRNA_DISABLE_BACKWARD_COMPATIBILITY
 
 /**
@@ -10,6 +10,11 @@
 #include "config.h"
 #endif
 
+/* erand48() */
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE
+#endif
+
 #define TDIST 0     /* use tree distance */
 #define PF    1     /* include support for partiton function */
 
@@ -29,22 +34,74 @@
 #include "ViennaRNA/RNAstruct.h"
 #endif
 #include "ViennaRNA/utils/basic.h"
+#include "ViennaRNA/utils/structures.h"
+#include "ViennaRNA/alphabet.h"
 #include "ViennaRNA/fold_vars.h"
-#include "ViennaRNA/pair_mat.h"
+#include "ViennaRNA/model.h"
+#include "ViennaRNA/fold_compound.h"
+#include "ViennaRNA/mfe.h"
+#include "ViennaRNA/eval.h"
+#include "ViennaRNA/params/basic.h"
+#include "ViennaRNA/inverse.h"
+
+/* state of the sequence design, each thread requires its own */
+struct vrna_inverse_s {
+  vrna_md_t       md;                         /* model details, backtrack_type is set per sub-structure */
+  unsigned int    options;
+  char            symbolset[MAXALPHA + 1];
+  char            pairset[2 * MAXALPHA + 1];
+  int             base;
+  int             npairs;
+  int             fold_type;                  /* 0 for mfe, 1 for partition function */
+  double          cost2;                      /* energy difference between target and mfe structure */
+  int             nc2;
+  double          min_en;                     /* mfe of the start sequence to scale partition functions */
+  float           final_cost;                 /* when to stop vrna_inverse_pf() */
+  unsigned short  seed[3];                    /* private state of the random number generator */
+  unsigned short  *rng;
+  char            *failed_seq;                /* sub-sequence and sub-structure of a failed design */
+  char            *failed_struct;
+#if TDIST
+  Tree            *T0;
+#endif
+};
 
 PRIVATE double
-adaptive_walk(char        *start,
-              const char  *target);
+adaptive_walk(vrna_inverse_t  *ctx,
+              char            *start,
+              const char      *target);
+
+
+PRIVATE int
+promising_mutant(vrna_inverse_t       *ctx,
+                 vrna_fold_compound_t *fc,
+                 const short          *pt_target,
+                 const short          *pt_mfe,
+                 int                  gap,
+                 int                  i,
+                 int                  j);
 
 
 PRIVATE void
-shuffle(int *list,
-        int len);
+set_eval_sequence(vrna_inverse_t        *ctx,
+                  vrna_fold_compound_t  *fc,
+                  const char            *string);
+
+
+PRIVATE double
+inv_urn(vrna_inverse_t *ctx);
 
 
 PRIVATE void
-make_start(char       *start,
-           const char *structure);
+shuffle(vrna_inverse_t  *ctx,
+        int             *list,
+        int             len);
+
+
+PRIVATE void
+make_start(vrna_inverse_t *ctx,
+           char           *start,
+           const char     *structure);
 
 
 PRIVATE void
@@ -53,17 +110,19 @@ make_ptable(const char  *structure,
 
 
 PRIVATE void
-make_pairset(void);
+make_pairset(vrna_inverse_t *ctx);
 
 
 PRIVATE double
-mfe_cost(const char *,
+mfe_cost(vrna_inverse_t *,
+         const char *,
          char *,
          const char *);
 
 
 PRIVATE double
-pf_cost(const char *,
+pf_cost(vrna_inverse_t *,
+        const char *,
         char *,
         const char *);
 
@@ -72,6 +131,16 @@ PRIVATE char *
 aux_struct(const char *structure);
 
 
+PRIVATE vrna_inverse_t *
+inverse_ctx_init(const vrna_md_t  *md,
+                 const char       *alphabet,
+                 unsigned int     options);
+
+
+PRIVATE vrna_inverse_t *
+legacy_ctx(void);
+
+
 /* for backward compatibility, make sure symbolset can hold 20 characters */
 PRIVATE char    default_alpha[21] = "AUGC";
 PUBLIC char     *symbolset        = default_alpha;
@@ -79,34 +148,120 @@ PUBLIC int      give_up           = 0;
 PUBLIC float    final_cost        = 0;  /* when to stop inverse_pf_fold */
 PUBLIC int      inv_verbose       = 0;  /* print out substructure on which inverse_fold() fails */
 
-PRIVATE char    pairset[2 * MAXALPHA + 1];
-PRIVATE int     base, npairs;
-PRIVATE int     nc2;
+/*-------------------------------------------------------------------------*/
+
+PUBLIC vrna_inverse_t *
+vrna_inverse_init(const vrna_md_t *md,
+                  const char      *alphabet,
+                  unsigned int    options)
+{
+  vrna_inverse_t *ctx;
+
+  ctx = inverse_ctx_init(md, alphabet, options);
+  vrna_inverse_seed(ctx, 0x1234ABCD);
+
+  return ctx;
+}
+
+
+PRIVATE vrna_inverse_t *
+inverse_ctx_init(const vrna_md_t  *md,
+                 const char       *alphabet,
+                 unsigned int     options)
+{
+  unsigned int    i;
+  vrna_inverse_t  *ctx;
+
+  ctx = (vrna_inverse_t *)vrna_alloc(sizeof(vrna_inverse_t));
+
+  if (md)
+    ctx->md = *md;
+  else
+    vrna_md_set_default(&(ctx->md));
+
+  ctx->options = options;
+
+  if (!alphabet)
+    alphabet = "AUGC";
+
+  /* symbolset should only have uppercase characters */
+  for (i = 0; (i < MAXALPHA) && (alphabet[i]); i++)
+    ctx->symbolset[i] = toupper(alphabet[i]);
+
+  make_pairset(ctx);
+
+  ctx->rng = ctx->seed;
+
+  return ctx;
+}
+
+
+PUBLIC void
+vrna_inverse_free(vrna_inverse_t *ctx)
+{
+  if (ctx) {
+    free(ctx->failed_seq);
+    free(ctx->failed_struct);
+    free(ctx);
+  }
+}
+
+
+PUBLIC void
+vrna_inverse_seed(vrna_inverse_t  *ctx,
+                  unsigned int    seed)
+{
+  if (ctx) {
+    /* same initialization as srand48() */
+    ctx->seed[0]  = 0x330E;
+    ctx->seed[1]  = (unsigned short)(seed & 0xFFFF);
+    ctx->seed[2]  = (unsigned short)(seed >> 16);
+  }
+}
+
+
+PUBLIC int
+vrna_inverse_failure(vrna_inverse_t *ctx,
+                     const char     **sequence,
+                     const char     **structure)
+{
+  if ((ctx) && (ctx->failed_seq)) {
+    if (sequence)
+      *sequence = ctx->failed_seq;
+
+    if (structure)
+      *structure = ctx->failed_struct;
+
+    return 1;
+  }
+
+  return 0;
+}
+
 
 /*-------------------------------------------------------------------------*/
-PRIVATE int     fold_type;
-#if TDIST
-PRIVATE Tree    *T0;
-#endif
-PRIVATE double  cost2;
 
 PRIVATE double
-adaptive_walk(char        *start,
-              const char  *target)
+adaptive_walk(vrna_inverse_t  *ctx,
+              char            *start,
+              const char      *target)
 {
 #ifdef DUMMY
-  printf("%s\n%s %c\n", start, target, backtrack_type);
+  printf("%s\n%s %c\n", start, target, ctx->md.backtrack_type);
   return 0.;
 #endif
-  int     i, j, p, tt, w1, w2, n_pos, len, flag;
+  int     i, j, p, tt, w1, w2, n_pos, len, flag, prescreen, gap;
   long    walk_len;
   char    *string, *string2, *cstring, *structure, *struct2;
   int     *mut_pos_list, mut_sym_list[MAXALPHA + 1], mut_pair_list[2 * MAXALPHA + 1];
   int     *w1_list, *w2_list, mut_position, symbol, bp;
   int     *target_table, *test_table;
+  short   *pt_target, *pt_mfe;
   char    cont;
+  vrna_fold_compound_t *fc_eval;
   double  cost, current_cost, ccost2;
-  double  (*cost_function)(const char *,
+  double  (*cost_function)(vrna_inverse_t *,
+                           const char *,
                            char *,
                            const char *);
 
@@ -125,30 +280,44 @@ adaptive_walk(char        *start,
   w2_list       = (int *)vrna_alloc(sizeof(int) * len);
   target_table  = (int *)vrna_alloc(sizeof(int) * len);
   test_table    = (int *)vrna_alloc(sizeof(int) * len);
+  pt_target     = vrna_ptable(target);
+  pt_mfe        = NULL;
+  fc_eval       = NULL;
+  gap           = 0;
+
+  /*
+   *  On request, mutants that increase the energy difference between the
+   *  target and the current mfe structure are rejected without refolding
+   */
+  prescreen = ((ctx->fold_type == 0) && (ctx->options & VRNA_INVERSE_PRESCREEN)) ? 1 : 0;
 
   make_ptable(target, target_table);
 
-  for (i = 0; i < base; i++)
+  for (i = 0; i < ctx->base; i++)
     mut_sym_list[i] = i;
-  for (i = 0; i < npairs; i++)
+  for (i = 0; i < ctx->npairs; i++)
     mut_pair_list[i] = i;
 
   for (i = 0; i < len; i++)
     string[i] = (islower(start[i])) ? toupper(start[i]) : start[i];
   walk_len = 0;
 
-  if (fold_type == 0)
+  if (ctx->fold_type == 0)
     cost_function = mfe_cost;
   else
     cost_function = pf_cost;
 
-  cost = cost_function(string, structure, target);
+  cost = cost_function(ctx, string, structure, target);
+
+  /* a single evaluation-only fold compound serves all energy evaluations of the pre-screening */
+  if (prescreen)
+    fc_eval = vrna_fold_compound(string, &(ctx->md), VRNA_OPTION_EVAL_ONLY);
 
-  if (fold_type == 0) {
-    ccost2 = cost2;
+  if (ctx->fold_type == 0) {
+    ccost2 = ctx->cost2;
   } else {
-    ccost2  = -1.;
-    cost2   = 0;
+    ccost2      = -1.;
+    ctx->cost2  = 0;
   }
 
   strcpy(cstring, string);
@@ -158,7 +327,7 @@ adaptive_walk(char        *start,
     do {
       cont = 0;
 
-      if (fold_type == 0) {
+      if (ctx->fold_type == 0) {
         /* min free energy fold */
         make_ptable(structure, test_table);
         for (j = w1 = w2 = flag = 0; j < len; j++)
@@ -187,12 +356,21 @@ adaptive_walk(char        *start,
             flag = 0;
           }
 
-        shuffle(w1_list, w1);
-        shuffle(w2_list, w2);
+        shuffle(ctx, w1_list, w1);
+        shuffle(ctx, w2_list, w2);
         for (j = n_pos = 0; j < w1; j++)
           mut_pos_list[n_pos++] = w1_list[j];
         for (j = 0; j < w2; j++)
           mut_pos_list[n_pos++] = w2_list[j];
+
+        if (prescreen) {
+          /* energy difference between target and mfe structure of the current sequence */
+          free(pt_mfe);
+          pt_mfe = vrna_ptable(structure);
+          set_eval_sequence(ctx, fc_eval, cstring);
+          gap = vrna_eval_structure_pt(fc_eval, pt_target) -
+                vrna_eval_structure_pt(fc_eval, pt_mfe);
+        }
       } else {
         /* partition_function */
         for (j = n_pos = 0; j < len; j++)
@@ -200,58 +378,70 @@ adaptive_walk(char        *start,
             if (target_table[j] <= j)
               mut_pos_list[n_pos++] = j;
 
-        shuffle(mut_pos_list, n_pos);
+        shuffle(ctx, mut_pos_list, n_pos);
       }
 
       string2[0] = '\0';
       for (mut_position = 0; mut_position < n_pos; mut_position++) {
         strcpy(string, cstring);
-        shuffle(mut_sym_list, base);
-        shuffle(mut_pair_list, npairs);
+        shuffle(ctx, mut_sym_list, ctx->base);
+        shuffle(ctx, mut_pair_list, ctx->npairs);
 
         i = mut_pos_list[mut_position];
 
         if (target_table[i] < 0) {
           /* unpaired base */
-          for (symbol = 0; symbol < base; symbol++) {
+          for (symbol = 0; symbol < ctx->base; symbol++) {
             if (cstring[i] ==
-                symbolset[mut_sym_list[symbol]])
+                ctx->symbolset[mut_sym_list[symbol]])
               continue;
 
-            string[i] = symbolset[mut_sym_list[symbol]];
+            string[i] = ctx->symbolset[mut_sym_list[symbol]];
 
-            cost = cost_function(string, structure, target);
+            if (prescreen) {
+              set_eval_sequence(ctx, fc_eval, string);
+              if (!promising_mutant(ctx, fc_eval, pt_target, pt_mfe, gap, i, -1))
+                continue;
+            }
+
+            cost = cost_function(ctx, string, structure, target);
 
             if (cost + DBL_EPSILON < current_cost)
               break;
 
-            if ((cost == current_cost) && (cost2 < ccost2)) {
+            if ((cost == current_cost) && (ctx->cost2 < ccost2)) {
               strcpy(string2, string);
               strcpy(struct2, structure);
-              ccost2 = cost2;
+              ccost2 = ctx->cost2;
             }
           }
         } else {
           /* paired base */
-          for (bp = 0; bp < npairs; bp++) {
+          for (bp = 0; bp < ctx->npairs; bp++) {
             j = target_table[i];
             p = mut_pair_list[bp] * 2;
-            if ((cstring[i] == pairset[p]) &&
-                (cstring[j] == pairset[p + 1]))
+            if ((cstring[i] == ctx->pairset[p]) &&
+                (cstring[j] == ctx->pairset[p + 1]))
               continue;
 
-            string[i] = pairset[p];
-            string[j] = pairset[p + 1];
+            string[i] = ctx->pairset[p];
+            string[j] = ctx->pairset[p + 1];
+
+            if (prescreen) {
+              set_eval_sequence(ctx, fc_eval, string);
+              if (!promising_mutant(ctx, fc_eval, pt_target, pt_mfe, gap, i, j))
+                continue;
+            }
 
-            cost = cost_function(string, structure, target);
+            cost = cost_function(ctx, string, structure, target);
 
             if (cost < current_cost)
               break;
 
-            if ((cost == current_cost) && (cost2 < ccost2)) {
+            if ((cost == current_cost) && (ctx->cost2 < ccost2)) {
               strcpy(string2, string);
               strcpy(struct2, structure);
-              ccost2 = cost2;
+              ccost2 = ctx->cost2;
             }
           }
         }
@@ -259,7 +449,7 @@ adaptive_walk(char        *start,
         if (cost < current_cost) {
           strcpy(cstring, string);
           current_cost  = cost;
-          ccost2        = cost2;
+          ccost2        = ctx->cost2;
           walk_len++;
           if (cost > 0)
             cont = 1;
@@ -273,7 +463,7 @@ adaptive_walk(char        *start,
          * cost constant */
         strcpy(cstring, string2);
         strcpy(structure, struct2);
-        nc2++;
+        ctx->nc2++;
         cont = 1;
       }
     } while (cont);
@@ -284,12 +474,15 @@ adaptive_walk(char        *start,
       start[i] = cstring[i];
 
 #if TDIST
-  if (fold_type == 0) {
-    free_tree(T0);
-    T0 = NULL;
+  if (ctx->fold_type == 0) {
+    free_tree(ctx->T0);
+    ctx->T0 = NULL;
   }
 
 #endif
+  vrna_fold_compound_free(fc_eval);
+  free(pt_mfe);
+  free(pt_target);
   free(test_table);
   free(target_table);
   free(mut_pos_list);
@@ -305,18 +498,107 @@ adaptive_walk(char        *start,
 }
 
 
+/*-------------------------------------------------------------------------*/
+
+/*
+ *  Decide whether a mutant of the current sequence at position i (and
+ *  its target pairing partner j) is worth refolding. Since the mfe of
+ *  the mutant can not exceed the energy of the current mfe structure,
+ *  a mutant that increases the energy difference between the target and
+ *  this structure can not decrease the secondary cost, and is unlikely
+ *  to lower the structure distance. Mutants that break a pair of the
+ *  current mfe structure are always refolded.
+ */
+PRIVATE int
+promising_mutant(vrna_inverse_t       *ctx,
+                 vrna_fold_compound_t *fc,
+                 const short          *pt_target,
+                 const short          *pt_mfe,
+                 int                  gap,
+                 int                  i,
+                 int                  j)
+{
+  int   k, p, q;
+  char  *string;
+
+  string = fc->sequence;
+
+  for (k = 0; k < 2; k++) {
+    p = (k == 0) ? i : j;
+    if ((p >= 0) && (pt_mfe[p + 1])) {
+      q = pt_mfe[p + 1] - 1;
+      if (!ctx->md.pair[vrna_nucleotide_encode(string[p], &(ctx->md))]
+          [vrna_nucleotide_encode(string[q], &(ctx->md))])
+        return 1;
+    }
+  }
+
+  return (vrna_eval_structure_pt(fc, pt_target) -
+          vrna_eval_structure_pt(fc, pt_mfe) <= gap) ? 1 : 0;
+}
+
+
+/*-------------------------------------------------------------------------*/
+
+/*
+ *  Replace the sequence of an evaluation-only fold compound by another
+ *  sequence of the same length, i.e. re-encode the positions that differ
+ */
+PRIVATE void
+set_eval_sequence(vrna_inverse_t        *ctx,
+                  vrna_fold_compound_t  *fc,
+                  const char            *string)
+{
+  unsigned int  i, n;
+  short         *S, *S1;
+
+  n   = fc->length;
+  S   = fc->sequence_encoding2;
+  S1  = fc->sequence_encoding;
+
+  for (i = 0; i < n; i++)
+    if (fc->sequence[i] != string[i]) {
+      fc->sequence[i] = string[i];
+      if (fc->nucleotides)
+        fc->nucleotides[0].string[i] = string[i];
+
+      S[i + 1]  = (short)vrna_nucleotide_encode(string[i], &(ctx->md));
+      S1[i + 1] = ctx->md.alias[S[i + 1]];
+    }
+
+  S[n + 1]  = S[1];
+  S1[n + 1] = S1[1];
+  S1[0]     = S1[n];
+}
+
+
+/*-------------------------------------------------------------------------*/
+
+/* uniform random number in [0,1] from the private state of the design */
+PRIVATE double
+inv_urn(vrna_inverse_t *ctx)
+{
+#ifdef HAVE_ERAND48
+  return erand48(ctx->rng);
+#else
+  return vrna_urn();
+#endif
+}
+
+
 /*-------------------------------------------------------------------------*/
 
 /* shuffle produces a ronaom list by doing len exchanges */
 PRIVATE void
-shuffle(int *list,
-        int len)
+shuffle(vrna_inverse_t  *ctx,
+        int             *list,
+        int             len)
 {
   int i, rn;
 
   for (i = 0; i < len; i++) {
     int temp;
-    rn = i + (int)(vrna_urn() * (len - i)); /* [i..len-1] */
+    rn = i + (int)(inv_urn(ctx) * (len - i)); /* [i..len-1] */
     /* swap element i and rn */
     temp      = list[i];
     list[i]   = list[rn];
@@ -370,23 +652,35 @@ make_ptable(const char  *structure,
     wstruct[j - i + 1] = '\0'; \
     strncpy(wstring, string + i, j - i + 1); \
     wstring[j - i + 1]  = '\0'; \
-    dist                = adaptive_walk(wstring, wstruct); \
+    dist                = adaptive_walk(ctx, wstring, wstruct); \
     strncpy(string + i, wstring, j - i + 1); \
-    if ((dist > 0) && (give_up)) \
+    if ((dist > 0) && (ctx->options & VRNA_INVERSE_GIVE_UP)) \
       goto adios; \
   }
 
 
 PUBLIC float
-inverse_fold(char *start,
-             char *structure)
+vrna_inverse_mfe(vrna_inverse_t *ctx,
+                 char           *start,
+                 const char     *structure)
 {
   int     i, j, jj, len, o;
   int     *pt;
   char    *string, *wstring, *wstruct, *aux;
   double  dist = 0;
 
-  nc2 = j = o = fold_type = 0;
+  if ((!ctx) || (!start) || (!structure))
+    return -1.;
+
+  j                   = o = 0;
+  ctx->nc2            = 0;
+  ctx->fold_type      = 0;
+  ctx->md.backtrack   = 1;
+
+  free(ctx->failed_seq);
+  free(ctx->failed_struct);
+  ctx->failed_seq     = NULL;
+  ctx->failed_struct  = NULL;
 
   len = strlen(structure);
   if (strlen(start) != len)
@@ -402,8 +696,7 @@ inverse_fold(char *start,
 
   aux = aux_struct(structure);
   strcpy(string, start);
-  make_pairset();
-  make_start(string, structure);
+  make_start(ctx, string, structure);
 
   make_ptable(structure, pt);
 
@@ -428,7 +721,7 @@ inverse_fold(char *start,
     }
 
     while (pt[j] == i) {
-      backtrack_type = 'C';
+      ctx->md.backtrack_type = 'C';
       if (aux[i] != '[') {
         while (aux[--i] != '[') ;
         while (aux[++j] != ']') ;
@@ -443,7 +736,7 @@ inverse_fold(char *start,
       while ((i >= 0) && (aux[i] == '.'))
         i--;
       if (pt[j] != i) {
-        backtrack_type = (o == 0) ? 'F' : 'M';
+        ctx->md.backtrack_type = (o == 0) ? 'F' : 'M';
         if (j - jj > 8)
           WALK((i + 1), (jj));
 
@@ -458,9 +751,11 @@ inverse_fold(char *start,
     }
   }
 adios:
-  backtrack_type = 'F';
-  if ((dist > 0) && (inv_verbose))
-    printf("%s\n%s\n", wstring, wstruct);
+  ctx->md.backtrack_type = 'F';
+  if (dist > 0) {
+    ctx->failed_seq     = strdup(wstring);
+    ctx->failed_struct  = strdup(wstruct);
+  }
 
   /*if ((dist==0)||(give_up==0))*/ strcpy(start, string);
   free(wstring);
@@ -468,7 +763,27 @@ adios:
   free(string);
   free(aux);
   free(pt);
-  /*   if (dist>0) printf("%3d \n", nc2); */
+  /*   if (dist>0) printf("%3d \n", ctx->nc2); */
+  return dist;
+}
+
+
+PUBLIC float
+inverse_fold(char       *start,
+             const char *structure)
+{
+  const char      *wstring, *wstruct;
+  float           dist;
+  vrna_inverse_t  *ctx;
+
+  ctx   = legacy_ctx();
+  dist  = vrna_inverse_mfe(ctx, start, structure);
+
+  if ((inv_verbose) && (vrna_inverse_failure(ctx, &wstring, &wstruct)))
+    printf("%s\n%s\n", wstring, wstruct);
+
+  vrna_inverse_free(ctx);
+
   return dist;
 }
 
@@ -476,32 +791,65 @@ adios:
 /*-------------------------------------------------------------------------*/
 
 PUBLIC float
-inverse_pf_fold(char  *start,
-                char  *target)
+vrna_inverse_pf(vrna_inverse_t  *ctx,
+                char            *start,
+                const char      *target,
+                float           final_cost)
 {
-  double  dist;
-  int     dang;
-
-  dang = dangles;
-  if (dangles != 0)
-    dangles = 2;
-
-  update_fold_params();     /* make sure there is a valid pair matrix */
-  make_pairset();
-  make_start(start, target);
-  fold_type     = 1;
-  do_backtrack  = 0;
-  dist          = adaptive_walk(start, target);
-  dangles       = dang;
+  double                dist;
+  vrna_md_t             md;
+  vrna_fold_compound_t  *fc;
+
+  if ((!ctx) || (!start) || (!target))
+    return -1.;
+
+  md = ctx->md;
+
+  make_start(ctx, start, target);
+
+  if (ctx->md.dangles != 0)
+    ctx->md.dangles = 2;
+
+  ctx->md.backtrack   = 0;
+  ctx->md.compute_bpp = 0;
+
+  /* scale the partition functions by the mfe of the start sequence */
+  fc          = vrna_fold_compound(start, &(ctx->md), VRNA_OPTION_MFE);
+  ctx->min_en = (double)vrna_mfe(fc, NULL);
+  vrna_fold_compound_free(fc);
+
+  ctx->fold_type      = 1;
+  ctx->final_cost     = final_cost;
+  dist                = adaptive_walk(ctx, start, target);
+  ctx->md             = md;
+
   return dist + final_cost;
 }
 
 
+PUBLIC float
+inverse_pf_fold(char        *start,
+                const char  *target)
+{
+  float           dist;
+  vrna_inverse_t  *ctx;
+
+  ctx   = legacy_ctx();
+  dist  = vrna_inverse_pf(ctx, start, target, final_cost);
+
+  vrna_inverse_free(ctx);
+  do_backtrack = 0;
+
+  return dist;
+}
+
+
 /*-------------------------------------------------------------------------*/
 
 PRIVATE void
-make_start(char       *start,
-           const char *structure)
+make_start(vrna_inverse_t *ctx,
+           char           *start,
+           const char     *structure)
 {
   int i, j, k, l, r, length;
   int *table, *S, sym[MAXALPHA], ss;
@@ -512,15 +860,15 @@ make_start(char       *start,
 
   make_ptable(structure, table);
   for (i = 0; i < strlen(start); i++)
-    S[i] = encode_char(toupper(start[i]));
-  for (i = 0; i < strlen(symbolset); i++)
+    S[i] = vrna_nucleotide_encode(toupper(start[i]), &(ctx->md));
+  for (i = 0; i < ctx->base; i++)
     sym[i] = i;
 
   for (k = 0; k < length; k++) {
     if (table[k] < k)
       continue;
 
-    if (((vrna_urn() < 0.5) && isupper(start[k])) ||
+    if (((inv_urn(ctx) < 0.5) && isupper(start[k])) ||
         islower(start[table[k]])) {
       i = table[k];
       j = k;
@@ -529,21 +877,21 @@ make_start(char       *start,
       j = table[k];
     }
 
-    if (!pair[S[i]][S[j]]) {
+    if (!ctx->md.pair[S[i]][S[j]]) {
       /* make a valid pair by mutating j */
-      shuffle(sym, (int)base);
-      for (l = 0; l < base; l++) {
-        ss = encode_char(symbolset[sym[l]]);
-        if (pair[S[i]][ss])
+      shuffle(ctx, sym, ctx->base);
+      for (l = 0; l < ctx->base; l++) {
+        ss = vrna_nucleotide_encode(ctx->symbolset[sym[l]], &(ctx->md));
+        if (ctx->md.pair[S[i]][ss])
           break;
       }
-      if (l == base) {
+      if (l == ctx->base) {
         /* nothing pairs start[i] */
-        r         = 2 * vrna_int_urn(0, npairs - 1);
-        start[i]  = pairset[r];
-        start[j]  = pairset[r + 1];
+        r         = 2 * (int)(inv_urn(ctx) * ctx->npairs);
+        start[i]  = ctx->pairset[r];
+        start[j]  = ctx->pairset[r + 1];
       } else {
-        start[j] = symbolset[sym[l]];
+        start[j] = ctx->symbolset[sym[l]];
       }
     }
   }
@@ -555,26 +903,25 @@ make_start(char       *start,
 /*---------------------------------------------------------------------------*/
 
 PRIVATE void
-make_pairset(void)
+make_pairset(vrna_inverse_t *ctx)
 {
   int i, j;
   int sym[MAXALPHA];
 
-  make_pair_matrix();
-  base = strlen(symbolset);
+  ctx->base = strlen(ctx->symbolset);
 
-  for (i = 0; i < base; i++)
-    sym[i] = encode_char(symbolset[i]);
+  for (i = 0; i < ctx->base; i++)
+    sym[i] = vrna_nucleotide_encode(ctx->symbolset[i], &(ctx->md));
 
-  for (i = npairs = 0; i < base; i++)
-    for (j = 0; j < base; j++)
-      if (pair[sym[i]][sym[j]]) {
-        pairset[npairs++] = symbolset[i];
-        pairset[npairs++] = symbolset[j];
+  for (i = ctx->npairs = 0; i < ctx->base; i++)
+    for (j = 0; j < ctx->base; j++)
+      if (ctx->md.pair[sym[i]][sym[j]]) {
+        ctx->pairset[ctx->npairs++] = ctx->symbolset[i];
+        ctx->pairset[ctx->npairs++] = ctx->symbolset[j];
       }
 
-  npairs /= 2;
-  if (npairs == 0)
+  ctx->npairs /= 2;
+  if (ctx->npairs == 0)
     vrna_message_error("No pairs in this alphabet!");
 }
 
@@ -582,36 +929,43 @@ make_pairset(void)
 /*---------------------------------------------------------------------------*/
 
 PRIVATE double
-mfe_cost(const char *string,
-         char       *structure,
-         const char *target)
+mfe_cost(vrna_inverse_t       *ctx,
+         const char           *string,
+         char                 *structure,
+         const char           *target)
 {
 #if TDIST
-  Tree    *T1;
-  char    *xstruc;
+  Tree                  *T1;
+  char                  *xstruc;
 #endif
-  double  energy, distance;
+  double                energy, distance;
+  vrna_fold_compound_t  *fc;
 
   if (strlen(string) != strlen(target))
     vrna_message_error("%s\n%s\nunequal length in mfe_cost", string, target);
 
-  energy = fold(string, structure);
+  /* a single fold compound serves both, the mfe fold and the evaluation of the target */
+  fc = vrna_fold_compound(string, &(ctx->md), VRNA_OPTION_MFE);
+
+  energy  = (double)vrna_mfe(fc, structure);
 #if TDIST
-  if (T0 == NULL) {
+  if (ctx->T0 == NULL) {
     xstruc  = expand_Full(target);
-    T0      = make_tree(xstruc);
+    ctx->T0 = make_tree(xstruc);
     free(xstruc);
   }
 
   xstruc    = expand_Full(structure);
   T1        = make_tree(xstruc);
-  distance  = tree_edit_distance(T0, T1);
+  distance  = tree_edit_distance(ctx->T0, T1);
   free(xstruc);
   free_tree(T1);
 #else
   distance = (double)vrna_bp_distance(target, structure);
 #endif
-  cost2 = energy_of_structure(string, target, 0) - energy;
+  ctx->cost2 = (double)vrna_eval_structure(fc, target) - energy;
+  vrna_fold_compound_free(fc);
+
   return (double)distance;
 }
 
@@ -619,16 +973,22 @@ mfe_cost(const char *string,
 /*---------------------------------------------------------------------------*/
 
 PRIVATE double
-pf_cost(const char  *string,
-        char        *structure,
-        const char  *target)
+pf_cost(vrna_inverse_t        *ctx,
+        const char            *string,
+        char                  *structure,
+        const char            *target)
 {
 #if PF
-  double f, e;
+  double                f, e;
+  vrna_fold_compound_t  *fc;
+
+  fc = vrna_fold_compound(string, &(ctx->md), VRNA_OPTION_PF);
+  vrna_exp_params_rescale(fc, &(ctx->min_en));
+  f = (double)vrna_pf(fc, NULL);
+  e = (double)vrna_eval_structure(fc, target);
+  vrna_fold_compound_free(fc);
 
-  f = pf_fold(string, structure);
-  e = energy_of_structure(string, target, 0);
-  return (double)(e - f - final_cost);
+  return (double)(e - f - ctx->final_cost);
 #else
   vrna_message_error("this version not linked with pf_fold");
   return 0;
@@ -636,6 +996,35 @@ pf_cost(const char  *string,
 }
 
 
+/*---------------------------------------------------------------------------*/
+
+/*
+ *  context for the backward compatible interface, i.e. global model settings,
+ *  symbolset, give_up, and the global random number generator
+ */
+PRIVATE vrna_inverse_t *
+legacy_ctx(void)
+{
+  unsigned int    options;
+  vrna_md_t       md;
+  vrna_inverse_t  *ctx;
+
+  set_model_details(&md);
+
+  options = VRNA_INVERSE_DEFAULT;
+  if (give_up)
+    options |= VRNA_INVERSE_GIVE_UP;
+
+  /* draw from the global random number generator */
+  ctx = inverse_ctx_init(&md, symbolset, options);
+#ifdef HAVE_ERAND48
+  ctx->rng = xsubi;
+#endif
+
+  return ctx;
+}
+
+
 /*---------------------------------------------------------------------------*/
 
 PRIVATE char *
@@ -1,6 +1,8 @@
 #ifndef VIENNA_RNA_PACKAGE_INVERSE_H
 #define VIENNA_RNA_PACKAGE_INVERSE_H
 
+#include <ViennaRNA/model.h>
+
 /**
  *  @file     inverse.h
  *  @ingroup  inverse_fold
@@ -14,6 +16,41 @@
  *  @brief RNA sequence design
  */
 
+/**
+ *  @brief  Sequence design context
+ *
+ *  Holds the model details, the alphabet, and the state of the random number
+ *  generator of an inverse folding search. Contexts do not share any state, so
+ *  independent designs may run concurrently as long as each thread uses its own
+ *  context.
+ *
+ *  @see  vrna_inverse_init(), vrna_inverse_mfe(), vrna_inverse_pf()
+ */
+typedef struct vrna_inverse_s vrna_inverse_t;
+
+/**
+ *  @brief  Default options for vrna_inverse_init()
+ */
+#define VRNA_INVERSE_DEFAULT      0U
+
+/**
+ *  @brief  Option flag to stop a design as soon as a sub-structure can not be realized
+ *
+ *  This is the equivalent of the global variable #give_up.
+ */
+#define VRNA_INVERSE_GIVE_UP      1U
+
+/**
+ *  @brief  Option flag to refold only promising mutants in vrna_inverse_mfe()
+ *
+ *  By default, every mutant is refolded, just as in inverse_fold(). With this
+ *  flag, a mutant is only refolded if it does not increase the energy difference
+ *  between the target and the current minimum free energy structure, or if it
+ *  breaks a pair of the latter. This heuristic saves most of the refolding but
+ *  may lead to different, and occasionally worse, designs.
+ */
+#define VRNA_INVERSE_PRESCREEN    2U
+
 /**
  *  \brief This global variable points to the allowed bases, initially "AUGC".
  *  It can be used to design sequences from reduced alphabets.
@@ -61,6 +98,98 @@ float inverse_fold( char *start,
 float inverse_pf_fold(char *start,
                       const char *target);
 
+/**
+ *  @brief  Create a sequence design context
+ *
+ *  The random number generator of the context starts from a fixed default seed,
+ *  so independent searches should be seeded with vrna_inverse_seed().
+ *
+ *  @see  vrna_inverse_free(), vrna_inverse_seed(), #VRNA_INVERSE_GIVE_UP, #VRNA_INVERSE_PRESCREEN
+ *
+ *  @param  md        The model details (may be NULL for default settings)
+ *  @param  alphabet  The allowed bases (may be NULL for "AUGC")
+ *  @param  options   Options, e.g. #VRNA_INVERSE_DEFAULT
+ *  @return           A new sequence design context
+ */
+vrna_inverse_t *
+vrna_inverse_init(const vrna_md_t *md,
+                  const char      *alphabet,
+                  unsigned int    options);
+
+
+/**
+ *  @brief  Free a sequence design context
+ *
+ *  @param  ctx   The sequence design context
+ */
+void
+vrna_inverse_free(vrna_inverse_t *ctx);
+
+
+/**
+ *  @brief  Seed the random number generator of a sequence design context
+ *
+ *  @param  ctx   The sequence design context
+ *  @param  seed  The seed
+ */
+void
+vrna_inverse_seed(vrna_inverse_t  *ctx,
+                  unsigned int    seed);
+
+
+/**
+ *  @brief  Find a sequence with predefined minimum free energy structure
+ *
+ *  Reentrant variant of inverse_fold() that takes the model settings, the
+ *  alphabet and the random number generator from the design context @p ctx.
+ *
+ *  @see  inverse_fold(), vrna_inverse_failure()
+ *
+ *  @param  ctx     The sequence design context
+ *  @param  start   The start sequence, overwritten by the designed sequence
+ *  @param  target  The target secondary structure in dot-bracket notation
+ *  @return         The distance to the target in case a search was unsuccessful, 0 otherwise
+ */
+float
+vrna_inverse_mfe(vrna_inverse_t *ctx,
+                 char           *start,
+                 const char     *target);
+
+
+/**
+ *  @brief  Find a sequence that maximizes the probability of a predefined structure
+ *
+ *  Reentrant variant of inverse_pf_fold().
+ *
+ *  @see  inverse_pf_fold()
+ *
+ *  @param  ctx         The sequence design context
+ *  @param  start       The start sequence, overwritten by the designed sequence
+ *  @param  target      The target secondary structure in dot-bracket notation
+ *  @param  final_cost  When to stop the search, see #final_cost
+ *  @return             The ensemble defect \f$-kT \cdot \log(p)\f$ of the target
+ */
+float
+vrna_inverse_pf(vrna_inverse_t  *ctx,
+                char            *start,
+                const char      *target,
+                float           final_cost);
+
+
+/**
+ *  @brief  Retrieve the sub-structure on which the last call of vrna_inverse_mfe() failed
+ *
+ *  @param  ctx         The sequence design context
+ *  @param  sequence    A pointer to store the sub-sequence (may be NULL)
+ *  @param  structure   A pointer to store the sub-structure (may be NULL)
+ *  @return             1 if the last design failed, 0 otherwise
+ */
+int
+vrna_inverse_failure(vrna_inverse_t *ctx,
+                     const char     **sequence,
+                     const char     **structure);
+
+
 /**
  *  @}
  */
@@ -367,7 +367,7 @@ E_internal_loop(vrna_fold_compound_t  *fc,
   short                 *S, **SS, **S5, **S3;
   unsigned int          *sn, *ss, **a2s, n_seq, s, n;
   int                   e, eee, *idx, ij, *c, *ggg, *rtype, with_ud, with_gquad, noclose,
-                        *hc_up, **c_local, **ggg_local;
+                        *hc_up, **c_local, **ggg_local, sc_ij;
   vrna_param_t          *P;
   vrna_md_t             *md;
   vrna_ud_t             *domains_up;
@@ -428,6 +428,8 @@ E_internal_loop(vrna_fold_compound_t  *fc,
 
     noclose = ((noGUclosure) && (type == 3 || type == 4)) ? 1 : 0;
 
+    sc_ij = (sc_wrapper.compiled) ? sc_int_compiled_pair(i, j, &sc_wrapper) : 0;
+
     if (fc->type == VRNA_FC_TYPE_COMPARATIVE) {
       tt = (unsigned int *)vrna_alloc(sizeof(unsigned int) * n_seq);
       for (s = 0; s < n_seq; s++)
@@ -479,7 +481,9 @@ E_internal_loop(vrna_fold_compound_t  *fc,
               break;
           }
 
-          if (sc_wrapper.pair)
+          if (sc_wrapper.compiled)
+            eee += sc_int_compiled(i, j, k, l, sc_ij, &sc_wrapper);
+          else if (sc_wrapper.pair)
             eee += sc_wrapper.pair(i, j, k, l, &sc_wrapper);
 
           e = MIN2(e, eee);
@@ -553,7 +557,9 @@ E_internal_loop(vrna_fold_compound_t  *fc,
                 break;
             }
 
-            if (sc_wrapper.pair)
+            if (sc_wrapper.compiled)
+              eee += sc_int_compiled(i, j, k, l, sc_ij, &sc_wrapper);
+            else if (sc_wrapper.pair)
               eee += sc_wrapper.pair(i, j, k, l, &sc_wrapper);
 
             e = MIN2(e, eee);
@@ -630,7 +636,9 @@ E_internal_loop(vrna_fold_compound_t  *fc,
                 break;
             }
 
-            if (sc_wrapper.pair)
+            if (sc_wrapper.compiled)
+              eee += sc_int_compiled(i, j, k, l, sc_ij, &sc_wrapper);
+            else if (sc_wrapper.pair)
               eee += sc_wrapper.pair(i, j, k, l, &sc_wrapper);
 
             e = MIN2(e, eee);
@@ -725,7 +733,9 @@ E_internal_loop(vrna_fold_compound_t  *fc,
                 break;
             }
 
-            if (sc_wrapper.pair)
+            if (sc_wrapper.compiled)
+              eee += sc_int_compiled(i, j, k, l, sc_ij, &sc_wrapper);
+            else if (sc_wrapper.pair)
               eee += sc_wrapper.pair(i, j, k, l, &sc_wrapper);
 
             e = MIN2(e, eee);
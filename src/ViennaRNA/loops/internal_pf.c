@@ -112,7 +112,7 @@ exp_E_int_loop(vrna_fold_compound_t *fc,
   unsigned int              *sn, *se, *ss, n_seq, s, **a2s, n;
   int                       *rtype, noclose, *my_iindx, *jindx, *hc_up, ij,
                             with_gquad, with_ud;
-  FLT_OR_DBL                qbt1, q_temp, *qb, **qb_local, *G, *scale;
+  FLT_OR_DBL                qbt1, q_temp, *qb, **qb_local, *G, *scale, sc_ij;
   vrna_exp_param_t          *pf_params;
   vrna_md_t                 *md;
   vrna_ud_t                 *domains_up;
@@ -175,6 +175,8 @@ exp_E_int_loop(vrna_fold_compound_t *fc,
 
     noclose = ((noGUclosure) && (type == 3 || type == 4)) ? 1 : 0;
 
+    sc_ij = (sc_wrapper.compiled) ? sc_int_compiled_pair(i, j, &sc_wrapper) : 1.;
+
     if (fc->type == VRNA_FC_TYPE_COMPARATIVE) {
       tt = (unsigned int *)vrna_alloc(sizeof(unsigned int) * n_seq);
       for (s = 0; s < n_seq; s++)
@@ -226,7 +228,9 @@ exp_E_int_loop(vrna_fold_compound_t *fc,
             break;
         }
 
-        if (sc_wrapper.pair)
+        if (sc_wrapper.compiled)
+          q_temp *= sc_int_compiled(i, j, k, l, sc_ij, &sc_wrapper);
+        else if (sc_wrapper.pair)
           q_temp *= sc_wrapper.pair(i, j, k, l, &sc_wrapper);
 
         qbt1 += q_temp *
@@ -302,7 +306,9 @@ exp_E_int_loop(vrna_fold_compound_t *fc,
                 break;
             }
 
-            if (sc_wrapper.pair)
+            if (sc_wrapper.compiled)
+              q_temp *= sc_int_compiled(i, j, k, l, sc_ij, &sc_wrapper);
+            else if (sc_wrapper.pair)
               q_temp *= sc_wrapper.pair(i, j, k, l, &sc_wrapper);
 
             qbt1 += q_temp *
@@ -384,7 +390,9 @@ exp_E_int_loop(vrna_fold_compound_t *fc,
                 break;
             }
 
-            if (sc_wrapper.pair)
+            if (sc_wrapper.compiled)
+              q_temp *= sc_int_compiled(i, j, k, l, sc_ij, &sc_wrapper);
+            else if (sc_wrapper.pair)
               q_temp *= sc_wrapper.pair(i, j, k, l, &sc_wrapper);
 
             qbt1 += q_temp *
@@ -482,7 +490,9 @@ exp_E_int_loop(vrna_fold_compound_t *fc,
                 break;
             }
 
-            if (sc_wrapper.pair)
+            if (sc_wrapper.compiled)
+              q_temp *= sc_int_compiled(i, j, k, l, sc_ij, &sc_wrapper);
+            else if (sc_wrapper.pair)
               q_temp *= sc_wrapper.pair(i, j, k, l, &sc_wrapper);
 
             qbt1 += q_temp *
@@ -73,8 +73,15 @@ struct aux_arrays {
  #################################
  */
 
+PRIVATE float
+mfe_compute(vrna_fold_compound_t  *fc,
+            char                  *structure,
+            int                   reuse);
+
+
 PRIVATE int
-fill_arrays(vrna_fold_compound_t *fc);
+fill_arrays(vrna_fold_compound_t  *fc,
+            int                   reuse);
 
 
 PRIVATE int
@@ -128,6 +135,41 @@ free_aux_arrays(struct aux_arrays *aux);
 PUBLIC float
 vrna_mfe(vrna_fold_compound_t *fc,
          char                 *structure)
+{
+  return mfe_compute(fc, structure, 0);
+}
+
+
+PUBLIC float
+vrna_mfe_update(vrna_fold_compound_t  *fc,
+                char                  *structure)
+{
+  return mfe_compute(fc, structure, 1);
+}
+
+
+PUBLIC int
+vrna_backtrack_from_intervals(vrna_fold_compound_t  *fc,
+                              vrna_bp_stack_t       *bp_stack,
+                              sect                  bt_stack[],
+                              int                   s)
+{
+  if (fc)
+    return backtrack(fc, bp_stack, bt_stack, s);
+
+  return 0;
+}
+
+
+/*
+ #####################################
+ # BEGIN OF STATIC HELPER FUNCTIONS  #
+ #####################################
+ */
+PRIVATE float
+mfe_compute(vrna_fold_compound_t  *fc,
+            char                  *structure,
+            int                   reuse)
 {
   char            *ss;
   int             length, energy, s;
@@ -154,7 +196,7 @@ vrna_mfe(vrna_fold_compound_t *fc,
     if ((fc->aux_grammar) && (fc->aux_grammar->cb_proc))
       fc->aux_grammar->cb_proc(fc, VRNA_STATUS_MFE_PRE, fc->aux_grammar->data);
 
-    energy = fill_arrays(fc);
+    energy = fill_arrays(fc, reuse);
 
     if (fc->params->model_details.circ)
       energy = postprocess_circular(fc, bt_stack, &s);
@@ -205,30 +247,13 @@ vrna_mfe(vrna_fold_compound_t *fc,
 }
 
 
-PUBLIC int
-vrna_backtrack_from_intervals(vrna_fold_compound_t  *fc,
-                              vrna_bp_stack_t       *bp_stack,
-                              sect                  bt_stack[],
-                              int                   s)
-{
-  if (fc)
-    return backtrack(fc, bp_stack, bt_stack, s);
-
-  return 0;
-}
-
-
-/*
- #####################################
- # BEGIN OF STATIC HELPER FUNCTIONS  #
- #####################################
- */
-
 /* fill DP matrices */
 PRIVATE int
-fill_arrays(vrna_fold_compound_t *fc)
+fill_arrays(vrna_fold_compound_t  *fc,
+            int                   reuse)
 {
-  int               i, j, ij, length, turn, uniq_ML, *indx, *f5, *c, *fML, *fM1;
+  int               i, j, ij, length, turn, uniq_ML, *indx, *f5, *c, *fML, *fM1,
+                    dirty_start, dirty_end;
   vrna_param_t      *P;
   vrna_mx_mfe_t     *matrices;
   vrna_ud_t         *domains_up;
@@ -252,6 +277,30 @@ fill_arrays(vrna_fold_compound_t *fc)
   if ((turn < 0) || (turn > length))
     turn = length; /* does this make any sense? */
 
+  /*
+   *  Only base pairs (i, j) that enclose, or overlap with the interval of
+   *  nucleotides affected by recently added hard constraints need to be
+   *  re-evaluated. Anything else would require to track much more state
+   *  changes, so we simply refuse to re-use entries in such cases
+   */
+  dirty_start = 1;
+  dirty_end   = length;
+
+  if ((reuse) &&
+      (fc->hc->type == VRNA_HC_DEFAULT) &&
+      (!fc->hc->f) &&
+      (!P->model_details.noLP) &&
+      (!P->model_details.gquad) &&
+      (fc->cutpoint <= 0) &&
+      (!domains_up) &&
+      (!fc->aux_grammar)) {
+    dirty_start = (int)fc->hc->dirty_start;
+    dirty_end   = (int)fc->hc->dirty_end;
+  }
+
+  fc->hc->dirty_start = length + 1;
+  fc->hc->dirty_end   = 0;
+
   /* pre-processing ligand binding production rule(s) */
   if (domains_up && domains_up->prod_cb)
     domains_up->prod_cb(fc, domains_up->data);
@@ -278,7 +327,8 @@ fill_arrays(vrna_fold_compound_t *fc)
       ij = indx[j] + i;
 
       /* decompose subsegment [i, j] with pair (i, j) */
-      c[ij] = decompose_pair(fc, i, j, helper_arrays);
+      if ((j >= dirty_start) && (i <= dirty_end))
+        c[ij] = decompose_pair(fc, i, j, helper_arrays);
 
       /* decompose subsegment [i, j] that is multibranch loop part with at least one branch */
       fML[ij] = vrna_E_ml_stems_fast(fc, i, j, helper_arrays->Fmi, helper_arrays->DMLi);
@@ -84,6 +84,40 @@ vrna_mfe(vrna_fold_compound_t *vc,
          char                 *structure);
 
 
+/**
+ *  @brief Re-compute the MFE after adding hard constraints, re-using unaffected DP matrix entries
+ *
+ *  This function behaves like vrna_mfe() but assumes that the DP matrices of @p vc have
+ *  already been filled by a previous call to vrna_mfe() or vrna_mfe_update(), and that
+ *  the only modifications since then were hard constraints added through vrna_hc_add_up(),
+ *  vrna_hc_add_up_batch(), vrna_hc_add_bp(), or vrna_hc_add_bp_nonspecific(). All base pair
+ *  entries @f$ C_{ij} @f$ of sub-sequences @f$ [i:j] @f$ that do not overlap with the interval
+ *  of nucleotides affected by these constraints (see vrna_hc_s.dirty_start, and
+ *  vrna_hc_s.dirty_end) are kept as they are. This considerably speeds up scanning
+ *  applications, e.g. computing accessibility profiles by successively forcing single
+ *  nucleotides to be unpaired.
+ *
+ *  If re-usage is not possible, e.g. due to the G-Quadruplex extension, lonely pair
+ *  suppression, unstructured domains, generic hard constraints, or auxiliary grammar
+ *  extensions, this function falls back to a full re-computation.
+ *
+ *  @warning  Any other change of the fold compound, such as modified soft constraints or
+ *            energy parameters, is not detected and renders the result invalid. Use
+ *            vrna_mfe() in such cases.
+ *
+ *  @see vrna_mfe(), vrna_hc_add_up(), vrna_hc_add_bp()
+ *
+ *  @param vc             fold compound
+ *  @param structure      A pointer to the character array where the
+ *                        secondary structure in dot-bracket notation will be written to (Maybe NULL)
+ *
+ *  @return the minimum free energy (MFE) in kcal/mol
+ */
+float
+vrna_mfe_update(vrna_fold_compound_t  *vc,
+                char                  *structure);
+
+
 /**
  *  @brief Compute the minimum free energy of two interacting RNA molecules
  *
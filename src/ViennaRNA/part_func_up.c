@@ -70,7 +70,7 @@
 #include "ViennaRNA/part_func.h"
 #include "ViennaRNA/loops/all.h"
 #include "ViennaRNA/part_func_up.h"
-#include "ViennaRNA/duplex.h"
+#include "ViennaRNA/alphabet.h"
 
 
 #define CO_TURN 0
@@ -79,6 +79,22 @@
 #define ISOLATED  256.0
 /* #define NUMERIC 1 */
 
+/* partition function of a single sequence as required by unstru() */
+typedef struct {
+  short             *S1;
+  char              *ptype;
+  FLT_OR_DBL        *qb;
+  FLT_OR_DBL        *qm;
+  FLT_OR_DBL        *q1k;
+  FLT_OR_DBL        *qln;
+  FLT_OR_DBL        *probs;
+  int               *iindx;
+  int               *jindx;   /* ptype is column-wise indexed if set, row-wise otherwise */
+  vrna_exp_param_t  *P;
+  double            pf_scale;
+  int               noGUclosure;
+} up_pf_t;
+
 /*
  #################################
  # GLOBAL VARIABLES              #
@@ -90,17 +106,13 @@
  # PRIVATE VARIABLES             #
  #################################
  */
-PRIVATE short             *S = NULL, *S1 = NULL, *SS = NULL, *SS2 = NULL;
-PRIVATE vrna_exp_param_t  *Pf = NULL;                           /* use this structure for all the exp-arrays*/
-PRIVATE FLT_OR_DBL        *qb = NULL, *qm = NULL, *prpr = NULL; /* add arrays for pf_unpaired()*/
-PRIVATE FLT_OR_DBL        *probs = NULL;
-PRIVATE FLT_OR_DBL        *q1k = NULL, *qln = NULL;
-PRIVATE double            *qqm2 = NULL, *qq_1m2 = NULL, *qqm = NULL, *qqm1 = NULL;
-PRIVATE FLT_OR_DBL        *scale = NULL, *expMLbase = NULL;
-PRIVATE char              *ptype = NULL;  /* precomputed array of pair types */
-PRIVATE int               init_length;    /* length in last call to init_pf_fold()*/
-PRIVATE double            init_temp;      /* temperature in last call to scale_pf_params */
-PRIVATE int               *my_iindx = NULL;
+PRIVATE vrna_exp_param_t  *Pf_compat = NULL;  /* Boltzmann factors of the backward compatibility interface */
+PRIVATE double            init_temp;          /* temperature in last call to scale_pf_params */
+
+#ifdef _OPENMP
+#pragma omp threadprivate(Pf_compat, init_temp)
+#endif
+
 /* make iptypes array for intermolecular constrains (ipidx for indexing)*/
 
 
@@ -123,39 +135,63 @@ plot_free_pu_out(pu_out   *res,
 
 
 PRIVATE void
-scale_stru_pf_params(unsigned int length);
+scale_stru_pf_params(void);
 
 
 PRIVATE void
-init_pf_two(int length);
+get_scale_arrays(vrna_exp_param_t *P,
+                 double           pfs,
+                 unsigned int     length,
+                 FLT_OR_DBL       *scale,
+                 FLT_OR_DBL       *expMLbase);
 
 
 PRIVATE void
-scale_int(const char  *s,
-          const char  *sl,
-          double      *sc_int);
+init_pf_two(int     length,
+            up_pf_t *pf);
 
 
-PRIVATE void
-encode_seq(const char *s1,
-           const char *s2);
+PRIVATE pu_contrib *
+unstru(const char *sequence,
+       int        w,
+       up_pf_t    *pf);
 
 
-PRIVATE constrain *
-get_ptypes_up(char        *S,
-              const char  *structure);
+PRIVATE interact *
+interact_core(vrna_exp_param_t  *Pf,
+              const char        *s1,
+              const char        *s2,
+              pu_contrib        *p_c,
+              pu_contrib        *p_c2,
+              int               w,
+              const char        *cstruc,
+              int               incr3,
+              int               incr5,
+              int               noLP);
 
 
-PRIVATE void
-get_up_arrays(unsigned int length);
+PRIVATE double
+scale_int(const char        *s,
+          const char        *sl,
+          vrna_exp_param_t  *P);
 
 
-PRIVATE void
-free_up_arrays(void);
+PRIVATE int
+duplex_energy(const char  *s1,
+              const char  *s2,
+              vrna_md_t   *md);
+
+
+PRIVATE constrain *
+get_ptypes_up(char        *S,
+              const char  *structure,
+              vrna_md_t   *md,
+              int         noLP);
 
 
 PRIVATE void
 set_encoded_seq(const char  *sequence,
+                vrna_md_t   *md,
                 short       **S,
                 short       **S1);
 
@@ -239,13 +275,68 @@ PUBLIC pu_contrib *
 pf_unstru(char  *sequence,
           int   w)
 {
-  int           n, i, j, v, k, l, o, p, ij, kl, po, u, u1, d, type, type_2, tt;
-  unsigned int  size;
-  double        temp, tqm2;
-  double        qbt1, *tmp, sum_l, *sum_M;
-  double        *store_H, *store_Io, **store_I2o; /* hairp., interior contribs */
-  double        *store_M_qm_o, *store_M_mlbase;   /* multiloop contributions */
-  pu_contrib    *pu_test;
+  up_pf_t     pf;
+  pu_contrib  *pu;
+
+  init_pf_two((int)strlen(sequence), &pf);
+
+  pu = unstru(sequence, w, &pf);
+
+  free(pf.iindx);
+
+  return pu;
+}
+
+
+PUBLIC pu_contrib *
+vrna_pf_unstru(vrna_fold_compound_t *fc,
+               int                  w)
+{
+  up_pf_t pf;
+
+  if ((!fc) || (fc->type != VRNA_FC_TYPE_SINGLE) || (!fc->exp_matrices) ||
+      (!fc->exp_matrices->probs) || (!fc->ptype)) {
+    vrna_message_warning("vrna_pf_unstru: "
+                         "base pair probabilities of a single sequence required, "
+                         "run vrna_pf() first!");
+    return NULL;
+  }
+
+  pf.S1           = fc->sequence_encoding;
+  pf.ptype        = fc->ptype;
+  pf.qb           = fc->exp_matrices->qb;
+  pf.qm           = fc->exp_matrices->qm;
+  pf.q1k          = fc->exp_matrices->q1k;
+  pf.qln          = fc->exp_matrices->qln;
+  pf.probs        = fc->exp_matrices->probs;
+  pf.iindx        = fc->iindx;
+  pf.jindx        = fc->jindx;
+  pf.P            = fc->exp_params;
+  pf.pf_scale     = fc->exp_params->pf_scale;
+  pf.noGUclosure  = fc->exp_params->model_details.noGUclosure;
+
+  return unstru(fc->sequence, w, &pf);
+}
+
+
+PRIVATE pu_contrib *
+unstru(const char *sequence,
+       int        w,
+       up_pf_t    *pf)
+{
+  short             *S1;
+  char              *ptype;
+  int               n, i, j, v, k, l, o, p, ij, kl, po, u, u1, d, type, type_2, tt, *my_iindx,
+                    *jindx;
+  unsigned int      size;
+  double            temp, tqm2;
+  double            qbt1, *tmp, sum_l, *sum_M;
+  double            *store_H, *store_Io, **store_I2o; /* hairp., interior contribs */
+  double            *store_M_qm_o, *store_M_mlbase;   /* multiloop contributions */
+  double            *qqm2, *qq_1m2, *qqm, *qqm1;
+  FLT_OR_DBL        *qb, *qm, *q1k, *qln, *probs, *prpr, *scale, *expMLbase;
+  vrna_exp_param_t  *Pf;
+  pu_contrib        *pu_test;
 
   sum_l   = 0.0;
   temp    = 0;
@@ -254,8 +345,26 @@ pf_unstru(char  *sequence,
   pu_test = get_pu_contrib_struct((unsigned)n, (unsigned)w);
   size    = ((n + 1) * (n + 2)) >> 1;
 
-  get_up_arrays((unsigned)n);
-  init_pf_two(n);
+  S1        = pf->S1;
+  ptype     = pf->ptype;
+  qb        = pf->qb;
+  qm        = pf->qm;
+  q1k       = pf->q1k;
+  qln       = pf->qln;
+  probs     = pf->probs;
+  my_iindx  = pf->iindx;
+  jindx     = pf->jindx;
+  Pf        = pf->P;
+
+  prpr      = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * size);
+  expMLbase = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * (n + 2));
+  scale     = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * (n + 2));
+  qqm2      = (double *)vrna_alloc(sizeof(double) * (n + 2));
+  qq_1m2    = (double *)vrna_alloc(sizeof(double) * (n + 2));
+  qqm       = (double *)vrna_alloc(sizeof(double) * (n + 2));
+  qqm1      = (double *)vrna_alloc(sizeof(double) * (n + 2));
+
+  get_scale_arrays(Pf, pf->pf_scale, (unsigned)n, scale, expMLbase);
 
   /* init everything */
   for (d = 0; d <= TURN; d++)
@@ -305,10 +414,10 @@ pf_unstru(char  *sequence,
        * an unpaired region [i,i+w[ exists within [p,o] */
       u     = o - p - 1;
       po    = my_iindx[p] - o;
-      type  = ptype[po];
+      type  = (jindx) ? ptype[jindx[o] + p] : ptype[po];
       if (type) {
         /*hairpin contribution*/
-        if (((type == 3) || (type == 4)) && no_closingGU)
+        if (((type == 3) || (type == 4)) && pf->noGUclosure)
           temp = 0.;
         else
           temp = prpr[po] *
@@ -324,7 +433,7 @@ pf_unstru(char  *sequence,
           sum_l = 0.;
           for (l = MAX2(k + TURN + 1, o - 1 - MAXLOOP + u1); l < o; l++) {
             kl      = my_iindx[k] - l;
-            type_2  = ptype[kl];
+            type_2  = (jindx) ? ptype[jindx[l] + k] : ptype[kl];
             if ((l + 1) < o)
               store_Io[l + 1] += sum_l;
 
@@ -481,7 +590,7 @@ pf_unstru(char  *sequence,
   for (o = n - TURN - 1; o >= 1; o--) {
     for (p = o + TURN + 1; p <= n; p++) {
       po    = my_iindx[o] - p;
-      type  = ptype[po];
+      type  = (jindx) ? ptype[jindx[p] + o] : ptype[po];
       /* recalculate of qqm matrix containing final stem
        * contributions to multiple loop partition function
        * from segment [o,p] */
@@ -538,7 +647,13 @@ pf_unstru(char  *sequence,
 
   free(sum_M);
   free(store_M_mlbase);
-  free_up_arrays();
+  free(prpr);
+  free(expMLbase);
+  free(scale);
+  free(qqm);
+  free(qqm1);
+  free(qqm2);
+  free(qq_1m2);
   return pu_test;
 }
 
@@ -590,21 +705,89 @@ pf_interact(const char  *s1,
             int         incr3,
             int         incr5)
 {
-  int         i, j, k, l, n1, n2, add_i5, add_i3, pc_size;
+  interact *Int;
+
+  if (fold_constrained && cstruc == NULL)
+    vrna_message_error("option -C selected, but no constrained structure given\n");
+
+  /* make sure the Boltzmann factors are up to date */
+  scale_stru_pf_params();
+
+  Int = interact_core(Pf_compat,
+                      s1,
+                      s2,
+                      p_c,
+                      p_c2,
+                      w,
+                      (fold_constrained) ? cstruc : NULL,
+                      incr3,
+                      incr5,
+                      noLonelyPairs);
+
+  free_pf_arrays(); /* for arrays for pf_fold(...) */
+
+  return Int;
+}
+
+
+PUBLIC interact *
+vrna_pf_interact(vrna_exp_param_t *params,
+                 const char       *s1,
+                 const char       *s2,
+                 pu_contrib       *p_c,
+                 pu_contrib       *p_c2,
+                 int              w,
+                 const char       *cstruc,
+                 int              incr3,
+                 int              incr5)
+{
+  if ((!params) || (!s1) || (!s2) || (!p_c))
+    return NULL;
+
+  return interact_core(params,
+                       s1,
+                       s2,
+                       p_c,
+                       p_c2,
+                       w,
+                       cstruc,
+                       incr3,
+                       incr5,
+                       params->model_details.noLP);
+}
+
+
+PRIVATE interact *
+interact_core(vrna_exp_param_t  *Pf,
+              const char        *s1,
+              const char        *s2,
+              pu_contrib        *p_c,
+              pu_contrib        *p_c2,
+              int               w,
+              const char        *cstruc,
+              int               incr3,
+              int               incr5,
+              int               noLP)
+{
+  short       *S1, *SS2;
+  int         i, j, k, l, n1, n2, add_i5, add_i3, pc_size, constrained;
   double      temp, Z, rev_d, E, Z2, **p_c_S, **p_c2_S, int_scale;
-  FLT_OR_DBL  ****qint_4, **qint_ik;
+  FLT_OR_DBL  ****qint_4, **qint_ik, *scale;
   /* PRIVATE double **pint; array for pf_up() output */
   interact    *Int;
   double      G_min, G_is, Gi_min;
   int         gi, gj, gk, gl, ci, cj, ck, cl, prev_k, prev_l;
   FLT_OR_DBL  **int_ik;
-  double      Z_int, temp_int, temppfs;
+  double      Z_int, temp_int;
   double      const_scale, const_T;
   constrain   *cc = NULL;                           /* constrains for cofolding */
   char        *Seq, *i_long, *i_short, *pos = NULL; /* short seq appended to long one */
+  vrna_md_t   md;
 
   /* int ***pu_jl; */ /* positions of interaction in the short RNA */
 
+  constrained = (cstruc != NULL);
+
   G_min = G_is = Gi_min = 100.0;
   gi    = gj = gk = gl = ci = cj = ck = cl = 0;
 
@@ -620,10 +803,14 @@ pf_interact(const char  *s1,
   strcpy(Seq, s1);
   strcat(Seq, s2);
 
-  set_encoded_seq(s1, &S, &S1);
-  set_encoded_seq(s2, &SS, &SS2);
+  /* pair types and the alias encoding for mismatches are taken from the model settings of Pf */
+  vrna_md_copy(&md, &(Pf->model_details));
+  vrna_md_update(&md);
+
+  set_encoded_seq(s1, &md, NULL, &S1);
+  set_encoded_seq(s2, &md, NULL, &SS2);
 
-  cc = get_ptypes_up(Seq, cstruc);
+  cc = get_ptypes_up(Seq, cstruc, &md, noLP);
 
   get_interact_arrays(n1, n2, p_c, p_c2, w, incr5, incr3, &p_c_S, &p_c2_S);
 
@@ -633,16 +820,12 @@ pf_interact(const char  *s1,
   Int->Gi = (double *)vrna_alloc(sizeof(double) * (n1 + 2));
 
   /* use a different scaling for pf_interact*/
-  scale_int(s2, s1, &int_scale);
-
-  /* set the global scale array and the global variable pf_scale to the
-   * values used to scale the interaction, keep their former values !! */
-  temppfs   = pf_scale;
-  pf_scale  = int_scale;
+  int_scale = scale_int(s2, s1, Pf);
 
-  /* in order to scale expLoopEnergy correctly call*/
-  /* we also pass twice the seq-length to avoid bogus access to scale[] array */
-  scale_stru_pf_params((unsigned)2 * n1);
+  /* in order to scale expLoopEnergy correctly */
+  /* we also use twice the seq-length to avoid bogus access to scale[] array */
+  scale = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * ((n1 + 1) * 2));
+  get_scale_arrays(Pf, int_scale, (unsigned)2 * n1, scale, NULL);
 
   qint_ik = (FLT_OR_DBL **)vrna_alloc(sizeof(FLT_OR_DBL *) * (n1 + 1));
   for (i = 1; i <= n1; i++)
@@ -653,16 +836,14 @@ pf_interact(const char  *s1,
     int_ik[i] = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * (n1 + 1));
   Z_int = 0.;
   /*  Gint = ( -log(int_ik[gk][gi])-( ((int) w/2)*log(pf_scale)) )*((Pf->temperature+K0)*GASCONST/1000.0); */
-  const_scale = ((int)w / 2) * log(pf_scale);
+  const_scale = ((int)w / 2) * log(int_scale);
   const_T     = (Pf->kT / 1000.0);
-  encode_seq(s1, s2);
-  /* static  short *S~S1, *S1~SS1, *SS~S2, *SS2; */
   for (i = 0; i <= n1; i++)
     Int->Pi[i] = Int->Gi[i] = 0.;
   E = 0.;
   Z = 0.;
 
-  if (fold_constrained && cstruc != NULL) {
+  if (constrained && cstruc != NULL) {
     pos = strchr(cstruc, '|');
     if (pos) {
       ci = ck = cl = cj = 0;
@@ -703,11 +884,9 @@ pf_interact(const char  *s1,
         vrna_message_error("pf_interact: could not satisfy all constraints");
       }
     }
-  } else if (fold_constrained && cstruc == NULL) {
-    vrna_message_error("option -C selected, but no constrained structure given\n");
   }
 
-  if (fold_constrained)
+  if (constrained)
     pos = strchr(cstruc, '|');
 
   /*  qint_4[i][j][k][l] contribution that region (k-i) in seq1 (l=n1)
@@ -719,16 +898,16 @@ pf_interact(const char  *s1,
   for (i = 1; i <= n1; i++) {
     int end_k;
     end_k = i - w;
-    if (fold_constrained && pos && ci)
+    if (constrained && pos && ci)
       end_k = MAX2(i - w, ci - w);
 
     /* '|' constrains for long sequence: index i from 1 to n1 (5' to 3')*/
     /* interaction has to include 3' most '|' constrain, ci */
-    if (fold_constrained && pos && ci && i == 1 && i < ci)
+    if (constrained && pos && ci && i == 1 && i < ci)
       i = ci - w + 1 > 1 ? ci - w + 1 : 1;
 
     /* interaction has to include 5' most '|' constrain, ck*/
-    if (fold_constrained && pos && ck && i > ck + w - 1)
+    if (constrained && pos && ck && i > ck + w - 1)
       break;
 
     /* note: qint_4[i] will be freed before we allocate qint_4[i+1] */
@@ -743,16 +922,16 @@ pf_interact(const char  *s1,
     for (j = n2; j > 0; j--) {
       int type, type2, end_l;
       end_l = j + w;
-      if (fold_constrained && pos && ci)
+      if (constrained && pos && ci)
         end_l = MIN2(cj + w, j + w);
 
       /* '|' constrains for short sequence: index j from n2 to 1 (3' to 5')*/
       /* interaction has to include 5' most '|' constrain, cj */
-      if (fold_constrained && pos && cj && j == n2 && j > cj)
+      if (constrained && pos && cj && j == n2 && j > cj)
         j = cj + w - 1 > n2 ? n2 : cj + w - 1;
 
       /* interaction has to include 3' most '|' constrain, cl*/
-      if (fold_constrained && pos && cl && j < cl - w + 1)
+      if (constrained && pos && cl && j < cl - w + 1)
         break;
 
       type                = cc->ptype[cc->indx[i] - (n1 + j)];
@@ -803,7 +982,7 @@ pf_interact(const char  *s1,
       temp    = 0.;
       prev_l  = n2;
       for (k = i - 1; k > end_k && k > 0; k--) {
-        if (fold_constrained && pos && cstruc[k - 1] == '|' && k > prev_k)
+        if (constrained && pos && cstruc[k - 1] == '|' && k > prev_k)
           prev_k = k;
 
         for (l = j + 1; l < end_l && l <= n2; l++) {
@@ -812,13 +991,13 @@ pf_interact(const char  *s1,
 
           type2 = cc->ptype[cc->indx[k] - (n1 + l)];
           /* '|' : l HAS TO be paired: not pair (k,x) where x>l allowed */
-          if (fold_constrained && pos && cstruc[n1 + l - 1] == '|' && l < prev_l)
+          if (constrained && pos && cstruc[n1 + l - 1] == '|' && l < prev_l)
             prev_l = l; /*break*/
 
-          if (fold_constrained && pos && (k <= ck || i >= ci) && !type2)
+          if (constrained && pos && (k <= ck || i >= ci) && !type2)
             continue;
 
-          if (fold_constrained && pos && ((cstruc[k - 1] == '|') || (cstruc[n1 + l - 1] == '|')) &&
+          if (constrained && pos && ((cstruc[k - 1] == '|') || (cstruc[n1 + l - 1] == '|')) &&
               !type2)
             break;
 
@@ -874,20 +1053,20 @@ pf_interact(const char  *s1,
 
           /* '|' constrain in long sequence */
           /* collect interactions starting before 5' most '|' constrain */
-          if (fold_constrained && pos && ci && i < ci)
+          if (constrained && pos && ci && i < ci)
             continue;
 
           /* collect interactions ending after 3' most '|' constrain*/
-          if (fold_constrained && pos && ck && k > ck)
+          if (constrained && pos && ck && k > ck)
             continue;
 
           /* '|' constrain in short sequence */
           /* collect interactions starting before 5' most '|' constrain */
-          if (fold_constrained && pos && cj && j > cj)
+          if (constrained && pos && cj && j > cj)
             continue;
 
           /* collect interactions ending after 3' most '|' constrain*/
-          if (fold_constrained && pos && cl && l < cl)
+          if (constrained && pos && cl && l < cl)
             continue;
 
           /* scale everything to w/2*/
@@ -937,10 +1116,10 @@ pf_interact(const char  *s1,
     if (i > w) {
       int bla;
       bla = i - w;
-      if (fold_constrained && pos && ci && i - w < ci - w + 1)
+      if (constrained && pos && ci && i - w < ci - w + 1)
         continue;
 
-      if (fold_constrained && pos && ci)
+      if (constrained && pos && ci)
         bla = MAX2(ci - w + 1, i - w);
 
       for (j = n2; j > 0; j--) {
@@ -964,7 +1143,7 @@ pf_interact(const char  *s1,
         Int->Pi[l] += qint_ik[i][k] / Z;
         /* Int->Gi[l]: minimal delta G at position [l] */
         Int->Gi[l] = MIN2(Int->Gi[l],
-                          (-log(qint_ik[i][k]) - (((int)w / 2) * log(pf_scale))) *
+                          (-log(qint_ik[i][k]) - (((int)w / 2) * log(int_scale))) *
                           (Pf->kT / 1000.0));
       }
     }
@@ -973,7 +1152,7 @@ pf_interact(const char  *s1,
     int start_i, end_i;
     start_i = n1 - w + 1;
     end_i   = n1;
-    if (fold_constrained && pos && ci) {
+    if (constrained && pos && ci) {
       /* a break in the k loop might result in unfreed values */
       start_i = ci - w + 1 < n1 - w + 1 ? ci - w + 1 : n1 - w + 1;
       start_i = start_i > 0 ? start_i : 1;
@@ -997,7 +1176,7 @@ pf_interact(const char  *s1,
     int start_i, end_i;
     start_i = 1;
     end_i   = n1;
-    if (fold_constrained && pos) {
+    if (constrained && pos) {
       start_i = ci - w + 1 > 0 ? ci - w + 1 : 1;
       end_i   = ck + w - 1 > n1 ? n1 : ck + w - 1;
     }
@@ -1013,7 +1192,7 @@ pf_interact(const char  *s1,
     free(qint_4);
   }
 
-  if (fold_constrained && (gi == 0 || gk == 0 || gl == 0 || gj == 0))
+  if (constrained && (gi == 0 || gk == 0 || gl == 0 || gj == 0))
     vrna_message_error("pf_interact: could not satisfy all constraints");
 
   /* fill structure interact */
@@ -1035,20 +1214,9 @@ pf_interact(const char  *s1,
     free(qint_ik[i]);
   free(qint_ik);
 
-  /* reset the global variables pf_scale and scale to their original values */
-  pf_scale = temppfs;                 /* reset pf_scale */
-  scale_stru_pf_params((unsigned)n1); /* reset the scale array */
-  free_pf_arrays();                   /* for arrays for pf_fold(...) */
-
-  if (expMLbase != NULL) {
-    free(expMLbase);
-    expMLbase = NULL;
-  }
-
-  if (scale != NULL) {
-    free(scale);
-    scale = NULL;
-  }
+  free(scale);
+  free(S1);
+  free(SS2);
 
   for (i = 1; i <= n1; i++)
     free(p_c_S[i]);
@@ -1069,35 +1237,97 @@ pf_interact(const char  *s1,
 
 /*------------------------------------------------------------------------*/
 /* use an extra scale for pf_interact, here sl is the longer sequence */
-PRIVATE void
-scale_int(const char  *s,
-          const char  *sl,
-          double      *sc_int)
+PRIVATE double
+scale_int(const char        *s,
+          const char        *sl,
+          vrna_exp_param_t  *P)
 {
-  int     n, nl;
-  duplexT mfe;
-  double  kT;
-
-  n   = strlen(s);
-  nl  = strlen(sl);
-
-  free(expMLbase);
-  free(scale);
+  int       n;
+  float     energy;
+  double    kT, sc_int;
+  vrna_md_t md;
 
-  expMLbase = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * ((nl + 1) * 2));
-  scale     = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * ((nl + 1) * 2));
+  n = strlen(s);
 
   /* use RNA duplex to get a realistic estimate for the best possible
    * interaction energy between the short RNA s and its target sl */
-  mfe = duplexfold(s, sl);
+  vrna_md_copy(&md, &(P->model_details));
+  vrna_md_update(&md);
+  energy = (float)duplex_energy(s, sl, &md) / 100.;
 
-  kT = Pf->kT / 1000.0; /* in Kcal */
+  kT = P->kT / 1000.0; /* in Kcal */
 
   /* sc_int is similar to pf_scale: i.e. one time the scale */
-  *sc_int = exp(-(mfe.energy) / kT / n);
+  sc_int = exp(-(energy) / kT / n);
+
+  return sc_int;
+}
+
+
+/*
+ *  minimum free energy of the duplex of s1 and s2 (in dcal/mol), i.e. with
+ *  inter-molecular base pairs only. Same recursion as duplexfold() but with
+ *  the model settings md instead of the global ones, and without backtracking
+ */
+PRIVATE int
+duplex_energy(const char  *s1,
+              const char  *s2,
+              vrna_md_t   *md)
+{
+  int           i, j, k, l, n1, n2, type, type2, E, Emin, **c;
+  short         *S1, *S2, *SS1, *SS2;
+  vrna_param_t  *P;
+
+  n1    = (int)strlen(s1);
+  n2    = (int)strlen(s2);
+  Emin  = INF;
+  P     = vrna_params(md);
+
+  c = (int **)vrna_alloc(sizeof(int *) * (n1 + 1));
+  for (i = 1; i <= n1; i++)
+    c[i] = (int *)vrna_alloc(sizeof(int) * (n2 + 1));
+
+  set_encoded_seq(s1, md, &S1, &SS1);
+  set_encoded_seq(s2, md, &S2, &SS2);
+
+  for (i = 1; i <= n1; i++) {
+    for (j = n2; j > 0; j--) {
+      type    = md->pair[S1[i]][S2[j]];
+      c[i][j] = type ? P->DuplexInit : INF;
+      if (!type)
+        continue;
+
+      c[i][j] += E_ExtLoop(type, (i > 1) ? SS1[i - 1] : -1, (j < n2) ? SS2[j + 1] : -1, P);
+      for (k = i - 1; k > 0 && k > i - MAXLOOP - 2; k--) {
+        for (l = j + 1; l <= n2; l++) {
+          if (i - k + l - j - 2 > MAXLOOP)
+            break;
 
-  /* free the structure returned by duplexfold */
-  free(mfe.structure);
+          type2 = md->pair[S1[k]][S2[l]];
+          if (!type2)
+            continue;
+
+          E = E_IntLoop(i - k - 1, l - j - 1, type2, md->rtype[type],
+                        SS1[k + 1], SS2[l - 1], SS1[i - 1], SS2[j + 1], P);
+          c[i][j] = MIN2(c[i][j], c[k][l] + E);
+        }
+      }
+      E = c[i][j];
+      E += E_ExtLoop(md->rtype[type], (j > 1) ? SS2[j - 1] : -1, (i < n1) ? SS1[i + 1] : -1, P);
+      Emin = MIN2(Emin, E);
+    }
+  }
+
+  for (i = 1; i <= n1; i++)
+    free(c[i]);
+  free(c);
+  free(S1);
+  free(S2);
+  free(SS1);
+  free(SS2);
+  free(P);
+
+  return Emin;
 }
 
 
@@ -1106,8 +1336,11 @@ scale_int(const char  *s,
 /* get_pf_arrays(&S, &S1, &ptype, &qb, &qm, &q1k, &qln);*/
 /* init_pf_fold(), update_pf_params, encode_char(), make_ptypes() are called by pf_fold() */
 PRIVATE void
-init_pf_two(int length)
+init_pf_two(int     length,
+            up_pf_t *pf)
 {
+  short *S;
+
 #ifdef SUN4
   nonstandard_arithmetic();
 #else
@@ -1118,178 +1351,173 @@ init_pf_two(int length)
   make_pair_matrix();
 
   /* gets the arrays, that we need, from part_func.c */
-  if (!get_pf_arrays(&S, &S1, &ptype, &qb, &qm, &q1k, &qln))
+  if (!get_pf_arrays(&S, &(pf->S1), &(pf->ptype), &(pf->qb), &(pf->qm), &(pf->q1k), &(pf->qln)))
     vrna_message_error("init_pf_two: pf_fold() has to be called before calling pf_unstru()\n");
 
   /* get a pointer to the base pair probs */
-  probs = export_bppm();
+  pf->probs = export_bppm();
 
-  scale_stru_pf_params((unsigned)length);
+  scale_stru_pf_params();
 
-  init_length = length;
-  if (init_temp != Pf->temperature)
+  pf->iindx       = vrna_idx_row_wise((unsigned)length);
+  pf->jindx       = NULL;
+  pf->P           = Pf_compat;
+  pf->pf_scale    = pf_scale;
+  pf->noGUclosure = no_closingGU;
+
+  if (init_temp != Pf_compat->temperature)
     vrna_message_error("init_pf_two: inconsistency with temperature");
 }
 
 
-PRIVATE void
-get_up_arrays(unsigned int length)
+PUBLIC void
+free_interact(interact *pin)
 {
-  unsigned int  l1  = length + 1;
-  unsigned int  l2  = length + 2;
-
-  prpr      = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * ((l1 * l2) >> 1));
-  expMLbase = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * l2);
-  scale     = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * l2);
-  qqm2      = (double *)vrna_alloc(sizeof(double) * l2);
-  qq_1m2    = (double *)vrna_alloc(sizeof(double) * l2);
-  qqm       = (double *)vrna_alloc(sizeof(double) * l2);
-  qqm1      = (double *)vrna_alloc(sizeof(double) * l2);
-  my_iindx  = vrna_idx_row_wise(length);
+  if (pin != NULL) {
+    free(pin->Pi);
+    free(pin->Gi);
+    free(pin);
+    pin = NULL;
+  }
 }
 
 
-PRIVATE void
-free_up_arrays(void)
-{
-  if (prpr != NULL) {
-    free(prpr);
-    prpr = NULL;
-  }
-
-  if (expMLbase != NULL) {
-    free(expMLbase);
-    expMLbase = NULL;
-  }
+/*---------------------------------------------------------------------------*/
+/* store and load the contributions to the probability of being unpaired */
+#define PU_CONTRIB_MAGIC  "VRNApu1"
 
-  if (scale != NULL) {
-    free(scale);
-    scale = NULL;
-  }
+PUBLIC int
+vrna_pu_contrib_write(FILE              *fp,
+                      const pu_contrib  *pu,
+                      const char        *key)
+{
+  unsigned int  i, dim[3];
+  size_t        w;
 
-  if (qqm != NULL) {
-    free(qqm);
-    qqm = NULL;
-  }
+  if ((!fp) || (!pu))
+    return 0;
 
-  if (qqm1 != NULL) {
-    free(qqm1);
-    qqm1 = NULL;
-  }
+  dim[0]  = (unsigned int)pu->length;
+  dim[1]  = (unsigned int)pu->w;
+  dim[2]  = (key) ? (unsigned int)strlen(key) : 0;
+  w       = (size_t)pu->w + 1;
 
-  if (qqm2 != NULL) {
-    free(qqm2);
-    qqm2 = NULL;
-  }
+  if ((fwrite(PU_CONTRIB_MAGIC, sizeof(char), 8, fp) != 8) ||
+      (fwrite(dim, sizeof(unsigned int), 3, fp) != 3) ||
+      (fwrite(key, sizeof(char), dim[2], fp) != dim[2]))
+    return 0;
 
-  if (qq_1m2 != NULL) {
-    free(qq_1m2);
-    qq_1m2 = NULL;
-  }
+  for (i = 0; i <= dim[0]; i++)
+    if ((fwrite(pu->H[i], sizeof(double), w, fp) != w) ||
+        (fwrite(pu->I[i], sizeof(double), w, fp) != w) ||
+        (fwrite(pu->M[i], sizeof(double), w, fp) != w) ||
+        (fwrite(pu->E[i], sizeof(double), w, fp) != w))
+      return 0;
 
-  if (my_iindx != NULL) {
-    free(my_iindx);
-    my_iindx = NULL;
-  }
+  return 1;
 }
 
 
-PUBLIC void
-free_interact(interact *pin)
+PUBLIC pu_contrib *
+vrna_pu_contrib_read(FILE       *fp,
+                     const char *key)
 {
-  if (S != NULL && pin != NULL) {
-    free(S);
-    S = NULL;
+  char          magic[8], *k;
+  unsigned int  i, dim[3];
+  size_t        w;
+  pu_contrib    *pu;
+
+  if ((!fp) ||
+      (fread(magic, sizeof(char), 8, fp) != 8) ||
+      (memcmp(magic, PU_CONTRIB_MAGIC, 8) != 0) ||
+      (fread(dim, sizeof(unsigned int), 3, fp) != 3))
+    return NULL;
+
+  /* the key must match exactly */
+  if (dim[2] != ((key) ? (unsigned int)strlen(key) : 0))
+    return NULL;
+
+  k = (char *)vrna_alloc(sizeof(char) * (dim[2] + 1));
+  if ((fread(k, sizeof(char), dim[2], fp) != dim[2]) ||
+      ((key) && (strcmp(k, key) != 0))) {
+    free(k);
+    return NULL;
   }
 
-  if (S1 != NULL && pin != NULL) {
-    free(S1);
-    S1 = NULL;
-  }
+  free(k);
 
-  if (pin != NULL) {
-    free(pin->Pi);
-    free(pin->Gi);
-    free(pin);
-    pin = NULL;
-  }
-}
-
-
-/*---------------------------------------------------------------------------*/
-
-PRIVATE void
-encode_seq(const char *s1,
-           const char *s2)
-{
-  unsigned int i, l;
+  pu  = get_pu_contrib_struct(dim[0], dim[1]);
+  w   = (size_t)dim[1] + 1;
 
-  l = strlen(s1);
-  /* S and S1 are freed by free_pf_arrays(); ! */
-  S   = (short *)vrna_alloc(sizeof(short) * (l + 1));
-  S1  = (short *)vrna_alloc(sizeof(short) * (l + 1));
-  /* S1 exists only for the special X K and I bases and energy_set!=0 */
-  S[0] = l;
-  for (i = 1; i <= l; i++) {
-    /* make numerical encoding of sequence */
-    S[i]  = (short)encode_char(toupper(s1[i - 1]));
-    S1[i] = alias[S[i]]; /* for mismatches of nostandard bases */
-  }
-  if (s2 != NULL) {
-    l = strlen(s2);
-    /* SS2 exists only for the special X K and I bases and energy_set!=0 */
-    SS[0] = l;
-    for (i = 1; i <= l; i++) {
-      /* make numerical encoding of sequence */
-      SS[i]   = (short)encode_char(toupper(s2[i - 1]));
-      SS2[i]  = alias[SS[i]]; /* for mismatches of nostandard bases */
+  for (i = 0; i <= dim[0]; i++)
+    if ((fread(pu->H[i], sizeof(double), w, fp) != w) ||
+        (fread(pu->I[i], sizeof(double), w, fp) != w) ||
+        (fread(pu->M[i], sizeof(double), w, fp) != w) ||
+        (fread(pu->E[i], sizeof(double), w, fp) != w)) {
+      free_pu_contrib_struct(pu);
+      return NULL;
     }
-  }
+
+  return pu;
 }
 
 
 /*-------------------------------------------------------------------------*/
 /* scale energy parameters and pre-calculate Boltzmann weights:
  * most of this is done in structure Pf see params.c,h (function:
- * get_scaled_pf_parameters(), only arrays scale and expMLbase are handled here*/
+ * get_scaled_pf_parameters(), only arrays scale and expMLbase are handled in
+ * get_scale_arrays() */
 PRIVATE void
-scale_stru_pf_params(unsigned int length)
+scale_stru_pf_params(void)
 {
-  unsigned int  i;
-  double        kT;
-
+  double kT;
 
   /* Do this only at the first call for get_scaled_pf_parameters()
    * and/or if temperature has changed*/
-  if (init_temp != temperature) {
-    if (Pf)
-      free(Pf);
+  if ((!Pf_compat) || (init_temp != temperature)) {
+    if (Pf_compat)
+      free(Pf_compat);
 
     vrna_md_t md;
     set_model_details(&md);
-    Pf = vrna_exp_params(&md);
+    Pf_compat = vrna_exp_params(&md);
   }
 
-  init_temp = Pf->temperature;
+  init_temp = Pf_compat->temperature;
 
-  kT = Pf->kT; /* kT in cal/mol  */
+  kT = Pf_compat->kT; /* kT in cal/mol  */
 
   /* scaling factors (to avoid overflows) */
   if (pf_scale == -1) {
     /* mean energy for random sequences: 184.3*length cal */
-    pf_scale = exp(-(-185 + (Pf->temperature - 37.) * 7.27) / kT);
+    pf_scale = exp(-(-185 + (Pf_compat->temperature - 37.) * 7.27) / kT);
     if (pf_scale < 1)
       pf_scale = 1;
   }
 
-  Pf->pf_scale  = pf_scale;
-  scale[0]      = 1.;
-  scale[1]      = 1. / pf_scale;
-  expMLbase[0]  = 1;
-  expMLbase[1]  = Pf->expMLbase / pf_scale;
-  for (i = 2; i <= length + 1; i++) {
-    scale[i]      = scale[i / 2] * scale[i - (i / 2)];
-    expMLbase[i]  = pow(Pf->expMLbase, (double)i) * scale[i];
+  Pf_compat->pf_scale = pf_scale;
+}
+
+
+PRIVATE void
+get_scale_arrays(vrna_exp_param_t *P,
+                 double           pfs,
+                 unsigned int     length,
+                 FLT_OR_DBL       *scale,
+                 FLT_OR_DBL       *expMLbase)
+{
+  unsigned int i;
+
+  scale[0]  = 1.;
+  scale[1]  = 1. / pfs;
+  for (i = 2; i <= length + 1; i++)
+    scale[i] = scale[i / 2] * scale[i - (i / 2)];
+
+  if (expMLbase) {
+    expMLbase[0]  = 1;
+    expMLbase[1]  = P->expMLbase / pfs;
+    for (i = 2; i <= length + 1; i++)
+      expMLbase[i] = pow(P->expMLbase, (double)i) * scale[i];
   }
 }
 
@@ -1485,7 +1713,7 @@ plot_free_pu_out(pu_out   *res,
   double  dG_u;
   char    nan[4], *time, dg[11];
   FILE    *wastl;
-  double  kT = Pf->kT;
+  double  kT = (Pf_compat) ? Pf_compat->kT : (temperature + K0) * GASCONST;
 
   wastl = fopen(ofile, "a");
   if (wastl == NULL) {
@@ -1620,21 +1848,22 @@ Up_plot(pu_contrib    *p_c,
 /* copy from part_func_co.c */
 PRIVATE constrain *
 get_ptypes_up(char        *Seq,
-              const char  *structure)
+              const char  *structure,
+              vrna_md_t   *md,
+              int         noLP)
 {
   int       n, i, j, k, l, length;
   constrain *con;
   short     *s, *s1;
 
-  length = strlen(Seq);
-  make_pair_matrix();
+  length    = strlen(Seq);
   con       = (constrain *)vrna_alloc(sizeof(constrain));
   con->indx = (int *)vrna_alloc(sizeof(int) * (length + 1));
   for (i = 1; i <= length; i++)
     con->indx[i] = ((length + 1 - i) * (length - i)) / 2 + length + 1;
   con->ptype = (char *)vrna_alloc(sizeof(char) * ((length + 1) * (length + 2) / 2));
 
-  set_encoded_seq((const char *)Seq, &s, &s1);
+  set_encoded_seq((const char *)Seq, md, &s, &s1);
 
   n = s[0];
   for (k = 1; k <= n - CO_TURN - 1; k++)
@@ -1645,12 +1874,12 @@ get_ptypes_up(char        *Seq,
       if (j > n)
         continue;
 
-      type = pair[s[i]][s[j]];
+      type = md->pair[s[i]][s[j]];
       while ((i >= 1) && (j <= n)) {
         if ((i > 1) && (j < n))
-          ntype = pair[s[i - 1]][s[j + 1]];
+          ntype = md->pair[s[i - 1]][s[j + 1]];
 
-        if (noLonelyPairs && (!otype) && (!ntype))
+        if (noLP && (!otype) && (!ntype))
           type = 0; /* i.j can only form isolated pairs */
 
         con->ptype[con->indx[i] - j]  = (char)type;
@@ -1661,7 +1890,7 @@ get_ptypes_up(char        *Seq,
       }
     }
 
-  if (fold_constrained && (structure != NULL)) {
+  if (structure != NULL) {
     int   hx, *stack;
     char  type;
     stack = (int *)vrna_alloc(sizeof(int) * (n + 1));
@@ -1711,27 +1940,14 @@ get_ptypes_up(char        *Seq,
 
 PRIVATE void
 set_encoded_seq(const char  *sequence,
+                vrna_md_t   *md,
                 short       **S,
                 short       **S1)
 {
-  unsigned int i, l;
-
-  l = strlen(sequence);
-  if (S != NULL) {
-    *S = (short *)vrna_alloc(sizeof(short) * (l + 2));
-    for (i = 1; i <= l; i++) /* make numerical encoding of sequence */
-      (*S)[i] = (short)encode_char(toupper(sequence[i - 1]));
-    (*S)[l + 1] = (*S)[1];
-    (*S)[0]     = (short)l;
-  }
+  if (S != NULL)
+    *S = vrna_seq_encode_simple(sequence, md);
 
   /* S1 exists only for the special X K and I bases and energy_set!=0 */
-  if (S1 != NULL) {
-    *S1 = (short *)vrna_alloc(sizeof(short) * (l + 2));
-    for (i = 1; i <= l; i++)                                            /* make numerical encoding of sequence */
-      (*S1)[i] = alias[(short)encode_char(toupper(sequence[i - 1]))];   /* for mismatches of nostandard bases */
-    /* for circular folding add first base at position n+1 and last base at position 0 in S1 */
-    (*S1)[l + 1]  = (*S1)[1];
-    (*S1)[0]      = (*S1)[l];
-  }
+  if (S1 != NULL)
+    *S1 = vrna_seq_encode(sequence, md);
 }
@@ -1,7 +1,11 @@
 #ifndef VIENNA_RNA_PACKAGE_PART_FUNC_UP_H
 #define VIENNA_RNA_PACKAGE_PART_FUNC_UP_H
 
+#include <stdio.h>
+
 #include <ViennaRNA/datastructures/basic.h>
+#include <ViennaRNA/fold_compound.h>
+#include <ViennaRNA/params/basic.h>
 
 #define   RNA_UP_MODE_1   1U
 #define   RNA_UP_MODE_2   2U
@@ -59,6 +63,26 @@
 pu_contrib *pf_unstru(char *sequence,
                       int max_w);
 
+/**
+ *  @brief Calculate the partition function over all unpaired regions
+ *  of a maximal length from the equilibrium probabilities of a fold compound
+ *
+ *  Reentrant variant of pf_unstru(). Instead of the global arrays of the
+ *  last call to pf_fold() the partition function and base pair probabilities
+ *  stored in @p fc are used. Hence, vrna_pf() has to be called for @p fc
+ *  with base pair probabilities turned on before calling this function.
+ *  The Boltzmann factors and the scaling factor are taken from
+ *  @p fc->exp_params.
+ *
+ *  @see pf_unstru(), vrna_pf_interact(), vrna_pu_contrib_write()
+ *
+ *  @param  fc    The fold compound of a single sequence with equilibrium probabilities
+ *  @param  max_w The maximal length of the unpaired regions
+ *  @return       The contributions to the probabilities of being unpaired (or NULL on error)
+ */
+pu_contrib *vrna_pf_unstru(vrna_fold_compound_t *fc,
+                           int                  max_w);
+
 /**
  *  @brief Calculates the probability of a local interaction between two sequences.
  * 
@@ -110,6 +134,37 @@ interact *pf_interact(const char *s1,
                       int incr3,
                       int incr5);
 
+/**
+ *  @brief Calculates the probability of a local interaction between two sequences
+ *
+ *  Reentrant variant of pf_interact() that does not depend on any global
+ *  variable or preceding call to pf_fold(). All energy parameters are taken from
+ *  @p params and the structure constraint in @p cstruc is applied whenever it is
+ *  not NULL.
+ *
+ *  @see pf_interact(), vrna_pf_unstru()
+ *
+ *  @param  params  The Boltzmann factors to use
+ *  @param  s1      The longer sequence
+ *  @param  s2      The shorter sequence
+ *  @param  p_c     The contributions to the probabilities of being unpaired of @p s1
+ *  @param  p_c2    The contributions to the probabilities of being unpaired of @p s2 (may be NULL)
+ *  @param  max_w   The maximal length of the interaction
+ *  @param  cstruc  A structure constraint for both sequences (may be NULL)
+ *  @param  incr3   The number of unpaired residues 3' of the interaction in @p s1
+ *  @param  incr5   The number of unpaired residues 5' of the interaction in @p s1
+ *  @return         The interaction (or NULL on error)
+ */
+interact *vrna_pf_interact(vrna_exp_param_t *params,
+                           const char       *s1,
+                           const char       *s2,
+                           pu_contrib       *p_c,
+                           pu_contrib       *p_c2,
+                           int              max_w,
+                           const char       *cstruc,
+                           int              incr3,
+                           int              incr5);
+
 /**
  *  @brief Frees the output of function pf_interact().
  */
@@ -141,6 +196,37 @@ void        free_pu_contrib_struct(pu_contrib *pu);
 void
 free_pu_contrib(pu_contrib *pu);
 
+/**
+ *  @brief Write the contributions to the probabilities of being unpaired to a file
+ *
+ *  The data is written in a binary format together with an identifying @p key,
+ *  e.g. the sequence and the model settings the contributions were computed for.
+ *  Use vrna_pu_contrib_read() to load the data again.
+ *
+ *  @param  fp    The file to write to
+ *  @param  pu    The contributions to the probabilities of being unpaired
+ *  @param  key   An identifier that must be matched when reading the data (may be NULL)
+ *  @return       Non-zero on success, 0 otherwise
+ */
+int
+vrna_pu_contrib_write(FILE              *fp,
+                      const pu_contrib  *pu,
+                      const char        *key);
+
+/**
+ *  @brief Read the contributions to the probabilities of being unpaired from a file
+ *
+ *  @see vrna_pu_contrib_write()
+ *
+ *  @param  fp    The file to read from
+ *  @param  key   The identifier the data must have been written with (may be NULL)
+ *  @return       The contributions to the probabilities of being unpaired, or NULL
+ *                if the file could not be read or the key does not match
+ */
+pu_contrib *
+vrna_pu_contrib_read(FILE       *fp,
+                     const char *key);
+
 /**
  * @}
  */
@@ -40,7 +40,9 @@
 #include <math.h>
 #include <ctype.h>
 #include <string.h>
+#include <stdarg.h>
 #include "ViennaRNA/utils/basic.h"
+#include "ViennaRNA/utils/cpu.h"
 #include "ViennaRNA/params/default.h"
 #include "ViennaRNA/fold_vars.h"
 #include "ViennaRNA/fold.h"
@@ -77,6 +79,8 @@
 #define LINIX(i, j, l)    ((i + 20) * l + j)
 #define LINIY(i, j, l)    ((i + 25) * l + j)
 
+#include "plex_kernel.inc"
+
 PRIVATE void
 encode_seqs(const char  *s1,
             const char  *s2);
@@ -140,7 +144,8 @@ plot_max(const int  max,
 
 /* PRIVATE duplexT duplexfold_XS(const char *s1, const char *s2,const int **access_s1, const int **access_s2, const int i_pos, const int j_pos, const int threshold); */
 PRIVATE duplexT
-duplexfold_XS(const char  *s1,
+duplexfold_XS(vrna_cstr_t output,
+              const char  *s1,
               const char  *s2,
               const int   **access_s1,
               const int   **access_s2,
@@ -162,7 +167,8 @@ backtrack_XS(int        i,
 
 
 PRIVATE void
-find_max_XS(const int   *position,
+find_max_XS(vrna_cstr_t output,
+            const int   *position,
             const int   *position_j,
             const int   delta,
             const int   threshold,
@@ -179,7 +185,8 @@ find_max_XS(const int   *position,
 
 
 PRIVATE void
-plot_max_XS(const int   max,
+plot_max_XS(vrna_cstr_t output,
+            const int   max,
             const int   max_pos,
             const int   max_pos_j,
             const int   alignment_length,
@@ -194,6 +201,36 @@ plot_max_XS(const int   max,
             const int   b_b);
 
 
+PRIVATE void
+plex_printf(vrna_cstr_t output,
+            const char  *format,
+            ...);
+
+
+/**
+*** scan_tables() fills the recursion arrays of Lduplexfold(_XS) row by row
+*** using the pre-gathered energy rows of the query, see plex_kernel.inc.
+*** It returns 0 if the sequences are not supported by the energy rows.
+**/
+PRIVATE int
+scan_tables(const char  *s2,
+            int         *SA,
+            const int   **access_s1,
+            int         **DJ,
+            const int   extension_cost,
+            const int   iopen,
+            const int   iext_s,
+            const int   iext_ass,
+            const int   bopen,
+            const int   bext,
+            const int   delta,
+            int         *position,
+            int         *position_j,
+            int         *max,
+            int         *max_pos,
+            int         *max_pos_j);
+
+
 PRIVATE duplexT
 fduplexfold(const char  *s1,
             const char  *s2,
@@ -271,6 +308,25 @@ PRIVATE short *S1 = NULL, *SS1 = NULL, *S2 = NULL, *SS2 = NULL; /*contains the s
 PRIVATE int   n1, n2;                                           /* sequence lengths */
 PRIVATE int   n3, n4; /*sequence length for the duplex*/;
 
+/**
+*** energy rows of the last query seen by Lduplexfold(_XS)
+**/
+PRIVATE plex_tables_t *query_tables = NULL;
+
+/**
+*** select the row kernel by the SIMD capabilities of the CPU (1) or always use the scalar one (0)
+**/
+PRIVATE int           plex_dispatch = 1;
+
+#ifdef _OPENMP
+
+/* NOTE: all variables are assumed to be uninitialized if they are declared as threadprivate
+ */
+#pragma omp threadprivate(P, c, in, bx, by, inx, iny, S1, SS1, S2, SS2, n1, n2, n3, n4, \
+  query_tables)
+
+#endif
+
 
 /*-----------------------------------------------------------------------duplexfold_XS---------------------------------------------------------------------------*/
 
@@ -282,7 +338,8 @@ PRIVATE int   n3, n4; /*sequence length for the duplex*/;
 *** profiles, i_pos, j_pos are the coordinates of the closing pair.
 **/
 PRIVATE duplexT
-duplexfold_XS(const char  *s1,
+duplexfold_XS(vrna_cstr_t output,
+              const char  *s1,
               const char  *s2,
               const int   **access_s1,
               const int   **access_s2,
@@ -324,7 +381,7 @@ duplexfold_XS(const char  *s1,
   j     = 1 + j_flag;
   type  = pair[S1[i]][S2[j]];
   if (!type) {
-    printf("Error during initialization of the duplex in duplexfold_XS\n");
+    plex_printf(output, "Error during initialization of the duplex in duplexfold_XS\n");
     mfe.structure = NULL;
     mfe.energy    = INF;
     return mfe;
@@ -1902,6 +1959,37 @@ Lduplexfold_XS(const char *s1,
                const int  il_b,
                const int  b_a,
                const int  b_b)
+{
+  return Lduplexfold_XS_cstr(NULL,
+                             s1,
+                             s2,
+                             access_s1,
+                             access_s2,
+                             threshold,
+                             alignment_length,
+                             delta,
+                             fast,
+                             il_a,
+                             il_b,
+                             b_a,
+                             b_b);
+}
+
+
+duplexT **
+Lduplexfold_XS_cstr(vrna_cstr_t output,
+                    const char  *s1,
+                    const char  *s2,
+                    const int   **access_s1,
+                    const int   **access_s2,
+                    const int   threshold,
+                    const int   alignment_length,
+                    const int   delta,
+                    const int   fast,
+                    const int   il_a,
+                    const int   il_b,
+                    const int   b_a,
+                    const int   b_b)
 {
   /**
   *** See variable definition in fduplexfold_XS
@@ -2041,265 +2129,283 @@ Lduplexfold_XS(const char *s1,
         SA[(j * 30) + 2 + 25] = SA[(j * 30) + 3 + 25] = SA[(j * 30) + 4 + 25] = INF;
   }
 
-  i         = 10;
-  i_length  = n1 - 9;
-  while (i < i_length) {
-    int di1, di2, di3, di4;
-    int idx   = i % 5;
-    int idx_1 = (i - 1) % 5;
-    int idx_2 = (i - 2) % 5;
-    int idx_3 = (i - 3) % 5;
-    int idx_4 = (i - 4) % 5;
-    di1 = 0.5 * (access_s1[5][i + 4] - access_s1[4][i + 4] + access_s1[5][i] - access_s1[4][i - 1]);
-    di2 = 0.5 *
-          (access_s1[5][i + 3] - access_s1[4][i + 3] + access_s1[5][i - 1] - access_s1[4][i - 2]) +
-          di1;
-    di3 = 0.5 *
-          (access_s1[5][i + 2] - access_s1[4][i + 2] + access_s1[5][i - 2] - access_s1[4][i - 3]) +
-          di2;
-    di4 = 0.5 *
-          (access_s1[5][i + 1] - access_s1[4][i + 1] + access_s1[5][i - 3] - access_s1[4][i - 4]) +
-          di3;
-    /*
-     *  di1 = access_s1[5][i]   - access_s1[4][i-1];
-     *  di2 = access_s1[5][i-1] - access_s1[4][i-2] + di1;
-     *  di3 = access_s1[5][i-2] - access_s1[4][i-3] + di2;
-     *  di4 = access_s1[5][i-3] - access_s1[4][i-4] + di3;
-     *  di1=MIN2(di1,maxPenalty[0]);
-     *  di2=MIN2(di2,maxPenalty[1]);
-     *  di3=MIN2(di3,maxPenalty[2]);
-     *  di4=MIN2(di4,maxPenalty[3]);
-     */
-    j = n2 - 9;
-    while (--j > 9) {
-      int dj1, dj2, dj3, dj4;
-      dj1 = DJ[0][j];
-      dj2 = DJ[1][j];
-      dj3 = DJ[2][j];
-      dj4 = DJ[3][j];
-      int type2, type, temp;
-      type = pair[S1[i]][S2[j]];
-      /**
-      *** Start duplex
-      **/
-      /* SA[LCI(idx,j,n2)] = type ? P->DuplexInit + access_s1[1][i] + access_s2[1][j] : INF; */
-      SA[LCI(idx, j, n2)] = type ? P->DuplexInit : INF;
-      /**
-      *** update lin bx by linx liny matrix
-      **/
-      type2 = pair[S2[j + 1]][S1[i - 1]];
-      /**
-      *** start/extend interior loop
-      **/
-      SA[LINI(idx, j, n2)] = MIN2(SA[LCI(idx_1, j + 1,
-                                         n2)] + P->mismatchI[type2][SS2[j]][SS1[i]] + di1 + dj1 + iopen + iext_s,
-                                  SA[LINI(idx_1, j, n2)] + iext_ass + di1);
+  if (!scan_tables(s2,
+                   SA,
+                   access_s1,
+                   DJ,
+                   0,
+                   iopen,
+                   iext_s,
+                   iext_ass,
+                   bopen,
+                   bext,
+                   delta,
+                   position,
+                   position_j,
+                   &max,
+                   &max_pos,
+                   &max_pos_j)) {
+    i         = 10;
+    i_length  = n1 - 9;
+    while (i < i_length) {
+      int di1, di2, di3, di4;
+      int idx   = i % 5;
+      int idx_1 = (i - 1) % 5;
+      int idx_2 = (i - 2) % 5;
+      int idx_3 = (i - 3) % 5;
+      int idx_4 = (i - 4) % 5;
+      di1 = 0.5 * (access_s1[5][i + 4] - access_s1[4][i + 4] + access_s1[5][i] - access_s1[4][i - 1]);
+      di2 = 0.5 *
+            (access_s1[5][i + 3] - access_s1[4][i + 3] + access_s1[5][i - 1] - access_s1[4][i - 2]) +
+            di1;
+      di3 = 0.5 *
+            (access_s1[5][i + 2] - access_s1[4][i + 2] + access_s1[5][i - 2] - access_s1[4][i - 3]) +
+            di2;
+      di4 = 0.5 *
+            (access_s1[5][i + 1] - access_s1[4][i + 1] + access_s1[5][i - 3] - access_s1[4][i - 4]) +
+            di3;
+      /*
+       *  di1 = access_s1[5][i]   - access_s1[4][i-1];
+       *  di2 = access_s1[5][i-1] - access_s1[4][i-2] + di1;
+       *  di3 = access_s1[5][i-2] - access_s1[4][i-3] + di2;
+       *  di4 = access_s1[5][i-3] - access_s1[4][i-4] + di3;
+       *  di1=MIN2(di1,maxPenalty[0]);
+       *  di2=MIN2(di2,maxPenalty[1]);
+       *  di3=MIN2(di3,maxPenalty[2]);
+       *  di4=MIN2(di4,maxPenalty[3]);
+       */
+      j = n2 - 9;
+      while (--j > 9) {
+        int dj1, dj2, dj3, dj4;
+        dj1 = DJ[0][j];
+        dj2 = DJ[1][j];
+        dj3 = DJ[2][j];
+        dj4 = DJ[3][j];
+        int type2, type, temp;
+        type = pair[S1[i]][S2[j]];
+        /**
+        *** Start duplex
+        **/
+        /* SA[LCI(idx,j,n2)] = type ? P->DuplexInit + access_s1[1][i] + access_s2[1][j] : INF; */
+        SA[LCI(idx, j, n2)] = type ? P->DuplexInit : INF;
+        /**
+        *** update lin bx by linx liny matrix
+        **/
+        type2 = pair[S2[j + 1]][S1[i - 1]];
+        /**
+        *** start/extend interior loop
+        **/
+        SA[LINI(idx, j, n2)] = MIN2(SA[LCI(idx_1, j + 1,
+                                           n2)] + P->mismatchI[type2][SS2[j]][SS1[i]] + di1 + dj1 + iopen + iext_s,
+                                    SA[LINI(idx_1, j, n2)] + iext_ass + di1);
+
+        /**
+        *** start/extend nx1 target
+        *** use same type2 as for in
+        **/
+        SA[LINIX(idx, j, n2)] = MIN2(SA[LCI(idx_1, j + 1,
+                                            n2)] + P->mismatch1nI[type2][SS2[j]][SS1[i]] + di1 + dj1 + iopen + iext_s,
+                                     SA[LINIX(idx_1, j, n2)] + iext_ass + di1);
+        /**
+        *** start/extend 1xn target
+        *** use same type2 as for in
+        **/
+        SA[LINIY(idx, j, n2)] = MIN2(SA[LCI(idx_1, j + 1,
+                                            n2)] + P->mismatch1nI[type2][SS2[j]][SS1[i]] + di1 + dj1 + iopen + iext_s,
+                                     SA[LINIY(idx, j + 1, n2)] + iext_ass + dj1);
+        /**
+        *** extend interior loop
+        **/
+        SA[LINI(idx, j, n2)]  = MIN2(SA[LINI(idx, j, n2)], SA[LINI(idx, j + 1, n2)] + iext_ass + dj1);
+        SA[LINI(idx, j, n2)]  = MIN2(SA[LINI(idx, j, n2)],
+                                     SA[LINI(idx_1, j + 1, n2)] + iext_s + di1 + dj1);
+        /**
+        *** start/extend bulge target
+        **/
+        type2                 = pair[S2[j]][S1[i - 1]];
+        SA[LBXI(idx, j, n2)]  = MIN2(SA[LBXI(idx_1, j, n2)] + bext + di1,
+                                     SA[LCI(idx_1, j,
+                                            n2)] + bopen + bext +
+                                     (type2 > 2 ? P->TerminalAU : 0) + di1);
+        /**
+        *** start/extend bulge query
+        **/
+        type2                 = pair[S2[j + 1]][S1[i]];
+        SA[LBYI(idx, j, n2)]  = MIN2(SA[LBYI(idx, j + 1, n2)] + bext + dj1,
+                                     SA[LCI(idx, j + 1,
+                                            n2)] + bopen + bext +
+                                     (type2 > 2 ? P->TerminalAU : 0) + dj1);
+        /**
+         ***end update recursion
+         **/
+        if (!type)
+          continue; /**
+                    *** stack extension
+                    **/
+
+        SA[LCI(idx, j, n2)] += E_ExtLoop(type, SS1[i - 1], SS2[j + 1], P);
+        /**
+        *** stack extension
+        **/
+        if ((type2 = pair[S1[i - 1]][S2[j + 1]]))
+          SA[LCI(idx, j, n2)] = MIN2(SA[LCI(idx_1, j + 1,
+                                            n2)] + P->stack[rtype[type]][type2] + di1 + dj1,
+                                     SA[LCI(idx, j, n2)]);
+
+        /**
+        *** 1x0 / 0x1 stack extension
+        **/
+        if ((type2 = pair[S1[i - 1]][S2[j + 2]])) {
+          SA[LCI(idx, j,
+                 n2)] = MIN2(SA[LCI(idx_1, j + 2,
+                                    n2)] + P->bulge[1] + P->stack[rtype[type]][type2] + di1 + dj2,
+                             SA[LCI(idx, j, n2)]);
+        }
 
-      /**
-      *** start/extend nx1 target
-      *** use same type2 as for in
-      **/
-      SA[LINIX(idx, j, n2)] = MIN2(SA[LCI(idx_1, j + 1,
-                                          n2)] + P->mismatch1nI[type2][SS2[j]][SS1[i]] + di1 + dj1 + iopen + iext_s,
-                                   SA[LINIX(idx_1, j, n2)] + iext_ass + di1);
-      /**
-      *** start/extend 1xn target
-      *** use same type2 as for in
-      **/
-      SA[LINIY(idx, j, n2)] = MIN2(SA[LCI(idx_1, j + 1,
-                                          n2)] + P->mismatch1nI[type2][SS2[j]][SS1[i]] + di1 + dj1 + iopen + iext_s,
-                                   SA[LINIY(idx, j + 1, n2)] + iext_ass + dj1);
-      /**
-      *** extend interior loop
-      **/
-      SA[LINI(idx, j, n2)]  = MIN2(SA[LINI(idx, j, n2)], SA[LINI(idx, j + 1, n2)] + iext_ass + dj1);
-      SA[LINI(idx, j, n2)]  = MIN2(SA[LINI(idx, j, n2)],
-                                   SA[LINI(idx_1, j + 1, n2)] + iext_s + di1 + dj1);
-      /**
-      *** start/extend bulge target
-      **/
-      type2                 = pair[S2[j]][S1[i - 1]];
-      SA[LBXI(idx, j, n2)]  = MIN2(SA[LBXI(idx_1, j, n2)] + bext + di1,
-                                   SA[LCI(idx_1, j,
-                                          n2)] + bopen + bext +
-                                   (type2 > 2 ? P->TerminalAU : 0) + di1);
-      /**
-      *** start/extend bulge query
-      **/
-      type2                 = pair[S2[j + 1]][S1[i]];
-      SA[LBYI(idx, j, n2)]  = MIN2(SA[LBYI(idx, j + 1, n2)] + bext + dj1,
-                                   SA[LCI(idx, j + 1,
-                                          n2)] + bopen + bext +
-                                   (type2 > 2 ? P->TerminalAU : 0) + dj1);
-      /**
-       ***end update recursion
-       **/
-      if (!type)
-        continue; /**
-                  *** stack extension
-                  **/
+        if ((type2 = pair[S1[i - 2]][S2[j + 1]])) {
+          SA[LCI(idx, j,
+                 n2)] = MIN2(SA[LCI(idx_2, j + 1,
+                                    n2)] + P->bulge[1] + P->stack[type2][rtype[type]] + di2 + dj1,
+                             SA[LCI(idx, j, n2)]);
+        }
 
-      SA[LCI(idx, j, n2)] += E_ExtLoop(type, SS1[i - 1], SS2[j + 1], P);
-      /**
-      *** stack extension
-      **/
-      if ((type2 = pair[S1[i - 1]][S2[j + 1]]))
-        SA[LCI(idx, j, n2)] = MIN2(SA[LCI(idx_1, j + 1,
-                                          n2)] + P->stack[rtype[type]][type2] + di1 + dj1,
-                                   SA[LCI(idx, j, n2)]);
+        /**
+        *** 1x1 / 2x2 stack extension
+        **/
+        if ((type2 = pair[S1[i - 2]][S2[j + 2]])) {
+          SA[LCI(idx, j,
+                 n2)] = MIN2(SA[LCI(idx_2, j + 2,
+                                    n2)] + P->int11[type2][rtype[type]][SS1[i - 1]][SS2[j + 1]] + di2 + dj2,
+                             SA[LCI(idx, j, n2)]);
+        }
 
-      /**
-      *** 1x0 / 0x1 stack extension
-      **/
-      if ((type2 = pair[S1[i - 1]][S2[j + 2]])) {
-        SA[LCI(idx, j,
-               n2)] = MIN2(SA[LCI(idx_1, j + 2,
-                                  n2)] + P->bulge[1] + P->stack[rtype[type]][type2] + di1 + dj2,
-                           SA[LCI(idx, j, n2)]);
-      }
+        if ((type2 = pair[S1[i - 3]][S2[j + 3]])) {
+          SA[LCI(idx, j,
+                 n2)] = MIN2(SA[LCI(idx_3, j + 3,
+                                    n2)] +
+                             P->int22[type2][rtype[type]][SS1[i - 2]][SS1[i - 1]][SS2[j + 1]][SS2[j +
+                                                                                                  2]] + di3 + dj3,
+                             SA[LCI(idx, j, n2)]);
+        }
+
+        /**
+        *** 1x2 / 2x1 stack extension
+        *** E_IntLoop(1,2,type2, rtype[type],SS1[i-1], SS2[j+2], SS1[i-1], SS2[j+1], P) corresponds to
+        *** P->int21[rtype[type]][type2][SS2[j+2]][SS1[i-1]][SS1[i-1]]
+        **/
+        if ((type2 = pair[S1[i - 3]][S2[j + 2]])) {
+          SA[LCI(idx, j,
+                 n2)] = MIN2(SA[LCI(idx_3, j + 2,
+                                    n2)] +
+                             P->int21[rtype[type]][type2][SS2[j + 1]][SS1[i - 2]][SS1[i - 1]] + di3 + dj2,
+                             SA[LCI(idx, j, n2)]);
+        }
+
+        if ((type2 = pair[S1[i - 2]][S2[j + 3]])) {
+          SA[LCI(idx, j,
+                 n2)] = MIN2(SA[LCI(idx_2, j + 3,
+                                    n2)] +
+                             P->int21[type2][rtype[type]][SS1[i - 1]][SS2[j + 1]][SS2[j + 2]] + di2 + dj3,
+                             SA[LCI(idx, j, n2)]);
+        }
 
-      if ((type2 = pair[S1[i - 2]][S2[j + 1]])) {
+        /**
+        *** 2x3 / 3x2 stack extension
+        **/
+        if ((type2 = pair[S1[i - 4]][S2[j + 3]])) {
+          SA[LCI(idx, j, n2)] = MIN2(SA[LCI(idx_4, j + 3, n2)] + P->internal_loop[5] + P->ninio[2] +
+                                     P->mismatch23I[type2][SS1[i - 3]][SS2[j + 2]] +
+                                     P->mismatch23I[rtype[type]][SS2[j + 1]][SS1[i - 1]] + di4 + dj3,
+                                     SA[LCI(idx, j, n2)]);
+        }
+
+        if ((type2 = pair[S1[i - 3]][S2[j + 4]])) {
+          SA[LCI(idx, j, n2)] = MIN2(SA[LCI(idx_3, j + 4, n2)] + P->internal_loop[5] + P->ninio[2] +
+                                     P->mismatch23I[type2][SS1[i - 2]][SS2[j + 3]] +
+                                     P->mismatch23I[rtype[type]][SS2[j + 1]][SS1[i - 1]] + di3 + dj4,
+                                     SA[LCI(idx, j, n2)]);
+        }
+
+        /**
+        *** So now we have to handle 1x3, 3x1, 3x3, and mxn m,n > 3
+        **/
+        /**
+        *** 3x3 or more
+        **/
         SA[LCI(idx, j,
-               n2)] = MIN2(SA[LCI(idx_2, j + 1,
-                                  n2)] + P->bulge[1] + P->stack[type2][rtype[type]] + di2 + dj1,
+               n2)] = MIN2(SA[LINI(idx_3, j + 3,
+                                   n2)] + P->mismatchI[rtype[type]][SS1[i - 1]][SS2[j + 1]] + 2 * iext_s + di3 + dj3,
                            SA[LCI(idx, j, n2)]);
-      }
-
-      /**
-      *** 1x1 / 2x2 stack extension
-      **/
-      if ((type2 = pair[S1[i - 2]][S2[j + 2]])) {
+        /**
+        *** 2xn or more
+        **/
         SA[LCI(idx, j,
-               n2)] = MIN2(SA[LCI(idx_2, j + 2,
-                                  n2)] + P->int11[type2][rtype[type]][SS1[i - 1]][SS2[j + 1]] + di2 + dj2,
+               n2)] = MIN2(SA[LINI(idx_4, j + 2,
+                                   n2)] + P->mismatchI[rtype[type]][SS1[i - 1]][SS2[j + 1]] + iext_s + 2 * iext_ass + di4 + dj2,
                            SA[LCI(idx, j, n2)]);
-      }
-
-      if ((type2 = pair[S1[i - 3]][S2[j + 3]])) {
+        /**
+        *** nx2 or more
+        **/
         SA[LCI(idx, j,
-               n2)] = MIN2(SA[LCI(idx_3, j + 3,
-                                  n2)] +
-                           P->int22[type2][rtype[type]][SS1[i - 2]][SS1[i - 1]][SS2[j + 1]][SS2[j +
-                                                                                                2]] + di3 + dj3,
+               n2)] = MIN2(SA[LINI(idx_2, j + 4,
+                                   n2)] + P->mismatchI[rtype[type]][SS1[i - 1]][SS2[j + 1]] + iext_s + 2 * iext_ass + di2 + dj4,
                            SA[LCI(idx, j, n2)]);
-      }
-
-      /**
-      *** 1x2 / 2x1 stack extension
-      *** E_IntLoop(1,2,type2, rtype[type],SS1[i-1], SS2[j+2], SS1[i-1], SS2[j+1], P) corresponds to
-      *** P->int21[rtype[type]][type2][SS2[j+2]][SS1[i-1]][SS1[i-1]]
-      **/
-      if ((type2 = pair[S1[i - 3]][S2[j + 2]])) {
+        /**
+        *** nx1 n>2
+        **/
         SA[LCI(idx, j,
-               n2)] = MIN2(SA[LCI(idx_3, j + 2,
-                                  n2)] +
-                           P->int21[rtype[type]][type2][SS2[j + 1]][SS1[i - 2]][SS1[i - 1]] + di3 + dj2,
+               n2)] = MIN2(SA[LINIX(idx_3, j + 1,
+                                    n2)] + P->mismatch1nI[rtype[type]][SS1[i - 1]][SS2[j + 1]] + iext_ass + iext_ass + di3 + dj1,
                            SA[LCI(idx, j, n2)]);
-      }
-
-      if ((type2 = pair[S1[i - 2]][S2[j + 3]])) {
+        /**
+        *** 1xn n>2
+        **/
         SA[LCI(idx, j,
-               n2)] = MIN2(SA[LCI(idx_2, j + 3,
-                                  n2)] +
-                           P->int21[type2][rtype[type]][SS1[i - 1]][SS2[j + 1]][SS2[j + 2]] + di2 + dj3,
+               n2)] = MIN2(SA[LINIY(idx_1, j + 3,
+                                    n2)] + P->mismatch1nI[rtype[type]][SS1[i - 1]][SS2[j + 1]] + iext_ass + iext_ass + dj3 + di1,
                            SA[LCI(idx, j, n2)]);
+        /**
+        *** nx0 n>1
+        **/
+        int bAU;
+        bAU = (type > 2 ? P->TerminalAU : 0);
+        SA[LCI(idx, j,
+               n2)] = MIN2(SA[LBXI(idx_2, j + 1, n2)] + di2 + dj1 + bext + bAU, SA[LCI(idx, j, n2)]);
+        /**
+        *** 0xn n>1
+        **/
+        SA[LCI(idx, j,
+               n2)] = MIN2(SA[LBYI(idx_1, j + 2, n2)] + di1 + dj2 + bext + bAU, SA[LCI(idx, j, n2)]);
+        temp        = min_colonne;
+        /**
+        *** (type>2?P->TerminalAU:0)+
+        *** P->dangle3[rtype[type]][SS1[i+1]]+
+        *** P->dangle5[rtype[type]][SS2[j-1]],
+        **/
+        /* remove this line printf("LCI %d:%d %d\t",i,j,SA[LCI(idx,j,n2)]); */
+        /* remove this line printf("LI %d:%d %d\t",i,j, SA[LINI(idx,j,n2)]); */
+        min_colonne = MIN2(SA[LCI(idx, j, n2)] + E_ExtLoop(rtype[type], SS2[j - 1], SS1[i + 1], P),
+                           min_colonne);
+
+        if (temp > min_colonne)
+          min_j_colonne = j;
+
+        /* ---------------------------------------------------------------------end update */
       }
-
-      /**
-      *** 2x3 / 3x2 stack extension
-      **/
-      if ((type2 = pair[S1[i - 4]][S2[j + 3]])) {
-        SA[LCI(idx, j, n2)] = MIN2(SA[LCI(idx_4, j + 3, n2)] + P->internal_loop[5] + P->ninio[2] +
-                                   P->mismatch23I[type2][SS1[i - 3]][SS2[j + 2]] +
-                                   P->mismatch23I[rtype[type]][SS2[j + 1]][SS1[i - 1]] + di4 + dj3,
-                                   SA[LCI(idx, j, n2)]);
-      }
-
-      if ((type2 = pair[S1[i - 3]][S2[j + 4]])) {
-        SA[LCI(idx, j, n2)] = MIN2(SA[LCI(idx_3, j + 4, n2)] + P->internal_loop[5] + P->ninio[2] +
-                                   P->mismatch23I[type2][SS1[i - 2]][SS2[j + 3]] +
-                                   P->mismatch23I[rtype[type]][SS2[j + 1]][SS1[i - 1]] + di3 + dj4,
-                                   SA[LCI(idx, j, n2)]);
+      if (max >= min_colonne) {
+        max       = min_colonne;
+        max_pos   = i;
+        max_pos_j = min_j_colonne;
       }
 
-      /**
-      *** So now we have to handle 1x3, 3x1, 3x3, and mxn m,n > 3
-      **/
-      /**
-      *** 3x3 or more
-      **/
-      SA[LCI(idx, j,
-             n2)] = MIN2(SA[LINI(idx_3, j + 3,
-                                 n2)] + P->mismatchI[rtype[type]][SS1[i - 1]][SS2[j + 1]] + 2 * iext_s + di3 + dj3,
-                         SA[LCI(idx, j, n2)]);
-      /**
-      *** 2xn or more
-      **/
-      SA[LCI(idx, j,
-             n2)] = MIN2(SA[LINI(idx_4, j + 2,
-                                 n2)] + P->mismatchI[rtype[type]][SS1[i - 1]][SS2[j + 1]] + iext_s + 2 * iext_ass + di4 + dj2,
-                         SA[LCI(idx, j, n2)]);
-      /**
-      *** nx2 or more
-      **/
-      SA[LCI(idx, j,
-             n2)] = MIN2(SA[LINI(idx_2, j + 4,
-                                 n2)] + P->mismatchI[rtype[type]][SS1[i - 1]][SS2[j + 1]] + iext_s + 2 * iext_ass + di2 + dj4,
-                         SA[LCI(idx, j, n2)]);
-      /**
-      *** nx1 n>2
-      **/
-      SA[LCI(idx, j,
-             n2)] = MIN2(SA[LINIX(idx_3, j + 1,
-                                  n2)] + P->mismatch1nI[rtype[type]][SS1[i - 1]][SS2[j + 1]] + iext_ass + iext_ass + di3 + dj1,
-                         SA[LCI(idx, j, n2)]);
-      /**
-      *** 1xn n>2
-      **/
-      SA[LCI(idx, j,
-             n2)] = MIN2(SA[LINIY(idx_1, j + 3,
-                                  n2)] + P->mismatch1nI[rtype[type]][SS1[i - 1]][SS2[j + 1]] + iext_ass + iext_ass + dj3 + di1,
-                         SA[LCI(idx, j, n2)]);
-      /**
-      *** nx0 n>1
-      **/
-      int bAU;
-      bAU = (type > 2 ? P->TerminalAU : 0);
-      SA[LCI(idx, j,
-             n2)] = MIN2(SA[LBXI(idx_2, j + 1, n2)] + di2 + dj1 + bext + bAU, SA[LCI(idx, j, n2)]);
-      /**
-      *** 0xn n>1
-      **/
-      SA[LCI(idx, j,
-             n2)] = MIN2(SA[LBYI(idx_1, j + 2, n2)] + di1 + dj2 + bext + bAU, SA[LCI(idx, j, n2)]);
-      temp        = min_colonne;
-      /**
-      *** (type>2?P->TerminalAU:0)+
-      *** P->dangle3[rtype[type]][SS1[i+1]]+
-      *** P->dangle5[rtype[type]][SS2[j-1]],
-      **/
-      /* remove this line printf("LCI %d:%d %d\t",i,j,SA[LCI(idx,j,n2)]); */
-      /* remove this line printf("LI %d:%d %d\t",i,j, SA[LINI(idx,j,n2)]); */
-      min_colonne = MIN2(SA[LCI(idx, j, n2)] + E_ExtLoop(rtype[type], SS2[j - 1], SS1[i + 1], P),
-                         min_colonne);
-
-      if (temp > min_colonne)
-        min_j_colonne = j;
-
-      /* ---------------------------------------------------------------------end update */
-    }
-    if (max >= min_colonne) {
-      max       = min_colonne;
-      max_pos   = i;
-      max_pos_j = min_j_colonne;
+      position[i + delta]   = min_colonne;
+      min_colonne           = INF;
+      position_j[i + delta] = min_j_colonne;
+      /* remove this line printf("\n"); */
+      i++;
     }
-
-    position[i + delta]   = min_colonne;
-    min_colonne           = INF;
-    position_j[i + delta] = min_j_colonne;
-    /* remove this line printf("\n"); */
-    i++;
   }
+
   /* printf("MAX: %d",max); */
   free(S1);
   free(S2);
@@ -2307,7 +2413,8 @@ Lduplexfold_XS(const char *s1,
   free(SS2);
   free(SA);
   if (max < threshold) {
-    find_max_XS(position,
+    find_max_XS(output,
+                position,
                 position_j,
                 delta,
                 threshold,
@@ -2324,7 +2431,8 @@ Lduplexfold_XS(const char *s1,
   }
 
   if (max < INF) {
-    plot_max_XS(max,
+    plot_max_XS(output,
+                max,
                 max_pos,
                 max_pos_j,
                 alignment_length,
@@ -2349,7 +2457,8 @@ Lduplexfold_XS(const char *s1,
 
 
 PRIVATE void
-find_max_XS(const int   *position,
+find_max_XS(vrna_cstr_t output,
+            const int   *position,
             const int   *position_j,
             const int   delta,
             const int   threshold,
@@ -2381,10 +2490,10 @@ find_max_XS(const int   *position,
         max_pos_j = position_j[pos + delta];
         int max;
         max = position[pos + delta];
-        printf("target upper bound %d: query lower bound %d  (%5.2f) \n",
-               pos - 10,
-               max_pos_j - 10,
-               ((double)max) / 100);
+        plex_printf(output, "target upper bound %d: query lower bound %d  (%5.2f) \n",
+                    pos - 10,
+                    max_pos_j - 10,
+                    ((double)max) / 100);
         pos = MAX2(10, pos + temp_min - delta);
       }
     }
@@ -2437,21 +2546,21 @@ find_max_XS(const int   *position,
                               b_b);
         if (test.energy * 100 < threshold) {
           int l1 = strchr(test.structure, '&') - test.structure;
-          printf(
-            " %s %3d,%-3d : %3d,%-3d (%5.2f = %5.2f + %5.2f + %5.2f) [%5.2f] i:%d,j:%d <%5.2f>\n",
-            test.structure,
-            begin_t - 10 + test.i - l1 - 10,
-            begin_t - 10 + test.i - 1 - 10,
-            begin_q - 10 + test.j - 1 - 10,
-            (begin_q - 11) + test.j + (int)strlen(test.structure) - l1 - 2 - 10,
-            test.ddG,
-            test.energy,
-            test.opening_backtrack_x,
-            test.opening_backtrack_y,
-            test.energy_backtrack,
-            pos - 10,
-            max_pos_j - 10,
-            ((double)position[pos + delta]) / 100);
+          plex_printf(output,
+                      " %s %3d,%-3d : %3d,%-3d (%5.2f = %5.2f + %5.2f + %5.2f) [%5.2f] i:%d,j:%d <%5.2f>\n",
+                      test.structure,
+                      begin_t - 10 + test.i - l1 - 10,
+                      begin_t - 10 + test.i - 1 - 10,
+                      begin_q - 10 + test.j - 1 - 10,
+                      (begin_q - 11) + test.j + (int)strlen(test.structure) - l1 - 2 - 10,
+                      test.ddG,
+                      test.energy,
+                      test.opening_backtrack_x,
+                      test.opening_backtrack_y,
+                      test.energy_backtrack,
+                      pos - 10,
+                      max_pos_j - 10,
+                      ((double)position[pos + delta]) / 100);
           pos = MAX2(10, pos + temp_min - delta);
           free(test.structure);
         }
@@ -2490,21 +2599,30 @@ find_max_XS(const int   *position,
         s4[end_q - begin_q + 1] = '\0';
         duplexT test;
         test =
-          duplexfold_XS(s3, s4, access_s1, access_s2, pos, max_pos_j, threshold, i_flag, j_flag);
+          duplexfold_XS(output,
+                        s3,
+                        s4,
+                        access_s1,
+                        access_s2,
+                        pos,
+                        max_pos_j,
+                        threshold,
+                        i_flag,
+                        j_flag);
         if (test.energy * 100 < threshold) {
-          printf("%s %3d,%-3d : %3d,%-3d (%5.2f = %5.2f + %5.2f + %5.2f) i:%d,j:%d <%5.2f>\n",
-                 test.structure,
-                 test.tb,
-                 test.te,
-                 test.qb,
-                 test.qe,
-                 test.ddG,
-                 test.energy,
-                 test.dG1,
-                 test.dG2,
-                 pos - 10,
-                 max_pos_j - 10,
-                 ((double)position[pos + delta]) / 100);
+          plex_printf(output, "%s %3d,%-3d : %3d,%-3d (%5.2f = %5.2f + %5.2f + %5.2f) i:%d,j:%d <%5.2f>\n",
+                      test.structure,
+                      test.tb,
+                      test.te,
+                      test.qb,
+                      test.qe,
+                      test.ddG,
+                      test.energy,
+                      test.dG1,
+                      test.dG2,
+                      pos - 10,
+                      max_pos_j - 10,
+                      ((double)position[pos + delta]) / 100);
           pos = MAX2(10, pos + temp_min - delta);
         }
 
@@ -2541,7 +2659,8 @@ compare(const void  *sub1,
 #endif
 
 PRIVATE void
-plot_max_XS(const int   max,
+plot_max_XS(vrna_cstr_t output,
+            const int   max,
             const int   max_pos,
             const int   max_pos_j,
             const int   alignment_length,
@@ -2556,8 +2675,8 @@ plot_max_XS(const int   max,
             const int   b_b)
 {
   if (fast == 1) {
-    printf("target upper bound %d: query lower bound %d (%5.2f)\n", max_pos - 3, max_pos_j,
-           ((double)max) / 100);
+    plex_printf(output, "target upper bound %d: query lower bound %d (%5.2f)\n", max_pos - 3, max_pos_j,
+                ((double)max) / 100);
   } else if (fast == 2) {
     int   alignment_length2;
     alignment_length2 = MIN2(n1, n2);
@@ -2578,20 +2697,20 @@ plot_max_XS(const int   max,
     duplexT test;
     test = fduplexfold_XS(s3, s4, access_s1, access_s2, end_t, begin_q, INF, il_a, il_b, b_a, b_b);
     int     l1 = strchr(test.structure, '&') - test.structure;
-    printf("%s %3d,%-3d : %3d,%-3d (%5.2f = %5.2f + %5.2f + %5.2f) [%5.2f] i:%d,j:%d <%5.2f>\n",
-           test.structure,
-           begin_t - 10 + test.i - l1 - 10,
-           begin_t - 10 + test.i - 1 - 10,
-           begin_q - 10 + test.j - 1 - 10,
-           (begin_q - 11) + test.j + (int)strlen(test.structure) - l1 - 2 - 10,
-           test.ddG,
-           test.energy,
-           test.opening_backtrack_x,
-           test.opening_backtrack_y,
-           test.energy_backtrack,
-           max_pos - 10,
-           max_pos_j - 10,
-           (double)max / 100);
+    plex_printf(output, "%s %3d,%-3d : %3d,%-3d (%5.2f = %5.2f + %5.2f + %5.2f) [%5.2f] i:%d,j:%d <%5.2f>\n",
+                test.structure,
+                begin_t - 10 + test.i - l1 - 10,
+                begin_t - 10 + test.i - 1 - 10,
+                begin_q - 10 + test.j - 1 - 10,
+                (begin_q - 11) + test.j + (int)strlen(test.structure) - l1 - 2 - 10,
+                test.ddG,
+                test.energy,
+                test.opening_backtrack_x,
+                test.opening_backtrack_y,
+                test.energy_backtrack,
+                max_pos - 10,
+                max_pos_j - 10,
+                (double)max / 100);
 
     free(s3);
     free(s4);
@@ -2613,20 +2732,29 @@ plot_max_XS(const int   max,
     s3[end_t - begin_t + 1] = '\0';                       /*  */
     s4[end_q - begin_q + 1] = '\0';
     duplexT test;
-    test = duplexfold_XS(s3, s4, access_s1, access_s2, max_pos, max_pos_j, INF, i_flag, j_flag);
-    printf("%s %3d,%-3d : %3d,%-3d (%5.2f = %5.2f + %5.2f + %5.2f) i:%d,j:%d <%5.2f>\n",
-           test.structure,
-           test.tb,
-           test.te,
-           test.qb,
-           test.qe,
-           test.ddG,
-           test.energy,
-           test.dG1,
-           test.dG2,
-           max_pos - 10,
-           max_pos_j - 10,
-           (double)max / 100);
+    test = duplexfold_XS(output,
+                         s3,
+                         s4,
+                         access_s1,
+                         access_s2,
+                         max_pos,
+                         max_pos_j,
+                         INF,
+                         i_flag,
+                         j_flag);
+    plex_printf(output, "%s %3d,%-3d : %3d,%-3d (%5.2f = %5.2f + %5.2f + %5.2f) i:%d,j:%d <%5.2f>\n",
+                test.structure,
+                test.tb,
+                test.te,
+                test.qb,
+                test.qe,
+                test.ddG,
+                test.energy,
+                test.dG1,
+                test.dG2,
+                max_pos - 10,
+                max_pos_j - 10,
+                (double)max / 100);
     free(s3);
     free(s4);
     free(test.structure);
@@ -3837,230 +3965,248 @@ Lduplexfold(const char  *s1,
          25]                  =
         SA[(j * 30) + 2 + 25] = SA[(j * 30) + 3 + 25] = SA[(j * 30) + 4 + 25] = INF;
   }
-  i         = 10;
-  i_length  = n1 - 9;
-  while (i < i_length) {
-    int idx   = i % 5;
-    int idx_1 = (i - 1) % 5;
-    int idx_2 = (i - 2) % 5;
-    int idx_3 = (i - 3) % 5;
-    int idx_4 = (i - 4) % 5;
-    j = n2 - 9;
-    while (9 < --j) {
-      int type, type2;
-      type = pair[S1[i]][S2[j]];
-      /**
-      *** Start duplex
-      **/
-      SA[LCI(idx, j, n2)] = type ? P->DuplexInit + 2 * extension_cost : INF;
-      /**
-      *** update lin bx by linx liny matrix
-      **/
-      type2 = pair[S2[j + 1]][S1[i - 1]];
-      /**
-      *** start/extend interior loop
-      **/
-      SA[LINI(idx, j, n2)] = MIN2(SA[LCI(idx_1, j + 1,
-                                         n2)] + P->mismatchI[type2][SS2[j]][SS1[i]] + iopen + iext_s,
-                                  SA[LINI(idx_1, j, n2)] + iext_ass);
-      /**
-      *** start/extend nx1 target
-      *** use same type2 as for in
-      **/
-      SA[LINIX(idx, j, n2)] = MIN2(SA[LCI(idx_1, j + 1,
-                                          n2)] + P->mismatch1nI[type2][SS2[j]][SS1[i]] + iopen + iext_s,
-                                   SA[LINIX(idx_1, j, n2)] + iext_ass);
-      /**
-      *** start/extend 1xn target
-      *** use same type2 as for in
-      **/
-      SA[LINIY(idx, j, n2)] = MIN2(SA[LCI(idx_1, j + 1,
-                                          n2)] + P->mismatch1nI[type2][SS2[j]][SS1[i]] + iopen + iext_s,
-                                   SA[LINIY(idx, j + 1, n2)] + iext_ass);
-      /**
-      *** extend interior loop
-      **/
-      SA[LINI(idx, j, n2)]  = MIN2(SA[LINI(idx, j, n2)], SA[LINI(idx, j + 1, n2)] + iext_ass);
-      SA[LINI(idx, j, n2)]  = MIN2(SA[LINI(idx, j, n2)], SA[LINI(idx_1, j + 1, n2)] + iext_s);
-      /**
-      *** start/extend bulge target
-      **/
-      type2                 = pair[S2[j]][S1[i - 1]];
-      SA[LBXI(idx, j, n2)]  = MIN2(SA[LBXI(idx_1, j, n2)] + bext,
-                                   SA[LCI(idx_1, j,
-                                          n2)] + bopen + bext + (type2 > 2 ? P->TerminalAU : 0));
-      /**
-      *** start/extend bulge query
-      **/
-      type2                 = pair[S2[j + 1]][S1[i]];
-      SA[LBYI(idx, j, n2)]  = MIN2(SA[LBYI(idx, j + 1, n2)] + bext,
-                                   SA[LCI(idx, j + 1,
-                                          n2)] + bopen + bext + (type2 > 2 ? P->TerminalAU : 0));
-      /**
-       ***end update recursion
-       ***##################### Start stack extension ######################
-       **/
-      if (!type)
-        continue; /**
-                  *** stack extension
-                  **/
+  if (!scan_tables(s2,
+                   SA,
+                   NULL,
+                   NULL,
+                   extension_cost,
+                   iopen,
+                   iext_s,
+                   iext_ass,
+                   bopen,
+                   bext,
+                   delta,
+                   position,
+                   position_j,
+                   &max,
+                   &max_pos,
+                   &max_pos_j)) {
+    i         = 10;
+    i_length  = n1 - 9;
+    while (i < i_length) {
+      int idx   = i % 5;
+      int idx_1 = (i - 1) % 5;
+      int idx_2 = (i - 2) % 5;
+      int idx_3 = (i - 3) % 5;
+      int idx_4 = (i - 4) % 5;
+      j = n2 - 9;
+      while (9 < --j) {
+        int type, type2;
+        type = pair[S1[i]][S2[j]];
+        /**
+        *** Start duplex
+        **/
+        SA[LCI(idx, j, n2)] = type ? P->DuplexInit + 2 * extension_cost : INF;
+        /**
+        *** update lin bx by linx liny matrix
+        **/
+        type2 = pair[S2[j + 1]][S1[i - 1]];
+        /**
+        *** start/extend interior loop
+        **/
+        SA[LINI(idx, j, n2)] = MIN2(SA[LCI(idx_1, j + 1,
+                                           n2)] + P->mismatchI[type2][SS2[j]][SS1[i]] + iopen + iext_s,
+                                    SA[LINI(idx_1, j, n2)] + iext_ass);
+        /**
+        *** start/extend nx1 target
+        *** use same type2 as for in
+        **/
+        SA[LINIX(idx, j, n2)] = MIN2(SA[LCI(idx_1, j + 1,
+                                            n2)] + P->mismatch1nI[type2][SS2[j]][SS1[i]] + iopen + iext_s,
+                                     SA[LINIX(idx_1, j, n2)] + iext_ass);
+        /**
+        *** start/extend 1xn target
+        *** use same type2 as for in
+        **/
+        SA[LINIY(idx, j, n2)] = MIN2(SA[LCI(idx_1, j + 1,
+                                            n2)] + P->mismatch1nI[type2][SS2[j]][SS1[i]] + iopen + iext_s,
+                                     SA[LINIY(idx, j + 1, n2)] + iext_ass);
+        /**
+        *** extend interior loop
+        **/
+        SA[LINI(idx, j, n2)]  = MIN2(SA[LINI(idx, j, n2)], SA[LINI(idx, j + 1, n2)] + iext_ass);
+        SA[LINI(idx, j, n2)]  = MIN2(SA[LINI(idx, j, n2)], SA[LINI(idx_1, j + 1, n2)] + iext_s);
+        /**
+        *** start/extend bulge target
+        **/
+        type2                 = pair[S2[j]][S1[i - 1]];
+        SA[LBXI(idx, j, n2)]  = MIN2(SA[LBXI(idx_1, j, n2)] + bext,
+                                     SA[LCI(idx_1, j,
+                                            n2)] + bopen + bext + (type2 > 2 ? P->TerminalAU : 0));
+        /**
+        *** start/extend bulge query
+        **/
+        type2                 = pair[S2[j + 1]][S1[i]];
+        SA[LBYI(idx, j, n2)]  = MIN2(SA[LBYI(idx, j + 1, n2)] + bext,
+                                     SA[LCI(idx, j + 1,
+                                            n2)] + bopen + bext + (type2 > 2 ? P->TerminalAU : 0));
+        /**
+         ***end update recursion
+         ***##################### Start stack extension ######################
+         **/
+        if (!type)
+          continue; /**
+                    *** stack extension
+                    **/
+
+        SA[LCI(idx, j, n2)] += E_ExtLoop(type, SS1[i - 1], SS2[j + 1], P) + 2 * extension_cost;
+        /**
+        *** stack extension
+        **/
+        if ((type2 = pair[S1[i - 1]][S2[j + 1]]))
+          SA[LCI(idx, j, n2)] = MIN2(SA[LCI(idx_1, j + 1,
+                                            n2)] + P->stack[rtype[type]][type2] + 2 * extension_cost,
+                                     SA[LCI(idx, j, n2)]);
+
+        /**
+        *** 1x0 / 0x1 stack extension
+        **/
+        if ((type2 = pair[S1[i - 1]][S2[j + 2]])) {
+          SA[LCI(idx, j,
+                 n2)] = MIN2(SA[LCI(idx_1, j + 2,
+                                    n2)] + P->bulge[1] + P->stack[rtype[type]][type2] + 3 * extension_cost,
+                             SA[LCI(idx, j, n2)]);
+        }
 
-      SA[LCI(idx, j, n2)] += E_ExtLoop(type, SS1[i - 1], SS2[j + 1], P) + 2 * extension_cost;
-      /**
-      *** stack extension
-      **/
-      if ((type2 = pair[S1[i - 1]][S2[j + 1]]))
-        SA[LCI(idx, j, n2)] = MIN2(SA[LCI(idx_1, j + 1,
-                                          n2)] + P->stack[rtype[type]][type2] + 2 * extension_cost,
-                                   SA[LCI(idx, j, n2)]);
+        if ((type2 = pair[S1[i - 2]][S2[j + 1]])) {
+          SA[LCI(idx, j,
+                 n2)] = MIN2(SA[LCI(idx_2, j + 1,
+                                    n2)] + P->bulge[1] + P->stack[type2][rtype[type]] + 3 * extension_cost,
+                             SA[LCI(idx, j, n2)]);
+        }
 
-      /**
-      *** 1x0 / 0x1 stack extension
-      **/
-      if ((type2 = pair[S1[i - 1]][S2[j + 2]])) {
-        SA[LCI(idx, j,
-               n2)] = MIN2(SA[LCI(idx_1, j + 2,
-                                  n2)] + P->bulge[1] + P->stack[rtype[type]][type2] + 3 * extension_cost,
-                           SA[LCI(idx, j, n2)]);
-      }
+        /**
+        *** 1x1 / 2x2 stack extension
+        **/
+        if ((type2 = pair[S1[i - 2]][S2[j + 2]])) {
+          SA[LCI(idx, j,
+                 n2)] = MIN2(SA[LCI(idx_2, j + 2,
+                                    n2)] + P->int11[type2][rtype[type]][SS1[i - 1]][SS2[j + 1]] + 4 * extension_cost,
+                             SA[LCI(idx, j, n2)]);
+        }
+
+        if ((type2 = pair[S1[i - 3]][S2[j + 3]])) {
+          SA[LCI(idx, j,
+                 n2)] = MIN2(SA[LCI(idx_3, j + 3,
+                                    n2)] +
+                             P->int22[type2][rtype[type]][SS1[i - 2]][SS1[i - 1]][SS2[j + 1]][SS2[j +
+                                                                                                  2]] + 6 * extension_cost,
+                             SA[LCI(idx, j, n2)]);
+        }
+
+        /**
+        *** 1x2 / 2x1 stack extension
+        *** E_IntLoop(1,2,type2, rtype[type],SS1[i-1], SS2[j+2], SS1[i-1], SS2[j+1], P) corresponds to
+        *** P->int21[rtype[type]][type2][SS2[j+2]][SS1[i-1]][SS1[i-1]]
+        **/
+        if ((type2 = pair[S1[i - 3]][S2[j + 2]])) {
+          SA[LCI(idx, j,
+                 n2)] = MIN2(SA[LCI(idx_3, j + 2,
+                                    n2)] +
+                             P->int21[rtype[type]][type2][SS2[j + 1]][SS1[i - 2]][SS1[i - 1]] + 5 * extension_cost,
+                             SA[LCI(idx, j, n2)]);
+        }
+
+        if ((type2 = pair[S1[i - 2]][S2[j + 3]])) {
+          SA[LCI(idx, j,
+                 n2)] = MIN2(SA[LCI(idx_2, j + 3,
+                                    n2)] +
+                             P->int21[type2][rtype[type]][SS1[i - 1]][SS2[j + 1]][SS2[j + 2]] + 5 * extension_cost,
+                             SA[LCI(idx, j, n2)]);
+        }
+
+        /**
+        *** 2x3 / 3x2 stack extension
+        **/
+        if ((type2 = pair[S1[i - 4]][S2[j + 3]])) {
+          SA[LCI(idx, j, n2)] = MIN2(SA[LCI(idx_4, j + 3,
+                                            n2)] + P->internal_loop[5] + P->ninio[2] +
+                                     P->mismatch23I[type2][SS1[i - 3]][SS2[j + 2]] +
+                                     P->mismatch23I[rtype[type]][SS2[j + 1]][SS1[i - 1]] + 7 * extension_cost,
+                                     SA[LCI(idx, j, n2)]);
+        }
 
-      if ((type2 = pair[S1[i - 2]][S2[j + 1]])) {
+        if ((type2 = pair[S1[i - 3]][S2[j + 4]])) {
+          SA[LCI(idx, j, n2)] = MIN2(SA[LCI(idx_3, j + 4,
+                                            n2)] + P->internal_loop[5] + P->ninio[2] +
+                                     P->mismatch23I[type2][SS1[i - 2]][SS2[j + 3]] +
+                                     P->mismatch23I[rtype[type]][SS2[j + 1]][SS1[i - 1]] + 7 * extension_cost,
+                                     SA[LCI(idx, j, n2)]);
+        }
+
+        /**
+        *** So now we have to handle 1x3, 3x1, 3x3, and mxn m,n > 3
+        **/
+        /**
+        *** 3x3 or more
+        **/
         SA[LCI(idx, j,
-               n2)] = MIN2(SA[LCI(idx_2, j + 1,
-                                  n2)] + P->bulge[1] + P->stack[type2][rtype[type]] + 3 * extension_cost,
+               n2)] = MIN2(SA[LINI(idx_3, j + 3,
+                                   n2)] + P->mismatchI[rtype[type]][SS1[i - 1]][SS2[j + 1]] + 2 * iext_s + 2 * extension_cost,
                            SA[LCI(idx, j, n2)]);
-      }
-
-      /**
-      *** 1x1 / 2x2 stack extension
-      **/
-      if ((type2 = pair[S1[i - 2]][S2[j + 2]])) {
+        /**
+        *** 2xn or more
+        **/
         SA[LCI(idx, j,
-               n2)] = MIN2(SA[LCI(idx_2, j + 2,
-                                  n2)] + P->int11[type2][rtype[type]][SS1[i - 1]][SS2[j + 1]] + 4 * extension_cost,
+               n2)] = MIN2(SA[LINI(idx_4, j + 2,
+                                   n2)] + P->mismatchI[rtype[type]][SS1[i - 1]][SS2[j + 1]] + iext_s + 2 * iext_ass + 2 * extension_cost,
                            SA[LCI(idx, j, n2)]);
-      }
-
-      if ((type2 = pair[S1[i - 3]][S2[j + 3]])) {
+        /**
+        *** nx2 or more
+        **/
         SA[LCI(idx, j,
-               n2)] = MIN2(SA[LCI(idx_3, j + 3,
-                                  n2)] +
-                           P->int22[type2][rtype[type]][SS1[i - 2]][SS1[i - 1]][SS2[j + 1]][SS2[j +
-                                                                                                2]] + 6 * extension_cost,
+               n2)] = MIN2(SA[LINI(idx_2, j + 4,
+                                   n2)] + P->mismatchI[rtype[type]][SS1[i - 1]][SS2[j + 1]] + iext_s + 2 * iext_ass + 2 * extension_cost,
                            SA[LCI(idx, j, n2)]);
-      }
-
-      /**
-      *** 1x2 / 2x1 stack extension
-      *** E_IntLoop(1,2,type2, rtype[type],SS1[i-1], SS2[j+2], SS1[i-1], SS2[j+1], P) corresponds to
-      *** P->int21[rtype[type]][type2][SS2[j+2]][SS1[i-1]][SS1[i-1]]
-      **/
-      if ((type2 = pair[S1[i - 3]][S2[j + 2]])) {
+        /**
+        *** nx1 n>2
+        **/
         SA[LCI(idx, j,
-               n2)] = MIN2(SA[LCI(idx_3, j + 2,
-                                  n2)] +
-                           P->int21[rtype[type]][type2][SS2[j + 1]][SS1[i - 2]][SS1[i - 1]] + 5 * extension_cost,
+               n2)] = MIN2(SA[LINIX(idx_3, j + 1,
+                                    n2)] + P->mismatch1nI[rtype[type]][SS1[i - 1]][SS2[j + 1]] + iext_ass + iext_ass + 2 * extension_cost,
                            SA[LCI(idx, j, n2)]);
-      }
-
-      if ((type2 = pair[S1[i - 2]][S2[j + 3]])) {
+        /**
+        *** 1xn n>2
+        **/
         SA[LCI(idx, j,
-               n2)] = MIN2(SA[LCI(idx_2, j + 3,
-                                  n2)] +
-                           P->int21[type2][rtype[type]][SS1[i - 1]][SS2[j + 1]][SS2[j + 2]] + 5 * extension_cost,
+               n2)] = MIN2(SA[LINIY(idx_1, j + 3,
+                                    n2)] + P->mismatch1nI[rtype[type]][SS1[i - 1]][SS2[j + 1]] + iext_ass + iext_ass + 2 * extension_cost,
                            SA[LCI(idx, j, n2)]);
+        /**
+        *** nx0 n>1
+        **/
+        int bAU;
+        bAU = (type > 2 ? P->TerminalAU : 0);
+        SA[LCI(idx, j,
+               n2)] =
+          MIN2(SA[LBXI(idx_2, j + 1, n2)] + 2 * extension_cost + bext + bAU, SA[LCI(idx, j, n2)]);
+        /**
+        *** 0xn n>1
+        **/
+        SA[LCI(idx, j,
+               n2)] =
+          MIN2(SA[LBYI(idx_1, j + 2, n2)] + 2 * extension_cost + bext + bAU, SA[LCI(idx, j, n2)]);
+        temp = min_colonne;
+
+        min_colonne = MIN2(SA[LCI(idx, j, n2)] + E_ExtLoop(rtype[type], SS2[j - 1], SS1[i + 1],
+                                                           P) + 2 * extension_cost,
+                           min_colonne);
+        if (temp > min_colonne)
+          min_j_colonne = j;
       }
-
-      /**
-      *** 2x3 / 3x2 stack extension
-      **/
-      if ((type2 = pair[S1[i - 4]][S2[j + 3]])) {
-        SA[LCI(idx, j, n2)] = MIN2(SA[LCI(idx_4, j + 3,
-                                          n2)] + P->internal_loop[5] + P->ninio[2] +
-                                   P->mismatch23I[type2][SS1[i - 3]][SS2[j + 2]] +
-                                   P->mismatch23I[rtype[type]][SS2[j + 1]][SS1[i - 1]] + 7 * extension_cost,
-                                   SA[LCI(idx, j, n2)]);
-      }
-
-      if ((type2 = pair[S1[i - 3]][S2[j + 4]])) {
-        SA[LCI(idx, j, n2)] = MIN2(SA[LCI(idx_3, j + 4,
-                                          n2)] + P->internal_loop[5] + P->ninio[2] +
-                                   P->mismatch23I[type2][SS1[i - 2]][SS2[j + 3]] +
-                                   P->mismatch23I[rtype[type]][SS2[j + 1]][SS1[i - 1]] + 7 * extension_cost,
-                                   SA[LCI(idx, j, n2)]);
+      if (max >= min_colonne) {
+        max       = min_colonne;
+        max_pos   = i;
+        max_pos_j = min_j_colonne;
       }
 
-      /**
-      *** So now we have to handle 1x3, 3x1, 3x3, and mxn m,n > 3
-      **/
-      /**
-      *** 3x3 or more
-      **/
-      SA[LCI(idx, j,
-             n2)] = MIN2(SA[LINI(idx_3, j + 3,
-                                 n2)] + P->mismatchI[rtype[type]][SS1[i - 1]][SS2[j + 1]] + 2 * iext_s + 2 * extension_cost,
-                         SA[LCI(idx, j, n2)]);
-      /**
-      *** 2xn or more
-      **/
-      SA[LCI(idx, j,
-             n2)] = MIN2(SA[LINI(idx_4, j + 2,
-                                 n2)] + P->mismatchI[rtype[type]][SS1[i - 1]][SS2[j + 1]] + iext_s + 2 * iext_ass + 2 * extension_cost,
-                         SA[LCI(idx, j, n2)]);
-      /**
-      *** nx2 or more
-      **/
-      SA[LCI(idx, j,
-             n2)] = MIN2(SA[LINI(idx_2, j + 4,
-                                 n2)] + P->mismatchI[rtype[type]][SS1[i - 1]][SS2[j + 1]] + iext_s + 2 * iext_ass + 2 * extension_cost,
-                         SA[LCI(idx, j, n2)]);
-      /**
-      *** nx1 n>2
-      **/
-      SA[LCI(idx, j,
-             n2)] = MIN2(SA[LINIX(idx_3, j + 1,
-                                  n2)] + P->mismatch1nI[rtype[type]][SS1[i - 1]][SS2[j + 1]] + iext_ass + iext_ass + 2 * extension_cost,
-                         SA[LCI(idx, j, n2)]);
-      /**
-      *** 1xn n>2
-      **/
-      SA[LCI(idx, j,
-             n2)] = MIN2(SA[LINIY(idx_1, j + 3,
-                                  n2)] + P->mismatch1nI[rtype[type]][SS1[i - 1]][SS2[j + 1]] + iext_ass + iext_ass + 2 * extension_cost,
-                         SA[LCI(idx, j, n2)]);
-      /**
-      *** nx0 n>1
-      **/
-      int bAU;
-      bAU = (type > 2 ? P->TerminalAU : 0);
-      SA[LCI(idx, j,
-             n2)] =
-        MIN2(SA[LBXI(idx_2, j + 1, n2)] + 2 * extension_cost + bext + bAU, SA[LCI(idx, j, n2)]);
-      /**
-      *** 0xn n>1
-      **/
-      SA[LCI(idx, j,
-             n2)] =
-        MIN2(SA[LBYI(idx_1, j + 2, n2)] + 2 * extension_cost + bext + bAU, SA[LCI(idx, j, n2)]);
-      temp = min_colonne;
-
-      min_colonne = MIN2(SA[LCI(idx, j, n2)] + E_ExtLoop(rtype[type], SS2[j - 1], SS1[i + 1],
-                                                         P) + 2 * extension_cost,
-                         min_colonne);
-      if (temp > min_colonne)
-        min_j_colonne = j;
-    }
-    if (max >= min_colonne) {
-      max       = min_colonne;
-      max_pos   = i;
-      max_pos_j = min_j_colonne;
+      position[i + delta]   = min_colonne;
+      min_colonne           = INF;
+      position_j[i + delta] = min_j_colonne;
+      i++;
     }
-
-    position[i + delta]   = min_colonne;
-    min_colonne           = INF;
-    position_j[i + delta] = min_j_colonne;
-    i++;
   }
+
   /* printf("MAX: %d",max); */
   free(S1);
   free(S2);
@@ -4418,6 +4564,27 @@ plot_max(const int  max,
 }
 
 
+/**
+*** plex_printf writes to the character stream output if one is given,
+*** and to stdout otherwise
+**/
+PRIVATE void
+plex_printf(vrna_cstr_t output,
+            const char  *format,
+            ...)
+{
+  va_list args;
+
+  va_start(args, format);
+  if (output)
+    vrna_cstr_vprintf(output, format, args);
+  else
+    vprintf(format, args);
+
+  va_end(args);
+}
+
+
 PRIVATE void
 update_dfold_params(void)
 {
@@ -4477,6 +4644,453 @@ encode_seq(const char *sequence)
 }
 
 
+/*
+ * ###########################################
+ * # pre-gathered energy rows of the query   #
+ * ###########################################
+ */
+
+/* number of contexts and energy rows per context group */
+PRIVATE const int ctx_count[PLEX_CTX_GROUPS] = {
+  25, 25, 125, 625, 625, 25
+};
+
+PRIVATE const int ctx_rows[PLEX_CTX_GROUPS] = {
+  10, 1, 2, 3, 1, 1
+};
+
+
+PRIVATE void
+free_query_tables(plex_tables_t *T)
+{
+  int g;
+
+  if (T) {
+    for (g = 0; g < PLEX_CTX_GROUPS; g++) {
+      free(T->built[g]);
+      free(T->rows[g]);
+    }
+    free(T->query);
+    free(T);
+  }
+}
+
+
+/**
+*** Return the (possibly cached) energy row tables for the encoded query s2,
+*** or NULL if the encoding of target or query is not covered by the tables
+**/
+PRIVATE plex_tables_t *
+get_query_tables(const char *s2,
+                 const int  extension_cost)
+{
+  int           g, k;
+  plex_tables_t *T;
+
+  if (energy_set != 0)
+    return NULL;
+
+  for (k = 1; k <= n1; k++)
+    if ((S1[k] < 0) || (S1[k] > 4))
+      return NULL;
+
+  for (k = 1; k <= n2; k++)
+    if ((S2[k] < 0) || (S2[k] > 4))
+      return NULL;
+
+  T = query_tables;
+  if ((T) &&
+      (T->P == P) &&
+      (T->temperature == P->temperature) &&
+      (T->extension_cost == extension_cost) &&
+      (!strcmp(T->query, s2)))
+    return T;
+
+  free_query_tables(T);
+
+  T                 = (plex_tables_t *)vrna_alloc(sizeof(plex_tables_t));
+  T->query          = strdup(s2);
+  T->extension_cost = extension_cost;
+  T->P              = P;
+  T->temperature    = P->temperature;
+  T->width          = n2 + 1;
+
+  for (g = 0; g < PLEX_CTX_GROUPS; g++) {
+    T->built[g] = (unsigned char *)vrna_alloc(sizeof(unsigned char) * ctx_count[g]);
+    T->rows[g]  = (int *)vrna_alloc(sizeof(int) * ctx_count[g] * ctx_rows[g] * T->width);
+  }
+
+  query_tables = T;
+
+  return T;
+}
+
+
+/**
+*** Fill the energy rows of a context group for target position i
+*** against all query positions j, see plex_kernel.inc. The extension
+*** cost is added for each nucleotide of the respective loop.
+**/
+PRIVATE void
+fill_context_rows(int group,
+                  int i,
+                  int ec,
+                  int *rows,
+                  int width)
+{
+  int j, k, type, rt, t2, *r[10];
+
+  for (k = 0; k < ctx_rows[group]; k++)
+    r[k] = rows + k * width;
+
+  for (j = 10; j <= n2 - 10; j++) {
+    type  = pair[S1[i]][S2[j]];
+    rt    = rtype[type];
+
+    switch (group) {
+      case PLEX_CTX_A:
+        r[0][j] = type ?
+                  P->DuplexInit + E_ExtLoop(type, SS1[i - 1], SS2[j + 1], P) + 4 * ec :
+                  INF;
+        t2      = pair[S1[i - 1]][S2[j + 1]];
+        r[1][j] = (type && t2) ? P->stack[rt][t2] + 2 * ec : INF;
+        t2      = pair[S1[i - 1]][S2[j + 2]];
+        r[2][j] = (type && t2) ? P->bulge[1] + P->stack[rt][t2] + 3 * ec : INF;
+        r[3][j] = P->mismatchI[rt][SS1[i - 1]][SS2[j + 1]];
+        r[4][j] = P->mismatch1nI[rt][SS1[i - 1]][SS2[j + 1]];
+        r[5][j] = (type > 2) ? P->TerminalAU : 0;
+        t2      = pair[S2[j + 1]][S1[i - 1]];
+        r[6][j] = P->mismatchI[t2][SS2[j]][SS1[i]];
+        r[7][j] = P->mismatch1nI[t2][SS2[j]][SS1[i]];
+        t2      = pair[S2[j]][S1[i - 1]];
+        r[8][j] = (t2 > 2) ? P->TerminalAU : 0;
+        t2      = pair[S2[j + 1]][S1[i]];
+        r[9][j] = (t2 > 2) ? P->TerminalAU : 0;
+        break;
+
+      case PLEX_CTX_B:
+        t2      = pair[S1[i - 2]][S2[j + 1]];
+        r[0][j] = (type && t2) ? P->bulge[1] + P->stack[t2][rt] + 3 * ec : INF;
+        break;
+
+      case PLEX_CTX_C:
+        t2      = pair[S1[i - 2]][S2[j + 2]];
+        r[0][j] = (type && t2) ? P->int11[t2][rt][SS1[i - 1]][SS2[j + 1]] + 4 * ec : INF;
+        t2      = pair[S1[i - 2]][S2[j + 3]];
+        r[1][j] = (type && t2) ?
+                  P->int21[t2][rt][SS1[i - 1]][SS2[j + 1]][SS2[j + 2]] + 5 * ec :
+                  INF;
+        break;
+
+      case PLEX_CTX_D:
+        t2      = pair[S1[i - 3]][S2[j + 3]];
+        r[0][j] = (type && t2) ?
+                  P->int22[t2][rt][SS1[i - 2]][SS1[i - 1]][SS2[j + 1]][SS2[j + 2]] + 6 * ec :
+                  INF;
+        t2      = pair[S1[i - 3]][S2[j + 2]];
+        r[1][j] = (type && t2) ?
+                  P->int21[rt][t2][SS2[j + 1]][SS1[i - 2]][SS1[i - 1]] + 5 * ec :
+                  INF;
+        t2      = pair[S1[i - 3]][S2[j + 4]];
+        r[2][j] = (type && t2) ?
+                  P->internal_loop[5] + P->ninio[2] +
+                  P->mismatch23I[t2][SS1[i - 2]][SS2[j + 3]] +
+                  P->mismatch23I[rt][SS2[j + 1]][SS1[i - 1]] + 7 * ec :
+                  INF;
+        break;
+
+      case PLEX_CTX_E:
+        t2      = pair[S1[i - 4]][S2[j + 3]];
+        r[0][j] = (type && t2) ?
+                  P->internal_loop[5] + P->ninio[2] +
+                  P->mismatch23I[t2][SS1[i - 3]][SS2[j + 2]] +
+                  P->mismatch23I[rt][SS2[j + 1]][SS1[i - 1]] + 7 * ec :
+                  INF;
+        break;
+
+      default:
+        r[0][j] = type ? E_ExtLoop(rt, SS2[j - 1], SS1[i + 1], P) + 2 * ec : INF;
+        break;
+    }
+  }
+}
+
+
+PRIVATE const int *
+get_context_rows(plex_tables_t  *T,
+                 int            group,
+                 int            i)
+{
+  int ctx, *rows;
+
+  switch (group) {
+    case PLEX_CTX_A:
+      ctx = S1[i] * 5 + S1[i - 1];
+      break;
+    case PLEX_CTX_B:
+      ctx = S1[i] * 5 + S1[i - 2];
+      break;
+    case PLEX_CTX_C:
+      ctx = (S1[i] * 5 + S1[i - 1]) * 5 + S1[i - 2];
+      break;
+    case PLEX_CTX_D:
+      ctx = ((S1[i] * 5 + S1[i - 1]) * 5 + S1[i - 2]) * 5 + S1[i - 3];
+      break;
+    case PLEX_CTX_E:
+      ctx = ((S1[i] * 5 + S1[i - 1]) * 5 + S1[i - 3]) * 5 + S1[i - 4];
+      break;
+    default:
+      ctx = S1[i] * 5 + S1[i + 1];
+      break;
+  }
+
+  rows = T->rows[group] + (size_t)ctx * ctx_rows[group] * T->width;
+
+  if (!T->built[group][ctx]) {
+    fill_context_rows(group, i, T->extension_cost, rows, T->width);
+    T->built[group][ctx] = 1;
+  }
+
+  return rows;
+}
+
+
+/**
+*** Default row kernel: the entries of the recursion arrays at target
+*** position i that only depend on the four previous target positions
+**/
+PRIVATE void
+plex_row_default(const plex_row_t *row,
+                 int              jmin,
+                 int              jmax)
+{
+  int       j, e, s, dj1, dj2, dj3, dj4;
+  const int di1 = row->di[1], di2 = row->di[2], di3 = row->di[3], di4 = row->di[4];
+
+  for (j = jmin; j <= jmax; j++) {
+    dj1 = row->dj[1][j];
+    dj2 = row->dj[2][j];
+    dj3 = row->dj[3][j];
+    dj4 = row->dj[4][j];
+
+    /* start/extend interior loops and bulges, in[0] and iny[0] are completed by the caller */
+    s                 = row->c[1][j + 1] + row->iopen + row->iext_s + di1 + dj1;
+    row->in[0][j]     = MIN3(s + row->in_start[j],
+                             row->in[1][j] + row->iext_ass + di1,
+                             row->in[1][j + 1] + row->iext_s + di1 + dj1);
+    row->inx[0][j]    = MIN2(s + row->in1n_start[j],
+                             row->inx[1][j] + row->iext_ass + di1);
+    row->iny[0][j]    = s + row->in1n_start[j];
+    row->bx[0][j]     = MIN2(row->bx[1][j] + row->bext + di1,
+                             row->c[1][j] + row->bopen + row->bext + row->au_bx[j] + di1);
+
+    if (row->init[j] == INF) {
+      row->c[0][j] = INF;
+      continue;
+    }
+
+    /* stacks, bulges, and interior loops closed by (i, j) */
+    e = row->init[j];
+    e = MIN2(e, row->c[1][j + 1] + row->stack[j] + di1 + dj1);
+    e = MIN2(e, row->c[1][j + 2] + row->bulge10[j] + di1 + dj2);
+    e = MIN2(e, row->c[2][j + 1] + row->bulge01[j] + di2 + dj1);
+    e = MIN2(e, row->c[2][j + 2] + row->int11[j] + di2 + dj2);
+    e = MIN2(e, row->c[3][j + 3] + row->int22[j] + di3 + dj3);
+    e = MIN2(e, row->c[3][j + 2] + row->int21a[j] + di3 + dj2);
+    e = MIN2(e, row->c[2][j + 3] + row->int21b[j] + di2 + dj3);
+    e = MIN2(e, row->c[4][j + 3] + row->int23[j] + di4 + dj3);
+    e = MIN2(e, row->c[3][j + 4] + row->int32[j] + di3 + dj4);
+    e = MIN2(e, row->in[3][j + 3] + row->mm_i[j] + row->k_3x3 + di3 + dj3);
+    e = MIN2(e, row->in[4][j + 2] + row->mm_i[j] + row->k_2xn + di4 + dj2);
+    e = MIN2(e, row->in[2][j + 4] + row->mm_i[j] + row->k_2xn + di2 + dj4);
+    e = MIN2(e, row->inx[3][j + 1] + row->mm_1n[j] + row->k_nx1 + di3 + dj1);
+    e = MIN2(e, row->iny[1][j + 3] + row->mm_1n[j] + row->k_nx1 + di1 + dj3);
+    e = MIN2(e, row->bx[2][j + 1] + row->au[j] + row->k_nx0 + di2 + dj1);
+    e = MIN2(e, row->by[1][j + 2] + row->au[j] + row->k_nx0 + di1 + dj2);
+
+    row->c[0][j] = e;
+  }
+}
+
+
+PUBLIC void
+vrna_plex_dispatch_disable(void)
+{
+  plex_dispatch = 0;
+}
+
+
+PUBLIC void
+vrna_plex_dispatch_enable(void)
+{
+  plex_dispatch = 1;
+}
+
+
+PRIVATE plex_row_f *
+plex_row_function(void)
+{
+#if VRNA_WITH_SIMD_SSE41
+  if ((plex_dispatch) &&
+      (vrna_cpu_simd_capabilities() & VRNA_CPU_SIMD_SSE41))
+    return &vrna_plex_row_sse41;
+
+#endif
+
+  return &plex_row_default;
+}
+
+
+/**
+*** Table driven version of the main loop of Lduplexfold(_XS). Rows of the
+*** recursion arrays are computed by a (vectorized) row kernel, only the
+*** recursions along the query are done here. access_s1 and DJ are NULL
+*** if accessibilities are not taken into account. Returns 0 without
+*** doing anything if the sequences can not be handled by the energy rows.
+**/
+PRIVATE int
+scan_tables(const char  *s2,
+            int         *SA,
+            const int   **access_s1,
+            int         **DJ,
+            const int   extension_cost,
+            const int   iopen,
+            const int   iext_s,
+            const int   iext_ass,
+            const int   bopen,
+            const int   bext,
+            const int   delta,
+            int         *position,
+            int         *position_j,
+            int         *max,
+            int         *max_pos,
+            int         *max_pos_j)
+{
+  int           i, j, k, idx, dj1, temp, min_colonne, min_j_colonne, *zero;
+  const int     *rows, *ext;
+  plex_tables_t *T;
+  plex_row_t    row;
+  plex_row_f    *compute_row;
+
+  T = get_query_tables(s2, extension_cost);
+  if (!T)
+    return 0;
+
+  compute_row = plex_row_function();
+  zero        = NULL;
+
+  memset(&row, 0, sizeof(plex_row_t));
+
+  if (DJ) {
+    for (k = 1; k <= 4; k++)
+      row.dj[k] = DJ[k - 1];
+  } else {
+    zero = (int *)vrna_alloc(sizeof(int) * (n2 + 1));
+    for (k = 1; k <= 4; k++)
+      row.dj[k] = zero;
+  }
+
+  row.iopen     = iopen;
+  row.iext_s    = iext_s;
+  row.iext_ass  = iext_ass;
+  row.bopen     = bopen;
+  row.bext      = bext;
+  row.k_3x3     = 2 * iext_s + 2 * extension_cost;
+  row.k_2xn     = iext_s + 2 * iext_ass + 2 * extension_cost;
+  row.k_nx1     = 2 * iext_ass + 2 * extension_cost;
+  row.k_nx0     = bext + 2 * extension_cost;
+
+  min_j_colonne = 0;
+
+  for (i = 10; i < n1 - 9; i++) {
+    for (k = 0; k <= 4; k++) {
+      idx         = (i - k) % 5;
+      row.c[k]    = SA + LCI(idx, 0, n2);
+      row.in[k]   = SA + LINI(idx, 0, n2);
+      row.bx[k]   = SA + LBXI(idx, 0, n2);
+      row.by[k]   = SA + LBYI(idx, 0, n2);
+      row.inx[k]  = SA + LINIX(idx, 0, n2);
+      row.iny[k]  = SA + LINIY(idx, 0, n2);
+    }
+
+    if (access_s1) {
+      row.di[1] = 0.5 *
+                  (access_s1[5][i + 4] - access_s1[4][i + 4] + access_s1[5][i] -
+                   access_s1[4][i - 1]);
+      row.di[2] = 0.5 *
+                  (access_s1[5][i + 3] - access_s1[4][i + 3] + access_s1[5][i - 1] -
+                   access_s1[4][i - 2]) +
+                  row.di[1];
+      row.di[3] = 0.5 *
+                  (access_s1[5][i + 2] - access_s1[4][i + 2] + access_s1[5][i - 2] -
+                   access_s1[4][i - 3]) +
+                  row.di[2];
+      row.di[4] = 0.5 *
+                  (access_s1[5][i + 1] - access_s1[4][i + 1] + access_s1[5][i - 3] -
+                   access_s1[4][i - 4]) +
+                  row.di[3];
+    }
+
+    rows            = get_context_rows(T, PLEX_CTX_A, i);
+    row.init        = rows;
+    row.stack       = rows + T->width;
+    row.bulge10     = rows + 2 * T->width;
+    row.mm_i        = rows + 3 * T->width;
+    row.mm_1n       = rows + 4 * T->width;
+    row.au          = rows + 5 * T->width;
+    row.in_start    = rows + 6 * T->width;
+    row.in1n_start  = rows + 7 * T->width;
+    row.au_bx       = rows + 8 * T->width;
+    row.au_by       = rows + 9 * T->width;
+    row.bulge01     = get_context_rows(T, PLEX_CTX_B, i);
+    rows            = get_context_rows(T, PLEX_CTX_C, i);
+    row.int11       = rows;
+    row.int21b      = rows + T->width;
+    rows            = get_context_rows(T, PLEX_CTX_D, i);
+    row.int22       = rows;
+    row.int21a      = rows + T->width;
+    row.int32       = rows + 2 * T->width;
+    row.int23       = get_context_rows(T, PLEX_CTX_E, i);
+    ext             = get_context_rows(T, PLEX_CTX_X, i);
+
+    compute_row(&row, 10, n2 - 10);
+
+    /**
+    *** extend interior loops and bulges along the query and
+    *** find the best duplex ending at target position i
+    **/
+    min_colonne = INF;
+    for (j = n2 - 10; j > 9; j--) {
+      dj1           = row.dj[1][j];
+      row.in[0][j]  = MIN2(row.in[0][j], row.in[0][j + 1] + iext_ass + dj1);
+      row.iny[0][j] = MIN2(row.iny[0][j], row.iny[0][j + 1] + iext_ass + dj1);
+      row.by[0][j]  = MIN2(row.by[0][j + 1] + bext + dj1,
+                           row.c[0][j + 1] + bopen + bext + row.au_by[j] + dj1);
+
+      if (row.init[j] != INF) {
+        temp        = min_colonne;
+        min_colonne = MIN2(row.c[0][j] + ext[j], min_colonne);
+        if (temp > min_colonne)
+          min_j_colonne = j;
+      }
+    }
+
+    if (*max >= min_colonne) {
+      *max        = min_colonne;
+      *max_pos    = i;
+      *max_pos_j  = min_j_colonne;
+    }
+
+    position[i + delta]   = min_colonne;
+    position_j[i + delta] = min_j_colonne;
+  }
+
+  free(zero);
+
+  return 1;
+}
+
+
 int
 arraySize(duplexT **array)
 {
@@ -2,6 +2,7 @@
 #define VIENNA_RNA_PACKAGE_PLEX_H
 
 #include <ViennaRNA/datastructures/basic.h>
+#include <ViennaRNA/datastructures/char_stream.h>
 
 
 extern int subopt_sorted;
@@ -37,6 +38,26 @@ duplexT** Lduplexfold_XS( const char*s1,
                           const int b_a,
                           const int b_b);/* , const int target_dead, const int query_dead); */
 
+/**
+*** Lduplexfold_XS_cstr Same as Lduplexfold_XS but appends its output to a character stream
+*** instead of writing it to stdout (output=NULL writes to stdout).
+*** The function is thread-safe when compiled with OpenMP, such that independent
+*** target/query pairs may be scanned in parallel, each thread using its own output stream.
+**/
+duplexT** Lduplexfold_XS_cstr(vrna_cstr_t output,
+                              const char*s1,
+                              const char* s2,
+                              const int **access_s1,
+                              const int **access_s2,
+                              const int threshold,
+                              const int alignment_length,
+                              const int delta,
+                              const int fast,
+                              const int il_a,
+                              const int il_b,
+                              const int b_a,
+                              const int b_b);
+
 /**
 *** Lduplexfold_C Computes duplexes between two single sequences and takes constraint into account
 **/
@@ -77,4 +98,12 @@ duplexT** Lduplexfold_CXS(const char*s1,
 int      arraySize(duplexT** array);
 void     freeDuplexT(duplexT** array);
 
+/**
+*** vrna_plex_dispatch_disable Always use the scalar recursions in Lduplexfold(_XS), even if
+*** the CPU supports SIMD instructions. vrna_plex_dispatch_enable restores the default, where
+*** the implementation is selected by the capabilities of the CPU at runtime.
+**/
+void     vrna_plex_dispatch_disable(void);
+void     vrna_plex_dispatch_enable(void);
+
 #endif
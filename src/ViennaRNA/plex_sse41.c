@@ -0,0 +1,153 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ViennaRNA/utils/basic.h"
+#include "ViennaRNA/params/basic.h"
+
+#include <emmintrin.h>
+#include <smmintrin.h>
+
+#include "plex_kernel.inc"
+
+/* a + b + c + d */
+#define ADD4(a, b, c, d)  _mm_add_epi32(_mm_add_epi32((a), (b)), _mm_add_epi32((c), (d)))
+
+#define LOAD(p)           _mm_loadu_si128((const __m128i *)(p))
+#define STORE(p, v)       _mm_storeu_si128((__m128i *)(p), (v))
+
+
+/*
+ *  Row kernel of Lduplexfold() and Lduplexfold_XS() that processes four
+ *  query positions at once. Computes the entries of the recursion arrays
+ *  at target position i that only depend on the four previous target
+ *  positions, see plex_row_default() in plex.c for the scalar version.
+ */
+PUBLIC void
+vrna_plex_row_sse41(const plex_row_t  *row,
+                    int               jmin,
+                    int               jmax)
+{
+  int           j, e, s, dj1, dj2, dj3, dj4;
+  const int     di1 = row->di[1], di2 = row->di[2], di3 = row->di[3], di4 = row->di[4];
+  const __m128i inf       = _mm_set1_epi32(INF);
+  const __m128i vdi1      = _mm_set1_epi32(di1);
+  const __m128i vdi2      = _mm_set1_epi32(di2);
+  const __m128i vdi3      = _mm_set1_epi32(di3);
+  const __m128i vdi4      = _mm_set1_epi32(di4);
+  const __m128i vopen     = _mm_set1_epi32(row->iopen + row->iext_s);
+  const __m128i viext_s   = _mm_set1_epi32(row->iext_s);
+  const __m128i viext_ass = _mm_set1_epi32(row->iext_ass);
+  const __m128i vbext     = _mm_set1_epi32(row->bext);
+  const __m128i vbopen    = _mm_set1_epi32(row->bopen + row->bext);
+  const __m128i vk_3x3    = _mm_set1_epi32(row->k_3x3);
+  const __m128i vk_2xn    = _mm_set1_epi32(row->k_2xn);
+  const __m128i vk_nx1    = _mm_set1_epi32(row->k_nx1);
+  const __m128i vk_nx0    = _mm_set1_epi32(row->k_nx0);
+
+  for (j = jmin; j + 3 <= jmax; j += 4) {
+    __m128i vdj1  = LOAD(row->dj[1] + j);
+    __m128i vdj2  = LOAD(row->dj[2] + j);
+    __m128i vdj3  = LOAD(row->dj[3] + j);
+    __m128i vdj4  = LOAD(row->dj[4] + j);
+    __m128i vinit = LOAD(row->init + j);
+    __m128i vs, v, ve, mm;
+
+    /* start/extend interior loops and bulges, in[0] and iny[0] are completed by the caller */
+    vs  = ADD4(LOAD(row->c[1] + j + 1), vopen, vdi1, vdj1);
+    v   = _mm_min_epi32(_mm_add_epi32(vs, LOAD(row->in_start + j)),
+                        _mm_add_epi32(LOAD(row->in[1] + j), _mm_add_epi32(viext_ass, vdi1)));
+    v = _mm_min_epi32(v, ADD4(LOAD(row->in[1] + j + 1), viext_s, vdi1, vdj1));
+    STORE(row->in[0] + j, v);
+
+    v = _mm_add_epi32(vs, LOAD(row->in1n_start + j));
+    STORE(row->iny[0] + j, v);
+    v = _mm_min_epi32(v, _mm_add_epi32(LOAD(row->inx[1] + j), _mm_add_epi32(viext_ass, vdi1)));
+    STORE(row->inx[0] + j, v);
+
+    v = _mm_min_epi32(_mm_add_epi32(LOAD(row->bx[1] + j), _mm_add_epi32(vbext, vdi1)),
+                      ADD4(LOAD(row->c[1] + j), vbopen, LOAD(row->au_bx + j), vdi1));
+    STORE(row->bx[0] + j, v);
+
+    /* stacks, bulges, and interior loops closed by (i, j) */
+    ve  = vinit;
+    ve  = _mm_min_epi32(ve, ADD4(LOAD(row->c[1] + j + 1), LOAD(row->stack + j), vdi1, vdj1));
+    ve  = _mm_min_epi32(ve, ADD4(LOAD(row->c[1] + j + 2), LOAD(row->bulge10 + j), vdi1, vdj2));
+    ve  = _mm_min_epi32(ve, ADD4(LOAD(row->c[2] + j + 1), LOAD(row->bulge01 + j), vdi2, vdj1));
+    ve  = _mm_min_epi32(ve, ADD4(LOAD(row->c[2] + j + 2), LOAD(row->int11 + j), vdi2, vdj2));
+    ve  = _mm_min_epi32(ve, ADD4(LOAD(row->c[3] + j + 3), LOAD(row->int22 + j), vdi3, vdj3));
+    ve  = _mm_min_epi32(ve, ADD4(LOAD(row->c[3] + j + 2), LOAD(row->int21a + j), vdi3, vdj2));
+    ve  = _mm_min_epi32(ve, ADD4(LOAD(row->c[2] + j + 3), LOAD(row->int21b + j), vdi2, vdj3));
+    ve  = _mm_min_epi32(ve, ADD4(LOAD(row->c[4] + j + 3), LOAD(row->int23 + j), vdi4, vdj3));
+    ve  = _mm_min_epi32(ve, ADD4(LOAD(row->c[3] + j + 4), LOAD(row->int32 + j), vdi3, vdj4));
+
+    mm  = LOAD(row->mm_i + j);
+    ve  = _mm_min_epi32(ve,
+                        _mm_add_epi32(ADD4(LOAD(row->in[3] + j + 3), mm, vk_3x3, vdi3), vdj3));
+    ve = _mm_min_epi32(ve,
+                       _mm_add_epi32(ADD4(LOAD(row->in[4] + j + 2), mm, vk_2xn, vdi4), vdj2));
+    ve = _mm_min_epi32(ve,
+                       _mm_add_epi32(ADD4(LOAD(row->in[2] + j + 4), mm, vk_2xn, vdi2), vdj4));
+
+    mm  = LOAD(row->mm_1n + j);
+    ve  = _mm_min_epi32(ve,
+                        _mm_add_epi32(ADD4(LOAD(row->inx[3] + j + 1), mm, vk_nx1, vdi3), vdj1));
+    ve = _mm_min_epi32(ve,
+                       _mm_add_epi32(ADD4(LOAD(row->iny[1] + j + 3), mm, vk_nx1, vdi1), vdj3));
+
+    mm  = LOAD(row->au + j);
+    ve  = _mm_min_epi32(ve,
+                        _mm_add_epi32(ADD4(LOAD(row->bx[2] + j + 1), mm, vk_nx0, vdi2), vdj1));
+    ve = _mm_min_epi32(ve,
+                       _mm_add_epi32(ADD4(LOAD(row->by[1] + j + 2), mm, vk_nx0, vdi1), vdj2));
+
+    /* no base pair (i, j) possible */
+    ve = _mm_blendv_epi8(ve, inf, _mm_cmpeq_epi32(vinit, inf));
+    STORE(row->c[0] + j, ve);
+  }
+
+  for (; j <= jmax; j++) {
+    dj1 = row->dj[1][j];
+    dj2 = row->dj[2][j];
+    dj3 = row->dj[3][j];
+    dj4 = row->dj[4][j];
+
+    s                 = row->c[1][j + 1] + row->iopen + row->iext_s + di1 + dj1;
+    row->in[0][j]     = MIN3(s + row->in_start[j],
+                             row->in[1][j] + row->iext_ass + di1,
+                             row->in[1][j + 1] + row->iext_s + di1 + dj1);
+    row->inx[0][j]    = MIN2(s + row->in1n_start[j],
+                             row->inx[1][j] + row->iext_ass + di1);
+    row->iny[0][j]    = s + row->in1n_start[j];
+    row->bx[0][j]     = MIN2(row->bx[1][j] + row->bext + di1,
+                             row->c[1][j] + row->bopen + row->bext + row->au_bx[j] + di1);
+
+    if (row->init[j] == INF) {
+      row->c[0][j] = INF;
+      continue;
+    }
+
+    e = row->init[j];
+    e = MIN2(e, row->c[1][j + 1] + row->stack[j] + di1 + dj1);
+    e = MIN2(e, row->c[1][j + 2] + row->bulge10[j] + di1 + dj2);
+    e = MIN2(e, row->c[2][j + 1] + row->bulge01[j] + di2 + dj1);
+    e = MIN2(e, row->c[2][j + 2] + row->int11[j] + di2 + dj2);
+    e = MIN2(e, row->c[3][j + 3] + row->int22[j] + di3 + dj3);
+    e = MIN2(e, row->c[3][j + 2] + row->int21a[j] + di3 + dj2);
+    e = MIN2(e, row->c[2][j + 3] + row->int21b[j] + di2 + dj3);
+    e = MIN2(e, row->c[4][j + 3] + row->int23[j] + di4 + dj3);
+    e = MIN2(e, row->c[3][j + 4] + row->int32[j] + di3 + dj4);
+    e = MIN2(e, row->in[3][j + 3] + row->mm_i[j] + row->k_3x3 + di3 + dj3);
+    e = MIN2(e, row->in[4][j + 2] + row->mm_i[j] + row->k_2xn + di4 + dj2);
+    e = MIN2(e, row->in[2][j + 4] + row->mm_i[j] + row->k_2xn + di2 + dj4);
+    e = MIN2(e, row->inx[3][j + 1] + row->mm_1n[j] + row->k_nx1 + di3 + dj1);
+    e = MIN2(e, row->iny[1][j + 3] + row->mm_1n[j] + row->k_nx1 + di1 + dj3);
+    e = MIN2(e, row->bx[2][j + 1] + row->au[j] + row->k_nx0 + di2 + dj1);
+    e = MIN2(e, row->by[1][j + 2] + row->au[j] + row->k_nx0 + di1 + dj2);
+
+    row->c[0][j] = e;
+  }
+}
@@ -14,6 +14,7 @@
 #endif
 
 #include <ViennaRNA/datastructures/basic.h>
+#include <ViennaRNA/dist_vars.h>
 
 /** \file profiledist.h  */
 
@@ -27,6 +28,61 @@ float profile_edit_distance(const float *T1,
                             const float *T2);
 
 
+/**
+ *  \brief Align two probability profiles using a workspace
+ *
+ *  In contrast to profile_edit_distance(), this function does not depend on the
+ *  global variable #edit_backtrack but takes the corresponding setting from
+ *  \p options. All memory is taken from the workspace \p ws and re-used in
+ *  subsequent calls. Hence, it may be called concurrently with different workspaces.
+ *  If \p options contains #VRNA_DIST_BACKTRACK, the aligned profiles are stored in
+ *  the \p aligned_line member of the workspace.
+ *
+ *  A non-zero \p band restricts the alignment to cells \f$(i,j)\f$ that are at most
+ *  \p band positions off the diagonal, extended by the length difference of the
+ *  two profiles. The result is exact as long as the optimal alignment stays within
+ *  the band.
+ *
+ *  \see vrna_dist_ws_init(), vrna_profile_edit_distance_matrix(), Make_bp_profile_bppm()
+ *
+ *  \param ws      The workspace
+ *  \param T1      The first probability profile
+ *  \param T2      The second probability profile
+ *  \param band    The band width, or 0 for the complete dynamic programming matrix
+ *  \param options Options for the distance computation
+ *  \return        The profile edit distance between \p T1 and \p T2
+ */
+float vrna_profile_edit_distance(vrna_dist_ws_t *ws,
+                                 const float    *T1,
+                                 const float    *T2,
+                                 unsigned int   band,
+                                 unsigned int   options);
+
+
+/**
+ *  \brief Calculates the profile edit distances between all pairs of a list of probability profiles.
+ *
+ *  The matrix is split into tiles that are distributed among all available
+ *  threads if OpenMP is available. Each thread re-uses its own workspace for
+ *  all of its pairs. #VRNA_DIST_BACKTRACK is ignored.
+ *
+ *  The lower triangle of the distance matrix is returned in row-major order
+ *  without the diagonal, i.e. the distance between profiles \f$i > j\f$ (0-based)
+ *  is found at position \f$i(i-1)/2 + j\f$.
+ *
+ *  \see vrna_profile_edit_distance()
+ *
+ *  \param profiles  A \em NULL terminated list of probability profiles
+ *  \param band      The band width, or 0 for the complete dynamic programming matrices
+ *  \param options   Options for the distance computation
+ *  \return          The lower triangle of the distance matrix, or \em NULL if the list
+ *                   has less than two entries
+ */
+float *vrna_profile_edit_distance_matrix(const float  **profiles,
+                                         unsigned int band,
+                                         unsigned int options);
+
+
 /**
  *  \brief condense pair probability matrix into a vector containing probabilities
  *  for unpaired, upstream paired and downstream paired.
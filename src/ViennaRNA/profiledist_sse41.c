@@ -0,0 +1,47 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ViennaRNA/utils/basic.h"
+
+#include <emmintrin.h>
+#include <smmintrin.h>
+
+/*
+ *  Sums of the geometric means of one profile position against a
+ *  row of square root profile entries, i.e.
+ *  out[j] = sum_k a[k] * b[k * ld + j] for all 0 <= j < count,
+ *  see vrna_profile_edit_distance() and vrna_profile_aln()
+ */
+PUBLIC void
+vrna_profile_dot_sse41(const float  *a,
+                       const float  *b,
+                       size_t       ld,
+                       int          kmax,
+                       float        *out,
+                       int          count)
+{
+  int j, k;
+
+  for (j = 0; j < count - 3; j += 4) {
+    __m128 acc = _mm_setzero_ps();
+
+    /* same order of summation as the scalar version */
+    for (k = 0; k < kmax; k++)
+      acc = _mm_add_ps(acc,
+                       _mm_mul_ps(_mm_set1_ps(a[k]),
+                                  _mm_loadu_ps(b + k * ld + j)));
+
+    _mm_storeu_ps(out + j, acc);
+  }
+
+  for (; j < count; j++) {
+    float s = 0.;
+    for (k = 0; k < kmax; k++)
+      s += a[k] * b[k * ld + j];
+    out[j] = s;
+  }
+}
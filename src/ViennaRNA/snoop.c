@@ -14,6 +14,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdarg.h>
 #include <math.h>
 #include <ctype.h>
 #include <string.h>
@@ -31,6 +32,10 @@
 #include "ViennaRNA/duplex.h"
 #include "ViennaRNA/loops/all.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 
 #define STACK_BULGE1  1   /* stacking energies for bulges of size 1 */
 #define NEW_NINIO     1   /* new asymetry penalty */
@@ -46,31 +51,96 @@ encode_seq(const char *seq);
 
 
 PRIVATE void
-find_max_snoop(const char *s1,
-               const char *s2,
-               const int  max,
-               const int  alignment_length,
-               const int  *position,
-               const int  delta,
-               const int  distance,
-               const int  penalty,
-               const int  threshloop,
-               const int  threshLE,
-               const int  threshRE,
-               const int  threshDE,
-               const int  threshTE,
-               const int  threshSE,
-               const int  threshD,
-               const int  half_stem,
-               const int  max_half_stem,
-               const int  min_s2,
-               const int  max_s2,
-               const int  min_s1,
-               const int  max_s1,
-               const int  min_d1,
-               const int  min_d2,
-               const char *name,
-               const int  fullStemEnergy);
+find_max_snoop(vrna_cstr_t  output,
+               const char   *s1,
+               const char   *s2,
+               const int    max,
+               const int    alignment_length,
+               const int    *position,
+               const int    delta,
+               const int    distance,
+               const int    penalty,
+               const int    threshloop,
+               const int    threshLE,
+               const int    threshRE,
+               const int    threshDE,
+               const int    threshTE,
+               const int    threshSE,
+               const int    threshD,
+               const int    half_stem,
+               const int    max_half_stem,
+               const int    min_s2,
+               const int    max_s2,
+               const int    min_s1,
+               const int    max_s1,
+               const int    min_d1,
+               const int    min_d2,
+               const char   *name,
+               const int    fullStemEnergy);
+
+
+/**
+*** Workspace of the scan done by Lsnoop_subopt_list(). The encoded
+*** sequences and the folding list of the snoRNA are shared among all
+*** threads, position[i] receives the best interaction ending at target
+*** position i.
+**/
+typedef struct {
+  short         *S1;
+  short         *SS1;
+  short         *S2;
+  short         *SS2;
+  int           n1;
+  int           n2;
+  folden        **foldlist;
+  int           penalty;
+  int           half_stem;
+  int           max_half_stem;
+  int           min_s2;
+  int           max_s2;
+  int           min_s1;
+  int           max_s1;
+  int           min_d1;
+  int           min_d2;
+  int           *position;
+} snoop_scan_t;
+
+
+PRIVATE void
+scan_rows(const snoop_scan_t  *ws,
+          int                 start,
+          int                 from,
+          int                 to);
+
+
+PRIVATE snoopT
+fold_snoop(const char *s1,
+           const char *s2,
+           const int  penalty,
+           const int  threshloop,
+           const int  threshLE,
+           const int  threshRE,
+           const int  threshDE,
+           const int  threshD,
+           const int  half_stem,
+           const int  max_half_stem,
+           const int  min_s2,
+           const int  max_s2,
+           const int  min_s1,
+           const int  max_s1,
+           const int  min_d1,
+           const int  min_d2,
+           const int  fullStemEnergy);
+
+
+PRIVATE void
+update_snoop_params(void);
+
+
+PRIVATE void
+snoop_printf(vrna_cstr_t  output,
+             const char   *format,
+             ...);
 
 
 PRIVATE void
@@ -207,6 +277,7 @@ PUBLIC int snoop_subopt_sorted = 0; /* from subopt.c, default 0 */
 #define MIN2(A, B)      ((A) < (B) ? (A) : (B))
 #define MAX2(A, B)      ((A) > (B) ? (A) : (B))
 #define ASS                1
+#define SNOOP_MIN_CHUNK  8 /* minimal chunk length of Lsnoop_subopt_list() in units of the overlap */
 PRIVATE vrna_param_t  *P = NULL;
 
 PRIVATE int           **c       = NULL; /* energy array, given that i-j pair */
@@ -225,6 +296,16 @@ PRIVATE int           n1, n2; /* sequence lengths */
 extern int            cut_point;
 
 PRIVATE int           delay_free = 0;
+
+#ifdef _OPENMP
+
+/* NOTE: all variables are assumed to be uninitialized if they are declared as threadprivate
+ */
+#pragma omp threadprivate(P, c, r, lc, lr, c_fill, r_fill, lpair, \
+  S1, SS1, S2, SS2, S1_fill, SS1_fill, S2_fill, SS2_fill, n1, n2, delay_free)
+
+#endif
+
 /*--------------------------------------------------------------------------*/
 
 snoopT
@@ -260,7 +341,6 @@ alisnoopfold(const char **s1,
   int       Loop_E;
   short     **Sali1, **Sali2;
   int       *type, *type2, *type3;
-  vrna_md_t md;
 
   Duplex_El = 0;
   Duplex_Er = 0;
@@ -279,15 +359,7 @@ alisnoopfold(const char **s1,
   if (n_seq != s)
     vrna_message_error("unequal number of sequences in aliduplexfold()\n");
 
-  set_model_details(&md);
-  if ((!P) || (fabs(P->temperature - temperature) > 1e-6)) {
-    snoupdate_fold_params();
-    if (P)
-      free(P);
-
-    P = vrna_params(&md);
-    make_pair_matrix();
-  }
+  update_snoop_params();
 
   c = (int **)vrna_alloc(sizeof(int *) * (n1 + 1));
   r = (int **)vrna_alloc(sizeof(int *) * (n1 + 1));
@@ -1114,21 +1186,12 @@ Lsnoop_subopt(const char  *s1,
   int       Loop_D;
   /* int u; */
   int       Loop_E;
-  vrna_md_t md;
 
   Duplex_El = 0;
   Duplex_Er = 0;
   Loop_E    = 0, Loop_D = 0;
   snoexport_fold_arrays(&indx, &mLoop, &cLoop, &foldlist, &foldlist_XS);
-  set_model_details(&md);
-  if ((!P) || (fabs(P->temperature - temperature) > 1e-6)) {
-    snoupdate_fold_params();
-    if (P)
-      free(P);
-
-    P = vrna_params(&md);
-    make_pair_matrix();
-  }
+  update_snoop_params();
 
   lc  = (int **)vrna_alloc(sizeof(int *) * (5));
   lr  = (int **)vrna_alloc(sizeof(int *) * (5));
@@ -1253,7 +1316,8 @@ Lsnoop_subopt(const char  *s1,
   free(SS1);
   free(SS2);
   if (max < threshTE) {
-    find_max_snoop(s1,
+    find_max_snoop(NULL,
+                   s1,
                    s2,
                    max,
                    alignment_length,
@@ -1318,53 +1382,190 @@ Lsnoop_subopt_list(const char *s1,
                    const char *name,
                    const int  fullStemEnergy)
 {
-  int min_colonne = INF;
-  int max_pos;
-  int max;
+  Lsnoop_subopt_list_cstr(NULL,
+                          s1,
+                          s2,
+                          delta,
+                          w,
+                          penalty,
+                          threshloop,
+                          threshLE,
+                          threshRE,
+                          threshDE,
+                          threshTE,
+                          threshSE,
+                          threshD,
+                          distance,
+                          half_stem,
+                          max_half_stem,
+                          min_s2,
+                          max_s2,
+                          min_s1,
+                          max_s1,
+                          min_d1,
+                          min_d2,
+                          alignment_length,
+                          name,
+                          fullStemEnergy);
+}
 
-  max = INF;
 
-  /* int temp; */
-  /* int nsubopt=10; */
-  n1  = (int)strlen(s1);
-  n2  = (int)strlen(s2);
-  int       *position;
-  position = (int *)vrna_alloc((n1 + 3) * sizeof(int));
+void
+Lsnoop_subopt_list_cstr(vrna_cstr_t  output,
+                        const char   *s1,
+                        const char   *s2,
+                        int          delta,
+                        int          w,
+                        const int    penalty,
+                        const int    threshloop,
+                        const int    threshLE,
+                        const int    threshRE,
+                        const int    threshDE,
+                        const int    threshTE,
+                        const int    threshSE,
+                        const int    threshD,
+                        const int    distance,
+                        const int    half_stem,
+                        const int    max_half_stem,
+                        const int    min_s2,
+                        const int    max_s2,
+                        const int    min_s1,
+                        const int    max_s1,
+                        const int    min_d1,
+                        const int    min_d2,
+                        const int    alignment_length,
+                        const char   *name,
+                        const int    fullStemEnergy)
+{
+  int           i, k, max, overlap, n_chunks, chunk_size;
+  int           *indx;
+  int           *mLoop;
+  int           *cLoop;
+  folden        **foldlist, **foldlist_XS;
+  snoop_scan_t  ws;
 
+  snoexport_fold_arrays(&indx, &mLoop, &cLoop, &foldlist, &foldlist_XS);
 
-  /* int Eminj, Emin_l; */
-  int       i, j;/*  l1, Emin=INF, i_min=0, j_min=0; */
-  /* char *struc; */
-  /* snoopT mfe; */
-  int       *indx;
-  int       *mLoop;
-  int       *cLoop;
-  folden    **foldlist, **foldlist_XS;
-  int       Duplex_El, Duplex_Er;
-  int       Loop_D;
-  /* int u; */
-  int       Loop_E;
-  vrna_md_t md;
+  update_snoop_params();
 
-  Duplex_El = 0;
-  Duplex_Er = 0;
-  Loop_E    = 0, Loop_D = 0;
-  snoexport_fold_arrays(&indx, &mLoop, &cLoop, &foldlist, &foldlist_XS);
+  encode_seqs(s1, s2);
 
-  set_model_details(&md);
-  if ((!P) || (fabs(P->temperature - temperature) > 1e-6)) {
-    snoupdate_fold_params();
-    if (P)
-      free(P);
+  ws.S1             = S1;
+  ws.SS1            = SS1;
+  ws.S2             = S2;
+  ws.SS2            = SS2;
+  ws.n1             = (int)strlen(s1);
+  ws.n2             = (int)strlen(s2);
+  ws.foldlist       = foldlist;
+  ws.penalty        = penalty;
+  ws.half_stem      = half_stem;
+  ws.max_half_stem  = max_half_stem;
+  ws.min_s2         = min_s2;
+  ws.max_s2         = max_s2;
+  ws.min_s1         = min_s1;
+  ws.max_s1         = max_s1;
+  ws.min_d1         = min_d1;
+  ws.min_d2         = min_d2;
+  ws.position       = (int *)vrna_alloc((ws.n1 + 3) * sizeof(int));
+
+  /*
+   *  Each step of the recursion moves at most 4 positions back in the
+   *  target and at least one position forward in the snoRNA. Hence,
+   *  row i does not depend on rows before i - overlap, and the target
+   *  can be split into chunks that are scanned independently, each one
+   *  starting overlap rows ahead of its first position
+   */
+  overlap   = 4 * (ws.n2 + 1);
+  n_chunks  = 1;
+
+#ifdef _OPENMP
+  if (!omp_in_parallel())
+    n_chunks = MAX2(1,
+                    MIN2(4 * omp_get_max_threads(),
+                         (ws.n1 - 4) / (SNOOP_MIN_CHUNK * overlap)));
 
-    P = vrna_params(&md);
-    make_pair_matrix();
+#endif
+
+  chunk_size = (ws.n1 - 4 + n_chunks - 1) / n_chunks;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) if (n_chunks > 1)
+#endif
+  for (k = 0; k < n_chunks; k++) {
+    int from  = 5 + k * chunk_size;
+    int to    = MIN2(ws.n1, from + chunk_size - 1);
+
+    scan_rows(&ws, MAX2(5, from - overlap), from, to);
   }
 
-  lpair = (int **)vrna_alloc(sizeof(int *) * (6));
-  lc    = (int **)vrna_alloc(sizeof(int *) * (6));
-  lr    = (int **)vrna_alloc(sizeof(int *) * (6));
-  for (i = 0; i < 6; i++) {
+  max = INF;
+  for (i = 5; i <= ws.n1; i++)
+    max = MIN2(max, ws.position[i]);
+
+  free(S1);
+  free(S2);
+  free(SS1);
+  free(SS2);
+  if (max < threshTE) {
+    find_max_snoop(output,
+                   s1,
+                   s2,
+                   max,
+                   alignment_length,
+                   ws.position,
+                   delta,
+                   distance,
+                   penalty,
+                   threshloop,
+                   threshLE,
+                   threshRE,
+                   threshDE,
+                   threshTE,
+                   threshSE,
+                   threshD,
+                   half_stem,
+                   max_half_stem,
+                   min_s2,
+                   max_s2,
+                   min_s1,
+                   max_s1,
+                   min_d1,
+                   min_d2,
+                   name,
+                   fullStemEnergy);
+  }
+
+  free(ws.position);
+}
+
+
+/**
+*** scan_rows() computes ws->position[from..to] of Lsnoop_subopt_list()
+*** with a rolling window of five rows. The recursion is started at
+*** row start, all rows before are considered empty.
+**/
+PRIVATE void
+scan_rows(const snoop_scan_t  *ws,
+          int                 start,
+          int                 from,
+          int                 to)
+{
+  int           i, j, min_colonne;
+  int           **lc, **lr, **lpair;
+  const short   *S1     = ws->S1;
+  const short   *SS1    = ws->SS1;
+  const short   *S2     = ws->S2;
+  const short   *SS2    = ws->SS2;
+  const int     n2      = ws->n2;
+  const int     penalty = ws->penalty;
+
+  /* energy parameters and pair matrices are thread local */
+  update_snoop_params();
+
+  lpair = (int **)vrna_alloc(sizeof(int *) * 5);
+  lc    = (int **)vrna_alloc(sizeof(int *) * 5);
+  lr    = (int **)vrna_alloc(sizeof(int *) * 5);
+  for (i = 0; i < 5; i++) {
     lc[i]     = (int *)vrna_alloc(sizeof(int) * (n2 + 1));
     lr[i]     = (int *)vrna_alloc(sizeof(int) * (n2 + 1));
     lpair[i]  = (int *)vrna_alloc(sizeof(int) * (n2 + 1));
@@ -1374,19 +1575,19 @@ Lsnoop_subopt_list(const char *s1,
       lpair[i][j] = 0;
     }
   }
-  encode_seqs(s1, s2);
-  int lim_maxj  = n2 - min_d2;
-  int lim_minj  = min_d1;
-  int lim_maxi  = n1;
-  for (i = 5; i <= lim_maxi; i++) {
+
+  int lim_maxj  = n2 - ws->min_d2;
+  int lim_minj  = ws->min_d1;
+  for (i = start; i <= to; i++) {
     int idx   = i % 5;
     int idx_1 = (i - 1) % 5;
     int idx_2 = (i - 2) % 5;
     int idx_3 = (i - 3) % 5;
     int idx_4 = (i - 4) % 5;
 
+    min_colonne = INF;
     for (j = lim_maxj; j > lim_minj; j--) {
-      int type, type2;/*  E, k,l; */
+      int type, type2;
       type          = pair[S1[i]][S2[j]];
       lpair[idx][j] = type;
       lc[idx][j]    = (type) ? P->DuplexInit + 2 * penalty : INF;
@@ -1395,38 +1596,27 @@ Lsnoop_subopt_list(const char *s1,
         continue;
 
       if ( /*pair[S1[i+1]][S2[j-1]] && Be sure it binds*/
-        j < max_s1 && j > min_s1 &&
-        j > n2 - max_s2 - max_half_stem &&
-        j < n2 - min_s2 - half_stem && S1[i - 2] == 4) {
+        j < ws->max_s1 && j > ws->min_s1 &&
+        j > n2 - ws->max_s2 - ws->max_half_stem &&
+        j < n2 - ws->min_s2 - ws->half_stem && S1[i - 2] == 4) {
         /*constraint on s2 and i*/
-        int     min_k, max_k;
-        max_k = MIN2(n2 - min_s2, j + max_half_stem + 1);
-        min_k = MAX2(j + half_stem + 1, n2 - max_s2);
-        folden  *temp;
-        temp = foldlist[j + 1];
+        folden *temp;
+        temp = ws->foldlist[j + 1];
         while (temp->next) {
           int k = temp->k;
-          /* if(k >= min_k-1 && k < max_k){ comment to recover normal behaviour */
-          if (lpair[idx_3][k + 1] /*&& lpair[idx_4][k+2]*/)
-            lr[idx][j] = MIN2(lr[idx][j], lc[idx_3][k + 1] + temp->energy);   /*--NU--*/
+          if (lpair[idx_3][k + 1])                                            /*--NU--*/
+            lr[idx][j] = MIN2(lr[idx][j], lc[idx_3][k + 1] + temp->energy);
 
-          /*else*/ if (lpair[idx_4][k + 1])                                   /*--NUN--*/
+          if (lpair[idx_4][k + 1])                                            /*--NUN--*/
             lr[idx][j] = MIN2(lr[idx][j], lc[idx_4][k + 1] + temp->energy);
 
-          /*  } */
           temp = temp->next;
         }
       }
 
       /* dangle 5'SIDE relative to the mRNA  */
       lc[idx][j] += E_ExtLoop(type, SS1[i - 1], SS2[j + 1], P);
-      /**
-      ***      lc[idx][j] += P->dangle5[type][SS1[i-1]];
-      ***      lc[idx][j] += P->dangle3[type][SS2[j+1]];
-      ***      if (type>2) lc[idx][j] += P->TerminalAU;
-      **/
-      /*       if(j<n2 && i>1){ */
-      /* type2=pair[S1[i-1]][S2[j+1]]; */
+
       type2 = lpair[idx_1][j + 1];
       if (type2 > 0) {
         lc[idx][j] =
@@ -1441,9 +1631,6 @@ Lsnoop_subopt_list(const char *s1,
                lr[idx][j]);
       }
 
-      /* } */
-      /*       if(j<n2-1 && i>2){ */
-      /* type2=pair[S1[i-2]][S2[j+2]]; */
       type2 = lpair[idx_2][j + 2];
       if (type2 > 0) {
         lc[idx][j] =
@@ -1456,11 +1643,8 @@ Lsnoop_subopt_list(const char *s1,
                E_IntLoop(1, 1, type2, rtype[type], SS1[i - 1], SS2[j + 1], SS1[i - 1], SS2[j + 1],
                          P),
                lr[idx][j]);
-        /*         } */
       }
 
-      /*       if(j<n2-2 && i>3){ */
-      /* type2 = pair[S1[i-3]][S2[j+3]]; */
       type2 = lpair[idx_3][j + 3];
       if (type2 > 0) {
         lc[idx][j] =
@@ -1473,104 +1657,68 @@ Lsnoop_subopt_list(const char *s1,
                E_IntLoop(2, 2, type2, rtype[type], SS1[i - 2], SS2[j + 2], SS1[i - 1], SS2[j + 1],
                          P) + 6 * penalty,
                lr[idx][j]);
-        /*         } */
       }
 
-      /* min_colonne=MIN2(lr[idx][j]+(type>2?P->TerminalAU:0)+P->dangle3[rtype[type]][SS1[i+1]]+P->dangle5[rtype[type]][SS2[j-1]], min_colonne); */
       int bla;
       bla         = lr[idx][j] + E_ExtLoop(rtype[type], SS2[j - 1], SS1[i + 1], P) + 2 * penalty;
       min_colonne = MIN2(bla, min_colonne);
     }
-    position[i] = min_colonne;
-    if (max >= min_colonne) {
-      max     = min_colonne;
-      max_pos = i;
-    }
-
-    min_colonne = INF;
+    if (i >= from)
+      ws->position[i] = min_colonne;
   }
 
-  free(S1);
-  free(S2);
-  free(SS1);
-  free(SS2);
-  if (max < threshTE) {
-    find_max_snoop(s1,
-                   s2,
-                   max,
-                   alignment_length,
-                   position,
-                   delta,
-                   distance,
-                   penalty,
-                   threshloop,
-                   threshLE,
-                   threshRE,
-                   threshDE,
-                   threshTE,
-                   threshSE,
-                   threshD,
-                   half_stem,
-                   max_half_stem,
-                   min_s2,
-                   max_s2,
-                   min_s1,
-                   max_s1,
-                   min_d1,
-                   min_d2,
-                   name,
-                   fullStemEnergy);
-  }
-
-  for (i = 1; i < 6; i++) {
+  for (i = 0; i < 5; i++) {
     free(lc[i]);
     free(lr[i]);
     free(lpair[i]);
   }
-  free(lc[0]);
-  free(lr[0]);
-  free(lpair[0]);
   free(lc);
   free(lr);
   free(lpair);
-  free(position);
 }
 
 
 PRIVATE void
-find_max_snoop(const char *s1,
-               const char *s2,
-               const int  max,
-               const int  alignment_length,
-               const int  *position,
-               const int  delta,
-               const int  distance,
-               const int  penalty,
-               const int  threshloop,
-               const int  threshLE,
-               const int  threshRE,
-               const int  threshDE,
-               const int  threshTE,
-               const int  threshSE,
-               const int  threshD,
-               const int  half_stem,
-               const int  max_half_stem,
-               const int  min_s2,
-               const int  max_s2,
-               const int  min_s1,
-               const int  max_s1,
-               const int  min_d1,
-               const int  min_d2,
-               const char *name,
-               const int  fullStemEnergy)
+find_max_snoop(vrna_cstr_t  output,
+               const char   *s1,
+               const char   *s2,
+               const int    max,
+               const int    alignment_length,
+               const int    *position,
+               const int    delta,
+               const int    distance,
+               const int    penalty,
+               const int    threshloop,
+               const int    threshLE,
+               const int    threshRE,
+               const int    threshDE,
+               const int    threshTE,
+               const int    threshSE,
+               const int    threshD,
+               const int    half_stem,
+               const int    max_half_stem,
+               const int    min_s2,
+               const int    max_s2,
+               const int    min_s1,
+               const int    max_s1,
+               const int    min_d1,
+               const int    min_d2,
+               const char   *name,
+               const int    fullStemEnergy)
 {
-  int count     = 0;
-  int pos       = n1 + 1;
-  int threshold = MIN2(threshTE, max + delta);
-
-  /* printf("threshTE %d max %d\n", threshTE, max); */
-  /* #pragma omp parallel for */
-  /*   for(pos=n1+1;pos>distance;pos--){ */
+  int         count     = 0;
+  int         n1        = (int)strlen(s1);
+  int         n2        = (int)strlen(s2);
+  int         pos       = n1 + 1;
+  int         threshold = MIN2(threshTE, max + delta);
+  int         h, n_hits, *hit_pos, *hit_begin;
+  char        **hit_seq;
+  snoopT      *hit_mfe;
+
+  /* collect the target windows first, they do not depend on the refolding */
+  n_hits    = 0;
+  hit_pos   = (int *)vrna_alloc(sizeof(int) * (n1 + 1));
+  hit_begin = (int *)vrna_alloc(sizeof(int) * (n1 + 1));
   while (pos-- > 5) {
     int temp_min = 0;
     if (position[pos] < (threshold)) {
@@ -1580,124 +1728,157 @@ find_max_snoop(const char *s1,
         if (position[pos - search_range] <= position[pos - temp_min])
           temp_min = search_range;
 
-      pos -= temp_min;
-      int     begin = MAX2(6, pos - alignment_length + 1);
-      char    *s3   = (char *)vrna_alloc(sizeof(char) * (pos - begin + 3 + 12));
-      strcpy(s3, "NNNNN");
-      strncat(s3, (s1 + begin - 1), pos - begin + 2);
-      strcat(s3, "NNNNN\0");
-      /* printf("%s s3\n", s3);  */
-      snoopT  test;
-      test = snoopfold(s3,
-                       s2,
-                       penalty,
-                       threshloop,
-                       threshLE,
-                       threshRE,
-                       threshDE,
-                       threshD,
-                       half_stem,
-                       max_half_stem,
-                       min_s2,
-                       max_s2,
-                       min_s1,
-                       max_s1,
-                       min_d1,
-                       min_d2,
-                       fullStemEnergy);
-      if (test.energy == INF) {
-        free(s3);
-        continue;
-      }
+      pos                 -= temp_min;
+      hit_pos[n_hits]     = pos;
+      hit_begin[n_hits++] = MAX2(6, pos - alignment_length + 1);
+    }
+  }
 
-      if (test.Duplex_El > threshLE * 0.01 || test.Duplex_Er > threshRE * 0.01 ||
-          test.Loop_D > threshD * 0.01 || (test.Duplex_Er + test.Duplex_El) > threshDE * 0.01 ||
-          (test.Duplex_Er + test.Duplex_El + test.Loop_E + test.Loop_D + 410) > threshSE * 0.01) {
-        free(test.structure);
-        free(s3);
-        continue;
-      }
+  hit_seq = (char **)vrna_alloc(sizeof(char *) * (n_hits + 1));
+  hit_mfe = (snoopT *)vrna_alloc(sizeof(snoopT) * (n_hits + 1));
 
-      int l1;
-      l1 = strchr(test.structure, '&') - test.structure;
+  for (h = 0; h < n_hits; h++) {
+    int   begin = hit_begin[h];
+    char  *s3   = (char *)vrna_alloc(sizeof(char) * (hit_pos[h] - begin + 3 + 12));
+    strcpy(s3, "NNNNN");
+    strncat(s3, (s1 + begin - 1), hit_pos[h] - begin + 2);
+    strcat(s3, "NNNNN\0");
+    hit_seq[h] = s3;
+  }
 
-      int shift = 0;
-      if (test.i > (int)strlen(s3) - 10) {
-        test.i--;
-        l1--;
-      }
+  /* refold the windows, possibly in parallel */
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) if (n_hits > 1 && !omp_in_parallel())
+#endif
+  for (h = 0; h < n_hits; h++)
+    hit_mfe[h] = fold_snoop(hit_seq[h],
+                            s2,
+                            penalty,
+                            threshloop,
+                            threshLE,
+                            threshRE,
+                            threshDE,
+                            threshD,
+                            half_stem,
+                            max_half_stem,
+                            min_s2,
+                            max_s2,
+                            min_s1,
+                            max_s1,
+                            min_d1,
+                            min_d2,
+                            fullStemEnergy);
+
+  /* report the hits in the order they were found */
+  for (h = 0; h < n_hits; h++) {
+    int     begin = hit_begin[h];
+    char    *s3   = hit_seq[h];
+    snoopT  test  = hit_mfe[h];
+
+    if (test.energy == INF) {
+      snoop_printf(output, "no target found under the constraints chosen\n");
+      free(s3);
+      continue;
+    }
 
-      if (test.i - l1 < 0) {
-        l1--;
-        shift++;
-      }
+    if (test.Duplex_El > threshLE * 0.01 || test.Duplex_Er > threshRE * 0.01 ||
+        test.Loop_D > threshD * 0.01 || (test.Duplex_Er + test.Duplex_El) > threshDE * 0.01 ||
+        (test.Duplex_Er + test.Duplex_El + test.Loop_E + test.Loop_D + 410) > threshSE * 0.01) {
+      free(test.structure);
+      free(s3);
+      continue;
+    }
 
-      char *target_struct = (char *)vrna_alloc(sizeof(char) * (strlen(test.structure) + 1));
-      strncpy(target_struct, test.structure + shift, l1);
-      strncat(target_struct, test.structure + (strchr(test.structure, '&') -
-                                               test.structure),
-              (int)strlen(test.structure) - (strchr(test.structure, '&') -
-                                             test.
-                                             structure));
-      strcat(target_struct, "\0");
-      char  *target;
-      target = (char *)vrna_alloc(l1 + 1);
-      strncpy(target, (s3 + test.i + 5 - l1), l1);
-      target[l1] = '\0';
-      char  *s4;
-      s4 = (char *)vrna_alloc(sizeof(char) * (strlen(s2) - 9));
-      strncpy(s4, s2 + 5, (int)strlen(s2) - 10);
-      s4[(int)strlen(s2) - 10] = '\0';
-      printf(
-        "%s %3d,%-3d;%3d : %3d,%-3d (%5.2f = %5.2f + %5.2f + %5.2f + %5.2f + 4.1 ) (%5.2f) \n%s&%s\n",
-        target_struct,
-        begin + test.i - 5 - l1,
-        begin + test.i - 6,
-        begin + test.u - 6,
-        test.j + 1,
-        test.j + (int)(strrchr(test.structure, '>') - strchr(test.structure, '>')) + 1,
-        test.Loop_D + test.Duplex_El + test.Duplex_Er + test.Loop_E + 4.10,
-        test.Duplex_El,
-        test.Duplex_Er,
-        test.Loop_E,
-        test.Loop_D,
-        test.fullStemEnergy,
-        target,
-        s4);
-      if (name) {
-        char  *temp_seq;
-        char  *temp_struc;
-        char  *psoutput;
-        temp_seq    = (char *)vrna_alloc(sizeof(char) * (l1 + n2 - 9));
-        temp_struc  = (char *)vrna_alloc(sizeof(char) * (l1 + n2 - 9));
-        strcpy(temp_seq, target);
-        strcat(temp_seq, s4);
-        strncpy(temp_struc, target_struct, l1);
-        strcat(temp_struc, target_struct + l1 + 1);
-        temp_seq[n2 + l1 - 10]    = '\0';
-        temp_struc[n2 + l1 - 10]  = '\0';
-        cut_point                 = l1 + 1;
-        psoutput                  = vrna_strdup_printf("sno_%d_u_%d_%s.ps",
-                                                       count,
-                                                       begin + test.u - 6,
-                                                       name);
+    int l1;
+    l1 = strchr(test.structure, '&') - test.structure;
 
+    int shift = 0;
+    if (test.i > (int)strlen(s3) - 10) {
+      test.i--;
+      l1--;
+    }
+
+    if (test.i - l1 < 0) {
+      l1--;
+      shift++;
+    }
+
+    char *target_struct = (char *)vrna_alloc(sizeof(char) * (strlen(test.structure) + 1));
+    strncpy(target_struct, test.structure + shift, l1);
+    strncat(target_struct, test.structure + (strchr(test.structure, '&') -
+                                             test.structure),
+            (int)strlen(test.structure) - (strchr(test.structure, '&') -
+                                           test.
+                                           structure));
+    strcat(target_struct, "\0");
+    char  *target;
+    target = (char *)vrna_alloc(l1 + 1);
+    strncpy(target, (s3 + test.i + 5 - l1), l1);
+    target[l1] = '\0';
+    char  *s4;
+    s4 = (char *)vrna_alloc(sizeof(char) * (strlen(s2) - 9));
+    strncpy(s4, s2 + 5, (int)strlen(s2) - 10);
+    s4[(int)strlen(s2) - 10] = '\0';
+    snoop_printf(output,
+                 "%s %3d,%-3d;%3d : %3d,%-3d (%5.2f = %5.2f + %5.2f + %5.2f + %5.2f + 4.1 ) (%5.2f) \n%s&%s\n",
+                 target_struct,
+                 begin + test.i - 5 - l1,
+                 begin + test.i - 6,
+                 begin + test.u - 6,
+                 test.j + 1,
+                 test.j + (int)(strrchr(test.structure, '>') - strchr(test.structure, '>')) + 1,
+                 test.Loop_D + test.Duplex_El + test.Duplex_Er + test.Loop_E + 4.10,
+                 test.Duplex_El,
+                 test.Duplex_Er,
+                 test.Loop_E,
+                 test.Loop_D,
+                 test.fullStemEnergy,
+                 target,
+                 s4);
+    if (name) {
+      char  *temp_seq;
+      char  *temp_struc;
+      char  *psoutput;
+      temp_seq    = (char *)vrna_alloc(sizeof(char) * (l1 + n2 - 9));
+      temp_struc  = (char *)vrna_alloc(sizeof(char) * (l1 + n2 - 9));
+      strcpy(temp_seq, target);
+      strcat(temp_seq, s4);
+      strncpy(temp_struc, target_struct, l1);
+      strcat(temp_struc, target_struct + l1 + 1);
+      temp_seq[n2 + l1 - 10]    = '\0';
+      temp_struc[n2 + l1 - 10]  = '\0';
+      psoutput                  = vrna_strdup_printf("sno_%d_u_%d_%s.ps",
+                                                     count,
+                                                     begin + test.u - 6,
+                                                     name);
+
+      /* the plot routine reads the global cut_point */
+#ifdef _OPENMP
+#pragma omp critical (snoop_plot)
+#endif
+      {
+        cut_point = l1 + 1;
         PS_rna_plot_snoop_a(temp_seq, temp_struc, psoutput, NULL, NULL);
         cut_point = -1;
-        free(temp_seq);
-        free(temp_struc);
-        free(psoutput);
-        count++;
-        /* free(psoutput); */
       }
 
-      free(s4);
-      free(test.structure);
-      free(target_struct);
-      free(target);
-      free(s3);
+      free(temp_seq);
+      free(temp_struc);
+      free(psoutput);
+      count++;
     }
+
+    free(s4);
+    free(test.structure);
+    free(target_struct);
+    free(target);
+    free(s3);
   }
+
+  free(hit_pos);
+  free(hit_begin);
+  free(hit_seq);
+  free(hit_mfe);
 }
 
 
@@ -1719,6 +1900,93 @@ snoopfold(const char  *s1,
           const int   min_d1,
           const int   min_d2,
           const int   fullStemEnergy)
+{
+  return snoopfold_cstr(NULL,
+                        s1,
+                        s2,
+                        penalty,
+                        threshloop,
+                        threshLE,
+                        threshRE,
+                        threshDE,
+                        threshD,
+                        half_stem,
+                        max_half_stem,
+                        min_s2,
+                        max_s2,
+                        min_s1,
+                        max_s1,
+                        min_d1,
+                        min_d2,
+                        fullStemEnergy);
+}
+
+
+snoopT
+snoopfold_cstr(vrna_cstr_t  output,
+               const char   *s1,
+               const char   *s2,
+               const int    penalty,
+               const int    threshloop,
+               const int    threshLE,
+               const int    threshRE,
+               const int    threshDE,
+               const int    threshD,
+               const int    half_stem,
+               const int    max_half_stem,
+               const int    min_s2,
+               const int    max_s2,
+               const int    min_s1,
+               const int    max_s1,
+               const int    min_d1,
+               const int    min_d2,
+               const int    fullStemEnergy)
+{
+  snoopT mfe;
+
+  mfe = fold_snoop(s1,
+                   s2,
+                   penalty,
+                   threshloop,
+                   threshLE,
+                   threshRE,
+                   threshDE,
+                   threshD,
+                   half_stem,
+                   max_half_stem,
+                   min_s2,
+                   max_s2,
+                   min_s1,
+                   max_s1,
+                   min_d1,
+                   min_d2,
+                 fullStemEnergy);
+
+  if (mfe.energy == INF)
+    snoop_printf(output, "no target found under the constraints chosen\n");
+
+  return mfe;
+}
+
+
+PRIVATE snoopT
+fold_snoop(const char *s1,
+           const char *s2,
+           const int  penalty,
+           const int  threshloop,
+           const int  threshLE,
+           const int  threshRE,
+           const int  threshDE,
+           const int  threshD,
+           const int  half_stem,
+           const int  max_half_stem,
+           const int  min_s2,
+           const int  max_s2,
+           const int  min_s1,
+           const int  max_s1,
+           const int  min_d1,
+           const int  min_d2,
+           const int  fullStemEnergy)
 {
   /* int Eminj, Emin_l; */
   int       i, j, l1, Emin = INF, i_min = 0, j_min = 0;
@@ -1732,7 +2000,6 @@ snoopfold(const char  *s1,
   int       Loop_D;
   int       u;
   int       Loop_E;
-  vrna_md_t md;
 
   Duplex_El = 0;
   Duplex_Er = 0;
@@ -1741,15 +2008,7 @@ snoopfold(const char  *s1,
   n1  = (int)strlen(s1);
   n2  = (int)strlen(s2);
 
-  set_model_details(&md);
-  if ((!P) || (fabs(P->temperature - temperature) > 1e-6)) {
-    snoupdate_fold_params();
-    if (P)
-      free(P);
-
-    P = vrna_params(&md);
-    make_pair_matrix();
-  }
+  update_snoop_params();
 
   c = (int **)vrna_alloc(sizeof(int *) * (n1 + 1));
   r = (int **)vrna_alloc(sizeof(int *) * (n1 + 1));
@@ -1834,7 +2093,6 @@ snoopfold(const char  *s1,
     }
   }
   if (Emin > 0) {
-    printf("no target found under the constraints chosen\n");
     for (i = 0; i <= n1; i++) {
       free(r[i]);
       free(c[i]);
@@ -1913,7 +2171,6 @@ snoopfold_XS_fill(const char  *s1,
   int       Loop_D;
   /* int u; */
   int       Loop_E;
-  vrna_md_t md;
 
   Duplex_El = 0;
   Duplex_Er = 0;
@@ -1922,15 +2179,7 @@ snoopfold_XS_fill(const char  *s1,
   n1  = (int)strlen(s1);
   n2  = (int)strlen(s2);
 
-  set_model_details(&md);
-  if ((!P) || (fabs(P->temperature - temperature) > 1e-6)) {
-    snoupdate_fold_params();
-    if (P)
-      free(P);
-
-    P = vrna_params(&md);
-    make_pair_matrix();
-  }
+  update_snoop_params();
 
   c_fill  = (int **)vrna_alloc(sizeof(int *) * (n1 + 1));
   r_fill  = (int **)vrna_alloc(sizeof(int *) * (n1 + 1));
@@ -2052,6 +2301,57 @@ snoop_subopt(const char *s1,
              const int  min_d1,
              const int  min_d2,
              const int  fullStemEnergy)
+{
+  return snoop_subopt_cstr(NULL,
+                           s1,
+                           s2,
+                           delta,
+                           w,
+                           penalty,
+                           threshloop,
+                           threshLE,
+                           threshRE,
+                           threshDE,
+                           threshTE,
+                           threshSE,
+                           threshD,
+                           distance,
+                           half_stem,
+                           max_half_stem,
+                           min_s2,
+                           max_s2,
+                           min_s1,
+                           max_s1,
+                           min_d1,
+                           min_d2,
+                           fullStemEnergy);
+}
+
+
+PUBLIC snoopT *
+snoop_subopt_cstr(vrna_cstr_t  output,
+                  const char   *s1,
+                  const char   *s2,
+                  int          delta,
+                  int          w,
+                  const int    penalty,
+                  const int    threshloop,
+                  const int    threshLE,
+                  const int    threshRE,
+                  const int    threshDE,
+                  const int    threshTE,
+                  const int    threshSE,
+                  const int    threshD,
+                  const int    distance,
+                  const int    half_stem,
+                  const int    max_half_stem,
+                  const int    min_s2,
+                  const int    max_s2,
+                  const int    min_s1,
+                  const int    max_s1,
+                  const int    min_d1,
+                  const int    min_d2,
+                  const int    fullStemEnergy)
 {
   /* printf("%d %d\n", min_s2, max_s2); */
   int     i, j, n1, n2, E, n_subopt = 0, n_max;
@@ -2072,9 +2372,9 @@ snoop_subopt(const char *s1,
   n_max       = 16;
   subopt      = (snoopT *)vrna_alloc(n_max * sizeof(snoopT));
   delay_free  = 1;
-  mfe         = snoopfold(s1, s2, penalty, threshloop, threshLE, threshRE, threshDE, threshD,
-                          half_stem, max_half_stem,
-                          min_s2, max_s2, min_s1, max_s1, min_d1, min_d2, fullStemEnergy);
+  mfe         = snoopfold_cstr(output, s1, s2, penalty, threshloop, threshLE, threshRE, threshDE,
+                               threshD, half_stem, max_half_stem,
+                               min_s2, max_s2, min_s1, max_s1, min_d1, min_d2, fullStemEnergy);
 
 
   if (mfe.energy > 0) {
@@ -2540,9 +2840,13 @@ snoop_backtrack(int         i,
                   for (b = 0; b < MISMATCH; b++) {
                     int ij = indx[k - 1 - a + 1] + j + 1 + b;
                     if (cLoop[ij] == temp->energy) {
-                      struc_loop  = snobacktrack_fold_from_pair(snoseq, j + 1 + b, k - a - 1 + 1);
-                      a           = INF;
-                      b           = INF;
+                      /* backtracking in the snoRNA uses the global arrays of snofold() */
+#ifdef _OPENMP
+#pragma omp critical (snofold_backtrack)
+#endif
+                      struc_loop = snobacktrack_fold_from_pair(snoseq, j + 1 + b, k - a - 1 + 1);
+                      a = INF;
+                      b = INF;
                     }
                   }
                 }
@@ -2566,9 +2870,13 @@ snoop_backtrack(int         i,
                   for (b = 0; b < MISMATCH; b++) {
                     int ij = indx[k - 1 - a + 1] + j + 1 + b;
                     if (cLoop[ij] == temp->energy) {
-                      struc_loop  = snobacktrack_fold_from_pair(snoseq, j + 1 + b, k - a - 1 + 1);
-                      a           = INF;
-                      b           = INF;
+                      /* backtracking in the snoRNA uses the global arrays of snofold() */
+#ifdef _OPENMP
+#pragma omp critical (snofold_backtrack)
+#endif
+                      struc_loop = snobacktrack_fold_from_pair(snoseq, j + 1 + b, k - a - 1 + 1);
+                      a = INF;
+                      b = INF;
                     }
                   }
                 }
@@ -2760,22 +3068,13 @@ Lsnoop_subopt_list_XS(const char  *s1,
   int       Loop_D;
   /* int u; */
   int       Loop_E;
-  vrna_md_t md;
 
   Duplex_El = 0;
   Duplex_Er = 0;
   Loop_E    = 0, Loop_D = 0;
   snoexport_fold_arrays(&indx, &mLoop, &cLoop, &foldlist, &foldlist_XS);
 
-  set_model_details(&md);
-  if ((!P) || (fabs(P->temperature - temperature) > 1e-6)) {
-    snoupdate_fold_params();
-    if (P)
-      free(P);
-
-    P = vrna_params(&md);
-    make_pair_matrix();
-  }
+  update_snoop_params();
 
   lpair = (int **)vrna_alloc(sizeof(int *) * (6));
   lc    = (int **)vrna_alloc(sizeof(int *) * (6));
@@ -3149,7 +3448,6 @@ snoopfold_XS(const char *s1,
   int       Loop_D;
   int       u;
   int       Loop_E;
-  vrna_md_t md;
 
   Duplex_El = 0;
   Duplex_Er = 0;
@@ -3158,15 +3456,7 @@ snoopfold_XS(const char *s1,
   n1  = (int)strlen(s1);
   n2  = (int)strlen(s2);
 
-  set_model_details(&md);
-  if ((!P) || (fabs(P->temperature - temperature) > 1e-6)) {
-    snoupdate_fold_params();
-    if (P)
-      free(P);
-
-    P = vrna_params(&md);
-    make_pair_matrix();
-  }
+  update_snoop_params();
 
   c = (int **)vrna_alloc(sizeof(int *) * (n1 + 1));
   r = (int **)vrna_alloc(sizeof(int *) * (n1 + 1));
@@ -3734,3 +4024,51 @@ compare(const void  *sub1,
 
   return ((snoopT *)sub1)->j - ((snoopT *)sub2)->j;
 }
+
+
+/**
+*** snoop_printf writes to the character stream output if one is given,
+*** and to stdout otherwise
+**/
+PRIVATE void
+snoop_printf(vrna_cstr_t  output,
+             const char   *format,
+             ...)
+{
+  va_list args;
+
+  va_start(args, format);
+  if (output)
+    vrna_cstr_vprintf(output, format, args);
+  else
+    vprintf(format, args);
+
+  va_end(args);
+}
+
+
+PRIVATE void
+update_snoop_params(void)
+{
+  vrna_md_t md;
+
+  if ((!P) || (fabs(P->temperature - temperature) > 1e-6)) {
+    /*
+     *  the energy parameters of snofold() are shared among threads and
+     *  replaced here, so this must not interfere with backtracking into
+     *  the snoRNA. The pair matrices of both, snofold() and snoop, are
+     *  thread local
+     */
+#ifdef _OPENMP
+#pragma omp critical (snofold_backtrack)
+#endif
+    snoupdate_fold_params();
+
+    set_model_details(&md);
+    if (P)
+      free(P);
+
+    P = vrna_params(&md);
+    make_pair_matrix();
+  }
+}
@@ -2,6 +2,7 @@
 #define VIENNA_RNA_PACKAGE_SNOOP_H
 
 #include <ViennaRNA/datastructures/basic.h>
+#include <ViennaRNA/datastructures/char_stream.h>
 /**
 *** computes snoRNA-RNA interactions in RNAduplex manner
 **/
@@ -25,6 +26,32 @@ snoopT snoopfold(const char *s1,
                  const int  fullStemEnergy);
 
 
+/**
+*** same as snoopfold() but writes its messages to the character stream
+*** output instead of stdout, see vrna_cstr(). Output may be NULL. Under
+*** OpenMP, several threads may call this function simultaneously.
+**/
+
+
+snoopT snoopfold_cstr(vrna_cstr_t  output,
+                      const char   *s1,
+                      const char   *s2,
+                      const int    penalty,
+                      const int    threshloop,
+                      const int    threshLE,
+                      const int    threshRE,
+                      const int    threshDE,
+                      const int    threshD,
+                      const int    half_stem,
+                      const int    max_half_stem,
+                      const int    min_s2,
+                      const int    max_s2,
+                      const int    min_s1,
+                      const int    max_s1,
+                      const int    min_d1,
+                      const int    min_d2,
+                      const int    fullStemEnergy);
+
 /**
 *** computes snoRNA-RNA suboptimal interactions in RNAduplex manner
 **/
@@ -54,6 +81,36 @@ snoopT *snoop_subopt(const char *s1,
                      const int  fullStemEnergy);
 
 
+/**
+*** same as snoop_subopt() but writes its messages to the character stream
+*** output instead of stdout. Thread-safe under OpenMP like snoopfold_cstr().
+**/
+
+
+snoopT *snoop_subopt_cstr(vrna_cstr_t  output,
+                          const char   *s1,
+                          const char   *s2,
+                          int          delta,
+                          int          w,
+                          const int    penalty,
+                          const int    threshloop,
+                          const int    threshLE,
+                          const int    threshRE,
+                          const int    threshDE,
+                          const int    threshTE,
+                          const int    threshSE,
+                          const int    threshD,
+                          const int    distance,
+                          const int    half_stem,
+                          const int    max_half_stem,
+                          const int    min_s2,
+                          const int    max_s2,
+                          const int    min_s1,
+                          const int    max_s1,
+                          const int    min_d1,
+                          const int    min_d2,
+                          const int    fullStemEnergy);
+
 /**
 *** computes snoRNA-RNA suboptimal interactions in a RNAplex manner
 **/
@@ -116,6 +173,41 @@ void Lsnoop_subopt_list(const char  *s1,
                         const int   fullStemEnergy);
 
 
+/**
+*** same as Lsnoop_subopt_list() but writes the interactions to the character
+*** stream output instead of stdout. Under OpenMP, the scan of long targets
+*** and the refolding of the hits are distributed among the available threads
+*** unless the function is called from within a parallel region. The output
+*** does not depend on the number of threads.
+**/
+
+
+void Lsnoop_subopt_list_cstr(vrna_cstr_t  output,
+                             const char   *s1,
+                             const char   *s2,
+                             int          delta,
+                             int          w,
+                             const int    penalty,
+                             const int    threshloop,
+                             const int    threshLE,
+                             const int    threshRE,
+                             const int    threshDE,
+                             const int    threshTE,
+                             const int    threshSE,
+                             const int    threshD,
+                             const int    distance,
+                             const int    half_stem,
+                             const int    max_half_stem,
+                             const int    min_s2,
+                             const int    max_s2,
+                             const int    min_s1,
+                             const int    max_s1,
+                             const int    min_d1,
+                             const int    min_d2,
+                             const int    alignment_length,
+                             const char   *name,
+                             const int    fullStemEnergy);
+
 /**
 *** computes snoRNA-RNA suboptimal interactions in a RNAplex manner. The stem energy is saved into a list of struct, leading to a runtime improvement of 20%. It considers accessibility
 **/
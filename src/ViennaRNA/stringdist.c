@@ -16,6 +16,14 @@
 #include "ViennaRNA/edit_cost.h"
 #include "ViennaRNA/dist_vars.h"
 #include "ViennaRNA/utils/basic.h"
+#include "ViennaRNA/stringdist.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/* number of strings per side of a tile in vrna_string_edit_distance_matrix() */
+#define DIST_TILE 16
 
 PUBLIC float
 string_edit_distance(swString *T1,
@@ -35,15 +43,18 @@ print_alignment_list(void);
 
 
 PRIVATE void
-sprint_aligned_swStrings(swString *T1,
-                         swString *T2);
+sprint_aligned_swStrings(int      *alignment[2],
+                         swString *T1,
+                         swString *T2,
+                         char     *aligned[2]);
 
 
 PRIVATE float
-StrEditCost(int       i,
-            int       j,
-            swString  *T1,
-            swString  *T2);
+StrEditCost(CostMatrix  *cost,
+            int         i,
+            int         j,
+            swString    *T1,
+            swString    *T2);
 
 
 PRIVATE void
@@ -62,9 +73,7 @@ encode(int  type,
        char label[]);
 
 
-PRIVATE int *alignment[2];       /* contains information from backtracking
-                                  *  alignment[0][n] is the node in tree2
-                                  *  matching node n in tree1               */
+PRIVATE vrna_dist_ws_t *backward_compat_ws = NULL;
 
 
 /*---------------------------------------------------------------------------*/
@@ -72,101 +81,146 @@ PRIVATE int *alignment[2];       /* contains information from backtracking
 PUBLIC float
 string_edit_distance(swString *T1,
                      swString *T2)
-
 {
-  float **distance;
-  short **i_point, **j_point;
+  unsigned int  options;
+  float         dist;
 
-  int   i, j, i1, j1, pos, length1, length2;
-  float minus, plus, change, temp;
+  if (!backward_compat_ws)
+    backward_compat_ws = vrna_dist_ws_init();
 
-  if (cost_matrix == 0)
-    EditCost = &UsualCost;
-  else
-    EditCost = &ShapiroCost;
+  options = VRNA_DIST_DEFAULT;
 
-  i_point = NULL;
-  j_point = NULL;
-  length1 = T1[0].sign;
-  length2 = T2[0].sign;
+  if (cost_matrix != 0)
+    options |= VRNA_DIST_SHAPIRO_COSTS;
+
+  if (edit_backtrack)
+    options |= VRNA_DIST_BACKTRACK;
+
+  dist = vrna_string_edit_distance(backward_compat_ws, T1, T2, options);
 
-  distance = (float **)vrna_alloc((length1 + 1) * sizeof(float *));
   if (edit_backtrack) {
-    i_point = (short **)vrna_alloc((length1 + 1) * sizeof(short *));
-    j_point = (short **)vrna_alloc((length1 + 1) * sizeof(short *));
+    /* hand the alignment over to the global aligned_line */
+    free(aligned_line[0]);
+    free(aligned_line[1]);
+    aligned_line[0]                     = backward_compat_ws->aligned_line[0];
+    aligned_line[1]                     = backward_compat_ws->aligned_line[1];
+    backward_compat_ws->aligned_line[0] = NULL;
+    backward_compat_ws->aligned_line[1] = NULL;
+  }
+
+  return dist;
+}
+
+
+/*---------------------------------------------------------------------------*/
+
+PUBLIC float
+vrna_string_edit_distance(vrna_dist_ws_t  *ws,
+                          swString        *T1,
+                          swString        *T2,
+                          unsigned int    options)
+{
+  float       *distance;
+  short       *i_point, *j_point;
+  int         i, j, i1, j1, pos, length1, length2, cols, backtrack, **alignment;
+  size_t      size;
+  float       minus, plus, change, temp;
+  CostMatrix  *cost;
+
+  cost      = (options & VRNA_DIST_SHAPIRO_COSTS) ? &ShapiroCost : &UsualCost;
+  backtrack = (options & VRNA_DIST_BACKTRACK) ? 1 : 0;
+  i_point   = NULL;
+  j_point   = NULL;
+  length1   = T1[0].sign;
+  length2   = T2[0].sign;
+  cols      = length2 + 1;
+
+  /* re-use the matrices of the workspace if they are large enough */
+  size = (size_t)(length1 + 1) * (length2 + 1);
+  if (size > ws->string_size) {
+    free(ws->sdist);
+    ws->sdist       = (float *)vrna_alloc(sizeof(float) * size);
+    ws->string_size = size;
   }
 
-  for (i = 0; i <= length1; i++) {
-    distance[i] = (float *)vrna_alloc((length2 + 1) * sizeof(float));
-    if (edit_backtrack) {
-      i_point[i]  = (short *)vrna_alloc((length2 + 1) * sizeof(short));
-      j_point[i]  = (short *)vrna_alloc((length2 + 1) * sizeof(short));
+  distance    = ws->sdist;
+  distance[0] = 0.;
+
+  if (backtrack) {
+    if (size > ws->point_size) {
+      free(ws->i_point);
+      free(ws->j_point);
+      ws->i_point     = (short *)vrna_alloc(sizeof(short) * size);
+      ws->j_point     = (short *)vrna_alloc(sizeof(short) * size);
+      ws->point_size  = size;
     }
+
+    i_point = ws->i_point;
+    j_point = ws->j_point;
   }
 
   for (i = 1; i <= length1; i++) {
-    if (edit_backtrack) {
-      i_point[i][0] = i - 1;
-      j_point[i][0] = 0;
+    if (backtrack) {
+      i_point[i * cols] = i - 1;
+      j_point[i * cols] = 0;
     }
 
-    distance[i][0] = distance[i - 1][0] + StrEditCost(i, 0, T1, T2);
+    distance[i * cols] = distance[(i - 1) * cols] + StrEditCost(cost, i, 0, T1, T2);
   }
   for (j = 1; j <= length2; j++) {
-    if (edit_backtrack) {
-      j_point[0][j] = j - 1;
-      i_point[0][j] = 0;
+    if (backtrack) {
+      j_point[j]  = j - 1;
+      i_point[j]  = 0;
     }
 
-    distance[0][j] = distance[0][j - 1] + StrEditCost(0, j, T1, T2);
+    distance[j] = distance[j - 1] + StrEditCost(cost, 0, j, T1, T2);
   }
 
   for (i = 1; i <= length1; i++) {
     for (j = 1; j <= length2; j++) {
-      minus   = distance[i - 1][j] + StrEditCost(i, 0, T1, T2);
-      plus    = distance[i][j - 1] + StrEditCost(0, j, T1, T2);
-      change  = distance[i - 1][j - 1] + StrEditCost(i, j, T1, T2);
-
-      distance[i][j] = MIN3(minus, plus, change);
-      /* printf("%g ", distance[i][j]); */
-
-      if (edit_backtrack) {
-        if (distance[i][j] == change) {
-          i_point[i][j] = i - 1;
-          j_point[i][j] = j - 1;
-        } else if (distance[i][j] == plus) {
-          i_point[i][j] = i;
-          j_point[i][j] = j - 1;
+      minus   = distance[(i - 1) * cols + j] + StrEditCost(cost, i, 0, T1, T2);
+      plus    = distance[i * cols + j - 1] + StrEditCost(cost, 0, j, T1, T2);
+      change  = distance[(i - 1) * cols + j - 1] + StrEditCost(cost, i, j, T1, T2);
+
+      distance[i * cols + j] = MIN3(minus, plus, change);
+
+      if (backtrack) {
+        if (distance[i * cols + j] == change) {
+          i_point[i * cols + j] = i - 1;
+          j_point[i * cols + j] = j - 1;
+        } else if (distance[i * cols + j] == plus) {
+          i_point[i * cols + j] = i;
+          j_point[i * cols + j] = j - 1;
         } else {
-          i_point[i][j] = i - 1;
-          j_point[i][j] = j;
+          i_point[i * cols + j] = i - 1;
+          j_point[i * cols + j] = j;
         }
       }
     }
-    /* printf("\n"); */
   }
-  /* printf("\n"); */
-  temp = distance[length1][length2];
-  for (i = 0; i <= length1; i++)
-    free(distance[i]);
-  free(distance);
-
-  if (edit_backtrack) {
-    if (alignment[0] != NULL)
-      free(alignment[0]);
-
-    if (alignment[1] != NULL)
-      free(alignment[1]);
+  temp = distance[length1 * cols + length2];
+
+  if (backtrack) {
+    size = (size_t)(length1 + length2 + 1);
+    if (size > ws->alignment_size) {
+      free(ws->alignment[0]);
+      free(ws->alignment[1]);
+      ws->alignment[0]    = (int *)vrna_alloc(size * sizeof(int));
+      ws->alignment[1]    = (int *)vrna_alloc(size * sizeof(int));
+      ws->alignment_size  = size;
+    } else {
+      memset(ws->alignment[0], 0, size * sizeof(int));
+      memset(ws->alignment[1], 0, size * sizeof(int));
+    }
 
-    alignment[0]  = (int *)vrna_alloc((length1 + length2 + 1) * sizeof(int));
-    alignment[1]  = (int *)vrna_alloc((length1 + length2 + 1) * sizeof(int));
+    alignment = ws->alignment;
 
     pos = length1 + length2;
     i   = length1;
     j   = length2;
     while ((i > 0) || (j > 0)) {
-      i1  = i_point[i][j];
-      j1  = j_point[i][j];
+      i1  = i_point[i * cols + j];
+      j1  = j_point[i * cols + j];
       if (((i - i1) == 1) && ((j - j1) == 1)) {
         /* substitution    */
         alignment[0][pos] = i;
@@ -195,47 +249,96 @@ string_edit_distance(swString *T1,
     }
     alignment[0][0] = length1 + length2 - pos;  /* length of alignment */
 
-    for (i = 0; i <= length1; i++) {
-      free(i_point[i]);
-      free(j_point[i]);
-    }
-    free(i_point);
-    free(j_point);
-    sprint_aligned_swStrings(T1, T2);
+    sprint_aligned_swStrings(alignment, T1, T2, ws->aligned_line);
   }
 
   return temp;
 }
 
 
+/*---------------------------------------------------------------------------*/
+
+PUBLIC float *
+vrna_string_edit_distance_matrix(swString     **strings,
+                                 unsigned int options)
+{
+  float *matrix;
+  int   n, p, num_tiles, num_tile_pairs;
+
+  if (!strings)
+    return NULL;
+
+  for (n = 0; strings[n]; n++) ;
+
+  if (n < 2)
+    return NULL;
+
+  matrix = (float *)vrna_alloc(sizeof(float) * n * (n - 1) / 2);
+
+  /* alignments of the individual pairs are not available */
+  options &= ~VRNA_DIST_BACKTRACK;
+
+  /* tiles of the lower triangle, dynamically assigned to idle threads */
+  num_tiles       = (n + DIST_TILE - 1) / DIST_TILE;
+  num_tile_pairs  = num_tiles * (num_tiles + 1) / 2;
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+  {
+    vrna_dist_ws_t *ws = vrna_dist_ws_init();
+
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+    for (p = 0; p < num_tile_pairs; p++) {
+      int ti, tj, i, j;
+
+      /* decode the index of the tile pair */
+      for (ti = 0; (ti + 1) * (ti + 2) / 2 <= p; ti++) ;
+      tj = p - ti * (ti + 1) / 2;
+
+      for (i = ti * DIST_TILE; (i < n) && (i < (ti + 1) * DIST_TILE); i++)
+        for (j = tj * DIST_TILE; (j < i) && (j < (tj + 1) * DIST_TILE); j++)
+          matrix[i * (i - 1) / 2 + j] = vrna_string_edit_distance(ws, strings[i], strings[j], options);
+    }
+
+    vrna_dist_ws_free(ws);
+  }
+
+  return matrix;
+}
+
+
 /*---------------------------------------------------------------------------*/
 
 PRIVATE float
-StrEditCost(int       i,
-            int       j,
-            swString  *T1,
-            swString  *T2)
+StrEditCost(CostMatrix  *cost,
+            int         i,
+            int         j,
+            swString    *T1,
+            swString    *T2)
 {
   float c, diff, cd, min, a, b, dist;
 
   if (i == 0) {
-    cd    = (float)(*EditCost)[0][T2[j].type];
+    cd    = (float)(*cost)[0][T2[j].type];
     diff  = T2[j].weight;
     dist  = cd * diff;
   } else
   if (j == 0) {
-    cd    = (float)(*EditCost)[T1[i].type][0];
+    cd    = (float)(*cost)[T1[i].type][0];
     diff  = T1[i].weight;
     dist  = cd * diff;
   } else
   if (((T1[i].sign) * (T2[j].sign)) > 0) {
-    c     = (float)(*EditCost)[T1[i].type][T2[j].type];
+    c     = (float)(*cost)[T1[i].type][T2[j].type];
     diff  = (float)fabs((a = T1[i].weight) - (b = T2[j].weight));
     min   = MIN2(a, b);
     if (min == a)
-      cd = (float)(*EditCost)[0][T2[j].type];
+      cd = (float)(*cost)[0][T2[j].type];
     else
-      cd = (float)(*EditCost)[T1[i].type][0];
+      cd = (float)(*cost)[T1[i].type][0];
 
     dist = c * min + cd * diff;
   } else {
@@ -442,8 +545,10 @@ encode(int  type,
 /*---------------------------------------------------------------------------*/
 
 PRIVATE void
-sprint_aligned_swStrings(swString *T1,
-                         swString *T2)
+sprint_aligned_swStrings(int      *alignment[2],
+                         swString *T1,
+                         swString *T2,
+                         char     *aligned[2])
 {
   int   i, j, l0, l1, ltmp = 0, weights;
   char  label[10], *a0, *a1, tmp0[20], tmp1[20];
@@ -509,19 +614,12 @@ sprint_aligned_swStrings(swString *T1,
     strcat(a1, tmp1);
     ltmp = strlen(a0);
   }
-  if (aligned_line[0] != NULL) {
-    free(aligned_line[0]);
-    aligned_line[0] = NULL;
-  }
-
-  if (aligned_line[1] != NULL) {
-    free(aligned_line[1]);
-    aligned_line[1] = NULL;
-  }
+  free(aligned[0]);
+  free(aligned[1]);
 
-  aligned_line[0] = strdup(a0);
+  aligned[0] = strdup(a0);
   free(a0);
-  aligned_line[1] = strdup(a1);
+  aligned[1] = strdup(a1);
   free(a1);
 }
 
@@ -545,7 +643,12 @@ print_swString(swString *x)
 PUBLIC void
 print_alignment_list(void)
 {
-  int i;
+  int i, **alignment;
+
+  if (!backward_compat_ws)
+    return;
+
+  alignment = backward_compat_ws->alignment;
 
   printf("\n");
   for (i = 1; i <= alignment[0][0]; i++)
@@ -27,4 +27,43 @@ swString *Make_swString(char *string);
 float     string_edit_distance( swString *T1,
                                 swString *T2);
 
+/**
+ *  \brief Calculate the string edit distance of T1 and T2 using a workspace.
+ *
+ *  In contrast to string_edit_distance(), this function does not depend on the global
+ *  variables #cost_matrix and #edit_backtrack but takes the corresponding settings
+ *  from \p options. All memory is taken from the workspace \p ws and re-used in
+ *  subsequent calls. Hence, it may be called concurrently with different workspaces.
+ *  If \p options contains #VRNA_DIST_BACKTRACK, the aligned structures are stored
+ *  in the \p aligned_line member of the workspace.
+ *
+ *  \see vrna_dist_ws_init(), vrna_string_edit_distance_matrix(), #VRNA_DIST_SHAPIRO_COSTS,
+ *  #VRNA_DIST_BACKTRACK
+ *
+ *  \param  ws      The workspace
+ *  \param  T1      The first string
+ *  \param  T2      The second string
+ *  \param  options Options for the distance computation
+ *  \return         The string edit distance between \p T1 and \p T2
+ */
+float     vrna_string_edit_distance(vrna_dist_ws_t  *ws,
+                                    swString        *T1,
+                                    swString        *T2,
+                                    unsigned int    options);
+
+/**
+ *  \brief Calculate the string edit distances between all pairs of a list of strings.
+ *
+ *  Same as vrna_tree_edit_distance_matrix(), but for strings.
+ *
+ *  \see vrna_string_edit_distance(), vrna_tree_edit_distance_matrix()
+ *
+ *  \param  strings A \em NULL terminated list of strings
+ *  \param  options Options for the distance computation
+ *  \return         The lower triangle of the distance matrix, or \em NULL if the list
+ *                  has less than two entries
+ */
+float     *vrna_string_edit_distance_matrix(swString      **strings,
+                                            unsigned int  options);
+
 #endif
@@ -15,12 +15,39 @@
 #include "ViennaRNA/edit_cost.h"
 #include "ViennaRNA/dist_vars.h"
 #include "ViennaRNA/utils/basic.h"
+#include "ViennaRNA/treedist.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #define PRIVATE  static
 #define PUBLIC
 
 #define MNODES    4000    /* Maximal number of nodes for alignment    */
 
+/* number of trees per side of a tile in vrna_tree_edit_distance_matrix() */
+#define DIST_TILE 16
+
+#define TDIST(i, j)  ctx->tdist[(i) * ctx->cols + (j)]
+#define FDIST(i, j)  ctx->fdist[(i) * ctx->cols + (j)]
+
+/* state of a single tree edit distance computation */
+typedef struct {
+  Tree        *tree1;
+  Tree        *tree2;
+  CostMatrix  *cost;
+  int         *tdist;         /* contains distances between subtrees */
+  int         *fdist;         /* contains distances between forests */
+  size_t      cols;
+  int         *alignment[2];  /* contains numeric information on the alignment:
+                               * alignment[0][p], aligment[1][p] are aligned postions.
+                               * INDELs have one 0.
+                               * alignment[0][0] contains the length of the alignment. */
+} tree_ctx_t;
+
+PRIVATE vrna_dist_ws_t *backward_compat_ws = NULL;
+
 PUBLIC Tree *
 make_tree(char *struc);
 
@@ -39,13 +66,15 @@ free_tree(Tree *t);
 
 
 PRIVATE void
-tree_dist(int i,
-          int j);
+tree_dist(tree_ctx_t  *ctx,
+          int         i,
+          int         j);
 
 
 PRIVATE int
-edit_cost(int i,
-          int j);
+edit_cost(tree_ctx_t  *ctx,
+          int         i,
+          int         j);
 
 
 PRIVATE int *
@@ -83,133 +112,232 @@ print_postorder_list(Postorder_list *pl);
 
 
 PRIVATE void
-backtracking(void);
+backtracking(tree_ctx_t *ctx);
 
 
 PRIVATE void
-sprint_aligned_trees(void);
+sprint_aligned_trees(tree_ctx_t *ctx,
+                     char       *aligned[2]);
 
 
-PRIVATE Tree  *tree1, *tree2;
-PRIVATE int   **tdist;        /* contains distances between subtrees */
-PRIVATE int   **fdist;        /* contains distances between forests */
-PRIVATE int   *alignment[2];  /* contains numeric information on the alignment:
-                               * alignment[0][p], aligment[1][p] are aligned postions.
-                               * INDELs have one 0.
-                               * alignment[0][0] contains the length of the alignment. */
-
 /*---------------------------------------------------------------------------*/
 
 PUBLIC float
 tree_edit_distance(Tree *T1,
                    Tree *T2)
 {
-  int i1, j1, i, j, dist;
-  int n1, n2;
+  unsigned int  options;
+  float         dist;
 
-  if (cost_matrix == 0)
-    EditCost = &UsualCost;
-  else
-    EditCost = &ShapiroCost;
+  if (!backward_compat_ws)
+    backward_compat_ws = vrna_dist_ws_init();
+
+  options = VRNA_DIST_DEFAULT;
+
+  if (cost_matrix != 0)
+    options |= VRNA_DIST_SHAPIRO_COSTS;
+
+  if (edit_backtrack)
+    options |= VRNA_DIST_BACKTRACK;
+
+  dist = vrna_tree_edit_distance(backward_compat_ws, T1, T2, options);
+
+  if (edit_backtrack) {
+    /* hand the alignment over to the global aligned_line */
+    free(aligned_line[0]);
+    free(aligned_line[1]);
+    aligned_line[0]                     = backward_compat_ws->aligned_line[0];
+    aligned_line[1]                     = backward_compat_ws->aligned_line[1];
+    backward_compat_ws->aligned_line[0] = NULL;
+    backward_compat_ws->aligned_line[1] = NULL;
+  }
+
+  return dist;
+}
+
+
+/*---------------------------------------------------------------------------*/
+
+PUBLIC float
+vrna_tree_edit_distance(vrna_dist_ws_t  *ws,
+                        Tree            *T1,
+                        Tree            *T2,
+                        unsigned int    options)
+{
+  int         i1, j1, i, j, dist;
+  int         n1, n2;
+  size_t      size;
+  tree_ctx_t  c, *ctx;
+
+  ctx = &c;
 
   n1  = T1->postorder_list[0].sons;
   n2  = T2->postorder_list[0].sons;
 
-  tdist = (int **)vrna_alloc(sizeof(int *) * (n1 + 1));
-  fdist = (int **)vrna_alloc(sizeof(int *) * (n1 + 1));
-  for (i = 0; i <= n1; i++) {
-    tdist[i]  = (int *)vrna_alloc(sizeof(int) * (n2 + 1));
-    fdist[i]  = (int *)vrna_alloc(sizeof(int) * (n2 + 1));
+  /* re-use the matrices of the workspace if they are large enough */
+  size = (size_t)(n1 + 1) * (n2 + 1);
+  if (size > ws->tree_size) {
+    free(ws->tdist);
+    free(ws->fdist);
+    ws->tdist     = (int *)vrna_alloc(sizeof(int) * size);
+    ws->fdist     = (int *)vrna_alloc(sizeof(int) * size);
+    ws->tree_size = size;
+  } else {
+    memset(ws->tdist, 0, sizeof(int) * size);
+    memset(ws->fdist, 0, sizeof(int) * size);
   }
 
-  tree1 = T1;
-  tree2 = T2;
+  ctx->tree1  = T1;
+  ctx->tree2  = T2;
+  ctx->cost   = (options & VRNA_DIST_SHAPIRO_COSTS) ? &ShapiroCost : &UsualCost;
+  ctx->tdist  = ws->tdist;
+  ctx->fdist  = ws->fdist;
+  ctx->cols   = (size_t)(n2 + 1);
 
   for (i1 = 1; i1 <= T1->keyroots[0]; i1++) {
     i = T1->keyroots[i1];
     for (j1 = 1; j1 <= T2->keyroots[0]; j1++) {
       j = T2->keyroots[j1];
 
-      tree_dist(i, j);
+      tree_dist(ctx, i, j);
     }
   }
 
-  if (edit_backtrack) {
+  if (options & VRNA_DIST_BACKTRACK) {
     if ((n1 > MNODES) || (n2 > MNODES))
       vrna_message_error("tree too large for alignment");
 
-    alignment[0]  = (int *)vrna_alloc((n1 + 1) * sizeof(int));
-    alignment[1]  = (int *)vrna_alloc((n2 + 1) * sizeof(int));
+    size = (size_t)MAX2(n1, n2) + 1;
+    if (size > ws->alignment_size) {
+      free(ws->alignment[0]);
+      free(ws->alignment[1]);
+      ws->alignment[0]    = (int *)vrna_alloc(size * sizeof(int));
+      ws->alignment[1]    = (int *)vrna_alloc(size * sizeof(int));
+      ws->alignment_size  = size;
+    } else {
+      memset(ws->alignment[0], 0, size * sizeof(int));
+      memset(ws->alignment[1], 0, size * sizeof(int));
+    }
 
-    backtracking();
-    sprint_aligned_trees();
-    free(alignment[0]);
-    free(alignment[1]);
-  }
+    ctx->alignment[0] = ws->alignment[0];
+    ctx->alignment[1] = ws->alignment[1];
 
-  dist = tdist[n1][n2];
-  for (i = 0; i <= n1; i++) {
-    free(tdist[i]);
-    free(fdist[i]);
+    backtracking(ctx);
+    sprint_aligned_trees(ctx, ws->aligned_line);
   }
-  free(tdist);
-  free(fdist);
+
+  dist = TDIST(n1, n2);
 
   return (float)dist;
 }
 
 
+/*---------------------------------------------------------------------------*/
+
+PUBLIC float *
+vrna_tree_edit_distance_matrix(Tree         **trees,
+                               unsigned int options)
+{
+  float *matrix;
+  int   n, p, num_tiles, num_tile_pairs;
+
+  if (!trees)
+    return NULL;
+
+  for (n = 0; trees[n]; n++) ;
+
+  if (n < 2)
+    return NULL;
+
+  matrix = (float *)vrna_alloc(sizeof(float) * n * (n - 1) / 2);
+
+  /* alignments of the individual pairs are not available */
+  options &= ~VRNA_DIST_BACKTRACK;
+
+  /* tiles of the lower triangle, dynamically assigned to idle threads */
+  num_tiles       = (n + DIST_TILE - 1) / DIST_TILE;
+  num_tile_pairs  = num_tiles * (num_tiles + 1) / 2;
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+  {
+    vrna_dist_ws_t *ws = vrna_dist_ws_init();
+
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+    for (p = 0; p < num_tile_pairs; p++) {
+      int ti, tj, i, j;
+
+      /* decode the index of the tile pair */
+      for (ti = 0; (ti + 1) * (ti + 2) / 2 <= p; ti++) ;
+      tj = p - ti * (ti + 1) / 2;
+
+      for (i = ti * DIST_TILE; (i < n) && (i < (ti + 1) * DIST_TILE); i++)
+        for (j = tj * DIST_TILE; (j < i) && (j < (tj + 1) * DIST_TILE); j++)
+          matrix[i * (i - 1) / 2 + j] = vrna_tree_edit_distance(ws, trees[i], trees[j], options);
+    }
+
+    vrna_dist_ws_free(ws);
+  }
+
+  return matrix;
+}
+
+
 /*---------------------------------------------------------------------------*/
 
 PRIVATE void
-tree_dist(int i,
-          int j)
+tree_dist(tree_ctx_t  *ctx,
+          int         i,
+          int         j)
 {
   int li, lj, i1, j1, i1_1, j1_1, li1_1, lj1_1, f1, f2, f3, f;
   int cost, lleaf_i1, lleaf_j1;
 
-  fdist[0][0] = 0;
+  FDIST(0, 0) = 0;
 
-  li  = tree1->postorder_list[i].leftmostleaf;
-  lj  = tree2->postorder_list[j].leftmostleaf;
+  li  = ctx->tree1->postorder_list[i].leftmostleaf;
+  lj  = ctx->tree2->postorder_list[j].leftmostleaf;
 
   for (i1 = li; i1 <= i; i1++) {
     i1_1          = (li == i1 ? 0 : i1 - 1);
-    fdist[i1][0]  = fdist[i1_1][0] + edit_cost(i1, 0);
+    FDIST(i1, 0)  = FDIST(i1_1, 0) + edit_cost(ctx, i1, 0);
   }
 
   for (j1 = lj; j1 <= j; j1++) {
     j1_1          = (lj == j1 ? 0 : j1 - 1);
-    fdist[0][j1]  = fdist[0][j1_1] + edit_cost(0, j1);
+    FDIST(0, j1)  = FDIST(0, j1_1) + edit_cost(ctx, 0, j1);
   }
 
   for (i1 = li; i1 <= i; i1++) {
-    lleaf_i1  = tree1->postorder_list[i1].leftmostleaf;
+    lleaf_i1  = ctx->tree1->postorder_list[i1].leftmostleaf;
     li1_1     = (li > lleaf_i1 - 1 ? 0 : lleaf_i1 - 1);
     i1_1      = (i1 == li ? 0 : i1 - 1);
-    cost      = edit_cost(i1, 0);
+    cost      = edit_cost(ctx, i1, 0);
 
     for (j1 = lj; j1 <= j; j1++) {
-      lleaf_j1  = tree2->postorder_list[j1].leftmostleaf;
+      lleaf_j1  = ctx->tree2->postorder_list[j1].leftmostleaf;
       j1_1      = (j1 == lj ? 0 : j1 - 1);
 
-      f1  = fdist[i1_1][j1] + cost;
-      f2  = fdist[i1][j1_1] + edit_cost(0, j1);
+      f1  = FDIST(i1_1, j1) + cost;
+      f2  = FDIST(i1, j1_1) + edit_cost(ctx, 0, j1);
 
       f = f1 < f2 ? f1 : f2;
 
       if (lleaf_i1 == li && lleaf_j1 == lj) {
-        f3 = fdist[i1_1][j1_1] + edit_cost(i1, j1);
+        f3 = FDIST(i1_1, j1_1) + edit_cost(ctx, i1, j1);
 
-        fdist[i1][j1] = f3 < f ? f3 : f;
+        FDIST(i1, j1) = f3 < f ? f3 : f;
 
-        tdist[i1][j1] = fdist[i1][j1]; /* store in array permanently */
+        TDIST(i1, j1) = FDIST(i1, j1); /* store in array permanently */
       } else {
         lj1_1 = (lj > lleaf_j1 - 1 ? 0 : lleaf_j1 - 1);
 
-        f3 = fdist[li1_1][lj1_1] + tdist[i1][j1];
+        f3 = FDIST(li1_1, lj1_1) + TDIST(i1, j1);
 
-        fdist[i1][j1] = f3 < f ? f3 : f;
+        FDIST(i1, j1) = f3 < f ? f3 : f;
       }
     }
   }
@@ -219,20 +347,21 @@ tree_dist(int i,
 /*---------------------------------------------------------------------------*/
 
 PRIVATE int
-edit_cost(int i,
-          int j)
+edit_cost(tree_ctx_t  *ctx,
+          int         i,
+          int         j)
 {
   int c, diff, cd, min, a, b;
 
-  c = (*EditCost)[tree1->postorder_list[i].type][tree2->postorder_list[j].type];
+  c = (*ctx->cost)[ctx->tree1->postorder_list[i].type][ctx->tree2->postorder_list[j].type];
 
-  diff = abs((a = tree1->postorder_list[i].weight) - (b = tree2->postorder_list[j].weight));
+  diff = abs((a = ctx->tree1->postorder_list[i].weight) - (b = ctx->tree2->postorder_list[j].weight));
 
   min = (a < b ? a : b);
   if (min == a)
-    cd = (*EditCost)[0][tree2->postorder_list[j].type];
+    cd = (*ctx->cost)[0][ctx->tree2->postorder_list[j].type];
   else
-    cd = (*EditCost)[0][tree1->postorder_list[i].type];
+    cd = (*ctx->cost)[0][ctx->tree1->postorder_list[i].type];
 
   return c * min + cd * diff;
 }
@@ -582,7 +711,7 @@ free_tree(Tree *t)
 
 
 PRIVATE void
-backtracking(void)
+backtracking(tree_ctx_t *ctx)
 {
   int li, lj, i1, j1, i1_1, j1_1, li1_1, lj1_1, f;
   int cost, lleaf_i1, lleaf_j1, ss, i, j, k;
@@ -593,35 +722,35 @@ backtracking(void)
 
   ss = 0;
 
-  i = i1 = tree1->postorder_list[0].sons;
-  j = j1 = tree2->postorder_list[0].sons;
+  i = i1 = ctx->tree1->postorder_list[0].sons;
+  j = j1 = ctx->tree2->postorder_list[0].sons;
 
 start:
-  li  = tree1->postorder_list[i].leftmostleaf;
-  lj  = tree2->postorder_list[j].leftmostleaf;
+  li  = ctx->tree1->postorder_list[i].leftmostleaf;
+  lj  = ctx->tree2->postorder_list[j].leftmostleaf;
 
 
   while ((i1 >= li) && (j1 >= lj)) {
-    lleaf_i1  = tree1->postorder_list[i1].leftmostleaf;
+    lleaf_i1  = ctx->tree1->postorder_list[i1].leftmostleaf;
     li1_1     = (li > lleaf_i1 - 1 ? 0 : lleaf_i1 - 1);
     i1_1      = (i1 == li ? 0 : i1 - 1);
-    lleaf_j1  = tree2->postorder_list[j1].leftmostleaf;
+    lleaf_j1  = ctx->tree2->postorder_list[j1].leftmostleaf;
     lj1_1     = (lj > lleaf_j1 - 1 ? 0 : lleaf_j1 - 1);
     j1_1      = (j1 == lj ? 0 : j1 - 1);
 
-    f = fdist[i1][j1];
+    f = FDIST(i1, j1);
 
-    cost = edit_cost(i1, 0);
-    if (f == fdist[i1_1][j1] + cost) {
-      alignment[0][i1]  = 0;
+    cost = edit_cost(ctx, i1, 0);
+    if (f == FDIST(i1_1, j1) + cost) {
+      ctx->alignment[0][i1]  = 0;
       i1                = i1_1;
     } else {
-      if (f == fdist[i1][j1_1] + edit_cost(0, j1)) {
-        alignment[1][j1]  = 0;
+      if (f == FDIST(i1, j1_1) + edit_cost(ctx, 0, j1)) {
+        ctx->alignment[1][j1]  = 0;
         j1                = j1_1;
       } else if (lleaf_i1 == li && lleaf_j1 == lj) {
-        alignment[0][i1]  = j1;
-        alignment[1][j1]  = i1;
+        ctx->alignment[0][i1]  = j1;
+        ctx->alignment[1][j1]  = i1;
         i1                = i1_1;
         j1                = j1_1;
       } else {
@@ -633,29 +762,29 @@ start:
     }
   }
   for (; i1 >= li; ) {
-    alignment[0][i1]  = 0;
+    ctx->alignment[0][i1]  = 0;
     i1                = (i1 == li ? 0 : i1 - 1);
   }
   for (; j1 >= lj; ) {
-    alignment[1][j1]  = 0;
+    ctx->alignment[1][j1]  = 0;
     j1                = (j1 == lj ? 0 : j1 - 1);
   }
   while (ss > 0) {
     i1  = sector[--ss].i;
     j1  = sector[ss].j;
     for (k = 1; 1; k++) {
-      i = tree1->keyroots[k];
-      if (tree1->postorder_list[i].leftmostleaf ==
-          tree1->postorder_list[i1].leftmostleaf)
+      i = ctx->tree1->keyroots[k];
+      if (ctx->tree1->postorder_list[i].leftmostleaf ==
+          ctx->tree1->postorder_list[i1].leftmostleaf)
         break;
     }
     for (k = 1; 1; k++) {
-      j = tree2->keyroots[k];
-      if (tree2->postorder_list[j].leftmostleaf ==
-          tree2->postorder_list[j1].leftmostleaf)
+      j = ctx->tree2->keyroots[k];
+      if (ctx->tree2->postorder_list[j].leftmostleaf ==
+          ctx->tree2->postorder_list[j1].leftmostleaf)
         break;
     }
-    tree_dist(i, j);
+    tree_dist(ctx, i, j);
     goto start;
   }
 }
@@ -664,50 +793,51 @@ start:
 /*---------------------------------------------------------------------------*/
 
 PRIVATE void
-sprint_aligned_trees(void)
+sprint_aligned_trees(tree_ctx_t *ctx,
+                     char       *aligned[2])
 {
   int   i, j, n1, n2, k, l, p, ni, nj, weights;
   char  t1[2 * MNODES + 1], t2[2 * MNODES + 1], a1[8 * MNODES], a2[8 * MNODES], ll[20], ll1[20];
 
   weights = 0;
-  n1      = tree1->postorder_list[0].sons;
-  n2      = tree2->postorder_list[0].sons;
+  n1      = ctx->tree1->postorder_list[0].sons;
+  n2      = ctx->tree2->postorder_list[0].sons;
   for (i = 1; i <= n1; i++)
-    weights |= (tree1->postorder_list[i].weight != 1);
+    weights |= (ctx->tree1->postorder_list[i].weight != 1);
   for (i = 1; i <= n2; i++)
-    weights |= (tree2->postorder_list[i].weight != 1);
+    weights |= (ctx->tree2->postorder_list[i].weight != 1);
 
   for (i = n1, l = 2 * n1 - 1; i > 0; i--) {
-    if (alignment[0][i] != 0)
+    if (ctx->alignment[0][i] != 0)
       t1[l--] = ']';
     else
       t1[l--] = ')';
 
     p = i;
-    while (i == tree1->postorder_list[p].leftmostleaf) {
-      if (alignment[0][p] != 0)
+    while (i == ctx->tree1->postorder_list[p].leftmostleaf) {
+      if (ctx->alignment[0][p] != 0)
         t1[l--] = '[';
       else
         t1[l--] = '(';
 
-      p = tree1->postorder_list[p].father;
+      p = ctx->tree1->postorder_list[p].father;
     }
   }
   t1[2 * n1] = '\0';
   for (j = n2, l = 2 * n2 - 1; j > 0; j--) {
-    if (alignment[1][j] != 0)
+    if (ctx->alignment[1][j] != 0)
       t2[l--] = ']';
     else
       t2[l--] = ')';
 
     p = j;
-    while (j == tree2->postorder_list[p].leftmostleaf) {
-      if (alignment[1][p] != 0)
+    while (j == ctx->tree2->postorder_list[p].leftmostleaf) {
+      if (ctx->alignment[1][p] != 0)
         t2[l--] = '[';
       else
         t2[l--] = '(';
 
-      p = tree2->postorder_list[p].father;
+      p = ctx->tree2->postorder_list[p].father;
     }
   }
   t2[2 * n2] = '\0';
@@ -717,9 +847,9 @@ sprint_aligned_trees(void)
     while ((t1[i] == '(') || (t1[i] == ')')) {
       if (t1[i] == ')') {
         ni++;
-        encode(tree1->postorder_list[ni].type, ll);
+        encode(ctx->tree1->postorder_list[ni].type, ll);
         if (weights)
-          sprintf(ll + strlen(ll), "%d", tree1->postorder_list[ni].weight);
+          sprintf(ll + strlen(ll), "%d", ctx->tree1->postorder_list[ni].weight);
 
         for (k = 0; k < strlen(ll); k++) {
           a1[l]   = ll[k];
@@ -738,9 +868,9 @@ sprint_aligned_trees(void)
     while ((t2[j] == '(') || (t2[j] == ')')) {
       if (t2[j] == ')') {
         nj++;
-        encode(tree2->postorder_list[nj].type, ll);
+        encode(ctx->tree2->postorder_list[nj].type, ll);
         if (weights)
-          sprintf(ll + strlen(ll), "%d", tree2->postorder_list[nj].weight);
+          sprintf(ll + strlen(ll), "%d", ctx->tree2->postorder_list[nj].weight);
 
         for (k = 0; k < strlen(ll); k++) {
           a2[l]   = ll[k];
@@ -759,13 +889,13 @@ sprint_aligned_trees(void)
     if (t2[j] == ']') {
       ni++;
       nj++;
-      encode(tree2->postorder_list[nj].type, ll);
+      encode(ctx->tree2->postorder_list[nj].type, ll);
       if (weights)
-        sprintf(ll + strlen(ll), "%d", tree2->postorder_list[nj].weight);
+        sprintf(ll + strlen(ll), "%d", ctx->tree2->postorder_list[nj].weight);
 
-      encode(tree1->postorder_list[ni].type, ll1);
+      encode(ctx->tree1->postorder_list[ni].type, ll1);
       if (weights)
-        sprintf(ll1 + strlen(ll1), "%d", tree1->postorder_list[ni].weight);
+        sprintf(ll1 + strlen(ll1), "%d", ctx->tree1->postorder_list[ni].weight);
 
       if (strlen(ll) > strlen(ll1))
         for (k = 0; k < strlen(ll) - strlen(ll1); k++)
@@ -795,16 +925,13 @@ sprint_aligned_trees(void)
   if (l > 8 * MNODES)
     vrna_message_error("structure too long in sprint_aligned_trees");
 
-  if (aligned_line[0] != NULL)
-    free(aligned_line[0]);
-
-  if (aligned_line[1] != NULL)
-    free(aligned_line[1]);
+  free(aligned[0]);
+  free(aligned[1]);
 
-  aligned_line[0] = (char *)vrna_alloc((l + 1) * sizeof(char));
-  aligned_line[1] = (char *)vrna_alloc((l + 1) * sizeof(char));
-  strcpy(aligned_line[0], a1);
-  strcpy(aligned_line[1], a2);
+  aligned[0]  = (char *)vrna_alloc((l + 1) * sizeof(char));
+  aligned[1]  = (char *)vrna_alloc((l + 1) * sizeof(char));
+  strcpy(aligned[0], a1);
+  strcpy(aligned[1], a2);
 }
 
 
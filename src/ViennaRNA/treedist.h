@@ -29,6 +29,53 @@ float   tree_edit_distance(Tree *T1,
                            Tree *T2);
 
 
+/**
+ *  \brief Calculates the edit distance of the two trees using a workspace.
+ *
+ *  In contrast to tree_edit_distance(), this function does not depend on the global
+ *  variables #cost_matrix and #edit_backtrack but takes the corresponding settings
+ *  from \p options. All memory is taken from the workspace \p ws and re-used in
+ *  subsequent calls. Hence, it may be called concurrently with different workspaces.
+ *  If \p options contains #VRNA_DIST_BACKTRACK, the aligned structures are stored
+ *  in the \p aligned_line member of the workspace.
+ *
+ *  \see vrna_dist_ws_init(), vrna_tree_edit_distance_matrix(), #VRNA_DIST_SHAPIRO_COSTS,
+ *  #VRNA_DIST_BACKTRACK
+ *
+ *  \param ws      The workspace
+ *  \param T1      The first tree
+ *  \param T2      The second tree
+ *  \param options Options for the distance computation
+ *  \return        The tree edit distance between \p T1 and \p T2
+ */
+float   vrna_tree_edit_distance(vrna_dist_ws_t  *ws,
+                                Tree            *T1,
+                                Tree            *T2,
+                                unsigned int    options);
+
+
+/**
+ *  \brief Calculates the edit distances between all pairs of a list of trees.
+ *
+ *  The matrix is split into tiles that are distributed among all available
+ *  threads if OpenMP is available. Each thread re-uses its own workspace for
+ *  all of its pairs. #VRNA_DIST_BACKTRACK is ignored.
+ *
+ *  The lower triangle of the distance matrix is returned in row-major order
+ *  without the diagonal, i.e. the distance between trees \f$i > j\f$ (0-based)
+ *  is found at position \f$i(i-1)/2 + j\f$.
+ *
+ *  \see vrna_tree_edit_distance()
+ *
+ *  \param trees   A \em NULL terminated list of trees
+ *  \param options Options for the distance computation
+ *  \return        The lower triangle of the distance matrix, or \em NULL if the list
+ *                 has less than two entries
+ */
+float   *vrna_tree_edit_distance_matrix(Tree          **trees,
+                                        unsigned int  options);
+
+
 /**
  *  \brief Print a tree (mainly for debugging)
  */
@@ -20,6 +20,7 @@
 #include <ctype.h>
 #include <float.h>
 #include <math.h>
+#include <stdint.h>
 
 #include "ViennaRNA/utils/basic.h"
 #include "ViennaRNA/alphabet.h"
@@ -318,6 +319,22 @@ PRIVATE void
 free_default_data(struct ligands_up_data_default *data);
 
 
+PRIVATE void
+motif_index_free(vrna_ud_t *ud);
+
+
+PRIVATE void
+motif_index_prepare(vrna_fold_compound_t *vc);
+
+
+PRIVATE int *
+motif_index_get(vrna_ud_t           *ud,
+                const unsigned int  *ptr,
+                const int           *list,
+                int                 i,
+                unsigned int        loop_type);
+
+
 PRIVATE int *
 get_motifs(vrna_fold_compound_t *vc,
            int                  i,
@@ -724,6 +741,31 @@ vrna_ud_get_motifs_at(vrna_fold_compound_t  *vc,
 }
 
 
+PUBLIC int *
+vrna_ud_get_motifs_ending_at(vrna_fold_compound_t *vc,
+                             int                  j,
+                             unsigned int         loop_type)
+{
+  vrna_ud_t *domains_up;
+
+  if (vc && vc->domains_up) {
+    if ((j > 0) && (j <= vc->length)) {
+      domains_up = vc->domains_up;
+
+      motif_index_prepare(vc);
+
+      return motif_index_get(domains_up,
+                             domains_up->index_end_ptr,
+                             domains_up->index_end,
+                             j,
+                             loop_type);
+    }
+  }
+
+  return NULL;
+}
+
+
 vrna_ud_motif_t *
 vrna_ud_detect_motifs(vrna_fold_compound_t  *vc,
                       const char            *structure)
@@ -998,6 +1040,8 @@ remove_ligands_up(vrna_fold_compound_t *vc)
 
   free(vc->domains_up->uniq_motif_size);
 
+  motif_index_free(vc->domains_up);
+
   free(vc->domains_up);
 
   vc->domains_up = NULL;
@@ -1017,6 +1061,11 @@ init_ligands_up(vrna_fold_compound_t *vc)
   vc->domains_up->motif_size        = NULL;
   vc->domains_up->motif_en          = NULL;
   vc->domains_up->motif_type        = NULL;
+  vc->domains_up->index_n           = 0;
+  vc->domains_up->index_start_ptr   = NULL;
+  vc->domains_up->index_start       = NULL;
+  vc->domains_up->index_end_ptr     = NULL;
+  vc->domains_up->index_end         = NULL;
   vc->domains_up->prod_cb           = NULL;
   vc->domains_up->exp_prod_cb       = NULL;
   vc->domains_up->energy_cb         = NULL;
@@ -1637,6 +1686,9 @@ add_ligand_motif(vrna_fold_compound_t *vc,
   ud->motif_type[ud->motif_count] = loop_type;
 
   ud->motif_count++;
+
+  /* the motif index is outdated now */
+  motif_index_free(ud);
 }
 
 
@@ -1819,42 +1871,234 @@ get_motifs(vrna_fold_compound_t *vc,
            int                  i,
            unsigned int         loop_type)
 {
-  int       k, j, u, n, *motif_list, cnt, guess;
-  char      *sequence;
   vrna_ud_t *domains_up;
 
-  sequence    = vc->sequence;
-  n           = (int)vc->length;
+  domains_up = vc->domains_up;
+
+  /* collect list of motif numbers we find that start at position i */
+  motif_index_prepare(vc);
+
+  return motif_index_get(domains_up,
+                         domains_up->index_start_ptr,
+                         domains_up->index_start,
+                         i,
+                         loop_type);
+}
+
+
+PRIVATE void
+motif_index_free(vrna_ud_t *ud)
+{
+  free(ud->index_start_ptr);
+  free(ud->index_start);
+  free(ud->index_end_ptr);
+  free(ud->index_end);
+
+  ud->index_n         = 0;
+  ud->index_start_ptr = NULL;
+  ud->index_start     = NULL;
+  ud->index_end_ptr   = NULL;
+  ud->index_end       = NULL;
+}
+
+
+/*
+ *  Build an index of all motif occurrences within the sequence
+ *  using a bit-parallel multi-pattern Shift-And search. All motifs
+ *  are concatenated into a single bit vector, where bit p of the
+ *  character mask for nucleotide c is set whenever c matches the
+ *  (IUPAC) motif character at p. A single left-to-right pass over
+ *  the sequence then reports all motifs ending at each position j.
+ *  The occurrences are finally stored in compressed row format,
+ *  once with respect to their start and once with respect to their
+ *  end position, such that subsequent queries run in constant time.
+ */
+PRIVATE void
+motif_index_prepare(vrna_fold_compound_t *vc)
+{
+  unsigned char c;
+  unsigned int  n, k, p, w, num_words, total, cnt, hits_size, *offset, *end_motif,
+                *s_ptr, *e_ptr, *tmp_ptr;
+  int           *s_list, *e_list, *by_motif;
+  uint64_t      *init, *fin, *state, *masks[256], carry, bits;
+  vrna_ud_t     *domains_up;
+  struct {
+    unsigned int  start;
+    unsigned int  end;
+    int           motif;
+  }             *hits, *sorted;
+
   domains_up  = vc->domains_up;
+  n           = vc->length;
 
-  cnt         = 0;
-  guess       = domains_up->motif_count;
-  motif_list  = (int *)vrna_alloc(sizeof(int) * (guess + 1));
+  if ((domains_up->index_n == n) && (domains_up->index_start_ptr))
+    return;
+
+  motif_index_free(domains_up);
+
+  /* assign a contiguous range of bits to each motif */
+  offset = (unsigned int *)vrna_alloc(sizeof(unsigned int) * (domains_up->motif_count + 1));
+  for (total = 0, k = 0; k < domains_up->motif_count; k++) {
+    offset[k] = total;
+    total     += domains_up->motif_size[k];
+  }
+  offset[k] = total;
+
+  num_words = (total + 63) / 64;
+  if (num_words == 0)
+    num_words = 1;
+
+  init      = (uint64_t *)vrna_alloc(sizeof(uint64_t) * num_words);
+  fin       = (uint64_t *)vrna_alloc(sizeof(uint64_t) * num_words);
+  state     = (uint64_t *)vrna_alloc(sizeof(uint64_t) * num_words);
+  end_motif = (unsigned int *)vrna_alloc(sizeof(unsigned int) * (total + 1));
 
-  /* collect list of motif numbers we find that start at position i */
   for (k = 0; k < domains_up->motif_count; k++) {
-    if (!(domains_up->motif_type[k] & loop_type))
+    if (domains_up->motif_size[k] == 0)
       continue;
 
-    j = i + domains_up->motif_size[k] - 1;
-    if (j <= n) {
-      /* only consider motif that does not exceed sequence length (does not work for circular RNAs!) */
-      for (u = i; u <= j; u++)
-        if (!vrna_nucleotide_IUPAC_identity(sequence[u - 1], domains_up->motif[k][u - i]))
-          break;
+    p             = offset[k];
+    init[p / 64]  |= (uint64_t)1 << (p % 64);
+    p             = offset[k + 1] - 1;
+    fin[p / 64]   |= (uint64_t)1 << (p % 64);
+    end_motif[p]  = k;
+  }
+
+  memset(masks, 0, sizeof(masks));
+
+  hits_size = 2 * n + 1;
+  hits      = vrna_alloc(sizeof(*hits) * hits_size);
+  cnt       = 0;
 
-      if (u > j) /* got a complete motif match */
-        motif_list[cnt++] = k;
+  for (p = 1; p <= n; p++) {
+    c = (unsigned char)vc->sequence[p - 1];
+
+    /* lazily compute the match mask for each nucleotide character in the sequence */
+    if (!masks[c]) {
+      masks[c] = (uint64_t *)vrna_alloc(sizeof(uint64_t) * num_words);
+      for (k = 0; k < domains_up->motif_count; k++)
+        for (w = 0; w < domains_up->motif_size[k]; w++)
+          if (vrna_nucleotide_IUPAC_identity((char)c, domains_up->motif[k][w]))
+            masks[c][(offset[k] + w) / 64] |= (uint64_t)1 << ((offset[k] + w) % 64);
+    }
+
+    /* state = ((state << 1) | init) & mask[c] */
+    for (carry = 0, w = 0; w < num_words; w++) {
+      bits      = state[w];
+      state[w]  = ((bits << 1) | carry | init[w]) & masks[c][w];
+      carry     = bits >> 63;
+    }
+
+    /* report all motifs that end at position p */
+    for (w = 0; w < num_words; w++) {
+      bits = state[w] & fin[w];
+      for (k = 64 * w; bits; bits >>= 1, k++) {
+        if (bits & 1) {
+          if (cnt == hits_size) {
+            hits_size *= 2;
+            hits      = vrna_realloc(hits, sizeof(*hits) * hits_size);
+          }
+
+          hits[cnt].motif = end_motif[k];
+          hits[cnt].end   = p;
+          hits[cnt].start = p - domains_up->motif_size[end_motif[k]] + 1;
+          cnt++;
+        }
+      }
     }
   }
 
-  if (cnt == 0) {
-    free(motif_list);
-    return NULL;
+  /*
+   *  hits are ordered by (end, motif) already. To obtain the
+   *  (start, motif) order we apply a stable counting sort first
+   *  by motif number, then by start position
+   */
+  s_ptr     = (unsigned int *)vrna_alloc(sizeof(unsigned int) * (n + 2));
+  e_ptr     = (unsigned int *)vrna_alloc(sizeof(unsigned int) * (n + 2));
+  s_list    = (int *)vrna_alloc(sizeof(int) * (cnt + 1));
+  e_list    = (int *)vrna_alloc(sizeof(int) * (cnt + 1));
+  tmp_ptr   = (unsigned int *)vrna_alloc(sizeof(unsigned int) *
+                                         (MAX2(n, domains_up->motif_count) + 2));
+  by_motif  = (int *)vrna_alloc(sizeof(int) * (cnt + 1));
+  sorted    = vrna_alloc(sizeof(*sorted) * (cnt + 1));
+
+  for (p = 0; p < cnt; p++) {
+    e_ptr[hits[p].end + 1]++;
+    e_list[p] = hits[p].motif;
+    tmp_ptr[hits[p].motif + 1]++;
+  }
+
+  for (p = 1; p <= n + 1; p++)
+    e_ptr[p] += e_ptr[p - 1];
+
+  for (k = 1; k <= domains_up->motif_count; k++)
+    tmp_ptr[k] += tmp_ptr[k - 1];
+
+  for (p = 0; p < cnt; p++)
+    by_motif[tmp_ptr[hits[p].motif]++] = (int)p;
+
+  for (p = 0; p < cnt; p++)
+    s_ptr[hits[p].start + 1]++;
+
+  for (p = 1; p <= n + 1; p++)
+    s_ptr[p] += s_ptr[p - 1];
+
+  memcpy(tmp_ptr, s_ptr, sizeof(unsigned int) * (n + 2));
+  for (p = 0; p < cnt; p++) {
+    k                               = (unsigned int)by_motif[p];
+    sorted[tmp_ptr[hits[k].start]]  = hits[k];
+    tmp_ptr[hits[k].start]++;
+  }
+
+  for (p = 0; p < cnt; p++)
+    s_list[p] = sorted[p].motif;
+
+  domains_up->index_n         = n;
+  domains_up->index_start_ptr = s_ptr;
+  domains_up->index_start     = s_list;
+  domains_up->index_end_ptr   = e_ptr;
+  domains_up->index_end       = e_list;
+
+  for (p = 0; p < 256; p++)
+    free(masks[p]);
+
+  free(sorted);
+  free(by_motif);
+  free(tmp_ptr);
+  free(hits);
+  free(end_motif);
+  free(state);
+  free(fin);
+  free(init);
+  free(offset);
+}
+
+
+PRIVATE int *
+motif_index_get(vrna_ud_t           *ud,
+                const unsigned int  *ptr,
+                const int           *list,
+                int                 i,
+                unsigned int        loop_type)
+{
+  unsigned int  p;
+  int           cnt, *motif_list;
+
+  motif_list  = NULL;
+  cnt         = 0;
+
+  for (p = ptr[i]; p < ptr[i + 1]; p++) {
+    if (!(ud->motif_type[list[p]] & loop_type))
+      continue;
+
+    if (!motif_list)
+      motif_list = (int *)vrna_alloc(sizeof(int) * (ptr[i + 1] - p + 1));
+
+    motif_list[cnt++] = list[p];
   }
 
-  motif_list      = (int *)vrna_realloc(motif_list, sizeof(int) * (cnt + 1));
-  motif_list[cnt] = -1; /* end of list marker */
+  if (motif_list)
+    motif_list[cnt] = -1; /* end of list marker */
 
   return motif_list;
 }
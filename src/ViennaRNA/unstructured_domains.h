@@ -240,6 +240,19 @@ struct vrna_unstructured_domain_s {
   double        *motif_en;                          /**<  @brief Ligand binding free energy contribution */
   unsigned int  *motif_type;                        /**<  @brief Type of motif, i.e. loop type the ligand binds to */
 
+  /*
+   **********************************
+   * Position-wise motif index, i.e.
+   * all motif occurrences within the
+   * sequence (built on demand)
+   **********************************
+   */
+  unsigned int  index_n;                            /**<  @brief Sequence length the motif index was built for (0 if no index is present) */
+  unsigned int  *index_start_ptr;                   /**<  @brief Offsets into #vrna_ud_t.index_start for each sequence position @f$ i @f$ (@f$ n + 2 @f$ entries) */
+  int           *index_start;                       /**<  @brief Motif numbers of all motifs that start at position @f$ i @f$, sorted by motif number */
+  unsigned int  *index_end_ptr;                     /**<  @brief Offsets into #vrna_ud_t.index_end for each sequence position @f$ j @f$ (@f$ n + 2 @f$ entries) */
+  int           *index_end;                         /**<  @brief Motif numbers of all motifs that end at position @f$ j @f$, sorted by motif number */
+
   /*
    **********************************
    * Grammar extension for ligand
@@ -386,6 +399,25 @@ vrna_ud_get_motifs_at(vrna_fold_compound_t  *vc,
                       unsigned int          loop_type);
 
 
+/**
+ *  @brief  Get a list of motifs that end at a certain position within the sequence
+ *
+ *  Motif occurrences are looked up from a position-wise index that is built once for
+ *  each #vrna_fold_compound_t (see #vrna_ud_t.index_end).
+ *
+ *  @see vrna_ud_get_motifs_at()
+ *
+ *  @param  vc          The #vrna_fold_compound_t data structure the ligand motifs are bound to
+ *  @param  j           The last nucleotide of the motif occurrences
+ *  @param  loop_type   The loop type the motifs bind to
+ *  @return             A list of motif numbers terminated by -1, or @p NULL if no motif ends at @p j
+ */
+int *
+vrna_ud_get_motifs_ending_at(vrna_fold_compound_t *vc,
+                             int                  j,
+                             unsigned int         loop_type);
+
+
 vrna_ud_motif_t *
 vrna_ud_detect_motifs(vrna_fold_compound_t  *vc,
                       const char            *structure);
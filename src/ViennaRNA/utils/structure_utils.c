@@ -21,14 +21,30 @@
 #include "ViennaRNA/utils/basic.h"
 #include "ViennaRNA/params/basic.h"
 #include "ViennaRNA/gquad.h"
+#include "ViennaRNA/utils/cpu.h"
 #include "ViennaRNA/utils/structures.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 #ifdef __GNUC__
 # define INLINE inline
 #else
 # define INLINE
 #endif
 
+/*
+ *  Maximum size of the encoded structures of one tile in
+ *  vrna_bp_distance_matrix(), such that the structures of
+ *  two tiles stay in the L1 cache
+ */
+#define BP_DISTANCE_TILE_BYTES  16384
+
+typedef int (proto_bp_common)(const unsigned short  *a,
+                              const unsigned short  *b,
+                              int                   count);
+
 /*
  #################################
  # PRIVATE FUNCTION DECLARATIONS #
@@ -67,6 +83,27 @@ extract_pairs(short       *pt,
               const char  *pair);
 
 
+PRIVATE int
+bp_common_default(const unsigned short  *a,
+                  const unsigned short  *b,
+                  int                   count);
+
+
+PRIVATE int
+bp_count(const unsigned short *a,
+         int                  count);
+
+
+#if VRNA_WITH_SIMD_SSE41
+int
+vrna_bp_common_sse41(const unsigned short *a,
+                     const unsigned short *b,
+                     int                  count);
+
+
+#endif
+
+
 /*
  #################################
  # BEGIN OF FUNCTION DEFINITIONS #
@@ -442,6 +479,158 @@ vrna_bp_distance(const char *str1,
 }
 
 
+PUBLIC int *
+vrna_bp_distance_matrix(const char **structures)
+{
+  unsigned short  *enc;
+  short           *pt;
+  int             *matrix, *len, *np, p, num_tile_pairs;
+  size_t          n, i, k, width, tile, num_tiles;
+  proto_bp_common *common;
+
+  if (!structures)
+    return NULL;
+
+  for (n = 0; structures[n]; n++) ;
+
+  if (n < 2)
+    return NULL;
+
+  len = (int *)vrna_alloc(sizeof(int) * n);
+  np  = (int *)vrna_alloc(sizeof(int) * n);
+
+  /* all structures are encoded in rows of equal width, padded to a multiple of 8 positions */
+  for (width = 0, i = 0; i < n; i++) {
+    len[i] = (int)strlen(structures[i]);
+    width  = MAX2(width, (size_t)len[i]);
+  }
+
+  width = (width + 7) & ~((size_t)7);
+
+  /*
+   *  each row stores the 3' partner of every opening position,
+   *  and 0 otherwise. Hence, two structures share a base pair
+   *  whenever they have the same non-zero entry
+   */
+  enc = (unsigned short *)vrna_alloc(sizeof(unsigned short) * width * n);
+
+  for (i = 0; i < n; i++) {
+    pt = vrna_ptable(structures[i]);
+    for (k = 1; k <= (size_t)pt[0]; k++)
+      if (pt[k] > (short)k) {
+        enc[i * width + k - 1] = (unsigned short)pt[k];
+        np[i]++;
+      }
+
+    free(pt);
+  }
+
+  common = &bp_common_default;
+
+#if VRNA_WITH_SIMD_SSE41
+  if (vrna_cpu_simd_capabilities() & VRNA_CPU_SIMD_SSE41)
+    common = &vrna_bp_common_sse41;
+
+#endif
+
+  matrix = (int *)vrna_alloc(sizeof(int) * n * (n - 1) / 2);
+
+  /* process the lower triangle in pairs of tiles ti >= tj */
+  tile            = MAX2(1, BP_DISTANCE_TILE_BYTES / (sizeof(unsigned short) * MAX2(width, 1)));
+  num_tiles       = (n + tile - 1) / tile;
+  num_tile_pairs  = (int)(num_tiles * (num_tiles + 1) / 2);
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for (p = 0; p < num_tile_pairs; p++) {
+    size_t                ti, tj, i, j, i_end, j_end;
+    int                   l, *row;
+    const unsigned short  *a, *b;
+
+    /* decode the index of the tile pair */
+    ti = (size_t)((sqrt(8. * p + 1.) - 1.) / 2.);
+    while (ti * (ti + 1) / 2 > (size_t)p)
+      ti--;
+    while ((ti + 1) * (ti + 2) / 2 <= (size_t)p)
+      ti++;
+
+    tj    = (size_t)p - ti * (ti + 1) / 2;
+    i_end = MIN2(n, (ti + 1) * tile);
+    j_end = MIN2(n, (tj + 1) * tile);
+
+    for (i = ti * tile; i < i_end; i++) {
+      a   = enc + i * width;
+      row = matrix + i * (i - 1) / 2;
+      for (j = tj * tile; (j < j_end) && (j < i); j++) {
+        b = enc + j * width;
+        if (len[i] == len[j]) {
+          row[j] = np[i] + np[j] - 2 * common(a, b, (int)width);
+        } else {
+          /* same as vrna_bp_distance(), only pairs opening within the shorter structure count */
+          l       = MIN2(len[i], len[j]);
+          row[j]  = bp_count(a, l) + bp_count(b, l) - 2 * common(a, b, l);
+        }
+      }
+    }
+  }
+
+  free(enc);
+  free(len);
+  free(np);
+
+  return matrix;
+}
+
+
+PUBLIC int
+vrna_bp_distance_matrix_write(FILE          *fp,
+                              const int     *matrix,
+                              size_t        n,
+                              unsigned int  options)
+{
+  char    *buf;
+  size_t  i, j, num, pos, buf_size;
+  int     ret;
+
+  num = (n > 1) ? n * (n - 1) / 2 : 0;
+
+  if ((!fp) || ((!matrix) && (num > 0)))
+    return 0;
+
+  if (options & VRNA_BP_DISTANCE_MATRIX_BINARY)
+    return (fwrite(matrix, sizeof(int), num, fp) == num) ? 1 : 0;
+
+  /* text output, assembled in a large buffer that is flushed at once */
+  ret       = 1;
+  buf_size  = 65536;
+  buf       = (char *)vrna_alloc(sizeof(char) * buf_size);
+  pos       = 0;
+
+  for (i = 1; i < n; i++) {
+    for (j = 0; j < i; j++) {
+      /* flush buffer if less than one full entry of output remains */
+      if (buf_size - pos < 32) {
+        if (fwrite(buf, sizeof(char), pos, fp) != pos)
+          ret = 0;
+
+        pos = 0;
+      }
+
+      pos += snprintf(buf + pos, buf_size - pos, "%d ", matrix[i * (i - 1) / 2 + j]);
+    }
+    buf[pos++] = '\n';
+  }
+
+  if (fwrite(buf, sizeof(char), pos, fp) != pos)
+    ret = 0;
+
+  free(buf);
+
+  return ret;
+}
+
+
 PUBLIC double
 vrna_dist_mountain(const char   *str1,
                    const char   *str2,
@@ -1339,6 +1528,35 @@ assign_elements_pair(short  *pt,
 }
 
 
+/* number of base pairs two encoded structures have in common */
+PRIVATE int
+bp_common_default(const unsigned short  *a,
+                  const unsigned short  *b,
+                  int                   count)
+{
+  int i, c;
+
+  for (c = 0, i = 0; i < count; i++)
+    c += ((a[i] == b[i]) && (a[i] != 0));
+
+  return c;
+}
+
+
+/* number of base pairs of an encoded structure */
+PRIVATE int
+bp_count(const unsigned short *a,
+         int                  count)
+{
+  int i, c;
+
+  for (c = 0, i = 0; i < count; i++)
+    c += (a[i] != 0);
+
+  return c;
+}
+
+
 #ifndef VRNA_DISABLE_BACKWARD_COMPATIBILITY
 
 /*###########################################*/
@@ -1522,3 +1740,4 @@ bppm_to_structure(char          *structure,
 
 
 #endif
+
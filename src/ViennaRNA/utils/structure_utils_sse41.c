@@ -0,0 +1,57 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ViennaRNA/utils/basic.h"
+
+#include <emmintrin.h>
+#include <smmintrin.h>
+
+/*
+ *  Count the base pairs two encoded structures have in common,
+ *  i.e. the positions where both structures have the same
+ *  non-zero 3' partner, see vrna_bp_distance_matrix()
+ */
+PUBLIC int
+vrna_bp_common_sse41(const unsigned short *a,
+                     const unsigned short *b,
+                     int                  count)
+{
+  int     i       = 0;
+  int     common  = 0;
+
+  __m128i zero  = _mm_setzero_si128();
+  __m128i ones  = _mm_set1_epi16(1);
+
+  while (i < count - 7) {
+    /* each of the 16bit counters may be incremented at most 32767 times */
+    int     end = MIN2(count - 7, i + 8 * 32767);
+    __m128i acc = zero;
+
+    for (; i < end; i += 8) {
+      __m128i x = _mm_loadu_si128((__m128i *)&a[i]);
+      __m128i y = _mm_loadu_si128((__m128i *)&b[i]);
+
+      /* equal entries that are not unpaired in both structures */
+      __m128i match = _mm_andnot_si128(_mm_cmpeq_epi16(x, zero),
+                                       _mm_cmpeq_epi16(x, y));
+
+      /* matches are all-ones, i.e. -1 */
+      acc = _mm_sub_epi16(acc, match);
+    }
+
+    /* horizontal sum of the 16bit counters */
+    acc     = _mm_madd_epi16(acc, ones);
+    acc     = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+    acc     = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+    common  += _mm_cvtsi128_si32(acc);
+  }
+
+  for (; i < count; i++)
+    common += ((a[i] == b[i]) && (a[i] != 0));
+
+  return common;
+}
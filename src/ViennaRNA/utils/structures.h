@@ -463,6 +463,64 @@ int vrna_bp_distance(const char *str1,
                      const char *str2);
 
 
+/**
+ *  @brief  Output flag for vrna_bp_distance_matrix_write() to write the distance matrix as text
+ *  @see    vrna_bp_distance_matrix_write(), #VRNA_BP_DISTANCE_MATRIX_BINARY
+ */
+#define VRNA_BP_DISTANCE_MATRIX_TEXT    0U
+
+/**
+ *  @brief  Output flag for vrna_bp_distance_matrix_write() to write the raw distance matrix
+ *  @see    vrna_bp_distance_matrix_write(), #VRNA_BP_DISTANCE_MATRIX_TEXT
+ */
+#define VRNA_BP_DISTANCE_MATRIX_BINARY  1U
+
+
+/**
+ *  @brief Compute the base pair distances between all pairs of a list of secondary structures
+ *
+ *  This function computes the same distances as calling vrna_bp_distance() for each
+ *  pair of structures, but converts each structure only once into a compact array that
+ *  holds the 3' partner of each opening position. The number of base pairs two structures
+ *  have in common is then counted with SIMD instructions if available, and the matrix is
+ *  processed in cache-sized tiles that are distributed among all available threads if
+ *  OpenMP is available.
+ *
+ *  The lower triangle of the distance matrix is returned in row-major order without the
+ *  diagonal, i.e. the distance between structures @f$i > j@f$ (0-based) is found at
+ *  position @f$i(i-1)/2 + j@f$.
+ *
+ *  @see vrna_bp_distance(), vrna_bp_distance_matrix_write()
+ *
+ *  @param structures A @em NULL terminated list of structures in dot-bracket notation
+ *  @return           The lower triangle of the distance matrix with @f$n(n-1)/2@f$ entries
+ *                    for @f$n@f$ structures, or @em NULL if the list has less than two entries
+ */
+int *vrna_bp_distance_matrix(const char **structures);
+
+
+/**
+ *  @brief Write a base pair distance matrix to a file
+ *
+ *  Output is either the lower triangle in text form (#VRNA_BP_DISTANCE_MATRIX_TEXT), one
+ *  line of space separated distances per row as printed by @em RNAdistance, or the raw,
+ *  native-endian array of @c int (#VRNA_BP_DISTANCE_MATRIX_BINARY). Text output is assembled
+ *  in large blocks before it is written to @p fp.
+ *
+ *  @see vrna_bp_distance_matrix(), #VRNA_BP_DISTANCE_MATRIX_TEXT, #VRNA_BP_DISTANCE_MATRIX_BINARY
+ *
+ *  @param fp       The file pointer to write to
+ *  @param matrix   The lower triangle of the distance matrix as returned by vrna_bp_distance_matrix()
+ *  @param n        The number of structures
+ *  @param options  Output options
+ *  @return         1 on success, 0 on errors
+ */
+int vrna_bp_distance_matrix_write(FILE          *fp,
+                                  const int     *matrix,
+                                  size_t        n,
+                                  unsigned int  options);
+
+
 double
 vrna_dist_mountain(const char   *str1,
                    const char   *str2,
@@ -64,6 +64,9 @@ struct options {
   dataset_id      id_control;
 
   char            *concentration_file;
+  char            *concentration_output;
+  unsigned int    concentration_output_options;
+  FILE            *concentration_fp;
 
   char            *constraint_file;
   int             constraint_batch;
@@ -100,8 +103,10 @@ struct record_data {
 
 
 struct output_stream {
-  vrna_cstr_t data;
-  vrna_cstr_t err;
+  vrna_cstr_t       data;
+  vrna_cstr_t       err;
+  vrna_dimer_conc_t *conc;      /* equilibrium concentrations for --concfile-output */
+  size_t            conc_num;
 };
 
 
@@ -126,7 +131,7 @@ read_concentrations(FILE *fp);
 PRIVATE void
 print_concentrations(vrna_cstr_t        stream,
                      vrna_dimer_conc_t  *result,
-                     double             *startconc);
+                     size_t             n);
 
 
 static int
@@ -189,6 +194,10 @@ init_default_options(struct options *opt)
   opt->doC                = 0; /* toggle to compute concentrations */
   opt->concentration_file = NULL;
 
+  opt->concentration_output         = NULL;
+  opt->concentration_output_options = VRNA_CONC_OUTPUT_CSV | VRNA_CONC_OUTPUT_RELATIVE;
+  opt->concentration_fp             = NULL;
+
   opt->constraint_file      = NULL;
   opt->constraint_batch     = 0;
   opt->constraint_enforce   = 0;
@@ -235,7 +244,8 @@ flush_cstr_callback(void          *auxdata,
                     unsigned int  i,
                     void          *data)
 {
-  struct output_stream *s = (struct output_stream *)data;
+  struct options        *opt  = (struct options *)auxdata;
+  struct output_stream  *s    = (struct output_stream *)data;
 
   /* flush/free errors first */
   vrna_cstr_free(s->err);
@@ -243,6 +253,23 @@ flush_cstr_callback(void          *auxdata,
   /* flush/free data[k] */
   vrna_cstr_free(s->data);
 
+  /* write concentrations to separate file in order of input */
+  if (s->conc) {
+    int ret;
+
+    THREADSAFE_FILE_OUTPUT(
+      ret = vrna_pf_dimer_concentrations_write(opt->concentration_fp,
+                                               s->conc,
+                                               s->conc_num,
+                                               opt->concentration_output_options));
+
+    if (!ret)
+      vrna_message_warning("Failed to write concentrations to file \"%s\"",
+                           opt->concentration_output);
+
+    free(s->conc);
+  }
+
   free(s);
 }
 
@@ -316,6 +343,17 @@ main(int  argc,
     opt.doC                 = opt.doT = opt.pf = 1;
   }
 
+  /* write concentrations to a separate file */
+  if (args_info.concfile_output_given) {
+    if (opt.doC)
+      opt.concentration_output = strdup(args_info.concfile_output_arg);
+    else
+      vrna_message_warning("Ignoring --concfile-output since no concentrations are computed");
+
+    if (args_info.concfile_binary_given)
+      opt.concentration_output_options = VRNA_CONC_OUTPUT_BINARY;
+  }
+
   /* partition function settings */
   if (args_info.partfunc_given) {
     opt.pf = 1;
@@ -457,8 +495,15 @@ main(int  argc,
   if ((opt.verbose) && (opt.jobs > 1))
     vrna_message_info(stderr, "Preparing %d parallel computation slots", opt.jobs);
 
+  if (opt.concentration_output) {
+    opt.concentration_fp = fopen(opt.concentration_output,
+                                 (opt.concentration_output_options & VRNA_CONC_OUTPUT_BINARY) ? "wb" : "w");
+    if (!opt.concentration_fp)
+      vrna_message_error("Unable to open file \"%s\" for writing", opt.concentration_output);
+  }
+
   if (opt.keep_order)
-    opt.output_queue = vrna_ostream_init(&flush_cstr_callback, NULL);
+    opt.output_queue = vrna_ostream_init(&flush_cstr_callback, (void *)&opt);
 
   /*
    ################################################
@@ -505,6 +550,8 @@ main(int  argc,
    */
   vrna_ostream_free(opt.output_queue);
 
+  if (opt.concentration_fp)
+    fclose(opt.concentration_fp);
 
   free(input_files);
   free(opt.constraint_file);
@@ -514,6 +561,7 @@ main(int  argc,
   free(opt.filename_delim);
   vrna_commands_free(opt.commands);
   free(opt.concentration_file);
+  free(opt.concentration_output);
 
   free_id_data(opt.id_control);
 
@@ -821,8 +869,10 @@ process_record(struct record_data *record)
     char              *Astring, *Bstring, *orig_Astring, *orig_Bstring, *pairing_propensity;
     int               Blength, Alength;
     vrna_dimer_pf_t   AB, AA, BB;
+    size_t            conc_num;
     vrna_dimer_conc_t *conc_result;
 
+    conc_num    = 0;
     conc_result = NULL;
     prAB        = NULL;
     prAA        = NULL;
@@ -944,13 +994,18 @@ process_record(struct record_data *record)
       }
 
       if (opt->doC) {
-        conc_result = vrna_pf_dimer_concentrations(AB.FcAB,
-                                                   AA.FcAB,
-                                                   BB.FcAB,
-                                                   AB.FA,
-                                                   AB.FB,
-                                                   concentrations,
-                                                   vc->exp_params);
+        for (conc_num = 0;
+             (concentrations[2 * conc_num] > 0) || (concentrations[2 * conc_num + 1] > 0);
+             conc_num++);  /* count */
+
+        conc_result = vrna_pf_dimer_concentrations_batch(AB.FcAB,
+                                                         AA.FcAB,
+                                                         BB.FcAB,
+                                                         AB.FA,
+                                                         AB.FB,
+                                                         concentrations,
+                                                         conc_num,
+                                                         vc->exp_params);
       }
     }
 
@@ -1103,7 +1158,15 @@ process_record(struct record_data *record)
       if (opt->csv_output) /* end of data set in case we output as CSV */
         vrna_cstr_printf(o_stream->data, "\n");
 
-      print_concentrations(o_stream->data, conc_result, concentrations);
+      if (opt->concentration_fp) {
+        /* written by flush_cstr_callback() to keep the order of input records */
+        o_stream->conc      = conc_result;
+        o_stream->conc_num  = conc_num;
+        conc_result         = NULL;
+      } else {
+        print_concentrations(o_stream->data, conc_result, conc_num);
+      }
+
       free(conc_result);
       free(concentrations);
     }
@@ -1133,7 +1196,7 @@ cleanup_record:
   if (opt->output_queue)
     vrna_ostream_provide(opt->output_queue, record->number, (void *)o_stream);
   else
-    flush_cstr_callback(NULL, 0, (void *)o_stream);
+    flush_cstr_callback((void *)opt, 0, (void *)o_stream);
 
   /* clean up */
   free(record->SEQ_ID);
@@ -1436,16 +1499,15 @@ postscript_layout(vrna_fold_compound_t  *fc,
 PRIVATE void
 print_concentrations(vrna_cstr_t        stream,
                      vrna_dimer_conc_t  *result,
-                     double             *startconc)
+                     size_t             n)
 {
-  /* compute and print concentrations out of free energies, calls get_concentrations */
-  int i, n;
+  /* print equilibrium concentrations relative to the sum of start concentrations */
+  size_t i;
 
   vrna_cstr_printf_thead(stream,
                          "Initial concentrations\t\trelative Equilibrium concentrations\n"
                          "A\t\tB\t\tAB\t\tAA\t\tBB\t\tA\t\tB");
 
-  for (n = 0; (startconc[2 * n] > 0) || (startconc[2 * n + 1] > 0); n++); /* count */
   for (i = 0; i < n; i++) {
     double tot = result[i].Ac_start + result[i].Bc_start;
     vrna_cstr_printf_tbody(stream,
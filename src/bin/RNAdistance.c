@@ -25,7 +25,7 @@
 #include "ViennaRNA/datastructures/basic.h"
 #include "RNAdistance_cmdl.h"
 
-#define MAXNUM      1000    /* max number of structs for distance matrix */
+#define MAXNUM      1000    /* max number of structs for tree and string edit distance matrix */
 
 #define PUBLIC
 #define PRIVATE     static
@@ -53,23 +53,28 @@ PRIVATE int   types = 1;
 PRIVATE int   task;
 PRIVATE int   taxa_list;
 PRIVATE char  outfile[FILENAME_MAX_LENGTH], *list_title;
+PRIVATE char  *binary_matrix_file = NULL;
 
 PRIVATE char  ttype[10] = "f";
-PRIVATE int   n         = 0;
+PRIVATE int   n           = 0;
+PRIVATE int   n_matrices  = 0;
 
 int
 main(int  argc,
      char *argv[])
 {
   char      *line = NULL, *xstruc, *cc;
-  Tree      *T[10][MAXNUM];
+  Tree      *T[10][MAXNUM + 1];
   int       tree_types = 0, ttree;
-  swString  *S[10][MAXNUM];
-  char      *P[MAXNUM];  /* structures for base pair distances */
+  swString  *S[10][MAXNUM + 1];
+  char      **P = NULL;  /* structures for base pair distances */
+  int       P_size = 0;
+  int       *bp_dist;
+  float     *edit_dist;
   int       string_types = 0, tstr;
   int       i, j, tt, istty, type;
   int       it, is;
-  FILE      *somewhere = NULL;
+  FILE      *somewhere = NULL, *matrix_fp;
 
   command_line(argc, argv);
 
@@ -107,9 +112,22 @@ main(int  argc,
       for (tt = 0; tt < types; tt++) {
         printf("> %c   %d\n", ttype[tt], n);
         if (islower(ttype[tt])) {
+          /* compute the entire matrix concurrently unless we need the alignments */
+          edit_dist = NULL;
+          if (!edit_backtrack) {
+            T[ttree][n] = NULL;
+            edit_dist   = vrna_tree_edit_distance_matrix(T[ttree],
+                                                         (cost_matrix) ?
+                                                         VRNA_DIST_SHAPIRO_COSTS :
+                                                         VRNA_DIST_DEFAULT);
+          }
+
           for (i = 1; i < n; i++) {
             for (j = 0; j < i; j++) {
-              printf("%g ", tree_edit_distance(T[ttree][i], T[ttree][j]));
+              printf("%g ",
+                     (edit_dist) ?
+                     edit_dist[i * (i - 1) / 2 + j] :
+                     tree_edit_distance(T[ttree][i], T[ttree][j]));
               if (edit_backtrack) {
                 fprintf(somewhere, "%d %d", i + 1, j + 1);
                 if (ttype[tt] == 'f')
@@ -121,24 +139,51 @@ main(int  argc,
             printf("\n");
           }
           printf("\n");
+          free(edit_dist);
           for (i = 0; i < n; i++)
             free_tree(T[ttree][i]);
           ttree++;
         }
 
         if (ttype[tt] == 'P') {
-          for (i = 1; i < n; i++) {
-            for (j = 0; j < i; j++)
-              printf("%g ", (float)vrna_bp_distance(P[i], P[j]));
-            printf("\n");
+          /* all base pair distances at once, each structure is converted only once */
+          if (P)
+            P[n] = NULL;
+
+          bp_dist = vrna_bp_distance_matrix((const char **)P);
+          if (binary_matrix_file) {
+            matrix_fp = fopen(binary_matrix_file, (n_matrices++) ? "ab" : "wb");
+            if ((!matrix_fp) ||
+                (!vrna_bp_distance_matrix_write(matrix_fp, bp_dist, n,
+                                                VRNA_BP_DISTANCE_MATRIX_BINARY)))
+              vrna_message_error("Failed to write distance matrix to file \"%s\"",
+                                 binary_matrix_file);
+
+            fclose(matrix_fp);
+          } else {
+            vrna_bp_distance_matrix_write(stdout, bp_dist, n, VRNA_BP_DISTANCE_MATRIX_TEXT);
           }
+
           printf("\n");
+          free(bp_dist);
           for (i = 0; i < n; i++)
             free(P[i]);
         } else if (isupper(ttype[tt])) {
+          edit_dist = NULL;
+          if (!edit_backtrack) {
+            S[tstr][n]  = NULL;
+            edit_dist   = vrna_string_edit_distance_matrix(S[tstr],
+                                                           (cost_matrix) ?
+                                                           VRNA_DIST_SHAPIRO_COSTS :
+                                                           VRNA_DIST_DEFAULT);
+          }
+
           for (i = 1; i < n; i++) {
             for (j = 0; j < i; j++) {
-              printf("%g ", string_edit_distance(S[tstr][i], S[tstr][j]));
+              printf("%g ",
+                     (edit_dist) ?
+                     edit_dist[i * (i - 1) / 2 + j] :
+                     string_edit_distance(S[tstr][i], S[tstr][j]));
               if (edit_backtrack) {
                 fprintf(somewhere, "%d %d", i + 1, j + 1);
                 if (ttype[tt] == 'F')
@@ -150,6 +195,7 @@ main(int  argc,
             printf("\n");
           }
           printf("\n");
+          free(edit_dist);
           for (i = 0; i < n; i++)
             free(S[tstr][i]);
           tstr++;
@@ -190,6 +236,11 @@ main(int  argc,
     tree_types    = 0;
     string_types  = 0;
     for (tt = 0; tt < types; tt++) {
+      if ((n >= MAXNUM) && (ttype[tt] != 'P'))
+        vrna_message_error("Too many structures, at most %d structures can be compared "
+                           "by tree or string edit distance",
+                           MAXNUM);
+
       switch (ttype[tt]) {
         case 'f':
         case 'F':
@@ -209,6 +260,12 @@ main(int  argc,
           if (type != 1)
             vrna_message_error("Can't convert back to full structure");
 
+          /* keep one more entry for the terminating NULL of vrna_bp_distance_matrix() */
+          if (n + 1 >= P_size) {
+            P_size  = (P_size) ? 2 * P_size : MAXNUM;
+            P       = (char **)vrna_realloc(P, sizeof(char *) * P_size);
+          }
+
           P[n] = strdup(line);
           break;
         case 'h':
@@ -655,6 +712,9 @@ command_line(int  argc,
     edit_backtrack = 1;
   }
 
+  if (args_info.binary_matrix_given)
+    binary_matrix_file = strdup(args_info.binary_matrix_arg);
+
   /* free allocated memory of command line data structure */
   RNAdistance_cmdline_parser_free(&args_info);
 }
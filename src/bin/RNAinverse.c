@@ -24,6 +24,10 @@
 #include "ViennaRNA/io/file_formats.h"
 #include "RNAinverse_cmdl.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 #include "ViennaRNA/color_output.inc"
 
 #ifdef dmalloc
@@ -40,11 +44,15 @@ main(int  argc,
      char *argv[])
 {
   struct RNAinverse_args_info args_info;
-  char                        *input_string, *start, *structure, *rstart, *str2,
-                              *ParamFile, *c, *ns_bases;
+  char                        *input_string, *start, *structure, *str2,
+                              *ParamFile, *c, *ns_bases, **strings, **rstarts, **failed;
   int                         input_type, i, length, l, hd, sym, pf, mfe, istty, repeat,
-                              found;
+                              found, r, n, n_threads;
+  unsigned int                *seeds, options;
+  float                       *mfe_dist, *pf_dist;
   double                      energy, kT;
+  vrna_md_t                   md;
+  vrna_inverse_t              **ctx;
 
   ParamFile     = NULL;
   energy        = 0.;
@@ -55,6 +63,8 @@ main(int  argc,
   repeat        = 0;
   input_type    = 0;
   input_string  = ns_bases = NULL;
+  n_threads     = 1;
+  options       = VRNA_INVERSE_DEFAULT;
   vrna_init_rand();
 
   /*
@@ -135,6 +145,24 @@ main(int  argc,
   if (args_info.verbose_given)
     inv_verbose = 1;
 
+  /* refold only promising mutants */
+  if (args_info.prescreen_given)
+    options |= VRNA_INVERSE_PRESCREEN;
+
+  /* number of concurrent searches */
+  if (args_info.jobs_given) {
+#ifdef _OPENMP
+    n_threads = (args_info.jobs_arg > 0) ? args_info.jobs_arg : omp_get_num_procs();
+#else
+    vrna_message_warning("This version of RNAinverse has been built without parallel search support.\n"
+                         "Ignoring request to search in parallel!");
+#endif
+  }
+
+#ifdef _OPENMP
+  omp_set_num_threads(n_threads);
+#endif
+
   /* free allocated memory of command line data structure */
   RNAinverse_cmdline_parser_free(&args_info);
 
@@ -147,6 +175,8 @@ main(int  argc,
 
 
   give_up = (repeat < 0);
+  if (give_up)
+    options |= VRNA_INVERSE_GIVE_UP;
 
   do {
     /*
@@ -237,74 +267,129 @@ main(int  argc,
     else
       found = 1;
 
-    /* initialize_fold(length); <- obsolete (hopefully commenting this out does not affect anything crucial ;) */
+    /* one design context per thread, all sharing the current model settings */
+    set_model_details(&md);
+    ctx = (vrna_inverse_t **)vrna_alloc(sizeof(vrna_inverse_t *) * n_threads);
+    for (i = 0; i < n_threads; i++)
+      ctx[i] = vrna_inverse_init(&md, symbolset, options);
 
-    rstart = (char *)vrna_alloc((unsigned)length + 1);
     while (found > 0) {
-      char *string;
-      string = (char *)vrna_alloc((unsigned)length + 1);
-      strcpy(string, start);
-      for (i = 0; i < length; i++) {
-        /* lower case characters are kept fixed, any other character
-         * not in symbolset is replaced by a random character */
-        if (islower(string[i]))
-          continue;
-
-        if (string[i] == '\0' || (strchr(symbolset, string[i]) == NULL))
-          string[i] = symbolset[vrna_int_urn(0, strlen(symbolset) - 1)];
+      /*
+       *  Independent searches are carried out in rounds. Start strings and seeds
+       *  are drawn beforehand, so the results of a round do not depend on the
+       *  number of threads. With negative --repeat, a round consists of at least
+       *  one search per thread and surplus solutions are discarded.
+       */
+      n         = (repeat >= 0) ? found : MAX2(found, n_threads);
+      strings   = (char **)vrna_alloc(sizeof(char *) * n);
+      rstarts   = (char **)vrna_alloc(sizeof(char *) * n);
+      failed    = (char **)vrna_alloc(sizeof(char *) * n);
+      seeds     = (unsigned int *)vrna_alloc(sizeof(unsigned int) * n);
+      mfe_dist  = (float *)vrna_alloc(sizeof(float) * n);
+      pf_dist   = (float *)vrna_alloc(sizeof(float) * n);
+
+      for (r = 0; r < n; r++) {
+        strings[r] = (char *)vrna_alloc((unsigned)length + 1);
+        strcpy(strings[r], start);
+        for (i = 0; i < length; i++) {
+          /* lower case characters are kept fixed, any other character
+           * not in symbolset is replaced by a random character */
+          if (islower(strings[r][i]))
+            continue;
+
+          if (strings[r][i] == '\0' || (strchr(symbolset, strings[r][i]) == NULL))
+            strings[r][i] = symbolset[vrna_int_urn(0, strlen(symbolset) - 1)];
+        }
+        rstarts[r]  = strdup(strings[r]); /* remember start string */
+        seeds[r]    = (unsigned int)(vrna_urn() * 4294967295.);
       }
-      strcpy(rstart, string); /* remember start string */
-
-      if (mfe) {
-        energy = inverse_fold(string, structure);
-        if ((repeat >= 0) || (energy <= 0.0)) {
-          found--;
-          hd = vrna_hamming_distance(rstart, string);
-          char *msg = NULL;
-
-          if (energy > 0) {
-            /* no solution found */
-            msg = vrna_strdup_printf("  %3d   d= %g", hd, energy);
-            if (istty) {
-              energy = fold(string, str2);
-              printf("%s\n", str2);
-            }
-          } else {
-            msg = vrna_strdup_printf("  %3d", hd);
-          }
 
-          print_structure(stdout, string, msg);
-          free(msg);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) private(i)
+#endif
+      for (r = 0; r < n; r++) {
+        const char      *wstring, *wstruct;
+        vrna_inverse_t  *c;
+
+        i = 0;
+#ifdef _OPENMP
+        i = omp_get_thread_num();
+#endif
+        c = ctx[i];
+        vrna_inverse_seed(c, seeds[r]);
+
+        if (mfe) {
+          mfe_dist[r] = vrna_inverse_mfe(c, strings[r], structure);
+          if ((inv_verbose) && (vrna_inverse_failure(c, &wstring, &wstruct)))
+            failed[r] = vrna_strdup_printf("%s\n%s\n", wstring, wstruct);
         }
+
+        /* unless we gave up in the mfe part */
+        if ((pf) && (!(mfe && give_up && (mfe_dist[r] > 0))))
+          pf_dist[r] = vrna_inverse_pf(c, strings[r], structure, final_cost);
       }
 
-      if (pf) {
-        if (!(mfe && give_up && (energy > 0))) {
-          /* unless we gave up in the mfe part */
-          double prob, min_en, sfact = 1.07;
-
-          /* get a reasonable pf_scale */
-          min_en    = fold(string, str2);
-          pf_scale  = exp(-(sfact * min_en) / kT / length);
-          /* init_pf_fold(length); <- obsolete (hopefully commenting this out does not affect anything crucial ;) */
-
-          energy  = inverse_pf_fold(string, structure);
-          prob    = exp(-energy / kT);
-          hd      = vrna_hamming_distance(rstart, string);
-          char *msg = vrna_strdup_printf("  %3d  (%g)", hd, prob);
-          print_structure(stdout, string, msg);
-          free(msg);
-          free_pf_arrays();
+      for (r = 0; (r < n) && (found > 0); r++) {
+        if (failed[r])
+          printf("%s", failed[r]);
+
+        if (mfe) {
+          energy = mfe_dist[r];
+          if ((repeat >= 0) || (energy <= 0.0)) {
+            found--;
+            hd = vrna_hamming_distance(rstarts[r], strings[r]);
+            char *msg = NULL;
+
+            if (energy > 0) {
+              /* no solution found */
+              msg = vrna_strdup_printf("  %3d   d= %g", hd, energy);
+              if (istty) {
+                (void)fold(strings[r], str2);
+                printf("%s\n", str2);
+              }
+            } else {
+              msg = vrna_strdup_printf("  %3d", hd);
+            }
+
+            print_structure(stdout, strings[r], msg);
+            free(msg);
+          }
         }
 
-        if (!mfe)
-          found--;
+        if (pf) {
+          if (!(mfe && give_up && (mfe_dist[r] > 0))) {
+            double prob;
+
+            prob  = exp(-pf_dist[r] / kT);
+            hd    = vrna_hamming_distance(rstarts[r], strings[r]);
+            char *msg = vrna_strdup_printf("  %3d  (%g)", hd, prob);
+            print_structure(stdout, strings[r], msg);
+            free(msg);
+          }
+
+          if (!mfe)
+            found--;
+        }
       }
 
       (void)fflush(stdout);
-      free(string);
+
+      for (r = 0; r < n; r++) {
+        free(strings[r]);
+        free(rstarts[r]);
+        free(failed[r]);
+      }
+      free(strings);
+      free(rstarts);
+      free(failed);
+      free(seeds);
+      free(mfe_dist);
+      free(pf_dist);
     }
-    free(rstart);
+
+    for (i = 0; i < n_threads; i++)
+      vrna_inverse_free(ctx[i]);
+    free(ctx);
     free_arrays();
 
     free(structure);
@@ -29,17 +29,19 @@
 #include "RNApaln_cmdl.h"
 
 #define MAXLENGTH  10000
-#define MAXSEQ      1000
+#define MAXSEQ      1000  /* initial number of profiles kept for the score matrix */
 
 
 static double gapo    = 1.5, gape = 0.666, seqw = 0.5;
 static int    endgaps = 0;
+static unsigned int band = 0;
 
 PRIVATE void command_line(int   argc,
                           char  *argv[]);
 
 
-PRIVATE void print_aligned_lines(FILE *somewhere);
+PRIVATE void print_aligned_lines(FILE           *somewhere,
+                                 vrna_dist_ws_t *ws);
 
 
 PRIVATE char  task;
@@ -53,9 +55,11 @@ main(int  argc,
      char *argv[])
 
 {
-  float *T[MAXSEQ];
-  char  *seq[MAXSEQ];
-  int   i, j, istty, n = 0;
+  float           **T, *score_mat;
+  char            **seq;
+  int             i, j, istty, n = 0, T_size;
+  unsigned int    options;
+  vrna_dist_ws_t  *ws;
   int   type, length, taxa_list = 0;
   float dist;
   FILE  *somewhere = NULL;
@@ -66,6 +70,12 @@ main(int  argc,
 
   command_line(argc, argv);
 
+  ws      = vrna_dist_ws_init();
+  options = (edit_backtrack) ? VRNA_DIST_BACKTRACK : VRNA_DIST_DEFAULT;
+  T_size  = MAXSEQ;
+  T       = (float **)vrna_alloc(sizeof(float *) * T_size);
+  seq     = (char **)vrna_alloc(sizeof(char *) * T_size);
+
   if ((outfile[0] == '\0') && (task == 'm') && (edit_backtrack))
     strcpy(outfile, "backtrack.file");
 
@@ -138,16 +148,32 @@ main(int  argc,
         printf("* END of taxa list\n");
 
       printf("> p %d (pdist)\n", n);
+
+      /* compute the entire matrix concurrently unless we need the alignments */
+      score_mat = NULL;
+      if (!edit_backtrack) {
+        T[n]      = NULL;
+        seq[n]    = NULL;
+        score_mat = vrna_profile_aln_matrix((const float **)T,
+                                            (const char **)seq,
+                                            band,
+                                            options);
+      }
+
       for (i = 1; i < n; i++) {
         for (j = 0; j < i; j++) {
-          printf("%g ", profile_aln(T[i], seq[i], T[j], seq[j]));
+          printf("%g ",
+                 (score_mat) ?
+                 score_mat[i * (i - 1) / 2 + j] :
+                 vrna_profile_aln(ws, T[i], seq[i], T[j], seq[j], band, options));
           if (edit_backtrack)
             fprintf(somewhere, "> %d %d\n", i + 1, j + 1);
 
-          print_aligned_lines(somewhere);
+          print_aligned_lines(somewhere, ws);
         }
         printf("\n");
       }
+      free(score_mat);
       if (type == 888) {
         /* do another distance matrix */
         n = 0;
@@ -157,8 +183,10 @@ main(int  argc,
     }
 
     if (type > 800) {
-      for (i = 0; i < n; i++)
+      for (i = 0; i < n; i++) {
         free_profile(T[i]);
+        free(seq[i]);
+      }
       if (type == 888)
         continue;
 
@@ -168,6 +196,10 @@ main(int  argc,
       if (line != NULL)
         free(line);
 
+      free(T);
+      free(seq);
+      vrna_dist_ws_free(ws);
+
       return 0; /* finito */
     }
 
@@ -201,6 +233,13 @@ main(int  argc,
     /* call threadsafe dot plot printing function */
     PS_dot_plot_list(line, fname, pr_pl, mfe_pl, "");
 
+    /* keep one more entry for the terminating NULL of vrna_profile_aln_matrix() */
+    if (n + 1 >= T_size) {
+      T_size  *= 2;
+      T       = (float **)vrna_realloc(T, sizeof(float *) * T_size);
+      seq     = (char **)vrna_realloc(seq, sizeof(char *) * T_size);
+    }
+
     T[n]    = Make_bp_profile_bppm(pr, length);
     seq[n]  = strdup(line);
     if ((istty) && (task == 'm'))
@@ -216,9 +255,9 @@ main(int  argc,
     switch (task) {
       case 'p':
         if (n == 2) {
-          dist = profile_aln(T[0], seq[0], T[1], seq[1]);
+          dist = vrna_profile_aln(ws, T[0], seq[0], T[1], seq[1], band, options);
           printf("%g\n", dist);
-          print_aligned_lines(somewhere);
+          print_aligned_lines(somewhere, ws);
           free_profile(T[0]);
           free_profile(T[1]);
           free(seq[0]);
@@ -229,9 +268,9 @@ main(int  argc,
         break;
       case 'f':
         if (n > 1) {
-          dist = profile_aln(T[1], seq[1], T[0], seq[0]);
+          dist = vrna_profile_aln(ws, T[1], seq[1], T[0], seq[0], band, options);
           printf("%g\n", dist);
-          print_aligned_lines(somewhere);
+          print_aligned_lines(somewhere, ws);
           free_profile(T[1]);
           free(seq[1]);
           n = 1;
@@ -240,9 +279,9 @@ main(int  argc,
         break;
       case 'c':
         if (n > 1) {
-          dist = profile_aln(T[1], seq[1], T[0], seq[0]);
+          dist = vrna_profile_aln(ws, T[1], seq[1], T[0], seq[0], band, options);
           printf("%g\n", dist);
-          print_aligned_lines(somewhere);
+          print_aligned_lines(somewhere, ws);
           free_profile(T[0]);
           free(seq[0]);
           T[0]    = T[1];
@@ -263,6 +302,10 @@ main(int  argc,
   if (line != NULL)
     free(line);
 
+  free(T);
+  free(seq);
+  vrna_dist_ws_free(ws);
+
   return 0;
 }
 
@@ -367,6 +410,14 @@ command_line(int  argc,
   if (args_info.endgaps_given)
     endgaps = 1;
 
+  /* restrict the alignments to a band around the diagonal */
+  if (args_info.band_given) {
+    if (args_info.band_arg < 0)
+      vrna_message_warning("Band width must not be negative, using complete alignments");
+    else
+      band = (unsigned int)args_info.band_arg;
+  }
+
   /* do not convert DNA nucleotide "T" to appropriate RNA "U" */
   if (args_info.noconv_given)
     noconv = 1;
@@ -408,12 +459,13 @@ command_line(int  argc,
 /*--------------------------------------------------------------------------*/
 
 PRIVATE void
-print_aligned_lines(FILE *somewhere)
+print_aligned_lines(FILE            *somewhere,
+                    vrna_dist_ws_t  *ws)
 {
   if (edit_backtrack)
     fprintf(somewhere, "%s\n%s\n%s\n%s\n",
-            aligned_line[2], aligned_line[0],
-            aligned_line[3], aligned_line[1]);
+            ws->aligned_line[2], ws->aligned_line[0],
+            ws->aligned_line[3], ws->aligned_line[1]);
 }
 
 
@@ -28,14 +28,15 @@
 
 
 #define MAXLENGTH  10000
-#define MAXSEQ      1000
+#define MAXSEQ      1000  /* initial number of profiles kept for the distance matrix */
 
 PRIVATE void command_line(int       argc,
                           char      *argv[],
                           vrna_md_t *md);
 
 
-PRIVATE void print_aligned_lines(FILE *somewhere);
+PRIVATE void print_aligned_lines(FILE           *somewhere,
+                                 vrna_dist_ws_t *ws);
 
 
 PRIVATE char  task;
@@ -43,14 +44,17 @@ PRIVATE char  outfile[FILENAME_MAX_LENGTH];
 PRIVATE char  ruler[] = "....,....1....,....2....,....3....,....4"
                         "....,....5....,....6....,....7....,....8";
 static int    noconv = 0;
+PRIVATE unsigned int  band = 0;
 
 int
 main(int  argc,
      char *argv[])
 
 {
-  float     *T[MAXSEQ];
-  int       i, j, istty, n = 0;
+  float           **T, *dist_mat;
+  int             i, j, istty, n = 0, T_size;
+  unsigned int    options;
+  vrna_dist_ws_t  *ws;
   int       type, taxa_list = 0;
   float     dist;
   FILE      *somewhere = NULL;
@@ -66,6 +70,11 @@ main(int  argc,
 
   command_line(argc, argv, &md);
 
+  ws      = vrna_dist_ws_init();
+  options = (edit_backtrack) ? VRNA_DIST_BACKTRACK : VRNA_DIST_DEFAULT;
+  T_size  = MAXSEQ;
+  T       = (float **)vrna_alloc(sizeof(float *) * T_size);
+
   if ((outfile[0] == '\0') && (task == 'm') && edit_backtrack)
     strcpy(outfile, "backtrack.file");
 
@@ -143,16 +152,28 @@ main(int  argc,
         printf("* END of taxa list\n");
 
       printf("> p %d (pdist)\n", n);
+
+      /* compute the entire matrix concurrently unless we need the alignments */
+      dist_mat = NULL;
+      if (!edit_backtrack) {
+        T[n]      = NULL;
+        dist_mat  = vrna_profile_edit_distance_matrix((const float **)T, band, options);
+      }
+
       for (i = 1; i < n; i++) {
         for (j = 0; j < i; j++) {
-          printf("%g ", profile_edit_distance(T[i], T[j]));
+          printf("%g ",
+                 (dist_mat) ?
+                 dist_mat[i * (i - 1) / 2 + j] :
+                 vrna_profile_edit_distance(ws, T[i], T[j], band, options));
           if (edit_backtrack)
             fprintf(somewhere, "> %d %d\n", i + 1, j + 1);
 
-          print_aligned_lines(somewhere);
+          print_aligned_lines(somewhere, ws);
         }
         printf("\n");
       }
+      free(dist_mat);
       if (type == 888) {
         /* do another distance matrix */
         n = 0;
@@ -173,6 +194,9 @@ main(int  argc,
       if (line != NULL)
         free(line);
 
+      free(T);
+      vrna_dist_ws_free(ws);
+
       return 0; /* finito */
     }
 
@@ -200,6 +224,12 @@ main(int  argc,
     /* call threadsafe dot plot printing function */
     PS_dot_plot_list(line, fname, pr_pl, mfe_pl, "");
 
+    /* keep one more entry for the terminating NULL of vrna_profile_edit_distance_matrix() */
+    if (n + 1 >= T_size) {
+      T_size  *= 2;
+      T       = (float **)vrna_realloc(T, sizeof(float *) * T_size);
+    }
+
     T[n] = Make_bp_profile_bppm(vc->exp_matrices->probs, vc->length);
 
     if ((istty) && (task == 'm'))
@@ -214,9 +244,9 @@ main(int  argc,
     switch (task) {
       case 'p':
         if (n == 2) {
-          dist = profile_edit_distance(T[0], T[1]);
+          dist = vrna_profile_edit_distance(ws, T[0], T[1], band, options);
           printf("%g\n", dist);
-          print_aligned_lines(somewhere);
+          print_aligned_lines(somewhere, ws);
           free_profile(T[0]);
           free_profile(T[1]);
           n = 0;
@@ -225,9 +255,9 @@ main(int  argc,
         break;
       case 'f':
         if (n > 1) {
-          dist = profile_edit_distance(T[1], T[0]);
+          dist = vrna_profile_edit_distance(ws, T[1], T[0], band, options);
           printf("%g\n", dist);
-          print_aligned_lines(somewhere);
+          print_aligned_lines(somewhere, ws);
           free_profile(T[1]);
           n = 1;
         }
@@ -235,9 +265,9 @@ main(int  argc,
         break;
       case 'c':
         if (n > 1) {
-          dist = profile_edit_distance(T[1], T[0]);
+          dist = vrna_profile_edit_distance(ws, T[1], T[0], band, options);
           printf("%g\n", dist);
-          print_aligned_lines(somewhere);
+          print_aligned_lines(somewhere, ws);
           free_profile(T[0]);
           T[0]  = T[1];
           n     = 1;
@@ -256,6 +286,9 @@ main(int  argc,
   if (line != NULL)
     free(line);
 
+  free(T);
+  vrna_dist_ws_free(ws);
+
   return 0;
 }
 
@@ -345,6 +378,14 @@ command_line(int        argc,
     edit_backtrack = 1;
   }
 
+  /* restrict the alignments to a band around the diagonal */
+  if (args_info.band_given) {
+    if (args_info.band_arg < 0)
+      vrna_message_warning("Band width must not be negative, using complete alignments");
+    else
+      band = (unsigned int)args_info.band_arg;
+  }
+
   /* free allocated memory of command line data structure */
   RNApdist_cmdline_parser_free(&args_info);
 
@@ -360,10 +401,11 @@ command_line(int        argc,
 /* ------------------------------------------------------------------------- */
 
 PRIVATE void
-print_aligned_lines(FILE *somewhere)
+print_aligned_lines(FILE            *somewhere,
+                    vrna_dist_ws_t  *ws)
 {
   if (edit_backtrack)
-    fprintf(somewhere, "%s\n%s\n", aligned_line[0], aligned_line[1]);
+    fprintf(somewhere, "%s\n%s\n", ws->aligned_line[0], ws->aligned_line[1]);
 }
 
 
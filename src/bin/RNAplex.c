@@ -15,9 +15,19 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 #include <time.h>
 #include <sys/types.h>
 #include <unistd.h>
+
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_MMAP)
+#include <sys/mman.h>
+#endif
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 #include "ViennaRNA/params/default.h"
 #include "ViennaRNA/fold_vars.h"
 #include "ViennaRNA/params/basic.h"
@@ -35,6 +45,70 @@
 #include "ViennaRNA/io/utils.h"
 #include "RNAplex_cmdl.h"
 
+#define PLEX_INDEX_MAGIC        "RNAplexI"
+#define PLEX_INDEX_VERSION      2
+#define PLEX_INDEX_BYTE_ORDER   0x01020304
+
+/* flags of a target entry in the index */
+#define PLEX_INDEX_BINARY       1   /* profile was read from a binary (-b) opening energy file */
+
+/* minimum number of targets scanned at once, see scan_plex_targets() */
+#define PLEX_TARGET_BLOCK       16
+
+/* header of the target index file */
+typedef struct {
+  char    magic[8];
+  int32_t version;
+  int32_t byte_order;
+  int64_t n;      /* number of targets */
+  int64_t table;  /* file offset of the target entries */
+} plex_index_head_t;
+
+/* file offsets and dimensions of a single target in the index */
+typedef struct {
+  int64_t name;
+  int64_t seq;
+  int64_t profile;
+  int32_t length;   /* length of the N-padded sequence */
+  int32_t rows;     /* number of profile rows */
+  int32_t u;        /* largest region for which opening energies are available */
+  int32_t flags;
+} plex_index_entry_t;
+
+typedef struct {
+  int                 n;
+  plex_index_entry_t  *entries;
+  char                *map;   /* memory mapped index */
+  size_t              size;
+  FILE                *fp;    /* used if the index could not be mapped */
+} plex_index_t;
+
+/* a target or query sequence together with its opening energy profile */
+typedef struct {
+  char  *id;
+  char  *seq;
+  char  *file;
+  int   **access;
+  int   *profile;   /* contiguous profile storage of indexed targets */
+  int   indexed;
+  char  *message;   /* reason why the target is not scanned */
+} plex_seq_t;
+
+/* settings for the accessibility based scan */
+typedef struct {
+  int     delta;
+  int     alignment_length;
+  int     deltaz;
+  int     fast;
+  int     il_a;
+  int     il_b;
+  int     b_a;
+  int     b_b;
+  int     binaries;
+  int     noconv;
+  double  verhaeltnis;
+} plex_opt_t;
+
 
 clock_t
 BeginTimer()
@@ -154,6 +228,73 @@ double probcompute_newparameters(char   *s1,
 static int convert_plfold_i(char *fname);/* convert test accessibility into bin accessibility. */
 
 
+static char *read_plex_record(FILE *fp,
+                              char **id,
+                              int  noconv);
+
+
+static int **read_plex_profile(const char *access,
+                               plex_seq_t *rna,
+                               double     verhaeltnis,
+                               int        alignment_length,
+                               int        fast,
+                               int        binaries);
+
+
+static void free_plex_seq(plex_seq_t *rna);
+
+
+static plex_seq_t *read_plex_queries(FILE       *fp,
+                                     const char *access,
+                                     int        *n,
+                                     double     verhaeltnis,
+                                     int        alignment_length,
+                                     int        fast,
+                                     int        binaries,
+                                     int        noconv);
+
+
+static void scan_plex_block(plex_seq_t        *targets,
+                            int               n_targets,
+                            plex_seq_t        *queries,
+                            int               n_queries,
+                            const plex_opt_t  *opt);
+
+
+/* scan all queries against the targets read from a file or a target index */
+static void scan_plex_targets(FILE              *mRNA,
+                              plex_index_t      *index,
+                              const char        *access,
+                              plex_seq_t        *queries,
+                              int               n_queries,
+                              int               n_threads,
+                              const plex_opt_t  *opt);
+
+
+/* store targets and their opening energies in a target index */
+static int build_plex_index(const char        *tname,
+                            const char        *access,
+                            const char        *iname,
+                            const plex_opt_t  *opt);
+
+
+static plex_index_t *open_plex_index(const char *iname);
+
+
+static void close_plex_index(plex_index_t *index);
+
+
+static void *read_plex_index(plex_index_t *index,
+                             int64_t      offset,
+                             size_t       size);
+
+
+static int fetch_plex_index(plex_index_t      *index,
+                            int               i,
+                            plex_seq_t        *target,
+                            const plex_opt_t  *opt);
+
+
 static char scale[] = "....,....1....,....2....,....3....,....4"
                       "....,....5....,....6....,....7....,....8";
 
@@ -172,6 +313,7 @@ main(int  argc,
   char                            *tname  = NULL;
   char                            *qname  = NULL;
   char                            *access = NULL;
+  char                            *tindex = NULL;
   char                            fname[FILENAME_MAX_LENGTH];
   char                            *ParamFile  = NULL;
   char                            *ns_bases   = NULL, *c;
@@ -211,6 +353,7 @@ main(int  argc,
   double                          k_concentration     = 0;
   double                          tris_concentration  = 0;
   int                             probe_mode          = 0;
+  int                             n_threads           = 1;
   /*
    #############################################
    # check the command line parameters
@@ -271,6 +414,24 @@ main(int  argc,
   if (args_info.convert_to_bin_given)
     convert = 1;
 
+  /*target_index*/
+  if (args_info.target_index_given)
+    tindex = strdup(args_info.target_index_arg);
+
+  /*jobs*/
+  if (args_info.jobs_given) {
+#ifdef _OPENMP
+    n_threads = (args_info.jobs_arg > 0) ? args_info.jobs_arg : omp_get_num_procs();
+#else
+    vrna_message_warning("This version of RNAplex has been built without parallel scan support.\n"
+                         "Ignoring request to scan in parallel!");
+#endif
+  }
+
+#ifdef _OPENMP
+  omp_set_num_threads(n_threads);
+#endif
+
   /*alignment_mode*/
   if (args_info.alignment_mode_given)
     alignment_mode = 1;
@@ -319,6 +480,20 @@ main(int  argc,
 
   int il_a, il_b, b_a, b_b;
   linear_fit(&il_a, &il_b, &b_a, &b_b);
+
+  plex_opt_t opt;
+  opt.delta             = delta;
+  opt.alignment_length  = alignment_length;
+  opt.deltaz            = deltaz;
+  opt.fast              = fast;
+  opt.il_a              = il_a;
+  opt.il_b              = il_b;
+  opt.b_a               = b_a;
+  opt.b_b               = b_b;
+  opt.binaries          = binaries;
+  opt.noconv            = noconv;
+  opt.verhaeltnis       = verhaeltnis;
+
   /**
    * check if we have two input files
    */
@@ -395,6 +570,21 @@ main(int  argc,
     return 0;
   }
 
+  if (tindex && !(convert && access && tname) &&
+      ((access == NULL) || (qname == NULL) || tname || fold_constrained || alignment_mode)) {
+    vrna_message_error("The target index requires an accessibility directory (-a) and either a target file\n"
+                       "and -k to create it, or a query file to scan. It can not be used with -t, -C, or -A otherwise.");
+  }
+
+  /**
+   * Create a target index from the target file and its opening energy profiles
+   */
+  if (convert && access && tindex) {
+    build_plex_index(tname, access, tindex, &opt);
+    RNAplex_cmdline_parser_free(&args_info);
+    return 0;
+  }
+
   if (convert && access) {
     char          pattern[8];
     strcpy(pattern, "_openen");
@@ -537,20 +727,29 @@ main(int  argc,
   /**
    * check if we have two input files
    */
-  if ((qname == NULL && tname) || (qname && tname == NULL)) {
+  if ((qname == NULL && (tname || tindex)) || (qname && tname == NULL && tindex == NULL)) {
     RNAplex_cmdline_parser_print_help();
-  } else if (qname && tname && !(alignment_mode)) {
+  } else if (qname && (tname || tindex) && !(alignment_mode)) {
     /*free allocated memory of commandline parser*/
     RNAplex_cmdline_parser_free(&args_info);
 
     if (!fold_constrained) {
       if (access) {
-        char *id_s1 = NULL;
-        mRNA = fopen(tname, "r");
-        if (mRNA == NULL) {
-          printf("%s: Wrong target file name\n", tname);
-          RNAplex_cmdline_parser_free(&args_info);
-          return 0;
+        int           n_queries;
+        plex_seq_t    *queries;
+        plex_index_t  *index = NULL;
+
+        if (tindex) {
+          index = open_plex_index(tindex);
+          if (index == NULL)
+            return 0;
+        } else {
+          mRNA = fopen(tname, "r");
+          if (mRNA == NULL) {
+            printf("%s: Wrong target file name\n", tname);
+            RNAplex_cmdline_parser_free(&args_info);
+            return 0;
+          }
         }
 
         sRNA = fopen(qname, "r");
@@ -560,182 +759,27 @@ main(int  argc,
           return 0;
         }
 
-        do {
-          /* main loop: continue until end of file */
-          if ((line_t = vrna_read_line(mRNA)) == NULL)
-            break;
-
-          /*parse line, get id for further accessibility fetching*/
-          while ((*line_t == '*') || (*line_t == '\0') || (*line_t == '>')) {
-            if (*line_t == '>') {
-              if (id_s1) {
-                free(id_s1);
-                id_s1 = NULL;
-              }
-
-              id_s1 = (char *)vrna_alloc(strlen(line_t) + 2);
-              (void)sscanf(line_t, "%s", id_s1);
-              memmove(id_s1, id_s1 + 1, strlen(id_s1));
-              free(line_t);
-              line_t = NULL;
-            }
-
-            if (line_t)
-              free(line_t);
-
-            if ((line_t = vrna_read_line(mRNA)) == NULL)
-              break;
-          }
-          /*append N's to the sequence in order to avoid boundary checking*/
-          if ((line_t == NULL) || (strcmp(line_t, "@") == 0)) {
-            if (id_s1) {
-              free(id_s1);
-              id_s1 = NULL;
-            }
-
-            break;
-          }
-
-          s1 = (char *)vrna_alloc(strlen(line_t) + 1 + 20);
-          strcpy(s1, "NNNNNNNNNN"); /*add NNNNNNNNNN to avoid boundary check*/
-          strcat(s1, line_t);
-          free(line_t);
-          strcat(s1, "NNNNNNNNNN\0");
-          int s1_len;
-          s1_len = strlen(s1);
-          for (l = 0; l < s1_len; l++) {
-            s1[l] = toupper(s1[l]);
-            if (!noconv && s1[l] == 'T')
-              s1[l] = 'U';
-          }
-
-          /*read accessibility*/
-          int   **access_s1;
-          char  *file_s1;
-          file_s1 = (char *)vrna_alloc(sizeof(char) * (strlen(id_s1) + strlen(access) + 20));
-          strcpy(file_s1, access);
-          strcat(file_s1, "/");
-          strcat(file_s1, id_s1);
-          strcat(file_s1, "_openen");
-          if (!binaries) {
-            access_s1 = read_plfold_i(file_s1, 1, s1_len, verhaeltnis, alignment_length, fast);
-          } else {
-            strcat(file_s1, "_bin");
-            access_s1 = read_plfold_i_bin(file_s1, 1, s1_len, verhaeltnis, alignment_length, fast);
-          }
-
-          if (access_s1 == NULL) {
-            printf("Accessibility file %s not found or corrupt, look at next target RNA\n", file_s1);
-            free(file_s1);
-            free(s1);
-            free(id_s1);
-            id_s1 = NULL;
-            continue;
-          }
-
-          do {
-            char *id_s2 = NULL;
-            if ((line_q = vrna_read_line(sRNA)) == NULL)
-              break;
-
-            while ((*line_q == '*') || (*line_q == '\0') || (*line_q == '>')) {
-              if (*line_q == '>') {
-                if (id_s2) {
-                  free(id_s2);
-                  id_s2 = NULL;
-                }
-
-                id_s2 = (char *)vrna_alloc(strlen(line_q) + 2);
-                (void)sscanf(line_q, "%s", id_s2);
-                memmove(id_s2, id_s2 + 1, strlen(id_s2));
-                free(line_q);
-                line_q = NULL;
-              }
-
-              if (line_q)
-                free(line_q);
-
-              if ((line_q = vrna_read_line(sRNA)) == NULL)
-                break;
-            }
-            if ((line_q == NULL) || (strcmp(line_q, "@") == 0)) {
-              if (id_s2) {
-                free(id_s2);
-                id_s2 = NULL;
-              }
-
-              break;
-            }
-
-            if (!id_s2) {
-              free(line_q);
-              continue;
-            }
+        /* queries and their opening energies are read only once */
+        queries = read_plex_queries(sRNA,
+                                    access,
+                                    &n_queries,
+                                    verhaeltnis,
+                                    alignment_length,
+                                    fast,
+                                    binaries,
+                                    noconv);
+        fclose(sRNA);
 
-            s2 = (char *)vrna_alloc(strlen(line_q) + 1 + 20);
-            strcpy(s2, "NNNNNNNNNN"); /*add NNNNNNNNNN to avoid boundary check*/
-            strcat(s2, line_q);
-            free(line_q);
-            strcat(s2, "NNNNNNNNNN\0");
-            int s2_len;
-            s2_len = strlen(s2);
-            for (l = 0; l < s2_len; l++) {
-              s2[l] = toupper(s2[l]);
-              if (!noconv && s2[l] == 'T')
-                s2[l] = 'U';
-            }
-            int   **access_s2;
-            char  *file_s2;
-            file_s2 = (char *)vrna_alloc(sizeof(char) * (strlen(id_s2) + strlen(access) + 20));
-            strcpy(file_s2, access);
-            strcat(file_s2, "/");
-            strcat(file_s2, id_s2);
-            strcat(file_s2, "_openen");
-            if (!binaries) {
-              access_s2 = read_plfold_i(file_s2, 1, s2_len, verhaeltnis, alignment_length, fast);
-            } else {
-              strcat(file_s2, "_bin");
-              access_s2 = read_plfold_i_bin(file_s2, 1, s2_len, verhaeltnis, alignment_length, fast);
-            }
+        scan_plex_targets(mRNA, index, access, queries, n_queries, n_threads, &opt);
 
-            if (access_s2 == NULL) {
-              printf("Accessibility file %s not found, look at next target RNA\n", file_s2);
-              free(file_s2);
-              free(s2);
-              free(id_s2);
-              id_s2 = NULL;
-              continue;
-            }
+        for (i = 0; i < n_queries; i++)
+          free_plex_seq(queries + i);
+        free(queries);
 
-            printf(">%s\n>%s\n", id_s1, id_s2);
-            double  begin = BeginTimer();
-            Lduplexfold_XS(s1, s2, (const int **)access_s1, (const int **)access_s2, delta, alignment_length, deltaz, fast, il_a, il_b, b_a, b_b);
-            float   elapTicks;
-            float   elapMilli;
-            elapTicks = (EndTimer(begin) - begin);
-            elapMilli = elapTicks / 1000;
-            /*             printf("Millisecond %.2f\n",elapMilli); */
-            free(id_s2);
-            free(file_s2);
-            free(s2);
-            id_s2 = NULL;
-            i     = access_s2[0][0];
-            while (--i > -1)
-              free(access_s2[i]);
-            free(access_s2);
-          } while (1);
-          free(id_s1);
-          id_s1 = NULL;
-          free(file_s1);
-          free(s1);
-          rewind(sRNA);
-          i = access_s1[0][0];
-          while (--i > -1)
-            free(access_s1[i]);
-          free(access_s1);
-        } while (1);
-        fclose(mRNA);
-        fclose(sRNA);
+        if (index)
+          close_plex_index(index);
+        else
+          fclose(mRNA);
       } else if (access == NULL) {
         /* t and q are defined, but no accessibility is provided */
         mRNA = fopen(tname, "r");
@@ -1561,11 +1605,12 @@ main(int  argc,
     access = NULL;
   }
 
-  if (tname) {
+  if (tname || tindex) {
     free(qname);
     access = NULL;
   }
 
+  free(tindex);
   RNAplex_cmdline_parser_free(&args_info);
   return 0;
 }
@@ -1813,6 +1858,552 @@ read_plfold_i_bin(char      *fname,
 }
 
 
+/*
+ *  Batched scanning of queries against targets with accessibility
+ *
+ *  All queries and their opening energy profiles are read only once.
+ *  Targets are either read from the target file and the accessibility
+ *  directory, or taken from a memory mapped target index, and scanned
+ *  in blocks against all queries, each target/query pair being an
+ *  independent task.
+ */
+static char *
+read_plex_record(FILE *fp,
+                 char **id,
+                 int  noconv)
+{
+  char  *line, *s;
+  int   l, s_len;
+
+  *id = NULL;
+
+  if ((line = vrna_read_line(fp)) == NULL)
+    return NULL;
+
+  /*parse line, get id for further accessibility fetching*/
+  while ((*line == '*') || (*line == '\0') || (*line == '>')) {
+    if (*line == '>') {
+      free(*id);
+      *id = (char *)vrna_alloc(strlen(line) + 2);
+      (void)sscanf(line, "%s", *id);
+      memmove(*id, *id + 1, strlen(*id));
+    }
+
+    free(line);
+    if ((line = vrna_read_line(fp)) == NULL)
+      break;
+  }
+
+  if ((line == NULL) || (strcmp(line, "@") == 0)) {
+    free(line);
+    free(*id);
+    *id = NULL;
+    return NULL;
+  }
+
+  /*append N's to the sequence in order to avoid boundary checking*/
+  s = (char *)vrna_alloc(strlen(line) + 1 + 20);
+  strcpy(s, "NNNNNNNNNN");
+  strcat(s, line);
+  strcat(s, "NNNNNNNNNN");
+  free(line);
+  s_len = strlen(s);
+  for (l = 0; l < s_len; l++) {
+    s[l] = toupper(s[l]);
+    if (!noconv && s[l] == 'T')
+      s[l] = 'U';
+  }
+
+  return s;
+}
+
+
+static int **
+read_plex_profile(const char  *access,
+                  plex_seq_t  *rna,
+                  double      verhaeltnis,
+                  int         alignment_length,
+                  int         fast,
+                  int         binaries)
+{
+  rna->file = (char *)vrna_alloc(sizeof(char) * (strlen(rna->id) + strlen(access) + 20));
+  strcpy(rna->file, access);
+  strcat(rna->file, "/");
+  strcat(rna->file, rna->id);
+  strcat(rna->file, "_openen");
+  if (!binaries) {
+    rna->access = read_plfold_i(rna->file, 1, strlen(rna->seq), verhaeltnis, alignment_length, fast);
+  } else {
+    strcat(rna->file, "_bin");
+    rna->access = read_plfold_i_bin(rna->file, 1, strlen(rna->seq), verhaeltnis, alignment_length, fast);
+  }
+
+  return rna->access;
+}
+
+
+static void
+free_plex_seq(plex_seq_t *rna)
+{
+  int i;
+
+  if (rna->access) {
+    if (rna->indexed) {
+      free(rna->profile);
+    } else {
+      i = rna->access[0][0];
+      while (--i > -1)
+        free(rna->access[i]);
+    }
+
+    free(rna->access);
+  }
+
+  free(rna->id);
+  free(rna->seq);
+  free(rna->file);
+  free(rna->message);
+  memset(rna, 0, sizeof(plex_seq_t));
+}
+
+
+static plex_seq_t *
+read_plex_queries(FILE        *fp,
+                  const char  *access,
+                  int         *n,
+                  double      verhaeltnis,
+                  int         alignment_length,
+                  int         fast,
+                  int         binaries,
+                  int         noconv)
+{
+  char        *id, *s;
+  int         size;
+  plex_seq_t  *queries;
+
+  *n      = 0;
+  size    = 16;
+  queries = (plex_seq_t *)vrna_alloc(sizeof(plex_seq_t) * size);
+
+  while ((s = read_plex_record(fp, &id, noconv))) {
+    /* queries without name can not be associated with a profile */
+    if (!id) {
+      free(s);
+      continue;
+    }
+
+    if (*n == size) {
+      size    *= 2;
+      queries = (plex_seq_t *)vrna_realloc(queries, sizeof(plex_seq_t) * size);
+    }
+
+    memset(queries + *n, 0, sizeof(plex_seq_t));
+    queries[*n].id  = id;
+    queries[*n].seq = s;
+    read_plex_profile(access, queries + *n, verhaeltnis, alignment_length, fast, binaries);
+    (*n)++;
+  }
+
+  return queries;
+}
+
+
+static void
+scan_plex_block(plex_seq_t        *targets,
+                int               n_targets,
+                plex_seq_t        *queries,
+                int               n_queries,
+                const plex_opt_t  *opt)
+{
+  int         k, t, q, n_tasks;
+  vrna_cstr_t *output;
+
+  n_tasks = n_targets * n_queries;
+  output  = (vrna_cstr_t *)vrna_alloc(sizeof(vrna_cstr_t) * (n_tasks + 1));
+
+  /*
+   *  Tasks are processed query by query, such that consecutive calls of
+   *  Lduplexfold_XS_cstr() in a thread can re-use the energy tables of
+   *  the query. The output is sorted by target again below.
+   */
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) private(t, q)
+#endif
+  for (k = 0; k < n_tasks; k++) {
+    q = k / n_targets;
+    t = k % n_targets;
+
+    if (targets[t].message)
+      continue;
+
+    output[t * n_queries + q] = vrna_cstr(0, stdout);
+
+    if (queries[q].access == NULL) {
+      vrna_cstr_printf(output[t * n_queries + q],
+                       "Accessibility file %s not found, look at next target RNA\n",
+                       queries[q].file);
+      continue;
+    }
+
+    vrna_cstr_printf(output[t * n_queries + q], ">%s\n>%s\n", targets[t].id, queries[q].id);
+    Lduplexfold_XS_cstr(output[t * n_queries + q],
+                        targets[t].seq,
+                        queries[q].seq,
+                        (const int **)targets[t].access,
+                        (const int **)queries[q].access,
+                        opt->delta,
+                        opt->alignment_length,
+                        opt->deltaz,
+                        opt->fast,
+                        opt->il_a,
+                        opt->il_b,
+                        opt->b_a,
+                        opt->b_b);
+  }
+
+  /* print results in the order of the input */
+  for (t = 0; t < n_targets; t++) {
+    if (targets[t].message)
+      printf("%s", targets[t].message);
+
+    for (q = 0; q < n_queries; q++)
+      vrna_cstr_free(output[t * n_queries + q]);
+  }
+
+  (void)fflush(stdout);
+  free(output);
+}
+
+
+static void
+scan_plex_targets(FILE              *mRNA,
+                  plex_index_t      *index,
+                  const char        *access,
+                  plex_seq_t        *queries,
+                  int               n_queries,
+                  int               n_threads,
+                  const plex_opt_t  *opt)
+{
+  char        *id, *s;
+  int         i, n, block, next;
+  plex_seq_t  *targets;
+
+  /* enough tasks per block to keep all threads busy */
+  block   = MAX2(PLEX_TARGET_BLOCK, (4 * n_threads + n_queries - 1) / MAX2(1, n_queries));
+  targets = (plex_seq_t *)vrna_alloc(sizeof(plex_seq_t) * block);
+  next    = 0;
+
+  do {
+    for (n = 0; n < block; n++) {
+      if (index) {
+        if (next == index->n)
+          break;
+
+        if (!fetch_plex_index(index, next++, targets + n, opt))
+          break;
+      } else {
+        if ((s = read_plex_record(mRNA, &id, opt->noconv)) == NULL)
+          break;
+
+        if (!id) {
+          free(s);
+          n--;
+          continue;
+        }
+
+        targets[n].id   = id;
+        targets[n].seq  = s;
+        if (!read_plex_profile(access, targets + n, opt->verhaeltnis, opt->alignment_length,
+                               opt->fast, opt->binaries)) {
+          targets[n].message = vrna_strdup_printf(
+            "Accessibility file %s not found or corrupt, look at next target RNA\n",
+            targets[n].file);
+        }
+      }
+    }
+
+    if (n == 0)
+      break;
+
+    scan_plex_block(targets, n, queries, n_queries, opt);
+    for (i = 0; i < n; i++)
+      free_plex_seq(targets + i);
+  } while (n == block);
+
+  free(targets);
+}
+
+
+/*
+ *  The target index stores the N-padded target sequences along with their
+ *  opening energy profiles, exactly as they are returned by read_plfold_i()
+ *  or read_plfold_i_bin(). It consists of a header, the data of each target
+ *  (name, sequence, and profile rows, each 8-byte aligned) and a table of
+ *  target entries at the end of the file. All numbers are stored in native
+ *  byte order.
+ */
+static int
+build_plex_index(const char       *tname,
+                 const char       *access,
+                 const char       *iname,
+                 const plex_opt_t *opt)
+{
+  char                s[8] = {
+    0x0
+  };
+  int                 i, size;
+  FILE                *mRNA, *fp;
+  plex_seq_t          target;
+  plex_index_head_t   head;
+  plex_index_entry_t  *entries;
+
+  mRNA = fopen(tname, "r");
+  if (mRNA == NULL) {
+    printf("%s: Wrong target file name\n", tname);
+    return 0;
+  }
+
+  fp = fopen(iname, "wb");
+  if (fp == NULL) {
+    vrna_message_warning("Could not open target index file '%s' for writing", iname);
+    fclose(mRNA);
+    return 0;
+  }
+
+  memset(&head, 0, sizeof(plex_index_head_t));
+  memcpy(head.magic, PLEX_INDEX_MAGIC, 8);
+  head.version    = PLEX_INDEX_VERSION;
+  head.byte_order = PLEX_INDEX_BYTE_ORDER;
+
+  /* leave room for the header, which is written last */
+  fwrite(&head, sizeof(plex_index_head_t), 1, fp);
+
+  size    = 1024;
+  entries = (plex_index_entry_t *)vrna_alloc(sizeof(plex_index_entry_t) * size);
+
+  memset(&target, 0, sizeof(plex_seq_t));
+  while ((target.seq = read_plex_record(mRNA, &(target.id), opt->noconv))) {
+    if (!target.id) {
+      free_plex_seq(&target);
+      continue;
+    }
+
+    /* profiles are stored unscaled, and the -l check is done when scanning */
+    if (!read_plex_profile(access, &target, 1., 0, 2, opt->binaries)) {
+      vrna_message_warning("Accessibility file %s not found or corrupt, skipping target %s",
+                           target.file,
+                           target.id);
+      free_plex_seq(&target);
+      continue;
+    }
+
+    if (head.n == size) {
+      size    *= 2;
+      entries = (plex_index_entry_t *)vrna_realloc(entries, sizeof(plex_index_entry_t) * size);
+    }
+
+    entries[head.n].length  = strlen(target.seq);
+    entries[head.n].rows    = target.access[0][0];
+    /* text profiles carry one additional row of INF values */
+    entries[head.n].u     = target.access[0][0] - ((opt->binaries) ? 1 : 2);
+    entries[head.n].flags = (opt->binaries) ? PLEX_INDEX_BINARY : 0;
+
+    entries[head.n].name = ftell(fp);
+    fwrite(target.id, sizeof(char), strlen(target.id) + 1, fp);
+    fwrite(s, sizeof(char), (8 - ftell(fp) % 8) % 8, fp);
+
+    entries[head.n].seq = ftell(fp);
+    fwrite(target.seq, sizeof(char), entries[head.n].length + 1, fp);
+    fwrite(s, sizeof(char), (8 - ftell(fp) % 8) % 8, fp);
+
+    entries[head.n].profile = ftell(fp);
+    for (i = 0; i < entries[head.n].rows; i++)
+      fwrite(target.access[i], sizeof(int), entries[head.n].length, fp);
+
+    head.n++;
+    free_plex_seq(&target);
+  }
+
+  fwrite(s, sizeof(char), (8 - ftell(fp) % 8) % 8, fp);
+  head.table = ftell(fp);
+  fwrite(entries, sizeof(plex_index_entry_t), head.n, fp);
+
+  fseek(fp, 0, SEEK_SET);
+  fwrite(&head, sizeof(plex_index_head_t), 1, fp);
+
+  if (ferror(fp))
+    vrna_message_warning("Error writing target index file '%s'", iname);
+
+  fclose(fp);
+  fclose(mRNA);
+  free(entries);
+
+  return 1;
+}
+
+
+static plex_index_t *
+open_plex_index(const char *iname)
+{
+  long              size;
+  FILE              *fp;
+  plex_index_head_t head;
+  plex_index_t      *index;
+
+  fp = fopen(iname, "rb");
+  if (fp == NULL) {
+    vrna_message_warning("Could not open target index file '%s'", iname);
+    return NULL;
+  }
+
+  fseek(fp, 0, SEEK_END);
+  size = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+
+  if ((fread(&head, sizeof(plex_index_head_t), 1, fp) != 1) ||
+      (memcmp(head.magic, PLEX_INDEX_MAGIC, 8) != 0) ||
+      (head.version != PLEX_INDEX_VERSION) ||
+      (head.byte_order != PLEX_INDEX_BYTE_ORDER) ||
+      (head.table + head.n * (int64_t)sizeof(plex_index_entry_t) > size)) {
+    vrna_message_warning("File '%s' is not a target index of this version of RNAplex", iname);
+    fclose(fp);
+    return NULL;
+  }
+
+  index       = (plex_index_t *)vrna_alloc(sizeof(plex_index_t));
+  index->n    = (int)head.n;
+  index->size = (size_t)size;
+
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_MMAP)
+  /* map the entire index, such that all targets share the page cache */
+  index->map = mmap(NULL, index->size, PROT_READ, MAP_PRIVATE, fileno(fp), 0);
+  if (index->map == MAP_FAILED)
+    index->map = NULL;
+
+#endif
+
+  if (index->map) {
+    index->entries = (plex_index_entry_t *)(index->map + head.table);
+    fclose(fp);
+  } else {
+    /* read the table of entries and fetch the target data on demand */
+    index->entries = (plex_index_entry_t *)vrna_alloc(sizeof(plex_index_entry_t) * (head.n + 1));
+    fseek(fp, head.table, SEEK_SET);
+    if (fread(index->entries, sizeof(plex_index_entry_t), head.n, fp) != (size_t)head.n)
+      index->n = 0;
+
+    index->fp = fp;
+  }
+
+  return index;
+}
+
+
+static void
+close_plex_index(plex_index_t *index)
+{
+  if (index) {
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_MMAP)
+    if (index->map)
+      munmap(index->map, index->size);
+
+#endif
+
+    if (index->fp) {
+      fclose(index->fp);
+      free(index->entries);
+    }
+
+    free(index);
+  }
+}
+
+
+static void *
+read_plex_index(plex_index_t  *index,
+                int64_t       offset,
+                size_t        size)
+{
+  void *data = vrna_alloc(size + 1);
+
+  if ((fseek(index->fp, offset, SEEK_SET) != 0) ||
+      (fread(data, 1, size, index->fp) != size)) {
+    free(data);
+    return NULL;
+  }
+
+  return data;
+}
+
+
+static int
+fetch_plex_index(plex_index_t     *index,
+                 int              i,
+                 plex_seq_t       *target,
+                 const plex_opt_t *opt)
+{
+  int                 r, j, scale;
+  size_t              n;
+  plex_index_entry_t  *e;
+
+  e = index->entries + i;
+  n = (size_t)e->rows * e->length;
+
+  /* same scaling of the opening energies as in read_plfold_i(), read_plfold_i_bin() ignores -V */
+  scale = ((opt->verhaeltnis != 1.) && (!(e->flags & PLEX_INDEX_BINARY))) ? 1 : 0;
+
+  if ((e->profile + (int64_t)(n * sizeof(int)) > (int64_t)index->size) ||
+      (e->name >= e->seq) ||
+      (e->seq >= e->profile)) {
+    vrna_message_warning("Target index is corrupt");
+    return 0;
+  }
+
+  memset(target, 0, sizeof(plex_seq_t));
+  target->indexed = 1;
+
+  if (index->map) {
+    target->id  = strdup(index->map + e->name);
+    target->seq = strdup(index->map + e->seq);
+    if (scale) {
+      target->profile = (int *)vrna_alloc(sizeof(int) * n);
+      memcpy(target->profile, index->map + e->profile, sizeof(int) * n);
+    }
+  } else {
+    target->id      = (char *)read_plex_index(index, e->name, e->seq - e->name);
+    target->seq     = (char *)read_plex_index(index, e->seq, e->profile - e->seq);
+    target->profile = (int *)read_plex_index(index, e->profile, sizeof(int) * n);
+    if ((!target->id) || (!target->seq) || (!target->profile)) {
+      vrna_message_warning("Could not read target %d from target index", i + 1);
+      free_plex_seq(target);
+      return 0;
+    }
+  }
+
+  target->access = (int **)vrna_alloc(sizeof(int *) * e->rows);
+  for (r = 0; r < e->rows; r++)
+    target->access[r] = (target->profile) ?
+                        target->profile + (size_t)r * e->length :
+                        (int *)(index->map + e->profile) + (size_t)r * e->length;
+
+  if (scale)
+    for (r = 1; r < e->rows; r++)
+      for (j = 0; j < e->length; j++)
+        if (target->access[r][j] != INF)
+          target->access[r][j] *= opt->verhaeltnis;
+
+  if (opt->alignment_length > e->u && opt->fast == 0) {
+    printf("Interaction length %d is larger than the length of the largest region %d \nfor which the opening energy was computed (-u parameter of RNAplfold)\n", opt->alignment_length, e->u);
+    printf("Please recompute your profiles with a larger -u or set -l to a smaller interaction length\n");
+    target->message = vrna_strdup_printf(
+      "Accessibility profile of %s in target index is too short, look at next target RNA\n",
+      target->id);
+  }
+
+  return 1;
+}
+
+
 static int
 get_max_u(const char  *s,
           char        delim)
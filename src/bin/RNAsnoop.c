@@ -16,6 +16,11 @@
 #include <unistd.h>
 #include <string.h>
 #include <time.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 #include "ViennaRNA/snofold.h"
 #include "ViennaRNA/fold.h"
 #include "ViennaRNA/params/default.h"
@@ -29,6 +34,7 @@
 #include "ViennaRNA/utils/strings.h"
 #include "ViennaRNA/utils/alignments.h"
 #include "ViennaRNA/io/utils.h"
+#include "ViennaRNA/datastructures/char_stream.h"
 #include "RNAsnoop_cmdl.h"
 static void  aliprint_struc(snoopT      *dup,
                             const char  **s1,
@@ -39,9 +45,10 @@ static void  aliprint_struc(snoopT      *dup,
                             int);
 
 
-static void  print_struc(snoopT     *dup,
-                         const char *s1,
-                         const char *s2,
+static void  print_struc(vrna_cstr_t output,
+                         snoopT      *dup,
+                         const char  *s1,
+                         const char  *s2,
                          char *,
                          char *,
                          int,
@@ -80,6 +87,16 @@ extern int cut_point;
 #define PRIVATE static
 #define MAX_NUM_NAMES    500
 
+/* a target sequence and its results, kept until all targets of a block are done */
+typedef struct {
+  char        *name_t;
+  char        *string_t;
+  char        *name_output;
+  snoopT      *subopt;
+  snoopT      mfe;
+  vrna_cstr_t output;
+} snoop_target_t;
+
 /*--------------------------------------------------------------------------*/
 
 int
@@ -133,6 +150,8 @@ main(int  argc,
                                     redraw /*if used (option I) allow to redraw command line output into ps files */;
 
   int noconv = 0;
+  int n_threads;
+  n_threads           = 1;
   string_s            = NULL;
   string_t            = NULL;
   plfold_up_flag      = 0;
@@ -232,6 +251,20 @@ main(int  argc,
   /*threshold on minimal lower stem energy*/
   alignment_length = args_info.alignmentLength_arg;
 
+  /*number of parallel threads*/
+  if (args_info.jobs_given) {
+#ifdef _OPENMP
+    n_threads = (args_info.jobs_arg > 0) ? args_info.jobs_arg : omp_get_num_procs();
+#else
+    vrna_message_warning("This version of RNAsnoop has been built without parallel support.\n"
+                         "Ignoring request to compute interactions in parallel!");
+#endif
+  }
+
+#ifdef _OPENMP
+  omp_set_num_threads(n_threads);
+#endif
+
   threshloop = MIN2(threshloop, 0);
 
   /*   if(plfold_up_flag && !fast){ */
@@ -345,180 +378,211 @@ main(int  argc,
       }
 
       fullStemEnergy = snofold(string_s, structure, max_asymm, threshloop, min_s2, max_s2, half_stem, max_half_stem);
+
+      /*
+       * targets are read in blocks, the interactions of a block are computed
+       * in parallel and written to stdout in input order afterwards
+       */
+      int             n_block, max_block, done;
+      char            *no_header;
+      vrna_cstr_t     tail;
+      snoop_target_t  *block;
+
+      max_block = (n_threads > 1) ? 4 * n_threads : 1;
+      block     = (snoop_target_t *)vrna_alloc(sizeof(snoop_target_t) * max_block);
+      done      = 0;
+      no_header = NULL;
+      tail      = NULL;
       do {
-        /* main loop for target continue until end of file */
-        snoopT  mfe;
-        if ((line_t = vrna_read_line(mrna)) == NULL)
-          /* free(line_t); */
-          break;
+        for (n_block = 0; n_block < max_block; n_block++) {
+          /* main loop for target continue until end of file */
+          if ((line_t = vrna_read_line(mrna)) == NULL) {
+            done = 1;
+            break;
+          }
 
-        char    *name_t = NULL;
+          snoop_target_t  *tg     = block + n_block;
+          char            *name_t = NULL;
 
-        /* skip comment lines and get filenames */
-        while ((*line_t == '*') || (*line_t == '\0') || (*line_t == '>')) {
-          if (*line_t == '>') {
-            printf("%s\n", name_s);
-            name_t = (char *)vrna_alloc(strlen(line_t) + 1);
-            (void)sscanf(line_t, "%s", name_t);
+          tg->output = vrna_cstr(0, stdout);
 
-            printf("%s\n", name_t);
-            free(line_t);
-            /*             free(string_t); */
-          }
+          /* skip comment lines and get filenames */
+          while ((*line_t == '*') || (*line_t == '\0') || (*line_t == '>')) {
+            if (*line_t == '>') {
+              vrna_cstr_printf(tg->output, "%s\n", name_s);
+              free(name_t);
+              name_t = (char *)vrna_alloc(strlen(line_t) + 1);
+              (void)sscanf(line_t, "%s", name_t);
+
+              vrna_cstr_printf(tg->output, "%s\n", name_t);
+            }
 
-          if ((line_t = vrna_read_line(mrna)) == NULL) {
             free(line_t);
+            if ((line_t = vrna_read_line(mrna)) == NULL)
+              break;
+          }
+          if ((name_t == NULL) || (line_t == NULL)) {
+            /* headers without sequence are reported after the current block */
+            tail      = tg->output;
+            no_header = line_t;
+            done      = 1;
+            free(name_t);
             break;
           }
-        }
-        if (name_t == NULL) {
-          printf("Your target sequence: \n%s\nhas no header. Please update your fasta file\n", line_t);
-          exit(0);
-        }
 
-        /*   if ((line ==NULL) || (strcmp(line, "@") == 0)) break; */
-        temp_t = (char *)vrna_alloc(strlen(line_t) + 1);
-        (void)sscanf(line_t, "%s", temp_t);
-        int length_t;
-        length_t = (int)strlen(temp_t);
-        for (l = 0; l < length_t; l++) {
-          temp_t[l] = toupper(temp_t[l]);
-          if (!noconv && temp_t[l] == 'T')
-            temp_t[l] = 'U';
-        }
-        string_t = (char *)vrna_alloc(length_t + 11);
-        strcpy(string_t, "NNNNN");
-        strcat(string_t + 5, temp_t);
-        strcat(string_t + 5 + length_t, "NNNNN");
-        free(temp_t);
-        char *name_output;
-        name_output = NULL;
-        if (nice) {
-          name_output = (char *)vrna_alloc(sizeof(char) * (length_t + length_s + 2));
-          strcpy(name_output, name_t + 1);
-          strcat(name_output, "_");
-          strcat(name_output, name_s + 1);
-          name_output[length_t + length_s + 1] = '\0';
-        }
+          /*   if ((line ==NULL) || (strcmp(line, "@") == 0)) break; */
+          temp_t = (char *)vrna_alloc(strlen(line_t) + 1);
+          (void)sscanf(line_t, "%s", temp_t);
+          free(line_t);
+          int length_t;
+          length_t = (int)strlen(temp_t);
+          for (l = 0; l < length_t; l++) {
+            temp_t[l] = toupper(temp_t[l]);
+            if (!noconv && temp_t[l] == 'T')
+              temp_t[l] = 'U';
+          }
+          string_t = (char *)vrna_alloc(length_t + 11);
+          strcpy(string_t, "NNNNN");
+          strcat(string_t + 5, temp_t);
+          strcat(string_t + 5 + length_t, "NNNNN");
+          free(temp_t);
+          char *name_output;
+          name_output = NULL;
+          if (nice) {
+            name_output = (char *)vrna_alloc(sizeof(char) * (length_t + length_s + 2));
+            strcpy(name_output, name_t + 1);
+            strcat(name_output, "_");
+            strcat(name_output, name_s + 1);
+            name_output[length_t + length_s + 1] = '\0';
+          }
 
-        if (delta >= 0) {
-          snoopT  *subopt;
-          snoopT  *sub;
-          if (!fast && !plfold_up_flag) {
-            subopt = snoop_subopt(string_t, string_s, delta, 5, penalty, threshloop,
-                                  threshLE, threshRE, threshDE, threshTE, threshSE, threshD, distance,
-                                  half_stem, max_half_stem, min_s2, max_s2, min_s1, max_s1, min_d1, min_d2, fullStemEnergy);
-            if (subopt == NULL) {
-              printf("no target found under the given constraints\n");
-              free(subopt);
-              free(string_t);
-              free(line_t);
-              continue;
-            }
+          tg->name_t      = name_t;
+          tg->string_t    = string_t;
+          tg->name_output = name_output;
+          tg->subopt      = NULL;
+          tg->mfe.energy  = INF;
+        }
 
-            int count = 0;
-            for (sub = subopt; sub->structure != NULL; sub++) {
-              print_struc(sub, string_t, string_s, name_s, name_t, count++, nice);
-              free(sub->structure);
+        /* compute the interactions that do not need accessibility profiles */
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) if (n_block > 1)
+#endif
+        for (i = 0; i < n_block; i++) {
+          snoop_target_t *tg = block + i;
+
+          if (delta >= 0) {
+            if (!fast && !plfold_up_flag) {
+              tg->subopt = snoop_subopt_cstr(tg->output, tg->string_t, string_s, delta, 5, penalty, threshloop,
+                                             threshLE, threshRE, threshDE, threshTE, threshSE, threshD, distance,
+                                             half_stem, max_half_stem, min_s2, max_s2, min_s1, max_s1, min_d1, min_d2, fullStemEnergy);
+            } else if (!plfold_up_flag) {
+              Lsnoop_subopt_list_cstr(tg->output, tg->string_t, string_s, delta, 5, penalty, threshloop,
+                                      threshLE, threshRE, threshDE, threshTE, threshSE, threshD, distance,
+                                      half_stem, max_half_stem, min_s2, max_s2, min_s1, max_s1, min_d1, min_d2, alignment_length, tg->name_output, fullStemEnergy);
             }
-            free(subopt);
-            free(string_t);
-            free(line_t);
-          } else if (!plfold_up_flag) {
-            Lsnoop_subopt_list(string_t, string_s, delta, 5, penalty, threshloop,
-                               threshLE, threshRE, threshDE, threshTE, threshSE, threshD, distance,
-                               half_stem, max_half_stem, min_s2, max_s2, min_s1, max_s1, min_d1, min_d2, alignment_length, name_output, fullStemEnergy);
-            free(string_t);
-            free(line_t);
           } else {
-            if (plfold_up_flag == 1) {
-              int   **access_s1;
-              char  *file_s1;
-              int   s1_len;/* k;*/ /*,j; */
-              s1_len  = strlen(string_t);
-              file_s1 = (char *)vrna_alloc(sizeof(char) * (strlen(name_t + 1) + strlen(access) + 9));
-              strcpy(file_s1, access);
-              strcat(file_s1, "/");
-              strcat(file_s1, name_t + 1);
-              strcat(file_s1, "_openen");
-              access_s1 = read_plfold_i(file_s1, 1, s1_len);
-              if (fast) {
-                Lsnoop_subopt_list_XS(string_t, string_s, (const int **)access_s1, delta, 5, penalty, threshloop,
-                                      threshLE, threshRE, threshDE, threshTE, threshSE, threshD, distance,
-                                      half_stem, max_half_stem, min_s2, max_s2, min_s1, max_s1, min_d1, min_d2, alignment_length, name_output, fullStemEnergy);
-              } else {
-                snoop_subopt_XS(string_t, string_s, (const int **)access_s1, delta, 5, penalty, threshloop,
-                                threshLE, threshRE, threshDE, threshTE, threshSE, threshD, distance,
-                                half_stem, max_half_stem, min_s2, max_s2, min_s1, max_s1, min_d1, min_d2, alignment_length, name_output, fullStemEnergy);
-              }
+            tg->mfe = snoopfold_cstr(tg->output, tg->string_t, string_s, penalty, threshloop, threshLE, threshRE, threshDE, threshD,
+                                     half_stem, max_half_stem, min_s2, max_s2, min_s1, max_s1, min_d1, min_d2, fullStemEnergy);
+          }
+        }
 
-              /*                for(j=0; j<s1_len; j++){  */
-              /*                  for(k=0; k<access_s1[0][0];k++){  */
-              /*                    printf("%d \t",access_s1[k][j]);  */
-              /*                  }  */
-              /*                  printf("\n");  */
-              /*                }  */
-              free(file_s1);
-              free(string_t);
-              free(line_t);
-              int i = access_s1[0][0];
-              while (--i > -1)
-                free(access_s1[i]);
-              free(access_s1);
-            } else if (plfold_up_flag == 2) {
-              int   **access_s1;
-              char  *file_s1;
-              int   s1_len, k;/* ,j; */
-              s1_len  = strlen(string_t);
-              file_s1 = (char *)vrna_alloc(sizeof(char) * (strlen(name_t + 1) + strlen(suffix) + strlen(access) + 3));
-              strcpy(file_s1, access);
-              strcat(file_s1, "/");
-              strcat(file_s1, name_t + 1);
-              strcat(file_s1, "_");
-              strcat(file_s1, suffix);
-              access_s1 = read_rnaup(file_s1, 1, s1_len);
-              if (fast) {
-                Lsnoop_subopt_list_XS(string_t, string_s, (const int **)access_s1, delta, 5, penalty, threshloop,
-                                      threshLE, threshRE, threshDE, threshTE, threshSE, threshD, distance,
-                                      half_stem, max_half_stem, min_s2, max_s2, min_s1, max_s1, min_d1, min_d2, alignment_length, name_output, fullStemEnergy);
+        /* write the results in input order */
+        for (i = 0; i < n_block; i++) {
+          snoop_target_t  *tg           = block + i;
+          char            *name_t       = tg->name_t;
+          char            *name_output  = tg->name_output;
+
+          string_t = tg->string_t;
+
+          if (delta >= 0) {
+            snoopT *sub;
+            if (!fast && !plfold_up_flag) {
+              if (tg->subopt == NULL) {
+                vrna_cstr_printf(tg->output, "no target found under the given constraints\n");
               } else {
-                snoop_subopt_XS(string_t, string_s, (const int **)access_s1, delta, 5, penalty, threshloop,
-                                threshLE, threshRE, threshDE, threshTE, threshSE, threshD, distance,
-                                half_stem, max_half_stem, min_s2, max_s2, min_s1, max_s1, min_d1, min_d2, alignment_length, name_output, fullStemEnergy);
+                int count = 0;
+                for (sub = tg->subopt; sub->structure != NULL; sub++) {
+                  print_struc(tg->output, sub, string_t, string_s, name_s, name_t, count++, nice);
+                  free(sub->structure);
+                }
+                free(tg->subopt);
+              }
+            } else if (plfold_up_flag) {
+              /* the accessibility variants write to stdout directly */
+              vrna_cstr_fflush(tg->output);
+              if (plfold_up_flag == 1) {
+                int   **access_s1;
+                char  *file_s1;
+                int   s1_len, k;/* ,j; */
+                s1_len  = strlen(string_t);
+                file_s1 = (char *)vrna_alloc(sizeof(char) * (strlen(name_t + 1) + strlen(access) + 9));
+                strcpy(file_s1, access);
+                strcat(file_s1, "/");
+                strcat(file_s1, name_t + 1);
+                strcat(file_s1, "_openen");
+                access_s1 = read_plfold_i(file_s1, 1, s1_len);
+                if (fast) {
+                  Lsnoop_subopt_list_XS(string_t, string_s, (const int **)access_s1, delta, 5, penalty, threshloop,
+                                        threshLE, threshRE, threshDE, threshTE, threshSE, threshD, distance,
+                                        half_stem, max_half_stem, min_s2, max_s2, min_s1, max_s1, min_d1, min_d2, alignment_length, name_output, fullStemEnergy);
+                } else {
+                  snoop_subopt_XS(string_t, string_s, (const int **)access_s1, delta, 5, penalty, threshloop,
+                                  threshLE, threshRE, threshDE, threshTE, threshSE, threshD, distance,
+                                  half_stem, max_half_stem, min_s2, max_s2, min_s1, max_s1, min_d1, min_d2, alignment_length, name_output, fullStemEnergy);
+                }
+
+                free(file_s1);
+                k = access_s1[0][0];
+                while (--k > -1)
+                  free(access_s1[k]);
+                free(access_s1);
+              } else if (plfold_up_flag == 2) {
+                int   **access_s1;
+                char  *file_s1;
+                int   s1_len, k;/* ,j; */
+                s1_len  = strlen(string_t);
+                file_s1 = (char *)vrna_alloc(sizeof(char) * (strlen(name_t + 1) + strlen(suffix) + strlen(access) + 3));
+                strcpy(file_s1, access);
+                strcat(file_s1, "/");
+                strcat(file_s1, name_t + 1);
+                strcat(file_s1, "_");
+                strcat(file_s1, suffix);
+                access_s1 = read_rnaup(file_s1, 1, s1_len);
+                if (fast) {
+                  Lsnoop_subopt_list_XS(string_t, string_s, (const int **)access_s1, delta, 5, penalty, threshloop,
+                                        threshLE, threshRE, threshDE, threshTE, threshSE, threshD, distance,
+                                        half_stem, max_half_stem, min_s2, max_s2, min_s1, max_s1, min_d1, min_d2, alignment_length, name_output, fullStemEnergy);
+                } else {
+                  snoop_subopt_XS(string_t, string_s, (const int **)access_s1, delta, 5, penalty, threshloop,
+                                  threshLE, threshRE, threshDE, threshTE, threshSE, threshD, distance,
+                                  half_stem, max_half_stem, min_s2, max_s2, min_s1, max_s1, min_d1, min_d2, alignment_length, name_output, fullStemEnergy);
+                }
+
+                free(file_s1);
+                k = access_s1[0][0];
+                while (--k > -1)
+                  free(access_s1[k]);
+                free(access_s1);
               }
-
-              /*                for(j=0; j<s1_len; j++){  */
-              /*                  for(k=0; k<access_s1[0][0];k++){  */
-              /*                    printf("%d \t",access_s1[k][j]);  */
-              /*                  }  */
-              /*                  printf("\n");  */
-              /*                }  */
-              free(file_s1);
-              free(string_t);
-              free(line_t);
-              k = access_s1[0][0];
-              while (--k > -1)
-                free(access_s1[k]);
-              free(access_s1);
             }
-          }
-        } else {
-          mfe = snoopfold(string_t, string_s, penalty, threshloop, threshLE, threshRE, threshDE, threshD,
-                          half_stem, max_half_stem, min_s2, max_s2, min_s1, max_s1, min_d1, min_d2, fullStemEnergy);
-          if (mfe.energy < INF) {
-            print_struc(&mfe, string_t, string_s, name_s, name_t, 0, 1);
-            free(mfe.structure);
+          } else if (tg->mfe.energy < INF) {
+            print_struc(tg->output, &(tg->mfe), string_t, string_s, name_s, name_t, 0, 1);
+            free(tg->mfe.structure);
           }
 
-          free(line_t);
-          length_t = (int)strlen(string_t);
+          vrna_cstr_free(tg->output);
           free(string_t);
+          free(name_t);
+          free(name_output);
         }
 
-        free(name_t);
-        if (nice)
-          free(name_output);
-      } while (1);
+        vrna_cstr_free(tail);
+        if (no_header) {
+          printf("Your target sequence: \n%s\nhas no header. Please update your fasta file\n", no_header);
+          exit(0);
+        }
+      } while (!done);
+      free(block);
       rewind(mrna);
       snofree_arrays(strlen(string_s));  /* free's base_pair */
       free(string_s);
@@ -620,7 +684,8 @@ main(int  argc,
 
 
 static void
-print_struc(snoopT      *dup,
+print_struc(vrna_cstr_t output,
+            snoopT      *dup,
             const char  *s1,
             const char  *s2,
             char        *name_s,
@@ -656,11 +721,12 @@ print_struc(snoopT      *dup,
   s4  = (char *)vrna_alloc(sizeof(char) * (n2 - 9));
   strncpy(s4, s2 + 5, n2 - 10);
   s4[n2 - 10] = '\0';
-  printf("%s %3d,%-3d;%3d : %3d,%-3d (%5.2f = %5.2f + %5.2f + %5.2f + %5.2f + 4.1 ) (%5.2f) \n%s&%s\n",
-         target_struct, dup->i + 1 - l1,
-         dup->i, dup->u, dup->j + 1, dup->j + (int)(strrchr(dup->structure, '>') - strchr(dup->structure, '>')) + 1,
-         (dup->Loop_D + dup->Duplex_El + dup->Duplex_Er + dup->Loop_E) + 4.10,
-         dup->Duplex_El, dup->Duplex_Er, dup->Loop_E, dup->Loop_D, dup->fullStemEnergy, target, s4);
+  vrna_cstr_printf(output,
+                   "%s %3d,%-3d;%3d : %3d,%-3d (%5.2f = %5.2f + %5.2f + %5.2f + %5.2f + 4.1 ) (%5.2f) \n%s&%s\n",
+                   target_struct, dup->i + 1 - l1,
+                   dup->i, dup->u, dup->j + 1, dup->j + (int)(strrchr(dup->structure, '>') - strchr(dup->structure, '>')) + 1,
+                   (dup->Loop_D + dup->Duplex_El + dup->Duplex_Er + dup->Loop_E) + 4.10,
+                   dup->Duplex_El, dup->Duplex_Er, dup->Loop_E, dup->Loop_D, dup->fullStemEnergy, target, s4);
   if (nice) {
     char  *temp_seq;
     char  *temp_struc;
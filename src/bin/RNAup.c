@@ -18,7 +18,13 @@
 #include <ctype.h>
 #include <unistd.h>
 #include <string.h>
+#include <stddef.h>
 #include <float.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 #include "ViennaRNA/fold.h"
 #include "ViennaRNA/fold_vars.h"
 #include "ViennaRNA/params/io.h"
@@ -27,6 +33,9 @@
 #include "ViennaRNA/utils/strings.h"
 #include "ViennaRNA/part_func.h"
 #include "ViennaRNA/part_func_up.h"
+#include "ViennaRNA/fold_compound.h"
+#include "ViennaRNA/mfe.h"
+#include "ViennaRNA/datastructures/char_stream.h"
 #include "ViennaRNA/duplex.h"
 #include "ViennaRNA/params/constants.h"
 #include "ViennaRNA/io/file_formats.h"
@@ -39,6 +48,67 @@
 #define MAX(x, y) (((x) > (y)) ? (x) : (y))
 #define EQUAL(A, B) (fabs((A)-(B)) < 1000 * DBL_EPSILON)
 
+/* version of the tables in cache_dir, increase whenever their computation changes */
+#define RNAUP_CACHE_VERSION 1
+
+/* settings shared by all computations */
+typedef struct {
+  int               w;
+  int               incr3;
+  int               incr5;
+  int               max_u;
+  int               output;
+  int               header;
+  double            sfact;
+  char              *contrib;
+  int               **unpaired_values;
+  char              *cmdl_parameters;
+  char              *cache_dir;
+  char              *settings;  /* energy model settings that identify the tables in cache_dir */
+  int               print_target;
+  vrna_md_t         md;
+  vrna_exp_param_t  *P;         /* Boltzmann factors for the interactions */
+} up_opt_t;
+
+/* a target sequence, i.e. the first input sequence or one of the sequences read via --targets */
+typedef struct {
+  char        *id;
+  char        *seq;
+  char        *orig;
+  char        *cstruc;
+  char        fname[FILENAME_MAX_LENGTH];
+  int         length;
+  pu_contrib  *pu;
+} up_target_t;
+
+/* the output for a query, or for a pair of query and target in mode 3 */
+typedef struct {
+  vrna_cstr_t output;
+  char        *ofile;
+  char        *head;
+  pu_contrib  *contrib1;
+  pu_contrib  *contrib2;
+  interact    *inter;
+} up_result_t;
+
+/* a query sequence (pair) read from stdin */
+typedef struct {
+  unsigned int  mode;
+  vrna_cstr_t   output;   /* FASTA header(s) */
+  char          *s1;
+  char          *s2;
+  char          *orig_s1;
+  char          *orig_s2;
+  char          *cstruc1;
+  char          *cstruc2;
+  char          fname1[FILENAME_MAX_LENGTH];
+  char          fname2[FILENAME_MAX_LENGTH];
+  int           length1;
+  int           length2;
+  pu_contrib    *pu;
+  up_result_t   *results;
+} up_record_t;
+
 PRIVATE void    tokenize(char *line,
                          char **seq1,
                          char **seq2);
@@ -50,7 +120,8 @@ PRIVATE void    seperate_bp(char  **inter,
                             char  **intra_s);
 
 
-PRIVATE void    print_interaction(interact    *Int,
+PRIVATE void    print_interaction(vrna_cstr_t output,
+                                  interact    *Int,
                                   char        *s1,
                                   char        *s2,
                                   pu_contrib  *p_c,
@@ -60,8 +131,36 @@ PRIVATE void    print_interaction(interact    *Int,
                                   int         incr5);
 
 
-PRIVATE void    print_unstru(pu_contrib *p_c,
-                             int        w);
+PRIVATE void    print_unstru(vrna_cstr_t  output,
+                             pu_contrib   *p_c,
+                             int          w);
+
+
+PRIVATE pu_contrib *unpaired_contrib(const char     *seq,
+                                     const char     *cstruc,
+                                     int            w,
+                                     const up_opt_t *opt);
+
+
+PRIVATE unsigned long long hash_bytes(const void  *data,
+                                      size_t      n);
+
+
+PRIVATE void    compute_targets(up_target_t     *targets,
+                                int             n_targets,
+                                const up_opt_t  *opt);
+
+
+PRIVATE int     read_targets(const char   *filename,
+                             up_target_t  **targets,
+                             int          noconv);
+
+
+PRIVATE void    process_records(up_record_t     *records,
+                                int             n_records,
+                                up_target_t     *targets,
+                                int             n_targets,
+                                const up_opt_t  *opt);
 
 
 PRIVATE int     compare_unpaired_values(const void  *p1,
@@ -86,19 +185,19 @@ main(int  argc,
 {
   struct RNAup_args_info  args_info;
   unsigned int            input_type, up_mode;
-  char                    my_contrib[10], *up_out, *name, fname1[FILENAME_MAX_LENGTH],
-                          fname2[FILENAME_MAX_LENGTH], fname_target[FILENAME_MAX_LENGTH], *ParamFile,
-                          *ns_bases, *c, *structure, *head, *input_string, *s1, *s2, *s3, *s_target, *cstruc1,
-                          *cstruc2, *cstruc_target, *cstruc_combined, *cmdl_parameters, *orig_s1, *orig_s2,
-                          *orig_target;
-  int                     i, j, length1, length2, length_target, sym, istty,
-                          rotated, noconv, max_u, **unpaired_values, ulength_num;
-  double                  min_en, sfact;
-
-  /* variables for output */
-  pu_contrib              *unstr_out, *unstr_short, *unstr_target, *contrib1, *contrib2;
-  interact                *inter_out;
-  /* pu_out *longer; */
+  char                    my_contrib[10], fname1[FILENAME_MAX_LENGTH],
+                          fname2[FILENAME_MAX_LENGTH], *ParamFile,
+                          *ns_bases, *c, *input_string, *s1, *s2, *s3, *cstruc1,
+                          *cstruc2, *cmdl_parameters, *orig_s1, *orig_s2, *targets_file;
+  int                     i, length1, length2, sym, istty, rotated, noconv, max_u,
+                          **unpaired_values, ulength_num, n_threads, n_targets, n_records,
+                          batch_size;
+  double                  sfact;
+  vrna_cstr_t             headers;
+  up_opt_t                opt;
+  up_target_t             *targets;
+  up_record_t             *records, *rec;
+  vrna_param_t            *params;
 
   /* commandline parameters */
   int                     w       = 25; /* length of region of interaction */
@@ -122,13 +221,14 @@ main(int  argc,
   dangles         = 2;
   do_backtrack    = 1;
   rotated         = 0;
-  input_string    = s1 = s2 = s3 = s_target = cstruc1 = cstruc2 = cstruc_target = cstruc_combined = NULL;
-  length1         = length2 = length_target = 0;
-  inter_out       = NULL;
-  unstr_out       = unstr_short = unstr_target = contrib1 = contrib2 = NULL;
-  structure       = ParamFile = ns_bases = head = orig_s1 = orig_s2 = orig_target = NULL;
-  up_out          = NULL;
-  fname_target[0] = '\0';
+  input_string    = s1 = s2 = s3 = cstruc1 = cstruc2 = NULL;
+  length1         = length2 = 0;
+  ParamFile       = ns_bases = orig_s1 = orig_s2 = targets_file = NULL;
+  n_threads       = 1;
+  n_targets       = 0;
+  targets         = NULL;
+  headers         = NULL;
+  memset(&opt, 0, sizeof(up_opt_t));
   /* allocate init length for commandline parameter string */
 
   cmdl_parameters = NULL;
@@ -289,6 +389,32 @@ main(int  argc,
       vrna_strcat_printf(&cmdl_parameters, "-c %s ", my_contrib);
   }
 
+  /* read the target sequences from a file */
+  if (args_info.targets_given) {
+    targets_file  = strdup(args_info.targets_arg);
+    up_mode       = RNA_UP_MODE_3;
+    if (header)
+      vrna_strcat_printf(&cmdl_parameters, "--targets %s ", targets_file);
+  }
+
+  /* store and re-use the tables of the target(s) */
+  if (args_info.cache_dir_given)
+    opt.cache_dir = strdup(args_info.cache_dir_arg);
+
+  /* number of parallel threads */
+  if (args_info.jobs_given) {
+#ifdef _OPENMP
+    n_threads = (args_info.jobs_arg > 0) ? args_info.jobs_arg : omp_get_num_procs();
+#else
+    vrna_message_warning("This version of RNAup has been built without parallel input processing.\n"
+                         "Ignoring request to process input in parallel!");
+#endif
+  }
+
+#ifdef _OPENMP
+  omp_set_num_threads(n_threads);
+#endif
+
   /* set length(s) of unpaired (unstructured) region(s) */
   int min, max, tmp;
   i = (args_info.ulength_given == 0) ? 1 : args_info.ulength_given;
@@ -393,6 +519,57 @@ main(int  argc,
   }
 
   RT = ((temperature + K0) * GASCONST / 1000.0);
+
+  /* settings shared by all computations */
+  opt.w               = w;
+  opt.incr3           = incr3;
+  opt.incr5           = incr5;
+  opt.max_u           = max_u;
+  opt.output          = output;
+  opt.header          = header;
+  opt.sfact           = sfact;
+  opt.contrib         = my_contrib;
+  opt.unpaired_values = unpaired_values;
+  opt.cmdl_parameters = cmdl_parameters;
+  opt.print_target    = (targets_file) ? 1 : 0;
+
+  set_model_details(&(opt.md));
+  opt.md.compute_bpp  = 1;
+  opt.P               = vrna_exp_params(&(opt.md));
+
+  /* identify the energy parameters by their values rather than the name of the parameter file */
+  params              = vrna_params(&(opt.md));
+  opt.settings        = vrna_strdup_printf("RNAup cache v%d T=%.17g d=%d noLP=%d noGU=%d "
+                                           "noClosingGU=%d noTetra=%d e=%d S=%.17g P=%016llx nsp=%s",
+                                           RNAUP_CACHE_VERSION,
+                                           temperature,
+                                           dangles,
+                                           noLonelyPairs,
+                                           noGU,
+                                           no_closingGU,
+                                           !tetra_loop,
+                                           energy_set,
+                                           sfact,
+                                           hash_bytes(&(params->stack),
+                                                      offsetof(vrna_param_t, model_details) -
+                                                      offsetof(vrna_param_t, stack)),
+                                           (ns_bases) ? ns_bases : "");
+  free(params);
+
+  /* the probabilities of being unpaired of the targets are computed only once */
+  if (targets_file) {
+    n_targets = read_targets(targets_file, &targets, noconv);
+    if (n_targets == 0)
+      vrna_message_error("No target sequences found in %s", targets_file);
+
+    compute_targets(targets, n_targets, &opt);
+  }
+
+  /* process sequences one by one in interactive mode */
+  batch_size  = ((n_threads > 1) && (!istty)) ? 4 * n_threads : 1;
+  records     = (up_record_t *)vrna_alloc(sizeof(up_record_t) * batch_size);
+  n_records   = 0;
+
   /*
    #############################################
    # main loop: continue until end of file
@@ -403,6 +580,7 @@ main(int  argc,
     cut_point = -1;
     fname1[0] = '\0';
     fname2[0] = '\0';
+    headers   = vrna_cstr(0, stdout);
     /*
      ########################################################
      # handle user input from 'stdin'
@@ -418,7 +596,7 @@ main(int  argc,
           break;
         case RNA_UP_MODE_3:   /* consecutive multi interaction mode ;) first sequence pairs with all following, former -Xf mode */
                               /* either we wait for the first two sequences */
-          if (s_target == NULL)
+          if (n_targets == 0)
             vrna_message_input_seq("Give each sequence on an extra line. "
                                    "The first seq. is stored, every other seq. is compared to the first one.");
           /* or we already have them and wait for the next sequence */
@@ -435,7 +613,7 @@ main(int  argc,
     /* extract filename from fasta header if available */
     while ((input_type = get_input_line(&input_string, 0)) & VRNA_INPUT_FASTA_HEADER) {
       (void)sscanf(input_string, "%" XSTR(FILENAME_ID_LENGTH) "s", fname1);
-      printf(">%s\n", input_string); /* print fasta header if available */
+      vrna_cstr_printf(headers, ">%s\n", input_string); /* print fasta header if available */
       free(input_string);
     }
 
@@ -466,9 +644,9 @@ main(int  argc,
         break;
       case RNA_UP_MODE_3:
         if (cut_point == -1) {
-          if (s_target == NULL)
+          if (n_targets == 0)
             read_again = 1;
-        } else if (s_target != NULL) {
+        } else if (n_targets > 0) {
           vrna_message_error(
             "After the first sequence (pair): Input a single sequence (no &)!\n"
             "Each input seq. is compared to the very first seq. given.\n"
@@ -486,7 +664,7 @@ main(int  argc,
       /* extract filename from fasta header if available */
       while ((input_type = get_input_line(&input_string, 0)) & VRNA_INPUT_FASTA_HEADER) {
         (void)sscanf(input_string, "%" XSTR(FILENAME_ID_LENGTH) "s", fname2);
-        printf(">%s\n", input_string); /* print fasta header if available */
+        vrna_cstr_printf(headers, ">%s\n", input_string); /* print fasta header if available */
         free(input_string);
       }
       /* break on any error, EOF or quit request */
@@ -541,7 +719,7 @@ main(int  argc,
       if (cut_point == -1) {
         if (up_mode & RNA_UP_MODE_2)
           read_again = 1;
-        else if ((up_mode & RNA_UP_MODE_3) && (s_target == NULL))
+        else if ((up_mode & RNA_UP_MODE_3) && (n_targets == 0))
           read_again = 1;
       }
 
@@ -606,37 +784,41 @@ main(int  argc,
 
     if (up_mode & RNA_UP_MODE_3) {
       /* if we haven't seen the target yet, store it now */
-      if (s_target == NULL) {
+      if (n_targets == 0) {
+        targets   = (up_target_t *)vrna_alloc(sizeof(up_target_t));
+        n_targets = 1;
         if (rotated) {
-          s_target      = s2;
-          orig_target   = orig_s2;
-          s2            = NULL;
-          orig_s2       = NULL;
-          length_target = length2;
-          strcpy(fname_target, fname2);
+          targets[0].seq    = s2;
+          targets[0].orig   = orig_s2;
+          targets[0].length = length2;
+          s2                = NULL;
+          orig_s2           = NULL;
+          strcpy(targets[0].fname, fname2);
           if (fold_constrained) {
-            cstruc_target = cstruc2;
-            cstruc2       = NULL;
+            targets[0].cstruc = cstruc2;
+            cstruc2           = NULL;
           }
         } else {
-          s_target      = s1;
-          orig_target   = orig_s1;
-          length_target = length1;
-          s1            = s2;
-          orig_s1       = orig_s2;
-          s2            = NULL;
-          orig_s2       = NULL;
-          length1       = length2;
-          strcpy(fname_target, fname1);
+          targets[0].seq    = s1;
+          targets[0].orig   = orig_s1;
+          targets[0].length = length1;
+          s1                = s2;
+          orig_s1           = orig_s2;
+          s2                = NULL;
+          orig_s2           = NULL;
+          length1           = length2;
+          strcpy(targets[0].fname, fname1);
           strcpy(fname1, fname2);
           if (fold_constrained) {
-            cstruc_target = cstruc1;
-            cstruc1       = cstruc2;
-            cstruc2       = NULL;
+            targets[0].cstruc = cstruc1;
+            cstruc1           = cstruc2;
+            cstruc2           = NULL;
           }
         }
 
         fname2[0] = '\0';
+
+        compute_targets(targets, n_targets, &opt);
       }
     }
 
@@ -646,199 +828,541 @@ main(int  argc,
      ########################################################
      */
 
-    /* compose file names */
+    /* add the record to the current block of input */
+    rec           = &(records[n_records++]);
+    rec->mode     = up_mode;
+    rec->output   = headers;
+    rec->s1       = s1;
+    rec->s2       = s2;
+    rec->orig_s1  = orig_s1;
+    rec->orig_s2  = orig_s2;
+    rec->cstruc1  = cstruc1;
+    rec->cstruc2  = cstruc2;
+    rec->length1  = length1;
+    rec->length2  = (s2) ? length2 : 0;
+    strcpy(rec->fname1, fname1);
+    strcpy(rec->fname2, fname2);
+
+    headers = NULL;
+    s1      = s2 = orig_s1 = orig_s2 = cstruc1 = cstruc2 = NULL;
+
+    if (n_records == batch_size) {
+      process_records(records, n_records, targets, n_targets, &opt);
+      n_records = 0;
+    }
+  } while (1);
+
+  /* process the remaining input, then print what was read last */
+  process_records(records, n_records, targets, n_targets, &opt);
+  vrna_cstr_free(headers);
+
+  /*
+   ########################################################
+   # clean up
+   ########################################################
+   */
+  for (i = 0; i < n_targets; i++) {
+    free(targets[i].id);
+    free(targets[i].seq);
+    free(targets[i].orig);
+    free(targets[i].cstruc);
+    free_pu_contrib_struct(targets[i].pu);
+  }
+
+  free(targets);
+  free(records);
+  free(s1);
+  free(s2);
+  free(orig_s1);
+  free(orig_s2);
+  free(cstruc1);
+  free(cstruc2);
+  free(opt.P);
+  free(opt.settings);
+  free(opt.cache_dir);
+  free(targets_file);
+  free(cmdl_parameters);
 
-    /* first file name */
-    if (fname1[0] != '\0') {
-      up_out = vrna_strdup_printf("%s", fname1);
-      if (up_mode & (RNA_UP_MODE_2 | RNA_UP_MODE_3)) {
-        if (fname2[0] != '\0')
-          vrna_strcat_printf(&up_out, "_%s", fname2);
-        else if (fname_target[0] != '\0')
-          vrna_strcat_printf(&up_out, "_%s", fname_target);
+  return EXIT_SUCCESS;
+}
+
+
+/* compute the probabilities of being unpaired of a single sequence */
+PRIVATE pu_contrib *
+unpaired_contrib(const char     *seq,
+                 const char     *cstruc,
+                 int            w,
+                 const up_opt_t *opt)
+{
+  int                   n;
+  double                min_en;
+  vrna_md_t             md;
+  vrna_fold_compound_t  *fc;
+  pu_contrib            *pu;
+
+  n = (int)strlen(seq);
+
+  vrna_md_copy(&md, &(opt->md));
+  fc = vrna_fold_compound(seq, &md, VRNA_OPTION_DEFAULT);
+
+  if (cstruc)
+    vrna_constraints_add(fc, cstruc, VRNA_CONSTRAINT_DB_DEFAULT);
+
+  /* scale the Boltzmann factors with the MFE to avoid overflows */
+  min_en = (double)vrna_mfe(fc, NULL);
+
+  free(fc->exp_params);
+  fc->exp_params            = vrna_exp_params(&(fc->params->model_details));
+  fc->exp_params->pf_scale  = exp(-(opt->sfact * min_en) / RT / n);
+  if (n > 2000)
+    vrna_message_info(stderr, "scaling factor %f", fc->exp_params->pf_scale);
+
+  (void)vrna_pf(fc, NULL);
+  pu = vrna_pf_unstru(fc, w);
+
+  vrna_fold_compound_free(fc);
+
+  return pu;
+}
+
+
+/* 64bit FNV-1a hash, e.g. of the cache key */
+PRIVATE unsigned long long
+hash_bytes(const void *data,
+           size_t     n)
+{
+  const unsigned char *c  = (const unsigned char *)data;
+  unsigned long long  h   = 14695981039346656037ULL;
+
+  for (; n > 0; n--, c++) {
+    h ^= *c;
+    h *= 1099511628211ULL;
+  }
+
+  return h;
+}
+
+
+/*
+ *  compute the probabilities of being unpaired of a target sequence,
+ *  or read them from the cache directory if they have been computed
+ *  with identical settings before
+ */
+PRIVATE pu_contrib *
+target_contrib(const up_target_t  *target,
+               int                w,
+               int                num,
+               const up_opt_t     *opt)
+{
+  char        *key, *file, *tmp;
+  FILE        *fp;
+  pu_contrib  *pu;
+
+  if ((!opt->cache_dir) || (target->cstruc))
+    return unpaired_contrib(target->seq, target->cstruc, w, opt);
+
+  key   = vrna_strdup_printf("%s w=%d\n%s", opt->settings, w, target->seq);
+  file  = vrna_strdup_printf("%s/%016llx.pu", opt->cache_dir, hash_bytes(key, strlen(key)));
+  pu    = NULL;
+
+  if ((fp = fopen(file, "rb"))) {
+    pu = vrna_pu_contrib_read(fp, key);
+    fclose(fp);
+  }
+
+  if (!pu) {
+    pu = unpaired_contrib(target->seq, NULL, w, opt);
+
+    /* write to a temporary file first, such that concurrent runs never see partial tables */
+    tmp = vrna_strdup_printf("%s.%ld-%d.tmp", file, (long)getpid(), num);
+    if ((fp = fopen(tmp, "wb"))) {
+      int ok = vrna_pu_contrib_write(fp, pu, key);
+      if ((fclose(fp) != 0) || (!ok) || (rename(tmp, file) != 0)) {
+        vrna_message_warning("Failed to write cache file %s", file);
+        (void)remove(tmp);
       }
     } else {
-      up_out = vrna_strdup_printf("RNA");
+      vrna_message_warning("Failed to open cache file %s", tmp);
     }
 
-    if (!(up_mode & RNA_UP_MODE_1))
-      vrna_strcat_printf(&up_out, "_w%d", w);
+    free(tmp);
+  }
 
-    structure = (char *)vrna_alloc(sizeof(char) * (MAX2(length_target, MAX2(length1, length2)) + 1));
+  free(key);
+  free(file);
 
+  return pu;
+}
 
-    /* begin actual computations */
-    update_fold_params();
 
-    /* calc mfe of first sequence */
-    if (cstruc1 != NULL)
-      strncpy(structure, cstruc1, length1 + 1);
+PRIVATE void
+compute_targets(up_target_t     *targets,
+                int             n_targets,
+                const up_opt_t  *opt)
+{
+  int i;
 
-    min_en = fold(s1, structure);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for (i = 0; i < n_targets; i++) {
+    int wplus = opt->w + opt->incr3 + opt->incr5;
+    if (opt->max_u > wplus)
+      wplus = opt->max_u;
 
-    (void)fflush(stdout);
+    if (targets[i].length < wplus)
+      wplus = targets[i].length;
 
-    /* calc probability to be unstructured for 1st sequence (in upmode=3 this is not the target!) */
+    targets[i].pu = target_contrib(&(targets[i]), wplus, i, opt);
+  }
+}
 
-    int wplus = w;
-    if (!(up_mode & RNA_UP_MODE_3)) {
-      wplus += incr3 + incr5;
-      /* reset window size if maximum unstructured region is exceeds it */
-      if (max_u > wplus)
-        wplus = max_u;
-    }
 
-    /* reset window size if sequence length is shorter */
-    if (length1 < wplus)
-      wplus = length1;
+PRIVATE int
+read_targets(const char   *filename,
+             up_target_t  **targets,
+             int          noconv)
+{
+  char          *header, *seq, **rest;
+  int           n, size;
+  unsigned int  type;
+  FILE          *fp;
 
-    /* calc mfe for first sequence (2nd if upmode = 3) */
-    if (cstruc1 != NULL)
-      strncpy(structure, cstruc1, length1 + 1);
+  if (!(fp = fopen(filename, "r")))
+    vrna_message_error("Failed to open target file %s", filename);
 
-    min_en    = fold(s1, structure);
-    pf_scale  = exp(-(sfact * min_en) / RT / length1);
-    if (length1 > 2000)
-      vrna_message_info(stderr, "scaling factor %f", pf_scale);
+  n         = 0;
+  size      = 16;
+  *targets  = (up_target_t *)vrna_alloc(sizeof(up_target_t) * size);
 
-    if (cstruc1 != NULL)
-      strncpy(structure, cstruc1, length1 + 1);
+  do {
+    header  = seq = NULL;
+    rest    = NULL;
+    type    = vrna_file_fasta_read_record(&header, &seq, &rest, fp, VRNA_INPUT_NO_REST);
+    if (type & (VRNA_INPUT_QUIT | VRNA_INPUT_ERROR))
+      break;
+
+    if (n == size) {
+      size      *= 2;
+      *targets  = (up_target_t *)vrna_realloc(*targets, sizeof(up_target_t) * size);
+      memset(*targets + n, 0, sizeof(up_target_t) * (size - n));
+    }
 
-    (void) pf_fold(s1, structure);
-    unstr_out = pf_unstru(s1, wplus);
-    free_pf_arrays();
+    up_target_t *t = &((*targets)[n++]);
 
-    if (fold_constrained && !(up_mode & RNA_UP_MODE_1)) {
-      cstruc_combined = (char *)vrna_alloc(sizeof(char) * (length1 + length2 + 1));
-      strncpy(cstruc_combined, cstruc1, length1 + 1);
-      strcat(cstruc_combined, cstruc2);
+    if (header) {
+      t->id = strdup((header[0] == '>') ? header + 1 : header);
+      (void)sscanf(t->id, "%" XSTR(FILENAME_ID_LENGTH) "s", t->fname);
     }
 
-    contrib1  = contrib2 = NULL;
-    inter_out = NULL;
+    if (!noconv)
+      vrna_seq_toRNA(seq);
 
-    switch (up_mode) {
-      case RNA_UP_MODE_1:
-        for (i = 1; i <= unpaired_values[0][0]; i++) {
-          j = unpaired_values[i][0];
-          do
-            print_unstru(unstr_out, j);
-          while (++j <= unpaired_values[i][1]);
-        }
-        if (output && header)
-          head = vrna_strdup_printf("# %s\n# %d %s\n# %s", cmdl_parameters, length1, fname1, orig_s1);
+    t->orig = strdup(seq);
+    vrna_seq_toupper(seq);
+    t->seq    = seq;
+    t->length = (int)strlen(seq);
 
-        contrib1 = unstr_out;
-        break;
-      case RNA_UP_MODE_2:
-        inter_out = pf_interact(s1, s2, unstr_out, NULL, w, cstruc_combined, incr3, incr5);
-        print_interaction(inter_out, orig_s1, orig_s2, unstr_out, NULL, w, incr3, incr5);
-        if (output && header)
-          head = vrna_strdup_printf("# %s\n# %d %s\n# %s\n# %d %s\n# %s", cmdl_parameters, length1, fname1, orig_s1, length2, fname2, orig_s2);
+    free(header);
+    if (rest) {
+      char **r;
+      for (r = rest; *r; r++)
+        free(*r);
+      free(rest);
+    }
+  } while (!feof(fp));
 
-        contrib1 = unstr_out;
-        break;
-      case RNA_UP_MODE_3:   /* calculate prob. unstruct. for target seq */
-        if (unstr_target == NULL) {
-          wplus = w + incr3 + incr5;
-          if (max_u > wplus)
-            wplus = max_u;
+  fclose(fp);
 
-          if (length_target < wplus)
-            wplus = length_target;
+  return n;
+}
 
-          if (cstruc_target != NULL)
-            strncpy(structure, cstruc_target, length_target + 1);
 
-          min_en    = fold(s_target, structure);
-          pf_scale  = exp(-(sfact * min_en) / RT / length_target);
-          if (length_target > 2000)
-            vrna_message_info(stderr, "scaling factor %f", pf_scale);
+/* compute the output for query rec and target t, and store it in res */
+/* concatenate two constraint strings, sequences without constraint, e.g. targets read via --targets, are unconstrained */
+PRIVATE char *
+join_constraints(const char *c1,
+                 int        n1,
+                 const char *c2,
+                 int        n2)
+{
+  char *c = (char *)vrna_alloc(sizeof(char) * (n1 + n2 + 1));
 
-          if (cstruc_target != NULL)
-            strncpy(structure, cstruc_target, length_target + 1);
+  if (c1)
+    memcpy(c, c1, sizeof(char) * n1);
+  else
+    memset(c, '.', sizeof(char) * n1);
 
-          (void) pf_fold(s_target, structure);
-          unstr_target  = pf_unstru(s_target, wplus);
-          free_pf_arrays();                     /* for arrays for pf_fold(...) */
-        }
+  if (c2)
+    memcpy(c + n1, c2, sizeof(char) * n2);
+  else
+    memset(c + n1, '.', sizeof(char) * n2);
 
-        /* check if target sequence is actually longer than query, if not rotate both sequences */
-        if (length_target < length1) {
-          inter_out = pf_interact(s1, s_target, unstr_out, unstr_target, w, cstruc_combined, incr3, incr5);
-          print_interaction(inter_out, orig_s1, orig_target, unstr_out, unstr_target, w, incr3, incr5);
-          contrib1  = unstr_out;
-          contrib2  = unstr_target;
-        } else {
-          inter_out = pf_interact(s_target, s1, unstr_target, unstr_out, w, cstruc_combined, incr3, incr5);
-          print_interaction(inter_out, orig_target, orig_s1, unstr_target, unstr_out, w, incr3, incr5);
-          contrib1  = unstr_target;
-          contrib2  = unstr_out;
-        }
+  return c;
+}
 
-        if (output && header)
-          head = vrna_strdup_printf("# %s\n# %d %s\n# %s\n# %d %s\n# %s", cmdl_parameters, length_target, fname_target, orig_target, length1, fname1, orig_s1);
 
-        break;
-    }
+PRIVATE void
+compute_result(up_record_t        *rec,
+               const up_target_t  *target,
+               up_result_t        *res,
+               const up_opt_t     *opt)
+{
+  int   i, j;
+  char  *cstruc_combined;
+
+  res->output     = vrna_cstr(0, stdout);
+  cstruc_combined = NULL;
+
+  switch (rec->mode) {
+    case RNA_UP_MODE_1:
+      for (i = 1; i <= opt->unpaired_values[0][0]; i++) {
+        j = opt->unpaired_values[i][0];
+        do
+          print_unstru(res->output, rec->pu, j);
+        while (++j <= opt->unpaired_values[i][1]);
+      }
+      if (opt->output && opt->header)
+        res->head = vrna_strdup_printf("# %s\n# %d %s\n# %s",
+                                       opt->cmdl_parameters,
+                                       rec->length1,
+                                       rec->fname1,
+                                       rec->orig_s1);
+
+      res->contrib1 = rec->pu;
+      break;
+
+    case RNA_UP_MODE_2:
+      if (rec->cstruc1)
+        cstruc_combined = vrna_strdup_printf("%s%s", rec->cstruc1, rec->cstruc2);
+
+      res->inter = vrna_pf_interact(opt->P,
+                                    rec->s1,
+                                    rec->s2,
+                                    rec->pu,
+                                    NULL,
+                                    opt->w,
+                                    cstruc_combined,
+                                    opt->incr3,
+                                    opt->incr5);
+      print_interaction(res->output,
+                        res->inter,
+                        rec->orig_s1,
+                        rec->orig_s2,
+                        rec->pu,
+                        NULL,
+                        opt->w,
+                        opt->incr3,
+                        opt->incr5);
+      if (opt->output && opt->header)
+        res->head = vrna_strdup_printf("# %s\n# %d %s\n# %s\n# %d %s\n# %s",
+                                       opt->cmdl_parameters,
+                                       rec->length1,
+                                       rec->fname1,
+                                       rec->orig_s1,
+                                       rec->length2,
+                                       rec->fname2,
+                                       rec->orig_s2);
+
+      res->contrib1 = rec->pu;
+      break;
+
+    case RNA_UP_MODE_3:
+      if (opt->print_target)
+        vrna_cstr_printf(res->output, ">%s\n", (target->id) ? target->id : "");
+
+      /* check if target sequence is actually longer than query, if not rotate both sequences */
+      if (target->length < rec->length1) {
+        if (rec->cstruc1)
+          cstruc_combined = join_constraints(rec->cstruc1,
+                                             rec->length1,
+                                             target->cstruc,
+                                             target->length);
+
+        res->inter = vrna_pf_interact(opt->P,
+                                      rec->s1,
+                                      target->seq,
+                                      rec->pu,
+                                      target->pu,
+                                      opt->w,
+                                      cstruc_combined,
+                                      opt->incr3,
+                                      opt->incr5);
+        print_interaction(res->output,
+                          res->inter,
+                          rec->orig_s1,
+                          target->orig,
+                          rec->pu,
+                          target->pu,
+                          opt->w,
+                          opt->incr3,
+                          opt->incr5);
+        res->contrib1 = rec->pu;
+        res->contrib2 = target->pu;
+      } else {
+        if (rec->cstruc1)
+          cstruc_combined = join_constraints(target->cstruc,
+                                             target->length,
+                                             rec->cstruc1,
+                                             rec->length1);
+
+        res->inter = vrna_pf_interact(opt->P,
+                                      target->seq,
+                                      rec->s1,
+                                      target->pu,
+                                      rec->pu,
+                                      opt->w,
+                                      cstruc_combined,
+                                      opt->incr3,
+                                      opt->incr5);
+        print_interaction(res->output,
+                          res->inter,
+                          target->orig,
+                          rec->orig_s1,
+                          target->pu,
+                          rec->pu,
+                          opt->w,
+                          opt->incr3,
+                          opt->incr5);
+        res->contrib1 = target->pu;
+        res->contrib2 = rec->pu;
+      }
+
+      if (opt->output && opt->header)
+        res->head = vrna_strdup_printf("# %s\n# %d %s\n# %s\n# %d %s\n# %s",
+                                       opt->cmdl_parameters,
+                                       target->length,
+                                       target->fname,
+                                       target->orig,
+                                       rec->length1,
+                                       rec->fname1,
+                                       rec->orig_s1);
+
+      break;
+  }
 
-    /* create additional output */
-    if (output) {
-      /* how to best compose a reasonable filename */
-      printf("RNAup output in file: ");
-      /* since we do not limit the amount of ulength values anymore we just put
-       * the maximum length into the filename, the actual printed lengths
-       * should be somewhere in the output itself */
-      name = vrna_strdup_printf("%s_u%d.out", up_out, unpaired_values[0][0]);
-      printf("%s\n", name);
-
-      Up_plot(contrib1, contrib2, inter_out, name, unpaired_values, my_contrib, head, up_mode);
+  /* create additional output */
+  if (opt->output) {
+    /* compose file names */
+    if (rec->fname1[0] != '\0') {
+      res->ofile = vrna_strdup_printf("%s", rec->fname1);
+      if (rec->mode & (RNA_UP_MODE_2 | RNA_UP_MODE_3)) {
+        if (rec->fname2[0] != '\0')
+          vrna_strcat_printf(&(res->ofile), "_%s", rec->fname2);
+        else if ((target) && (target->fname[0] != '\0'))
+          vrna_strcat_printf(&(res->ofile), "_%s", target->fname);
+      }
+    } else {
+      res->ofile = vrna_strdup_printf("RNA");
     }
 
-    /*
-     ########################################################
-     # clean up
-     ########################################################
-     */
+    if (!(rec->mode & RNA_UP_MODE_1))
+      vrna_strcat_printf(&(res->ofile), "_w%d", opt->w);
 
-    /* we can save the pu contribution structure of the target sequence for the next run */
-    if (unstr_target != NULL) {
-      if (length_target < length1)
-        free_pu_contrib_struct(contrib1);
-      else
-        free_pu_contrib_struct(contrib2);
-    } else {
-      if (contrib1 != NULL)
-        free_pu_contrib_struct(contrib1);
+    /* since we do not limit the amount of ulength values anymore we just put
+     * the maximum length into the filename, the actual printed lengths
+     * should be somewhere in the output itself */
+    vrna_strcat_printf(&(res->ofile), "_u%d.out", opt->unpaired_values[0][0]);
+    vrna_cstr_printf(res->output, "RNAup output in file: %s\n", res->ofile);
+  }
+
+  free(cstruc_combined);
+}
+
+
+/*
+ *  compute the probabilities of being unpaired of all queries in a block of
+ *  input, followed by the interactions with all targets. Everything is computed
+ *  in parallel but printed in the order of the input.
+ */
+PRIVATE void
+process_records(up_record_t     *records,
+                int             n_records,
+                up_target_t     *targets,
+                int             n_targets,
+                const up_opt_t  *opt)
+{
+  int i, k, t, slots;
+
+  slots = (n_targets > 0) ? n_targets : 1;
+
+  for (i = 0; i < n_records; i++)
+    records[i].results = (up_result_t *)vrna_alloc(sizeof(up_result_t) * slots);
 
-      if (contrib2 != NULL)
-        free_pu_contrib_struct(contrib2);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for (i = 0; i < n_records; i++) {
+    up_record_t *rec  = &(records[i]);
+    int         wplus = opt->w;
+
+    /* in mode 3, the target window is extended instead */
+    if (!(rec->mode & RNA_UP_MODE_3)) {
+      wplus += opt->incr3 + opt->incr5;
+      /* reset window size if maximum unstructured region is exceeds it */
+      if (opt->max_u > wplus)
+        wplus = opt->max_u;
     }
 
-    if (inter_out != NULL)
-      free_interact(inter_out);
-
-    /* free all unnecessary character arrays */
-    free(structure);
-    free(s1);
-    free(s2);
-    free(orig_s1);
-    free(orig_s2);
-    free(cstruc1);
-    free(cstruc2);
-    free(head);
-    free(cstruc_combined);
-    free(up_out);
-    free(name);
-
-    structure = s1 = s2 = orig_s1 = orig_s2 = cstruc1 = cstruc2 = head = cstruc_combined = NULL;
-    up_out    = name = NULL;
-
-    free_arrays(); /* for arrays for fold(...) */
-  } while (1);
-  free(cmdl_parameters);
+    /* reset window size if sequence length is shorter */
+    if (rec->length1 < wplus)
+      wplus = rec->length1;
 
-  return EXIT_SUCCESS;
+    rec->pu = unpaired_contrib(rec->s1, rec->cstruc1, wplus, opt);
+  }
+
+#ifdef _OPENMP
+#pragma omp parallel for private(i, t) schedule(dynamic)
+#endif
+  for (k = 0; k < n_records * slots; k++) {
+    i = k / slots;
+    t = k % slots;
+    if ((t == 0) || (records[i].mode & RNA_UP_MODE_3))
+      compute_result(&(records[i]),
+                     (records[i].mode & RNA_UP_MODE_3) ? &(targets[t]) : NULL,
+                     &(records[i].results[t]),
+                     opt);
+  }
+
+  for (i = 0; i < n_records; i++) {
+    up_record_t *rec = &(records[i]);
+
+    vrna_cstr_free(rec->output);
+
+    for (t = 0; t < slots; t++) {
+      up_result_t *res = &(rec->results[t]);
+
+      if (!res->output)
+        continue;
+
+      vrna_cstr_free(res->output);
+
+      if (res->ofile)
+        Up_plot(res->contrib1,
+                res->contrib2,
+                res->inter,
+                res->ofile,
+                opt->unpaired_values,
+                opt->contrib,
+                res->head,
+                rec->mode);
+
+      if (res->inter)
+        free_interact(res->inter);
+
+      free(res->ofile);
+      free(res->head);
+    }
+
+    free_pu_contrib_struct(rec->pu);
+    free(rec->results);
+    free(rec->s1);
+    free(rec->s2);
+    free(rec->orig_s1);
+    free(rec->orig_s2);
+    free(rec->cstruc1);
+    free(rec->cstruc2);
+  }
 }
 
 
@@ -1101,7 +1625,8 @@ seperate_bp(char  **inter,
 
 
 PRIVATE void
-print_interaction(interact    *Int,
+print_interaction(vrna_cstr_t output,
+                  interact    *Int,
                   char        *s1,
                   char        *s2,
                   pu_contrib  *p_c,
@@ -1185,9 +1710,11 @@ print_interaction(interact    *Int,
     G_sum = Gi_min + Gul;
 
     /* printf("dG = dGint + dGu_l\n"); */
-    printf("%s %3d,%-3d : %3d,%-3d (%.2f = %.2f + %.2f)\n",
-           struc, Int->k, Int->i, Int->j, Int->l, G_min, Gi_min, Gul);
-    printf("%s&%s\n", i_long, i_short);
+    vrna_cstr_printf(output,
+                     "%s %3d,%-3d : %3d,%-3d (%.2f = %.2f + %.2f)\n",
+                     struc,
+                     Int->k, Int->i, Int->j, Int->l, G_min, Gi_min, Gul);
+    vrna_cstr_printf(output, "%s&%s\n", i_long, i_short);
   } else {
     p_c_S = p_c2->H[Int->j][(Int->l) - (Int->j)] +
             p_c2->I[Int->j][(Int->l) - (Int->j)] +
@@ -1198,15 +1725,17 @@ print_interaction(interact    *Int,
 
     G_sum = Gi_min + Gul + Gus;
     /* printf("dG = dGint + dGu_l + dGu_s\n"); */
-    printf("%s %3d,%-3d : %3d,%-3d (%.2f = %.2f + %.2f + %.2f)\n",
-           struc, Int->k, Int->i, Int->j, Int->l, G_min, Gi_min, Gul, Gus);
-    printf("%s&%s\n", i_long, i_short);
+    vrna_cstr_printf(output,
+                     "%s %3d,%-3d : %3d,%-3d (%.2f = %.2f + %.2f + %.2f)\n",
+                     struc,
+                     Int->k, Int->i, Int->j, Int->l, G_min, Gi_min, Gul, Gus);
+    vrna_cstr_printf(output, "%s&%s\n", i_long, i_short);
   }
 
   if (!EQUAL(G_min, G_sum)) {
-    printf("ERROR\n");
+    vrna_cstr_printf(output, "ERROR\n");
     diff = fabs((G_min) - (G_sum));
-    printf("diff %.18f\n", diff);
+    vrna_cstr_printf(output, "diff %.18f\n", diff);
   }
 
   if (nix_up)
@@ -1221,8 +1750,9 @@ print_interaction(interact    *Int,
 
 /* print coordinates and free energy for the region of highest accessibility */
 PRIVATE void
-print_unstru(pu_contrib *p_c,
-             int        w)
+print_unstru(vrna_cstr_t  output,
+             pu_contrib   *p_c,
+             int          w)
 {
   int     i, j, len, min_i, min_j;
   double  dG_u, min_gu;
@@ -1247,7 +1777,7 @@ print_unstru(pu_contrib *p_c,
         }
       }
     }
-    printf("%4d,%4d \t (%.3f) \t for u=%3d\n", min_i, min_j, min_gu, w);
+    vrna_cstr_printf(output, "%4d,%4d \t (%.3f) \t for u=%3d\n", min_i, min_j, min_gu, w);
   } else {
     vrna_message_error("error with prob unpaired");
   }
@@ -0,0 +1,55 @@
+echo "Testing AnalyseDists:"
+
+RETURN=0
+
+function failed {
+    RETURN=1
+    echo " [ NOT OK ]"
+}
+
+function passed {
+    echo " [ OK ]"
+}
+
+function testline {
+  echo -en "...testing $1:\t\t"
+}
+
+# Test split decomposition, Ward's method, and neighbour joining on a text matrix
+testline "Cluster analysis (AnalyseDists -Xswn)"
+RNAdistance -Xm -DP < ${DATADIR}/analysedists.db > analysedists.matrix
+AnalyseDists -Xswn < analysedists.matrix > analysedists.out 2>/dev/null
+diff=$(${DIFF} ${ANALYSEDISTS_RESULTSDIR}/analysedists.Xswn.gold analysedists.out)
+if [ "x${diff}" != "x" ] ; then failed; echo -e "$diff"; else passed; fi
+
+# Test reading the same matrix in binary form
+testline "Cluster analysis of binary matrix (AnalyseDists -Xswn -B)"
+rm -f analysedists.bin
+RNAdistance -Xm -DP --binary-matrix=analysedists.bin < ${DATADIR}/analysedists.db > /dev/null
+AnalyseDists -Xswn -B analysedists.bin > analysedists.out
+diff=$(${DIFF} ${ANALYSEDISTS_RESULTSDIR}/analysedists.Xswn.binary.gold analysedists.out)
+if [ "x${diff}" != "x" ] ; then failed; echo -e "$diff"; else passed; fi
+
+# Test reading several matrices of the same size from one binary file
+testline "Cluster analysis of binary matrices (AnalyseDists -Xswn -B -N 10)"
+rm -f analysedists.bin
+RNAdistance -Xm -DP --binary-matrix=analysedists.bin < ${DATADIR}/analysedists.multi.db > /dev/null
+AnalyseDists -Xswn -B analysedists.bin -N 10 > analysedists.out
+diff=$(${DIFF} ${ANALYSEDISTS_RESULTSDIR}/analysedists.multi.Xswn.binary.gold analysedists.out)
+if [ "x${diff}" != "x" ] ; then failed; echo -e "$diff"; else passed; fi
+
+# Test that an empty binary file and a file that does not hold matrices of the given size are rejected
+testline "Empty binary matrix (AnalyseDists -B)"
+rm -f analysedists.bin
+touch analysedists.bin
+if AnalyseDists -Xswn -B analysedists.bin > analysedists.out 2>&1 ; then failed; cat analysedists.out; else passed; fi
+
+testline "Size mismatch of binary matrices (AnalyseDists -B -N 7)"
+rm -f analysedists.bin
+RNAdistance -Xm -DP --binary-matrix=analysedists.bin < ${DATADIR}/analysedists.multi.db > /dev/null
+if AnalyseDists -Xswn -B analysedists.bin -N 7 > analysedists.out 2>&1 ; then failed; cat analysedists.out; else passed; fi
+
+# clean up
+rm -f analysedists.matrix analysedists.bin analysedists.out wards.ps nj.ps
+
+exit ${RETURN}
@@ -57,8 +57,13 @@ RNAcofold --noPS -f ${DATADIR}/rnacofold.concentrations < ${DATADIR}/rnacofold.s
 diff=$(${DIFF} -I frequency ${RNACOFOLD_RESULTSDIR}/rnacofold.small.concentrations.gold rnacofold_concentrations.fold)
 if [ "x${diff}" != "x" ] ; then failed; echo -e "$diff"; else passed; fi
 
+testline "Partition function (concentrations, CSV file)"
+RNAcofold --noPS -f ${DATADIR}/rnacofold.concentrations --concfile-output=rnacofold_concentrations.csv < ${DATADIR}/rnacofold.small.seq > rnacofold_concentrations.fold
+diff=$(${DIFF} ${RNACOFOLD_RESULTSDIR}/rnacofold.small.concentrations.csv.gold rnacofold_concentrations.csv)
+if [ "x${diff}" != "x" ] ; then failed; echo -e "$diff"; else passed; fi
+
 # clean up
-rm rnacofold_pf.fold ABdot5.ps AAdot5.ps BBdot5.ps Adot5.ps Bdot5.ps rnacofold_concentrations.fold
+rm rnacofold_pf.fold ABdot5.ps AAdot5.ps BBdot5.ps Adot5.ps Bdot5.ps rnacofold_concentrations.fold rnacofold_concentrations.csv
 rm ABrnacofold_pf_test_00*dp5.ps AArnacofold_pf_test_00*dp5.ps BBrnacofold_pf_test_00*dp5.ps Arnacofold_pf_test_00*dp5.ps Brnacofold_pf_test_00*dp5.ps dot.ps
 
 exit ${RETURN}
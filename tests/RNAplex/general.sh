@@ -0,0 +1,59 @@
+echo "Testing RNAplex:"
+
+RETURN=0
+
+function failed {
+    RETURN=1
+    echo " [ NOT OK ]"
+}
+
+function passed {
+    echo " [ OK ]"
+}
+
+function testline {
+  echo -en "...testing $1:\t\t"
+}
+
+# Compute the opening energy profiles of targets and queries
+rm -rf rnaplex.acc
+mkdir rnaplex.acc
+(cd rnaplex.acc && RNAplfold -W 200 -L 150 -u 30 -O > /dev/null 2>&1) < ${DATADIR}/rnaplex.targets.fa
+(cd rnaplex.acc && RNAplfold -W 200 -L 150 -u 30 -O > /dev/null 2>&1) < ${DATADIR}/rnaplex.queries.fa
+
+# Test queries against targets with accessibility profiles
+testline "Accessibility mode (RNAplex -a)"
+RNAplex -q ${DATADIR}/rnaplex.queries.fa -t ${DATADIR}/rnaplex.targets.fa -a rnaplex.acc -l 20 > rnaplex.out 2>/dev/null
+diff=$(${DIFF} ${RNAPLEX_RESULTSDIR}/rnaplex.a.gold rnaplex.out)
+if [ "x${diff}" != "x" ] ; then failed; echo -e "$diff"; else passed; fi
+
+# Test a pre-processed target index, the output must equal the one of the plain run
+testline "Target index (RNAplex -k --target-index)"
+rm -f rnaplex.idx
+RNAplex -t ${DATADIR}/rnaplex.targets.fa -a rnaplex.acc -k --target-index=rnaplex.idx > /dev/null 2>&1
+RNAplex -q ${DATADIR}/rnaplex.queries.fa -a rnaplex.acc -l 20 --target-index=rnaplex.idx > rnaplex.out 2>/dev/null
+diff=$(${DIFF} ${RNAPLEX_RESULTSDIR}/rnaplex.a.gold rnaplex.out)
+if [ "x${diff}" != "x" ] ; then failed; echo -e "$diff"; else passed; fi
+
+# The same with 4 threads, the output must not depend on the number of threads
+testline "Parallel target index (RNAplex --target-index --jobs=4)"
+RNAplex -q ${DATADIR}/rnaplex.queries.fa -a rnaplex.acc -l 20 --target-index=rnaplex.idx --jobs=4 > rnaplex.out 2>/dev/null
+diff=$(${DIFF} ${RNAPLEX_RESULTSDIR}/rnaplex.a.gold rnaplex.out)
+if [ "x${diff}" != "x" ] ; then failed; echo -e "$diff"; else passed; fi
+
+# Test suboptimal duplexes below an energy threshold
+testline "Suboptimal duplexes (RNAplex -a -e -4 -z 20)"
+RNAplex -q ${DATADIR}/rnaplex.queries.fa -t ${DATADIR}/rnaplex.targets.fa -a rnaplex.acc -l 20 -e -4 -z 20 > rnaplex.out 2>/dev/null
+diff=$(${DIFF} ${RNAPLEX_RESULTSDIR}/rnaplex.a.e.gold rnaplex.out)
+if [ "x${diff}" != "x" ] ; then failed; echo -e "$diff"; else passed; fi
+
+# The same in parallel on the target index
+testline "Parallel suboptimal duplexes (RNAplex --target-index --jobs=4 -e -4 -z 20)"
+RNAplex -q ${DATADIR}/rnaplex.queries.fa -a rnaplex.acc -l 20 -e -4 -z 20 --target-index=rnaplex.idx --jobs=4 > rnaplex.out 2>/dev/null
+diff=$(${DIFF} ${RNAPLEX_RESULTSDIR}/rnaplex.a.e.gold rnaplex.out)
+if [ "x${diff}" != "x" ] ; then failed; echo -e "$diff"; else passed; fi
+
+# clean up
+rm -rf rnaplex.out rnaplex.idx rnaplex.acc
+
+exit ${RETURN}
@@ -0,0 +1,39 @@
+echo "Testing RNAsnoop:"
+
+RETURN=0
+
+function failed {
+    RETURN=1
+    echo " [ NOT OK ]"
+}
+
+function passed {
+    echo " [ OK ]"
+}
+
+function testline {
+  echo -en "...testing $1:\t\t"
+}
+
+# Test the target search on long targets (8, 20, and 50 kb) that are scanned in chunks
+testline "Target search (RNAsnoop -e 3)"
+RNAsnoop -s ${DATADIR}/rnasnoop.sno.fa -t ${DATADIR}/rnasnoop.targets.fa -e 3 > rnasnoop.out
+diff=$(${DIFF} ${RNASNOOP_RESULTSDIR}/rnasnoop.targets.gold rnasnoop.out)
+if [ "x${diff}" != "x" ] ; then failed; echo -e "$diff"; else passed; fi
+
+# The same with 8 threads, the output must not depend on the number of threads
+testline "Parallel target search (RNAsnoop -e 3 --jobs=8)"
+RNAsnoop -s ${DATADIR}/rnasnoop.sno.fa -t ${DATADIR}/rnasnoop.targets.fa -e 3 --jobs=8 > rnasnoop.out 2>/dev/null
+diff=$(${DIFF} ${RNASNOOP_RESULTSDIR}/rnasnoop.targets.gold rnasnoop.out)
+if [ "x${diff}" != "x" ] ; then failed; echo -e "$diff"; else passed; fi
+
+# Test the optimal interaction of each target
+testline "Optimal interactions (RNAsnoop -e -1 --jobs=8)"
+RNAsnoop -s ${DATADIR}/rnasnoop.sno.fa -t ${DATADIR}/rnasnoop.targets.fa -e -1 --jobs=8 > rnasnoop.out 2>/dev/null
+diff=$(${DIFF} ${RNASNOOP_RESULTSDIR}/rnasnoop.targets.mfe.gold rnasnoop.out)
+if [ "x${diff}" != "x" ] ; then failed; echo -e "$diff"; else passed; fi
+
+# clean up
+rm -f rnasnoop.out sno_*.ps
+
+exit ${RETURN}
@@ -0,0 +1,39 @@
+echo "Testing RNAup:"
+
+RETURN=0
+
+function failed {
+    RETURN=1
+    echo " [ NOT OK ]"
+}
+
+function passed {
+    echo " [ OK ]"
+}
+
+function testline {
+  echo -en "...testing $1:\t\t"
+}
+
+# Test constrained queries against the first sequence, given with an empty constraint
+testline "Constrained interactions (RNAup -b -C --interaction_first)"
+RNAup -b -C -o --interaction_first < ${DATADIR}/rnaup.constrained.fa > rnaup.out 2>/dev/null
+diff=$(${DIFF} ${RNAUP_RESULTSDIR}/rnaup.first.C.gold rnaup.out)
+if [ "x${diff}" != "x" ] ; then failed; echo -e "$diff"; else passed; fi
+
+# The same queries against unconstrained targets read from a file, including one target that is shorter than a query
+testline "Constrained queries (RNAup -b -C --targets)"
+RNAup -b -C -o --targets=${DATADIR}/rnaup.targets.fa < ${DATADIR}/rnaup.queries.fa > rnaup.out 2>/dev/null
+diff=$(${DIFF} ${RNAUP_RESULTSDIR}/rnaup.targets.C.gold rnaup.out)
+if [ "x${diff}" != "x" ] ; then failed; echo -e "$diff"; else passed; fi
+
+# The same with 4 threads, the output must not depend on the number of threads
+testline "Parallel constrained queries (RNAup -b -C --targets --jobs=4)"
+RNAup -b -C -o --targets=${DATADIR}/rnaup.targets.fa --jobs=4 < ${DATADIR}/rnaup.queries.fa > rnaup.out 2>/dev/null
+diff=$(${DIFF} ${RNAUP_RESULTSDIR}/rnaup.targets.C.gold rnaup.out)
+if [ "x${diff}" != "x" ] ; then failed; echo -e "$diff"; else passed; fi
+
+# clean up
+rm -f rnaup.out
+
+exit ${RETURN}
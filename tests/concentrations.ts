@@ -0,0 +1,200 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ViennaRNA/params/basic.h>
+#include <ViennaRNA/concentrations.h>
+#include <ViennaRNA/utils/basic.h>
+
+/*
+ *  Reference implementation of the Newton iteration as used by
+ *  vrna_pf_dimer_concentrations() before concentrations were solved
+ *  in batches
+ */
+static void
+newton_reference(double KAB,
+                 double KAA,
+                 double KBB,
+                 double concA,
+                 double concB,
+                 double *ConcVec)
+{
+  double  TOL, EPS, xn, yn, det, cA, cB;
+  int     i;
+
+  i   = 0;
+  cA  = concA;
+  cB  = concB;
+  TOL = 1e-6;
+  do {
+    det = 1 + 16. * KAA * KBB * cA * cB + KAB * (cA + cB) + 4. * KAA * cA + 4. * KBB * cB + 4. *
+          KAB * (KBB * cB * cB + KAA * cA * cA);
+    xn = ((2.0 * KBB * cB * cB + cB - concB) * (KAB * cA) - KAB * cA * cB * (4. * KBB * cB + 1.) -
+          (2.0 * KAA * cA * cA + cA - concA) * (4.0 * KBB * cB + KAB * cA + 1.0)) / det;
+    yn = ((2.0 * KAA * cA * cA + cA - concA) * (KAB * cB) - KAB * cA * cB * (4. * KAA * cA + 1.) -
+          (2.0 * KBB * cB * cB + cB - concB) * (4.0 * KAA * cA + KAB * cB + 1.0)) / det;
+    EPS = fabs(xn / cA) + fabs(yn / cB);
+    cA  += xn;
+    cB  += yn;
+    i++;
+    if (i > 10000)
+      break;
+  } while (EPS > TOL);
+
+  ConcVec[0]  = cA * cB * KAB;
+  ConcVec[1]  = cA * cA * KAA;
+  ConcVec[2]  = cB * cB * KBB;
+  ConcVec[3]  = cA;
+  ConcVec[4]  = cB;
+}
+
+
+static int
+relCompare(double a,
+           double b)
+{
+  if (fabs(a - b) <= 1e-12 * MAX2(fabs(a), fabs(b)))
+    return 1;
+
+  printf("%g != %g\n", a, b);
+  return 0;
+}
+
+
+/* end of prologue */
+
+#suite Concentrations
+
+#tcase  DimerConcentrations
+
+#test test_vrna_pf_dimer_concentrations_batch
+{
+  /* dimer and monomer free energies of a typical RNAcofold run */
+  double            FcAB = -48.4, FcAA = -45.1, FcBB = -61.3, FEA = -22.6, FEB = -30.9;
+  double            KAA, KAB, KBB, kT, ref[5], *startconc;
+  size_t            i, j, num, grid;
+  vrna_exp_param_t  *exp_params;
+  vrna_dimer_conc_t *batch, *single;
+
+  exp_params  = vrna_exp_params(NULL);
+  kT          = exp_params->kT / 1000.;
+  KAA         = exp((2.0 * FEA - FcAA) / kT);
+  KBB         = exp((2.0 * FEB - FcBB) / kT);
+  KAB         = exp((FEA + FEB - FcAB) / kT);
+
+  /* a logarithmic grid of start concentrations, plus an odd number of extra entries */
+  grid      = 40;
+  num       = grid * grid + 3;
+  startconc = (double *)vrna_alloc(sizeof(double) * 2 * (num + 1));
+
+  for (i = 0; i < grid; i++)
+    for (j = 0; j < grid; j++) {
+      startconc[2 * (i * grid + j)]     = 1e-9 * pow(10., 6. * i / grid);
+      startconc[2 * (i * grid + j) + 1] = 1e-9 * pow(10., 6. * j / grid);
+    }
+
+  for (i = grid * grid; i < num; i++) {
+    startconc[2 * i]      = 1e-7 * (i - grid * grid + 1);
+    startconc[2 * i + 1]  = 2e-7;
+  }
+
+  batch = vrna_pf_dimer_concentrations_batch(FcAB, FcAA, FcBB, FEA, FEB, startconc, num, exp_params);
+  ck_assert(batch != NULL);
+
+  for (i = 0; i < num; i++) {
+    newton_reference(KAB, KAA, KBB, startconc[2 * i], startconc[2 * i + 1], ref);
+
+    ck_assert(batch[i].Ac_start == startconc[2 * i]);
+    ck_assert(batch[i].Bc_start == startconc[2 * i + 1]);
+    ck_assert(relCompare(batch[i].ABc, ref[0]));
+    ck_assert(relCompare(batch[i].AAc, ref[1]));
+    ck_assert(relCompare(batch[i].BBc, ref[2]));
+    ck_assert(relCompare(batch[i].Ac, ref[3]));
+    ck_assert(relCompare(batch[i].Bc, ref[4]));
+
+    /* mass conservation */
+    ck_assert(fabs(batch[i].Ac + batch[i].ABc + 2 * batch[i].AAc - startconc[2 * i]) <
+              1e-5 * startconc[2 * i]);
+    ck_assert(fabs(batch[i].Bc + batch[i].ABc + 2 * batch[i].BBc - startconc[2 * i + 1]) <
+              1e-5 * startconc[2 * i + 1]);
+  }
+
+  /* the zero-terminated interface yields the same results */
+  startconc[2 * num] = startconc[2 * num + 1] = 0.;
+  single = vrna_pf_dimer_concentrations(FcAB, FcAA, FcBB, FEA, FEB, startconc, exp_params);
+  ck_assert(memcmp(single, batch, sizeof(vrna_dimer_conc_t) * num) == 0);
+  free(single);
+
+  /* invalid input */
+  ck_assert(vrna_pf_dimer_concentrations_batch(FcAB, FcAA, FcBB, FEA, FEB, startconc, 0,
+                                               exp_params) == NULL);
+  ck_assert(vrna_pf_dimer_concentrations_batch(FcAB, FcAA, FcBB, FEA, FEB, NULL, num,
+                                               exp_params) == NULL);
+
+  free(batch);
+  free(startconc);
+  free(exp_params);
+}
+
+#test test_vrna_pf_dimer_concentrations_write
+{
+  double            startconc[] = {
+    1e-7, 1e-7, 2e-6, 5e-7, 1e-5, 3e-4
+  };
+  char              line[1024];
+  int               lines;
+  size_t            num = 3;
+  FILE              *fp;
+  vrna_exp_param_t  *exp_params;
+  vrna_dimer_conc_t *conc, read_back[3];
+
+  exp_params  = vrna_exp_params(NULL);
+  conc        = vrna_pf_dimer_concentrations_batch(-48.4,
+                                                   -45.1,
+                                                   -61.3,
+                                                   -22.6,
+                                                   -30.9,
+                                                   startconc,
+                                                   num,
+                                                   exp_params);
+
+  /* binary output is the raw array */
+  fp = tmpfile();
+  ck_assert(fp != NULL);
+  ck_assert_int_eq(vrna_pf_dimer_concentrations_write(fp, conc, num, VRNA_CONC_OUTPUT_BINARY), 1);
+  rewind(fp);
+  ck_assert(fread(read_back, sizeof(vrna_dimer_conc_t), num, fp) == num);
+  ck_assert(fgetc(fp) == EOF);
+  ck_assert(memcmp(read_back, conc, sizeof(vrna_dimer_conc_t) * num) == 0);
+  fclose(fp);
+
+  /* CSV output has one header line and one line per entry */
+  fp = tmpfile();
+  ck_assert(fp != NULL);
+  ck_assert_int_eq(vrna_pf_dimer_concentrations_write(fp,
+                                                      conc,
+                                                      num,
+                                                      VRNA_CONC_OUTPUT_CSV |
+                                                      VRNA_CONC_OUTPUT_RELATIVE), 1);
+  rewind(fp);
+  ck_assert(fgets(line, sizeof(line), fp) != NULL);
+  ck_assert_str_eq(line, "A0,B0,AB,AA,BB,A,B\n");
+
+  for (lines = 0; fgets(line, sizeof(line), fp); lines++) {
+    double a0, b0, ab, aa, bb, a, b, tot;
+    ck_assert_int_eq(sscanf(line, "%lf,%lf,%lf,%lf,%lf,%lf,%lf", &a0, &b0, &ab, &aa, &bb, &a, &b), 7);
+    tot = conc[lines].Ac_start + conc[lines].Bc_start;
+    ck_assert(fabs(a0 - conc[lines].Ac_start) <= 1e-5 * conc[lines].Ac_start);
+    ck_assert(fabs(b0 - conc[lines].Bc_start) <= 1e-5 * conc[lines].Bc_start);
+    ck_assert(fabs(ab - conc[lines].ABc / tot) <= 1e-5 * ab + 1e-12);
+    ck_assert(fabs(a - conc[lines].Ac / tot) <= 1e-5 * a + 1e-12);
+  }
+  ck_assert_int_eq(lines, (int)num);
+  fclose(fp);
+
+  ck_assert_int_eq(vrna_pf_dimer_concentrations_write(NULL, conc, num, VRNA_CONC_OUTPUT_CSV), 0);
+
+  free(conc);
+  free(exp_params);
+}
@@ -5,6 +5,10 @@
 #include <ViennaRNA/io/file_formats.h>
 #include <ViennaRNA/constraints/basic.h>
 #include <ViennaRNA/constraints/SHAPE.h>
+#include <ViennaRNA/fold_compound.h>
+#include <ViennaRNA/mfe.h>
+#include <ViennaRNA/part_func.h>
+#include <ViennaRNA/utils/basic.h>
 
 static int
 deltaCompare(double a,
@@ -448,3 +452,106 @@ writeTempFile(char        *tempfile,
   ck_assert(deltaCompare(p1, 0));
   ck_assert(deltaCompare(p2, 0));
 }
+
+
+#test test_vrna_sc_SHAPE_batch
+{
+  /* each profile of a batch must yield the same results as folding with
+   * the respective soft constraints applied separately
+   */
+  const char            sequence[]  = "GGGAAAUCCCGCAGCUAGCUAGCUAGGACCUUAGCGAUCGAUCGGAUCCAGCUAGCAUG";
+  const double          params_D[]  = { 1.8, -0.6, 2.6, -0.8, 1.1, -0.2 };
+  const double          params_Z[]  = { 0.89, 0.5, 0.5, 0.1, 1.6, 0.9 };
+  const double          *reactivities[3];
+  const double          *params;
+  double                *profile, mfe;
+  float                 ens_en;
+  unsigned int          k, K, n, m;
+  int                   i, j;
+  char                  method;
+  FLT_OR_DBL            p_u, *probs;
+  vrna_md_t             md;
+  vrna_sc_SHAPE_batch_t *batch;
+  vrna_fold_compound_t  *fc;
+
+  K = 3;
+  n = strlen(sequence);
+
+  for (k = 0; k < K; k++) {
+    profile = (double *)vrna_alloc(sizeof(double) * (n + 1));
+    for (i = 1; i <= (int)n; i++)
+      /* include some positions without reactivity data */
+      profile[i] = ((i + k) % 11 == 0) ? -999. : (double)((i * (k + 3)) % 17) / 10.;
+
+    reactivities[k] = profile;
+  }
+
+  vrna_md_set_default(&md);
+
+  for (m = 0; m < 2; m++) {
+    method  = m ? 'Z' : 'D';
+    params  = m ? params_Z : params_D;
+    batch   = vrna_sc_SHAPE_batch(sequence,
+                                  &md,
+                                  reactivities,
+                                  params,
+                                  K,
+                                  method,
+                                  NULL,
+                                  VRNA_OPTION_MFE | VRNA_OPTION_PF);
+    ck_assert(batch != NULL);
+    ck_assert_int_eq(batch->profiles, K);
+    ck_assert_int_eq(batch->length, n);
+
+    for (k = 0; k < K; k++) {
+      vrna_md_t md_pf = md;
+      md_pf.uniq_ML     = 1;
+      md_pf.compute_bpp = 1;
+
+      fc = vrna_fold_compound(sequence, &md_pf, VRNA_OPTION_MFE | VRNA_OPTION_PF);
+
+      if (method == 'D')
+        vrna_sc_add_SHAPE_deigan(fc,
+                                 reactivities[k],
+                                 params[2 * k],
+                                 params[2 * k + 1],
+                                 VRNA_OPTION_MFE | VRNA_OPTION_PF);
+      else
+        vrna_sc_add_SHAPE_zarringhalam(fc,
+                                       reactivities[k],
+                                       params[2 * k],
+                                       params[2 * k + 1],
+                                       "O",
+                                       VRNA_OPTION_MFE | VRNA_OPTION_PF);
+
+      mfe = (double)vrna_mfe(fc, NULL);
+      ck_assert(deltaCompare(batch->mfe[k], mfe));
+
+      vrna_exp_params_rescale(fc, &mfe);
+      ens_en = vrna_pf(fc, NULL);
+      ck_assert(deltaCompare(batch->ens_en[k], ens_en));
+
+      probs = fc->exp_matrices->probs;
+      for (i = 1; i <= (int)n; i++) {
+        p_u = 1.;
+        for (j = 1; j <= (int)n; j++)
+          if (j < i)
+            p_u -= probs[fc->iindx[j] - i];
+          else if (j > i)
+            p_u -= probs[fc->iindx[i] - j];
+
+        if (p_u < 0.)
+          p_u = 0.;
+
+        ck_assert(deltaCompare(batch->p_unpaired[k * (n + 1) + i], p_u));
+      }
+
+      vrna_fold_compound_free(fc);
+    }
+
+    vrna_sc_SHAPE_batch_free(batch);
+  }
+
+  for (k = 0; k < K; k++)
+    free((double *)reactivities[k]);
+}
@@ -6,6 +6,38 @@
 #include <ViennaRNA/data_structures.h>
 #include <ViennaRNA/utils/strings.h>
 #include <ViennaRNA/constraints/soft.h>
+#include <ViennaRNA/mfe.h>
+#include <ViennaRNA/part_func.h>
+#include <ViennaRNA/loops/internal.h>
+
+/*
+ *  neutral generic soft constraints that force the decompositions to
+ *  evaluate pre-computed pseudo energies through the callback wrappers
+ *  instead of the 'compiled' interior loop kernels
+ */
+static int
+sc_zero(int           i,
+        int           j,
+        int           k,
+        int           l,
+        unsigned char d,
+        void          *data)
+{
+  return 0;
+}
+
+
+static FLT_OR_DBL
+sc_exp_one(int            i,
+           int            j,
+           int            k,
+           int            l,
+           unsigned char  d,
+           void           *data)
+{
+  return 1.;
+}
+
 
 #suite Constraints
 
@@ -216,3 +248,59 @@
   vrna_fold_compound_free(fc);
   free(seq);
 }
+
+
+#test test_vrna_sc_compiled_mode
+{
+  /* interior loops with pre-computed soft constraints only are evaluated
+   * inline ('compiled' mode), which must yield the same contributions as
+   * the generic callback wrappers that are used as soon as a (neutral)
+   * user-defined callback is attached
+   */
+  const char            sequence[] =
+    "UGCCUGGCGGCCGUAGCGCGGUGGUCCCACCUGACCCCAUGCCGAACUCAGAAGUGAAACGCCGUAGCGCCGAUGGUAGUGUGGGGUCUCCCCAUGCGAGAGUAGGGAACUGCCAGGCAU";
+  int                   i, j, n, *e_compiled;
+  FLT_OR_DBL            *q_compiled, q;
+  double                mfe;
+  vrna_fold_compound_t  *fc;
+
+  fc  = vrna_fold_compound(sequence, NULL, VRNA_OPTION_MFE | VRNA_OPTION_PF);
+  n   = (int)fc->length;
+
+  for (i = 1; i <= n; i++) {
+    vrna_sc_add_up(fc, i, -0.3 * (i % 4), VRNA_OPTION_DEFAULT);
+    vrna_sc_add_stack(fc, i, -0.2 * (i % 3), VRNA_OPTION_DEFAULT);
+  }
+
+  for (i = 1; i < n; i++)
+    for (j = i + 4; j <= n; j += 7)
+      vrna_sc_add_bp(fc, i, j, -0.5, VRNA_OPTION_DEFAULT);
+
+  mfe = (double)vrna_mfe(fc, NULL);
+  vrna_exp_params_rescale(fc, &mfe);
+  vrna_pf(fc, NULL);
+
+  e_compiled  = (int *)vrna_alloc(sizeof(int) * (n * (n + 1) / 2 + 2));
+  q_compiled  = (FLT_OR_DBL *)vrna_alloc(sizeof(FLT_OR_DBL) * (n * (n + 1) / 2 + 2));
+
+  for (i = 1; i < n; i++)
+    for (j = i + 4; j <= n; j++) {
+      e_compiled[fc->iindx[i] - j]  = vrna_E_int_loop(fc, i, j);
+      q_compiled[fc->iindx[i] - j]  = vrna_exp_E_int_loop(fc, i, j);
+    }
+
+  vrna_sc_add_f(fc, &sc_zero);
+  vrna_sc_add_exp_f(fc, &sc_exp_one);
+
+  for (i = 1; i < n; i++)
+    for (j = i + 4; j <= n; j++) {
+      ck_assert_int_eq(vrna_E_int_loop(fc, i, j), e_compiled[fc->iindx[i] - j]);
+
+      q = vrna_exp_E_int_loop(fc, i, j);
+      ck_assert(fabs(q - q_compiled[fc->iindx[i] - j]) <= 1e-12 * q);
+    }
+
+  free(e_compiled);
+  free(q_compiled);
+  vrna_fold_compound_free(fc);
+}
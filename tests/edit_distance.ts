@@ -0,0 +1,307 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <ViennaRNA/dist_vars.h>
+#include <ViennaRNA/RNAstruct.h>
+#include <ViennaRNA/treedist.h>
+#include <ViennaRNA/stringdist.h>
+#include <ViennaRNA/utils/basic.h>
+
+#define NUM_STRUCTURES  6
+#define NUM_PAIRS       (NUM_STRUCTURES * (NUM_STRUCTURES - 1) / 2)
+
+static const char *structures[] = {
+  "(((((((..((((........)))).((((((....)))))).....(((((.......)))))))))))).",
+  "(((((((..((.(....))).((.(.(((((......))))).).))(((((.......)))))))))))).",
+  "(((((((..((((........))))...((((....)))).......(((((.......)))))))))))).",
+  "((((((((.(((.....))))((.(.((((((....)))))).).))(((((.......)))))))))))).",
+  "........................................................................",
+  "((((....))))..((((((...))).)))",
+  NULL
+};
+
+/*
+ *  Distances of the lower triangle (i > j, row-major) as computed by
+ *  tree_edit_distance() and string_edit_distance() before they became
+ *  reentrant, for the full and the weighted coarse representation, with
+ *  default and Shapiro's costs
+ */
+static const float tree_reference[2][2][NUM_PAIRS] = {
+  {
+    { 20, 8, 22, 16, 10, 22, 88, 92, 80, 100, 46, 48, 48, 44, 82 },
+    { 20, 8, 22, 16, 10, 22, 88, 92, 80, 100, 46, 48, 48, 44, 82 }
+  },
+  {
+    { 39, 10, 47, 37, 16, 47, 147, 144, 153, 138, 61, 55, 67, 47, 96 },
+    { 1035, 310, 1335, 950, 545, 1260, 2965, 2420, 3255, 2105, 1900, 1348, 2190, 1023, 1105 }
+  }
+};
+
+static const float string_reference[2][2][NUM_PAIRS] = {
+  {
+    { 14, 4, 17, 12, 6, 15, 44, 46, 40, 50, 44, 43, 43, 42, 62 },
+    { 14, 4, 17, 12, 6, 15, 44, 46, 40, 50, 44, 43, 43, 42, 62 }
+  },
+  {
+    { 39, 28, 65, 36, 16, 64, 102, 99, 126, 93, 53, 52, 77, 45, 51 },
+    { 1035, 985, 2010, 914, 514, 1899, 2740, 2195, 3705, 1880, 1785.5, 1250.5, 2750.5, 966.5, 880 }
+  }
+};
+
+
+/* full (0) or weighted coarse (1) representation */
+static char *
+representation(const char *structure,
+               int        r)
+{
+  return (r == 0) ? expand_Full(structure) : b2Shapiro(structure);
+}
+
+
+static Tree **
+make_trees(int r)
+{
+  int   i;
+  char  *x;
+  Tree  **trees;
+
+  trees = (Tree **)vrna_alloc(sizeof(Tree *) * (NUM_STRUCTURES + 1));
+  for (i = 0; i < NUM_STRUCTURES; i++) {
+    x         = representation(structures[i], r);
+    trees[i]  = make_tree(x);
+    free(x);
+  }
+
+  return trees;
+}
+
+
+static swString **
+make_strings(int r)
+{
+  int       i;
+  char      *x;
+  swString  **strings;
+
+  strings = (swString **)vrna_alloc(sizeof(swString *) * (NUM_STRUCTURES + 1));
+  for (i = 0; i < NUM_STRUCTURES; i++) {
+    x           = representation(structures[i], r);
+    strings[i]  = Make_swString(x);
+    free(x);
+  }
+
+  return strings;
+}
+
+
+/* end of prologue */
+
+#suite EditDistance
+
+#tcase TreeEditDistance
+
+#test test_vrna_tree_edit_distance
+{
+  int             r, c, i, j, p;
+  unsigned int    options;
+  float           *matrix;
+  Tree            **trees;
+  vrna_dist_ws_t  *ws;
+
+  ws = vrna_dist_ws_init();
+
+  for (r = 0; r < 2; r++) {
+    trees = make_trees(r);
+    for (c = 0; c < 2; c++) {
+      options = (c) ? VRNA_DIST_SHAPIRO_COSTS : VRNA_DIST_DEFAULT;
+
+      /* one workspace for all pairs, i.e. it is re-used for smaller and larger trees */
+      for (p = 0, i = 1; i < NUM_STRUCTURES; i++)
+        for (j = 0; j < i; j++, p++) {
+          ck_assert(vrna_tree_edit_distance(ws, trees[i], trees[j], options) ==
+                    tree_reference[r][c][p]);
+          /* the distance is symmetric */
+          ck_assert(vrna_tree_edit_distance(ws, trees[j], trees[i], options) ==
+                    tree_reference[r][c][p]);
+        }
+
+      /* the legacy interface still honours the global cost_matrix */
+      cost_matrix = c;
+      for (p = 0, i = 1; i < NUM_STRUCTURES; i++)
+        for (j = 0; j < i; j++, p++)
+          ck_assert(tree_edit_distance(trees[i], trees[j]) == tree_reference[r][c][p]);
+
+      cost_matrix = 0;
+
+      matrix = vrna_tree_edit_distance_matrix(trees, options);
+      ck_assert(matrix != NULL);
+      ck_assert(memcmp(matrix, tree_reference[r][c], sizeof(float) * NUM_PAIRS) == 0);
+      free(matrix);
+    }
+
+    for (i = 0; i < NUM_STRUCTURES; i++)
+      free_tree(trees[i]);
+
+    free(trees);
+  }
+
+  vrna_dist_ws_free(ws);
+}
+
+#test test_vrna_tree_edit_distance_backtrack
+{
+  int             i, j;
+  float           d;
+  Tree            **trees;
+  vrna_dist_ws_t  *ws;
+
+  ws    = vrna_dist_ws_init();
+  trees = make_trees(0);
+
+  edit_backtrack = 1;
+  for (i = 1; i < NUM_STRUCTURES; i++)
+    for (j = 0; j < i; j++) {
+      d = vrna_tree_edit_distance(ws, trees[i], trees[j], VRNA_DIST_BACKTRACK);
+      ck_assert(d == tree_edit_distance(trees[i], trees[j]));
+      ck_assert(ws->aligned_line[0] != NULL);
+      ck_assert(ws->aligned_line[1] != NULL);
+      ck_assert_str_eq(ws->aligned_line[0], aligned_line[0]);
+      ck_assert_str_eq(ws->aligned_line[1], aligned_line[1]);
+      ck_assert_int_eq(strlen(ws->aligned_line[0]), strlen(ws->aligned_line[1]));
+    }
+  edit_backtrack = 0;
+
+  for (i = 0; i < NUM_STRUCTURES; i++)
+    free_tree(trees[i]);
+
+  free(trees);
+  vrna_dist_ws_free(ws);
+
+  /* less than two trees */
+  trees     = (Tree **)vrna_alloc(sizeof(Tree *) * 2);
+  trees[0]  = NULL;
+  ck_assert(vrna_tree_edit_distance_matrix(trees, VRNA_DIST_DEFAULT) == NULL);
+  ck_assert(vrna_tree_edit_distance_matrix(NULL, VRNA_DIST_DEFAULT) == NULL);
+  free(trees);
+}
+
+#tcase StringEditDistance
+
+#test test_vrna_string_edit_distance
+{
+  int             r, c, i, j, p;
+  unsigned int    options;
+  float           *matrix;
+  swString        **strings;
+  vrna_dist_ws_t  *ws;
+
+  ws = vrna_dist_ws_init();
+
+  for (r = 0; r < 2; r++) {
+    strings = make_strings(r);
+    for (c = 0; c < 2; c++) {
+      options = (c) ? VRNA_DIST_SHAPIRO_COSTS : VRNA_DIST_DEFAULT;
+
+      for (p = 0, i = 1; i < NUM_STRUCTURES; i++)
+        for (j = 0; j < i; j++, p++)
+          ck_assert(vrna_string_edit_distance(ws, strings[i], strings[j], options) ==
+                    string_reference[r][c][p]);
+
+      cost_matrix = c;
+      for (p = 0, i = 1; i < NUM_STRUCTURES; i++)
+        for (j = 0; j < i; j++, p++)
+          ck_assert(string_edit_distance(strings[i], strings[j]) == string_reference[r][c][p]);
+
+      cost_matrix = 0;
+
+      matrix = vrna_string_edit_distance_matrix(strings, options);
+      ck_assert(matrix != NULL);
+      ck_assert(memcmp(matrix, string_reference[r][c], sizeof(float) * NUM_PAIRS) == 0);
+      free(matrix);
+    }
+
+    for (i = 0; i < NUM_STRUCTURES; i++)
+      free(strings[i]);
+
+    free(strings);
+  }
+
+  vrna_dist_ws_free(ws);
+}
+
+#test test_vrna_string_edit_distance_backtrack
+{
+  int             i, j;
+  float           d;
+  swString        **strings;
+  vrna_dist_ws_t  *ws;
+
+  ws      = vrna_dist_ws_init();
+  strings = make_strings(0);
+
+  edit_backtrack = 1;
+  for (i = 1; i < NUM_STRUCTURES; i++)
+    for (j = 0; j < i; j++) {
+      d = vrna_string_edit_distance(ws, strings[i], strings[j], VRNA_DIST_BACKTRACK);
+      ck_assert(d == string_edit_distance(strings[i], strings[j]));
+      ck_assert(ws->aligned_line[0] != NULL);
+      ck_assert(ws->aligned_line[1] != NULL);
+      ck_assert_str_eq(ws->aligned_line[0], aligned_line[0]);
+      ck_assert_str_eq(ws->aligned_line[1], aligned_line[1]);
+      ck_assert_int_eq(strlen(ws->aligned_line[0]), strlen(ws->aligned_line[1]));
+    }
+  edit_backtrack = 0;
+
+  for (i = 0; i < NUM_STRUCTURES; i++)
+    free(strings[i]);
+
+  free(strings);
+  vrna_dist_ws_free(ws);
+}
+
+#tcase DistanceMatrix
+
+#test test_vrna_edit_distance_matrix_tiles
+{
+  int             i, j, n;
+  char            *x;
+  float           *tmatrix, *smatrix;
+  Tree            **trees;
+  swString        **strings;
+  vrna_dist_ws_t  *ws;
+
+  /* enough entries for several tiles of the lower triangle */
+  n       = 40;
+  trees   = (Tree **)vrna_alloc(sizeof(Tree *) * (n + 1));
+  strings = (swString **)vrna_alloc(sizeof(swString *) * (n + 1));
+  for (i = 0; i < n; i++) {
+    x           = representation(structures[(7 * i) % NUM_STRUCTURES], i % 2);
+    trees[i]    = make_tree(x);
+    strings[i]  = Make_swString(x);
+    free(x);
+  }
+
+  tmatrix = vrna_tree_edit_distance_matrix(trees, VRNA_DIST_DEFAULT);
+  smatrix = vrna_string_edit_distance_matrix(strings, VRNA_DIST_DEFAULT);
+  ck_assert((tmatrix != NULL) && (smatrix != NULL));
+
+  ws = vrna_dist_ws_init();
+  for (i = 1; i < n; i++)
+    for (j = 0; j < i; j++) {
+      ck_assert(tmatrix[i * (i - 1) / 2 + j] ==
+                vrna_tree_edit_distance(ws, trees[i], trees[j], VRNA_DIST_DEFAULT));
+      ck_assert(smatrix[i * (i - 1) / 2 + j] ==
+                vrna_string_edit_distance(ws, strings[i], strings[j], VRNA_DIST_DEFAULT));
+    }
+  vrna_dist_ws_free(ws);
+
+  for (i = 0; i < n; i++) {
+    free_tree(trees[i]);
+    free(strings[i]);
+  }
+
+  free(trees);
+  free(strings);
+  free(tmatrix);
+  free(smatrix);
+}
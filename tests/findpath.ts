@@ -0,0 +1,147 @@
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <ViennaRNA/fold_compound.h>
+#include <ViennaRNA/eval.h>
+#include <ViennaRNA/findpath.h>
+#include <ViennaRNA/utils/structures.h>
+#include <ViennaRNA/utils/basic.h>
+
+static const char *sequence = "GGGCGCGUAGCUCAGUUGGUAGAGCGCUACCUUGCAAGGUAGAGGUCGGCGGUUCGAUCCCGCCCGCGUCCA";
+
+/* a few suboptimal structures, and the open chain */
+static const char *structures[] = {
+  "(((((((..((((........)))).((((((....)))))).....(((((.......)))))))))))).",
+  "(((((((..(((((.....).)))).(((((......))))).....(((((.......)))))))))))).",
+  "(((((((..((.(....))).((.(.(((((......))))).).))(((((.......)))))))))))).",
+  "(((((((..((((........))))...((((....)))).......(((((.......)))))))))))).",
+  "((((((((.(((.....))))((.(.((((((....)))))).).))(((((.......)))))))))))).",
+  "........................................................................",
+  NULL
+};
+
+
+static int
+num_structures(void)
+{
+  int n;
+
+  for (n = 0; structures[n]; n++);
+
+  return n;
+}
+
+
+/* end of prologue */
+
+#suite Findpath
+
+#tcase SaddleMatrix
+
+#test test_vrna_path_findpath_saddle_matrix
+{
+  short                 *pt;
+  int                   i, j, n, width, *S;
+  vrna_fold_compound_t  *fc;
+
+  n     = num_structures();
+  width = 10;
+  fc    = vrna_fold_compound(sequence, NULL, VRNA_OPTION_EVAL_ONLY);
+
+  for (i = 0; i < n; i++)
+    ck_assert_int_eq(strlen(structures[i]), strlen(sequence));
+
+  S = vrna_path_findpath_saddle_matrix(fc, structures, width, VRNA_PATH_SADDLE_MATRIX_DEFAULT);
+  ck_assert(S != NULL);
+
+  /* same saddles as the pairwise search */
+  for (i = 0; i < n; i++) {
+    pt = vrna_ptable(structures[i]);
+    ck_assert_int_eq(S[n * i + i], vrna_eval_structure_pt(fc, pt));
+    free(pt);
+    for (j = i + 1; j < n; j++) {
+      ck_assert_int_eq(S[n * i + j],
+                       vrna_path_findpath_saddle(fc, structures[i], structures[j], width));
+      ck_assert_int_eq(S[n * i + j], S[n * j + i]);
+    }
+  }
+
+#ifdef _OPENMP
+  /* the result does not depend on the number of threads */
+  {
+    int *S1, max_threads = omp_get_max_threads();
+
+    omp_set_num_threads(1);
+    S1 = vrna_path_findpath_saddle_matrix(fc, structures, width, VRNA_PATH_SADDLE_MATRIX_DEFAULT);
+    omp_set_num_threads(max_threads);
+    ck_assert(memcmp(S, S1, sizeof(int) * n * n) == 0);
+    free(S1);
+  }
+#endif
+
+  free(S);
+
+  /* invalid input */
+  ck_assert(vrna_path_findpath_saddle_matrix(NULL, structures, width, 0) == NULL);
+  ck_assert(vrna_path_findpath_saddle_matrix(fc, NULL, width, 0) == NULL);
+  ck_assert(vrna_path_findpath_saddle_matrix(fc, structures + n, width, 0) == NULL);
+
+  vrna_fold_compound_free(fc);
+}
+
+#test test_vrna_path_findpath_saddle_matrix_upper_bounds
+{
+  int                   i, j, k, n, width, *S, *S_ub;
+  vrna_fold_compound_t  *fc;
+
+  n     = num_structures();
+  width = 10;
+  fc    = vrna_fold_compound(sequence, NULL, VRNA_OPTION_EVAL_ONLY);
+
+  S     = vrna_path_findpath_saddle_matrix(fc, structures, width, VRNA_PATH_SADDLE_MATRIX_DEFAULT);
+  S_ub  = vrna_path_findpath_saddle_matrix(fc,
+                                           structures,
+                                           width,
+                                           VRNA_PATH_SADDLE_MATRIX_UPPER_BOUNDS);
+  ck_assert(S_ub != NULL);
+
+  for (i = 0; i < n; i++) {
+    ck_assert_int_eq(S_ub[n * i + i], S[n * i + i]);
+    for (j = i + 1; j < n; j++) {
+      ck_assert_int_eq(S_ub[n * i + j], S_ub[n * j + i]);
+      /* never above the direct saddle, never below either end point */
+      ck_assert(S_ub[n * i + j] <= S[n * i + j]);
+      ck_assert(S_ub[n * i + j] >= MAX2(S[n * i + i], S[n * j + j]));
+      /* never above a detour via a structure of a previous row */
+      for (k = 0; k < i; k++)
+        ck_assert(S_ub[n * i + j] <= MAX2(S_ub[n * k + i], S_ub[n * k + j]));
+    }
+  }
+
+  /* the first row has no detours */
+  for (j = 1; j < n; j++)
+    ck_assert_int_eq(S_ub[j], S[j]);
+
+#ifdef _OPENMP
+  {
+    int *S1, max_threads = omp_get_max_threads();
+
+    omp_set_num_threads(1);
+    S1 = vrna_path_findpath_saddle_matrix(fc,
+                                          structures,
+                                          width,
+                                          VRNA_PATH_SADDLE_MATRIX_UPPER_BOUNDS);
+    omp_set_num_threads(max_threads);
+    ck_assert(memcmp(S_ub, S1, sizeof(int) * n * n) == 0);
+    free(S1);
+  }
+#endif
+
+  free(S);
+  free(S_ub);
+  vrna_fold_compound_free(fc);
+}
@@ -1,5 +1,6 @@
 #include <stdio.h>      /* printf, scanf, NULL */
 #include <stdlib.h>     /* malloc, free, rand */
+#include <string.h>
 
 #include <ViennaRNA/fold_vars.h>
 #include <ViennaRNA/data_structures.h>
@@ -8,6 +9,108 @@
 #include <ViennaRNA/constraints/basic.h>
 #include <ViennaRNA/fold.h>
 #include <ViennaRNA/part_func.h>
+#include <ViennaRNA/mfe.h>
+
+
+/*
+ *  Add hard constraints one after another and compare the incrementally
+ *  updated unpaired stretches and MFE against freshly initialized hard
+ *  constraints that receive all constraints at once
+ */
+static void
+check_hc_incremental_update(const char  *sequence,
+                            int         circ)
+{
+  vrna_md_t             md;
+  vrna_fold_compound_t  *vc, *vc_ref;
+  int                   i, j, p, s, num_bp;
+  const int             length = (int)strlen(sequence);
+  char                  structure[length + 1];
+  char                  structure_ref[length + 1];
+  char                  constraint[length + 1];
+  short                 *pt;
+  float                 mfe, mfe_ref;
+
+  vrna_md_set_default(&md);
+  md.circ = circ;
+
+  vc      = vrna_fold_compound(sequence, &md, VRNA_OPTION_MFE);
+  vc_ref  = vrna_fold_compound(sequence, &md, VRNA_OPTION_MFE);
+
+  /* base pairs of the unconstrained MFE structure serve as pair constraints */
+  (void)vrna_mfe(vc, structure);
+  pt = vrna_ptable(structure);
+
+  memset(constraint, '.', sizeof(char) * length);
+  constraint[length] = '\0';
+  num_bp = 0;
+
+  /* every 13th nucleotide, including the first and the last one */
+  for (s = 0, p = 1; p <= length; s++, p = (p == length) ? length + 1 : MIN2(p + 13, length)) {
+    if (constraint[p - 1] != '.')
+      continue;
+
+    switch (s % 4) {
+      case 0: /* must pair */
+        vrna_hc_add_bp_nonspecific(vc, p, 0, VRNA_CONSTRAINT_CONTEXT_ALL_LOOPS);
+        constraint[p - 1] = '|';
+        break;
+
+      case 1: /* can't pair */
+        vrna_hc_add_up(vc, p, VRNA_CONSTRAINT_CONTEXT_ALL_LOOPS);
+        constraint[p - 1] = 'x';
+        break;
+
+      case 2: /* pairs upstream */
+        vrna_hc_add_bp_nonspecific(vc, p, -1, VRNA_CONSTRAINT_CONTEXT_ALL_LOOPS);
+        constraint[p - 1] = '>';
+        break;
+
+      default: /* enforced base pair */
+        if (pt[p] == 0)
+          continue;
+
+        i = MIN2(p, pt[p]);
+        j = MAX2(p, pt[p]);
+        if ((constraint[i - 1] != '.') || (constraint[j - 1] != '.'))
+          continue;
+
+        vrna_hc_add_bp(vc,
+                       i,
+                       j,
+                       VRNA_CONSTRAINT_CONTEXT_ALL_LOOPS | VRNA_CONSTRAINT_CONTEXT_ENFORCE);
+        constraint[i - 1] = '(';
+        constraint[j - 1] = ')';
+        num_bp++;
+        break;
+    }
+
+    mfe = vrna_mfe_update(vc, structure);
+
+    vrna_hc_init(vc_ref);
+    vrna_hc_add_from_db(vc_ref,
+                        constraint,
+                        VRNA_CONSTRAINT_DB_DEFAULT | VRNA_CONSTRAINT_DB_ENFORCE_BP);
+    mfe_ref = vrna_mfe(vc_ref, structure_ref);
+
+    for (i = 1; i <= length + 1; i++) {
+      ck_assert_int_eq(vc->hc->up_ext[i], vc_ref->hc->up_ext[i]);
+      ck_assert_int_eq(vc->hc->up_hp[i], vc_ref->hc->up_hp[i]);
+      ck_assert_int_eq(vc->hc->up_int[i], vc_ref->hc->up_int[i]);
+      ck_assert_int_eq(vc->hc->up_ml[i], vc_ref->hc->up_ml[i]);
+    }
+
+    ck_assert(mfe == mfe_ref);
+    ck_assert_str_eq(structure, structure_ref);
+  }
+
+  ck_assert(num_bp > 0);
+
+  free(pt);
+  vrna_fold_compound_free(vc);
+  vrna_fold_compound_free(vc_ref);
+}
+
 
 #suite  MFE_Prediction
 
@@ -142,3 +245,14 @@
   free(plist_constrained);
   free(plist_unconstrained);
 }
+
+#tcase  Hard_Constraints
+
+#test test_hc_incremental_update
+{
+  const char sequence[] =
+    "UGCCUGGCGGCCGUAGCGCGGUGGUCCCACCUGACCCCAUGCCGAACUCAGAAGUGAAACGCCGUAGCGCCGAUGGUAGUGUGGGGUCUCCCCAUGCGAGAGUAGGGAACUGCCAGGCAU";
+
+  check_hc_incremental_update(sequence, 0);
+  check_hc_incremental_update(sequence, 1);
+}
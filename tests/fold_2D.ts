@@ -0,0 +1,263 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <ViennaRNA/fold_compound.h>
+#include <ViennaRNA/model.h>
+#include <ViennaRNA/2Dfold.h>
+#include <ViennaRNA/2Dpfold.h>
+#include <ViennaRNA/utils/basic.h>
+
+typedef struct {
+  int         k;
+  int         l;
+  int         en;
+  const char  *s;
+} mfe_class_t;
+
+typedef struct {
+  int         k;
+  int         l;
+  FLT_OR_DBL  q;
+} pf_class_t;
+
+static const char *sequence = "GGGCUAUUAGCUCAGUUGGUUAGAGCGCACCCCUGAUAAGGGUGAGGUCCA";
+static const char *ref1     = "(((((....((((.........)))).(((((.......))))).))))).";
+static const char *ref2     = "..........((((......))))....(((((......))))).......";
+
+/*
+ *  Distance classes up to a distance of 14 to both references (and the
+ *  class of all remaining structures) as computed before the circular
+ *  partition function was distributed among threads
+ */
+static const mfe_class_t mfe_linear[] = {
+  { 9, 14, -1100, "((((.....((((.........))))....(((......)))....))))." },
+  { 10, 13, -930, "((((.....(((((......).))))....(((......)))....))))." },
+  { 11, 12, -840, ".........((((.........)))).((.(((......)))))......." },
+  { 11, 14, -1170, "((((.....(((((......).))))....((((....))))....))))." },
+  { 12, 11, -670, ".........(((((......).)))).((.(((......)))))......." },
+  { 12, 13, -1080, ".........((((.........)))).((.((((....))))))......." },
+  { 13, 10, -760, ".........((((.........))))....(((......)))........." },
+  { 13, 12, -910, ".........(((((......).)))).((.((((....))))))......." },
+  { 13, 14, -950, "((.......((((.........))))...(((((....)))).)....))." },
+  { 14, 9, -590, ".........(((((......).))))....(((......)))........." },
+  { 14, 11, -1000, ".........((((.........))))....((((....))))........." },
+  { 14, 13, -910, ".........((((((....)).)))).((.((((....))))))......." },
+  { -1, -1, -1660, "(((((....((((.........)))).(((((.......))))).)))))." },
+  { INF, INF, 0, NULL }
+};
+
+static const pf_class_t pf_linear[] = {
+  { 9, 14, 0x1.1347fc53ebcc8p+3 },
+  { 10, 13, 0x1.7ecddf2bc1823p-2 },
+  { 11, 12, 0x1.5edc6da65c87ep-4 },
+  { 11, 14, 0x1.2ea3a6ae61d0ap+4 },
+  { 12, 11, 0x1.12ea82ea887fep-7 },
+  { 12, 13, 0x1.0eebcc053e4f4p+2 },
+  { 13, 10, 0x1.2361f8725f5b5p-6 },
+  { 13, 12, 0x1.b25d224a85ff5p-2 },
+  { 13, 14, 0x1.7b00fe915bc53p+0 },
+  { 14, 9, 0x1.38957250d9b16p-10 },
+  { 14, 11, 0x1.c609ea94e5215p-1 },
+  { 14, 13, 0x1.a67c02d3c9345p-1 },
+  { -1, -1, 0x1.25848e6c81673p+17 },
+  { INF, INF, 0. }
+};
+
+static const mfe_class_t mfe_circular[] = {
+  { 9, 14, -220, ".((((....((((.........))))....(((......)))...)))).." },
+  { 10, 13, -60, "..(((....((((.........))))....(((......)))...)))..." },
+  { 11, 12, 40, ".........((((.........)))).((.(((......)))))......." },
+  { 11, 14, -300, "..(((....((((.........))))....((((....))))...)))..." },
+  { 12, 11, 210, ".........(((((......).)))).((.(((......)))))......." },
+  { 12, 13, -200, ".........((((.........)))).((.((((....))))))......." },
+  { 13, 10, 20, ".........((((.........))))....(((......)))........." },
+  { 13, 12, -30, ".........(((((......).)))).((.((((....))))))......." },
+  { 13, 14, -190, "...(.....((((.........)))).((.((((....)))))).)....." },
+  { 14, 9, 0, "..................................................." },
+  { 14, 11, -220, ".........((((.........))))....((((....))))........." },
+  { 14, 13, -30, ".........((((((....)).)))).((.((((....))))))......." },
+  { -1, -1, -820, "(((((...)))))...(((....(.(.(((((.......))))).).))))" },
+  { INF, INF, 0, NULL }
+};
+
+static const pf_class_t pf_circular[] = {
+  { 9, 14, 0x1.98db2bc1100e9p-19 },
+  { 10, 13, 0x1.4c25d32eba88p-21 },
+  { 11, 12, 0x1.9d18934110d52p-24 },
+  { 11, 14, 0x1.0303645bf1c7dp-15 },
+  { 12, 11, 0x1.43f6fadc2846fp-27 },
+  { 12, 13, 0x1.4560f932fdfc1p-18 },
+  { 13, 10, 0x1.e2c33c01869d1p-25 },
+  { 13, 12, 0x1.f511a0b14a6d4p-22 },
+  { 13, 14, 0x1.d97455eabe511p-18 },
+  { 14, 9, 0x1.5a5b80e793012p-24 },
+  { 14, 11, 0x1.7b9d770b25e9fp-19 },
+  { 14, 13, 0x1.9d8a11dbeb468p-21 },
+  { -1, -1, 0x1.525e093bb2627p-1 },
+  { INF, INF, 0. }
+};
+
+
+static vrna_fold_compound_t *
+twoD_compound(int circ)
+{
+  vrna_md_t md;
+
+  vrna_md_set_default(&md);
+  md.circ = circ;
+
+  return vrna_fold_compound_TwoD(sequence, ref1, ref2, &md, VRNA_OPTION_MFE | VRNA_OPTION_PF);
+}
+
+
+static void
+check_mfe(int                circ,
+          const mfe_class_t  *reference)
+{
+  int                   i;
+  vrna_sol_TwoD_t       *mfe;
+  vrna_fold_compound_t  *fc;
+
+  fc  = twoD_compound(circ);
+  mfe = vrna_mfe_TwoD(fc, 14, 14);
+
+  for (i = 0; reference[i].k != INF; i++) {
+    ck_assert_int_eq(mfe[i].k, reference[i].k);
+    ck_assert_int_eq(mfe[i].l, reference[i].l);
+    ck_assert_int_eq((int)roundf(mfe[i].en * 100.), reference[i].en);
+    ck_assert_str_eq(mfe[i].s, reference[i].s);
+    free(mfe[i].s);
+  }
+  ck_assert_int_eq(mfe[i].k, INF);
+
+  free(mfe);
+  vrna_fold_compound_free(fc);
+}
+
+
+static vrna_sol_TwoD_pf_t *
+pf(int circ,
+   int maxD)
+{
+  vrna_sol_TwoD_pf_t    *q;
+  vrna_fold_compound_t  *fc;
+
+  fc  = twoD_compound(circ);
+  q   = vrna_pf_TwoD(fc, maxD, maxD);
+  vrna_fold_compound_free(fc);
+
+  return q;
+}
+
+
+static int
+num_classes(const vrna_sol_TwoD_pf_t *q)
+{
+  int n;
+
+  for (n = 0; q[n].k != INF; n++);
+
+  return n;
+}
+
+
+/* end of prologue */
+
+#suite TwoD
+
+#tcase MFE
+
+#test test_vrna_mfe_TwoD
+{
+  check_mfe(0, mfe_linear);
+}
+
+#test test_vrna_mfe_TwoD_circ
+{
+  check_mfe(1, mfe_circular);
+}
+
+#tcase PartitionFunction
+
+#test test_vrna_pf_TwoD
+{
+  int                 i;
+  vrna_sol_TwoD_pf_t  *q;
+
+  /* the linear partition function is not affected by the order of the threads */
+  q = pf(0, 14);
+  for (i = 0; pf_linear[i].k != INF; i++) {
+    ck_assert_int_eq(q[i].k, pf_linear[i].k);
+    ck_assert_int_eq(q[i].l, pf_linear[i].l);
+    ck_assert(q[i].q == pf_linear[i].q);
+  }
+  ck_assert_int_eq(q[i].k, INF);
+  free(q);
+}
+
+#test test_vrna_pf_TwoD_circ
+{
+  int                 i;
+  vrna_sol_TwoD_pf_t  *q;
+
+  /* the contributions of the threads are summed up in a different order */
+  q = pf(1, 14);
+  for (i = 0; pf_circular[i].k != INF; i++) {
+    ck_assert_int_eq(q[i].k, pf_circular[i].k);
+    ck_assert_int_eq(q[i].l, pf_circular[i].l);
+    ck_assert(fabs(q[i].q - pf_circular[i].q) <= 1e-10 * pf_circular[i].q);
+  }
+  ck_assert_int_eq(q[i].k, INF);
+  free(q);
+}
+
+#test test_vrna_pf_TwoD_threads
+{
+  int                 circ, n;
+  vrna_sol_TwoD_pf_t  *q, *q2;
+
+  for (circ = 0; circ < 2; circ++) {
+    /* the same results for repeated runs */
+    q   = pf(circ, -1);
+    q2  = pf(circ, -1);
+    n   = num_classes(q);
+    ck_assert_int_eq(num_classes(q2), n);
+    ck_assert(memcmp(q, q2, sizeof(vrna_sol_TwoD_pf_t) * n) == 0);
+    free(q2);
+
+#ifdef _OPENMP
+    {
+      int i, max_threads = omp_get_max_threads();
+
+      omp_set_num_threads(8);
+      q2 = pf(circ, -1);
+      ck_assert_int_eq(num_classes(q2), n);
+      if (circ) {
+        for (i = 0; i < n; i++) {
+          ck_assert_int_eq(q2[i].k, q[i].k);
+          ck_assert_int_eq(q2[i].l, q[i].l);
+          ck_assert(fabs(q2[i].q - q[i].q) <= 1e-10 * q[i].q);
+        }
+
+        /* but bitwise equal for a fixed number of threads */
+        free(q);
+        q = pf(circ, -1);
+        ck_assert(memcmp(q, q2, sizeof(vrna_sol_TwoD_pf_t) * n) == 0);
+      } else {
+        ck_assert(memcmp(q, q2, sizeof(vrna_sol_TwoD_pf_t) * n) == 0);
+      }
+
+      free(q2);
+      omp_set_num_threads(max_threads);
+    }
+#endif
+
+    free(q);
+  }
+}
@@ -0,0 +1,135 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <ViennaRNA/fold_compound.h>
+#include <ViennaRNA/mfe.h>
+#include <ViennaRNA/inverse.h>
+#include <ViennaRNA/utils/basic.h>
+
+static const char *targets[] = {
+  "((((....))))..((((((...))))))....(((((((....)))))))",
+  "..((((((((.....))))((((....))))))))....",
+  "(((((((..((((........)))).(((((.......))))).....(((((.......))))))))))))....",
+  NULL
+};
+
+
+/* a deterministic start sequence over the default alphabet */
+static char *
+start_sequence(size_t       n,
+               unsigned int seed)
+{
+  size_t  i;
+  char    *s;
+
+  s = (char *)vrna_alloc(sizeof(char) * (n + 1));
+  for (i = 0; i < n; i++) {
+    seed  = seed * 1103515245U + 12345U;
+    s[i]  = "AUGC"[(seed >> 16) % 4];
+  }
+
+  return s;
+}
+
+
+/* set the global random number generator to the state of vrna_inverse_seed() */
+static void
+seed_global(unsigned int seed)
+{
+  xsubi[0]  = 0x330E;
+  xsubi[1]  = (unsigned short)(seed & 0xFFFF);
+  xsubi[2]  = (unsigned short)(seed >> 16);
+  srand(seed);
+}
+
+
+static int
+folds_into(const char *sequence,
+           const char *target)
+{
+  int                   ret;
+  char                  *structure;
+  vrna_fold_compound_t  *fc;
+
+  structure = (char *)vrna_alloc(sizeof(char) * (strlen(sequence) + 1));
+  fc        = vrna_fold_compound(sequence, NULL, VRNA_OPTION_MFE);
+  vrna_mfe(fc, structure);
+  ret = (strcmp(structure, target) == 0);
+  vrna_fold_compound_free(fc);
+  free(structure);
+
+  return ret;
+}
+
+
+/* end of prologue */
+
+#suite Inverse
+
+#tcase InverseMFE
+
+#test test_vrna_inverse_mfe
+{
+  unsigned int    t, seed;
+  float           d_ctx, d_legacy;
+  char            *s_ctx, *s_legacy;
+  vrna_inverse_t  *ctx;
+
+  ctx = vrna_inverse_init(NULL, NULL, VRNA_INVERSE_DEFAULT);
+
+  for (t = 0; targets[t]; t++)
+    for (seed = 1; seed < 4; seed++) {
+      s_ctx     = start_sequence(strlen(targets[t]), seed);
+      s_legacy  = strdup(s_ctx);
+
+      /* by default, the search of a context is the one of inverse_fold() */
+      vrna_inverse_seed(ctx, seed);
+      srand(seed);
+      d_ctx = vrna_inverse_mfe(ctx, s_ctx, targets[t]);
+
+      seed_global(seed);
+      d_legacy = inverse_fold(s_legacy, targets[t]);
+
+      ck_assert(d_ctx == d_legacy);
+      ck_assert_str_eq(s_ctx, s_legacy);
+      ck_assert(d_ctx >= 0.);
+      if (d_ctx == 0.)
+        ck_assert(folds_into(s_ctx, targets[t]));
+
+      free(s_ctx);
+      free(s_legacy);
+    }
+
+  vrna_inverse_free(ctx);
+}
+
+#test test_vrna_inverse_mfe_prescreen
+{
+  unsigned int    t, seed, found;
+  float           d;
+  char            *s;
+  vrna_inverse_t  *ctx;
+
+  ctx   = vrna_inverse_init(NULL, NULL, VRNA_INVERSE_PRESCREEN);
+  found = 0;
+
+  for (t = 0; targets[t]; t++)
+    for (seed = 1; seed < 4; seed++) {
+      s = start_sequence(strlen(targets[t]), seed);
+      vrna_inverse_seed(ctx, seed);
+      d = vrna_inverse_mfe(ctx, s, targets[t]);
+
+      /* the pre-screening may lead to other designs, but successful ones fold into the target */
+      ck_assert(d >= 0.);
+      if (d == 0.) {
+        ck_assert(folds_into(s, targets[t]));
+        found++;
+      }
+
+      free(s);
+    }
+
+  ck_assert(found > 0);
+
+  vrna_inverse_free(ctx);
+}
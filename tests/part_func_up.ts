@@ -0,0 +1,250 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ViennaRNA/fold_compound.h>
+#include <ViennaRNA/model.h>
+#include <ViennaRNA/params/basic.h>
+#include <ViennaRNA/mfe.h>
+#include <ViennaRNA/fold.h>
+#include <ViennaRNA/part_func.h>
+#include <ViennaRNA/part_func_up.h>
+#include <ViennaRNA/utils/basic.h>
+
+static const char *sequences[] = {
+  "GGGCGCGUAGCUCAGUUGGUAGAGCGCUACCUUGCAAGGUAGAGGUCGGCGGUUCGAUCCCGCCCGCGUCCA",
+  "AUGCUAGCUAGCAUCGAUCGGCGCGAUAUAUUAGCGAUCG",
+  "GCGAUCGCUAAUAUAUCGCGCC",
+  NULL
+};
+
+
+static int
+relCompare(double a,
+           double b)
+{
+  if (fabs(a - b) <= 1e-12 * MAX2(fabs(a), fabs(b)))
+    return 1;
+
+  printf("%g != %g\n", a, b);
+  return 0;
+}
+
+
+static int
+pu_equal(const pu_contrib *a,
+         const pu_contrib *b)
+{
+  int i, j;
+
+  if ((a->length != b->length) || (a->w != b->w))
+    return 0;
+
+  for (i = 0; i <= a->length; i++)
+    for (j = 0; j <= a->w; j++)
+      if ((!relCompare(a->H[i][j], b->H[i][j])) ||
+          (!relCompare(a->I[i][j], b->I[i][j])) ||
+          (!relCompare(a->M[i][j], b->M[i][j])) ||
+          (!relCompare(a->E[i][j], b->E[i][j])))
+        return 0;
+
+  return 1;
+}
+
+
+/* the contributions as computed by the legacy interface */
+static pu_contrib *
+pu_legacy(const char  *sequence,
+          int         w)
+{
+  int         n;
+  char        *structure;
+  double      min_en;
+  pu_contrib  *pu;
+
+  n         = (int)strlen(sequence);
+  structure = (char *)vrna_alloc(sizeof(char) * (n + 1));
+  min_en    = fold(sequence, structure);
+  free_arrays();
+
+  pf_scale = exp(-min_en / (0.00198717 * (temperature + K0)) / n);
+  (void)pf_fold(sequence, structure);
+  pu = pf_unstru((char *)sequence, w);
+
+  free(structure);
+
+  return pu;
+}
+
+
+/* the contributions as computed by the reentrant interface */
+static pu_contrib *
+pu_reentrant(const char *sequence,
+             int        w)
+{
+  int                   n;
+  double                min_en;
+  pu_contrib            *pu;
+  vrna_fold_compound_t  *fc;
+
+  n       = (int)strlen(sequence);
+  fc      = vrna_fold_compound(sequence, NULL, VRNA_OPTION_DEFAULT);
+  min_en  = (double)vrna_mfe(fc, NULL);
+
+  free(fc->exp_params);
+  fc->exp_params            = vrna_exp_params(&(fc->params->model_details));
+  fc->exp_params->pf_scale  = exp(-min_en / (0.00198717 * (temperature + K0)) / n);
+
+  (void)vrna_pf(fc, NULL);
+  pu = vrna_pf_unstru(fc, w);
+
+  vrna_fold_compound_free(fc);
+
+  return pu;
+}
+
+
+/* end of prologue */
+
+#suite PartFuncUp
+
+#tcase Unstructured
+
+#test test_vrna_pf_unstru
+{
+  int         s, w;
+  pu_contrib  *pu, *pu_ref;
+
+  for (s = 0; sequences[s]; s++)
+    for (w = 1; w < 12; w += 5) {
+      pu_ref  = pu_legacy(sequences[s], w);
+      pu      = pu_reentrant(sequences[s], w);
+
+      ck_assert(pu != NULL);
+      ck_assert(pu_equal(pu, pu_ref));
+
+      free_pu_contrib_struct(pu);
+      free_pu_contrib_struct(pu_ref);
+      free_pf_arrays();
+    }
+
+  /* no base pair probabilities */
+  ck_assert(vrna_pf_unstru(NULL, 5) == NULL);
+}
+
+#test test_vrna_pf_interact
+{
+  int               i, s, w, incr3, incr5;
+  interact          *inter, *inter_ref;
+  pu_contrib        *pu1, *pu2, *pu1_ref, *pu2_ref;
+  vrna_exp_param_t  *P;
+
+  w       = 20;
+  P       = vrna_exp_params(NULL);
+  pu1     = pu_reentrant(sequences[1], w);
+  pu2     = pu_reentrant(sequences[2], w);
+  pu1_ref = pu_legacy(sequences[1], w);
+  pu2_ref = pu_legacy(sequences[2], w);
+
+  for (incr3 = 0; incr3 < 3; incr3 += 2)
+    for (incr5 = 0; incr5 < 3; incr5 += 2)
+      for (s = 0; s < 2; s++) {
+        /* interaction with an unstructured (s = 0) and a structured (s = 1) second sequence */
+        inter_ref = pf_interact(sequences[1],
+                                sequences[2],
+                                pu1_ref,
+                                (s) ? pu2_ref : NULL,
+                                w,
+                                NULL,
+                                incr3,
+                                incr5);
+        inter = vrna_pf_interact(P,
+                                 sequences[1],
+                                 sequences[2],
+                                 pu1,
+                                 (s) ? pu2 : NULL,
+                                 w,
+                                 NULL,
+                                 incr3,
+                                 incr5);
+
+        ck_assert(inter != NULL);
+        ck_assert(inter->Gikjl < 0.);
+        ck_assert_int_eq(inter->length, inter_ref->length);
+        ck_assert_int_eq(inter->i, inter_ref->i);
+        ck_assert_int_eq(inter->k, inter_ref->k);
+        ck_assert_int_eq(inter->j, inter_ref->j);
+        ck_assert_int_eq(inter->l, inter_ref->l);
+        ck_assert(relCompare(inter->Gikjl, inter_ref->Gikjl));
+        ck_assert(relCompare(inter->Gikjl_wo, inter_ref->Gikjl_wo));
+        for (i = 1; i <= inter->length; i++) {
+          ck_assert(relCompare(inter->Pi[i], inter_ref->Pi[i]));
+          ck_assert(relCompare(inter->Gi[i], inter_ref->Gi[i]));
+        }
+
+        free_interact(inter);
+        free_interact(inter_ref);
+      }
+
+  /* invalid input */
+  ck_assert(vrna_pf_interact(NULL, sequences[1], sequences[2], pu1, NULL, w, NULL, 0, 0) == NULL);
+  ck_assert(vrna_pf_interact(P, sequences[1], sequences[2], NULL, NULL, w, NULL, 0, 0) == NULL);
+
+  free_pu_contrib_struct(pu1);
+  free_pu_contrib_struct(pu2);
+  free_pu_contrib_struct(pu1_ref);
+  free_pu_contrib_struct(pu2_ref);
+  free(P);
+}
+
+#tcase Storage
+
+#test test_vrna_pu_contrib_write_read
+{
+  const char  *key = "GCGAUCGCUAAUAUAUCGCGCC T=37";
+  FILE        *fp;
+  pu_contrib  *pu, *pu_read;
+
+  pu = pu_reentrant(sequences[2], 8);
+
+  fp = tmpfile();
+  ck_assert(fp != NULL);
+  ck_assert_int_eq(vrna_pu_contrib_write(fp, pu, key), 1);
+
+  /* the same key yields the same data */
+  rewind(fp);
+  pu_read = vrna_pu_contrib_read(fp, key);
+  ck_assert(pu_read != NULL);
+  ck_assert(pu_equal(pu, pu_read));
+  ck_assert(memcmp(pu->E[pu->length], pu_read->E[pu->length], sizeof(double) * (pu->w + 1)) == 0);
+  free_pu_contrib_struct(pu_read);
+
+  /* a different key, e.g. other model settings, is rejected */
+  rewind(fp);
+  ck_assert(vrna_pu_contrib_read(fp, "GCGAUCGCUAAUAUAUCGCGCC T=25") == NULL);
+  rewind(fp);
+  ck_assert(vrna_pu_contrib_read(fp, "GCGAUCGCUAAUAUAUCGCGCC T=3") == NULL);
+  rewind(fp);
+  ck_assert(vrna_pu_contrib_read(fp, NULL) == NULL);
+  fclose(fp);
+
+  /* data written without key */
+  fp = tmpfile();
+  ck_assert(fp != NULL);
+  ck_assert_int_eq(vrna_pu_contrib_write(fp, pu, NULL), 1);
+  rewind(fp);
+  ck_assert(vrna_pu_contrib_read(fp, key) == NULL);
+  rewind(fp);
+  pu_read = vrna_pu_contrib_read(fp, NULL);
+  ck_assert(pu_read != NULL);
+  ck_assert(pu_equal(pu, pu_read));
+  free_pu_contrib_struct(pu_read);
+  fclose(fp);
+
+  /* invalid input */
+  ck_assert_int_eq(vrna_pu_contrib_write(NULL, pu, key), 0);
+  ck_assert(vrna_pu_contrib_read(NULL, key) == NULL);
+
+  free_pu_contrib_struct(pu);
+}
@@ -0,0 +1,370 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <ViennaRNA/datastructures/char_stream.h>
+#include <ViennaRNA/params/constants.h>
+#include <ViennaRNA/LPfold.h>
+#include <ViennaRNA/plex.h>
+#include <ViennaRNA/utils/basic.h>
+
+/* maximal length of unpaired stretches in the opening energy profiles, RNAplfold -u */
+#define UNPAIRED  30
+
+/* linear fit of the interior and bulge loop energies of the default parameters, see RNAplex */
+#define IL_A      6
+#define IL_B      196
+#define B_A       40
+#define B_B       200
+
+/*
+ *  hits of Lduplexfold_XS() for each target/query pair (target * 3 + query) with
+ *  threshold -800, alignment length 20 and duplex distance 20, as reported by
+ *  RNAplex before the target index was added
+ */
+static const char *reference_XS[9] = {
+  "(((((&)))))  35,39  :   6,10  (-7.09 = -9.70 +  1.65 +  0.96) i:39,j:6 <-7.80>\n",
+  "Error during initialization of the duplex in duplexfold_XS\n"
+  "((((((((&))))).)))  33,40  :  15,23  (-9.06 = -13.30 +  2.89 +  1.35) i:40,j:15 <-9.03>\n",
+  "Error during initialization of the duplex in duplexfold_XS\n"
+  "((((((&)))))) 204,209 :  12,17  (-9.30 = -10.56 +  0.70 +  0.56) i:209,j:12 <-9.43>\n",
+  "(.(((((&))))))  11,17  :   5,10  (-4.71 = -7.21 +  1.53 +  0.97) i:17,j:5 <-5.83>\n",
+  "Error during initialization of the duplex in duplexfold_XS\n"
+  "((((((.(((((&)))))......)))))) 210,221 :   4,20  (-7.02 = -11.50 +  3.12 +  1.36) i:221,j:4 <-8.93>\n",
+  "Error during initialization of the duplex in duplexfold_XS\n"
+  "Error during initialization of the duplex in duplexfold_XS\n"
+  "Error during initialization of the duplex in duplexfold_XS\n"
+  "Error during initialization of the duplex in duplexfold_XS\n"
+  "Error during initialization of the duplex in duplexfold_XS\n"
+  "Error during initialization of the duplex in duplexfold_XS\n"
+  "Error during initialization of the duplex in duplexfold_XS\n"
+  "Error during initialization of the duplex in duplexfold_XS\n"
+  "Error during initialization of the duplex in duplexfold_XS\n"
+  "Error during initialization of the duplex in duplexfold_XS\n"
+  "((((((((&)))))))) 241,248 :   5,12  (-6.89 = -12.73 +  3.85 +  1.99) i:248,j:5 <-12.93>\n",
+  "Error during initialization of the duplex in duplexfold_XS\n"
+  "((((((&))))))  40,45  :   5,10  (-7.99 = -10.71 +  1.75 +  0.97) i:45,j:5 <-9.44>\n",
+  "(((((((&))))))) 252,258 :   4,10  (-6.64 = -9.31 +  1.74 +  0.93) i:258,j:4 <-7.67>\n",
+  "Error during initialization of the duplex in duplexfold_XS\n"
+  "Error during initialization of the duplex in duplexfold_XS\n"
+  "Error during initialization of the duplex in duplexfold_XS\n"
+  "Error during initialization of the duplex in duplexfold_XS\n"
+  "Error during initialization of the duplex in duplexfold_XS\n"
+  "Error during initialization of the duplex in duplexfold_XS\n"
+  "((((((.(((((..(((&)))..))))))))).)) 359,375 :   1,16  (-9.72 = -17.62 +  5.69 +  2.21) i:375,j:1 <-10.81>\n"
+};
+
+/*
+ *  hits of Lduplexfold() for each target/query pair (target * 3 + query) with
+ *  threshold -600, extension cost 30, alignment length 20 and duplex distance 20,
+ *  as reported by RNAplex before the recursions were vectorized
+ */
+static const char *reference[9] = {
+  ".(((((.(((((.&.)))))...))))). 141,153 :   5,19  (-16.30) i:152,j:6 <-5.80>\n",
+  ".(((.((((((.&.))))))))). 194,205 :  14,24  (-14.40)  i:204,j:15 <-6.30>\n"
+  ".((((((((((.&.)))).)))))). 147,158 :   9,21  (-15.50)  i:157,j:10 <-6.80>\n"
+  ".((((((((.&.))))).))).  32,41  :  14,24  (-14.50)  i:40,j:15 <-7.00>\n"
+  ".((((((((.&.))))).))).  32,41  :  14,24  (-14.50) i:40,j:15 <-7.00>\n",
+  ".((((((.&.)))))). 203,210 :  11,18  (-11.80) i:209,j:12 <-5.80>\n",
+  ".((((((.((((.&.))))..)))))). 203,215 :   5,18  (-14.80) i:214,j:6 <-5.50>\n",
+  ".(((.((((((.&.)))))).))) 205,216 :  14,24  (-13.70) i:215,j:15 <-5.90>\n",
+  ".((((((..((.(((.&.))).)).)))))). 359,374 :   4,18  (-18.90)  i:373,j:5 <-8.40>\n"
+  ".((((((.((((.((.&.)).))))..)))))). 264,279 :   2,18  (-19.30)  i:278,j:3 <-8.20>\n"
+  ".((((((((.&.)))))))). 240,249 :   4,13  (-13.40)  i:248,j:5 <-6.20>\n"
+  ".((((((..((.(((.&.))).)).)))))). 359,374 :   4,18  (-18.90) i:373,j:5 <-8.40>\n",
+  ".((((((.&.)))))).  39,46  :   4,11  (-11.90) i:45,j:5 <-5.90>\n",
+  ".(((((((.&.))))))). 450,458 :  13,21  (-12.10) i:457,j:14 <-5.50>\n",
+  ".(((((..(((.(((((.&))))))))))))). 581,598 :   1,14  (-17.00)  i:597,j:1 <-6.20>\n"
+  ".(((((((.&.))))))). 519,527 :   8,16  (-12.80)  i:526,j:9 <-6.20>\n"
+  ".((..(.(((((((.&.))))))).)..)). 450,464 :   4,18  (-16.50)  i:463,j:5 <-6.30>\n"
+  ".((((..(((..(((((..(((.&)))..)))))))))))). 354,376 :   1,18  (-20.70)  i:375,j:1 <-7.20>\n"
+  ".((((...(((((.&.))))))))). 313,326 :   8,18  (-15.70)  i:325,j:9 <-7.00>\n"
+  ".(((((.(...(((((((.&.)))))))..).))))). 264,282 :   3,20  (-18.90)  i:281,j:4 <-6.60>\n"
+  ".((((((.&.)))))). 220,227 :   4,11  (-12.50)  i:226,j:5 <-6.50>\n"
+  ".((((..(((..(((((..(((.&)))..)))))))))))). 354,376 :   1,18  (-20.70) i:375,j:1 <-7.20>\n"
+};
+
+
+/* a deterministic random sequence of length n, padded with N's as in RNAplex */
+static char *
+sequence(unsigned int seed,
+         int          n)
+{
+  int   i;
+  char  *s;
+
+  s = (char *)vrna_alloc(sizeof(char) * (n + 21));
+  strcpy(s, "NNNNNNNNNN");
+  for (i = 0; i < n; i++) {
+    seed      = seed * 1103515245U + 12345U;
+    s[10 + i] = "ACGU"[(seed >> 16) % 4];
+  }
+  strcpy(s + 10 + n, "NNNNNNNNNN");
+
+  return s;
+}
+
+
+/* opening energies of a padded sequence in the layout RNAplex reads from RNAplfold -W 200 -L 150 -O */
+static int **
+accessibility(const char *s)
+{
+  char    *seq;
+  int     i, k, n, **access;
+  double  kT, **pU;
+
+  n       = strlen(s) - 20;
+  seq     = strndup(s + 10, n);
+  kT      = (37. + K0) * GASCONST / 1000.;
+  pU      = vrna_pfl_fold_up(seq, UNPAIRED, n < 200 ? n : 200, n < 150 ? n : 150);
+  access  = (int **)vrna_alloc(sizeof(int *) * (UNPAIRED + 2));
+
+  for (i = 0; i < UNPAIRED + 2; i++) {
+    access[i] = (int *)vrna_alloc(sizeof(int) * (n + 21));
+    for (k = 0; k < n + 21; k++)
+      access[i][k] = INF;
+  }
+
+  access[0][0] = UNPAIRED + 2;
+  for (k = 1; k <= n; k++) {
+    for (i = 1; i <= UNPAIRED && i <= k; i++)
+      access[i][k + 10] = (int)rint(100 * (-log(pU[k][i]) * kT));
+    free(pU[k]);
+  }
+
+  free(pU);
+  free(seq);
+
+  return access;
+}
+
+
+static void
+accessibility_free(int **access)
+{
+  int i;
+
+  for (i = 0; i < UNPAIRED + 2; i++)
+    free(access[i]);
+  free(access);
+}
+
+
+static char *
+duplexes_XS(const char  *s1,
+            const char  *s2,
+            int         **access_s1,
+            int         **access_s2)
+{
+  char        *result;
+  vrna_cstr_t output;
+
+  /* the stream is written to a temporary file when closed */
+  output = vrna_cstr(0, tmpfile());
+  Lduplexfold_XS_cstr(output, s1, s2, (const int **)access_s1, (const int **)access_s2,
+                      -800, 20, 20, 0, IL_A, IL_B, B_A, B_B);
+  result = strdup(vrna_cstr_string(output));
+  vrna_cstr_close(output);
+
+  return result;
+}
+
+
+/* redirect stdout to a temporary file, Lduplexfold() and Lduplexfold_XS() print their hits */
+static FILE *
+capture_stdout(int *fd)
+{
+  FILE *tmp = tmpfile();
+
+  fflush(stdout);
+  *fd = dup(fileno(stdout));
+  dup2(fileno(tmp), fileno(stdout));
+
+  return tmp;
+}
+
+
+static char *
+release_stdout(FILE *tmp,
+               int  fd)
+{
+  char  *result;
+  long  size;
+
+  fflush(stdout);
+  dup2(fd, fileno(stdout));
+  close(fd);
+
+  size    = ftell(tmp);
+  result  = (char *)vrna_alloc(sizeof(char) * (size + 1));
+  rewind(tmp);
+  if (fread(result, sizeof(char), size, tmp) != (size_t)size)
+    result[0] = '\0';
+
+  fclose(tmp);
+
+  return result;
+}
+
+
+/* compare the hits of Lduplexfold() and Lduplexfold_XS() for all pairs with the references */
+static void
+check_Lduplexfold(void)
+{
+  int   fd, t, q, **access_t[3], **access_q[3];
+  char  *s_t[3], *s_q[3], *result;
+  FILE  *tmp;
+
+  for (t = 0; t < 3; t++) {
+    s_t[t]      = sequence(1001 + t, 300 + 150 * t);
+    access_t[t] = accessibility(s_t[t]);
+  }
+
+  for (q = 0; q < 3; q++) {
+    s_q[q]      = sequence(2001 + q, 22 + 2 * q);
+    access_q[q] = accessibility(s_q[q]);
+  }
+
+  for (t = 0; t < 3; t++)
+    for (q = 0; q < 3; q++) {
+      tmp = capture_stdout(&fd);
+      Lduplexfold(s_t[t], s_q[q], -600, 30, 20, 20, 0, IL_A, IL_B, B_A, B_B);
+      result = release_stdout(tmp, fd);
+      ck_assert_str_eq(result, reference[t * 3 + q]);
+      free(result);
+
+      tmp = capture_stdout(&fd);
+      Lduplexfold_XS(s_t[t], s_q[q], (const int **)access_t[t], (const int **)access_q[q],
+                     -800, 20, 20, 0, IL_A, IL_B, B_A, B_B);
+      result = release_stdout(tmp, fd);
+      ck_assert_str_eq(result, reference_XS[t * 3 + q]);
+      free(result);
+    }
+
+  for (t = 0; t < 3; t++) {
+    accessibility_free(access_t[t]);
+    accessibility_free(access_q[t]);
+    free(s_t[t]);
+    free(s_q[t]);
+  }
+}
+
+
+/* end of prologue */
+
+#suite Plex
+
+#tcase LduplexfoldXS
+
+#test test_Lduplexfold_XS_cstr
+{
+  int   t, q, **access_t[3], **access_q[3];
+  char  *s_t[3], *s_q[3], *result;
+
+  for (t = 0; t < 3; t++) {
+    s_t[t]      = sequence(1001 + t, 300 + 150 * t);
+    access_t[t] = accessibility(s_t[t]);
+  }
+
+  for (q = 0; q < 3; q++) {
+    s_q[q]      = sequence(2001 + q, 22 + 2 * q);
+    access_q[q] = accessibility(s_q[q]);
+  }
+
+  for (t = 0; t < 3; t++)
+    for (q = 0; q < 3; q++) {
+      result = duplexes_XS(s_t[t], s_q[q], access_t[t], access_q[q]);
+      ck_assert_str_eq(result, reference_XS[t * 3 + q]);
+      free(result);
+    }
+
+  for (t = 0; t < 3; t++) {
+    accessibility_free(access_t[t]);
+    accessibility_free(access_q[t]);
+    free(s_t[t]);
+    free(s_q[t]);
+  }
+}
+
+#test test_Lduplexfold_XS_cstr_threads
+{
+  int   k, t, q, **access_t[3], **access_q[3];
+  char  *s_t[3], *s_q[3], *result[9];
+
+  for (t = 0; t < 3; t++) {
+    s_t[t]      = sequence(1001 + t, 300 + 150 * t);
+    access_t[t] = accessibility(s_t[t]);
+  }
+
+  for (q = 0; q < 3; q++) {
+    s_q[q]      = sequence(2001 + q, 22 + 2 * q);
+    access_q[q] = accessibility(s_q[q]);
+  }
+
+#ifdef _OPENMP
+  {
+    int max_threads = omp_get_max_threads();
+
+    /* all pairs in parallel as in RNAplex --jobs, the output does not depend on the number of threads */
+    omp_set_num_threads(1);
+#pragma omp parallel for schedule(dynamic, 1) private(t, q)
+    for (k = 0; k < 9; k++) {
+      q         = k / 3;
+      t         = k % 3;
+      result[k] = duplexes_XS(s_t[t], s_q[q], access_t[t], access_q[q]);
+    }
+
+    for (k = 0; k < 9; k++) {
+      ck_assert_str_eq(result[k], reference_XS[(k % 3) * 3 + k / 3]);
+      free(result[k]);
+    }
+
+    omp_set_num_threads(8);
+#pragma omp parallel for schedule(dynamic, 1) private(t, q)
+    for (k = 0; k < 9; k++) {
+      q         = k / 3;
+      t         = k % 3;
+      result[k] = duplexes_XS(s_t[t], s_q[q], access_t[t], access_q[q]);
+    }
+
+    omp_set_num_threads(max_threads);
+  }
+#else
+  for (k = 0; k < 9; k++)
+    result[k] = duplexes_XS(s_t[k % 3], s_q[k / 3], access_t[k % 3], access_q[k / 3]);
+#endif
+
+  for (k = 0; k < 9; k++) {
+    ck_assert_str_eq(result[k], reference_XS[(k % 3) * 3 + k / 3]);
+    free(result[k]);
+  }
+
+  for (t = 0; t < 3; t++) {
+    accessibility_free(access_t[t]);
+    accessibility_free(access_q[t]);
+    free(s_t[t]);
+    free(s_q[t]);
+  }
+}
+
+#tcase Lduplexfold
+
+#test test_Lduplexfold
+{
+  /* the implementation selected by the SIMD capabilities of the CPU */
+  check_Lduplexfold();
+}
+
+#test test_Lduplexfold_scalar
+{
+  /* the scalar recursions */
+  vrna_plex_dispatch_disable();
+  check_Lduplexfold();
+  vrna_plex_dispatch_enable();
+}
@@ -0,0 +1,257 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ViennaRNA/dist_vars.h>
+#include <ViennaRNA/profiledist.h>
+#include <ViennaRNA/ProfileAln.h>
+#include <ViennaRNA/utils/basic.h>
+
+#define NUM_PROFILES  6
+#define NUM_PAIRS     (NUM_PROFILES * (NUM_PROFILES - 1) / 2)
+
+static const int lengths[NUM_PROFILES] = {
+  37, 42, 30, 58, 41, 45
+};
+
+/* portable pseudo-random numbers in [0,1) */
+static double
+lcg(unsigned int *state)
+{
+  *state = *state * 1103515245u + 12345u;
+  return (double)((*state >> 8) & 0xFFFF) / 65536.;
+}
+
+
+/* random probability profile and sequence of length n */
+static float *
+random_profile(int          n,
+               char         **seq,
+               unsigned int *state)
+{
+  int   i;
+  float *T, up, down;
+
+  T     = (float *)vrna_alloc(sizeof(float) * 3 * (n + 1));
+  *seq  = (char *)vrna_alloc(sizeof(char) * (n + 1));
+  T[0]  = (float)n;
+  T[1]  = 3.;
+
+  for (i = 1; i <= n; i++) {
+    up            = (float)(0.6 * lcg(state));
+    down          = (float)((1. - up) * lcg(state));
+    T[3 * i + 1]  = up;
+    T[3 * i + 2]  = down;
+    T[3 * i + 0]  = 1 - up - down;
+    (*seq)[i - 1] = "ACGU"[(int)(4 * lcg(state))];
+  }
+
+  return T;
+}
+
+
+/*
+ *  Results of profile_edit_distance() and profile_aln() for the lower
+ *  triangle (i > j, row-major) of the profiles above, as computed with
+ *  double precision sums before the distances became reentrant
+ */
+static const float dist_reference[NUM_PAIRS] = {
+  11.1685219, 10.841877, 15.7920389, 24.6146088, 20.899456, 30.5023365, 10.4105482,
+  9.22486782, 14.8628235, 21.0916977, 12.7189837, 9.83421421, 18.2142811, 17.2825184,
+  8.27291775
+};
+
+/* default alignment parameters */
+static const float aln_reference[NUM_PAIRS] = {
+  16.3706837, 14.9781675, 18.3496704, 21.4786987, 21.8449001, 17.4557457, 20.0978832,
+  21.8820267, 18.4336834, 23.9316902, 18.131155, 22.566637, 17.1802216, 23.7637386,
+  22.3074207
+};
+
+/* set_paln_params(2.0, 0.5, 0.2, 0) */
+static const float aln_reference_no_free_ends[NUM_PAIRS] = {
+  21.8338909, 16.8520393, 15.0760412, 15.3661413, 21.0156956, 6.28815889, 23.0915031,
+  27.0316315, 14.4330978, 20.8051052, 21.8758888, 27.7905083, 12.7470827, 25.3565693,
+  27.7338181
+};
+
+/* alignments of profiles 3 and 1 */
+static const char *dist_alignment[2] = {
+  ",.|))}|}||..{|.}|,}||,}|,).}{|},|}).){,|}}.}).|}{.{.|{,|)|",
+  "||{,_{,}||___)|)_.})}{}|{}_)_|,,_,}_}{_|_|_||.___,|.}_,{}|"
+};
+
+static const char *aln_alignment[4] = {
+  ",.|))}|}||..{|.}|,}||,}|,).}{|},|}).){,|}}.}).|}{.{.|{,|)|",
+  "||{,_{,}||)|).})}{}|{})|,,,}}{||||.___,|.},{}|____________",
+  "CUGAUACCGAUUCUGCCUUUCACUCUUGAGAAUCCACGUGUAGGUACAUAUGCGGCAA",
+  "AUAA_ACGGAGGGGGCAUGCUACACACAGCAAUCU___UGGAGGUG____________"
+};
+
+
+static int
+relCompare(float  a,
+           float  b)
+{
+  if (fabs(a - b) <= 1e-5 * MAX2(fabs(a), fabs(b)))
+    return 1;
+
+  printf("%.9g != %.9g\n", a, b);
+  return 0;
+}
+
+
+static void
+make_profiles(float **T,
+              char  **S)
+{
+  int           i;
+  unsigned int  state = 4711;
+
+  for (i = 0; i < NUM_PROFILES; i++)
+    T[i] = random_profile(lengths[i], S + i, &state);
+
+  T[NUM_PROFILES] = NULL;
+  S[NUM_PROFILES] = NULL;
+}
+
+
+static void
+free_profiles(float **T,
+              char  **S)
+{
+  int i;
+
+  for (i = 0; i < NUM_PROFILES; i++) {
+    free(T[i]);
+    free(S[i]);
+  }
+}
+
+
+/* end of prologue */
+
+#suite ProfileDistance
+
+#tcase ProfileEditDistance
+
+#test test_vrna_profile_edit_distance
+{
+  float           *T[NUM_PROFILES + 1], d, d_band, *matrix;
+  char            *S[NUM_PROFILES + 1];
+  int             i, j, p;
+  vrna_dist_ws_t  *ws;
+
+  make_profiles(T, S);
+  ws = vrna_dist_ws_init();
+
+  for (p = 0, i = 1; i < NUM_PROFILES; i++)
+    for (j = 0; j < i; j++, p++) {
+      d = vrna_profile_edit_distance(ws, T[i], T[j], 0, VRNA_DIST_DEFAULT);
+      ck_assert(relCompare(d, dist_reference[p]));
+      /* the legacy interface gives the same result */
+      ck_assert(d == profile_edit_distance(T[i], T[j]));
+      /* full and two-row matrices give the same result */
+      ck_assert(d == vrna_profile_edit_distance(ws, T[i], T[j], 0, VRNA_DIST_BACKTRACK));
+      /* a band that covers the complete matrix is exact */
+      ck_assert(d == vrna_profile_edit_distance(ws, T[i], T[j], 100, VRNA_DIST_DEFAULT));
+      /* a narrow band can only increase the distance */
+      d_band = vrna_profile_edit_distance(ws, T[i], T[j], 2, VRNA_DIST_DEFAULT);
+      ck_assert(d_band >= d - 1e-5 * d);
+    }
+
+  matrix = vrna_profile_edit_distance_matrix((const float **)T, 0, VRNA_DIST_DEFAULT);
+  ck_assert(matrix != NULL);
+  for (p = 0, i = 1; i < NUM_PROFILES; i++)
+    for (j = 0; j < i; j++, p++)
+      ck_assert(matrix[p] == vrna_profile_edit_distance(ws, T[i], T[j], 0, VRNA_DIST_DEFAULT));
+
+  free(matrix);
+
+  matrix = vrna_profile_edit_distance_matrix((const float **)T, 2, VRNA_DIST_DEFAULT);
+  ck_assert(matrix != NULL);
+  for (p = 0, i = 1; i < NUM_PROFILES; i++)
+    for (j = 0; j < i; j++, p++)
+      ck_assert(matrix[p] == vrna_profile_edit_distance(ws, T[i], T[j], 2, VRNA_DIST_DEFAULT));
+
+  free(matrix);
+
+  /* alignments are unchanged */
+  vrna_profile_edit_distance(ws, T[3], T[1], 0, VRNA_DIST_BACKTRACK);
+  ck_assert_str_eq(ws->aligned_line[0], dist_alignment[0]);
+  ck_assert_str_eq(ws->aligned_line[1], dist_alignment[1]);
+
+  edit_backtrack = 1;
+  profile_edit_distance(T[3], T[1]);
+  edit_backtrack = 0;
+  ck_assert_str_eq(aligned_line[0], dist_alignment[0]);
+  ck_assert_str_eq(aligned_line[1], dist_alignment[1]);
+
+  vrna_dist_ws_free(ws);
+  free_profiles(T, S);
+}
+
+#tcase ProfileAlignment
+
+#test test_vrna_profile_aln
+{
+  float           *T[NUM_PROFILES + 1], score, score_band, *matrix;
+  char            *S[NUM_PROFILES + 1];
+  int             i, j, p;
+  vrna_dist_ws_t  *ws;
+
+  make_profiles(T, S);
+  ws = vrna_dist_ws_init();
+
+  for (p = 0, i = 1; i < NUM_PROFILES; i++)
+    for (j = 0; j < i; j++, p++) {
+      score = vrna_profile_aln(ws, T[i], S[i], T[j], S[j], 0, VRNA_DIST_DEFAULT);
+      ck_assert(relCompare(score, aln_reference[p]));
+      /* the legacy interface returns the score also without backtracking */
+      ck_assert(score == profile_aln(T[i], S[i], T[j], S[j]));
+      ck_assert(score == vrna_profile_aln(ws, T[i], S[i], T[j], S[j], 0, VRNA_DIST_BACKTRACK));
+      ck_assert(score == vrna_profile_aln(ws, T[i], S[i], T[j], S[j], 100, VRNA_DIST_DEFAULT));
+      /* a narrow band can only decrease the score */
+      score_band = vrna_profile_aln(ws, T[i], S[i], T[j], S[j], 2, VRNA_DIST_DEFAULT);
+      ck_assert(score_band <= score + 1e-5 * score);
+    }
+
+  matrix = vrna_profile_aln_matrix((const float **)T, (const char **)S, 0, VRNA_DIST_DEFAULT);
+  ck_assert(matrix != NULL);
+  for (p = 0, i = 1; i < NUM_PROFILES; i++)
+    for (j = 0; j < i; j++, p++)
+      ck_assert(matrix[p] ==
+                vrna_profile_aln(ws, T[i], S[i], T[j], S[j], 0, VRNA_DIST_DEFAULT));
+
+  free(matrix);
+
+  /* alignments are unchanged */
+  vrna_profile_aln(ws, T[3], S[3], T[1], S[1], 0, VRNA_DIST_BACKTRACK);
+  for (i = 0; i < 4; i++)
+    ck_assert_str_eq(ws->aligned_line[i], aln_alignment[i]);
+
+  edit_backtrack = 1;
+  profile_aln(T[3], S[3], T[1], S[1]);
+  edit_backtrack = 0;
+  for (i = 0; i < 4; i++)
+    ck_assert_str_eq(aligned_line[i], aln_alignment[i]);
+
+  /* no free end gaps and a different sequence weight */
+  set_paln_params(2.0, 0.5, 0.2, 0);
+  for (p = 0, i = 1; i < NUM_PROFILES; i++)
+    for (j = 0; j < i; j++, p++) {
+      score = vrna_profile_aln(ws, T[i], S[i], T[j], S[j], 0, VRNA_DIST_DEFAULT);
+      ck_assert(relCompare(score, aln_reference_no_free_ends[p]));
+    }
+
+  matrix = vrna_profile_aln_matrix((const float **)T, (const char **)S, 0, VRNA_DIST_DEFAULT);
+  for (p = 0; p < NUM_PAIRS; p++)
+    ck_assert(relCompare(matrix[p], aln_reference_no_free_ends[p]));
+
+  free(matrix);
+  set_paln_params(1.5, 0.666, 0.5, 1);
+
+  vrna_dist_ws_free(ws);
+  free_profiles(T, S);
+}
@@ -0,0 +1,158 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <ViennaRNA/datastructures/char_stream.h>
+#include <ViennaRNA/snofold.h>
+#include <ViennaRNA/snoop.h>
+#include <ViennaRNA/utils/basic.h>
+
+/* H/ACA snoRNA, the sequences are padded with five N's as in RNAsnoop */
+static const char *snoRNA = "NNNNNCUUGUGCUAAAUACACGUCAGACAAAUAACAGAAAUGUUAUUUGUCGCACGAAAUUUAGCACAUGGNNNNN";
+
+/* interactions with the first 2000 nt of target(20061, ...) as reported by RNAsnoop -e 3 */
+static const char *reference =
+  "<<<<<<.<<<|.<<&>>(((((.............(((((((((((....))))))))))))))))..>>>.>>>>>>... "
+  "1163,1176;1173 :   2,64  (-25.90 = -12.70 + -2.80 + -14.50 +  0.00 + 4.1 ) (-25.60) \n"
+  "UGUGCUUGAUUGGG&CUUGUGCUAAAUACACGUCAGACAAAUAACAGAAAUGUUAUUUGUCGCACGAAAUUUAGCACAUGG\n"
+  "<<<<<<<.<<<.|.<<<<&........>>>>(..(((..............................)))...)>>>.>>>>>>> "
+  "252,269;264 :  10,67  (-23.20 = -14.90 + -2.90 + -9.50 +  0.00 + 4.1 ) (-25.60) \n"
+  "CUAUGUGGUAACUAAUUU&CUUGUGCUAAAUACACGUCAGACAAAUAACAGAAAUGUUAUUUGUCGCACGAAAUUUAGCACAUGG\n";
+
+
+/* a deterministic random target of length n, padded with N's */
+static char *
+target(unsigned int seed,
+       int          n)
+{
+  int   i;
+  char  *s;
+
+  s = (char *)vrna_alloc(sizeof(char) * (n + 11));
+  strcpy(s, "NNNNN");
+  for (i = 0; i < n; i++) {
+    seed      = seed * 1103515245U + 12345U;
+    s[5 + i]  = "ACGU"[(seed >> 16) % 4];
+  }
+  strcpy(s + 5 + n, "NNNNN");
+
+  return s;
+}
+
+
+static int
+fold_snoRNA(void)
+{
+  char *structure;
+
+  /* snofold() takes over the structure */
+  structure = (char *)vrna_alloc(sizeof(char) * (strlen(snoRNA) + 1));
+
+  return snofold(snoRNA, structure, 30, -280, 16, 21, 5, 120);
+}
+
+
+/* the interactions as written by RNAsnoop with default settings */
+static char *
+interactions(const char *s,
+             int        delta,
+             int        fullStemEnergy)
+{
+  char        *result;
+  vrna_cstr_t output;
+
+  /* the stream is written to a temporary file when closed */
+  output = vrna_cstr(0, tmpfile());
+  Lsnoop_subopt_list_cstr(output, s, snoRNA, delta, 5, 0, -280, -170, -270, -1090, -1370,
+                          100000, 100000, 2, 5, 120, 16, 21, 6, 100005, 5, 5, 25, NULL,
+                          fullStemEnergy);
+  result = strdup(vrna_cstr_string(output));
+  vrna_cstr_close(output);
+
+  return result;
+}
+
+
+/* end of prologue */
+
+#suite Snoop
+
+#tcase LsnoopSuboptList
+
+#test test_Lsnoop_subopt_list_cstr
+{
+  int   fullStemEnergy;
+  char  *s, *result;
+
+  fullStemEnergy = fold_snoRNA();
+  ck_assert_int_eq(fullStemEnergy, -2560);
+
+  s       = target(20061, 2000);
+  result  = interactions(s, 310, fullStemEnergy);
+  ck_assert_str_eq(result, reference);
+  free(result);
+
+  /* a negative energy range leaves no interactions */
+  result = interactions(s, -2000, fullStemEnergy);
+  ck_assert_str_eq(result, "");
+  free(result);
+
+  free(s);
+}
+
+#test test_Lsnoop_subopt_list_cstr_threads
+{
+  int   i, n, fullStemEnergy;
+  char  *s[4], *result[4], *reference_long[4];
+
+  fullStemEnergy  = fold_snoRNA();
+  n               = 4;
+
+  /* long targets are scanned in chunks */
+  for (i = 0; i < n; i++) {
+    s[i]              = target(20061 + i, 2000 * (i + 1) * (i + 1));
+    reference_long[i] = interactions(s[i], 310, fullStemEnergy);
+  }
+
+#ifdef _OPENMP
+  {
+    int max_threads = omp_get_max_threads();
+
+    /* the output does not depend on the number of threads */
+    omp_set_num_threads(1);
+    for (i = 0; i < n; i++) {
+      result[i] = interactions(s[i], 310, fullStemEnergy);
+      ck_assert_str_eq(result[i], reference_long[i]);
+      free(result[i]);
+    }
+
+    omp_set_num_threads(8);
+    for (i = 0; i < n; i++) {
+      result[i] = interactions(s[i], 310, fullStemEnergy);
+      ck_assert_str_eq(result[i], reference_long[i]);
+      free(result[i]);
+    }
+
+    /* several targets at once, each one scanned sequentially */
+#pragma omp parallel for schedule(dynamic, 1)
+    for (i = 0; i < n; i++)
+      result[i] = interactions(s[i], 310, fullStemEnergy);
+
+    omp_set_num_threads(max_threads);
+  }
+#else
+  for (i = 0; i < n; i++)
+    result[i] = interactions(s[i], 310, fullStemEnergy);
+#endif
+
+  for (i = 0; i < n; i++) {
+    ck_assert_str_eq(result[i], reference_long[i]);
+    free(result[i]);
+    free(reference_long[i]);
+    free(s[i]);
+  }
+}
@@ -0,0 +1,148 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <ViennaRNA/fold_compound.h>
+#include <ViennaRNA/alphabet.h>
+#include <ViennaRNA/unstructured_domains.h>
+#include <ViennaRNA/utils/basic.h>
+
+/*
+ *  Reference implementation that naively matches each motif at each position
+ *  of the sequence, i.e. the way motif occurrences have been collected before
+ *  the position-wise motif index was introduced
+ */
+static int
+motif_matches_at(vrna_fold_compound_t *fc,
+                 int                  k,
+                 int                  i,
+                 unsigned int         loop_type)
+{
+  int       u, j;
+  vrna_ud_t *domains_up = fc->domains_up;
+
+  if (!(domains_up->motif_type[k] & loop_type))
+    return 0;
+
+  j = i + domains_up->motif_size[k] - 1;
+  if ((i < 1) || (j > (int)fc->length))
+    return 0;
+
+  for (u = i; u <= j; u++)
+    if (!vrna_nucleotide_IUPAC_identity(fc->sequence[u - 1], domains_up->motif[k][u - i]))
+      return 0;
+
+  return 1;
+}
+
+
+static void
+check_motif_list(vrna_fold_compound_t *fc,
+                 int                  *list,
+                 int                  i,
+                 int                  ending,
+                 unsigned int         loop_type)
+{
+  int k, cnt, *seen;
+
+  seen  = (int *)vrna_alloc(sizeof(int) * (fc->domains_up->motif_count + 1));
+  cnt   = 0;
+
+  if (list) {
+    for (; *list != -1; list++) {
+      ck_assert(*list >= 0);
+      ck_assert(*list < fc->domains_up->motif_count);
+      /* every motif must be reported at most once */
+      ck_assert_int_eq(seen[*list], 0);
+      seen[*list] = 1;
+      cnt++;
+    }
+
+    /* an empty list is reported as NULL */
+    ck_assert(cnt > 0);
+  }
+
+  for (k = 0; k < fc->domains_up->motif_count; k++) {
+    int start = ending ? i - fc->domains_up->motif_size[k] + 1 : i;
+    ck_assert_int_eq(seen[k], motif_matches_at(fc, k, start, loop_type));
+  }
+
+  free(seen);
+}
+
+
+static void
+check_motif_index(vrna_fold_compound_t *fc)
+{
+  unsigned int  t;
+  int           i, *list;
+  unsigned int  loop_types[] = {
+    VRNA_UNSTRUCTURED_DOMAIN_EXT_LOOP,
+    VRNA_UNSTRUCTURED_DOMAIN_HP_LOOP,
+    VRNA_UNSTRUCTURED_DOMAIN_INT_LOOP,
+    VRNA_UNSTRUCTURED_DOMAIN_MB_LOOP,
+    VRNA_UNSTRUCTURED_DOMAIN_ALL_LOOPS
+  };
+
+  for (t = 0; t < sizeof(loop_types) / sizeof(loop_types[0]); t++)
+    for (i = 1; i <= (int)fc->length; i++) {
+      list = vrna_ud_get_motifs_at(fc, i, loop_types[t]);
+      check_motif_list(fc, list, i, 0, loop_types[t]);
+      free(list);
+
+      list = vrna_ud_get_motifs_ending_at(fc, i, loop_types[t]);
+      check_motif_list(fc, list, i, 1, loop_types[t]);
+      free(list);
+    }
+
+  /* out of range positions */
+  ck_assert(vrna_ud_get_motifs_at(fc, 0, VRNA_UNSTRUCTURED_DOMAIN_ALL_LOOPS) == NULL);
+  ck_assert(vrna_ud_get_motifs_ending_at(fc, 0, VRNA_UNSTRUCTURED_DOMAIN_ALL_LOOPS) == NULL);
+  ck_assert(vrna_ud_get_motifs_ending_at(fc,
+                                         (int)fc->length + 1,
+                                         VRNA_UNSTRUCTURED_DOMAIN_ALL_LOOPS) == NULL);
+}
+
+
+/* end of prologue */
+
+#suite UnstructuredDomains
+
+#tcase MotifIndex
+
+#test test_vrna_ud_motif_index
+{
+  const char            sequence[] =
+    "GAAAGUUUUCCGAAAGGAAACUUUUCCGAAAGGAAACUAUGAAAGUUUUCAAAAAAAAAAAAAAAAAGGUAAGGAAAACCUUUUCCGAAAGG";
+  vrna_fold_compound_t  *fc;
+
+  fc = vrna_fold_compound(sequence, NULL, VRNA_OPTION_MFE | VRNA_OPTION_PF);
+
+  /* no motifs attached yet */
+  ck_assert(vrna_ud_get_motifs_ending_at(fc, 1, VRNA_UNSTRUCTURED_DOMAIN_ALL_LOOPS) == NULL);
+
+  vrna_ud_add_motif(fc, "GAAA", -2.0, "gaaa", VRNA_UNSTRUCTURED_DOMAIN_ALL_LOOPS);
+  vrna_ud_add_motif(fc, "AAA", -1.0, "aaa", VRNA_UNSTRUCTURED_DOMAIN_HP_LOOP);
+  vrna_ud_add_motif(fc, "UUUUCC", -3.0, "uuuucc", VRNA_UNSTRUCTURED_DOMAIN_EXT_LOOP);
+  vrna_ud_add_motif(fc, "RNNY", -0.5, "rnny", VRNA_UNSTRUCTURED_DOMAIN_INT_LOOP);
+  vrna_ud_add_motif(fc, "A", -0.1, "a", VRNA_UNSTRUCTURED_DOMAIN_MB_LOOP);
+
+  check_motif_index(fc);
+
+  /*
+   *  adding motifs must invalidate the index. Here, the total motif length
+   *  exceeds 64 nucleotides such that the bit-parallel search spans multiple
+   *  words
+   */
+  vrna_ud_add_motif(fc, "AAAAAAAAAAAAAAAAA", -4.0, "polyA", VRNA_UNSTRUCTURED_DOMAIN_ALL_LOOPS);
+  vrna_ud_add_motif(fc,
+                    "GAAAGUUUUCCGAAAGGAAACUUUUCCGAAAGGAAACUAUG",
+                    -5.0,
+                    "long",
+                    VRNA_UNSTRUCTURED_DOMAIN_EXT_LOOP | VRNA_UNSTRUCTURED_DOMAIN_MB_LOOP);
+  vrna_ud_add_motif(fc, "NNNNNNNNNNNNNNNNNNNNN", -0.2, "any", VRNA_UNSTRUCTURED_DOMAIN_HP_LOOP);
+  vrna_ud_add_motif(fc, "GGWAAGG", -1.5, "ggwaagg", VRNA_UNSTRUCTURED_DOMAIN_ALL_LOOPS);
+
+  check_motif_index(fc);
+
+  vrna_fold_compound_free(fc);
+}
@@ -1,9 +1,49 @@
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <ViennaRNA/model.h>
 #include <ViennaRNA/utils/basic.h>
+#include <ViennaRNA/utils/structures.h>
 #include <ViennaRNA/alphabet.h>
 
+/* random, valid dot-bracket string of length n */
+static char *
+random_structure(int n)
+{
+  char  *s;
+  int   i, top, *stack;
+
+  s     = (char *)vrna_alloc(sizeof(char) * (n + 1));
+  stack = (int *)vrna_alloc(sizeof(int) * (n + 1));
+
+  for (top = 0, i = 0; i < n; i++) {
+    switch (rand() % 3) {
+      case 0:
+        if ((top > 0) && (i - stack[top - 1] > 3)) {
+          s[stack[--top]] = '(';
+          s[i]            = ')';
+          break;
+        }
+
+      /* fall through */
+      case 1:
+        stack[top++]  = i;
+        s[i]          = '.';
+        break;
+
+      default:
+        s[i] = '.';
+        break;
+    }
+  }
+
+  free(stack);
+
+  return s;
+}
+
+
 #suite Utilities
 
 #tcase Sequence_Utils
@@ -205,3 +245,74 @@
 //@TODO: extend alphabeth
 //@TODO: details.noLP = 1
 //@TODO: idx_type = 1
+
+#test test_vrna_bp_distance_matrix
+{
+  char    **structures, line[65536], *tok;
+  int     *matrix, *read_back, d;
+  size_t  i, j, n;
+  FILE    *fp;
+
+  /* enough structures for several tiles, a few of them with a different length */
+  n           = 300;
+  structures  = (char **)vrna_alloc(sizeof(char *) * (n + 1));
+  srand(4711);
+  for (i = 0; i < n; i++)
+    structures[i] = random_structure((i % 37 == 5) ? 80 + (int)(i % 29) : 100);
+
+  /* a few duplicates */
+  free(structures[17]);
+  structures[17] = strdup(structures[3]);
+
+  matrix = vrna_bp_distance_matrix((const char **)structures);
+  ck_assert(matrix != NULL);
+
+  for (i = 1; i < n; i++)
+    for (j = 0; j < i; j++)
+      ck_assert_int_eq(matrix[i * (i - 1) / 2 + j],
+                       vrna_bp_distance(structures[i], structures[j]));
+
+  ck_assert_int_eq(matrix[17 * 16 / 2 + 3], 0);
+
+  /* binary output is the raw lower triangle */
+  fp = tmpfile();
+  ck_assert(fp != NULL);
+  ck_assert_int_eq(vrna_bp_distance_matrix_write(fp, matrix, n, VRNA_BP_DISTANCE_MATRIX_BINARY), 1);
+  rewind(fp);
+  read_back = (int *)vrna_alloc(sizeof(int) * n * (n - 1) / 2);
+  ck_assert(fread(read_back, sizeof(int), n * (n - 1) / 2, fp) == n * (n - 1) / 2);
+  ck_assert(fgetc(fp) == EOF);
+  ck_assert(memcmp(read_back, matrix, sizeof(int) * n * (n - 1) / 2) == 0);
+  fclose(fp);
+  free(read_back);
+
+  /* text output has one line per row i > 0 with i entries */
+  fp = tmpfile();
+  ck_assert(fp != NULL);
+  ck_assert_int_eq(vrna_bp_distance_matrix_write(fp, matrix, n, VRNA_BP_DISTANCE_MATRIX_TEXT), 1);
+  rewind(fp);
+  for (i = 1; fgets(line, sizeof(line), fp); i++) {
+    ck_assert(line[strlen(line) - 1] == '\n');
+    for (j = 0, tok = strtok(line, " \n"); tok; tok = strtok(NULL, " \n"), j++) {
+      ck_assert(j < i);
+      ck_assert_int_eq(sscanf(tok, "%d", &d), 1);
+      ck_assert_int_eq(d, matrix[i * (i - 1) / 2 + j]);
+    }
+    ck_assert_int_eq(j, i);
+  }
+  ck_assert_int_eq(i, n);
+  fclose(fp);
+
+  ck_assert_int_eq(vrna_bp_distance_matrix_write(NULL, matrix, n, 0), 0);
+  free(matrix);
+
+  /* less than two structures */
+  free(structures[1]);
+  structures[1] = NULL;
+  ck_assert(vrna_bp_distance_matrix((const char **)structures) == NULL);
+  ck_assert(vrna_bp_distance_matrix(NULL) == NULL);
+
+  for (i = 0; i < n; i++)
+    free(structures[i]);
+  free(structures);
+}